@@ -89,13 +89,13 @@ float3 GetHitNormal( HitData hit_data, out bool hit_valid, out float3 geometry_n
     {
         hit_valid = true;
         uint base_index = hit_data.ray_payload.primitive_index * 3;
-        uint16_t i0 = geom_indices[hit_data.geom_index][base_index + 0];
-        uint16_t i1 = geom_indices[hit_data.geom_index][base_index + 1];
-        uint16_t i2 = geom_indices[hit_data.geom_index][base_index + 2];
+        uint16_t i0 = LoadGeomIndex( hit_data.geom_index, base_index + 0 );
+        uint16_t i1 = LoadGeomIndex( hit_data.geom_index, base_index + 1 );
+        uint16_t i2 = LoadGeomIndex( hit_data.geom_index, base_index + 2 );
         
-        MeshVertex v0 = geom_vertices[hit_data.geom_index][i0];
-        MeshVertex v1 = geom_vertices[hit_data.geom_index][i1];
-        MeshVertex v2 = geom_vertices[hit_data.geom_index][i2];
+        MeshVertex v0 = LoadGeomVertex( hit_data.geom_index, i0 );
+        MeshVertex v1 = LoadGeomVertex( hit_data.geom_index, i1 );
+        MeshVertex v2 = LoadGeomVertex( hit_data.geom_index, i2 );
         
         //float3 triangle_normal_ls = normalize( cross( v1.position - v0.position, v2.position - v0.position ) );
         
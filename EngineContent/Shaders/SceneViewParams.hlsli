@@ -74,8 +74,6 @@ struct ViewFrameReadbackData
 // bind point #2 - global data (meshes, textures)
 // per workload params are specified in inline push constants
 
-static const int MAX_SCENE_GEOMS = 256;
-
 [[vk::binding( 0, 1 )]] RaytracingAccelerationStructure scene_tlas;
 [[vk::binding( 1, 1 )]] ConstantBuffer<SceneViewParams> view_data;
 [[vk::binding( 2, 1 )]] StructuredBuffer<TLASItemParams> tlas_items;
@@ -85,11 +83,23 @@ static const int MAX_SCENE_GEOMS = 256;
 [[vk::binding( 6, 1 )]] Texture2D<float4> env_cubemap;
 [[vk::binding( 7, 1 )]] SamplerState env_cubemap_sampler;
 
-[[vk::binding( 0, 2 )]] StructuredBuffer<uint16_t> geom_indices[MAX_SCENE_GEOMS];
-[[vk::binding( 1, 2 )]] StructuredBuffer<MeshVertex> geom_vertices[MAX_SCENE_GEOMS];
-
 // @todo - untyped data blob? with typed loads for different types of materials
-[[vk::binding( 2, 2 )]] StructuredBuffer<Material> materials;
+[[vk::binding( 0, 2 )]] StructuredBuffer<Material> materials;
+
+// One variable-count array of buffers for all scene geometry, index buffer of a geometry at 2 * geom_index and vertex buffer at 2 * geom_index + 1.
+// Both declarations alias the same binding, it has one element type per declaration
+[[vk::binding( 1, 2 )]] StructuredBuffer<uint16_t> geom_indices[];
+[[vk::binding( 1, 2 )]] StructuredBuffer<MeshVertex> geom_vertices[];
+
+uint16_t LoadGeomIndex( uint geom_index, uint i )
+{
+    return geom_indices[2 * geom_index][i];
+}
+
+MeshVertex LoadGeomVertex( uint geom_index, uint i )
+{
+    return geom_vertices[2 * geom_index + 1][i];
+}
 
 DebugLine MakeDebugVector( float3 start_ws, float3 dir_ws, float3 color_start, float3 color_end )
 {
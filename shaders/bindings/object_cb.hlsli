@@ -9,9 +9,13 @@ struct ObjectConstants
 
 #ifdef PER_OBJECT_CB_BINDING
 
+// instanced batches keep the constants of every instance, indexed by SV_InstanceID.
+// Must match MAX_INSTANCES_PER_BATCH in RenderData.h
+#define MAX_INSTANCES_PER_BATCH 512
+
 cbuffer cbPerObject : register( PER_OBJECT_CB_BINDING )
 {
-    ObjectConstants renderitem;
+    ObjectConstants renderitems[MAX_INSTANCES_PER_BATCH];
 }
 
 #endif // PER_OBJECT_CB_BINDING
@@ -11,6 +11,7 @@ struct VertexIn
     float3 pos : POSITION;
     float3 normal : NORMAL;
     float2 uv : TEXCOORD;
+    uint instance_id : SV_InstanceID;
 };
 
 struct VertexOut
@@ -21,6 +22,7 @@ struct VertexOut
 
 VertexOut main(VertexIn vin)
 {
+    ObjectConstants renderitem = renderitems[vin.instance_id];
     float4 pos_ws = mul( float4( vin.pos, 1.0f ), renderitem.model_mat );
     VertexOut vout;
     vout.pos = mul( pos_ws, pass_params.view_proj_mat );	
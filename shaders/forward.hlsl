@@ -28,6 +28,7 @@ struct VertexIn
     float3 normal : NORMAL;
     float3 tangent : TANGENT;
     float2 uv : TEXCOORD;
+    uint instance_id : SV_InstanceID;
 };
 
 struct VertexOut
@@ -139,6 +140,7 @@ float4 dbg_get_lod_color( float4 base_color, float lod )
 
 VertexOut main_vs( VertexIn vin )
 {
+    ObjectConstants renderitem = renderitems[vin.instance_id];
     float4 pos_ws = mul( float4( vin.pos, 1.0f ), renderitem.model_mat );
     VertexOut vout;
     float4 pos_v = mul( pos_ws, pass_params.view_mat );
@@ -17,6 +17,7 @@ struct VertexIn
     float3 pos : POSITION;
     float3 normal : NORMAL;
     float2 uv : TEXCOORD;
+    uint instance_id : SV_InstanceID;
 };
 
 struct VertexOut
@@ -27,6 +28,7 @@ struct VertexOut
 
 VertexOut main(VertexIn vin)
 {
+    ObjectConstants renderitem = renderitems[vin.instance_id];
     float4x4 mv_mat = mul( renderitem.model_mat, pass_params.view_mat );
     VertexOut vout;
     
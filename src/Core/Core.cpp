@@ -54,6 +54,7 @@ Logger::~Logger()
 
 void Logger::Flush()
 {
+	std::scoped_lock lock( m_cs );
 	if ( m_write_to_std )
 	{
 		std::flush( std::cout );
@@ -93,6 +94,7 @@ void Logger::Log( const LogCategory& category, LogMessageType msg_type, const ch
 
 	message << buf << "\n";
 
+	std::unique_lock lock( m_cs );
 	if ( m_file && m_file->good() )
 	{
 		( *m_file ) << message.str();
@@ -112,6 +114,7 @@ void Logger::Log( const LogCategory& category, LogMessageType msg_type, const ch
 	{
 		OutputDebugStringA( message.str().c_str() );
 	}
+	lock.unlock();
 
 	if ( msg_type == LogMessageType::FatalError )
 	{
@@ -126,6 +129,7 @@ void Logger::Log( const LogCategory& category, LogMessageType msg_type, const ch
 
 void Logger::Newline()
 {
+	std::scoped_lock lock( m_cs );
 	if ( m_file && m_file->good() )
 	{
 		( *m_file ) << '\n';
@@ -261,6 +261,7 @@ class Logger
 {
 private:
 	std::optional<std::ofstream> m_file;
+	std::mutex m_cs; // messages come from worker threads too
 	bool m_write_to_std = true;
 	bool m_write_debugstr = true;
 
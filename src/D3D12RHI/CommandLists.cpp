@@ -27,6 +27,8 @@ D3D12CommandList* D3D12CommandListManager::GetCommandList(RHI::QueueType type)
 {
     VERIFY_EQUALS(type < RHI::QueueType::Count, true);
 
+    std::scoped_lock lock(m_lock);
+
     auto& free_lists = m_free_lists[size_t(type)];
     if (!free_lists.empty())
     {
@@ -50,8 +52,10 @@ RHIFence D3D12CommandListManager::SubmitCommandLists(const RHI::SubmitInfo& info
 
     const size_t queue_idx = size_t(info.cmd_lists[0]->GetType());
 
+    std::scoped_lock lock(m_lock);
+
     // Not necessary, but we have to do this somewhere at regular intervals. Why not here?
-    ProcessCompleted();
+    ProcessCompletedNoLock();
 
     constexpr size_t typical_num_lists = 4;
 
@@ -104,10 +108,19 @@ void D3D12CommandListManager::WaitForFence(const RHIFence& fence)
 }
 
 void D3D12CommandListManager::ProcessCompleted()
+{
+    std::scoped_lock lock(m_lock);
+    ProcessCompletedNoLock();
+}
+
+void D3D12CommandListManager::ProcessCompletedNoLock()
 {
     for (size_t queue_i = 0; queue_i < m_submitted_lists.size(); ++queue_i)
     {
         auto& submitted_lists = m_submitted_lists[queue_i];
+        if (submitted_lists.empty())
+            continue; // also skips queues the device doesn't have
+
         auto& free_lists = m_free_lists[queue_i];
         D3DQueue* d3d_queue = m_rhi->GetQueue(RHI::QueueType(queue_i));
         VERIFY_NOT_EQUAL(d3d_queue, nullptr);
@@ -132,15 +145,21 @@ void D3D12CommandListManager::WaitSubmittedUntilCompletion()
 {
     for (size_t queue_i = 0; queue_i < m_submitted_lists.size(); ++queue_i)
     {
-        auto& submitted_lists = m_submitted_lists[queue_i];
+        uint64_t last_fence = 0;
+        {
+            std::scoped_lock lock(m_lock);
 
-        if (submitted_lists.empty())
-            continue;
+            auto& submitted_lists = m_submitted_lists[queue_i];
+            if (submitted_lists.empty())
+                continue;
+
+            last_fence = submitted_lists.back().completion_fence;
+        }
 
         D3DQueue* d3d_queue = m_rhi->GetQueue(RHI::QueueType(queue_i));
         VERIFY_NOT_EQUAL(d3d_queue, nullptr);
 
-        d3d_queue->WaitForSignal(submitted_lists.back().completion_fence);
+        d3d_queue->WaitForSignal(last_fence);
     }
 
     ProcessCompleted();
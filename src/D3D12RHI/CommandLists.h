@@ -9,6 +9,9 @@ class D3D12CommandListManager
 private:
 	class D3D12RHI* m_rhi = nullptr;
 
+	// GetCommandList and SubmitCommandLists may be called from several threads
+	std::mutex m_lock;
+
 	std::array<packed_freelist<std::unique_ptr<class D3D12CommandList>>, size_t(RHI::QueueType::Count)> m_cmd_lists;
 
 public:
@@ -38,6 +41,9 @@ public:
 
 	void WaitSubmittedUntilCompletion();
 
+private:
+	void ProcessCompletedNoLock();
+
 };
 
 class D3D12CommandList : public RHICommandList
@@ -54,6 +54,15 @@ void D3D12RHI::WaitForFenceCompletion(const RHIFence& fence)
     return m_cmd_list_mgr->WaitForFence(fence);
 }
 
+bool D3D12RHI::IsFenceCompleted(const RHIFence& fence)
+{
+    D3DQueue* queue = GetQueue(static_cast<RHI::QueueType>(fence._3));
+    if (!queue)
+        return true;
+
+    return queue->Poll() >= fence._1;
+}
+
 RHICommandList* D3D12RHI::GetCommandList(QueueType type)
 {
     return m_cmd_list_mgr->GetCommandList(type);
@@ -59,6 +59,7 @@ public:
 
 	virtual RHIFence SubmitCommandLists(const SubmitInfo& info) override;
 	virtual void WaitForFenceCompletion(const RHIFence& fence) override;
+	virtual bool IsFenceCompleted(const RHIFence& fence) override;
 
 	virtual RHICommandList* GetCommandList(QueueType type);
 
@@ -4,31 +4,377 @@
 
 #include "Assets.h"
 
+CVAR_DEFINE( asset_loadThreads, uint32_t, 0, "Number of threads preparing assets for the upload stage, 0 means one per core. Applied on startup" );
+CVAR_DEFINE( asset_orphanBudgetMB, uint32_t, 256, "Assets nobody references stay loaded for reuse until they take more memory than this, least recently used ones are unloaded first" );
+
+enum class AssetLoadState : uint8_t
+{
+	Queued = 0,
+	Preparing, // on a loader thread
+	WaitingForDependencies,
+	WaitingForUpload,
+	Uploading,
+	FinishingUpload, // waits for Asset::FinishUpload
+	Done,
+	Cancelled
+};
+
+// Guarded by AssetManager::m_load_cs
+struct AssetLoadRequest
+{
+	AssetId id;
+	AssetLoadPriority priority = AssetLoadPriority::Normal;
+	AssetLoadState state = AssetLoadState::Queued;
+
+	uint32_t num_interested = 0; // handles that weren't cancelled and dependent requests
+	uint32_t num_pending_dependencies = 0;
+
+	// prepared asset, owned by the request until it is uploaded
+	Asset* asset = nullptr;
+
+	std::vector<std::shared_ptr<AssetLoadRequest>> dependencies; // unfinished ones
+	std::vector<AssetPtr> loaded_dependencies; // kept alive until the upload
+	std::vector<std::shared_ptr<AssetLoadRequest>> dependents;
+
+	AssetPtr result;
+
+	AssetLoadRequest( const AssetId& in_id ) : id( in_id ) {}
+};
+
+namespace
+{
+	bool IsFinished( AssetLoadState state )
+	{
+		return state == AssetLoadState::Done || state == AssetLoadState::Cancelled;
+	}
+
+	void RemoveRequest( std::vector<std::shared_ptr<AssetLoadRequest>>& requests, const AssetLoadRequest& request )
+	{
+		auto it = std::find_if( requests.begin(), requests.end(), [&request]( const auto& other ) { return other.get() == &request; } );
+		if ( it != requests.end() )
+			requests.erase( it );
+	}
+
+	uint64_t HashAssetPath( const char* path )
+	{
+		uint64_t hash = 0xcbf29ce484222325ull;
+		for ( const char* c = path; *c != '\0'; ++c )
+		{
+			hash ^= uint8_t( *c );
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	class AssetPathTable
+	{
+	public:
+		const InternedAssetPath* Intern( const char* path )
+		{
+			const uint64_t hash = HashAssetPath( path );
+			Shard& shard = m_shards[hash >> ( 64 - NumShardsLog2 )];
+
+			std::scoped_lock lock( shard.cs );
+			auto [begin, end] = shard.paths.equal_range( hash );
+			for ( auto it = begin; it != end; ++it )
+			{
+				if ( it->second->path == path )
+					return it->second.get();
+			}
+
+			auto interned = std::make_unique<InternedAssetPath>();
+			interned->hash = hash;
+			interned->path = path;
+			return shard.paths.emplace( hash, std::move( interned ) )->second.get();
+		}
+
+	private:
+		static constexpr uint32_t NumShardsLog2 = 4;
+
+		struct alignas( 64 ) Shard
+		{
+			std::mutex cs;
+			std::unordered_multimap<uint64_t, std::unique_ptr<InternedAssetPath>> paths;
+		};
+		std::array<Shard, 1u << NumShardsLog2> m_shards;
+	};
+
+	AssetPathTable& GetAssetPathTable()
+	{
+		// never destroyed, ids in static objects may outlive everything else
+		static AssetPathTable* table = new AssetPathTable();
+		return *table;
+	}
+}
+
+AssetId::AssetId( const char* path )
+	: m_path( GetAssetPathTable().Intern( path ) )
+{
+}
+
 void Asset::Release()
 {
+	// once the reference is dropped the asset may be unloaded by another thread at any moment
+	AssetManager* mgr = m_mgr;
+	const AssetId id = m_id;
 	if ( --m_refs <= 0 )
-		m_mgr->Orphan( m_id );
+		mgr->Orphan( id );
+}
+
+
+AssetRegistry::~AssetRegistry()
+{
+	CollectOrphanRecords();
+	SE_ENSURE( GetNumAssets() == 0 );
+}
+
+AssetPtr AssetRegistry::Find( const AssetId& id )
+{
+	Shard& shard = GetShard( id );
+	std::scoped_lock lock( shard.cs );
+
+	auto entry = shard.entries.find( id );
+	if ( entry == shard.entries.end() )
+		return nullptr;
+
+	// the LRU record becomes stale and is dropped by UnloadOrphans
+	if ( entry->second.orphaned )
+	{
+		entry->second.orphaned = false;
+		m_orphan_memory.fetch_sub( entry->second.memory_usage, std::memory_order_relaxed );
+	}
+
+	// referenced under the lock, so a concurrent UnloadOrphans can't take it
+	return entry->second.asset;
+}
+
+void AssetRegistry::Register( Asset* asset )
+{
+	Shard& shard = GetShard( asset->m_id );
+	std::scoped_lock lock( shard.cs );
+
+	Entry& entry = shard.entries[asset->m_id];
+	SE_ENSURE( entry.asset == nullptr );
+	entry.asset = asset;
+	entry.memory_usage = asset->GetMemoryUsage();
+}
+
+void AssetRegistry::Orphan( const AssetId& id )
+{
+	uint64_t tick = 0;
+	{
+		Shard& shard = GetShard( id );
+		std::scoped_lock lock( shard.cs );
+
+		auto entry = shard.entries.find( id );
+		if ( entry == shard.entries.end() || entry->second.orphaned || entry->second.asset->m_refs > 0 )
+			return;
+
+		tick = m_orphan_clock.fetch_add( 1, std::memory_order_relaxed ) + 1;
+		entry->second.orphaned = true;
+		entry->second.orphan_tick = tick;
+		m_orphan_memory.fetch_add( entry->second.memory_usage, std::memory_order_relaxed );
+	}
+
+	OrphanRecord* record = new OrphanRecord{ id, tick, m_orphan_records.load( std::memory_order_relaxed ) };
+	while ( !m_orphan_records.compare_exchange_weak( record->next, record, std::memory_order_release, std::memory_order_relaxed ) )
+	{
+	}
+}
+
+void AssetRegistry::CollectOrphanRecords()
+{
+	OrphanRecord* record = m_orphan_records.exchange( nullptr, std::memory_order_acquire );
+	while ( record != nullptr )
+	{
+		// only the latest record of an asset can match its entry
+		auto [lru_tick, inserted] = m_orphan_lru_ticks.try_emplace( record->id, record->tick );
+		if ( inserted )
+		{
+			m_orphan_lru.emplace( record->tick, record->id );
+		}
+		else if ( lru_tick->second < record->tick )
+		{
+			m_orphan_lru.erase( lru_tick->second );
+			m_orphan_lru.emplace( record->tick, record->id );
+			lru_tick->second = record->tick;
+		}
+
+		OrphanRecord* next = record->next;
+		delete record;
+		record = next;
+	}
+}
+
+uint32_t AssetRegistry::UnloadOrphans( size_t budget )
+{
+	uint32_t num_unloaded = 0;
+	std::vector<Asset*> unloaded;
+	do
+	{
+		CollectOrphanRecords();
+
+		unloaded.clear();
+		while ( !m_orphan_lru.empty() && ( budget == 0 || GetOrphanMemoryUsage() > budget ) )
+		{
+			const uint64_t tick = m_orphan_lru.begin()->first;
+			const AssetId id = m_orphan_lru.begin()->second;
+			m_orphan_lru.erase( m_orphan_lru.begin() );
+			m_orphan_lru_ticks.erase( id );
+
+			Shard& shard = GetShard( id );
+			std::scoped_lock lock( shard.cs );
+
+			// revived, or orphaned again after the record was taken
+			auto entry = shard.entries.find( id );
+			if ( entry == shard.entries.end() || !entry->second.orphaned || entry->second.orphan_tick != tick || entry->second.asset->m_refs > 0 )
+				continue;
+
+			m_orphan_memory.fetch_sub( entry->second.memory_usage, std::memory_order_relaxed );
+			unloaded.push_back( entry->second.asset );
+			shard.entries.erase( entry );
+		}
+
+		// deleted outside of the locks, assets release their dependencies and those may become orphans too
+		for ( Asset* asset : unloaded )
+			delete asset;
+		num_unloaded += uint32_t( unloaded.size() );
+	} while ( !unloaded.empty() );
+
+	return num_unloaded;
+}
+
+uint32_t AssetRegistry::GetNumAssets()
+{
+	uint32_t num_assets = 0;
+	for ( Shard& shard : m_shards )
+	{
+		std::scoped_lock lock( shard.cs );
+		num_assets += uint32_t( shard.entries.size() );
+	}
+	return num_assets;
+}
+
+std::vector<Asset*> AssetRegistry::RemoveAll()
+{
+	std::vector<Asset*> assets;
+	for ( Shard& shard : m_shards )
+	{
+		std::scoped_lock lock( shard.cs );
+		for ( const auto& [id, entry] : shard.entries )
+			assets.push_back( entry.asset );
+		shard.entries.clear();
+	}
+
+	CollectOrphanRecords();
+	m_orphan_lru.clear();
+	m_orphan_lru_ticks.clear();
+	m_orphan_memory = 0;
+
+	return assets;
+}
+
+
+bool AssetLoadHandle::IsDone() const
+{
+	if ( !m_request )
+		return false;
+
+	std::scoped_lock lock( m_mgr->m_load_cs );
+	return IsFinished( m_request->state );
+}
+
+AssetPtr AssetLoadHandle::Wait()
+{
+	if ( !m_request )
+		return nullptr;
+
+	return m_mgr->WaitForRequest( *m_request );
+}
+
+AssetPtr AssetLoadHandle::GetAsset() const
+{
+	if ( !m_request )
+		return nullptr;
+
+	std::scoped_lock lock( m_mgr->m_load_cs );
+	return m_request->result;
+}
+
+void AssetLoadHandle::Cancel()
+{
+	if ( !m_request || m_cancelled )
+		return;
+
+	std::scoped_lock lock( m_mgr->m_load_cs );
+	m_cancelled = true;
+	m_mgr->ReleaseInterest( *m_request );
 }
 
 
-AssetManager::AssetManager()
+AssetManager::AssetManager( uint32_t num_load_threads )
 {
 	RegisterGenerators();
+
+	m_upload_thread = std::this_thread::get_id();
+
+	if ( num_load_threads == 0 )
+		num_load_threads = std::max( std::thread::hardware_concurrency(), 1u );
+
+	m_load_threads.reserve( num_load_threads );
+	for ( uint32_t i = 0; i < num_load_threads; ++i )
+		m_load_threads.emplace_back( [this]() { LoadThreadLoop(); } );
 }
 
 AssetManager::~AssetManager()
 {
+	{
+		std::scoped_lock lock( m_load_cs );
+		m_stop_loading = true;
+	}
+	m_load_queue_cv.notify_all();
+
+	for ( std::thread& thread : m_load_threads )
+		thread.join();
+
+	{
+		std::scoped_lock lock( m_load_cs );
+
+		if ( !m_requests.empty() )
+			SE_LOG_WARNING( Engine, "Dropped %u unfinished asset loads when destroying AssetManager", uint32_t( m_requests.size() ) );
+
+		// requests reference each other, the lists are cleared to break the cycles
+		for ( auto& [id, request] : m_requests )
+		{
+			delete request->asset;
+			request->asset = nullptr;
+			request->state = AssetLoadState::Cancelled;
+			request->dependencies.clear();
+			request->dependents.clear();
+			request->loaded_dependencies.clear();
+		}
+		m_requests.clear();
+		m_load_queue.clear();
+		m_upload_queue.clear();
+		m_finishing_uploads.clear();
+	}
+	m_load_done_cv.notify_all();
+
 	UnloadAllOrphans();
 
-	if ( !m_assets.empty() )
+	const std::vector<Asset*> assets_in_use = m_registry.RemoveAll();
+	if ( !assets_in_use.empty() )
 	{
 		SE_LOG_ERROR( Engine, "Found assets still in use when destroying AssetManager :" );
 	}
 
-	for ( auto& asset : m_assets )
+	for ( Asset* asset : assets_in_use )
 	{
-		SE_LOG_ERROR( Engine, "\t%s", asset.first.GetPath() );
-		delete asset.second.asset;
+		SE_LOG_ERROR( Engine, "\t%s", asset->GetPath() );
+	}
+	for ( Asset* asset : assets_in_use )
+	{
+		delete asset;
 	}
 }
 
@@ -38,155 +384,512 @@ AssetPtr AssetManager::Load( const AssetId& id )
 	if ( found_asset != nullptr )
 		return found_asset;
 
-	// Load from disk
+	return LoadAsync( id, AssetLoadPriority::High ).Wait();
+}
+
+AssetLoadHandle AssetManager::LoadAsync( const AssetId& id, AssetLoadPriority priority )
+{
+	AssetLoadHandle handle;
+	handle.m_mgr = this;
+
+	std::scoped_lock lock( m_load_cs );
+
+	// loaded assets are registered and removed from m_requests under m_load_cs, so a load is never started twice
+	if ( m_requests.find( id ) == m_requests.end() )
+	{
+		AssetPtr loaded_asset = FindLoadedAsset( id );
+		if ( loaded_asset != nullptr )
+		{
+			handle.m_request = std::make_shared<AssetLoadRequest>( id );
+			handle.m_request->state = AssetLoadState::Done;
+			handle.m_request->num_interested = 1;
+			handle.m_request->result = std::move( loaded_asset );
+			return handle;
+		}
+	}
+
+	handle.m_request = FindOrCreateRequest( id, priority );
+	handle.m_request->num_interested++;
+	return handle;
+}
+
+uint32_t AssetManager::ProcessUploads()
+{
+	if ( !SE_ENSURE( std::this_thread::get_id() == m_upload_thread ) )
+		return 0;
+
+	uint32_t num_uploaded = 0;
+
+	std::unique_lock lock( m_load_cs );
+	do
+	{
+		while ( !m_upload_queue.empty() )
+		{
+			// the queue is short, FIFO order within a priority is kept
+			auto next = std::max_element( m_upload_queue.begin(), m_upload_queue.end(),
+				[]( const auto& a, const auto& b ) { return a->priority < b->priority; } );
+			std::shared_ptr<AssetLoadRequest> request = std::move( *next );
+			m_upload_queue.erase( next );
+
+			// cancelled requests are left in the queue
+			if ( request->state != AssetLoadState::WaitingForUpload )
+				continue;
+
+			request->state = AssetLoadState::Uploading;
+			Asset* asset = request->asset;
+
+			lock.unlock();
+			const bool uploaded = asset->Upload();
+			lock.lock();
+
+			if ( !uploaded )
+			{
+				SE_LOG_ERROR( Engine, "Asset %s failed to upload", request->id.GetPath() );
+				request->asset = nullptr;
+				delete asset;
+
+				FinishRequest( *request, nullptr );
+				num_uploaded++;
+				continue;
+			}
+
+			// finished after the whole queue is uploaded, so GPU work of the uploads goes to the same batch
+			request->state = AssetLoadState::FinishingUpload;
+			m_finishing_uploads.push_back( std::move( request ) );
+		}
+
+		// finished assets may let their dependents upload
+		num_uploaded += FinishUploads( lock );
+	} while ( !m_upload_queue.empty() );
+
+	return num_uploaded;
+}
+
+size_t AssetManager::GetNumLoadsInFlight()
+{
+	std::scoped_lock lock( m_load_cs );
+	return m_requests.size();
+}
+
+uint32_t AssetManager::UnloadOrphans( size_t budget )
+{
+	return m_registry.UnloadOrphans( budget );
+}
+
+void AssetManager::UnloadAllOrphans()
+{
+	const uint32_t num_unloaded = m_registry.UnloadOrphans( 0 );
+
+	SE_LOG_INFO( Engine, "Unloaded %u orphans", num_unloaded );
+}
+
+void AssetManager::Orphan( const AssetId& asset_id )
+{
+	m_registry.Orphan( asset_id );
+}
+
+template <class AssetClass>
+Asset* AssetManager::CreateAsset( const AssetId& id, AssetManager& mgr )
+{
+	return new AssetClass( id, mgr );
+}
+
+
+AssetPtr AssetManager::FindLoadedAsset( const AssetId& id )
+{
+	AssetPtr found_asset = m_registry.Find( id );
+
+	if ( found_asset && found_asset->GetStatus() == AssetStatus::Invalid )
+	{
+		// try reloading? maybe track the number of reload attempts
+		NOTIMPL;
+	}
+	
+	return found_asset;
+}
+
+void AssetManager::RegisterGenerators()
+{
+	// todo: automatic generation?
+
+#ifdef REGISTER_ASSET_GENERATOR
+#error "Macro REGISTER_ASSET_GENERATOR is already defined"
+#endif
+#define REGISTER_ASSET_GENERATOR( className ) m_factories[ S_(className) ] = CreateAsset<className>;
+
+	REGISTER_ASSET_GENERATOR( CubeAsset );
+	REGISTER_ASSET_GENERATOR( MeshAsset );
+	REGISTER_ASSET_GENERATOR( TextureAsset );
+	REGISTER_ASSET_GENERATOR( MaterialAsset );
+
+#undef REGISTER_ASSET_GENERATOR
+}
+
+Asset* AssetManager::CreateAssetFromFile( const AssetId& id, Json& data )
+{
 	// todo: memory-map the file and only read generator part to figure out asset class (should be the first)
 	// Can probably skip even that if generator class is known beforehand
 	std::string ospath = ToOSPath( id.GetPath() );
 	std::ifstream file( ospath );
 	if ( !file.good() )
 	{
-		SE_LOG_ERROR( Engine, "Can't open file %s (OS path: %s)", id.GetPath(), ospath );
+		SE_LOG_ERROR( Engine, "Can't open file %s (OS path: %s)", id.GetPath(), ospath.c_str() );
 		return nullptr;
 	}
 
-	Json d;
 	rapidjson::IStreamWrapper isw( file );
-	rapidjson::ParseResult parse_res = d.ParseStream( isw );
+	rapidjson::ParseResult parse_res = data.ParseStream( isw );
 	if ( parse_res.IsError() )
 	{
 		SE_LOG_ERROR( Engine, "File %s (OS path: %s) is not a valid asset file : json parse error %s (%u)", id.GetPath(), ospath.c_str(), rapidjson::GetParseError_En(parse_res.Code()), parse_res.Offset());
 		return nullptr;
 	}
 
-	JsonValue::MemberIterator generator = d.FindMember( "_generator" );
+	JsonValue::MemberIterator generator = data.FindMember( "_generator" );
 
-	if ( generator == d.MemberEnd() || !generator->value.IsString() )
+	if ( generator == data.MemberEnd() || !generator->value.IsString() )
 	{
-		SE_LOG_ERROR( Engine, "File %s (OS path : %s) is not a valid asset file : _generator value is invalid", id.GetPath(), ospath );
+		SE_LOG_ERROR( Engine, "File %s (OS path : %s) is not a valid asset file : _generator value is invalid", id.GetPath(), ospath.c_str() );
 		return nullptr;
 	}
 
 	auto factory = m_factories.find( generator->value.GetString() );
 	if ( factory == m_factories.end() )
 	{
-		SE_LOG_ERROR( Engine, "File %s (OS path : %s) is not a valid asset file : _generator %s is not found", id.GetPath(), ospath, generator->value.GetString() );
+		SE_LOG_ERROR( Engine, "File %s (OS path : %s) is not a valid asset file : _generator %s is not found", id.GetPath(), ospath.c_str(), generator->value.GetString() );
 		return nullptr;
 	}
 
 	Asset* created_asset = factory->second( id, *this );
-	if ( !SE_ENSURE( created_asset ) )
-		return nullptr;
+	SE_ENSURE( created_asset );
 
-	// todo: async loading
-	if ( !created_asset->Load( d ) )
+	return created_asset;
+}
+
+std::shared_ptr<AssetLoadRequest> AssetManager::FindOrCreateRequest( const AssetId& id, AssetLoadPriority priority )
+{
+	auto existing = m_requests.find( id );
+	if ( existing != m_requests.end() )
 	{
-		delete created_asset;
-		return nullptr;
+		RaisePriority( existing->second, priority );
+		return existing->second;
 	}
 
-	std::scoped_lock lock_read( m_read_cs );
-	std::scoped_lock lock( m_write_cs );
-	m_assets[id].asset = created_asset;
+	auto request = std::make_shared<AssetLoadRequest>( id );
+	request->priority = priority;
+	m_requests.emplace( id, request );
 
-	return created_asset;
+	m_load_queue.push_back( QueuedLoad{ priority, m_next_sequence++, request } );
+	std::push_heap( m_load_queue.begin(), m_load_queue.end(), LoadQueueLess );
+	m_load_queue_cv.notify_one();
+
+	return request;
 }
 
-void AssetManager::UnloadAllOrphans()
+bool AssetManager::LoadQueueLess( const QueuedLoad& a, const QueuedLoad& b )
+{
+	// max-heap, older requests go first within a priority
+	if ( a.priority != b.priority )
+		return a.priority < b.priority;
+	return a.sequence > b.sequence;
+}
+
+void AssetManager::RaisePriority( const std::shared_ptr<AssetLoadRequest>& request, AssetLoadPriority priority )
 {
-	std::unordered_map<AssetId, AssetManagerEntry> orphans_copy;
-	int num_unloaded = 0;
-	while ( !m_orphans.empty() )
+	if ( priority <= request->priority || IsFinished( request->state ) )
+		return;
+
+	request->priority = priority;
+
+	// the old heap entry becomes stale and is skipped by the loader threads
+	if ( request->state == AssetLoadState::Queued )
 	{
+		m_load_queue.push_back( QueuedLoad{ priority, m_next_sequence++, request } );
+		std::push_heap( m_load_queue.begin(), m_load_queue.end(), LoadQueueLess );
+		m_load_queue_cv.notify_one();
+	}
+
+	for ( const auto& dependency : request->dependencies )
+		RaisePriority( dependency, priority );
+}
+
+void AssetManager::AddDependency( const std::shared_ptr<AssetLoadRequest>& request, const AssetId& dependency_id )
+{
+	if ( m_requests.find( dependency_id ) == m_requests.end() )
+	{
+		AssetPtr loaded_dependency = FindLoadedAsset( dependency_id );
+		if ( loaded_dependency != nullptr )
 		{
-			std::scoped_lock lock( m_orphan_cs );
-			orphans_copy = std::move( m_orphans );
-			m_orphans.clear();
+			request->loaded_dependencies.emplace_back( std::move( loaded_dependency ) );
+			return;
 		}
+	}
 
-		for ( auto& orphan : orphans_copy )
+	auto existing = m_requests.find( dependency_id );
+	if ( existing != m_requests.end() && ( existing->second == request || DependsOn( *existing->second, *request ) ) )
+	{
+		// the asset of the request is uploaded first and can't find this dependency
+		SE_LOG_WARNING( Engine, "Asset %s has a cyclic dependency on %s", request->id.GetPath(), dependency_id.GetPath() );
+		return;
+	}
+
+	std::shared_ptr<AssetLoadRequest> dependency = FindOrCreateRequest( dependency_id, request->priority );
+	for ( const auto& other : request->dependencies )
+	{
+		if ( other == dependency )
+			return;
+	}
+
+	dependency->num_interested++;
+	dependency->dependents.push_back( request );
+	request->dependencies.push_back( dependency );
+	request->num_pending_dependencies++;
+}
+
+bool AssetManager::DependsOn( const AssetLoadRequest& request, const AssetLoadRequest& dependency ) const
+{
+	// unfinished dependencies never form a cycle, visited requests are only tracked to skip shared subgraphs
+	std::vector<const AssetLoadRequest*> stack = { &request };
+	std::unordered_set<const AssetLoadRequest*> visited;
+	while ( !stack.empty() )
+	{
+		const AssetLoadRequest* current = stack.back();
+		stack.pop_back();
+
+		for ( const auto& next : current->dependencies )
 		{
-			delete orphan.second.asset;
-			num_unloaded++;
+			if ( next.get() == &dependency )
+				return true;
+			if ( visited.insert( next.get() ).second )
+				stack.push_back( next.get() );
 		}
 	}
+	return false;
+}
 
-	SE_LOG_INFO( Engine, "Unloaded %i orphans", num_unloaded );
+void AssetManager::ReleaseInterest( AssetLoadRequest& request )
+{
+	if ( !SE_ENSURE( request.num_interested > 0 ) )
+		return;
 
-	m_orphans.clear();
+	if ( --request.num_interested == 0 && !IsFinished( request.state ) )
+		CancelRequest( request );
 }
 
-void AssetManager::Orphan( const AssetId& asset_id )
+void AssetManager::OnDependencyFinished( const std::shared_ptr<AssetLoadRequest>& request )
 {
-	std::scoped_lock lock1( m_read_cs );
+	if ( !SE_ENSURE( request->num_pending_dependencies > 0 ) )
+		return;
 
-	auto entry = m_assets.find( asset_id );
-	if ( entry != m_assets.end() )
+	if ( --request->num_pending_dependencies == 0 && request->state == AssetLoadState::WaitingForDependencies )
 	{
-		std::scoped_lock lock2( m_orphan_cs );
-		std::scoped_lock lock3( m_write_cs );
+		request->state = AssetLoadState::WaitingForUpload;
+		m_upload_queue.push_back( request );
+		m_load_done_cv.notify_all();
+	}
+}
+
+void AssetManager::FinishRequest( AssetLoadRequest& request, Asset* asset )
+{
+	request.state = AssetLoadState::Done;
+	request.asset = nullptr;
+
+	auto entry = m_requests.find( request.id );
+	if ( entry != m_requests.end() && entry->second.get() == &request )
+		m_requests.erase( entry );
 
-		m_orphans[asset_id] = entry->second;
-		m_assets.erase( entry );
+	if ( asset != nullptr )
+	{
+		asset->m_status = AssetStatus::Ready;
+		request.result = asset;
+
+		m_registry.Register( asset );
+	}
+
+	// failed dependencies don't fail the dependents, their assets handle missing dependencies on upload
+	std::vector<std::shared_ptr<AssetLoadRequest>> dependents = std::move( request.dependents );
+	request.dependents.clear();
+	for ( const auto& dependent : dependents )
+	{
+		RemoveRequest( dependent->dependencies, request );
+		if ( asset != nullptr )
+			dependent->loaded_dependencies.push_back( request.result );
+		OnDependencyFinished( dependent );
+	}
 
-		SE_LOG_INFO( Temp, "Orphan %s", asset_id.GetPath() );
+	std::vector<std::shared_ptr<AssetLoadRequest>> dependencies = std::move( request.dependencies );
+	request.dependencies.clear();
+	for ( const auto& dependency : dependencies )
+	{
+		RemoveRequest( dependency->dependents, request );
+		ReleaseInterest( *dependency );
 	}
+	request.loaded_dependencies.clear();
+
+	m_load_done_cv.notify_all();
 }
 
-template <class AssetClass>
-Asset* AssetManager::CreateAsset( const AssetId& id, AssetManager& mgr )
+uint32_t AssetManager::FinishUploads( std::unique_lock<std::mutex>& lock )
 {
-	return new AssetClass( id, mgr );
+	uint32_t num_finished = 0;
+
+	// only the upload thread changes the list
+	std::vector<std::shared_ptr<AssetLoadRequest>> finishing = std::move( m_finishing_uploads );
+	m_finishing_uploads.clear();
+	for ( std::shared_ptr<AssetLoadRequest>& request : finishing )
+	{
+		Asset* asset = request->asset;
+
+		lock.unlock();
+		const bool finished = asset->FinishUpload();
+		lock.lock();
+
+		if ( !finished )
+		{
+			m_finishing_uploads.push_back( std::move( request ) );
+			continue;
+		}
+
+		FinishRequest( *request, asset );
+		num_finished++;
+	}
+
+	return num_finished;
 }
 
+void AssetManager::CancelRequest( AssetLoadRequest& request )
+{
+	// the upload is already running, the asset is kept
+	if ( request.state == AssetLoadState::Uploading || request.state == AssetLoadState::FinishingUpload )
+		return;
 
-AssetPtr AssetManager::FindLoadedAsset( const AssetId& id )
+	const AssetLoadState prev_state = request.state;
+	request.state = AssetLoadState::Cancelled;
+
+	auto entry = m_requests.find( request.id );
+	if ( entry != m_requests.end() && entry->second.get() == &request )
+		m_requests.erase( entry );
+
+	// a preparing asset is deleted by its loader thread, queued requests are skipped by them
+	if ( prev_state == AssetLoadState::WaitingForDependencies || prev_state == AssetLoadState::WaitingForUpload )
+	{
+		delete request.asset;
+		request.asset = nullptr;
+	}
+
+	// every dependent holds an interest, so there are none left
+	SE_ENSURE( request.dependents.empty() );
+
+	std::vector<std::shared_ptr<AssetLoadRequest>> dependencies = std::move( request.dependencies );
+	request.dependencies.clear();
+	for ( const auto& dependency : dependencies )
+	{
+		RemoveRequest( dependency->dependents, request );
+		ReleaseInterest( *dependency );
+	}
+	request.loaded_dependencies.clear();
+
+	m_load_done_cv.notify_all();
+}
+
+void AssetManager::LoadThreadLoop()
 {
-	std::scoped_lock lock( m_read_cs );
+	while ( true )
+	{
+		std::shared_ptr<AssetLoadRequest> request;
+		{
+			std::unique_lock lock( m_load_cs );
+			m_load_queue_cv.wait( lock, [this]() { return m_stop_loading || !m_load_queue.empty(); } );
+			if ( m_stop_loading )
+				return;
+
+			std::pop_heap( m_load_queue.begin(), m_load_queue.end(), LoadQueueLess );
+			request = std::move( m_load_queue.back().request );
+			m_load_queue.pop_back();
+
+			// stale entry of a reprioritized, cancelled or already taken request
+			if ( request->state != AssetLoadState::Queued )
+				continue;
+
+			request->state = AssetLoadState::Preparing;
+		}
 
-	// Find in caches
-	auto entry = m_assets.find( id );
+		PrepareRequest( request );
+	}
+}
 
-	Asset* found_asset = nullptr;
+void AssetManager::PrepareRequest( const std::shared_ptr<AssetLoadRequest>& request )
+{
+	Json data;
+	Asset* asset = CreateAssetFromFile( request->id, data );
 
-	if ( entry != m_assets.end() )
-		found_asset = entry->second.asset;
+	std::vector<std::string> dependencies;
+	if ( asset != nullptr )
+		asset->GetDependencies( data, dependencies );
 
-	if ( !found_asset )
 	{
-		std::scoped_lock lock2( m_orphan_cs );
+		// dependencies are started before Prepare, so they are loaded in parallel with it
+		std::scoped_lock lock( m_load_cs );
+		if ( request->state == AssetLoadState::Cancelled )
+		{
+			delete asset;
+			return;
+		}
 
-		entry = m_orphans.find( id );
-		if ( entry != m_orphans.end() )
+		if ( asset == nullptr )
 		{
-			std::scoped_lock lock3( m_write_cs );
-			m_assets[id] = entry->second;
-			found_asset = entry->second.asset;
-			m_orphans.erase( entry );
+			FinishRequest( *request, nullptr );
+			return;
 		}
+
+		for ( const std::string& dependency : dependencies )
+			AddDependency( request, AssetId( dependency.c_str() ) );
 	}
 
-	if ( found_asset && found_asset->GetStatus() == AssetStatus::Invalid )
+	const bool prepared = asset->Prepare( data );
+
+	std::scoped_lock lock( m_load_cs );
+	if ( request->state == AssetLoadState::Cancelled || !prepared )
 	{
-		// try reloading? maybe track the number of reload attempts
-		NOTIMPL;
+		delete asset;
+		if ( request->state != AssetLoadState::Cancelled )
+			FinishRequest( *request, nullptr );
+		return;
+	}
+
+	request->asset = asset;
+	if ( request->num_pending_dependencies == 0 )
+	{
+		request->state = AssetLoadState::WaitingForUpload;
+		m_upload_queue.push_back( request );
+		m_load_done_cv.notify_all();
+	}
+	else
+	{
+		request->state = AssetLoadState::WaitingForDependencies;
 	}
-	
-	return found_asset;
 }
 
-void AssetManager::RegisterGenerators()
+AssetPtr AssetManager::WaitForRequest( const AssetLoadRequest& request )
 {
-	// todo: automatic generation?
-
-#ifdef REGISTER_ASSET_GENERATOR
-#error "Macro REGISTER_ASSET_GENERATOR is already defined"
-#endif
-#define REGISTER_ASSET_GENERATOR( className ) m_factories[ S_(className) ] = CreateAsset<className>;
+	const bool is_upload_thread = std::this_thread::get_id() == m_upload_thread;
 
-	REGISTER_ASSET_GENERATOR( CubeAsset );
-	REGISTER_ASSET_GENERATOR( MeshAsset );
-	REGISTER_ASSET_GENERATOR( TextureAsset );
-	REGISTER_ASSET_GENERATOR( MaterialAsset );
-
-#undef REGISTER_ASSET_GENERATOR
+	std::unique_lock lock( m_load_cs );
+	while ( !IsFinished( request.state ) )
+	{
+		if ( is_upload_thread && ( !m_upload_queue.empty() || !m_finishing_uploads.empty() ) )
+		{
+			// nothing to upload, finishing assets wait for the GPU
+			const bool waits_for_gpu = m_upload_queue.empty();
+
+			lock.unlock();
+			ProcessUploads();
+			if ( waits_for_gpu )
+				std::this_thread::yield();
+			lock.lock();
+			continue;
+		}
+		m_load_done_cv.wait( lock );
+	}
+	return request.result;
 }
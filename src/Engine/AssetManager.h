@@ -4,27 +4,35 @@
 
 #include "Serialization.h"
 
-class AssetId
+#include <condition_variable>
+#include <map>
+#include <thread>
+
+struct InternedAssetPath
 {
-	// todo: guid? hash?
-	std::string m_path;
+	uint64_t hash = 0; // 64-bit FNV-1a of the path
+	std::string path;
+};
 
-	friend struct std::hash<AssetId>;
+// Paths are interned: ids of the same path point to one InternedAssetPath, so ids are compared by pointer and never hashed again.
+// Interned paths live as long as the process
+class AssetId
+{
+	const InternedAssetPath* m_path = nullptr;
 
 public:
-	AssetId( const char* path ) :
-		m_path( path )
-	{}
+	AssetId( const char* path );
 
-	const char* GetPath() const { return m_path.c_str(); }
+	const char* GetPath() const { return m_path->path.c_str(); }
+	uint64_t GetHash() const { return m_path->hash; }
 
-	bool operator==( const AssetId& rhs ) const = default;
+	bool operator==( const AssetId& rhs ) const { return m_path == rhs.m_path; }
 };
 
 template<>
 struct std::hash<AssetId>
 {
-	size_t operator()( const AssetId& v ) const { return std::hash<std::string>{}( v.m_path ); }
+	size_t operator()( const AssetId& v ) const { return size_t( v.GetHash() ); }
 };
 
 // Asset state can only transition one way
@@ -43,6 +51,7 @@ enum class AssetStatus
 class Asset
 {
 	friend class AssetManager;
+	friend class AssetRegistry;
 	class AssetManager* m_mgr = nullptr;
 	std::atomic<int> m_refs = 0;
 
@@ -57,7 +66,18 @@ public:
 	void AddRef() { m_refs++; }
 	void Release();
 
-	virtual bool Load( const JsonValue& data ) { m_status = AssetStatus::Invalid; return false; }
+	// Loading runs in stages. GetDependencies lists assets that have to be loaded before Upload.
+	// Prepare does the CPU work like reading and cooking source files. It runs on a loader thread in parallel with the dependencies,
+	// so it must not touch the RHI, the renderer or other assets. Upload creates GPU resources on the upload stage, see AssetManager::ProcessUploads.
+	// FinishUpload is polled on the upload stage after a successful Upload, the asset gets ready once it returns true. It must not block,
+	// assets wait there for the GPU work their Upload started
+	virtual void GetDependencies( const JsonValue& data, std::vector<std::string>& dependencies ) const {}
+	virtual bool Prepare( const JsonValue& data ) { return false; }
+	virtual bool Upload() { return true; }
+	virtual bool FinishUpload() { return true; }
+
+	// CPU and GPU memory owned by the asset once it is loaded, the orphan budget of AssetRegistry is based on it
+	virtual size_t GetMemoryUsage() const { return 0; }
 
 	AssetStatus GetStatus() const { return m_status; }
 
@@ -68,6 +88,10 @@ protected:
 		: m_mgr( &mgr ), m_id( id )
 	{
 	}
+
+	// Dependencies are loaded before Upload, so they are only looked up. nullptr if the dependency failed to load or is part of a cycle
+	template <typename AssetClass>
+	boost::intrusive_ptr<AssetClass> FindDependency( const char* path ) const;
 };
 
 inline void intrusive_ptr_add_ref( Asset* p )
@@ -83,30 +107,169 @@ inline void intrusive_ptr_release( Asset* p )
 
 using AssetPtr = boost::intrusive_ptr<Asset>;
 
-struct AssetManagerEntry
+// Loaded assets by id. The table is split into shards with a lock each, picked by the id hash, so lookups of different assets rarely contend.
+// Assets without references become orphans: they stay registered and lookups revive them, until UnloadOrphans unloads
+// the least recently orphaned ones. Orphaning only pushes a record to a lock-free list, the LRU is kept by the UnloadOrphans caller
+class AssetRegistry
 {
-	Asset* asset = nullptr;
+public:
+	static constexpr uint32_t NumShardsLog2 = 6;
+	static constexpr uint32_t NumShards = 1u << NumShardsLog2;
+
+	AssetRegistry() = default;
+	~AssetRegistry();
+
+	AssetRegistry( const AssetRegistry& ) = delete;
+	AssetRegistry& operator=( const AssetRegistry& ) = delete;
+
+	// nullptr if the asset is not registered
+	AssetPtr Find( const AssetId& id );
+	// the asset must be loaded, its memory usage is not expected to change
+	void Register( Asset* asset );
+	// Called once the last reference is released. Does nothing if the asset was found again meanwhile
+	void Orphan( const AssetId& id );
+
+	// Unloads the least recently orphaned assets until the rest take at most budget bytes, all of them if the budget is 0.
+	// May run concurrently with every method except itself and RemoveAll. Returns the number of unloaded assets
+	uint32_t UnloadOrphans( size_t budget );
+
+	size_t GetOrphanMemoryUsage() const { return m_orphan_memory.load( std::memory_order_relaxed ); }
+	// including orphans
+	uint32_t GetNumAssets();
+
+	// unregisters every asset and returns them, for shutdown
+	std::vector<Asset*> RemoveAll();
+
+private:
+	struct Entry
+	{
+		Asset* asset = nullptr;
+		size_t memory_usage = 0;
+		uint64_t orphan_tick = 0;
+		bool orphaned = false;
+	};
+
+	struct alignas( 64 ) Shard
+	{
+		std::mutex cs;
+		std::unordered_map<AssetId, Entry> entries;
+	};
+
+	struct OrphanRecord
+	{
+		AssetId id;
+		uint64_t tick = 0;
+		OrphanRecord* next = nullptr;
+	};
+
+	// low bits of the hash pick the bucket inside a shard
+	Shard& GetShard( const AssetId& id ) { return m_shards[id.GetHash() >> ( 64 - NumShardsLog2 )]; }
+
+	void CollectOrphanRecords();
+
+	std::array<Shard, NumShards> m_shards;
+
+	std::atomic<uint64_t> m_orphan_clock = 0;
+	std::atomic<size_t> m_orphan_memory = 0;
+	// pushed by Orphan from any thread, taken as a whole by UnloadOrphans
+	std::atomic<OrphanRecord*> m_orphan_records = nullptr;
+
+	// Only touched by UnloadOrphans. Least recently orphaned first, records of revived assets are dropped once they come up
+	std::map<uint64_t, AssetId> m_orphan_lru;
+	std::unordered_map<AssetId, uint64_t> m_orphan_lru_ticks;
+};
+
+enum class AssetLoadPriority : uint8_t
+{
+	Low = 0, // prefetching
+	Normal,
+	High // something waits for the asset, synchronous loads use it
+};
+
+struct AssetLoadRequest;
+
+// Future-like handle of an asynchronous load. Handles of the same asset share one request.
+// Dropping a handle doesn't stop the load, Cancel does once no other handle or dependent asset waits for it
+class AssetLoadHandle
+{
+	friend class AssetManager;
+	class AssetManager* m_mgr = nullptr;
+	std::shared_ptr<AssetLoadRequest> m_request;
+	bool m_cancelled = false;
+
+public:
+	AssetLoadHandle() = default;
+	AssetLoadHandle( AssetLoadHandle&& ) = default;
+	AssetLoadHandle& operator=( AssetLoadHandle&& ) = default;
+	AssetLoadHandle( const AssetLoadHandle& ) = delete;
+	AssetLoadHandle& operator=( const AssetLoadHandle& ) = delete;
+
+	bool IsValid() const { return m_request != nullptr; }
+	// loaded, failed or cancelled
+	bool IsDone() const;
+	// Blocks until the request is done. On the upload thread the upload stage runs meanwhile.
+	// nullptr if loading failed or was cancelled
+	AssetPtr Wait();
+	// nullptr until done
+	AssetPtr GetAsset() const;
+	void Cancel();
 };
 
 class AssetManager
 {
-	std::unordered_map<AssetId, AssetManagerEntry> m_assets;
-	std::unordered_map<AssetId, AssetManagerEntry> m_orphans;
+	friend class AssetLoadHandle;
+
+	AssetRegistry m_registry;
 
 	using AssetFactoryFunctionPtr = Asset * ( * )( const AssetId&, AssetManager& );
 	std::unordered_map<std::string, AssetFactoryFunctionPtr> m_factories;
 
-	std::mutex m_write_cs;
-	std::mutex m_read_cs;
-	std::mutex m_orphan_cs;
+	// Asynchronous loading. Requests stay in m_requests while they are in flight, so requests of the same asset are merged.
+	// Loader threads take requests from m_load_queue, a heap by priority. Prepared requests with loaded dependencies wait in m_upload_queue,
+	// uploaded ones wait in m_finishing_uploads until Asset::FinishUpload succeeds
+	struct QueuedLoad
+	{
+		AssetLoadPriority priority = AssetLoadPriority::Normal;
+		uint64_t sequence = 0;
+		std::shared_ptr<AssetLoadRequest> request;
+	};
+
+	std::mutex m_load_cs; // taken before the registry locks
+	std::condition_variable m_load_queue_cv;
+	std::condition_variable m_load_done_cv; // a request is finished or was added to the upload queue
+	std::unordered_map<AssetId, std::shared_ptr<AssetLoadRequest>> m_requests;
+	std::vector<QueuedLoad> m_load_queue;
+	std::vector<std::shared_ptr<AssetLoadRequest>> m_upload_queue;
+	std::vector<std::shared_ptr<AssetLoadRequest>> m_finishing_uploads;
+	uint64_t m_next_sequence = 0;
+	bool m_stop_loading = false;
+	std::vector<std::thread> m_load_threads;
+	std::thread::id m_upload_thread;
 
 public:
-	AssetManager();
+	// num_load_threads loader threads parse and prepare assets, 0 means one per core. The thread that creates the manager runs the upload stage
+	explicit AssetManager( uint32_t num_load_threads = 0 );
 	~AssetManager();
 
 	// user-facing
+	// Waits for the asset, on the upload thread the upload stage runs meanwhile
 	AssetPtr Load( const AssetId& id );
+	// The asset and its dependencies are loaded on loader threads. Dependencies inherit the priority of the assets waiting for them
+	AssetLoadHandle LoadAsync( const AssetId& id, AssetLoadPriority priority = AssetLoadPriority::Normal );
+	// Upload stage: uploads every prepared asset with loaded dependencies, including the ones that get ready meanwhile, higher priorities first.
+	// Assets with GPU work in flight are finished by later calls. Only for the upload thread, the engine calls it once per frame.
+	// Returns the number of finished uploads
+	uint32_t ProcessUploads();
+	size_t GetNumLoadsInFlight();
+	uint32_t GetNumLoadThreads() const { return uint32_t( m_load_threads.size() ); }
+
+	// Orphans are kept loaded until their memory usage exceeds the budget, see AssetRegistry. Only for one thread at a time,
+	// the engine calls it once per frame
+	uint32_t UnloadOrphans( size_t budget );
 	void UnloadAllOrphans();
+	size_t GetOrphanMemoryUsage() const { return m_registry.GetOrphanMemoryUsage(); }
+	// including orphans
+	uint32_t GetNumLoadedAssets() { return m_registry.GetNumAssets(); }
 
 	AssetPtr FindLoadedAsset( const AssetId& id );
 
@@ -117,13 +280,40 @@ private:
 	template <class AssetClass>
 	static Asset* CreateAsset( const AssetId& id, AssetManager& mgr );
 
-
 	void RegisterGenerators();
+
+	// parses the asset file and creates an asset of its generator class
+	Asset* CreateAssetFromFile( const AssetId& id, Json& data );
+
+	static bool LoadQueueLess( const QueuedLoad& a, const QueuedLoad& b );
+
+	// m_load_cs must be held by every function below
+	std::shared_ptr<AssetLoadRequest> FindOrCreateRequest( const AssetId& id, AssetLoadPriority priority );
+	void RaisePriority( const std::shared_ptr<AssetLoadRequest>& request, AssetLoadPriority priority );
+	void AddDependency( const std::shared_ptr<AssetLoadRequest>& request, const AssetId& dependency_id );
+	bool DependsOn( const AssetLoadRequest& request, const AssetLoadRequest& dependency ) const;
+	void ReleaseInterest( AssetLoadRequest& request );
+	void OnDependencyFinished( const std::shared_ptr<AssetLoadRequest>& request );
+	void FinishRequest( AssetLoadRequest& request, Asset* asset );
+	void CancelRequest( AssetLoadRequest& request );
+	// polls m_finishing_uploads, the lock is released around Asset::FinishUpload
+	uint32_t FinishUploads( std::unique_lock<std::mutex>& lock );
+
+	void LoadThreadLoop();
+	void PrepareRequest( const std::shared_ptr<AssetLoadRequest>& request );
+	AssetPtr WaitForRequest( const AssetLoadRequest& request );
 };
 
 #define IMPLEMENT_ASSET_GENERATOR private: friend class AssetManager
 
 
+template <typename AssetClass>
+boost::intrusive_ptr<AssetClass> Asset::FindDependency( const char* path ) const
+{
+	return boost::dynamic_pointer_cast< AssetClass >( m_mgr->FindLoadedAsset( AssetId( path ) ) );
+}
+
+
 // helper
 
 template < typename AssetClass >
@@ -3,22 +3,25 @@
 
 #include "Assets.h"
 
+#include "MeshCooking.h"
 #include "RHIUtils.h"
 #include "Scene.h"
+#include "TextureCooking.h"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tinyobjloader/tiny_obj_loader.h>
+#include <utils/MemoryMappedFile.h>
+#include <utils/MeshSimplification.h>
+#include <utils/TaskScheduler.h>
 
-#include <stb/stb_image.h>
+#include <filesystem>
 
-// MeshAsset
+CVAR_DEFINE( asset_optimizeMeshes, int, 1, "Reorder triangles and vertices of imported meshes for the GPU vertex cache, overdraw and vertex fetch. Applied when meshes are cooked" );
+CVAR_DEFINE( asset_cookMeshes, int, 1, "Cook .obj meshes into .semesh files next to the source on load. Cooked files are loaded instead of the source while they are newer" );
+CVAR_DEFINE( asset_cookTextures, int, 1, "Cook textures into .setex files next to the source on load. Cooked files are loaded instead of the source while they are newer" );
+CVAR_DEFINE( asset_compressTextures, int, 1, "Block compress cooked textures: BC7 for color, BC4 for data, BC5 for normal maps and BC6H for hdr. Uncompressed textures are RGBA8 or RGB9E5" );
+CVAR_DEFINE( asset_cookThreads, uint32_t, 0, "Threads used to generate mips and encode textures, 0 means one per core. Read on the first cook" );
+CVAR_DEFINE( r_lodMaxPixelError, uint32_t, 1, "Mesh LODs are selected so their simplification error covers at most this many pixels on screen" );
 
-struct MeshVertex
-{
-    glm::vec3 position;
-    glm::vec3 normal;
-    glm::vec2 uv;
-};
+// MeshAsset
 
 RHIPrimitiveAttributeInfo MeshAsset::GetPositionBufferInfo() const
 {
@@ -36,10 +39,59 @@ size_t MeshAsset::GetPositionBufferStride() const
 
 const RHIIndexBufferType MeshAsset::GetIndexBufferType() const
 {
-    return m_indices_num > std::numeric_limits<uint16_t>::max() ? RHIIndexBufferType::UInt32 : RHIIndexBufferType::UInt16;
+    return m_index_type;
+}
+
+uint32_t MeshAsset::SelectLOD( float distance, float projection_scale ) const
+{
+    return ::SelectLOD( m_lod_errors.data(), GetNumLODs(), distance, projection_scale, float( r_lodMaxPixelError.GetValue() ) );
+}
+
+struct MeshAsset::PreparedMesh
+{
+    MemoryMappedFile file;
+    std::vector<uint8_t> blob;
+
+    std::span<const MeshVertex> vertices;
+    const void* indices = nullptr;
+    std::span<const uint8_t> lod_indices;
+};
+
+MeshAsset::MeshAsset( const AssetId& id, AssetManager& mgr )
+    : Asset( id, mgr )
+{
+}
+
+MeshAsset::~MeshAsset()
+{
+    // the renderer goes away before the assets on shutdown
+    if ( m_global_geom.IsValid() && g_engine.renderer != nullptr )
+        GetRenderer().GetGlobalDescriptors().RemoveGeometry( m_global_geom );
+}
+
+size_t MeshAsset::GetMemoryUsage() const
+{
+    size_t memory_usage = sizeof( *this ) + m_cpu_bvh.GetMemoryUsage();
+    for ( const RHIBuffer* buffer : { m_vertex_buffer.get(), m_index_buffer.get(), m_lod_index_buffer.get() } )
+    {
+        if ( buffer )
+            memory_usage += buffer->GetSize();
+    }
+    memory_usage += m_meshlets.size() * sizeof( Meshlet ) + m_meshlet_bounds.size() * sizeof( MeshletBounds )
+        + m_meshlet_vertices.size() * sizeof( uint32_t ) + m_meshlet_triangles.size() * sizeof( uint8_t );
+    return memory_usage;
+}
+
+void MeshAsset::GetDependencies( const JsonValue& data, std::vector<std::string>& dependencies ) const
+{
+    JsonValue::ConstMemberIterator material_it = data.FindMember( "material" );
+    if ( material_it != data.MemberEnd() && material_it->value.IsString() )
+    {
+        dependencies.emplace_back( material_it->value.GetString() );
+    }
 }
 
-bool MeshAsset::Load( const JsonValue& data )
+bool MeshAsset::Prepare( const JsonValue& data )
 {
     JsonValue::ConstMemberIterator source = data.FindMember( "source" );
     if ( source == data.MemberEnd() || !source->value.IsString() )
@@ -48,7 +100,11 @@ bool MeshAsset::Load( const JsonValue& data )
         return false;
     }
 
-    if ( !LoadFromObj( source->value.GetString() ) )
+    const std::string_view source_path = source->value.GetString();
+    const bool prepared = source_path.ends_with( ".semesh" )
+        ? PrepareFromCookedFile( ToOSPath( source->value.GetString() ).c_str() )
+        : PrepareFromObj( source->value.GetString() );
+    if ( !prepared )
     {
         return false;
     }
@@ -62,153 +118,242 @@ bool MeshAsset::Load( const JsonValue& data )
         }
         else
         {
-            m_default_material = LoadAsset<MaterialAsset>( material_it->value.GetString() );
+            m_material_path = material_it->value.GetString();
         }
     }
 
-    if ( m_default_material == nullptr )
+    if ( m_material_path.empty() )
     {
         SE_LOG_WARNING( Engine, "MeshAsset %s does not have a default material set", m_id.GetPath() );
     }
 
-    m_status = AssetStatus::Ready;
     return true;
 }
 
-bool MeshAsset::LoadFromObj( const char* path )
+bool MeshAsset::Upload()
 {
-    // @todo: pre-reserve index array
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
+    if ( !SE_ENSURE( m_prepared ) )
+        return false;
 
-    std::string err;
+    bool created = CreateGPUResources( m_prepared->vertices, m_prepared->indices );
 
-    std::string input_file_path = ToOSPath( path );
+    const std::span<const uint8_t> lod_indices = m_prepared->lod_indices;
+    if ( created && !lod_indices.empty() )
+    {
+        RHI::BufferInfo lod_index_buf_info = {};
+        lod_index_buf_info.size = lod_indices.size();
+        lod_index_buf_info.usage = RHIBufferUsageFlags::IndexBuffer | RHIBufferUsageFlags::StructuredBuffer;
+        GPUUploadManager::Token lod_token = GPUUploadManager::CompletedToken;
+        m_lod_index_buffer = GetUploadManager().CreateInitializedBuffer( lod_index_buf_info, lod_indices.data(), lod_indices.size(), lod_token );
+        m_upload_token = std::max( m_upload_token, lod_token );
+    }
 
-    bool tinyobjloader_retval = tinyobj::LoadObj( &attrib, &shapes, &materials, &err, input_file_path.c_str() );
+    // the mapping is only needed until the data is copied to upload buffers
+    m_prepared.reset();
 
-    if ( !err.empty() )
+    if ( !created )
     {
-        SE_LOG_ERROR( Engine, "[TinyObjLoader]: %s", err.c_str() );
+        return false;
     }
 
-    if ( tinyobjloader_retval == false )
+    if ( !m_material_path.empty() )
     {
-        SE_LOG_ERROR( Engine, "Could not load .obj file at <%s>", input_file_path.c_str() );
-        return false;
+        m_default_material = FindDependency<MaterialAsset>( m_material_path.c_str() );
+        if ( m_default_material == nullptr )
+        {
+            SE_LOG_WARNING( Engine, "MeshAsset %s could not get its default material %s", m_id.GetPath(), m_material_path.c_str() );
+        }
     }
 
-    std::unordered_map<uint64_t, uint32_t> vertex_attribs_to_index;
+    return true;
+}
 
-    std::vector<MeshVertex> vertices;
-    std::vector<uint16_t> indices;
+bool MeshAsset::FinishUpload()
+{
+    GPUUploadManager& upload_mgr = GetUploadManager();
+    upload_mgr.Update();
 
-    // vertices array stores 3 elements per vertex
-    vertices.reserve( attrib.vertices.size() / 3 );
-    if ( attrib.vertices.size() % 3 != 0 )
+    // the BLAS token moves to a later batch when the structure gets compacted
+    const GPUUploadManager::Token token = std::max( m_upload_token, m_pending_blas ? m_pending_blas->token : GPUUploadManager::CompletedToken );
+    if ( !upload_mgr.IsCompleted( token ) )
     {
-        SE_LOG_ERROR( Engine, "Obj file vertex array size not multiple of 3. File: <%s> ", input_file_path.c_str() );
+        // assets of the frame are uploaded by now, the batch does not have to wait for the end of the frame
+        upload_mgr.Submit();
         return false;
     }
 
-    // Loop over shapes
-    for ( size_t s = 0; s < shapes.size(); s++ ) {
-        // Loop over faces(polygon)
-        size_t index_offset = 0;
-        for ( size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++ ) {
-            size_t fv = size_t( shapes[s].mesh.num_face_vertices[f] );
+    if ( m_pending_blas )
+    {
+        m_blas = std::move( m_pending_blas->as );
+        m_pending_blas.reset();
+    }
 
-            if ( fv != 3 )
+    return true;
+}
+
+bool MeshAsset::PrepareFromObj( const char* path )
+{
+    std::string input_file_path = ToOSPath( path );
+    std::string cooked_file_path = input_file_path + ".semesh";
+
+    const bool use_cooked = asset_cookMeshes.GetValue() != 0;
+    if ( use_cooked )
+    {
+        std::error_code source_ec;
+        std::error_code cooked_ec;
+        const auto source_time = std::filesystem::last_write_time( input_file_path, source_ec );
+        const auto cooked_time = std::filesystem::last_write_time( cooked_file_path, cooked_ec );
+        if ( !source_ec && !cooked_ec && cooked_time >= source_time )
+        {
+            if ( PrepareFromCookedFile( cooked_file_path.c_str() ) )
             {
-                NOTIMPL;
+                return true;
             }
+            SE_LOG_WARNING( Engine, "Cooked mesh <%s> is invalid, cooking it again", cooked_file_path.c_str() );
+        }
+    }
 
-            // Loop over vertices in the face.
-            for ( size_t v = 0; v < fv; v++ ) {
-                // access to vertex
-                tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
-
-                if ( idx.vertex_index > std::numeric_limits<uint16_t>::max() )
-                {
-                    NOTIMPL;
-                }
-                if ( idx.normal_index > std::numeric_limits<uint16_t>::max() )
-                {
-                    NOTIMPL;
-                }
-                if ( idx.texcoord_index > std::numeric_limits<uint16_t>::max() )
-                {
-                    NOTIMPL;
-                }
-
-                const uint64_t vertex_hash =
-                    ( idx.vertex_index & 0xffff )
-                    | ( ( uint64_t( idx.normal_index ) << 16 ) & 0xffff0000 )
-                    | ( ( uint64_t( idx.texcoord_index ) << 32 ) & 0xffff00000000 );
-                
-                uint16_t vertex_idx = -1;
-                auto existing_index_it = vertex_attribs_to_index.find( vertex_hash );
-                if ( existing_index_it != vertex_attribs_to_index.end() )
-                {
-                    vertex_idx = existing_index_it->second;
-                }
-                else
-                {
-                    vertex_idx = uint16_t( vertices.size() );
-
-                    MeshVertex new_vertex = {};
-
-                    const int pos_offset = idx.vertex_index * 3;
-                    tinyobj::real_t vx = attrib.vertices[pos_offset + 0];
-                    tinyobj::real_t vy = attrib.vertices[pos_offset + 1];
-                    tinyobj::real_t vz = attrib.vertices[pos_offset + 2];
-
-                    new_vertex.position = glm::vec3( vx, vy, vz );
-                    
-                    const int normal_offset = idx.normal_index * 3;
-                    if ( normal_offset >= 0 )
-                    {
-                        tinyobj::real_t nx = attrib.normals[normal_offset + 0];
-                        tinyobj::real_t ny = attrib.normals[normal_offset + 1];
-                        tinyobj::real_t nz = attrib.normals[normal_offset + 2];
-
-                        new_vertex.normal = glm::vec3( nx, ny, nz );
-                    }
-
-                    const int texcoord_offset = idx.texcoord_index * 2;
-                    if ( texcoord_offset >= 0 )
-                    {
-                        tinyobj::real_t tu = attrib.texcoords[texcoord_offset + 0];
-                        tinyobj::real_t tv = attrib.texcoords[texcoord_offset + 1];
-
-                        new_vertex.uv = glm::vec2( tu, tv );
-                    }
-
-                    vertices.emplace_back( new_vertex );
-                }
-
-                indices.emplace_back( vertex_idx );
-            }
-            index_offset += fv;
+    MeshImportData import_data;
+    if ( !ImportObj( input_file_path.c_str(), import_data ) )
+    {
+        return false;
+    }
+
+    if ( asset_optimizeMeshes.GetValue() != 0 )
+    {
+        OptimizeMesh( import_data );
+    }
+
+    // the source goes through the cooked layout even when it is not saved, so both paths upload the same data
+    m_prepared = std::make_unique<PreparedMesh>();
+    std::vector<uint8_t>& cooked_blob = m_prepared->blob;
+    if ( !CookMesh( import_data, MeshCookSettings{}, cooked_blob ) )
+    {
+        SE_LOG_ERROR( Engine, "Could not cook .obj file at <%s>", input_file_path.c_str() );
+        m_prepared.reset();
+        return false;
+    }
+
+    if ( use_cooked && !WriteCookedMesh( cooked_file_path.c_str(), cooked_blob ) )
+    {
+        SE_LOG_WARNING( Engine, "Mesh <%s> will be cooked again on the next load", input_file_path.c_str() );
+    }
+
+    CookedMeshView cooked;
+    if ( !SE_ENSURE( cooked.Init( cooked_blob ) ) )
+    {
+        m_prepared.reset();
+        return false;
+    }
+
+    return PrepareFromCooked( cooked );
+}
+
+bool MeshAsset::PrepareFromCookedFile( const char* ospath )
+{
+    m_prepared = std::make_unique<PreparedMesh>();
+    MemoryMappedFile& file = m_prepared->file;
+    if ( !file.Open( ospath ) )
+    {
+        SE_LOG_ERROR( Engine, "Could not open cooked mesh at <%s>", ospath );
+        m_prepared.reset();
+        return false;
+    }
+
+    CookedMeshView cooked;
+    if ( !cooked.Init( std::span<const uint8_t>( file.GetData().cbegin(), file.GetData().size() ) ) )
+    {
+        SE_LOG_ERROR( Engine, "File <%s> is not a valid cooked mesh or was cooked by a different engine version", ospath );
+        m_prepared.reset();
+        return false;
+    }
+
+    return PrepareFromCooked( cooked );
+}
+
+bool MeshAsset::PrepareFromCooked( const CookedMeshView& cooked )
+{
+    const CookedMeshHeader& header = cooked.GetHeader();
+    const std::span<const MeshVertex> vertices = cooked.GetVertices();
+    const std::span<const uint8_t> indices = cooked.GetIndexData();
+    m_index_type = header.index_size == sizeof( uint16_t ) ? RHIIndexBufferType::UInt16 : RHIIndexBufferType::UInt32;
+    m_indices_num = header.num_indices;
+
+    // BVH is copied out of the mapping, it outlives the file. Files cooked with an older BVH layout are still usable
+    const std::span<const uint8_t> bvh_data = cooked.GetBVHData();
+    if ( bvh_data.empty() || !m_cpu_bvh.Deserialize( bvh_data.data(), bvh_data.size() ) )
+    {
+        if ( m_index_type == RHIIndexBufferType::UInt16 )
+            m_cpu_bvh.Build( &vertices.data()->position, header.num_vertices, sizeof( MeshVertex ), reinterpret_cast<const uint16_t*>( indices.data() ), header.num_indices );
+        else
+            m_cpu_bvh.Build( &vertices.data()->position, header.num_vertices, sizeof( MeshVertex ), reinterpret_cast<const uint32_t*>( indices.data() ), header.num_indices );
+    }
+
+    // ranges of every submesh in a LOD follow each other, so each LOD is one range of the mesh
+    const std::span<const float> lod_errors = cooked.GetLODErrors();
+    const std::span<const MeshLODRange> lod_ranges = cooked.GetLODRanges();
+    const size_t ranges_per_lod = lod_ranges.size() / lod_errors.size();
+    m_lod_errors.assign( lod_errors.begin(), lod_errors.end() );
+    m_lods.clear();
+    for ( size_t lod = 0; lod < lod_errors.size(); ++lod )
+    {
+        const std::span<const MeshLODRange> ranges = lod_ranges.subspan( lod * ranges_per_lod, ranges_per_lod );
+        MeshLOD& mesh_lod = m_lods.emplace_back();
+        mesh_lod.first_index = lod == 0 ? 0 : ranges.front().first_index;
+        mesh_lod.first_meshlet = ranges.front().first_meshlet;
+        for ( const MeshLODRange& range : ranges )
+        {
+            mesh_lod.num_indices += range.num_indices;
+            mesh_lod.num_meshlets += range.num_meshlets;
         }
+        if ( lod == 0 )
+            mesh_lod.num_indices = header.num_indices;
     }
 
-    return LoadFromData( vertices, indices );
+    m_meshlets.assign( cooked.GetMeshlets().begin(), cooked.GetMeshlets().end() );
+    m_meshlet_bounds.assign( cooked.GetMeshletBounds().begin(), cooked.GetMeshletBounds().end() );
+    m_meshlet_vertices.assign( cooked.GetMeshletVertices().begin(), cooked.GetMeshletVertices().end() );
+    m_meshlet_triangles.assign( cooked.GetMeshletTriangles().begin(), cooked.GetMeshletTriangles().end() );
+
+    m_prepared->vertices = vertices;
+    m_prepared->indices = indices.data();
+    m_prepared->lod_indices = cooked.GetLODIndexData();
+
+    return true;
 }
 
-bool MeshAsset::LoadFromData( const std::span<MeshVertex>& vertices, const std::span<uint16_t>& indices )
+bool MeshAsset::PrepareFromData( const std::span<const MeshVertex>& vertices, const std::span<const uint16_t>& indices )
+{
+    m_cpu_bvh.Build( &vertices.data()->position, uint32_t( vertices.size() ), sizeof( MeshVertex ), indices.data(), uint32_t( indices.size() ) );
+
+    m_index_type = RHIIndexBufferType::UInt16;
+    m_indices_num = uint32_t( indices.size() );
+    m_lods.assign( 1, MeshLOD{ 0, m_indices_num } );
+    m_lod_errors.assign( 1, 0.0f );
+
+    m_prepared = std::make_unique<PreparedMesh>();
+    m_prepared->vertices = vertices;
+    m_prepared->indices = indices.data();
+
+    return true;
+}
+
+bool MeshAsset::CreateGPUResources( const std::span<const MeshVertex>& vertices, const void* indices )
 {
     RHI::BufferInfo vertex_buf_info = {};
     vertex_buf_info.size = sizeof( MeshVertex ) * vertices.size();
     vertex_buf_info.usage = RHIBufferUsageFlags::VertexBuffer | RHIBufferUsageFlags::AccelerationStructureInput | RHIBufferUsageFlags::StructuredBuffer;
-    m_vertex_buffer = RHIUtils::CreateInitializedGPUBuffer( vertex_buf_info, vertices.data(), vertex_buf_info.size );
+    GPUUploadManager& upload_mgr = GetUploadManager();
+    GPUUploadManager::Token vertex_token = GPUUploadManager::CompletedToken;
+    m_vertex_buffer = upload_mgr.CreateInitializedBuffer( vertex_buf_info, vertices.data(), vertex_buf_info.size, vertex_token );
 
     RHI::BufferInfo index_buf_info = {};
-    index_buf_info.size = sizeof( indices[0] ) * indices.size();
+    index_buf_info.size = size_t( m_indices_num ) * ( m_index_type == RHIIndexBufferType::UInt16 ? sizeof( uint16_t ) : sizeof( uint32_t ) );
     index_buf_info.usage = RHIBufferUsageFlags::IndexBuffer | RHIBufferUsageFlags::AccelerationStructureInput | RHIBufferUsageFlags::StructuredBuffer;
-    m_index_buffer = RHIUtils::CreateInitializedGPUBuffer( index_buf_info, indices.data(), index_buf_info.size );
-    m_indices_num = uint32_t( indices.size() );
+    GPUUploadManager::Token index_token = GPUUploadManager::CompletedToken;
+    m_index_buffer = upload_mgr.CreateInitializedBuffer( index_buf_info, indices, index_buf_info.size, index_token );
+
+    m_upload_token = std::max( vertex_token, index_token );
 
     RHIASGeometryInfo blas_geom = {};
     blas_geom.type = RHIASGeometryType::Triangles;
@@ -218,16 +363,17 @@ bool MeshAsset::LoadFromData( const std::span<MeshVertex>& vertices, const std::
     blas_geom.triangles.vtx_format = GetPositionBufferInfo().format;
     blas_geom.triangles.vtx_stride = GetPositionBufferStride();
     blas_geom.triangles.vtx_offset = GetPositionBufferInfo().offset;
-    m_blas = RHIUtils::CreateAS( blas_geom );
+    // built with the uploads of the same batch, the asset gets ready in FinishUpload
+    m_pending_blas = upload_mgr.BuildBLAS( blas_geom );
 
-    m_global_geom_index = GetRenderer().GetGlobalDescriptors().AddGeometry( RHIBufferViewInfo{ m_vertex_buffer.get() }, RHIBufferViewInfo{ m_index_buffer.get() } );
+    m_global_geom = GetRenderer().GetGlobalDescriptors().AddGeometry( RHIBufferViewInfo{ m_vertex_buffer.get() }, RHIBufferViewInfo{ m_index_buffer.get() } );
 
     return true;
 }
 
 // CubeAsset
 
-bool CubeAsset::Load( const JsonValue& data )
+bool CubeAsset::Prepare( const JsonValue& data )
 {
     static std::array<MeshVertex, 8> vertices =
     {
@@ -262,215 +408,284 @@ bool CubeAsset::Load( const JsonValue& data )
         3, 7, 6
     };
 
-    if ( ! LoadFromData( vertices, indices ) )
-    {
-        return false;
-    }
-
-    m_status = AssetStatus::Ready;
-    return true;
+    // static, so it outlives Upload
+    return PrepareFromData( vertices, indices );
 }
 
 // TextureAsset
 
-bool TextureAsset::Load( const JsonValue& data )
+namespace
 {
-    JsonValue::ConstMemberIterator source = data.FindMember( "source" );
-    if ( source == data.MemberEnd() || !source->value.IsString() )
+    // the cooker runs on loader threads, the pool lives as long as the engine
+    ITaskScheduler& GetTextureCookScheduler()
     {
-        SE_LOG_ERROR( Engine, "File %s is not a valid texture asset: \"source\" value is invalid", m_id.GetPath() );
-        return false;
+        static ThreadPoolTaskScheduler scheduler( asset_cookThreads.GetValue() );
+        return scheduler;
     }
 
-    if ( !LoadFromFile( source->value.GetString() ) )
+    template<typename Enum, size_t N>
+    bool ParseEnumString( const char* str, const std::pair<const char*, Enum>( &names )[N], Enum& value )
     {
+        for ( const auto& [name, name_value] : names )
+        {
+            if ( strcmp( str, name ) == 0 )
+            {
+                value = name_value;
+                return true;
+            }
+        }
         return false;
     }
 
-    RHI::TextureROViewInfo view_info = {};
-    view_info.texture = m_rhi_texture.get();
-    m_rhi_view = GetRHI().CreateTextureROView( view_info );
+    constexpr std::pair<const char*, TextureUsage> TextureUsageNames[] =
+    {
+        { "color", TextureUsage::Color },
+        { "data", TextureUsage::Data },
+        { "normal", TextureUsage::NormalMap },
+        { "hdr", TextureUsage::HDR },
+    };
 
-    m_status = AssetStatus::Ready;
-    return true;
+    constexpr std::pair<const char*, TextureEncoding> TextureEncodingNames[] =
+    {
+        { "rgba8", TextureEncoding::RGBA8 },
+        { "bc1", TextureEncoding::BC1 },
+        { "bc4", TextureEncoding::BC4 },
+        { "bc5", TextureEncoding::BC5 },
+        { "bc6h", TextureEncoding::BC6H },
+        { "bc7", TextureEncoding::BC7 },
+        { "rgb9e5", TextureEncoding::RGB9E5 },
+    };
 }
 
-bool TextureAsset::LoadFromFile( const char* path )
+struct TextureAsset::PreparedTexture
 {
-    std::string input_file_path = ToOSPath( path );
+    MemoryMappedFile file;
+    std::vector<uint8_t> blob;
+    CookedTextureView cooked;
+};
+
+TextureAsset::TextureAsset( const AssetId& id, AssetManager& mgr )
+    : Asset( id, mgr )
+{
+}
 
-    // Parse signature
-    uint32_t signature;
+TextureAsset::~TextureAsset() = default;
+
+bool TextureAsset::Prepare( const JsonValue& data )
+{
+    JsonValue::ConstMemberIterator source = data.FindMember( "source" );
+    if ( source == data.MemberEnd() || !source->value.IsString() )
     {
-        std::ifstream file_stream( input_file_path.c_str(), std::ios_base::in | std::ios_base::binary );
-        if ( !file_stream.good() )
-        {
-            SE_LOG_ERROR( Engine, "Could not load texture file at <%s>", input_file_path.c_str() );
-            return false;
-        }
+        SE_LOG_ERROR( Engine, "File %s is not a valid texture asset: \"source\" value is invalid", m_id.GetPath() );
+        return false;
+    }
 
-        file_stream.read( reinterpret_cast<char*>( &signature ), sizeof( signature ) );
+    const std::string_view source_path = source->value.GetString();
 
-        if ( file_stream.eof() || !file_stream.good() )
+    TextureCookSettings settings;
+    settings.compress = asset_compressTextures.GetValue() != 0;
+    settings.usage = source_path.ends_with( ".exr" ) || source_path.ends_with( ".hdr" ) ? TextureUsage::HDR : TextureUsage::Color;
+
+    JsonValue::ConstMemberIterator usage = data.FindMember( "usage" );
+    if ( usage != data.MemberEnd() )
+    {
+        if ( !usage->value.IsString() || !ParseEnumString( usage->value.GetString(), TextureUsageNames, settings.usage ) )
         {
-            SE_LOG_ERROR( Engine, "Could not load file signature at <%s>", input_file_path.c_str() );
+            SE_LOG_ERROR( Engine, "File %s is not a valid texture asset: \"usage\" must be one of color, data, normal or hdr", m_id.GetPath() );
             return false;
         }
     }
 
-    static constexpr uint32_t SIGNATURE_EXR = 0x01312F76;
-    if ( signature == SIGNATURE_EXR )
+    JsonValue::ConstMemberIterator encoding = data.FindMember( "encoding" );
+    if ( encoding != data.MemberEnd() )
     {
-        return LoadEXR( input_file_path.c_str() );
+        TextureEncoding encoding_value = TextureEncoding::RGBA8;
+        if ( !encoding->value.IsString() || !ParseEnumString( encoding->value.GetString(), TextureEncodingNames, encoding_value ) )
+        {
+            SE_LOG_ERROR( Engine, "File %s is not a valid texture asset: \"encoding\" must be one of rgba8, bc1, bc4, bc5, bc6h, bc7 or rgb9e5", m_id.GetPath() );
+            return false;
+        }
+        settings.encoding = encoding_value;
     }
 
-    return LoadWithSTB( input_file_path.c_str() );
+    return source_path.ends_with( ".setex" )
+        ? PrepareFromCookedFile( ToOSPath( source->value.GetString() ).c_str() )
+        : PrepareFromFile( source->value.GetString(), settings );
 }
 
-bool TextureAsset::LoadWithSTB( const char* ospath )
+bool TextureAsset::Upload()
 {
-    bool file_hdr = stbi_is_hdr( ospath );
+    if ( !SE_ENSURE( m_prepared ) )
+        return false;
+
+    const bool created = CreateTexture( m_prepared->cooked );
 
-    if ( file_hdr )
+    // the mapping is only needed until the data is copied to the upload buffer
+    m_prepared.reset();
+
+    if ( !created )
     {
-        // requires separate interface, loads floats
-        NOTIMPL;
+        return false;
     }
 
-    int file_width, file_height, file_channels;
+    RHI::TextureROViewInfo view_info = {};
+    view_info.texture = m_rhi_texture.get();
+    m_rhi_view = GetRHI().CreateTextureROView( view_info );
+
+    return true;
+}
+
+bool TextureAsset::FinishUpload()
+{
+    GPUUploadManager& upload_mgr = GetUploadManager();
+    upload_mgr.Update();
 
-    stbi_uc* file_pixels = stbi_load( ospath, &file_width, &file_height, &file_channels, STBI_rgb_alpha );
-    if ( file_pixels == nullptr )
+    if ( !upload_mgr.IsCompleted( m_upload_token ) )
     {
-        SE_LOG_ERROR( Engine, "Could not load texture file at <%s>", ospath );
+        upload_mgr.Submit();
         return false;
     }
 
-    BOOST_SCOPE_EXIT( file_pixels )
-    {
-        stbi_image_free( file_pixels );
-    } BOOST_SCOPE_EXIT_END
+    return true;
+}
 
-    RHI::TextureInfo tex_info = {};
-    tex_info.dimensions = RHITextureDimensions::T2D;
-    if ( file_channels == 4 || file_channels == 3 )
+bool TextureAsset::PrepareFromFile( const char* path, const TextureCookSettings& settings )
+{
+    std::string input_file_path = ToOSPath( path );
+    std::string cooked_file_path = input_file_path + ".setex";
+
+    const bool use_cooked = asset_cookTextures.GetValue() != 0;
+    if ( use_cooked )
     {
-        tex_info.format = RHIFormat::R8G8B8A8_SRGB;
+        std::error_code source_ec;
+        std::error_code cooked_ec;
+        const auto source_time = std::filesystem::last_write_time( input_file_path, source_ec );
+        const auto cooked_time = std::filesystem::last_write_time( cooked_file_path, cooked_ec );
+        if ( !source_ec && !cooked_ec && cooked_time >= source_time )
+        {
+            if ( PrepareFromCookedFile( cooked_file_path.c_str(), &settings ) )
+            {
+                return true;
+            }
+            SE_LOG_WARNING( Engine, "Cooked texture <%s> is invalid or was cooked with different settings, cooking it again", cooked_file_path.c_str() );
+        }
     }
-    else
+
+    TextureImage image;
+    bool is_hdr = false;
+    if ( !ImportTexture( input_file_path.c_str(), image, is_hdr ) )
     {
-        NOTIMPL;
+        return false;
     }
-    tex_info.allow_multiformat_views = false;
-
-    tex_info.width = uint32_t( file_width );
-    tex_info.height = uint32_t( file_height );
-    tex_info.depth = 1;
 
-    tex_info.mips = 1;
-    tex_info.array_layers = 1;
-
-    tex_info.usage = RHITextureUsageFlags::TextureROView;
-    tex_info.initial_layout = RHITextureLayout::ShaderReadOnly;
-    tex_info.initial_queue = RHI::QueueType::Graphics;
+    if ( is_hdr && settings.usage != TextureUsage::HDR )
+    {
+        SE_LOG_WARNING( Engine, "HDR texture <%s> is not cooked as hdr, values will be clamped", input_file_path.c_str() );
+    }
 
-    size_t file_data_size = file_width * file_height * RHIUtils::GetRHIFormatSize( tex_info.format );
+    // the source goes through the cooked layout even when it is not saved, so both paths upload the same data
+    m_prepared = std::make_unique<PreparedTexture>();
+    std::vector<uint8_t>& cooked_blob = m_prepared->blob;
+    if ( !CookTexture( image, settings, GetTextureCookScheduler(), cooked_blob ) )
+    {
+        SE_LOG_ERROR( Engine, "Could not cook texture file at <%s>", input_file_path.c_str() );
+        m_prepared.reset();
+        return false;
+    }
 
-    m_rhi_texture = RHIUtils::CreateInitializedGPUTexture( tex_info, file_pixels, file_data_size );
+    if ( use_cooked && !WriteCookedTexture( cooked_file_path.c_str(), cooked_blob ) )
+    {
+        SE_LOG_WARNING( Engine, "Texture <%s> will be cooked again on the next load", input_file_path.c_str() );
+    }
 
-    if ( !m_rhi_texture )
+    if ( !SE_ENSURE( m_prepared->cooked.Init( cooked_blob ) ) )
     {
+        m_prepared.reset();
         return false;
     }
 
-    m_status = AssetStatus::Ready;
     return true;
 }
 
-bool TextureAsset::LoadEXR( const char* ospath )
+bool TextureAsset::PrepareFromCookedFile( const char* ospath, const TextureCookSettings* expected_settings )
 {
-    float* out_pixels = nullptr;
-    int width = 0;
-    int height = 0;
-    const char* err = nullptr;
-
-    int ret = ::LoadEXR( &out_pixels, &width, &height, ospath, &err );
-
-    BOOST_SCOPE_EXIT( out_pixels )
+    m_prepared = std::make_unique<PreparedTexture>();
+    MemoryMappedFile& file = m_prepared->file;
+    if ( !file.Open( ospath ) )
     {
-        if ( out_pixels )
-        {
-            free( out_pixels );
-        }
-    } BOOST_SCOPE_EXIT_END
+        SE_LOG_ERROR( Engine, "Could not open cooked texture at <%s>", ospath );
+        m_prepared.reset();
+        return false;
+    }
 
-    if ( ret != TINYEXR_SUCCESS || out_pixels == nullptr )
+    CookedTextureView& cooked = m_prepared->cooked;
+    if ( !cooked.Init( std::span<const uint8_t>( file.GetData().cbegin(), file.GetData().size() ) ) )
     {
-        SE_LOG_ERROR( Engine, "Could not load EXR file at <%s>", ospath );
-        if ( err )
-        {
-            SE_LOG_ERROR( Engine, "[TinyEXR]: %s", err );
-            FreeEXRErrorMessage( err );
-        }
-
+        SE_LOG_ERROR( Engine, "File <%s> is not a valid cooked texture or was cooked by a different engine version", ospath );
+        m_prepared.reset();
         return false;
     }
 
-    // @todo - convert to RGB9E5
-
-    struct HDRPixelValue
+    if ( expected_settings != nullptr && !MatchesCookSettings( cooked.GetHeader(), *expected_settings ) )
     {
-        float r;
-        float g;
-        float b;
-        float a;
-    };
+        m_prepared.reset();
+        return false;
+    }
 
-    std::vector<HDRPixelValue> pixels_converted;
-    pixels_converted.resize( width* height );
+    return true;
+}
+
+bool TextureAsset::CreateTexture( const CookedTextureView& cooked )
+{
+    const CookedTextureHeader& header = cooked.GetHeader();
 
-    for ( int i = 0; i < width * height; ++i )
-    {
-        float* file_pixel = &out_pixels[i * 4];
-        pixels_converted[i].r = file_pixel[0];
-        pixels_converted[i].g = file_pixel[1];
-        pixels_converted[i].b = file_pixel[2];
-        pixels_converted[i].a = file_pixel[3];
-    }
-    
     RHI::TextureInfo tex_info = {};
     tex_info.dimensions = RHITextureDimensions::T2D;
-    tex_info.format = RHIFormat::RGBA32_SFLOAT;
-    
+    tex_info.format = cooked.GetRHIFormat();
     tex_info.allow_multiformat_views = false;
 
-    tex_info.width = uint32_t( width );
-    tex_info.height = uint32_t( height );
+    tex_info.width = header.width;
+    tex_info.height = header.height;
     tex_info.depth = 1;
 
-    tex_info.mips = 1;
+    tex_info.mips = header.num_mips;
     tex_info.array_layers = 1;
 
     tex_info.usage = RHITextureUsageFlags::TextureROView;
     tex_info.initial_layout = RHITextureLayout::ShaderReadOnly;
     tex_info.initial_queue = RHI::QueueType::Graphics;
 
-    size_t file_data_size = pixels_converted.size() * RHIUtils::GetRHIFormatSize( tex_info.format );
-
-    m_rhi_texture = RHIUtils::CreateInitializedGPUTexture( tex_info, pixels_converted.data(), file_data_size);
-
-    if ( !m_rhi_texture )
+    // the data section is uploaded as is, the mip table gives the copy regions
+    bc::small_vector<RHIBufferTextureCopyRegion, 16> regions;
+    for ( uint32_t mip_idx = 0; mip_idx < header.num_mips; ++mip_idx )
     {
-        return false;
+        const CookedTextureMip& mip = cooked.GetMips()[mip_idx];
+        RHIBufferTextureCopyRegion& region = regions.emplace_back();
+        region.buffer_offset = size_t( mip.offset );
+        region.texture_subresource.mip_base = mip_idx;
+        region.texture_subresource.mip_count = 1;
+        region.texture_subresource.array_count = 1;
+        region.texture_extent[0] = mip.width;
+        region.texture_extent[1] = mip.height;
+        region.texture_extent[2] = 1;
     }
 
-    m_status = AssetStatus::Ready;
-    return true;
+    const std::span<const uint8_t> data = cooked.GetData();
+    m_rhi_texture = GetUploadManager().CreateInitializedTexture( tex_info, data.data(), data.size(), regions, m_upload_token );
+    m_texture_size = data.size();
+
+    return m_rhi_texture != nullptr;
 }
 
 // MaterialAsset
 
-bool MaterialAsset::Load( const JsonValue& data )
+MaterialAsset::~MaterialAsset()
+{
+    if ( m_global_material.IsValid() && g_engine.renderer != nullptr )
+        GetRenderer().GetGlobalDescriptors().RemoveMaterial( m_global_material );
+}
+
+bool MaterialAsset::Prepare( const JsonValue& data )
 {
     JsonValue::ConstMemberIterator parms = data.FindMember( "parms" );
     if ( parms == data.MemberEnd() || !parms->value.IsObject() )
@@ -485,8 +700,12 @@ bool MaterialAsset::Load( const JsonValue& data )
 
     bool has_roughness = Serialization::Deserialize( parms->value, "roughness", m_gpu_data.roughness );
 
-    m_global_material_index = GetRenderer().GetGlobalDescriptors().AddMaterial( m_gpu_data );
+    return true;
+}
+
+bool MaterialAsset::Upload()
+{
+    m_global_material = GetRenderer().GetGlobalDescriptors().AddMaterial( m_gpu_data );
 
-    m_status = AssetStatus::Ready;
     return true;
 }
@@ -1,11 +1,17 @@
 #pragma once
 
 #include "AssetManager.h"
+#include "RHIUtils.h"
 
 #include <RHI/RHI.h>
 
+#include <utils/BVH.h>
+#include <utils/Meshlets.h>
 
 struct MeshVertex;
+class CookedMeshView;
+struct TextureCookSettings;
+class CookedTextureView;
 
 struct MaterialGPU
 {
@@ -18,25 +24,36 @@ class MaterialAsset : public Asset
 {
 	IMPLEMENT_ASSET_GENERATOR;
 
-	uint32_t m_global_material_index = -1;
+	BindlessSlotAllocator::Handle m_global_material;
 
 	MaterialGPU m_gpu_data = {};
 
 public:
-	virtual ~MaterialAsset() = default;
+	virtual ~MaterialAsset();
 
 	MaterialAsset( const AssetId& id, AssetManager& mgr )
 		: Asset( id, mgr )
 	{}
 
-	virtual bool Load( const JsonValue& data ) override;
+	virtual bool Prepare( const JsonValue& data ) override;
+	virtual bool Upload() override;
+	virtual size_t GetMemoryUsage() const override { return sizeof( *this ); }
 
-	uint32_t GetGlobalMaterialIndex() const { return m_global_material_index; }
+	uint32_t GetGlobalMaterialIndex() const { return m_global_material.IsValid() ? m_global_material.GetIndex() : uint32_t( -1 ); }
 
 };
 using MaterialAssetPtr = boost::intrusive_ptr<MaterialAsset>;
 
 
+// LOD of the whole mesh, ranges of its submeshes are stored one after another
+struct MeshLOD
+{
+	uint32_t first_index = 0; // into MeshAsset::GetLODIndexBuffer
+	uint32_t num_indices = 0;
+	uint32_t first_meshlet = 0;
+	uint32_t num_meshlets = 0;
+};
+
 class MeshAsset : public Asset
 {
 	IMPLEMENT_ASSET_GENERATOR;
@@ -47,17 +64,45 @@ protected:
 	RHIBufferPtr m_index_buffer = nullptr;
 	RHIAccelerationStructurePtr m_blas = nullptr;
 
+	// for ray queries on CPU (picking, line of sight), GPU buffers are not readable
+	MeshBVH m_cpu_bvh;
+
 	uint32_t m_indices_num = 0;
+	RHIIndexBufferType m_index_type = RHIIndexBufferType::UInt16;
+
+	// LODs after the first one share a buffer with the index type of m_index_buffer
+	RHIBufferPtr m_lod_index_buffer = nullptr;
+	std::vector<MeshLOD> m_lods;
+	std::vector<float> m_lod_errors; // deviation from LOD 0 in mesh units, grows with the LOD
 
-	uint32_t m_global_geom_index = -1;
+	// for cluster culling on CPU
+	std::vector<Meshlet> m_meshlets;
+	std::vector<MeshletBounds> m_meshlet_bounds;
+	std::vector<uint32_t> m_meshlet_vertices;
+	std::vector<uint8_t> m_meshlet_triangles;
 
+	BindlessSlotAllocator::Handle m_global_geom;
+
+	std::string m_material_path;
 	MaterialAssetPtr m_default_material;
 
+	// vertex and index data that waits for Upload, with the file mapping or the blob it points into
+	struct PreparedMesh;
+	std::unique_ptr<PreparedMesh> m_prepared;
+
+	// GPU work started by Upload, m_blas is set once the BLAS is built and compacted
+	GPUUploadManager::Token m_upload_token = GPUUploadManager::CompletedToken;
+	GPUUploadManager::BLASPtr m_pending_blas;
+
 public:
 
-	virtual bool Load( const JsonValue& data ) override;
+	virtual void GetDependencies( const JsonValue& data, std::vector<std::string>& dependencies ) const override;
+	virtual bool Prepare( const JsonValue& data ) override;
+	virtual bool Upload() override;
+	virtual bool FinishUpload() override;
+	virtual size_t GetMemoryUsage() const override;
 
-	virtual ~MeshAsset() = default;
+	virtual ~MeshAsset();
 
 	RHIPrimitiveAttributeInfo GetPositionBufferInfo() const;
 	size_t GetPositionBufferStride() const;
@@ -65,22 +110,45 @@ public:
 	const RHIBuffer* GetVertexBuffer() const { return m_vertex_buffer.get(); }
 	const RHIBuffer* GetIndexBuffer() const { return m_index_buffer.get(); }
 	const RHIAccelerationStructure* GetAccelerationStructure() const { return m_blas.get(); }
+	const MeshBVH& GetCPUBVH() const { return m_cpu_bvh; }
 
 	const RHIIndexBufferType GetIndexBufferType() const;
 	uint32_t GetNumIndices() const { return m_indices_num; }
 
-	uint32_t GetGlobalGeomIndex() const { return m_global_geom_index; }
+	// LOD 0 is the full mesh. BLAS and global geometry always use it
+	uint32_t GetNumLODs() const { return uint32_t( m_lods.size() ); }
+	const MeshLOD& GetLOD( uint32_t lod ) const { return m_lods[lod]; }
+	float GetLODError( uint32_t lod ) const { return m_lod_errors[lod]; }
+	const RHIBuffer* GetLODIndexBuffer( uint32_t lod ) const { return lod == 0 ? m_index_buffer.get() : m_lod_index_buffer.get(); }
+	// distance from the camera to the mesh bounds in mesh units, projection_scale comes from GetLODProjectionScale.
+	// Picks the coarsest LOD with an error below r_lodMaxPixelError pixels
+	uint32_t SelectLOD( float distance, float projection_scale ) const;
+
+	std::span<const Meshlet> GetMeshlets() const { return m_meshlets; }
+	std::span<const MeshletBounds> GetMeshletBounds() const { return m_meshlet_bounds; }
+	std::span<const uint32_t> GetMeshletVertices() const { return m_meshlet_vertices; }
+	std::span<const uint8_t> GetMeshletTriangles() const { return m_meshlet_triangles; }
+
+	uint32_t GetGlobalGeomIndex() const { return m_global_geom.IsValid() ? m_global_geom.GetIndex() : uint32_t( -1 ); }
 
 	const MaterialAsset* GetMaterial() const { return m_default_material.get(); }
 
 protected:
-	MeshAsset( const AssetId& id, AssetManager& mgr )
-		: Asset( id, mgr )
-	{}
+	MeshAsset( const AssetId& id, AssetManager& mgr );
+
+	// Cooks the obj into a .semesh blob next to it, later loads use the cooked file while it is newer than the source
+	bool PrepareFromObj( const char* path );
+	// Vertex and index data is uploaded straight from the file mapping, it stays open until Upload
+	bool PrepareFromCookedFile( const char* ospath );
+	// the view must point into m_prepared
+	bool PrepareFromCooked( const CookedMeshView& cooked );
 
-	bool LoadFromObj( const char* path );
+	// the data must outlive Upload
+	bool PrepareFromData( const std::span<const MeshVertex>& vertices, const std::span<const uint16_t>& indices );
 
-	bool LoadFromData( const std::span<MeshVertex>& vertices, const std::span<uint16_t>& indices );
+private:
+	// index type and count are set by Prepare
+	bool CreateGPUResources( const std::span<const MeshVertex>& vertices, const void* indices );
 };
 using MeshAssetPtr = boost::intrusive_ptr<MeshAsset>;
 
@@ -93,7 +161,7 @@ class CubeAsset : public MeshAsset
 
 public:
 
-	virtual bool Load( const JsonValue& data ) override;
+	virtual bool Prepare( const JsonValue& data ) override;
 
 	virtual ~CubeAsset() = default;
 
@@ -111,23 +179,32 @@ class TextureAsset : public Asset
 
 	RHITexturePtr m_rhi_texture = nullptr;
 	RHITextureROViewPtr m_rhi_view = nullptr;
+	size_t m_texture_size = 0; // of the cooked data
 
-public:
-	virtual ~TextureAsset() = default;
+	// cooked data that waits for Upload, with the file mapping or the blob it points into
+	struct PreparedTexture;
+	std::unique_ptr<PreparedTexture> m_prepared;
 
-	TextureAsset( const AssetId& id, AssetManager& mgr )
-		: Asset( id, mgr )
-	{}
+	GPUUploadManager::Token m_upload_token = GPUUploadManager::CompletedToken;
+
+public:
+	virtual ~TextureAsset();
 
-	virtual bool Load( const JsonValue& data ) override;
+	TextureAsset( const AssetId& id, AssetManager& mgr );
 
-	bool LoadFromFile( const char* path );
+	virtual bool Prepare( const JsonValue& data ) override;
+	virtual bool Upload() override;
+	virtual bool FinishUpload() override;
+	virtual size_t GetMemoryUsage() const override { return sizeof( *this ) + m_texture_size; }
 
 	const RHITexture* GetTexture() const { return m_rhi_texture.get(); }
 	RHITextureROView* GetTextureROView() const { return m_rhi_view.get(); }
 
 private:
-	bool LoadWithSTB( const char* ospath );
-	bool LoadEXR( const char* ospath );
+	// Cooks the source into a .setex file next to it, unless there is a newer one cooked with the same settings
+	bool PrepareFromFile( const char* path, const TextureCookSettings& settings );
+	// expected_settings == nullptr accepts any cooked texture
+	bool PrepareFromCookedFile( const char* ospath, const TextureCookSettings* expected_settings = nullptr );
+	bool CreateTexture( const CookedTextureView& cooked );
 };
 using TextureAssetPtr = boost::intrusive_ptr<TextureAsset>;
@@ -205,10 +205,13 @@ void DisplayMapping::SetupRendergraph( SceneViewFrameData& data, DisplayMappingC
     {
         ctx.dbg_copy_pass = data.rg->AddPass( RHI::QueueType::Graphics, "DisplayMappingCopyDbgTexture" );
         ctx.dbg_copy_pass->UseTextureView( *ctx.input_tex->GetRTView() );
+        // debug texture is not registered in the rendergraph
+        ctx.dbg_copy_pass->SetHasUntrackedAccesses();
     }
 
     ctx.main_pass = data.rg->AddPass( RHI::QueueType::Graphics, "DisplayMapping" );
     ctx.main_pass->UseTextureView( *ctx.input_tex->GetROView() );
+    ctx.main_pass->SetHasUntrackedAccesses(); // view descriptor set
     const int new_output_idx = ( cur_output_idx + 1 ) % 2;
 
     data.scene_output_idx = new_output_idx;
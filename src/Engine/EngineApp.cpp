@@ -4,6 +4,7 @@
 
 #include "AssetManager.h"
 #include "LevelObjects.h"
+#include "RHIUtils.h"
 #include "Rendergraph.h"
 #include "Scene.h"
 
@@ -14,6 +15,11 @@
 
 #include <vulkan/vulkan.h>
 
+CVAR_EXTERN( asset_loadThreads, uint32_t );
+CVAR_EXTERN( asset_orphanBudgetMB, uint32_t );
+CVAR_EXTERN( r_uploadRingSizeMB, uint32_t );
+CVAR_EXTERN( r_uploadBatchSizeMB, uint32_t );
+
 struct SwapChainSupportDetails
 {
     VkSurfaceCapabilitiesKHR capabilities = {};
@@ -54,12 +60,16 @@ void EngineApp::Run( int argc, char** argv )
     InitRHI();
     InitImGUI();
 
-    m_asset_mgr = std::make_unique<AssetManager>();
+    // the main thread runs the upload stage
+    m_asset_mgr = std::make_unique<AssetManager>( asset_loadThreads.GetValue() );
 
     LevelObject::RegisterTraits();
 
     InitEngineGlobals();
 
+    m_upload_mgr = std::make_unique<GPUUploadManager>( size_t( r_uploadRingSizeMB.GetValue() ) * SizeMB, size_t( r_uploadBatchSizeMB.GetValue() ) * SizeMB );
+    g_engine.upload_mgr = m_upload_mgr.get();
+
     m_renderer = std::make_unique<Renderer>();
     g_engine.renderer = m_renderer.get();
 
@@ -255,11 +265,15 @@ void EngineApp::Cleanup()
     m_render_finished_semaphores.clear();
     m_inflight_fences.clear();
 
+    g_engine.renderer = nullptr;
     m_renderer = nullptr;
 
     g_engine.asset_mgr = nullptr;
     m_asset_mgr.reset();
 
+    g_engine.upload_mgr = nullptr;
+    m_upload_mgr.reset();
+
     m_rendergraphs.clear();
 
     g_engine.rhi = nullptr;
@@ -276,6 +290,12 @@ void EngineApp::Cleanup()
 
 void EngineApp::Update()
 {
+    // assets finished since the last frame are uploaded in one batch, it is submitted before the frame that may use them
+    m_asset_mgr->ProcessUploads();
+    m_upload_mgr->Submit();
+    m_upload_mgr->Update();
+    m_asset_mgr->UnloadOrphans( size_t( asset_orphanBudgetMB.GetValue() ) * SizeMB );
+
     m_renderer->DebugUI();
     OnUpdate();
     DrawFrame();
@@ -333,6 +353,7 @@ void EngineApp::DrawFrame()
     fg_submit_info.stages_to_wait = stages_to_wait;
 
     m_inflight_fences[m_current_frame] = framegraph.Submit( fg_submit_info );
+    m_renderer->GetGlobalDescriptors().OnFrameSubmitted( m_inflight_fences[m_current_frame] );
 
     RHI::PresentInfo present_info = {};
     present_info.semaphore_count = 1;
@@ -49,6 +49,7 @@ protected:
 	CommandLineArguments m_cmd_line_args;
 
 	std::unique_ptr<class AssetManager> m_asset_mgr = nullptr;
+	std::unique_ptr<class GPUUploadManager> m_upload_mgr = nullptr;
 	std::unique_ptr<class Renderer> m_renderer = nullptr;
 	std::unique_ptr<class Console> m_console = nullptr;
 
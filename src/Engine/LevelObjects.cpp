@@ -171,6 +171,28 @@ bool LevelObject::Deserialize( const JsonValue& in, bool defer_regeneration )
     return true;
 }
 
+void LevelObject::GetAssetPaths( const JsonValue& in, std::vector<std::string>& paths )
+{
+    // invalid objects are skipped silently, Deserialize reports them
+    auto traits_it = in.FindMember( "traits" );
+    if ( traits_it == in.MemberEnd() || !traits_it->value.IsArray() )
+        return;
+
+    for ( auto&& trait_json_value : traits_it->value.GetArray() )
+    {
+        auto type_it = trait_json_value.FindMember( "_type" );
+        auto value_it = trait_json_value.FindMember( "value" );
+        if ( type_it == trait_json_value.MemberEnd() || !type_it->value.IsString() || value_it == trait_json_value.MemberEnd() )
+            continue;
+
+        auto factory = s_trait_factories.find( type_it->value.GetString() );
+        if ( factory == s_trait_factories.end() )
+            continue;
+
+        factory->second()->GetAssetPaths( value_it->value, paths );
+    }
+}
+
 bool LevelObject::RegenerateEntities()
 {
     DestroyEntities();
@@ -436,6 +458,16 @@ bool MeshInstanceTrait::Deserialize( const JsonValue& in )
     return true;
 }
 
+void MeshInstanceTrait::GetAssetPaths( const JsonValue& in, std::vector<std::string>& paths ) const
+{
+    if ( !in.IsObject() )
+        return;
+
+    auto asset_it = in.FindMember( "asset" );
+    if ( asset_it != in.MemberEnd() && asset_it->value.IsString() )
+        paths.emplace_back( asset_it->value.GetString() );
+}
+
 void MeshInstanceTrait::SetAsset( MeshAssetPtr mesh )
 {
     m_mesh = mesh;
@@ -527,6 +559,16 @@ bool EnvironmentTrait::Deserialize( const JsonValue& in )
     return true;
 }
 
+void EnvironmentTrait::GetAssetPaths( const JsonValue& in, std::vector<std::string>& paths ) const
+{
+    if ( !in.IsObject() )
+        return;
+
+    auto asset_it = in.FindMember( "env_cubemap" );
+    if ( asset_it != in.MemberEnd() && asset_it->value.IsString() )
+        paths.emplace_back( asset_it->value.GetString() );
+}
+
 void EnvironmentTrait::SetEnvCubemap( TextureAssetPtr env_map )
 {
     m_env_cubemap = env_map;
@@ -24,6 +24,9 @@ public:
     virtual bool Serialize( JsonValue& out, JsonAllocator& allocator ) const = 0;
     virtual bool Deserialize( const JsonValue& in ) = 0;
 
+    // Assets Deserialize is going to load, so they can be requested ahead of it
+    virtual void GetAssetPaths( const JsonValue& in, std::vector<std::string>& paths ) const {}
+
     //
     virtual const char* GetTraitPrettyName() const = 0;
     virtual const char* GetTraitClassName() const = 0;
@@ -76,6 +79,9 @@ public:
     bool Serialize( JsonValue& out, JsonAllocator& allocator ) const;
     bool Deserialize( const JsonValue& in, bool defer_regeneration );
 
+    // Paths of the assets used by a serialized object. Loading them asynchronously before Deserialize lets the whole level load in parallel
+    static void GetAssetPaths( const JsonValue& in, std::vector<std::string>& paths );
+
     bool RegenerateEntities();
 
     bool SetPickingId( int32_t picking_id );
@@ -170,6 +176,7 @@ public:
 
     virtual bool Serialize( JsonValue& out, JsonAllocator& allocator ) const override;
     virtual bool Deserialize( const JsonValue& in ) override;
+    virtual void GetAssetPaths( const JsonValue& in, std::vector<std::string>& paths ) const override;
 
     void SetAsset( MeshAssetPtr mesh );
 };
@@ -192,6 +199,7 @@ public:
 
     virtual bool Serialize( JsonValue& out, JsonAllocator& allocator ) const override;
     virtual bool Deserialize( const JsonValue& in ) override;
+    virtual void GetAssetPaths( const JsonValue& in, std::vector<std::string>& paths ) const override;
 
     void SetEnvCubemap( TextureAssetPtr cubemap );
 
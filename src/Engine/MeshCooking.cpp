@@ -0,0 +1,640 @@
+
+#include "StdAfx.h"
+
+#include "MeshCooking.h"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tinyobjloader/tiny_obj_loader.h>
+
+#include <utils/MeshOptimization.h>
+#include <utils/MeshSimplification.h>
+
+#include <filesystem>
+#include <thread>
+
+namespace
+{
+    struct ObjVertexKey
+    {
+        int position;
+        int normal;
+        int texcoord;
+
+        bool operator==( const ObjVertexKey& other ) const = default;
+    };
+
+    struct ObjVertexKeyHash
+    {
+        size_t operator()( const ObjVertexKey& key ) const
+        {
+            uint64_t hash = uint32_t( key.position ) * 0x9E3779B97F4A7C15ull;
+            hash ^= ( uint64_t( uint32_t( key.normal ) ) << 32 | uint32_t( key.texcoord ) ) * 0xC2B2AE3D27D4EB4Full;
+            return size_t( hash ^ ( hash >> 29 ) );
+        }
+    };
+
+    uint64_t AlignSection( uint64_t offset )
+    {
+        return ( offset + CookedMeshHeader::SectionAlignment - 1 ) & ~( CookedMeshHeader::SectionAlignment - 1 );
+    }
+
+    bool IsSectionValid( uint64_t offset, uint64_t size, uint64_t file_size )
+    {
+        return offset % CookedMeshHeader::SectionAlignment == 0 && offset <= file_size && size <= file_size - offset;
+    }
+
+    void WriteIndices( uint8_t* dst, const std::vector<uint32_t>& indices, uint32_t index_size )
+    {
+        if ( index_size == sizeof( uint16_t ) )
+        {
+            uint16_t* dst16 = reinterpret_cast<uint16_t*>( dst );
+            for ( uint32_t index : indices )
+                *dst16++ = uint16_t( index );
+        }
+        else if ( !indices.empty() )
+        {
+            memcpy( dst, indices.data(), indices.size() * sizeof( uint32_t ) );
+        }
+    }
+
+    // normal and uv follow each other in MeshVertex and are simplified as one attribute block
+    constexpr uint32_t LODAttributeCount = 5;
+    constexpr float LODAttributeWeights[LODAttributeCount] = { 1.0f, 1.0f, 1.0f, 0.5f, 0.5f };
+    static_assert( offsetof( MeshVertex, uv ) == offsetof( MeshVertex, normal ) + 3 * sizeof( float ) );
+
+    // Submeshes are simplified separately. Positions used by more than one of them are locked, otherwise their borders would move apart
+    std::vector<uint8_t> GetSubmeshBorderLocks( const MeshImportData& mesh, const std::vector<MeshSubmesh>& submeshes )
+    {
+        std::vector<uint8_t> locks( mesh.vertices.size(), 0 );
+        if ( submeshes.size() < 2 )
+            return locks;
+
+        constexpr uint32_t NoSubmesh = uint32_t( -1 );
+        constexpr uint32_t SharedVertex = uint32_t( -2 );
+        std::vector<uint32_t> owners( mesh.vertices.size(), NoSubmesh );
+        for ( uint32_t submesh_idx = 0; submesh_idx < uint32_t( submeshes.size() ); ++submesh_idx )
+        {
+            const MeshSubmesh& submesh = submeshes[submesh_idx];
+            for ( uint32_t i = submesh.first_index; i < submesh.first_index + submesh.num_indices; ++i )
+            {
+                uint32_t& owner = owners[mesh.indices[i]];
+                owner = owner == NoSubmesh || owner == submesh_idx ? submesh_idx : SharedVertex;
+            }
+        }
+
+        // vertices with equal positions are next to each other in the sorted order
+        auto position_key = [&mesh]( uint32_t vertex )
+        {
+            std::array<uint32_t, 3> key;
+            memcpy( key.data(), &mesh.vertices[vertex].position, sizeof( key ) );
+            return key;
+        };
+        std::vector<uint32_t> order( mesh.vertices.size() );
+        for ( uint32_t vertex = 0; vertex < uint32_t( order.size() ); ++vertex )
+            order[vertex] = vertex;
+        std::sort( order.begin(), order.end(), [&position_key]( uint32_t l, uint32_t r ) { return position_key( l ) < position_key( r ); } );
+
+        for ( size_t begin = 0; begin < order.size(); )
+        {
+            size_t end = begin + 1;
+            bool shared = owners[order[begin]] == SharedVertex;
+            while ( end < order.size() && position_key( order[end] ) == position_key( order[begin] ) )
+            {
+                shared |= owners[order[end]] != owners[order[begin]];
+                end++;
+            }
+            if ( shared )
+                for ( size_t i = begin; i < end; ++i )
+                    locks[order[i]] = 1;
+            begin = end;
+        }
+        return locks;
+    }
+
+    struct CookedLODs
+    {
+        std::vector<float> errors;
+        std::vector<MeshLODRange> ranges;
+        std::vector<uint32_t> indices; // LODs after the first one
+
+        std::vector<Meshlet> meshlets;
+        std::vector<MeshletBounds> meshlet_bounds;
+        std::vector<uint32_t> meshlet_vertices;
+        std::vector<uint8_t> meshlet_triangles;
+    };
+
+    // vertices of one submesh, simplification cost then only depends on its size
+    struct SubmeshLODSource
+    {
+        std::vector<uint32_t> mesh_vertices;
+        std::vector<MeshVertex> vertices;
+        std::vector<uint8_t> locks;
+        std::vector<uint32_t> indices; // of the last LOD, into vertices
+    };
+
+    // Each LOD simplifies the previous one, so the chain costs about as much as simplifying the mesh once
+    void BuildLODs( const MeshImportData& mesh, const std::vector<MeshSubmesh>& submeshes, const MeshCookSettings& settings, CookedLODs& lods )
+    {
+        lods.errors.push_back( 0.0f );
+        for ( const MeshSubmesh& submesh : submeshes )
+            lods.ranges.push_back( MeshLODRange{ submesh.first_index, submesh.num_indices } );
+
+        if ( !settings.build_lods )
+            return;
+
+        const std::vector<uint8_t> locks = GetSubmeshBorderLocks( mesh, submeshes );
+
+        constexpr uint32_t NoLocalVertex = uint32_t( -1 );
+        std::vector<uint32_t> local_vertices( mesh.vertices.size(), NoLocalVertex );
+        std::vector<SubmeshLODSource> sources( submeshes.size() );
+        for ( size_t i = 0; i < submeshes.size(); ++i )
+        {
+            SubmeshLODSource& source = sources[i];
+            for ( uint32_t index = submeshes[i].first_index; index < submeshes[i].first_index + submeshes[i].num_indices; ++index )
+            {
+                const uint32_t vertex = mesh.indices[index];
+                if ( local_vertices[vertex] == NoLocalVertex )
+                {
+                    local_vertices[vertex] = uint32_t( source.mesh_vertices.size() );
+                    source.mesh_vertices.push_back( vertex );
+                    source.vertices.push_back( mesh.vertices[vertex] );
+                    source.locks.push_back( locks[vertex] );
+                }
+                source.indices.push_back( local_vertices[vertex] );
+            }
+            for ( uint32_t vertex : source.mesh_vertices )
+                local_vertices[vertex] = NoLocalVertex;
+        }
+
+        std::vector<std::vector<uint32_t>> simplified( submeshes.size() );
+        for ( uint32_t lod = 1; lod < settings.max_lods; ++lod )
+        {
+            size_t num_indices_before = 0;
+            size_t num_indices_after = 0;
+            float lod_error = 0.0f;
+            for ( size_t i = 0; i < submeshes.size(); ++i )
+            {
+                const SubmeshLODSource& source = sources[i];
+                const size_t target_index_count = size_t( float( source.indices.size() / 3 ) * settings.lod_reduction ) * 3;
+
+                float error = 0.0f;
+                simplified[i].resize( source.indices.size() );
+                simplified[i].resize( SimplifyMesh( simplified[i].data(), source.indices.data(), source.indices.size(),
+                                                    &source.vertices.data()->position.x, uint32_t( source.vertices.size() ), sizeof( MeshVertex ),
+                                                    target_index_count, std::numeric_limits<float>::max(), &error,
+                                                    &source.vertices.data()->normal.x, sizeof( MeshVertex ), LODAttributeWeights, LODAttributeCount,
+                                                    source.locks.data() ) );
+
+                num_indices_before += source.indices.size();
+                num_indices_after += simplified[i].size();
+                lod_error = std::max( lod_error, error );
+            }
+
+            // a LOD which barely shrinks costs memory without saving much
+            if ( num_indices_after * 10 > num_indices_before * 9 || lods.indices.size() + num_indices_after > std::numeric_limits<uint32_t>::max() )
+                break;
+
+            // the error is measured against the previous LOD, the sum bounds the deviation from LOD 0 and keeps errors growing
+            lods.errors.push_back( lods.errors.back() + lod_error );
+            for ( size_t i = 0; i < submeshes.size(); ++i )
+            {
+                SubmeshLODSource& source = sources[i];
+                source.indices.swap( simplified[i] );
+
+                MeshLODRange range;
+                range.first_index = uint32_t( lods.indices.size() );
+                range.num_indices = uint32_t( source.indices.size() );
+                lods.ranges.push_back( range );
+
+                lods.indices.resize( lods.indices.size() + source.indices.size() );
+                uint32_t* lod_indices = lods.indices.data() + range.first_index;
+                if ( !source.indices.empty() )
+                    OptimizeVertexCacheTipsify( lod_indices, source.indices.data(), source.indices.size(), uint32_t( source.vertices.size() ) );
+                for ( uint32_t j = 0; j < range.num_indices; ++j )
+                    lod_indices[j] = source.mesh_vertices[lod_indices[j]];
+            }
+        }
+    }
+
+    void BuildLODMeshlets( const MeshImportData& mesh, size_t num_submeshes, CookedLODs& lods )
+    {
+        const uint32_t num_vertices = uint32_t( mesh.vertices.size() );
+        for ( size_t range_idx = 0; range_idx < lods.ranges.size(); ++range_idx )
+        {
+            MeshLODRange& range = lods.ranges[range_idx];
+            const uint32_t* indices = ( range_idx < num_submeshes ? mesh.indices.data() : lods.indices.data() ) + range.first_index;
+
+            range.first_meshlet = uint32_t( lods.meshlets.size() );
+            BuildMeshlets( lods.meshlets, lods.meshlet_vertices, lods.meshlet_triangles, indices, range.num_indices, num_vertices );
+            range.num_meshlets = uint32_t( lods.meshlets.size() ) - range.first_meshlet;
+
+            for ( uint32_t meshlet_idx = range.first_meshlet; meshlet_idx < uint32_t( lods.meshlets.size() ); ++meshlet_idx )
+                lods.meshlet_bounds.push_back( ComputeMeshletBounds( lods.meshlets[meshlet_idx], lods.meshlet_vertices.data(), lods.meshlet_triangles.data(),
+                                                                     &mesh.vertices.data()->position.x, sizeof( MeshVertex ) ) );
+        }
+    }
+}
+
+bool ImportObj( const char* ospath, MeshImportData& mesh )
+{
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+
+    std::string err;
+
+    bool tinyobjloader_retval = tinyobj::LoadObj( &attrib, &shapes, &materials, &err, ospath );
+
+    if ( !err.empty() )
+    {
+        SE_LOG_ERROR( Engine, "[TinyObjLoader]: %s", err.c_str() );
+    }
+
+    if ( tinyobjloader_retval == false )
+    {
+        SE_LOG_ERROR( Engine, "Could not load .obj file at <%s>", ospath );
+        return false;
+    }
+
+    if ( attrib.vertices.size() % 3 != 0 )
+    {
+        SE_LOG_ERROR( Engine, "Obj file vertex array size not multiple of 3. File: <%s> ", ospath );
+        return false;
+    }
+
+    mesh = {};
+
+    size_t total_indices = 0;
+    for ( const tinyobj::shape_t& shape : shapes )
+        total_indices += shape.mesh.indices.size();
+
+    if ( total_indices > std::numeric_limits<uint32_t>::max() )
+    {
+        SE_LOG_ERROR( Engine, "Obj file has too many indices. File: <%s>", ospath );
+        return false;
+    }
+
+    mesh.indices.reserve( total_indices );
+    mesh.vertices.reserve( attrib.vertices.size() / 3 );
+
+    std::unordered_map<ObjVertexKey, uint32_t, ObjVertexKeyHash> vertex_attribs_to_index;
+    vertex_attribs_to_index.reserve( attrib.vertices.size() / 3 );
+
+    const int num_positions = int( attrib.vertices.size() / 3 );
+    const int num_normals = int( attrib.normals.size() / 3 );
+    const int num_texcoords = int( attrib.texcoords.size() / 2 );
+
+    for ( const tinyobj::shape_t& shape : shapes )
+    {
+        MeshSubmesh submesh;
+        submesh.first_index = uint32_t( mesh.indices.size() );
+
+        // polygons are triangulated by the loader
+        for ( unsigned char num_face_vertices : shape.mesh.num_face_vertices )
+        {
+            if ( num_face_vertices != 3 )
+            {
+                SE_LOG_ERROR( Engine, "Obj file has a face with %u vertices after triangulation. File: <%s>", uint32_t( num_face_vertices ), ospath );
+                return false;
+            }
+        }
+
+        for ( const tinyobj::index_t& idx : shape.mesh.indices )
+        {
+            if ( idx.vertex_index < 0 || idx.vertex_index >= num_positions
+                 || idx.normal_index >= num_normals || idx.texcoord_index >= num_texcoords )
+            {
+                SE_LOG_ERROR( Engine, "Obj file has an out of range face index. File: <%s>", ospath );
+                return false;
+            }
+
+            const ObjVertexKey key = { idx.vertex_index, idx.normal_index, idx.texcoord_index };
+            auto [it, inserted] = vertex_attribs_to_index.try_emplace( key, uint32_t( mesh.vertices.size() ) );
+            if ( inserted )
+            {
+                MeshVertex& new_vertex = mesh.vertices.emplace_back();
+
+                const float* position = &attrib.vertices[size_t( idx.vertex_index ) * 3];
+                new_vertex.position = glm::vec3( position[0], position[1], position[2] );
+
+                if ( idx.normal_index >= 0 )
+                {
+                    const float* normal = &attrib.normals[size_t( idx.normal_index ) * 3];
+                    new_vertex.normal = glm::vec3( normal[0], normal[1], normal[2] );
+                }
+
+                if ( idx.texcoord_index >= 0 )
+                {
+                    const float* texcoord = &attrib.texcoords[size_t( idx.texcoord_index ) * 2];
+                    new_vertex.uv = glm::vec2( texcoord[0], texcoord[1] );
+                }
+            }
+
+            mesh.indices.push_back( it->second );
+        }
+
+        submesh.num_indices = uint32_t( mesh.indices.size() ) - submesh.first_index;
+        if ( submesh.num_indices > 0 )
+            mesh.submeshes.push_back( submesh );
+    }
+
+    return true;
+}
+
+void OptimizeMesh( MeshImportData& mesh, uint32_t cache_size )
+{
+    if ( mesh.indices.empty() )
+        return;
+
+    std::vector<MeshSubmesh> ranges = mesh.submeshes;
+    if ( ranges.empty() )
+        ranges.push_back( MeshSubmesh{ 0, uint32_t( mesh.indices.size() ) } );
+
+    for ( const MeshSubmesh& range : ranges )
+        if ( !SE_ENSURE( size_t( range.first_index ) + range.num_indices <= mesh.indices.size() && range.num_indices % 3 == 0 ) )
+            return;
+    if ( !SE_ENSURE( *std::max_element( mesh.indices.begin(), mesh.indices.end() ) < mesh.vertices.size() ) )
+        return;
+
+    const uint32_t num_vertices = uint32_t( mesh.vertices.size() );
+    std::vector<uint32_t> scratch;
+    std::vector<uint32_t> hard_boundaries;
+    for ( const MeshSubmesh& range : ranges )
+    {
+        uint32_t* range_indices = mesh.indices.data() + range.first_index;
+        scratch.resize( range.num_indices );
+        OptimizeVertexCacheTipsify( scratch.data(), range_indices, range.num_indices, num_vertices, cache_size, &hard_boundaries );
+        OptimizeOverdraw( range_indices, scratch.data(), range.num_indices, &mesh.vertices.data()->position.x, num_vertices, sizeof( MeshVertex ),
+                          hard_boundaries, cache_size );
+    }
+
+    std::vector<uint32_t> remap( num_vertices );
+    const uint32_t num_used_vertices = OptimizeVertexFetchRemap( remap.data(), mesh.indices.data(), mesh.indices.size(), num_vertices );
+    RemapIndices( mesh.indices.data(), mesh.indices.size(), remap.data() );
+
+    std::vector<MeshVertex> remapped_vertices( num_used_vertices );
+    RemapVertices( remapped_vertices.data(), mesh.vertices.data(), num_vertices, sizeof( MeshVertex ), remap.data() );
+    mesh.vertices = std::move( remapped_vertices );
+}
+
+bool CookMesh( const MeshImportData& mesh, const MeshCookSettings& settings, std::vector<uint8_t>& blob )
+{
+    if ( mesh.vertices.empty() || mesh.indices.empty() || mesh.indices.size() % 3 != 0 )
+    {
+        SE_LOG_ERROR( Engine, "Can't cook a mesh without triangles" );
+        return false;
+    }
+
+    for ( const MeshSubmesh& submesh : mesh.submeshes )
+    {
+        if ( submesh.first_index > mesh.indices.size() || submesh.num_indices > mesh.indices.size() - submesh.first_index )
+        {
+            SE_LOG_ERROR( Engine, "Can't cook a mesh: submesh is out of the index buffer range" );
+            return false;
+        }
+    }
+
+    for ( uint32_t index : mesh.indices )
+    {
+        if ( index >= mesh.vertices.size() )
+        {
+            SE_LOG_ERROR( Engine, "Can't cook a mesh: index %u is out of range", index );
+            return false;
+        }
+    }
+
+    CookedMeshHeader header;
+    header.vertex_stride = sizeof( MeshVertex );
+    header.num_vertices = uint32_t( mesh.vertices.size() );
+    // 0xffff is a valid index for triangle lists, strip cut values don't apply
+    header.index_size = mesh.vertices.size() <= size_t( std::numeric_limits<uint16_t>::max() ) + 1 ? sizeof( uint16_t ) : sizeof( uint32_t );
+    header.num_indices = uint32_t( mesh.indices.size() );
+    header.num_submeshes = uint32_t( mesh.submeshes.size() );
+
+    BVHBounds bounds;
+    for ( const MeshVertex& vertex : mesh.vertices )
+        bounds.Extend( &vertex.position.x );
+    std::copy_n( bounds.min, 3, header.bounds_min );
+    std::copy_n( bounds.max, 3, header.bounds_max );
+
+    MeshBVH bvh;
+    if ( settings.build_bvh )
+        bvh.Build( &mesh.vertices.data()->position, header.num_vertices, sizeof( MeshVertex ), mesh.indices.data(), header.num_indices );
+
+    // LOD ranges are per submesh, a mesh without submeshes is one
+    std::vector<MeshSubmesh> lod_submeshes = mesh.submeshes;
+    if ( lod_submeshes.empty() )
+        lod_submeshes.push_back( MeshSubmesh{ 0, header.num_indices } );
+
+    CookedLODs lods;
+    BuildLODs( mesh, lod_submeshes, settings, lods );
+    if ( settings.build_meshlets )
+        BuildLODMeshlets( mesh, lod_submeshes.size(), lods );
+
+    header.num_lods = uint32_t( lods.errors.size() );
+    header.num_lod_indices = uint32_t( lods.indices.size() );
+    header.num_meshlets = uint32_t( lods.meshlets.size() );
+    header.num_meshlet_vertices = uint32_t( lods.meshlet_vertices.size() );
+    header.num_meshlet_triangle_bytes = lods.meshlet_triangles.size();
+
+    header.vertex_offset = AlignSection( sizeof( CookedMeshHeader ) );
+    header.index_offset = AlignSection( header.vertex_offset + uint64_t( header.num_vertices ) * header.vertex_stride );
+    header.submesh_offset = AlignSection( header.index_offset + uint64_t( header.num_indices ) * header.index_size );
+    header.bvh_offset = AlignSection( header.submesh_offset + uint64_t( header.num_submeshes ) * sizeof( MeshSubmesh ) );
+    header.bvh_size = settings.build_bvh ? bvh.GetSerializedSize() : 0;
+    header.lod_error_offset = AlignSection( header.bvh_offset + header.bvh_size );
+    header.lod_range_offset = AlignSection( header.lod_error_offset + uint64_t( header.num_lods ) * sizeof( float ) );
+    header.lod_index_offset = AlignSection( header.lod_range_offset + lods.ranges.size() * sizeof( MeshLODRange ) );
+    header.meshlet_offset = AlignSection( header.lod_index_offset + uint64_t( header.num_lod_indices ) * header.index_size );
+    header.meshlet_bounds_offset = AlignSection( header.meshlet_offset + uint64_t( header.num_meshlets ) * sizeof( Meshlet ) );
+    header.meshlet_vertex_offset = AlignSection( header.meshlet_bounds_offset + uint64_t( header.num_meshlets ) * sizeof( MeshletBounds ) );
+    header.meshlet_triangle_offset = AlignSection( header.meshlet_vertex_offset + uint64_t( header.num_meshlet_vertices ) * sizeof( uint32_t ) );
+    header.file_size = header.meshlet_triangle_offset + header.num_meshlet_triangle_bytes;
+
+    // zeroed padding keeps cooked files deterministic
+    blob.assign( size_t( header.file_size ), 0 );
+    memcpy( blob.data(), &header, sizeof( header ) );
+    memcpy( blob.data() + header.vertex_offset, mesh.vertices.data(), mesh.vertices.size() * sizeof( MeshVertex ) );
+
+    WriteIndices( blob.data() + header.index_offset, mesh.indices, header.index_size );
+
+    if ( !mesh.submeshes.empty() )
+        memcpy( blob.data() + header.submesh_offset, mesh.submeshes.data(), mesh.submeshes.size() * sizeof( MeshSubmesh ) );
+
+    if ( settings.build_bvh )
+        bvh.Serialize( blob.data() + header.bvh_offset );
+
+    memcpy( blob.data() + header.lod_error_offset, lods.errors.data(), lods.errors.size() * sizeof( float ) );
+    memcpy( blob.data() + header.lod_range_offset, lods.ranges.data(), lods.ranges.size() * sizeof( MeshLODRange ) );
+    WriteIndices( blob.data() + header.lod_index_offset, lods.indices, header.index_size );
+
+    if ( header.num_meshlets > 0 )
+    {
+        memcpy( blob.data() + header.meshlet_offset, lods.meshlets.data(), lods.meshlets.size() * sizeof( Meshlet ) );
+        memcpy( blob.data() + header.meshlet_bounds_offset, lods.meshlet_bounds.data(), lods.meshlet_bounds.size() * sizeof( MeshletBounds ) );
+        memcpy( blob.data() + header.meshlet_vertex_offset, lods.meshlet_vertices.data(), lods.meshlet_vertices.size() * sizeof( uint32_t ) );
+        memcpy( blob.data() + header.meshlet_triangle_offset, lods.meshlet_triangles.data(), lods.meshlet_triangles.size() );
+    }
+
+    return true;
+}
+
+bool WriteCookedMesh( const char* ospath, const std::span<const uint8_t>& blob )
+{
+    const std::filesystem::path path = ospath;
+    // loader threads may cook the same source at once, each of them writes its own temporary file
+    std::filesystem::path tmp_path = path;
+    tmp_path += ".tmp" + std::to_string( std::hash<std::thread::id>{}( std::this_thread::get_id() ) );
+
+    {
+        std::ofstream file( tmp_path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc );
+        file.write( reinterpret_cast<const char*>( blob.data() ), std::streamsize( blob.size() ) );
+        if ( !file.good() )
+        {
+            SE_LOG_ERROR( Engine, "Could not write cooked mesh to <%s>", tmp_path.string().c_str() );
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename( tmp_path, path, ec );
+    if ( ec )
+    {
+        SE_LOG_ERROR( Engine, "Could not move cooked mesh to <%s>: %s", ospath, ec.message().c_str() );
+        std::filesystem::remove( tmp_path, ec );
+        return false;
+    }
+
+    return true;
+}
+
+bool CookedMeshView::Init( const std::span<const uint8_t>& blob )
+{
+    m_header = nullptr;
+    m_blob = {};
+
+    if ( blob.size() < sizeof( CookedMeshHeader ) || reinterpret_cast<uintptr_t>( blob.data() ) % alignof( CookedMeshHeader ) != 0 )
+        return false;
+
+    const CookedMeshHeader* header = reinterpret_cast<const CookedMeshHeader*>( blob.data() );
+    if ( header->magic != CookedMeshHeader::Magic || header->version != CookedMeshHeader::CurrentVersion )
+        return false;
+
+    const uint64_t file_size = header->file_size;
+    const bool valid = file_size == blob.size()
+        && header->vertex_stride == sizeof( MeshVertex )
+        && ( header->index_size == sizeof( uint16_t ) || header->index_size == sizeof( uint32_t ) )
+        && header->num_indices % 3 == 0
+        && IsSectionValid( header->vertex_offset, uint64_t( header->num_vertices ) * header->vertex_stride, file_size )
+        && IsSectionValid( header->index_offset, uint64_t( header->num_indices ) * header->index_size, file_size )
+        && IsSectionValid( header->submesh_offset, uint64_t( header->num_submeshes ) * sizeof( MeshSubmesh ), file_size )
+        && IsSectionValid( header->bvh_offset, header->bvh_size, file_size )
+        && header->num_lods > 0
+        && header->num_lod_indices % 3 == 0
+        && IsSectionValid( header->lod_error_offset, uint64_t( header->num_lods ) * sizeof( float ), file_size )
+        && IsSectionValid( header->lod_range_offset, uint64_t( header->num_lods ) * std::max( header->num_submeshes, 1u ) * sizeof( MeshLODRange ), file_size )
+        && IsSectionValid( header->lod_index_offset, uint64_t( header->num_lod_indices ) * header->index_size, file_size )
+        && IsSectionValid( header->meshlet_offset, uint64_t( header->num_meshlets ) * sizeof( Meshlet ), file_size )
+        && IsSectionValid( header->meshlet_bounds_offset, uint64_t( header->num_meshlets ) * sizeof( MeshletBounds ), file_size )
+        && IsSectionValid( header->meshlet_vertex_offset, uint64_t( header->num_meshlet_vertices ) * sizeof( uint32_t ), file_size )
+        && IsSectionValid( header->meshlet_triangle_offset, header->num_meshlet_triangle_bytes, file_size );
+    if ( !valid )
+        return false;
+
+    m_header = header;
+    m_blob = blob;
+
+    bool ranges_valid = true;
+    for ( const MeshSubmesh& submesh : GetSubmeshes() )
+        ranges_valid &= submesh.first_index <= header->num_indices && submesh.num_indices <= header->num_indices - submesh.first_index;
+
+    const std::span<const MeshLODRange> lod_ranges = GetLODRanges();
+    const size_t ranges_per_lod = lod_ranges.size() / header->num_lods;
+    for ( size_t i = 0; i < lod_ranges.size(); ++i )
+    {
+        const MeshLODRange& range = lod_ranges[i];
+        const uint32_t num_indices = i < ranges_per_lod ? header->num_indices : header->num_lod_indices;
+        ranges_valid &= range.first_index <= num_indices && range.num_indices <= num_indices - range.first_index
+            && range.first_meshlet <= header->num_meshlets && range.num_meshlets <= header->num_meshlets - range.first_meshlet;
+    }
+
+    for ( const Meshlet& meshlet : GetMeshlets() )
+    {
+        ranges_valid &= meshlet.vertex_offset <= header->num_meshlet_vertices && meshlet.num_vertices <= header->num_meshlet_vertices - meshlet.vertex_offset
+            && meshlet.num_vertices <= MaxMeshletVertices
+            && meshlet.triangle_offset <= header->num_meshlet_triangle_bytes && uint64_t( meshlet.num_triangles ) * 3 <= header->num_meshlet_triangle_bytes - meshlet.triangle_offset;
+    }
+
+    if ( !ranges_valid )
+    {
+        m_header = nullptr;
+        m_blob = {};
+        return false;
+    }
+
+    return true;
+}
+
+std::span<const MeshVertex> CookedMeshView::GetVertices() const
+{
+    return std::span<const MeshVertex>( reinterpret_cast<const MeshVertex*>( m_blob.data() + m_header->vertex_offset ), m_header->num_vertices );
+}
+
+std::span<const uint8_t> CookedMeshView::GetIndexData() const
+{
+    return m_blob.subspan( size_t( m_header->index_offset ), size_t( m_header->num_indices ) * m_header->index_size );
+}
+
+std::span<const MeshSubmesh> CookedMeshView::GetSubmeshes() const
+{
+    return std::span<const MeshSubmesh>( reinterpret_cast<const MeshSubmesh*>( m_blob.data() + m_header->submesh_offset ), m_header->num_submeshes );
+}
+
+std::span<const uint8_t> CookedMeshView::GetBVHData() const
+{
+    return m_blob.subspan( size_t( m_header->bvh_offset ), size_t( m_header->bvh_size ) );
+}
+
+std::span<const float> CookedMeshView::GetLODErrors() const
+{
+    return std::span<const float>( reinterpret_cast<const float*>( m_blob.data() + m_header->lod_error_offset ), m_header->num_lods );
+}
+
+std::span<const MeshLODRange> CookedMeshView::GetLODRanges() const
+{
+    const size_t num_ranges = size_t( m_header->num_lods ) * std::max( m_header->num_submeshes, 1u );
+    return std::span<const MeshLODRange>( reinterpret_cast<const MeshLODRange*>( m_blob.data() + m_header->lod_range_offset ), num_ranges );
+}
+
+std::span<const uint8_t> CookedMeshView::GetLODIndexData() const
+{
+    return m_blob.subspan( size_t( m_header->lod_index_offset ), size_t( m_header->num_lod_indices ) * m_header->index_size );
+}
+
+std::span<const Meshlet> CookedMeshView::GetMeshlets() const
+{
+    return std::span<const Meshlet>( reinterpret_cast<const Meshlet*>( m_blob.data() + m_header->meshlet_offset ), m_header->num_meshlets );
+}
+
+std::span<const MeshletBounds> CookedMeshView::GetMeshletBounds() const
+{
+    return std::span<const MeshletBounds>( reinterpret_cast<const MeshletBounds*>( m_blob.data() + m_header->meshlet_bounds_offset ), m_header->num_meshlets );
+}
+
+std::span<const uint32_t> CookedMeshView::GetMeshletVertices() const
+{
+    return std::span<const uint32_t>( reinterpret_cast<const uint32_t*>( m_blob.data() + m_header->meshlet_vertex_offset ), m_header->num_meshlet_vertices );
+}
+
+std::span<const uint8_t> CookedMeshView::GetMeshletTriangles() const
+{
+    return m_blob.subspan( size_t( m_header->meshlet_triangle_offset ), size_t( m_header->num_meshlet_triangle_bytes ) );
+}
+
+BVHBounds CookedMeshView::GetBounds() const
+{
+    BVHBounds bounds;
+    std::copy_n( m_header->bounds_min, 3, bounds.min );
+    std::copy_n( m_header->bounds_max, 3, bounds.max );
+    return bounds;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "StdAfx.h"
+
+#include <utils/BVH.h>
+#include <utils/Meshlets.h>
+
+// Offline part of mesh loading: source formats are imported once and cooked into .semesh blobs,
+// which are loaded at runtime straight from a memory mapping.
+
+struct MeshVertex
+{
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 uv;
+};
+
+// range of the index buffer, one per shape of the source file
+struct MeshSubmesh
+{
+    uint32_t first_index = 0;
+    uint32_t num_indices = 0;
+};
+
+struct MeshImportData
+{
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices; // triangle list
+    std::vector<MeshSubmesh> submeshes;
+};
+
+// Triangulates polygons and merges vertices with the same position, normal and uv indices. No limit on the vertex count
+bool ImportObj( const char* ospath, MeshImportData& mesh );
+
+// Reorders triangles of every submesh for the post-transform cache and overdraw, then vertices for fetch locality.
+// Unreferenced vertices are dropped. Submesh ranges and triangle windings are kept
+void OptimizeMesh( MeshImportData& mesh, uint32_t cache_size = 16 );
+
+struct MeshCookSettings
+{
+    bool build_bvh = true;
+    // LOD chain by edge collapse, each LOD has about lod_reduction of the triangles of the previous one.
+    // The chain stops early once simplification gets stuck, e.g. on meshes made of locked borders
+    bool build_lods = true;
+    uint32_t max_lods = 6;
+    float lod_reduction = 0.5f;
+    // meshlets for every LOD of every submesh, see Meshlets.h
+    bool build_meshlets = true;
+};
+
+// indices of one submesh in one LOD and its meshlets
+struct MeshLODRange
+{
+    uint32_t first_index = 0;
+    uint32_t num_indices = 0;
+    uint32_t first_meshlet = 0;
+    uint32_t num_meshlets = 0;
+};
+
+// .semesh layout: header, then vertex, index, submesh, BVH, LOD and meshlet sections, each starting at a multiple of SectionAlignment.
+// Indices are 16 bit when every vertex can be addressed with them. All values are little endian
+struct CookedMeshHeader
+{
+    static constexpr uint32_t Magic = 0x48534D45; // "EMSH"
+    static constexpr uint32_t CurrentVersion = 3; // 2: meshes are optimized before cooking, 3: LODs and meshlets
+    static constexpr uint64_t SectionAlignment = 64;
+
+    uint32_t magic = Magic;
+    uint32_t version = CurrentVersion;
+    uint64_t file_size = 0;
+
+    uint32_t vertex_stride = 0;
+    uint32_t num_vertices = 0;
+    uint64_t vertex_offset = 0;
+
+    uint32_t index_size = 0; // 2 or 4 bytes
+    uint32_t num_indices = 0;
+    uint64_t index_offset = 0;
+
+    uint32_t num_submeshes = 0;
+    uint32_t reserved = 0;
+    uint64_t submesh_offset = 0;
+
+    // MeshBVH::Serialize output, bvh_size is 0 when the BVH was not cooked
+    uint64_t bvh_offset = 0;
+    uint64_t bvh_size = 0;
+
+    // LOD 0 is the mesh itself, num_lods is at least 1. Every LOD has a MeshLODRange per submesh, or one when there are no submeshes,
+    // stored LOD major. LOD 0 ranges address the index section, others the LOD index section, which has the same index_size
+    uint32_t num_lods = 0;
+    uint32_t num_lod_indices = 0;
+    uint64_t lod_error_offset = 0; // float per LOD, the deviation from LOD 0 in mesh units
+    uint64_t lod_range_offset = 0;
+    uint64_t lod_index_offset = 0;
+
+    // Meshlet, MeshletBounds, uint32 vertex index and uint8 local index arrays, num_meshlets is 0 when meshlets were not cooked
+    uint32_t num_meshlets = 0;
+    uint32_t num_meshlet_vertices = 0;
+    uint64_t num_meshlet_triangle_bytes = 0;
+    uint64_t meshlet_offset = 0;
+    uint64_t meshlet_bounds_offset = 0;
+    uint64_t meshlet_vertex_offset = 0;
+    uint64_t meshlet_triangle_offset = 0;
+
+    float bounds_min[3] = {};
+    float bounds_max[3] = {};
+};
+static_assert( sizeof( CookedMeshHeader ) % 8 == 0 );
+
+bool CookMesh( const MeshImportData& mesh, const MeshCookSettings& settings, std::vector<uint8_t>& blob );
+
+// Writes to a temporary file first, so a concurrent reader never sees a partially written blob
+bool WriteCookedMesh( const char* ospath, const std::span<const uint8_t>& blob );
+
+// Read-only view into a cooked blob, usually a memory mapped file. Only the header and section ranges are validated,
+// index values are trusted. The blob must outlive the view and be 8 byte aligned, mappings and heap allocations are
+class CookedMeshView
+{
+public:
+    bool Init( const std::span<const uint8_t>& blob );
+
+    const CookedMeshHeader& GetHeader() const { return *m_header; }
+
+    std::span<const MeshVertex> GetVertices() const;
+    // raw index buffer, GetHeader().index_size bytes per index
+    std::span<const uint8_t> GetIndexData() const;
+    std::span<const MeshSubmesh> GetSubmeshes() const;
+    std::span<const uint8_t> GetBVHData() const;
+    BVHBounds GetBounds() const;
+
+    std::span<const float> GetLODErrors() const;
+    std::span<const MeshLODRange> GetLODRanges() const;
+    std::span<const uint8_t> GetLODIndexData() const;
+
+    std::span<const Meshlet> GetMeshlets() const;
+    std::span<const MeshletBounds> GetMeshletBounds() const;
+    std::span<const uint32_t> GetMeshletVertices() const;
+    std::span<const uint8_t> GetMeshletTriangles() const;
+
+private:
+    const CookedMeshHeader* m_header = nullptr;
+    std::span<const uint8_t> m_blob;
+};
@@ -2,6 +2,14 @@
 
 #include "RHIUtils.h"
 
+CVAR_DEFINE( r_tlasRefit, int, 1, "Refit TLAS instead of rebuilding it when only a few instances moved" );
+CVAR_DEFINE( r_tlasRefitMaxMovedPercent, uint32_t, 10, "TLAS is rebuilt when more than this percent of instances moved since the previous build" );
+CVAR_DEFINE( r_tlasRefitMaxQualityLossPercent, uint32_t, 50, "TLAS is rebuilt once the moved instance percents summed over consecutive refits exceed this" );
+CVAR_DEFINE( r_tlasUploadMergeGap, uint32_t, 16, "Dirty TLAS instance ranges separated by at most this many clean instances are uploaded with one write" );
+CVAR_DEFINE( r_uploadRingSizeMB, uint32_t, 64, "Size of the staging ring GPUUploadManager copies resource data through. Applied on startup" );
+CVAR_DEFINE( r_uploadBatchSizeMB, uint32_t, 16, "GPUUploadManager submits its batch once this much data is staged, otherwise once per frame. Applied on startup" );
+CVAR_DEFINE( r_blasCompaction, int, 1, "BLAS built by GPUUploadManager are copied into compacted structures once their builds complete" );
+
 RHIBufferPtr RHIUtils::CreateInitializedGPUBuffer( RHI::BufferInfo& buffer_info, const void* src_data, size_t src_size )
 {
     buffer_info.usage |= RHIBufferUsageFlags::TransferDst;
@@ -28,6 +36,35 @@ RHIBufferPtr RHIUtils::CreateInitializedGPUBuffer( RHI::BufferInfo& buffer_info,
 }
 
 RHITexturePtr RHIUtils::CreateInitializedGPUTexture( RHI::TextureInfo& texture_info, const void* src_data, size_t src_size )
+{
+    // copies can't span several mips
+    std::vector<RHIBufferTextureCopyRegion> regions;
+    size_t offset = 0;
+    for ( uint32_t layer = 0; layer < std::max( texture_info.array_layers, 1u ); ++layer )
+    {
+        for ( uint32_t mip = 0; mip < std::max( texture_info.mips, 1u ); ++mip )
+        {
+            RHIBufferTextureCopyRegion& region = regions.emplace_back();
+            region.buffer_offset = offset;
+            region.texture_subresource.mip_base = mip;
+            region.texture_subresource.mip_count = 1;
+            region.texture_subresource.array_base = layer;
+            region.texture_subresource.array_count = 1;
+            region.texture_extent[0] = std::max( texture_info.width >> mip, 1u );
+            region.texture_extent[1] = std::max( texture_info.height >> mip, 1u );
+            region.texture_extent[2] = std::max( texture_info.depth >> mip, 1u );
+            offset += GetRHITextureMipSize( texture_info.format, texture_info.width, texture_info.height, texture_info.depth, mip );
+        }
+    }
+
+    if ( !SE_ENSURE( offset <= src_size ) )
+        return nullptr;
+
+    return CreateInitializedGPUTexture( texture_info, src_data, src_size, regions );
+}
+
+RHITexturePtr RHIUtils::CreateInitializedGPUTexture( RHI::TextureInfo& texture_info, const void* src_data, size_t src_size,
+                                                     const std::span<const RHIBufferTextureCopyRegion>& regions )
 {
     RHITextureLayout desired_initial_layout = texture_info.initial_layout;
     texture_info.initial_layout = RHITextureLayout::TransferDst;
@@ -44,13 +81,7 @@ RHITexturePtr RHIUtils::CreateInitializedGPUTexture( RHI::TextureInfo& texture_i
 
     RHICommandList* list = BeginSingleTimeCommands( RHI::QueueType::Graphics );
 
-    RHIBufferTextureCopyRegion copy_region = {};
-    copy_region.texture_subresource.mip_count = texture_info.mips;
-    copy_region.texture_subresource.array_count = texture_info.array_layers;
-    copy_region.texture_extent[0] = texture_info.width;
-    copy_region.texture_extent[1] = texture_info.height;
-    copy_region.texture_extent[2] = texture_info.depth;
-    list->CopyBufferToTexture( *upload_buffer->GetBuffer(), *gpu_texture, &copy_region, 1 );
+    list->CopyBufferToTexture( *upload_buffer->GetBuffer(), *gpu_texture, regions.data(), regions.size() );
 
     if ( texture_info.initial_layout != desired_initial_layout )
     {
@@ -86,7 +117,7 @@ RHIAccelerationStructurePtr RHIUtils::CreateAS( const RHIASGeometryInfo& geom )
     }
 
     RHIASBuildSizes build_sizes = {};
-    if ( !GetRHI().GetASBuildSize( type, &geom, 1, build_sizes ) )
+    if ( !GetRHI().GetASBuildSize( type, &geom, 1, RHIASBuildFlags::None, build_sizes ) )
         return nullptr;
 
     RHI::ASInfo as_create_info = {};
@@ -170,9 +201,29 @@ uint8_t RHIUtils::GetRHIFormatSize( RHIFormat format )
     case RHIFormat::R8G8B8A8_UNORM:
         return 4;
         break;
+    case RHIFormat::RGB9E5:
+        return 4;
+        break;
     case RHIFormat::RGBA32_SFLOAT:
         return 16;
         break;
+    case RHIFormat::R16_UINT:
+        return 2;
+        break;
+    case RHIFormat::RGB8_SRGB:
+        return 3;
+        break;
+    case RHIFormat::BC1_UNORM:
+    case RHIFormat::BC1_SRGB:
+    case RHIFormat::BC4_UNORM:
+        return 8;
+        break;
+    case RHIFormat::BC5_UNORM:
+    case RHIFormat::BC6H_UFLOAT:
+    case RHIFormat::BC7_UNORM:
+    case RHIFormat::BC7_SRGB:
+        return 16;
+        break;
     default:
         NOTIMPL;
         break;
@@ -180,11 +231,578 @@ uint8_t RHIUtils::GetRHIFormatSize( RHIFormat format )
     return 0;
 }
 
+bool RHIUtils::IsRHIFormatBlockCompressed( RHIFormat format )
+{
+    switch ( format )
+    {
+    case RHIFormat::BC1_UNORM:
+    case RHIFormat::BC1_SRGB:
+    case RHIFormat::BC4_UNORM:
+    case RHIFormat::BC5_UNORM:
+    case RHIFormat::BC6H_UFLOAT:
+    case RHIFormat::BC7_UNORM:
+    case RHIFormat::BC7_SRGB:
+        return true;
+    default:
+        return false;
+    }
+}
+
+size_t RHIUtils::GetRHITextureMipSize( RHIFormat format, uint32_t width, uint32_t height, uint32_t depth, uint32_t mip )
+{
+    const uint32_t block_dim = IsRHIFormatBlockCompressed( format ) ? 4 : 1;
+    const size_t blocks_x = ( std::max( width >> mip, 1u ) + block_dim - 1 ) / block_dim;
+    const size_t blocks_y = ( std::max( height >> mip, 1u ) + block_dim - 1 ) / block_dim;
+    return blocks_x * blocks_y * std::max( depth >> mip, 1u ) * GetRHIFormatSize( format );
+}
+
+// GPUUploadManager
+
+namespace
+{
+    constexpr size_t BufferStagingAlignment = 16;
+    // D3D12 placement alignment, covers texel block sizes for Vulkan
+    constexpr size_t TextureStagingAlignment = 512;
+}
+
+GPUUploadManager::GPUUploadManager( size_t ring_size, size_t batch_size )
+    : m_ring_size( CalcAlignedSize( std::max<size_t>( ring_size, TextureStagingAlignment ), TextureStagingAlignment ) ), m_batch_size( batch_size )
+{
+    RHI::BufferInfo ring_info = {};
+    ring_info.size = m_ring_size;
+    ring_info.usage = RHIBufferUsageFlags::TransferSrc;
+    m_ring = GetRHI().CreateUploadBuffer( ring_info );
+    VERIFY_NOT_EQUAL( m_ring, nullptr );
+}
+
+GPUUploadManager::~GPUUploadManager()
+{
+    WaitAll();
+}
+
+RHIBufferPtr GPUUploadManager::CreateInitializedBuffer( RHI::BufferInfo& buffer_info, const void* src_data, size_t src_size, Token& token )
+{
+    buffer_info.usage |= RHIBufferUsageFlags::TransferDst;
+
+    RHIBufferPtr gpu_buffer = GetRHI().CreateDeviceBuffer( buffer_info );
+    if ( !gpu_buffer )
+        return nullptr;
+
+    token = UploadBuffer( *gpu_buffer, 0, src_data, std::min( src_size, buffer_info.size ) );
+
+    return gpu_buffer;
+}
+
+RHITexturePtr GPUUploadManager::CreateInitializedTexture( RHI::TextureInfo& texture_info, const void* src_data, size_t src_size,
+                                                          const std::span<const RHIBufferTextureCopyRegion>& regions, Token& token )
+{
+    RHITextureLayout desired_initial_layout = texture_info.initial_layout;
+    texture_info.initial_layout = RHITextureLayout::TransferDst;
+    texture_info.usage |= RHITextureUsageFlags::TransferDst;
+
+    RHITexturePtr gpu_texture = GetRHI().CreateTexture( texture_info );
+
+    texture_info.initial_layout = desired_initial_layout;
+
+    if ( !gpu_texture )
+        return nullptr;
+
+    RHIBuffer* staging_buffer = nullptr;
+    const size_t staging_offset = Stage( src_data, src_size, TextureStagingAlignment, staging_buffer );
+
+    bc::small_vector<RHIBufferTextureCopyRegion, 16> staged_regions( regions.begin(), regions.end() );
+    for ( RHIBufferTextureCopyRegion& region : staged_regions )
+        region.buffer_offset += staging_offset;
+
+    Batch& batch = GetPendingBatch();
+    batch.list->CopyBufferToTexture( *staging_buffer, *gpu_texture, staged_regions.data(), staged_regions.size() );
+
+    if ( desired_initial_layout != RHITextureLayout::TransferDst )
+    {
+        RHITextureBarrier barrier;
+        barrier.layout_src = RHITextureLayout::TransferDst;
+        barrier.layout_dst = desired_initial_layout;
+        barrier.texture = gpu_texture.get();
+        batch.list->TextureBarriers( &barrier, 1 );
+    }
+
+    batch.resources.emplace_back( gpu_texture );
+    token = batch.token;
+
+    SubmitIfFull();
+
+    return gpu_texture;
+}
+
+GPUUploadManager::Token GPUUploadManager::UploadBuffer( RHIBuffer& dst, size_t dst_offset, const void* src_data, size_t size )
+{
+    if ( size == 0 )
+        return CompletedToken;
+
+    RHIBuffer* staging_buffer = nullptr;
+    const size_t staging_offset = Stage( src_data, size, BufferStagingAlignment, staging_buffer );
+
+    Batch& batch = GetPendingBatch();
+
+    RHICommandList::CopyRegion copy_region = {};
+    copy_region.src_offset = staging_offset;
+    copy_region.dst_offset = dst_offset;
+    copy_region.size = size;
+    batch.list->CopyBuffer( *staging_buffer, dst, 1, &copy_region );
+
+    batch.resources.emplace_back( &dst );
+    const Token token = batch.token;
+
+    SubmitIfFull();
+
+    return token;
+}
+
+GPUUploadManager::BLASPtr GPUUploadManager::BuildBLAS( const RHIASGeometryInfo& geom )
+{
+    if ( !SE_ENSURE( geom.type == RHIASGeometryType::Triangles ) )
+        return nullptr;
+
+    const RHIASBuildFlags flags = r_blasCompaction.GetValue() != 0 ? RHIASBuildFlags::AllowCompaction : RHIASBuildFlags::None;
+
+    RHIASBuildSizes build_sizes = {};
+    if ( !GetRHI().GetASBuildSize( RHIAccelerationStructureType::BLAS, &geom, 1, flags, build_sizes ) )
+        return nullptr;
+
+    RHI::ASInfo as_create_info = {};
+    as_create_info.size = build_sizes.as_size;
+    as_create_info.type = RHIAccelerationStructureType::BLAS;
+
+    RHIAccelerationStructurePtr as = GetRHI().CreateAS( as_create_info );
+    if ( !as )
+        return nullptr;
+
+    RHI::BufferInfo scratch_ci = {};
+    scratch_ci.size = build_sizes.scratch_size;
+    scratch_ci.usage = RHIBufferUsageFlags::AccelerationStructureScratch;
+    RHIBufferPtr scratch = GetRHI().CreateDeviceBuffer( scratch_ci );
+    if ( !scratch )
+        return nullptr;
+
+    Batch& batch = GetPendingBatch();
+
+    BLASPtr blas = std::make_shared<BLAS>();
+    blas->as = std::move( as );
+    blas->token = batch.token;
+
+    BLASBuild& build = batch.blas_builds.emplace_back();
+    build.blas = blas;
+    build.geom = geom;
+    build.flags = flags;
+    build.scratch = std::move( scratch );
+
+    // builds only get const pointers to the geometry
+    batch.resources.emplace_back( const_cast< RHIBuffer* >( geom.triangles.vtx_buf ) );
+    batch.resources.emplace_back( const_cast< RHIBuffer* >( geom.triangles.idx_buf ) );
+
+    m_stats.built_blas++;
+
+    return blas;
+}
+
+void GPUUploadManager::Submit()
+{
+    if ( m_pending.list == nullptr )
+        return;
+
+    RHICommandList& list = *m_pending.list;
+
+    if ( !m_pending.blas_builds.empty() )
+    {
+        // geometry may have been copied by this batch
+        list.MemoryBarrierGPU();
+
+        bc::small_vector<const RHIAccelerationStructure*, 16> compactable;
+        for ( const BLASBuild& build : m_pending.blas_builds )
+        {
+            const RHIASGeometryInfo* geom = &build.geom;
+            RHIASBuildInfo build_info = {};
+            build_info.dst = build.blas->as.get();
+            build_info.scratch = build.scratch.get();
+            build_info.geoms = &geom;
+            build_info.geoms_count = 1;
+            build_info.flags = build.flags;
+            list.BuildAS( build_info );
+
+            if ( build.flags == RHIASBuildFlags::AllowCompaction )
+                compactable.emplace_back( build_info.dst );
+        }
+
+        if ( !compactable.empty() )
+        {
+            list.MemoryBarrierGPU();
+
+            RHI::BufferInfo sizes_info = {};
+            sizes_info.size = sizeof( uint64_t ) * compactable.size();
+            sizes_info.usage = RHIBufferUsageFlags::TransferDst;
+            m_pending.compacted_sizes = GetRHI().CreateReadbackBuffer( sizes_info );
+            list.WriteCompactedASSizes( compactable.data(), compactable.size(), *m_pending.compacted_sizes->GetBuffer(), 0 );
+        }
+    }
+
+    for ( const Compaction& compaction : m_pending.compactions )
+        list.CompactAS( *compaction.blas->as, *compaction.compacted );
+
+    // uploaded resources may be used by any later work on the queue
+    list.MemoryBarrierGPU();
+    list.End();
+
+    RHICommandList* lists[] = { &list };
+    RHI::SubmitInfo submit_info = {};
+    submit_info.cmd_list_count = 1;
+    submit_info.cmd_lists = lists;
+    m_pending.fence = GetRHI().SubmitCommandLists( submit_info );
+    m_pending.list = nullptr;
+    m_pending.ring_end = m_ring_head;
+
+    m_in_flight.emplace_back( std::move( m_pending ) );
+    m_pending = {};
+    m_next_token++;
+    m_stats.submissions++;
+}
+
+void GPUUploadManager::Update()
+{
+    while ( !m_in_flight.empty() && GetRHI().IsFenceCompleted( m_in_flight.front().fence ) )
+    {
+        RetireBatch( m_in_flight.front() );
+        m_in_flight.pop_front();
+    }
+}
+
+void GPUUploadManager::Wait( Token token )
+{
+    if ( token >= m_next_token )
+        Submit();
+
+    while ( !IsCompleted( token ) && !m_in_flight.empty() )
+        WaitForOldestBatch();
+}
+
+void GPUUploadManager::WaitAll()
+{
+    // retired builds may schedule compactions
+    while ( m_pending.list != nullptr || !m_in_flight.empty() )
+    {
+        Submit();
+        while ( !m_in_flight.empty() )
+            WaitForOldestBatch();
+    }
+}
+
+GPUUploadManager::Batch& GPUUploadManager::GetPendingBatch()
+{
+    if ( m_pending.list == nullptr )
+    {
+        m_pending.token = m_next_token;
+        m_pending.list = GetRHI().GetCommandList( RHI::QueueType::Graphics );
+        m_pending.list->Begin();
+    }
+    return m_pending;
+}
+
+size_t GPUUploadManager::Stage( const void* src_data, size_t size, size_t alignment, RHIBuffer*& staging_buffer )
+{
+    m_stats.uploads++;
+    m_stats.uploaded_bytes += size;
+
+    // too large for the ring, gets its own buffer that lives as long as the batch
+    if ( size > m_ring_size / 2 )
+    {
+        RHI::BufferInfo staging_info = {};
+        staging_info.size = size;
+        staging_info.usage = RHIBufferUsageFlags::TransferSrc;
+        RHIUploadBufferPtr staging = GetRHI().CreateUploadBuffer( staging_info );
+        staging->WriteBytes( src_data, size );
+
+        Batch& batch = GetPendingBatch();
+        batch.staged_bytes += size;
+        batch.resources.emplace_back( staging );
+        staging_buffer = staging->GetBuffer();
+
+        m_stats.dedicated_staging_buffers++;
+        return 0;
+    }
+
+    size_t offset = 0;
+    while ( true )
+    {
+        // nothing uses the ring, allocations start over from its beginning
+        if ( m_ring_tail == m_ring_head )
+        {
+            m_ring_head = ( m_ring_head + m_ring_size - 1 ) / m_ring_size * m_ring_size;
+            m_ring_tail = m_ring_head;
+        }
+
+        offset = CalcAlignedSize( m_ring_head, alignment );
+        // allocations don't wrap, the rest of the ring is skipped
+        const size_t ring_offset = offset % m_ring_size;
+        if ( ring_offset + size > m_ring_size )
+            offset += m_ring_size - ring_offset;
+
+        if ( offset + size <= m_ring_tail + m_ring_size )
+            break;
+
+        // the pending batch holds the space itself
+        if ( m_in_flight.empty() )
+            Submit();
+
+        m_stats.ring_stalls++;
+        WaitForOldestBatch();
+    }
+
+    m_ring->WriteBytes( src_data, size, offset % m_ring_size );
+    m_ring_head = offset + size;
+
+    GetPendingBatch().staged_bytes += size;
+    staging_buffer = m_ring->GetBuffer();
+
+    return offset % m_ring_size;
+}
+
+void GPUUploadManager::SubmitIfFull()
+{
+    if ( m_pending.staged_bytes >= m_batch_size )
+        Submit();
+}
+
+void GPUUploadManager::RetireBatch( Batch& batch )
+{
+    m_completed_token = batch.token;
+    m_ring_tail = std::max( m_ring_tail, batch.ring_end );
+
+    for ( Compaction& compaction : batch.compactions )
+    {
+        m_stats.compacted_blas++;
+        m_stats.compaction_saved_bytes += compaction.blas->as->GetSize() - compaction.compacted->GetSize();
+        compaction.blas->as = std::move( compaction.compacted );
+    }
+
+    if ( batch.compacted_sizes == nullptr )
+        return;
+
+    std::vector<uint64_t> compacted_sizes( batch.compacted_sizes->GetBuffer()->GetSize() / sizeof( uint64_t ) );
+    batch.compacted_sizes->ReadBytes( compacted_sizes.data(), sizeof( uint64_t ) * compacted_sizes.size() );
+
+    size_t size_idx = 0;
+    for ( const BLASBuild& build : batch.blas_builds )
+    {
+        if ( build.flags != RHIASBuildFlags::AllowCompaction )
+            continue;
+
+        const BLASPtr& blas = build.blas;
+        const size_t compacted_size = size_t( compacted_sizes[size_idx++] );
+
+        // the batch holds the last reference, nobody waits for the structure anymore
+        if ( blas.use_count() == 1 || compacted_size == 0 || compacted_size >= blas->as->GetSize() )
+            continue;
+
+        RHI::ASInfo as_create_info = {};
+        as_create_info.size = compacted_size;
+        as_create_info.type = RHIAccelerationStructureType::BLAS;
+        RHIAccelerationStructurePtr compacted = GetRHI().CreateAS( as_create_info );
+        if ( !compacted )
+            continue;
+
+        Batch& pending = GetPendingBatch();
+        pending.compactions.emplace_back( Compaction{ blas, std::move( compacted ) } );
+        blas->token = pending.token;
+    }
+}
+
+void GPUUploadManager::WaitForOldestBatch()
+{
+    GetRHI().WaitForFenceCompletion( m_in_flight.front().fence );
+    Update();
+}
+
+// RingBufferDirtyTracker
+
+RingBufferDirtyTracker::RingBufferDirtyTracker( uint32_t ring_size )
+{
+    VERIFY( ring_size > 0 && ring_size <= MaxRingSize );
+    m_bufs.resize( ring_size );
+}
+
+void RingBufferDirtyTracker::MarkDirty( uint32_t elem_idx )
+{
+    if ( elem_idx >= m_dirty_mask.size() )
+        m_dirty_mask.resize( std::max<size_t>( elem_idx + 1, m_dirty_mask.size() * 2 ), 0 );
+
+    uint8_t& mask = m_dirty_mask[elem_idx];
+    for ( uint32_t buf_idx = 0; buf_idx < uint32_t( m_bufs.size() ); ++buf_idx )
+    {
+        const uint8_t buf_bit = uint8_t( 1u << buf_idx );
+        if ( mask & buf_bit )
+            continue;
+
+        mask |= buf_bit;
+        m_bufs[buf_idx].dirty_elems.emplace_back( elem_idx );
+    }
+}
+
+void RingBufferDirtyTracker::MarkAllDirty()
+{
+    for ( uint32_t buf_idx = 0; buf_idx < uint32_t( m_bufs.size() ); ++buf_idx )
+    {
+        MarkClean( buf_idx );
+        m_bufs[buf_idx].full_update = true;
+    }
+}
+
+void RingBufferDirtyTracker::ConsumeDirtyRanges( uint32_t buf_idx, uint32_t num_elems, uint32_t merge_gap, std::vector<Range>& ranges )
+{
+    ranges.clear();
+
+    std::vector<uint32_t>& dirty_elems = m_bufs[buf_idx].dirty_elems;
+    std::sort( dirty_elems.begin(), dirty_elems.end() );
+
+    const uint8_t buf_bit = uint8_t( 1u << buf_idx );
+    for ( uint32_t elem_idx : dirty_elems )
+    {
+        m_dirty_mask[elem_idx] &= ~buf_bit;
+
+        // elements past the end were removed after they had been changed
+        if ( elem_idx >= num_elems )
+            continue;
+
+        if ( !ranges.empty() && elem_idx <= ranges.back().first + ranges.back().count + merge_gap )
+            ranges.back().count = elem_idx - ranges.back().first + 1;
+        else
+            ranges.emplace_back( Range{ elem_idx, 1 } );
+    }
+
+    dirty_elems.clear();
+    m_bufs[buf_idx].full_update = false;
+}
+
+void RingBufferDirtyTracker::MarkClean( uint32_t buf_idx )
+{
+    const uint8_t buf_bit = uint8_t( 1u << buf_idx );
+    for ( uint32_t elem_idx : m_bufs[buf_idx].dirty_elems )
+        m_dirty_mask[elem_idx] &= ~buf_bit;
+
+    m_bufs[buf_idx].dirty_elems.clear();
+    m_bufs[buf_idx].full_update = false;
+}
+
+
+// BindlessSlotAllocator
+
+BindlessSlotAllocator::BindlessSlotAllocator( uint32_t max_slots )
+    : m_max_slots( max_slots )
+{
+    VERIFY( max_slots > 0 && max_slots <= MaxSlots );
+}
+
+BindlessSlotAllocator::Handle BindlessSlotAllocator::Allocate()
+{
+    uint32_t slot = 0;
+    if ( !m_free_slots.empty() )
+    {
+        slot = m_free_slots.back();
+        m_free_slots.pop_back();
+    }
+    else if ( m_generations.size() < m_max_slots )
+    {
+        slot = uint32_t( m_generations.size() );
+        m_generations.emplace_back( 0 );
+    }
+    else
+    {
+        return Handle{};
+    }
+
+    m_num_allocated++;
+    return Handle{ ( m_generations[slot] << IndexBits ) | slot };
+}
+
+bool BindlessSlotAllocator::Free( Handle handle, uint64_t frame )
+{
+    if ( !IsAlive( handle ) )
+        return false;
+
+    // invalidates the handle right away, the slot itself waits for the frame
+    const uint32_t slot = handle.GetIndex();
+    m_generations[slot] = ( m_generations[slot] + 1 ) % NumGenerations;
+    m_num_allocated--;
+
+    SE_ENSURE( m_pending_free.empty() || m_pending_free.back().frame <= frame );
+    m_pending_free.emplace_back( PendingFree{ frame, slot } );
+
+    return true;
+}
+
+bool BindlessSlotAllocator::IsAlive( Handle handle ) const
+{
+    if ( !handle.IsValid() )
+        return false;
+
+    const uint32_t slot = handle.GetIndex();
+    return slot < m_generations.size() && ( ( m_generations[slot] << IndexBits ) | slot ) == handle.value;
+}
+
+uint32_t BindlessSlotAllocator::Recycle( uint64_t completed_frame )
+{
+    uint32_t num_recycled = 0;
+    while ( !m_pending_free.empty() && m_pending_free.front().frame <= completed_frame )
+    {
+        m_free_slots.emplace_back( m_pending_free.front().slot );
+        m_pending_free.pop_front();
+        num_recycled++;
+    }
+    return num_recycled;
+}
+
+
+// TLAS
+
+TLAS::InstanceID TLAS::AddInstance( const RHIAccelerationStructure* blas, const glm::mat3x4& transform )
+{
+    InstanceID id = m_instances.emplace();
+    m_instances[id].blas = blas;
+    m_instances[id].transform = transform;
+
+    m_dirty_instances.MarkDirty( uint32_t( m_instances.get_packed_idx( id ) ) );
+    m_hierarchy_valid = false;
+
+    return id;
+}
+
+void TLAS::RemoveInstance( InstanceID id )
+{
+    if ( !m_instances.has( id ) )
+        return;
+
+    // the last instance is moved into the freed slot
+    const uint32_t packed_idx = uint32_t( m_instances.get_packed_idx( id ) );
+    m_instances.erase( id );
+    if ( packed_idx < m_instances.size() )
+        m_dirty_instances.MarkDirty( packed_idx );
+
+    m_hierarchy_valid = false;
+}
+
+void TLAS::SetInstanceTransform( InstanceID id, const glm::mat3x4& transform )
+{
+    m_instances[id].transform = transform;
+    m_dirty_instances.MarkDirty( uint32_t( m_instances.get_packed_idx( id ) ) );
+}
+
 bool TLAS::Build( RHICommandList& cmd_list )
 {
-    RHIASInstanceBufferPtr& gpu_instance_buf = m_gpu_instances[m_cur_buf_idx++];
+    const uint32_t buf_idx = uint32_t( m_cur_buf_idx++ );
     m_cur_buf_idx = m_cur_buf_idx % m_max_num_bufs;
 
+    RHIASInstanceBufferPtr& gpu_instance_buf = m_gpu_instances[buf_idx];
+
+    m_last_build_stats = {};
+
     RHIASBuildSizes build_sizes = {};
 
     RHIASGeometryInfo geom_info = {};
@@ -193,42 +811,42 @@ bool TLAS::Build( RHICommandList& cmd_list )
     if ( m_instances.empty() )
         NOTIMPL;
 
-    if ( !gpu_instance_buf )
-    {
-        RHI::ASInstanceBufferInfo instance_buffer_ci = {};
-        instance_buffer_ci.data = m_instances.data();
-        instance_buffer_ci.num_instances = m_instances.size();
-        gpu_instance_buf = GetRHI().CreateASInstanceBuffer( instance_buffer_ci );
-    }
-    
-    if ( !SE_ENSURE( m_gpu_instances != nullptr ) )
+    if ( !UploadInstances( gpu_instance_buf, buf_idx ) )
         return false;
 
-    gpu_instance_buf->UpdateBuffer( m_instances.data(), m_instances.size() );
+    const size_t num_instances = m_instances.size();
+    const size_t moved_instances = m_dirty_instances.GetNumDirty( m_changes_since_build_slot );
+    m_dirty_instances.MarkClean( m_changes_since_build_slot );
+    m_last_build_stats.moved_instances = moved_instances;
 
     geom_info.instances.instance_buf = gpu_instance_buf.get();
-    geom_info.instances.num_instances = m_instances.size();
+    geom_info.instances.num_instances = num_instances;
+
+    const RHIASBuildFlags build_flags = RHIASBuildFlags::AllowUpdate;
+    GetRHI().GetASBuildSize( RHIAccelerationStructureType::TLAS, &geom_info, 1, build_flags, build_sizes );
 
-    GetRHI().GetASBuildSize( RHIAccelerationStructureType::TLAS, &geom_info, 1, build_sizes );
+    const size_t scratch_size = std::max( build_sizes.scratch_size, build_sizes.update_scratch_size );
 
-    bool need_full_build = 
+    bool need_realloc = 
         !m_as || !m_scratch
-        || ( m_scratch->GetSize() < build_sizes.scratch_size )
+        || ( m_scratch->GetSize() < scratch_size )
         || ( m_as->GetSize() < build_sizes.as_size );
 
-    if ( need_full_build )
+    if ( need_realloc )
     {
         RHI::ASInfo as_create_info = {};
         as_create_info.size = build_sizes.as_size;
         as_create_info.size += as_create_info.size / 4; // make some room for subsequent rebuilds
         as_create_info.type = RHIAccelerationStructureType::TLAS;
 
+        m_hierarchy_valid = false;
+
         m_as = GetRHI().CreateAS( as_create_info );
         if ( !m_as )
             return false;
 
         RHI::BufferInfo scratch_ci = {};
-        scratch_ci.size = build_sizes.scratch_size;
+        scratch_ci.size = scratch_size;
         scratch_ci.size += scratch_ci.size / 4; // make some room for subsequent rebuilds
         scratch_ci.usage = RHIBufferUsageFlags::AccelerationStructureScratch;
         m_scratch = GetRHI().CreateDeviceBuffer( scratch_ci );
@@ -236,25 +854,100 @@ bool TLAS::Build( RHICommandList& cmd_list )
             return false;
     }
 
-    if ( !SE_ENSURE( m_as != nullptr && m_scratch != nullptr && m_gpu_instances != nullptr ) )
+    if ( !SE_ENSURE( m_as != nullptr && m_scratch != nullptr && gpu_instance_buf != nullptr ) )
         return false;
 
+    if ( m_hierarchy_valid && moved_instances == 0 )
+    {
+        m_last_build_stats.type = BuildType::Skipped;
+        m_last_build_stats.refit_quality_loss = m_refit_quality_loss;
+        return true;
+    }
+
+    // Refitting keeps the hierarchy, so bounds of the nodes grow with every moved instance and traversal gets slower.
+    // The loss is estimated as the fraction of instances moved, summed over the refits since the last full build
+    const float moved_fraction = float( moved_instances ) / float( num_instances );
+    const bool refit = m_hierarchy_valid
+        && r_tlasRefit.GetValue() != 0
+        && moved_fraction * 100.0f <= float( r_tlasRefitMaxMovedPercent.GetValue() )
+        && ( m_refit_quality_loss + moved_fraction ) * 100.0f <= float( r_tlasRefitMaxQualityLossPercent.GetValue() );
+
     const RHIASGeometryInfo* geom_info_ptr = &geom_info;
     RHIASBuildInfo build_info = {};
     build_info.geoms = &geom_info_ptr;
     build_info.geoms_count = 1;
     build_info.dst = m_as.get();
     build_info.scratch = m_scratch.get();
+    build_info.flags = build_flags;
+
+    if ( refit )
+    {
+        build_info.mode = RHIASBuildMode::Update;
+        build_info.src = m_as.get();
+        m_refit_quality_loss += moved_fraction;
+        m_last_build_stats.type = BuildType::Refit;
+    }
+    else
+    {
+        m_refit_quality_loss = 0.0f;
+        m_hierarchy_valid = true;
+        m_last_build_stats.type = BuildType::Build;
+    }
+    m_last_build_stats.refit_quality_loss = m_refit_quality_loss;
 
     cmd_list.BuildAS( build_info );
 
     return true;
 }
 
+bool TLAS::UploadInstances( RHIASInstanceBufferPtr& gpu_instance_buf, uint32_t buf_idx )
+{
+    const size_t num_instances = m_instances.size();
+
+    if ( !gpu_instance_buf )
+    {
+        RHI::ASInstanceBufferInfo instance_buffer_ci = {};
+        instance_buffer_ci.data = m_instances.data();
+        instance_buffer_ci.num_instances = num_instances;
+        gpu_instance_buf = GetRHI().CreateASInstanceBuffer( instance_buffer_ci );
+        if ( !SE_ENSURE( gpu_instance_buf != nullptr ) )
+            return false;
+
+        m_dirty_instances.MarkClean( buf_idx );
+        m_last_build_stats.uploaded_instances = num_instances;
+        m_last_build_stats.upload_ranges = 1;
+        return true;
+    }
+
+    if ( m_dirty_instances.NeedsFullUpdate( buf_idx ) || gpu_instance_buf->GetCapacity() < num_instances )
+    {
+        gpu_instance_buf->UpdateBuffer( m_instances.data(), num_instances );
+
+        m_dirty_instances.MarkClean( buf_idx );
+        m_last_build_stats.uploaded_instances = num_instances;
+        m_last_build_stats.upload_ranges = 1;
+        return true;
+    }
+
+    m_dirty_instances.ConsumeDirtyRanges( buf_idx, uint32_t( num_instances ), r_tlasUploadMergeGap.GetValue(), m_upload_ranges );
+    for ( const RingBufferDirtyTracker::Range& range : m_upload_ranges )
+    {
+        gpu_instance_buf->UpdateBufferRange( m_instances.data() + range.first, range.first, range.count );
+        m_last_build_stats.uploaded_instances += range.count;
+    }
+    m_last_build_stats.upload_ranges = m_upload_ranges.size();
+
+    return true;
+}
+
 void TLAS::Reset()
 {
     m_as = nullptr;
     m_scratch = nullptr;
     for ( auto& instance_buf : m_gpu_instances )
         instance_buf = nullptr;
+
+    m_dirty_instances.MarkAllDirty();
+    m_hierarchy_valid = false;
+    m_refit_quality_loss = 0.0f;
 }
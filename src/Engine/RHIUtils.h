@@ -2,8 +2,119 @@
 
 #include "StdAfx.h"
 
+// Mirrors a CPU-side array into a ring of GPU buffers that are written in turn. Remembers which elements every buffer of the ring
+// is missing, so a buffer only receives the elements changed since it was written the last time
+class RingBufferDirtyTracker
+{
+public:
+    static constexpr uint32_t MaxRingSize = 8;
+
+    struct Range
+    {
+        uint32_t first = 0;
+        uint32_t count = 0;
+    };
+
+    explicit RingBufferDirtyTracker( uint32_t ring_size );
+
+    void MarkDirty( uint32_t elem_idx );
+    void MarkAllDirty(); // every buffer of the ring needs a full rewrite
+
+    bool NeedsFullUpdate( uint32_t buf_idx ) const { return m_bufs[buf_idx].full_update; }
+    size_t GetNumDirty( uint32_t buf_idx ) const { return m_bufs[buf_idx].dirty_elems.size(); }
+
+    // Sorted ranges of dirty elements below num_elems, marks the buffer as up-to-date. Ranges separated by no more than merge_gap
+    // clean elements are merged, rewriting a few clean elements is cheaper than an extra copy
+    void ConsumeDirtyRanges( uint32_t buf_idx, uint32_t num_elems, uint32_t merge_gap, std::vector<Range>& ranges );
+
+    // Marks the buffer as up-to-date after it was rewritten entirely
+    void MarkClean( uint32_t buf_idx );
+
+private:
+    struct BufferState
+    {
+        std::vector<uint32_t> dirty_elems;
+        bool full_update = true;
+    };
+    bc::small_vector<BufferState, MaxRingSize> m_bufs;
+
+    std::vector<uint8_t> m_dirty_mask; // bit per ring buffer for every element
+};
+
+// Stable indices into bindless tables. Allocate and Free are O(1), the slot table grows on demand up to max_slots.
+// Freed slots may still be read by frames in flight, they are tagged with the current frame and go back to the free list
+// once Recycle is told that the frame completed. Handles carry a generation of the slot, so stale handles are detected
+class BindlessSlotAllocator
+{
+public:
+    static constexpr uint32_t IndexBits = 20;
+    static constexpr uint32_t MaxSlots = 1u << IndexBits;
+
+    struct Handle
+    {
+        static constexpr uint32_t InvalidValue = ~0u;
+
+        uint32_t value = InvalidValue; // generation in the high bits
+
+        bool IsValid() const { return value != InvalidValue; }
+        uint32_t GetIndex() const { return value & ( MaxSlots - 1 ); }
+        bool operator==( const Handle& other ) const { return value == other.value; }
+    };
+
+    explicit BindlessSlotAllocator( uint32_t max_slots = MaxSlots );
+
+    // invalid handle when all slots are in use
+    Handle Allocate();
+    // frame is the last one that may read the slot. Returns false for stale handles
+    bool Free( Handle handle, uint64_t frame );
+    bool IsAlive( Handle handle ) const;
+
+    // slots freed up to completed_frame are reused. Returns the number of recycled slots
+    uint32_t Recycle( uint64_t completed_frame );
+
+    uint32_t GetNumAllocated() const { return m_num_allocated; }
+    uint32_t GetNumPendingFree() const { return uint32_t( m_pending_free.size() ); }
+    // every index handed out so far is below it, tables have to cover that many slots
+    uint32_t GetHighWatermark() const { return uint32_t( m_generations.size() ); }
+    uint32_t GetMaxSlots() const { return m_max_slots; }
+
+private:
+    // the highest one is skipped, so no handle matches InvalidValue
+    static constexpr uint32_t NumGenerations = ( 1u << ( 32 - IndexBits ) ) - 1;
+
+    struct PendingFree
+    {
+        uint64_t frame = 0;
+        uint32_t slot = 0;
+    };
+
+    std::vector<uint32_t> m_generations; // generation of the current or the next handle of every slot
+    std::vector<uint32_t> m_free_slots;
+    std::deque<PendingFree> m_pending_free; // ordered by frame
+    uint32_t m_num_allocated = 0;
+    uint32_t m_max_slots = MaxSlots;
+};
+
 class TLAS
 {
+public:
+    enum class BuildType : uint8_t
+    {
+        Skipped = 0, // nothing changed since the previous build
+        Build,
+        Refit
+    };
+
+    struct BuildStats
+    {
+        BuildType type = BuildType::Skipped;
+        size_t moved_instances = 0; // since the previous build
+        size_t uploaded_instances = 0;
+        size_t upload_ranges = 0;
+        float refit_quality_loss = 0.0f; // accumulated since the last full build, see r_tlasRefitMaxQualityLossPercent
+    };
+
+private:
     RHIAccelerationStructurePtr m_as = nullptr;
     RHIBufferPtr m_scratch = nullptr;
     packed_freelist<RHIASInstanceData> m_instances;
@@ -12,35 +123,169 @@ class TLAS
     RHIASInstanceBufferPtr m_gpu_instances[m_max_num_bufs] = {};
     size_t m_cur_buf_idx = 0;
 
+    // one more slot than there are buffers, it tracks instances changed since the previous build
+    static const constexpr uint32_t m_changes_since_build_slot = m_max_num_bufs;
+    RingBufferDirtyTracker m_dirty_instances = RingBufferDirtyTracker( m_max_num_bufs + 1 );
+    std::vector<RingBufferDirtyTracker::Range> m_upload_ranges;
+
+    // a refit keeps the hierarchy of the last full build, so it's only possible while the set of instances stays the same
+    bool m_hierarchy_valid = false;
+    float m_refit_quality_loss = 0.0f;
+
+    BuildStats m_last_build_stats = {};
+
 public:
     using InstanceID = decltype( m_instances )::id;
 
+    InstanceID AddInstance( const RHIAccelerationStructure* blas, const glm::mat3x4& transform );
+    void RemoveInstance( InstanceID id );
+    void SetInstanceTransform( InstanceID id, const glm::mat3x4& transform );
+
+    // Uploads instances changed since the last build and refits or rebuilds the structure, depending on how many of them moved
     bool Build( RHICommandList& cmd_list );
 
     void Reset(); // clears memory, releases rhi objects
 
     RHIAccelerationStructure& GetRHIAS() const { return *m_as; }
 
-    auto& Instances() { return m_instances; };
     const auto& Instances() const { return m_instances; }
+
+    const BuildStats& GetLastBuildStats() const { return m_last_build_stats; }
+
+private:
+    bool UploadInstances( RHIASInstanceBufferPtr& gpu_instance_buf, uint32_t buf_idx );
+};
+
+// Batches uploads of GPU resources into one submission per frame, or per batch_size bytes of staged data, instead of a flush per resource.
+// Data is staged in a persistent ring of upload memory, the part of the ring used by a batch is reclaimed once its fence completes.
+// Callers get a token of the batch to poll instead of waiting. BLAS builds go to the same batches and are compacted by a later one.
+// Not thread-safe, the engine uses it on the asset upload stage
+class GPUUploadManager
+{
+public:
+    // batch index, batches complete in order
+    using Token = uint64_t;
+    static constexpr Token CompletedToken = 0;
+
+    struct BLAS
+    {
+        RHIAccelerationStructurePtr as; // replaced with the compacted copy before the token completes
+        Token token = CompletedToken; // moves to the compacting batch once the build completed
+    };
+    using BLASPtr = std::shared_ptr<BLAS>;
+
+    struct Stats
+    {
+        uint64_t submissions = 0;
+        uint64_t uploads = 0;
+        uint64_t uploaded_bytes = 0;
+        uint64_t dedicated_staging_buffers = 0; // uploads larger than the ring
+        uint64_t ring_stalls = 0; // waits for the GPU to free ring space
+        uint64_t built_blas = 0;
+        uint64_t compacted_blas = 0;
+        uint64_t compaction_saved_bytes = 0;
+    };
+
+    GPUUploadManager( size_t ring_size, size_t batch_size );
+    ~GPUUploadManager(); // waits for all batches
+
+    // Same as the RHIUtils functions, without the flush. The resource may be used by GPU work submitted after the token completes,
+    // or after the batch is submitted for work on the graphics queue
+    RHIBufferPtr CreateInitializedBuffer( RHI::BufferInfo& buffer_info, const void* src_data, size_t src_size, Token& token );
+    RHITexturePtr CreateInitializedTexture( RHI::TextureInfo& texture_info, const void* src_data, size_t src_size,
+                                            const std::span<const RHIBufferTextureCopyRegion>& regions, Token& token );
+    // dst must have TransferDst usage
+    Token UploadBuffer( RHIBuffer& dst, size_t dst_offset, const void* src_data, size_t size );
+
+    // Triangles only. Built after the copies of the pending batch, so the geometry may be uploaded by the same batch.
+    // The geometry buffers are kept alive until the build completes. Structures nobody holds a handle to by then are not compacted
+    BLASPtr BuildBLAS( const RHIASGeometryInfo& geom );
+
+    // Submits the pending batch, if there is one. The engine calls it once per frame
+    void Submit();
+    // Polls fences of the batches in flight, reclaims their ring space and schedules compaction of the built structures
+    void Update();
+
+    bool IsCompleted( Token token ) const { return token <= m_completed_token; }
+    void Wait( Token token );
+    void WaitAll();
+
+    const Stats& GetStats() const { return m_stats; }
+
+private:
+    struct BLASBuild
+    {
+        BLASPtr blas;
+        RHIASGeometryInfo geom = {};
+        RHIASBuildFlags flags = RHIASBuildFlags::None;
+        RHIBufferPtr scratch;
+    };
+
+    struct Compaction
+    {
+        BLASPtr blas;
+        RHIAccelerationStructurePtr compacted;
+    };
+
+    struct Batch
+    {
+        Token token = CompletedToken;
+        RHICommandList* list = nullptr; // recording while the batch is pending
+        RHIFence fence = {};
+        size_t ring_end = 0; // ring head when the batch was submitted
+        size_t staged_bytes = 0;
+        std::vector<RHIObjectPtr<RHIObject>> resources; // destinations, dedicated staging buffers and build inputs
+        std::vector<BLASBuild> blas_builds; // recorded on submission, after the copies
+        std::vector<Compaction> compactions;
+        RHIReadbackBufferPtr compacted_sizes;
+    };
+
+    Batch& GetPendingBatch();
+    // offset into the buffer of the staged data
+    size_t Stage( const void* src_data, size_t size, size_t alignment, RHIBuffer*& staging_buffer );
+    void SubmitIfFull();
+    void RetireBatch( Batch& batch );
+    void WaitForOldestBatch();
+
+    RHIUploadBufferPtr m_ring;
+    size_t m_ring_size = 0;
+    // offsets grow monotonically, the physical offset is modulo m_ring_size. Data between the tail and the head is used by batches
+    size_t m_ring_head = 0;
+    size_t m_ring_tail = 0;
+    size_t m_batch_size = 0;
+
+    Batch m_pending;
+    std::deque<Batch> m_in_flight;
+    Token m_next_token = 1;
+    Token m_completed_token = CompletedToken;
+
+    Stats m_stats;
 };
 
 struct RHIUtils
 {
     // Creates upload buffer under the hood, and transfers the data. Flushes rhi and waits for completion, so use with care. buffer_info must be filled
-    // No const ref because the function appends TransferDst usage flag to buffer_info
+    // No const ref because the function appends TransferDst usage flag to buffer_info. GPUUploadManager does the same without the flush
     static RHIBufferPtr CreateInitializedGPUBuffer( RHI::BufferInfo& buffer_info, const void* src_data, size_t src_size );
 
     // Creates upload buffer under the hood, and transfers the data. Flushes rhi and waits for completion, so use with care. texture_info must be filled
-    // No const ref because the function appends TransferDst usage flag to texture_info
+    // No const ref because the function appends TransferDst usage flag to texture_info.
+    // src_data holds tightly packed mips of the first layer, then the mips of the next one
     static RHITexturePtr CreateInitializedGPUTexture( RHI::TextureInfo& texture_info, const void* src_data, size_t src_size );
+    // Same, with explicit copy regions into src_data. Every region may cover only one mip
+    static RHITexturePtr CreateInitializedGPUTexture( RHI::TextureInfo& texture_info, const void* src_data, size_t src_size,
+                                                      const std::span<const RHIBufferTextureCopyRegion>& regions );
 
-    // Super slow because of the flushes and lots of allocations
+    // Super slow because of the flushes and lots of allocations, GPUUploadManager::BuildBLAS batches the builds
     static RHIAccelerationStructurePtr CreateAS( const RHIASGeometryInfo& geom );
 
     // Allows "immediate mode" controls. EndSingleTimeCommands flushes entire RHI, so use with caution
     static RHICommandList* BeginSingleTimeCommands( RHI::QueueType queue_type );
     static void EndSingleTimeCommands( RHICommandList& list );
 
+    // Bytes per texel, or per 4x4 block for block compressed formats
     static uint8_t GetRHIFormatSize( RHIFormat format );
+    static bool IsRHIFormatBlockCompressed( RHIFormat format );
+    // Tightly packed size of one mip of one array layer, block compressed mips are padded to whole blocks
+    static size_t GetRHITextureMipSize( RHIFormat format, uint32_t width, uint32_t height, uint32_t depth, uint32_t mip );
 };
\ No newline at end of file
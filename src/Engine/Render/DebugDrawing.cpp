@@ -324,6 +324,7 @@ void DebugDrawing::AddDrawPasses( SceneViewFrameData& data, DebugDrawingContext&
     ctx.draw_pass->UseBuffer( *ctx.lines_buf, RGBufferUsage::ShaderRead );
     ctx.draw_pass->UseBuffer( *ctx.lines_args_buf, RGBufferUsage::IndirectArgs );
     ctx.draw_pass->UseTextureView( *data.scene_output[data.scene_output_idx]->GetRTView() );
+    ctx.draw_pass->SetHasUntrackedAccesses(); // view descriptor set
 }
 
 void DebugDrawing::RecordInitPasses( RHICommandList& cmd_list, const SceneViewFrameData& data, const DebugDrawingContext& ctx ) const
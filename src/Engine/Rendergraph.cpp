@@ -4,6 +4,71 @@
 
 #include "DescriptorSetPool.h"
 
+#include <utils/TaskScheduler.h>
+
+CVAR_DEFINE( rg_asyncQueues, int, 1, "Allow rendergraph to move compute and copy passes to async queues" );
+CVAR_DEFINE( rg_queueSyncCost, uint32_t, 50, "Estimated cost of a cross-queue wait in microseconds, used by rendergraph scheduling" );
+CVAR_DEFINE( rg_logTransientResources, int, 0, "Log placement of transient rendergraph resources on every compile" );
+CVAR_DEFINE( rg_cullPasses, int, 1, "Skip rendergraph passes that don't contribute to external resources" );
+CVAR_DEFINE( rg_optimizeBarriers, int, 1, "Emit rendergraph memory barriers only for hazards and merge barrier batches. If 0, every pass starts with a memory barrier" );
+CVAR_DEFINE( rg_cacheCompiledGraphs, int, 1, "Reuse compiled rendergraph plans while the structure of the graph stays the same" );
+
+// Everything Compile() produces for one graph structure. Passes are referenced by index and resources by handle,
+// RHI textures in barriers are patched when the plan is applied, so the plan survives swapchain image changes
+struct RGCompiledPlan
+{
+    static constexpr uint64_t NoResource = uint64_t( -1 );
+
+    struct Barrier
+    {
+        uint64_t texture_handle = 0;
+        RHITextureBarrier barrier = {};
+    };
+
+    struct Pass
+    {
+        RHI::QueueType scheduled_queue = RHI::QueueType::Graphics;
+        bool begins_submission = false;
+        bool culled = false;
+        bool start_memory_barrier = false;
+        std::vector<Barrier> start_barriers;
+    };
+
+    struct Submission
+    {
+        std::vector<uint32_t> passes;
+        std::vector<Barrier> end_barriers;
+        RHI::QueueType type = RHI::QueueType::Graphics;
+        std::vector<uint32_t> wait_submissions;
+    };
+
+    struct TransientAllocation
+    {
+        uint64_t handle = 0;
+        bool is_texture = false;
+        uint32_t first_pass = 0;
+        uint32_t last_pass = 0;
+        uint32_t heap = TransientResourceAllocator::InvalidHeap;
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint64_t aliased_handle = NoResource;
+    };
+
+    uint64_t key = 0;
+    uint64_t last_used = 0;
+
+    // see Rendergraph::DescribeStructure
+    std::vector<uint64_t> structure;
+
+    std::vector<Pass> passes;
+    std::vector<Submission> submissions;
+    std::vector<TransientAllocation> transient_allocations;
+    std::vector<uint64_t> heap_sizes;
+
+    RGTransientResourceStats transient_stats;
+    RGScheduleStats schedule_stats;
+};
+
 // RGTexture
 
 RGTexture::RGTexture( uint64_t handle, const char* name, bool is_external )
@@ -11,6 +76,16 @@ RGTexture::RGTexture( uint64_t handle, const char* name, bool is_external )
 {
 }
 
+void RGTexture::SetRHIViews( RHITextureROView* ro_view, RHITextureRWView* rw_view, RHIRenderTargetView* rt_view )
+{
+    if ( m_ro_view.has_value() )
+        m_ro_view->m_rhi_view = ro_view;
+    if ( m_rw_view.has_value() )
+        m_rw_view->m_rhi_view = rw_view;
+    if ( m_rt_view.has_value() )
+        m_rt_view->m_rhi_view = rt_view;
+}
+
 const RGTextureROView* RGTexture::RegisterExternalROView( const RGExternalTextureROViewDesc& desc )
 {
     if ( m_ro_view.has_value() )
@@ -54,6 +129,19 @@ RGExternalTexture::RGExternalTexture( uint64_t handle, const RGExternalTextureDe
 {
 }
 
+// RGTransientTexture
+
+RGTransientTexture::RGTransientTexture( uint64_t handle, const RGTransientTextureDesc& desc )
+    : RGTexture( handle, desc.name, /*is_external=*/false ), m_desc( desc )
+{
+    if ( bool( desc.info.usage & RHITextureUsageFlags::TextureROView ) )
+        RegisterExternalROView( {} );
+    if ( bool( desc.info.usage & RHITextureUsageFlags::TextureRWView ) )
+        RegisterExternalRWView( {} );
+    if ( bool( desc.info.usage & RHITextureUsageFlags::RenderTargetView ) )
+        RegisterExternalRTView( {} );
+}
+
 // RGBuffer
 
 RGBuffer::RGBuffer( uint64_t handle, const char* name )
@@ -68,6 +156,13 @@ RGExternalBuffer::RGExternalBuffer( uint64_t handle, const RGExternalBufferDesc&
 {
 }
 
+// RGTransientBuffer
+
+RGTransientBuffer::RGTransientBuffer( uint64_t handle, const RGTransientBufferDesc& desc )
+    : RGBuffer( handle, desc.name ), m_desc( desc )
+{
+}
+
 // Rendergraph
 
 Rendergraph::Rendergraph()
@@ -129,10 +224,20 @@ RGExternalBuffer* Rendergraph::RegisterExternalBuffer( const RGExternalBufferDes
     return buffer_ptr;
 }
 
-RGResource* Rendergraph::CreateTransientTexture()
+RGTransientTexture* Rendergraph::CreateTransientTexture( const RGTransientTextureDesc& desc )
 {
-    NOTIMPL;
-    return nullptr;
+    if ( !SE_ENSURE( desc.name != nullptr ) )
+        return nullptr;
+
+    std::unique_ptr<RGTransientTexture> transient_texture = std::make_unique<RGTransientTexture>( GenerateHandle(), desc );
+
+    RGTransientTexture* texture_ptr = transient_texture.get();
+
+    auto& entry = m_transient_textures[transient_texture->GetHandle()];
+
+    entry.texture = std::move( transient_texture );
+
+    return texture_ptr;
 }
 
 RGResource* Rendergraph::RegisterExternalAS()
@@ -141,10 +246,20 @@ RGResource* Rendergraph::RegisterExternalAS()
     return nullptr;
 }
 
-RGResource* Rendergraph::CreateTransientBuffer()
+RGTransientBuffer* Rendergraph::CreateTransientBuffer( const RGTransientBufferDesc& desc )
 {
-    NOTIMPL;
-    return nullptr;
+    if ( !SE_ENSURE( desc.name != nullptr ) )
+        return nullptr;
+
+    std::unique_ptr<RGTransientBuffer> transient_buffer = std::make_unique<RGTransientBuffer>( GenerateHandle(), desc );
+
+    RGTransientBuffer* buffer_ptr = transient_buffer.get();
+
+    auto& entry = m_transient_buffers[transient_buffer->GetHandle()];
+
+    entry.buffer = std::move( transient_buffer );
+
+    return buffer_ptr;
 }
 
 namespace
@@ -162,22 +277,131 @@ namespace
         }
         NOTIMPL;
     }
+
+    template<typename T>
+    void HashCombine( uint64_t& seed, const T& val )
+    {
+        seed ^= std::hash<T>()( val ) + 0x9e3779b97f4a7c15ull + ( seed << 6 ) + ( seed >> 2 );
+    }
+
+    uint64_t CalcTransientTextureKey( const RHI::TextureInfo& info, const RHIMemoryHeap* heap, uint64_t offset )
+    {
+        uint64_t key = 0;
+        HashCombine( key, info.dimensions );
+        HashCombine( key, info.format );
+        HashCombine( key, info.allow_multiformat_views );
+        HashCombine( key, info.width );
+        HashCombine( key, info.height );
+        HashCombine( key, info.depth );
+        HashCombine( key, info.mips );
+        HashCombine( key, info.array_layers );
+        HashCombine( key, info.usage );
+        HashCombine( key, info.initial_layout );
+        HashCombine( key, heap );
+        HashCombine( key, offset );
+        return key;
+    }
+
+    uint64_t CalcTransientBufferKey( const RHI::BufferInfo& info, const RHIMemoryHeap* heap, uint64_t offset )
+    {
+        uint64_t key = 0;
+        HashCombine( key, info.size );
+        HashCombine( key, info.usage );
+        HashCombine( key, heap );
+        HashCombine( key, offset );
+        return key;
+    }
+
+    template<typename Map>
+    void GetSortedHandles( const Map& map, std::vector<uint64_t>& handles )
+    {
+        handles.clear();
+        for ( const auto& [handle, entry] : map )
+            handles.emplace_back( handle );
+        std::sort( handles.begin(), handles.end() );
+    }
+
+    uint64_t CalcStructureKey( const std::vector<uint64_t>& structure )
+    {
+        uint64_t key = 0;
+        for ( uint64_t value : structure )
+            HashCombine( key, value );
+        return key;
+    }
+
+    const RGResource* GetAllocatedResource( const RGTransientResourceAllocation& allocation )
+    {
+        if ( allocation.texture != nullptr )
+            return allocation.texture;
+        return allocation.buffer;
+    }
 }
 
 bool Rendergraph::Compile()
 {
-    // 0. Validate all passes are graphics
+    m_compile_count++;
+    m_compile_stats.cached = false;
+
+    const bool use_cache = rg_cacheCompiledGraphs.GetValue() > 0;
+    uint64_t key = 0;
+    if ( use_cache )
+    {
+        DescribeStructure( m_structure );
+        key = CalcStructureKey( m_structure );
+
+        // the key only narrows the search, a plan is reused if the whole structure matches
+        auto plan_it = std::find_if( m_compiled_plans.begin(), m_compiled_plans.end(),
+            [this, key]( const auto& plan ) { return plan->key == key && plan->structure == m_structure; } );
+
+        if ( plan_it != m_compiled_plans.end() )
+        {
+            if ( ApplyCompiledPlan( **plan_it ) )
+            {
+                ( *plan_it )->last_used = m_compile_count;
+                m_compile_stats.cached = true;
+                m_compile_stats.cache_hits++;
+                return true;
+            }
+
+            // everything applied so far is overwritten by the full compile
+            m_compiled_plans.erase( plan_it );
+        }
+    }
+
+    m_compile_stats.cache_misses++;
+
+    // 0. Validate queues. Only graphics queue can render
     for ( const auto& pass : m_passes )
     {
-        if ( pass->m_queue_type != RHI::QueueType::Graphics )
+        if ( !SE_ENSURE( pass->m_queue_type < RHI::QueueType::Count ) )
+            return false;
+
+        if ( pass->m_queue_type == RHI::QueueType::Graphics )
+            continue;
+
+        for ( const auto& [handle, used_texture] : pass->m_used_textures )
         {
-            NOTIMPL;
+            if ( used_texture.usage == RGTextureUsage::RenderTarget )
+            {
+                SE_LOG_ERROR( Rendergraph, "Pass <%s> uses texture <%s> as a render target, but it is not on the graphics queue", pass->m_name.c_str(), used_texture.texture->GetName().c_str() );
+                return false;
+            }
         }
     }
 
-    // 1. Build layout transitions for external resources
+    // 1. Remove passes that don't contribute to the frame
+    CullPasses();
+
+    // 2. Allocate memory for transient resources. This has to be done before building barriers, since barriers need RHI textures
+    if ( !AllocateTransientResources() )
+        return false;
+
+    // 3. Find first and last usage of external resources
     for ( const auto& pass : m_passes )
     {
+        if ( pass->m_culled )
+            continue;
+
         for ( const auto& [handle, used_texture] : pass->m_used_textures )
         {
             if ( !used_texture.texture->IsExternal() )
@@ -197,178 +421,1312 @@ bool Rendergraph::Compile()
         }
     }
 
-    std::vector<RHITextureBarrier> initial_barriers;
-    m_final_barriers.clear();
+    // 4. Assign passes to queues, split them into submissions and build barriers
+    if ( !ScheduleSubmissions() )
+        return false;
 
-    initial_barriers.reserve( m_external_textures.size() );
-    m_final_barriers.reserve( m_external_textures.size() );
+    if ( use_cache )
+        StoreCompiledPlan( key );
 
-    std::unordered_map<uint64_t, RHITextureLayout> current_layouts;
+    return true;
+}
 
-    for ( const auto& [handle, ext_texture_entry] : m_external_textures )
+// Flat description of everything Compile() results depend on except RHI resources of external textures and buffers.
+// Resource and usage maps are unordered, so their elements are written in handle order
+void Rendergraph::DescribeStructure( std::vector<uint64_t>& structure ) const
+{
+    RHI& rhi = GetRHI();
+
+    structure.clear();
+    structure.push_back( rg_asyncQueues.GetValue() > 0 );
+    structure.push_back( rg_queueSyncCost.GetValue() );
+    structure.push_back( rg_cullPasses.GetValue() > 0 );
+    structure.push_back( rg_optimizeBarriers.GetValue() > 0 );
+    structure.push_back( rhi.IsQueueSupported( RHI::QueueType::Compute ) );
+    structure.push_back( rhi.IsQueueSupported( RHI::QueueType::Copy ) );
+    structure.push_back( rhi.SupportsPlacedResources() );
+    structure.push_back( m_handle_generator );
+
+    std::vector<uint64_t> handles;
+
+    GetSortedHandles( m_external_textures, handles );
+    structure.push_back( handles.size() );
+    for ( uint64_t handle : handles )
     {
-        const RGExternalTextureDesc& tex_desc = ext_texture_entry.texture->GetDesc();
+        const RGExternalTextureDesc& desc = m_external_textures.at( handle ).texture->GetDesc();
+        structure.insert( structure.end(), { handle, uint64_t( desc.initial_layout ), uint64_t( desc.final_layout ) } );
+    }
 
-        // If texture is not really used in any of the passes, we still need to correctly transition it from initial layout to final layout
-        if ( ext_texture_entry.first_usage == RGTextureUsage::Undefined )
+    GetSortedHandles( m_external_buffers, handles );
+    structure.push_back( handles.size() );
+    structure.insert( structure.end(), handles.begin(), handles.end() );
+
+    GetSortedHandles( m_transient_textures, handles );
+    structure.push_back( handles.size() );
+    for ( uint64_t handle : handles )
+    {
+        const RHI::TextureInfo& info = m_transient_textures.at( handle ).texture->GetDesc().info;
+        structure.insert( structure.end(), {
+            handle, uint64_t( info.dimensions ), uint64_t( info.format ), uint64_t( info.allow_multiformat_views ),
+            info.width, info.height, info.depth, info.mips, info.array_layers, uint64_t( info.usage ), uint64_t( info.initial_layout ) } );
+    }
+
+    GetSortedHandles( m_transient_buffers, handles );
+    structure.push_back( handles.size() );
+    for ( uint64_t handle : handles )
+    {
+        const RHI::BufferInfo& info = m_transient_buffers.at( handle ).buffer->GetDesc().info;
+        structure.insert( structure.end(), { handle, info.size, uint64_t( info.usage ) } );
+    }
+
+    structure.push_back( m_passes.size() );
+    for ( const auto& pass : m_passes )
+    {
+        structure.insert( structure.end(), {
+            uint64_t( pass->m_queue_type ), pass->m_cost_hint, uint64_t( pass->m_untracked_accesses ) } );
+
+        GetSortedHandles( pass->m_used_textures, handles );
+        structure.push_back( handles.size() );
+        for ( uint64_t handle : handles )
+            structure.insert( structure.end(), { handle, uint64_t( pass->m_used_textures.at( handle ).usage ) } );
+
+        GetSortedHandles( pass->m_used_buffers, handles );
+        structure.push_back( handles.size() );
+        for ( uint64_t handle : handles )
+            structure.insert( structure.end(), { handle, uint64_t( pass->m_used_buffers.at( handle ).usage ) } );
+    }
+}
+
+bool Rendergraph::ApplyCompiledPlan( const RGCompiledPlan& plan )
+{
+    if ( !SE_ENSURE( plan.passes.size() == m_passes.size() ) )
+        return false;
+
+    std::vector<const RGResource*> resources( m_handle_generator, nullptr );
+    std::vector<const RHITexture*> rhi_textures( m_handle_generator, nullptr );
+    for ( const auto& [handle, entry] : m_external_textures )
+    {
+        resources[handle] = entry.texture.get();
+        rhi_textures[handle] = entry.texture->GetDesc().rhi_texture;
+    }
+    for ( const auto& [handle, entry] : m_transient_textures )
+        resources[handle] = entry.texture.get();
+    for ( const auto& [handle, entry] : m_transient_buffers )
+        resources[handle] = entry.buffer.get();
+
+    // 1. Transient resources get the same placement as in the frame that compiled the plan
+    m_transient_allocations.clear();
+    m_transient_allocations.reserve( plan.transient_allocations.size() );
+    for ( const RGCompiledPlan::TransientAllocation& cached_allocation : plan.transient_allocations )
+    {
+        RGTransientResourceAllocation& allocation = m_transient_allocations.emplace_back();
+        if ( cached_allocation.is_texture )
+        {
+            auto transient_it = m_transient_textures.find( cached_allocation.handle );
+            if ( !SE_ENSURE( transient_it != m_transient_textures.end() ) )
+                return false;
+            allocation.texture = transient_it->second.texture.get();
+        }
+        else
         {
-            SE_LOG_WARNING( Rendergraph, "External texture <%s> is added to the rendergraph but is not used in any pass!", ext_texture_entry.texture->GetName().c_str() );
+            auto transient_it = m_transient_buffers.find( cached_allocation.handle );
+            if ( !SE_ENSURE( transient_it != m_transient_buffers.end() ) )
+                return false;
+            allocation.buffer = transient_it->second.buffer.get();
+        }
+        allocation.first_pass = cached_allocation.first_pass;
+        allocation.last_pass = cached_allocation.last_pass;
+        allocation.heap = cached_allocation.heap;
+        allocation.offset = cached_allocation.offset;
+        allocation.size = cached_allocation.size;
+        if ( cached_allocation.aliased_handle != RGCompiledPlan::NoResource )
+            allocation.aliased_resource = resources[cached_allocation.aliased_handle];
+    }
+
+    m_transient_stats = plan.transient_stats;
+    if ( GetRHI().SupportsPlacedResources() )
+    {
+        if ( !CreateTransientHeaps( plan.heap_sizes ) )
+            return false;
+    }
+    else
+    {
+        m_transient_heaps.clear();
+    }
+
+    CreateTransientRHIResources();
+
+    for ( const auto& [handle, entry] : m_transient_textures )
+        rhi_textures[handle] = entry.texture->GetRHITexture();
+
+    if ( rg_logTransientResources.GetValue() > 0 )
+    {
+        LogTransientResources();
+    }
+
+    // 2. Schedule with patched textures
+    auto patch_barriers = [&rhi_textures]( const std::vector<RGCompiledPlan::Barrier>& cached_barriers, std::vector<RHITextureBarrier>& barriers )
+    {
+        barriers.clear();
+        barriers.reserve( cached_barriers.size() );
+        for ( const RGCompiledPlan::Barrier& cached_barrier : cached_barriers )
+        {
+            if ( !SE_ENSURE( cached_barrier.texture_handle < rhi_textures.size() && rhi_textures[cached_barrier.texture_handle] != nullptr ) )
+                return false;
+
+            RHITextureBarrier& barrier = barriers.emplace_back( cached_barrier.barrier );
+            barrier.texture = rhi_textures[cached_barrier.texture_handle];
         }
+        return true;
+    };
+
+    for ( size_t pass_idx = 0; pass_idx < m_passes.size(); ++pass_idx )
+    {
+        RGPass& pass = *m_passes[pass_idx];
+        const RGCompiledPlan::Pass& cached_pass = plan.passes[pass_idx];
+
+        pass.m_scheduled_queue = cached_pass.scheduled_queue;
+        pass.m_begins_submission = cached_pass.begins_submission;
+        pass.m_culled = cached_pass.culled;
+        pass.m_pass_start_memory_barrier = cached_pass.start_memory_barrier;
+        if ( !patch_barriers( cached_pass.start_barriers, pass.m_pass_start_texture_barriers ) )
+            return false;
+    }
+
+    m_submissions.resize( plan.submissions.size() );
+    for ( size_t submission_idx = 0; submission_idx < m_submissions.size(); ++submission_idx )
+    {
+        RendergraphSubmission& submission = m_submissions[submission_idx];
+        const RGCompiledPlan::Submission& cached_submission = plan.submissions[submission_idx];
+
+        submission.passes.clear();
+        for ( uint32_t pass_idx : cached_submission.passes )
+            submission.passes.emplace_back( m_passes[pass_idx].get() );
+
+        if ( !patch_barriers( cached_submission.end_barriers, submission.end_barriers ) )
+            return false;
 
-        RHITextureLayout required_first_layout =
-            ( ext_texture_entry.first_usage == RGTextureUsage::Undefined )
-                ? tex_desc.initial_layout
-                : RGUsageToLayout( ext_texture_entry.first_usage );
+        submission.type = cached_submission.type;
+        submission.wait_submissions = cached_submission.wait_submissions;
+    }
+
+    m_schedule_stats = plan.schedule_stats;
+
+    return true;
+}
+
+void Rendergraph::StoreCompiledPlan( uint64_t key )
+{
+    // Barriers only know RHI textures. Graphs that register the same RHI texture twice can't be mapped back to handles, so they are not cached
+    std::unordered_map<const RHITexture*, uint64_t> texture_handles;
+    for ( const auto& [handle, entry] : m_external_textures )
+    {
+        if ( !texture_handles.try_emplace( entry.texture->GetDesc().rhi_texture, handle ).second )
+            return;
+    }
+    for ( const auto& [handle, entry] : m_transient_textures )
+    {
+        if ( entry.texture->GetRHITexture() != nullptr && !texture_handles.try_emplace( entry.texture->GetRHITexture(), handle ).second )
+            return;
+    }
 
-        if ( required_first_layout != tex_desc.initial_layout )
+    auto store_barriers = [&texture_handles]( const std::vector<RHITextureBarrier>& barriers, std::vector<RGCompiledPlan::Barrier>& cached_barriers )
+    {
+        cached_barriers.reserve( barriers.size() );
+        for ( const RHITextureBarrier& barrier : barriers )
         {
-            auto& barrier = initial_barriers.emplace_back();
-            barrier.layout_src = tex_desc.initial_layout;
-            barrier.layout_dst = required_first_layout;
-            barrier.texture = tex_desc.rhi_texture;
+            auto handle_it = texture_handles.find( barrier.texture );
+            if ( handle_it == texture_handles.end() )
+                return false;
+
+            RGCompiledPlan::Barrier& cached_barrier = cached_barriers.emplace_back();
+            cached_barrier.texture_handle = handle_it->second;
+            cached_barrier.barrier = barrier;
+            cached_barrier.barrier.texture = nullptr;
         }
+        return true;
+    };
+
+    auto plan = std::make_unique<RGCompiledPlan>();
+    plan->key = key;
+    plan->last_used = m_compile_count;
+    plan->structure = m_structure;
+
+    std::unordered_map<const RGPass*, uint32_t> pass_indices;
+    plan->passes.resize( m_passes.size() );
+    for ( uint32_t pass_idx = 0; pass_idx < uint32_t( m_passes.size() ); ++pass_idx )
+    {
+        const RGPass& pass = *m_passes[pass_idx];
+        RGCompiledPlan::Pass& cached_pass = plan->passes[pass_idx];
+
+        cached_pass.scheduled_queue = pass.m_scheduled_queue;
+        cached_pass.begins_submission = pass.m_begins_submission;
+        cached_pass.culled = pass.m_culled;
+        cached_pass.start_memory_barrier = pass.m_pass_start_memory_barrier;
+        if ( !store_barriers( pass.m_pass_start_texture_barriers, cached_pass.start_barriers ) )
+            return;
+
+        pass_indices[&pass] = pass_idx;
+    }
+
+    plan->submissions.resize( m_submissions.size() );
+    for ( size_t submission_idx = 0; submission_idx < m_submissions.size(); ++submission_idx )
+    {
+        const RendergraphSubmission& submission = m_submissions[submission_idx];
+        RGCompiledPlan::Submission& cached_submission = plan->submissions[submission_idx];
+
+        for ( const RGPass* pass : submission.passes )
+            cached_submission.passes.emplace_back( pass_indices[pass] );
+
+        if ( !store_barriers( submission.end_barriers, cached_submission.end_barriers ) )
+            return;
 
-        RHITextureLayout required_last_layout =
-            ( ext_texture_entry.last_usage == RGTextureUsage::Undefined )
-                ? tex_desc.initial_layout
-                : RGUsageToLayout( ext_texture_entry.last_usage );
+        cached_submission.type = submission.type;
+        cached_submission.wait_submissions = submission.wait_submissions;
+    }
+
+    for ( const RGTransientResourceAllocation& allocation : m_transient_allocations )
+    {
+        RGCompiledPlan::TransientAllocation& cached_allocation = plan->transient_allocations.emplace_back();
+        cached_allocation.handle = GetAllocatedResource( allocation )->GetHandle();
+        cached_allocation.is_texture = allocation.texture != nullptr;
+        cached_allocation.first_pass = allocation.first_pass;
+        cached_allocation.last_pass = allocation.last_pass;
+        cached_allocation.heap = allocation.heap;
+        cached_allocation.offset = allocation.offset;
+        cached_allocation.size = allocation.size;
+        if ( allocation.aliased_resource != nullptr )
+            cached_allocation.aliased_handle = allocation.aliased_resource->GetHandle();
+    }
+
+    if ( GetRHI().SupportsPlacedResources() )
+        plan->heap_sizes = m_transient_allocator_result.heap_sizes;
+
+    plan->transient_stats = m_transient_stats;
+    plan->schedule_stats = m_schedule_stats;
+
+    auto same_key_it = std::find_if( m_compiled_plans.begin(), m_compiled_plans.end(),
+        [key]( const auto& cached_plan ) { return cached_plan->key == key; } );
+    if ( same_key_it != m_compiled_plans.end() )
+    {
+        *same_key_it = std::move( plan );
+    }
+    else if ( m_compiled_plans.size() < MaxCompiledPlans )
+    {
+        m_compiled_plans.emplace_back( std::move( plan ) );
+    }
+    else
+    {
+        auto lru_it = std::min_element( m_compiled_plans.begin(), m_compiled_plans.end(),
+            []( const auto& a, const auto& b ) { return a->last_used < b->last_used; } );
+        *lru_it = std::move( plan );
+    }
+}
+
+namespace
+{
+    constexpr uint32_t NoPass = uint32_t( -1 );
+    constexpr uint32_t NoSubmission = uint32_t( -1 );
+    constexpr size_t QueueCount = size_t( RHI::QueueType::Count );
+
+    // For every queue, index + 1 of its last submission known to be completed at some point of execution. 0 if none
+    using QueueClock = std::array<uint32_t, QueueCount>;
+
+    // Positions of accesses and barriers on every queue, as pass indices. An access is synchronized with later accesses on the same queue
+    // by a memory barrier or, for textures, by a barrier of the texture itself recorded at a later position.
+    // Accesses on different queues are synchronized by semaphores
+    using QueuePositions = std::array<int64_t, QueueCount>;
+    constexpr int64_t NotAccessed = -2;
+    constexpr int64_t PreviousFrame = -1; // external resources may be written by the previous frame
+
+    QueuePositions MakeQueuePositions( int64_t position )
+    {
+        QueuePositions positions;
+        positions.fill( position );
+        return positions;
+    }
+
+    struct RGResourceState
+    {
+        // All earlier uses of a resource happen before its last writer
+        uint32_t last_writer = NoPass;
+        std::vector<uint32_t> readers; // since the last write
+        bool used = false;
+
+        int64_t last_use = NotAccessed; // on any queue
+        QueuePositions last_write = MakeQueuePositions( NotAccessed );
+        QueuePositions last_read = MakeQueuePositions( NotAccessed );
+        QueuePositions last_texture_barrier = MakeQueuePositions( NotAccessed );
+
+        // textures only
+        const RHITexture* rhi_texture = nullptr;
+        RHITextureLayout layout = RHITextureLayout::Undefined;
+        RHI::QueueType owner = RHI::QueueType::Count; // Count if nobody owns the contents yet
+        uint32_t owner_submission = NoSubmission; // last submission using the texture on the owner queue
+    };
+
+    struct RGResourceUse
+    {
+        RGResourceState* state = nullptr;
+        uint64_t handle = 0;
+        bool is_texture = false;
+        bool is_write = false;
+        bool has_barrier = false; // texture barrier at the start of the pass
+        RHITextureLayout layout = RHITextureLayout::Undefined;
+    };
+
+    bool IsWriteUsage( RGBufferUsage usage )
+    {
+        return usage == RGBufferUsage::ShaderReadWrite || usage == RGBufferUsage::ShaderWriteOnly;
+    }
+
+    void RequireSubmission( std::array<uint32_t, QueueCount>& required, RHI::QueueType queue, uint32_t submission )
+    {
+        uint32_t& entry = required[size_t( queue )];
+        if ( entry == NoSubmission || entry < submission )
+            entry = submission;
+    }
+}
 
-        if ( required_last_layout != tex_desc.final_layout )
+// Passes are kept if they write external resources, have untracked accesses or write something a kept pass uses later.
+// Walking backwards visits all users of a resource before its writers
+void Rendergraph::CullPasses()
+{
+    const bool allow_culling = rg_cullPasses.GetValue() > 0;
+
+    std::unordered_set<uint64_t> needed_resources;
+    for ( auto pass_it = m_passes.rbegin(); pass_it != m_passes.rend(); ++pass_it )
+    {
+        RGPass& pass = **pass_it;
+
+        bool keep = !allow_culling || pass.HasUntrackedAccesses();
+        for ( const auto& [handle, used_texture] : pass.m_used_textures )
+        {
+            if ( used_texture.usage != RGTextureUsage::ShaderRead && ( used_texture.texture->IsExternal() || needed_resources.contains( handle ) ) )
+                keep = true;
+        }
+        for ( const auto& [handle, used_buffer] : pass.m_used_buffers )
         {
-            auto& barrier = m_final_barriers.emplace_back();
-            barrier.layout_src = required_last_layout;
-            barrier.layout_dst = tex_desc.final_layout;
-            barrier.texture = tex_desc.rhi_texture;
+            if ( IsWriteUsage( used_buffer.usage ) && ( m_external_buffers.contains( handle ) || needed_resources.contains( handle ) ) )
+                keep = true;
         }
 
-        current_layouts[handle] = required_first_layout;
+        pass.m_culled = !keep;
+        if ( !keep )
+            continue;
+
+        // contents written by earlier passes may be read, render targets may be loaded and buffers may be partially written
+        for ( const auto& [handle, used_texture] : pass.m_used_textures )
+            needed_resources.insert( handle );
+        for ( const auto& [handle, used_buffer] : pass.m_used_buffers )
+            needed_resources.insert( handle );
     }
+}
+
+// Passes are scheduled greedily in declaration order, which is a valid topological order of the dependency graph.
+// Every pass goes to the queue where it is estimated to finish first according to the cost hints. Cross-queue dependencies
+// are resolved with semaphores between submissions, waits already implied by earlier waits are skipped.
+// Textures are owned by one queue at a time, moving them to another queue requires a release barrier at the end of the submission
+// that used it last and an acquire barrier at the start of the pass. Buffers are assumed to be shared between queues.
+bool Rendergraph::ScheduleSubmissions()
+{
+    RHI& rhi = GetRHI();
+
+    m_submissions.clear();
+    m_schedule_stats = {};
 
-    // @todo - interface instead of raw friend access?
-    m_passes.front()->m_pass_start_texture_barriers = std::move( initial_barriers );
+    const uint32_t pass_count = uint32_t( m_passes.size() );
+    const uint64_t sync_cost = rg_queueSyncCost.GetValue();
 
-    // Build all other layout transitions
-    for ( size_t i = 1; i < m_passes.size(); i++ )
+    // 1. Initial resource states
+    std::unordered_map<uint64_t, RGResourceState> states;
+    for ( const auto& [handle, ext_texture_entry] : m_external_textures )
+    {
+        RGResourceState& state = states[handle];
+        state.rhi_texture = ext_texture_entry.texture->GetDesc().rhi_texture;
+        state.layout = ext_texture_entry.texture->GetDesc().initial_layout;
+        // external textures belong to the graphics queue between frames
+        state.owner = RHI::QueueType::Graphics;
+        state.last_use = PreviousFrame;
+        state.last_write[size_t( RHI::QueueType::Graphics )] = PreviousFrame;
+    }
+    for ( const auto& [handle, ext_buffer_entry] : m_external_buffers )
+    {
+        RGResourceState& state = states[handle];
+        state.last_use = PreviousFrame;
+        state.last_write[size_t( RHI::QueueType::Graphics )] = PreviousFrame;
+    }
+    for ( const auto& [handle, transient_texture_entry] : m_transient_textures )
     {
-        std::vector<RHITextureBarrier> pass_barriers;
+        // contents of transient textures are undefined on their first use, that also works as an aliasing barrier
+        states[handle].rhi_texture = transient_texture_entry.texture->GetRHITexture();
+    }
 
-        const auto& used_textures = m_passes[i]->m_used_textures;
+    // Transient resources that alias memory of earlier ones can't start until all users of the earlier ones are done
+    std::unordered_map<uint64_t, std::vector<uint64_t>> aliased_resources;
+    for ( const RGTransientResourceAllocation& allocation : m_transient_allocations )
+    {
+        if ( allocation.heap == TransientResourceAllocator::InvalidHeap )
+            continue;
 
-        for ( const auto& used_texture : used_textures )
+        for ( const RGTransientResourceAllocation& other : m_transient_allocations )
         {
-            auto curr_layout_it = current_layouts.find( used_texture.first );
+            if ( other.heap != allocation.heap || other.last_pass >= allocation.first_pass )
+                continue;
+
+            const bool memory_overlaps = other.offset < allocation.offset + allocation.size && allocation.offset < other.offset + other.size;
+            if ( memory_overlaps )
+                aliased_resources[GetAllocatedResource( allocation )->GetHandle()].emplace_back( GetAllocatedResource( other )->GetHandle() );
+        }
+    }
+
+    // 2. Submissions
+    std::vector<QueueClock> clocks; // one per submission
+    std::array<uint32_t, QueueCount> open_submissions;
+    std::array<uint32_t, QueueCount> last_submissions;
+    open_submissions.fill( NoSubmission );
+    last_submissions.fill( NoSubmission );
+
+    auto begin_submission = [&]( RHI::QueueType queue ) -> uint32_t
+    {
+        const size_t queue_idx = size_t( queue );
+        const uint32_t submission_idx = uint32_t( m_submissions.size() );
+
+        m_submissions.emplace_back().type = queue;
+
+        QueueClock clock = ( last_submissions[queue_idx] != NoSubmission ) ? clocks[last_submissions[queue_idx]] : QueueClock{};
+        clock[queue_idx] = submission_idx + 1;
+        clocks.emplace_back( clock );
+
+        open_submissions[queue_idx] = submission_idx;
+        last_submissions[queue_idx] = submission_idx;
+        return submission_idx;
+    };
 
-            RHITextureLayout curr_layout = RHITextureLayout::Undefined;
-            RHITextureLayout new_layout = RGUsageToLayout( used_texture.second.usage );
-            if ( curr_layout_it == current_layouts.end() )
+    // Returns the submission on the queue that starts after all required submissions on other queues are completed
+    auto sync_queue = [&]( RHI::QueueType queue, const std::array<uint32_t, QueueCount>& required ) -> uint32_t
+    {
+        const size_t queue_idx = size_t( queue );
+        const QueueClock current = ( last_submissions[queue_idx] != NoSubmission ) ? clocks[last_submissions[queue_idx]] : QueueClock{};
+
+        std::array<size_t, QueueCount> wait_queues = {};
+        size_t wait_queue_count = 0;
+        for ( size_t other = 0; other < QueueCount; ++other )
+        {
+            if ( other == queue_idx || required[other] == NoSubmission || current[other] > required[other] )
+                continue;
+
+            // semaphores are signaled at the end of a submission, nothing can be added to the required one after that
+            if ( open_submissions[other] == required[other] )
+                open_submissions[other] = NoSubmission;
+            wait_queues[wait_queue_count++] = other;
+        }
+
+        // skip waits that are implied by waits on other queues
+        for ( size_t i = 0; i < wait_queue_count; )
+        {
+            bool implied = false;
+            for ( size_t j = 0; j < wait_queue_count && !implied; ++j )
+                implied = ( i != j ) && clocks[required[wait_queues[j]]][wait_queues[i]] > required[wait_queues[i]];
+
+            if ( implied )
+                wait_queues[i] = wait_queues[--wait_queue_count];
+            else
+                ++i;
+        }
+
+        if ( wait_queue_count == 0 )
+            return ( open_submissions[queue_idx] != NoSubmission ) ? open_submissions[queue_idx] : begin_submission( queue );
+
+        // waits are done at the start of a submission
+        const uint32_t submission_idx = begin_submission( queue );
+        for ( size_t i = 0; i < wait_queue_count; ++i )
+        {
+            const uint32_t wait_submission = required[wait_queues[i]];
+            m_submissions[submission_idx].wait_submissions.emplace_back( wait_submission );
+
+            for ( size_t clock_idx = 0; clock_idx < QueueCount; ++clock_idx )
+                clocks[submission_idx][clock_idx] = std::max( clocks[submission_idx][clock_idx], clocks[wait_submission][clock_idx] );
+        }
+        return submission_idx;
+    };
+
+    // 3. Passes
+    std::vector<uint64_t> pass_finish( pass_count, 0 );
+    std::vector<uint64_t> pass_chain( pass_count, 0 ); // longest dependency chain ending with the pass
+    std::vector<uint32_t> pass_submissions( pass_count, NoSubmission );
+    std::array<uint64_t, QueueCount> queue_finish = {};
+
+    const bool allow_async_queues = rg_asyncQueues.GetValue() > 0;
+    const bool optimize_barriers = rg_optimizeBarriers.GetValue() > 0;
+
+    QueuePositions last_memory_barrier = MakeQueuePositions( PreviousFrame );
+    QueuePositions last_untracked_pass = MakeQueuePositions( NotAccessed );
+    std::array<uint32_t, QueueCount> last_barrier_batch; // pass that starts with the last barrier batch on the queue
+    last_barrier_batch.fill( NoPass );
+
+    std::vector<RGResourceUse> uses;
+    std::vector<uint32_t> deps;
+    std::vector<uint32_t> best_deps;
+    std::vector<RHITextureBarrier> pass_barriers;
+    for ( uint32_t pass_idx = 0; pass_idx < pass_count; ++pass_idx )
+    {
+        RGPass& pass = *m_passes[pass_idx];
+
+        pass.m_pass_start_texture_barriers.clear();
+        pass.m_pass_start_memory_barrier = false;
+        if ( pass.m_culled )
+        {
+            m_schedule_stats.culled_pass_count++;
+            continue;
+        }
+
+        uses.clear();
+        for ( const auto& [handle, used_texture] : pass.m_used_textures )
+        {
+            auto state_it = states.find( handle );
+            if ( !SE_ENSURE( state_it != states.end() ) )
+                return false;
+
+            RGResourceUse& use = uses.emplace_back();
+            use.state = &state_it->second;
+            use.handle = handle;
+            use.is_texture = true;
+            use.is_write = used_texture.usage != RGTextureUsage::ShaderRead;
+            use.layout = RGUsageToLayout( used_texture.usage );
+        }
+        for ( const auto& [handle, used_buffer] : pass.m_used_buffers )
+        {
+            RGResourceUse& use = uses.emplace_back();
+            use.state = &states[handle];
+            use.handle = handle;
+            use.is_write = IsWriteUsage( used_buffer.usage );
+        }
+
+        // Graphics queue can run anything
+        std::array<RHI::QueueType, 2> candidates = { pass.m_queue_type, RHI::QueueType::Graphics };
+        size_t candidate_count = 2;
+        if ( pass.m_queue_type == RHI::QueueType::Graphics || !allow_async_queues || !rhi.IsQueueSupported( pass.m_queue_type ) )
+        {
+            candidates[0] = RHI::QueueType::Graphics;
+            candidate_count = 1;
+        }
+
+        // Pick the queue where the pass finishes first. Requested queue wins ties
+        RHI::QueueType best_queue = RHI::QueueType::Count;
+        uint64_t best_finish = 0;
+        for ( size_t candidate_idx = 0; candidate_idx < candidate_count; ++candidate_idx )
+        {
+            const RHI::QueueType queue = candidates[candidate_idx];
+
+            deps.clear();
+            for ( const RGResourceUse& use : uses )
             {
-                curr_layout = new_layout;
-                current_layouts[used_texture.first] = new_layout;
+                const RGResourceState& state = *use.state;
+                const bool changes_owner = use.is_texture && state.owner != RHI::QueueType::Count && state.owner != queue;
+                const bool exclusive = use.is_write || changes_owner || ( use.is_texture && state.layout != use.layout );
+
+                if ( state.last_writer != NoPass )
+                    deps.emplace_back( state.last_writer );
+                if ( exclusive )
+                    deps.insert( deps.end(), state.readers.begin(), state.readers.end() );
+
+                if ( !state.used )
+                {
+                    auto aliased_it = aliased_resources.find( use.handle );
+                    if ( aliased_it != aliased_resources.end() )
+                    {
+                        for ( uint64_t aliased_handle : aliased_it->second )
+                        {
+                            const RGResourceState& aliased_state = states[aliased_handle];
+                            if ( aliased_state.last_writer != NoPass )
+                                deps.emplace_back( aliased_state.last_writer );
+                            deps.insert( deps.end(), aliased_state.readers.begin(), aliased_state.readers.end() );
+                        }
+                    }
+                }
             }
-            else
+            std::sort( deps.begin(), deps.end() );
+            deps.erase( std::unique( deps.begin(), deps.end() ), deps.end() );
+
+            uint64_t start = queue_finish[size_t( queue )];
+            for ( uint32_t dep : deps )
             {
-                curr_layout = curr_layout_it->second;
-                curr_layout_it->second = new_layout;
+                const bool cross_queue = m_passes[dep]->m_scheduled_queue != queue;
+                start = std::max( start, pass_finish[dep] + ( cross_queue ? sync_cost : 0 ) );
             }
 
-            if ( curr_layout != new_layout )
+            const uint64_t finish = start + pass.m_cost_hint;
+            if ( best_queue == RHI::QueueType::Count || finish < best_finish )
             {
-                auto& barrier = pass_barriers.emplace_back();
-                barrier.layout_src = curr_layout;
-                barrier.layout_dst = new_layout;
-                barrier.texture = used_texture.second.texture->GetRHITexture();
+                best_queue = queue;
+                best_finish = finish;
+                best_deps.swap( deps );
             }
         }
 
-        m_passes[i]->m_pass_start_texture_barriers = std::move( pass_barriers );
+        const RHI::QueueType queue = best_queue;
+        pass.m_scheduled_queue = queue;
+        pass_finish[pass_idx] = best_finish;
+        queue_finish[size_t( queue )] = best_finish;
+
+        std::array<uint32_t, QueueCount> required;
+        required.fill( NoSubmission );
+        for ( uint32_t dep : best_deps )
+        {
+            pass_chain[pass_idx] = std::max( pass_chain[pass_idx], pass_chain[dep] );
+            if ( m_passes[dep]->m_scheduled_queue != queue )
+                RequireSubmission( required, m_passes[dep]->m_scheduled_queue, pass_submissions[dep] );
+        }
+        pass_chain[pass_idx] += pass.m_cost_hint;
+
+        // Ownership transfers. Texture barriers are the same on both queues
         pass_barriers.clear();
+        for ( RGResourceUse& use : uses )
+        {
+            RGResourceState& state = *use.state;
+            if ( !use.is_texture || state.owner == RHI::QueueType::Count || state.owner == queue )
+                continue;
+
+            if ( state.owner_submission == NoSubmission )
+            {
+                // not used in this frame yet, release right away
+                const size_t owner_idx = size_t( state.owner );
+                state.owner_submission = ( open_submissions[owner_idx] != NoSubmission ) ? open_submissions[owner_idx] : begin_submission( state.owner );
+            }
+
+            RHITextureBarrier& barrier = pass_barriers.emplace_back();
+            barrier.texture = state.rhi_texture;
+            barrier.layout_src = state.layout;
+            barrier.layout_dst = use.layout;
+            barrier.queue_src = state.owner;
+            barrier.queue_dst = queue;
+            use.has_barrier = true;
+
+            m_submissions[state.owner_submission].end_barriers.emplace_back( barrier );
+            RequireSubmission( required, state.owner, state.owner_submission );
+
+            state.layout = use.layout;
+            state.owner = queue;
+            m_schedule_stats.ownership_transfer_count++;
+        }
+
+        const uint32_t submission_idx = sync_queue( queue, required );
+        RendergraphSubmission& submission = m_submissions[submission_idx];
+        pass.m_begins_submission = submission.passes.empty() && !submission.wait_submissions.empty();
+        submission.passes.emplace_back( &pass );
+        pass_submissions[pass_idx] = submission_idx;
+
+        // Layout transitions
+        for ( RGResourceUse& use : uses )
+        {
+            RGResourceState& state = *use.state;
+            if ( !use.is_texture )
+                continue;
+
+            if ( state.layout != use.layout )
+            {
+                RHITextureBarrier& barrier = pass_barriers.emplace_back();
+                barrier.texture = state.rhi_texture;
+                barrier.layout_src = state.layout;
+                barrier.layout_dst = use.layout;
+                state.layout = use.layout;
+                use.has_barrier = true;
+            }
+            state.owner = queue;
+            state.owner_submission = submission_idx;
+        }
+
+        // Memory hazards with earlier passes on the same queue. Barriers can be recorded as early as right after the last use of
+        // everything they synchronize, so they are merged into the last barrier batch of the submission if it is late enough
+        const size_t queue_idx = size_t( queue );
+        const int64_t position = pass_idx;
+
+        auto is_synchronized = [&]( const RGResourceState& state, int64_t access, bool is_texture )
+        {
+            return last_memory_barrier[queue_idx] > access || ( is_texture && state.last_texture_barrier[queue_idx] > access );
+        };
+
+        bool memory_barrier = !optimize_barriers || pass.HasUntrackedAccesses() || last_untracked_pass[queue_idx] >= last_memory_barrier[queue_idx];
+        int64_t hoist_limit = ( !optimize_barriers || pass.HasUntrackedAccesses() ) ? position : last_untracked_pass[queue_idx] + 1;
+        for ( const RGResourceUse& use : uses )
+        {
+            const RGResourceState& state = *use.state;
+            const bool hazard = !is_synchronized( state, state.last_write[queue_idx], use.is_texture )
+                || ( use.is_write && !is_synchronized( state, state.last_read[queue_idx], use.is_texture ) );
+
+            if ( use.has_barrier || hazard )
+                hoist_limit = std::max( hoist_limit, state.last_use + 1 );
+            if ( !use.has_barrier && hazard )
+                memory_barrier = true;
+
+            if ( state.used )
+                continue;
+
+            // memory of aliased resources is reused on the first use. Transitions from the undefined layout don't wait for earlier accesses
+            auto aliased_it = aliased_resources.find( use.handle );
+            if ( aliased_it == aliased_resources.end() )
+                continue;
+
+            for ( uint64_t aliased_handle : aliased_it->second )
+            {
+                const RGResourceState& aliased_state = states[aliased_handle];
+                hoist_limit = std::max( hoist_limit, aliased_state.last_use + 1 );
+                if ( !is_synchronized( aliased_state, aliased_state.last_write[queue_idx], false ) || !is_synchronized( aliased_state, aliased_state.last_read[queue_idx], false ) )
+                    memory_barrier = true;
+            }
+        }
+
+        int64_t barrier_position = position;
+        if ( !pass_barriers.empty() || memory_barrier )
+        {
+            const uint32_t batch_pass = last_barrier_batch[queue_idx];
+            const bool merge = optimize_barriers && batch_pass != NoPass && int64_t( batch_pass ) >= hoist_limit && pass_submissions[batch_pass] == submission_idx;
+
+            RGPass* batch_owner = &pass;
+            if ( merge )
+            {
+                batch_owner = m_passes[batch_pass].get();
+                barrier_position = batch_pass;
+                m_schedule_stats.merged_barrier_batch_count++;
+            }
+            else
+            {
+                last_barrier_batch[queue_idx] = pass_idx;
+            }
+
+            batch_owner->m_pass_start_texture_barriers.insert( batch_owner->m_pass_start_texture_barriers.end(), pass_barriers.begin(), pass_barriers.end() );
+            batch_owner->m_pass_start_memory_barrier |= memory_barrier;
+            if ( memory_barrier )
+                last_memory_barrier[queue_idx] = std::max( last_memory_barrier[queue_idx], barrier_position );
+        }
+
+        if ( pass.HasUntrackedAccesses() )
+            last_untracked_pass[queue_idx] = position;
+
+        // Hazard tracking
+        for ( const RGResourceUse& use : uses )
+        {
+            RGResourceState& state = *use.state;
+            if ( use.has_barrier )
+                state.last_texture_barrier[queue_idx] = barrier_position;
+
+            if ( use.is_write )
+            {
+                state.last_writer = pass_idx;
+                state.readers.clear();
+                state.last_write[queue_idx] = position;
+            }
+            else
+            {
+                state.readers.emplace_back( pass_idx );
+                state.last_read[queue_idx] = position;
+            }
+            state.last_use = position;
+            state.used = true;
+        }
+
+        m_schedule_stats.pass_count[size_t( queue )]++;
+        m_schedule_stats.serial_cost += pass.m_cost_hint;
+        m_schedule_stats.scheduled_cost = std::max( m_schedule_stats.scheduled_cost, best_finish );
+        m_schedule_stats.critical_path = std::max( m_schedule_stats.critical_path, pass_chain[pass_idx] );
     }
 
-    // Make submissions
-    m_submissions.resize( 1 );
+    // 4. External textures go back to the graphics queue in their final layouts
+    std::vector<RHITextureBarrier> final_barriers;
+    final_barriers.reserve( m_external_textures.size() );
+
+    std::array<uint32_t, QueueCount> required;
+    required.fill( NoSubmission );
+    for ( const auto& [handle, ext_texture_entry] : m_external_textures )
     {
-        auto& submission = m_submissions.front();
-        submission.passes.reserve( m_passes.size() );
-        for ( const auto& pass : m_passes )
+        const RGExternalTextureDesc& tex_desc = ext_texture_entry.texture->GetDesc();
+        const RGResourceState& state = states[handle];
+
+        if ( ext_texture_entry.first_usage == RGTextureUsage::Undefined )
         {
-            submission.passes.emplace_back( pass.get() );
+            // we still need to correctly transition it from initial layout to final layout. Textures used only by culled passes are fine
+            const bool used_by_culled_pass = std::any_of( m_passes.begin(), m_passes.end(), [handle]( const auto& pass ) { return pass->m_used_textures.contains( handle ); } );
+            if ( !used_by_culled_pass )
+                SE_LOG_WARNING( Rendergraph, "External texture <%s> is added to the rendergraph but is not used in any pass!", ext_texture_entry.texture->GetName().c_str() );
         }
-        submission.type = RHI::QueueType::Graphics;
+
+        if ( state.owner == RHI::QueueType::Graphics && state.layout == tex_desc.final_layout )
+            continue;
+
+        RHITextureBarrier& barrier = final_barriers.emplace_back();
+        barrier.texture = tex_desc.rhi_texture;
+        barrier.layout_src = state.layout;
+        barrier.layout_dst = tex_desc.final_layout;
+
+        if ( state.owner != RHI::QueueType::Graphics )
+        {
+            barrier.queue_src = state.owner;
+            barrier.queue_dst = RHI::QueueType::Graphics;
+
+            m_submissions[state.owner_submission].end_barriers.emplace_back( barrier );
+            RequireSubmission( required, state.owner, state.owner_submission );
+            m_schedule_stats.ownership_transfer_count++;
+        }
+    }
+
+    // 5. Frame fence is taken from the last submission, so it has to wait for all other queues
+    for ( size_t queue_idx = 0; queue_idx < QueueCount; ++queue_idx )
+    {
+        if ( queue_idx != size_t( RHI::QueueType::Graphics ) && last_submissions[queue_idx] != NoSubmission )
+            RequireSubmission( required, RHI::QueueType( queue_idx ), last_submissions[queue_idx] );
+    }
+
+    if ( !m_submissions.empty() || !final_barriers.empty() )
+    {
+        const uint32_t final_submission = sync_queue( RHI::QueueType::Graphics, required );
+        if ( !SE_ENSURE( final_submission + 1 == m_submissions.size() ) )
+            return false;
+
+        auto& end_barriers = m_submissions[final_submission].end_barriers;
+        end_barriers.insert( end_barriers.end(), final_barriers.begin(), final_barriers.end() );
+    }
+
+    m_schedule_stats.submission_count = m_submissions.size();
+    for ( const RendergraphSubmission& submission : m_submissions )
+        m_schedule_stats.semaphore_count += submission.wait_submissions.size();
+
+    for ( const auto& pass : m_passes )
+    {
+        if ( pass->m_pass_start_texture_barriers.empty() && !pass->m_pass_start_memory_barrier )
+            continue;
+
+        m_schedule_stats.barrier_batch_count++;
+        m_schedule_stats.texture_barrier_count += pass->m_pass_start_texture_barriers.size();
+        m_schedule_stats.memory_barrier_count += pass->m_pass_start_memory_barrier ? 1 : 0;
     }
 
     return true;
 }
 
-RHIFence Rendergraph::Submit( const RGSubmitInfo& info )
+bool Rendergraph::RecordPasses( ITaskScheduler& scheduler )
 {
-    if ( m_submissions.empty() && !m_final_barriers.empty() )
+    std::vector<RGPass*> passes;
+    for ( const auto& pass : m_passes )
     {
-        // We still need one submission for barriers
-        m_submissions.emplace_back();
+        if ( !pass->m_record_callback || pass->m_culled )
+            continue;
+
+        // lists of other passes can't be borrowed, there is no telling which one is recorded first
+        if ( !SE_ENSURE( pass->m_cmd_lists.empty() && !pass->m_borrowed_list ) )
+            return false;
+
+        passes.emplace_back( pass.get() );
     }
 
-    m_submissions.back().end_barriers = std::move( m_final_barriers );
+    // no more than GetNumThreads() tasks run at the same time
+    while ( m_record_contexts.size() < scheduler.GetNumThreads() )
+    {
+        m_record_contexts.emplace_back( std::make_unique<RGRecordContext>() );
+    }
 
-    if ( m_submissions.size() > 1 )
+    m_free_record_contexts.clear();
+    for ( const auto& ctx : m_record_contexts )
     {
-        // need to synchronize multiple submissions
-        NOTIMPL;
+        m_free_record_contexts.emplace_back( ctx.get() );
     }
 
-    RHIFence last_fence = {};
+    RHI& rhi = GetRHI();
 
-    for ( const auto& submission : m_submissions )
+    scheduler.ParallelFor( passes.size(), [&]( size_t task_idx )
     {
-        RHI::SubmitInfo rhi_submission = {};
-        size_t cmd_lists_num = 0;
-        for ( const auto* pass : submission.passes )
+        RGRecordContext* ctx = nullptr;
         {
-            cmd_lists_num += pass->m_cmd_lists.size();
+            std::scoped_lock lock( m_record_contexts_lock );
+            ctx = m_free_record_contexts.back();
+            m_free_record_contexts.pop_back();
         }
 
-        if ( !submission.end_barriers.empty() )
+        RGPass& pass = *passes[task_idx];
+
+        RHICommandList* cmd_list = rhi.GetCommandList( pass.GetQueueType() );
+        cmd_list->Begin();
+        pass.AddCommandList( *cmd_list );
+        pass.m_record_callback( *cmd_list, *ctx );
+        cmd_list->End();
+        pass.EndPass();
+
+        std::scoped_lock lock( m_record_contexts_lock );
+        m_free_record_contexts.emplace_back( ctx );
+    } );
+
+    return true;
+}
+
+RHIFence Rendergraph::Submit( const RGSubmitInfo& info )
+{
+    RHI& rhi = GetRHI();
+
+    // 1. One semaphore per cross-queue wait
+    size_t semaphore_count = 0;
+    for ( const auto& submission : m_submissions )
+    {
+        semaphore_count += submission.wait_submissions.size();
+    }
+
+    while ( m_queue_semaphores.size() < semaphore_count )
+    {
+        m_queue_semaphores.emplace_back( rhi.CreateGPUSemaphore() );
+    }
+
+    std::vector<std::vector<RHISemaphore*>> semaphores_to_wait( m_submissions.size() );
+    std::vector<std::vector<RHISemaphore*>> semaphores_to_signal( m_submissions.size() );
+    size_t next_semaphore = 0;
+    for ( size_t i = 0; i < m_submissions.size(); ++i )
+    {
+        for ( uint32_t wait_submission : m_submissions[i].wait_submissions )
         {
-            cmd_lists_num++;
+            RHISemaphore* semaphore = m_queue_semaphores[next_semaphore++].get();
+            semaphores_to_wait[i].emplace_back( semaphore );
+            semaphores_to_signal[wait_submission].emplace_back( semaphore );
         }
+    }
+
+    // 2. Submit in order, signals are always submitted before waits
+    auto first_graphics_submission = std::find_if( m_submissions.begin(), m_submissions.end(),
+        []( const RendergraphSubmission& submission ) { return submission.type == RHI::QueueType::Graphics; } );
+
+    RHIFence last_fence = {};
 
-        std::vector<RHICommandList*> cmd_lists;
-        cmd_lists.reserve( cmd_lists_num );
+    std::vector<RHICommandList*> cmd_lists;
+    std::vector<RHIPipelineStageFlags> stages_to_wait;
+    for ( size_t i = 0; i < m_submissions.size(); ++i )
+    {
+        const auto& submission = m_submissions[i];
+
+        cmd_lists.clear();
         for ( const auto* pass : submission.passes )
         {
+            // barriers of later passes may have been merged into a pass that was not recorded
+            if ( pass->m_cmd_lists.empty() && !pass->m_borrowed_list
+                && ( !pass->m_pass_start_texture_barriers.empty() || pass->m_pass_start_memory_barrier ) )
+            {
+                RHICommandList* barriers_cmd_list = rhi.GetCommandList( submission.type );
+                barriers_cmd_list->Begin();
+                pass->AddPassBeginCommands( *barriers_cmd_list );
+                barriers_cmd_list->End();
+                cmd_lists.emplace_back( barriers_cmd_list );
+            }
+
             cmd_lists.insert( cmd_lists.end(), pass->m_cmd_lists.begin(), pass->m_cmd_lists.end() );
         }
 
-        if ( !submission.end_barriers.empty() )
+        // submissions without passes still wait and signal, so they need a list too
+        if ( !submission.end_barriers.empty() || cmd_lists.empty() )
         {
-            RHICommandList* end_barriers_cmd_list = GetRHI().GetCommandList( submission.type );
+            RHICommandList* end_barriers_cmd_list = rhi.GetCommandList( submission.type );
             end_barriers_cmd_list->Begin();
-            end_barriers_cmd_list->TextureBarriers( submission.end_barriers.data(), submission.end_barriers.size() );
+            if ( !submission.end_barriers.empty() )
+                end_barriers_cmd_list->TextureBarriers( submission.end_barriers.data(), submission.end_barriers.size() );
             end_barriers_cmd_list->End();
             cmd_lists.emplace_back( end_barriers_cmd_list );
         }
 
+        auto& wait_semaphores = semaphores_to_wait[i];
+        stages_to_wait.assign( wait_semaphores.size(), RHIPipelineStageFlags::AllBits );
+        if ( first_graphics_submission - m_submissions.begin() == ptrdiff_t( i ) )
+        {
+            wait_semaphores.insert( wait_semaphores.end(), info.semaphores_to_wait, info.semaphores_to_wait + info.wait_semaphore_count );
+            stages_to_wait.insert( stages_to_wait.end(), info.stages_to_wait, info.stages_to_wait + info.wait_semaphore_count );
+        }
+
+        auto& signal_semaphores = semaphores_to_signal[i];
+        if ( i + 1 == m_submissions.size() && info.semaphore_to_signal != nullptr )
+        {
+            signal_semaphores.emplace_back( info.semaphore_to_signal );
+        }
+
+        RHI::SubmitInfo rhi_submission = {};
         rhi_submission.cmd_lists = cmd_lists.data();
         rhi_submission.cmd_list_count = cmd_lists.size();
+        rhi_submission.wait_semaphore_count = wait_semaphores.size();
+        rhi_submission.semaphores_to_wait = wait_semaphores.data();
+        rhi_submission.stages_to_wait = stages_to_wait.data();
+        rhi_submission.signal_semaphore_count = signal_semaphores.size();
+        rhi_submission.semaphores_to_signal = signal_semaphores.data();
 
-        rhi_submission.wait_semaphore_count = info.wait_semaphore_count;
-        rhi_submission.semaphores_to_wait = info.semaphores_to_wait;
-        rhi_submission.stages_to_wait = info.stages_to_wait;
-        rhi_submission.semaphore_to_signal = info.semaphore_to_signal;
-
-        last_fence = GetRHI().SubmitCommandLists( rhi_submission );
+        last_fence = rhi.SubmitCommandLists( rhi_submission );
     }
     return last_fence;
 }
 
 void Rendergraph::Reset()
 {
+    m_handle_generator = 0;
     m_passes.clear();
     m_submissions.clear();
     m_external_textures.clear();
-    m_final_barriers.clear();
+    m_external_buffers.clear();
+    m_transient_textures.clear();
+    m_transient_buffers.clear();
+    m_transient_allocations.clear();
+    m_transient_stats = {};
+    m_schedule_stats = {};
     m_descriptors->Reset();
     m_upload_buffers_uniform->Reset();
     m_upload_buffers_structured->Reset();
+    for ( const auto& ctx : m_record_contexts )
+    {
+        ctx->Reset();
+    }
+}
+
+bool Rendergraph::AllocateTransientResources()
+{
+    m_transient_allocations.clear();
+    m_transient_stats = {};
+
+    // 1. Lifetimes over the pass order. Resources used only by culled passes are not allocated
+    std::unordered_map<uint64_t, size_t> allocation_indices;
+    std::unordered_set<uint64_t> culled_pass_resources;
+    for ( uint32_t pass_idx = 0; pass_idx < uint32_t( m_passes.size() ); ++pass_idx )
+    {
+        auto track_usage = [&]( uint64_t handle, const RGTransientTexture* texture, const RGTransientBuffer* buffer )
+        {
+            auto [allocation_it, inserted] = allocation_indices.try_emplace( handle, m_transient_allocations.size() );
+            if ( inserted )
+            {
+                auto& allocation = m_transient_allocations.emplace_back();
+                allocation.texture = texture;
+                allocation.buffer = buffer;
+                allocation.first_pass = pass_idx;
+            }
+            m_transient_allocations[allocation_it->second].last_pass = pass_idx;
+        };
+
+        const RGPass& pass = *m_passes[pass_idx];
+        if ( pass.m_culled )
+        {
+            for ( const auto& [handle, used_texture] : pass.m_used_textures )
+                culled_pass_resources.insert( handle );
+            for ( const auto& [handle, used_buffer] : pass.m_used_buffers )
+                culled_pass_resources.insert( handle );
+            continue;
+        }
+
+        for ( const auto& [handle, used_texture] : pass.m_used_textures )
+        {
+            auto transient_it = m_transient_textures.find( handle );
+            if ( transient_it != m_transient_textures.end() )
+                track_usage( handle, transient_it->second.texture.get(), nullptr );
+        }
+        for ( const auto& [handle, used_buffer] : pass.m_used_buffers )
+        {
+            auto transient_it = m_transient_buffers.find( handle );
+            if ( transient_it != m_transient_buffers.end() )
+                track_usage( handle, nullptr, transient_it->second.buffer.get() );
+        }
+    }
+
+    if ( m_transient_allocations.size() != m_transient_textures.size() + m_transient_buffers.size() )
+    {
+        for ( const auto& [handle, entry] : m_transient_textures )
+        {
+            if ( !allocation_indices.contains( handle ) && !culled_pass_resources.contains( handle ) )
+                SE_LOG_WARNING( Rendergraph, "Transient texture <%s> is added to the rendergraph but is not used in any pass!", entry.texture->GetName().c_str() );
+        }
+        for ( const auto& [handle, entry] : m_transient_buffers )
+        {
+            if ( !allocation_indices.contains( handle ) && !culled_pass_resources.contains( handle ) )
+                SE_LOG_WARNING( Rendergraph, "Transient buffer <%s> is added to the rendergraph but is not used in any pass!", entry.buffer->GetName().c_str() );
+        }
+    }
+
+    m_transient_stats.resource_count = m_transient_allocations.size();
+
+    // 2. Pack resources into heaps. Without placed resources support every transient resource gets dedicated memory
+    RHI& rhi = GetRHI();
+    if ( rhi.SupportsPlacedResources() )
+    {
+        std::vector<TransientResourceAllocator::Request> requests;
+        requests.reserve( m_transient_allocations.size() );
+        for ( RGTransientResourceAllocation& allocation : m_transient_allocations )
+        {
+            const RHIMemoryRequirements requirements = ( allocation.texture != nullptr )
+                ? rhi.GetTextureMemoryRequirements( allocation.texture->GetDesc().info )
+                : rhi.GetBufferMemoryRequirements( allocation.buffer->GetDesc().info );
+
+            if ( !SE_ENSURE( requirements.size > 0 ) )
+                return false;
+
+            allocation.size = requirements.size;
+
+            auto& request = requests.emplace_back();
+            request.size = requirements.size;
+            request.alignment = requirements.alignment;
+            request.first_pass = allocation.first_pass;
+            request.last_pass = allocation.last_pass;
+        }
+
+        const TransientResourceAllocator::Result& result = m_transient_allocator_result;
+        m_transient_allocator.Allocate( requests, TransientHeapMaxSize, m_transient_allocator_result );
+
+        for ( size_t i = 0; i < m_transient_allocations.size(); ++i )
+        {
+            const TransientResourceAllocator::Placement& placement = result.placements[i];
+            RGTransientResourceAllocation& allocation = m_transient_allocations[i];
+            allocation.heap = placement.heap;
+            allocation.offset = placement.offset;
+            if ( placement.aliased_request != TransientResourceAllocator::NoAliasing )
+                allocation.aliased_resource = GetAllocatedResource( m_transient_allocations[placement.aliased_request] );
+        }
+
+        if ( !CreateTransientHeaps( result.heap_sizes ) )
+            return false;
+
+        m_transient_stats.aliased_resource_count = result.aliased_count;
+        m_transient_stats.requested_memory = result.requested_size;
+        m_transient_stats.peak_memory = result.total_heap_size;
+    }
+    else
+    {
+        m_transient_heaps.clear();
+    }
+
+    // 3. RHI resources
+    CreateTransientRHIResources();
+
+    if ( rg_logTransientResources.GetValue() > 0 )
+    {
+        LogTransientResources();
+    }
+
+    return true;
+}
+
+// Heaps from previous frames are reused if they are big enough
+bool Rendergraph::CreateTransientHeaps( std::span<const uint64_t> heap_sizes )
+{
+    RHI& rhi = GetRHI();
+
+    m_transient_stats.heap_memory = 0;
+    m_transient_heaps.resize( heap_sizes.size() );
+    for ( size_t heap_idx = 0; heap_idx < m_transient_heaps.size(); ++heap_idx )
+    {
+        RHIMemoryHeapPtr& heap = m_transient_heaps[heap_idx];
+        if ( heap == nullptr || heap->GetSize() < heap_sizes[heap_idx] )
+        {
+            RHI::MemoryHeapInfo heap_info = {};
+            heap_info.size = heap_sizes[heap_idx];
+            heap_info.name = "RGTransientHeap";
+            heap = rhi.CreateMemoryHeap( heap_info );
+            if ( !SE_ENSURE( heap != nullptr ) )
+                return false;
+        }
+        m_transient_stats.heap_memory += heap->GetSize();
+    }
+    m_transient_stats.heap_count = m_transient_heaps.size();
+
+    return true;
+}
+
+void Rendergraph::CreateTransientRHIResources()
+{
+    RHI& rhi = GetRHI();
+
+    // RHI resources that are not reused by this frame are released with the previous cache
+    std::unordered_map<uint64_t, RGTransientTextureCacheEntry> prev_texture_cache;
+    std::unordered_map<uint64_t, RHIBufferPtr> prev_buffer_cache;
+    prev_texture_cache.swap( m_transient_texture_cache );
+    prev_buffer_cache.swap( m_transient_buffer_cache );
+
+    for ( const RGTransientResourceAllocation& allocation : m_transient_allocations )
+    {
+        RHIMemoryHeap* heap = ( allocation.heap != TransientResourceAllocator::InvalidHeap ) ? m_transient_heaps[allocation.heap].get() : nullptr;
+
+        if ( allocation.texture != nullptr )
+        {
+            RGTransientTexture& texture = *m_transient_textures[allocation.texture->GetHandle()].texture;
+            const RHI::TextureInfo& info = texture.GetDesc().info;
+
+            // identical resources can be placed at the same offset, they still need separate RHI textures
+            uint64_t key = CalcTransientTextureKey( info, heap, allocation.offset );
+            while ( m_transient_texture_cache.contains( key ) )
+                HashCombine( key, uint64_t( 1 ) );
+
+            RGTransientTextureCacheEntry& entry = m_transient_texture_cache[key];
+
+            auto prev_it = prev_texture_cache.find( key );
+            if ( prev_it != prev_texture_cache.end() )
+            {
+                entry = std::move( prev_it->second );
+                prev_texture_cache.erase( prev_it );
+            }
+            else
+            {
+                entry.texture = ( heap != nullptr ) ? rhi.CreatePlacedTexture( info, *heap, allocation.offset ) : rhi.CreateTexture( info );
+
+                if ( bool( info.usage & RHITextureUsageFlags::TextureROView ) )
+                {
+                    RHI::TextureROViewInfo view_info = {};
+                    view_info.texture = entry.texture.get();
+                    entry.ro_view = rhi.CreateTextureROView( view_info );
+                }
+                if ( bool( info.usage & RHITextureUsageFlags::RenderTargetView ) )
+                {
+                    RHI::RenderTargetViewInfo view_info = {};
+                    view_info.texture = entry.texture.get();
+                    view_info.format = info.format;
+                    entry.rt_view = rhi.CreateRTV( view_info );
+                }
+            }
+
+            RHITextureRWView* rw_view = bool( info.usage & RHITextureUsageFlags::TextureRWView ) ? entry.texture->GetBaseRWView() : nullptr;
+
+            texture.SetRHITexture( entry.texture.get() );
+            texture.SetRHIViews( entry.ro_view.get(), rw_view, entry.rt_view.get() );
+        }
+        else
+        {
+            RGTransientBuffer& buffer = *m_transient_buffers[allocation.buffer->GetHandle()].buffer;
+            RHI::BufferInfo info = buffer.GetDesc().info;
+            if ( info.name == nullptr )
+                info.name = buffer.GetDesc().name;
+
+            uint64_t key = CalcTransientBufferKey( info, heap, allocation.offset );
+            while ( m_transient_buffer_cache.contains( key ) )
+                HashCombine( key, uint64_t( 1 ) );
+
+            RHIBufferPtr& entry = m_transient_buffer_cache[key];
+
+            auto prev_it = prev_buffer_cache.find( key );
+            if ( prev_it != prev_buffer_cache.end() )
+            {
+                entry = std::move( prev_it->second );
+                prev_buffer_cache.erase( prev_it );
+            }
+            else
+            {
+                entry = ( heap != nullptr ) ? rhi.CreatePlacedBuffer( info, *heap, allocation.offset ) : rhi.CreateDeviceBuffer( info );
+            }
+
+            buffer.SetRHIBuffer( entry.get() );
+        }
+    }
+}
+
+void Rendergraph::LogTransientResources() const
+{
+    const RGTransientResourceStats& stats = m_transient_stats;
+    SE_LOG_INFO( Rendergraph, "Transient resources: %zu, aliased: %zu. Memory without aliasing: %llu KB, with aliasing: %llu KB, heaps: %zu (%llu KB)",
+        stats.resource_count, stats.aliased_resource_count,
+        stats.requested_memory / SizeKB, stats.peak_memory / SizeKB,
+        stats.heap_count, stats.heap_memory / SizeKB );
+
+    for ( const RGTransientResourceAllocation& allocation : m_transient_allocations )
+    {
+        SE_LOG_INFO( Rendergraph, "\t<%s>: passes [%u, %u], heap %u, offset %llu KB, size %llu KB%s%s",
+            GetAllocatedResource( allocation )->GetName().c_str(),
+            allocation.first_pass, allocation.last_pass,
+            allocation.heap, allocation.offset / SizeKB, allocation.size / SizeKB,
+            allocation.aliased_resource ? ", aliases " : "",
+            allocation.aliased_resource ? allocation.aliased_resource->GetName().c_str() : "" );
+    }
 }
 
 RHIDescriptorSet* Rendergraph::AllocateFrameDescSet( RHIDescriptorSetLayout& layout )
@@ -386,6 +1744,39 @@ UploadBufferRange Rendergraph::AllocateUploadBufferStructured( size_t size )
     return m_upload_buffers_structured->Allocate( size );
 }
 
+// RGRecordContext
+
+RGRecordContext::RGRecordContext()
+{
+    m_descriptors = std::make_unique<DescriptorSetPool>();
+    m_upload_buffers_uniform = std::make_unique<UploadBufferPool>( RHIBufferUsageFlags::UniformBuffer );
+    m_upload_buffers_structured = std::make_unique<UploadBufferPool>( RHIBufferUsageFlags::StructuredBuffer );
+}
+
+RGRecordContext::~RGRecordContext() = default;
+
+RHIDescriptorSet* RGRecordContext::AllocateFrameDescSet( RHIDescriptorSetLayout& layout )
+{
+    return m_descriptors->Allocate( layout );
+}
+
+UploadBufferRange RGRecordContext::AllocateUploadBufferUniform( size_t size )
+{
+    return m_upload_buffers_uniform->Allocate( size );
+}
+
+UploadBufferRange RGRecordContext::AllocateUploadBufferStructured( size_t size )
+{
+    return m_upload_buffers_structured->Allocate( size );
+}
+
+void RGRecordContext::Reset()
+{
+    m_descriptors->Reset();
+    m_upload_buffers_uniform->Reset();
+    m_upload_buffers_structured->Reset();
+}
+
 // RGPass
 
 RGPass::RGPass( RHI::QueueType queue_type, const char* name )
@@ -446,6 +1837,9 @@ bool RGPass::UseTextureView( const RGRenderTargetView& view )
 
 void RGPass::AddCommandList( RHICommandList& cmd_list )
 {
+    if ( !SE_ENSURE( !m_culled && cmd_list.GetType() == m_scheduled_queue ) )
+        return;
+
     if ( m_cmd_lists.empty() && ( m_borrowed_list == false ) )
     {
         AddPassBeginCommands( cmd_list );
@@ -459,6 +1853,9 @@ bool RGPass::BorrowCommandList( RHICommandList& cmd_list )
     if ( !SE_ENSURE( m_borrowed_list == false ) )
         return false;
 
+    if ( !SE_ENSURE( !m_culled && cmd_list.GetType() == m_scheduled_queue && !m_begins_submission ) )
+        return false;
+
     m_borrowed_list = true;
     AddPassBeginCommands( cmd_list );
     return true;
@@ -469,8 +1866,11 @@ void RGPass::EndPass()
     // nothing to do?
 }
 
-void RGPass::AddPassBeginCommands( RHICommandList& cmd_list )
+void RGPass::AddPassBeginCommands( RHICommandList& cmd_list ) const
 {
-    cmd_list.TextureBarriers( m_pass_start_texture_barriers.data(), m_pass_start_texture_barriers.size() );
-    cmd_list.MemoryBarrierGPU();
+    if ( !m_pass_start_texture_barriers.empty() )
+        cmd_list.TextureBarriers( m_pass_start_texture_barriers.data(), m_pass_start_texture_barriers.size() );
+
+    if ( m_pass_start_memory_barrier )
+        cmd_list.MemoryBarrierGPU();
 }
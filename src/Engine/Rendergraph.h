@@ -3,13 +3,18 @@
 
 #include "StdAfx.h"
 
+#include "TransientResourceAllocator.h"
 #include "UploadBufferPool.h"
 
+#include <functional>
+
 SE_LOG_CATEGORY( Rendergraph );
 
 
 class DescriptorSetPool;
+class ITaskScheduler;
 class RHICommandList;
+struct RGCompiledPlan;
 
 
 class RGResource
@@ -108,6 +113,9 @@ public:
     void SetRHITexture( const RHITexture* tex ) { m_rhi_texture = tex; }
     const RHITexture* GetRHITexture() const { return m_rhi_texture; }
 
+    // Views of transient textures are registered on creation and get their RHI views after Rendergraph::Compile
+    void SetRHIViews( RHITextureROView* ro_view, RHITextureRWView* rw_view, RHIRenderTargetView* rt_view );
+
     const RGTextureROView* RegisterExternalROView( const RGExternalTextureROViewDesc& desc );
     const RGTextureRWView* RegisterExternalRWView( const RGExternalTextureRWViewDesc& desc );
     const RGRenderTargetView* RegisterExternalRTView( const RGExternalRenderTargetViewDesc& desc );
@@ -156,11 +164,44 @@ struct RGPassBuffer
 
 
 
+// Allocations for passes recorded on worker threads, see Rendergraph::RecordPasses. Each context is used by one thread at a time.
+// Allocated descriptor sets and buffer ranges may only be used until Rendergraph::Submit() is called, same as the ones allocated from Rendergraph
+class RGRecordContext
+{
+    friend class Rendergraph;
+
+    std::unique_ptr<DescriptorSetPool> m_descriptors;
+    std::unique_ptr<UploadBufferPool> m_upload_buffers_uniform;
+    std::unique_ptr<UploadBufferPool> m_upload_buffers_structured;
+
+public:
+    RGRecordContext();
+    ~RGRecordContext();
+
+    RHIDescriptorSet* AllocateFrameDescSet( RHIDescriptorSetLayout& layout );
+    UploadBufferRange AllocateUploadBufferUniform( size_t size );
+    UploadBufferRange AllocateUploadBufferStructured( size_t size );
+
+    template<typename BufferType>
+    UploadBufferRange AllocateUploadBufferUniform() { return AllocateUploadBufferUniform( sizeof( BufferType ) ); }
+
+private:
+    void Reset();
+};
+
+// Records all commands of a pass. Called on a worker thread, so it must not touch other passes or the rendergraph itself
+using RGRecordCallback = std::function<void( RHICommandList& cmd_list, RGRecordContext& ctx )>;
+
+
 class RGPass
 {
     friend class Rendergraph;
 
+    // queue requested on creation. Compute and copy passes may still end up on the graphics queue, see Rendergraph::Compile
     RHI::QueueType m_queue_type = RHI::QueueType::Count;
+    RHI::QueueType m_scheduled_queue = RHI::QueueType::Graphics;
+
+    uint32_t m_cost_hint = DefaultCostHint;
 
     std::unordered_map<uint64_t, RGPassTexture> m_used_textures;
 
@@ -169,20 +210,58 @@ class RGPass
     std::vector<RHICommandList*> m_cmd_lists;
 
     std::vector<RHITextureBarrier> m_pass_start_texture_barriers;
+    // full memory barrier before the pass, only if it has a hazard with an earlier pass on the same queue
+    bool m_pass_start_memory_barrier = false;
 
     std::string m_name;
 
+    RGRecordCallback m_record_callback;
+
     bool m_borrowed_list = false;
 
+    // pass waits for other queues, so it can't share a command list with the previous pass
+    bool m_begins_submission = false;
+
+    bool m_untracked_accesses = false;
+    bool m_culled = false;
+
 public:
+    // Estimated GPU time of a pass in microseconds
+    static constexpr uint32_t DefaultCostHint = 100;
+
     RGPass( RHI::QueueType queue_type, const char* name );
 
+    const std::string& GetName() const { return m_name; }
+
+    // Used by Rendergraph::Compile to decide whether moving the pass to an async queue shortens the frame
+    void SetCostHint( uint32_t gpu_time_us ) { m_cost_hint = gpu_time_us; }
+    uint32_t GetCostHint() const { return m_cost_hint; }
+
+    RHI::QueueType GetRequestedQueueType() const { return m_queue_type; }
+    // Valid after Rendergraph::Compile. Command lists of the pass must be taken from this queue
+    RHI::QueueType GetQueueType() const { return m_scheduled_queue; }
+    // Valid after Rendergraph::Compile. Layout transitions and queue ownership acquires recorded at the start of the pass.
+    // Barriers of later passes may be moved here if nothing in between uses their textures
+    std::span<const RHITextureBarrier> GetStartBarriers() const { return m_pass_start_texture_barriers; }
+    bool HasStartMemoryBarrier() const { return m_pass_start_memory_barrier; }
+
+    // Pass reads or writes resources that are not declared with UseTexture/UseBuffer. Such passes are never culled and are separated
+    // from other passes on their queue with memory barriers. Passes without declared resources are treated the same way
+    void SetHasUntrackedAccesses() { m_untracked_accesses = true; }
+    bool HasUntrackedAccesses() const { return m_untracked_accesses || ( m_used_textures.empty() && m_used_buffers.empty() ); }
+
+    // Valid after Rendergraph::Compile. Culled passes don't contribute to external resources, they are not submitted and must not be recorded
+    bool IsCulled() const { return m_culled; }
+
     bool UseTexture( const RGTexture& texture, RGTextureUsage usage );
     bool UseTextureView( const RGRenderTargetView& view );
     bool UseTextureView( const RGTextureROView& view );
     bool UseTextureView( const RGTextureRWView& view );
     bool UseBuffer( const RGBuffer& buffer, RGBufferUsage usage );
 
+    // Pass is recorded by Rendergraph::RecordPasses into a command list of its own instead of the lists added manually
+    void SetRecordCallback( RGRecordCallback callback ) { m_record_callback = std::move( callback ); }
+
     void AddCommandList( RHICommandList& cmd_list );
 
     // Has to be called, when all command lists are written for that pass
@@ -196,19 +275,52 @@ public:
     // curr_pass->BorrowCommmandList( list );
     // curr_pass->AddCommandList( some_other_list ); // optional
     // curr_pass->EndPass();
+    // Borrowing fails if the passes were scheduled to different queues or the pass has to wait for another queue
     bool CanBorrowCommandListFromPreviousPass() const { NOTIMPL; return false; }
     bool BorrowCommandList( RHICommandList& cmd_list );
 
 private:
-    void AddPassBeginCommands( RHICommandList& cmd_list );
+    void AddPassBeginCommands( RHICommandList& cmd_list ) const;
 };
 
 
 struct RendergraphSubmission
 {
     std::vector<RGPass*> passes;
+    // queue ownership releases and final layout transitions
     std::vector<RHITextureBarrier> end_barriers;
     RHI::QueueType type = RHI::QueueType::Graphics;
+
+    // earlier submissions on other queues this one waits for. Waits implied by other waits are omitted
+    std::vector<uint32_t> wait_submissions;
+};
+
+struct RGScheduleStats
+{
+    std::array<size_t, size_t( RHI::QueueType::Count )> pass_count = {};
+    size_t submission_count = 0;
+    size_t semaphore_count = 0;
+    size_t ownership_transfer_count = 0;
+    size_t culled_pass_count = 0;
+
+    // Barriers recorded at pass starts. Batches are pipeline barriers, texture barriers of later passes are merged into earlier batches when possible
+    size_t barrier_batch_count = 0;
+    size_t merged_barrier_batch_count = 0;
+    size_t texture_barrier_count = 0;
+    size_t memory_barrier_count = 0;
+
+    // Estimates from pass cost hints, in microseconds
+    uint64_t serial_cost = 0; // all passes on the graphics queue
+    uint64_t scheduled_cost = 0; // frame length with the chosen schedule
+    uint64_t critical_path = 0; // longest chain of dependent passes, no schedule can be shorter
+};
+
+
+struct RGCompileStats
+{
+    bool cached = false; // last Compile() reused a plan compiled by an earlier frame
+    size_t cache_hits = 0;
+    size_t cache_misses = 0;
 };
 
 
@@ -261,6 +373,92 @@ struct RGExternalBufferEntry
     std::unique_ptr<RGExternalBuffer> buffer = nullptr;
 };
 
+// Transient resources only live during one rendergraph execution. Their memory is allocated on Compile() and may be shared (aliased)
+// with other transient resources whose lifetimes don't overlap, so their contents are undefined at the first pass that uses them.
+// RHI resources are only available after Compile()
+struct RGTransientTextureDesc
+{
+    const char* name = nullptr;
+    RHI::TextureInfo info = {};
+};
+
+class RGTransientTexture : public RGTexture
+{
+private:
+    RGTransientTextureDesc m_desc = {};
+
+public:
+    RGTransientTexture( uint64_t handle, const RGTransientTextureDesc& desc );
+
+    const RGTransientTextureDesc& GetDesc() const { return m_desc; }
+};
+
+struct RGTransientTextureEntry
+{
+    std::unique_ptr<RGTransientTexture> texture = nullptr;
+};
+
+struct RGTransientBufferDesc
+{
+    const char* name = nullptr;
+    RHI::BufferInfo info = {};
+};
+
+class RGTransientBuffer : public RGBuffer
+{
+private:
+    RGTransientBufferDesc m_desc = {};
+
+public:
+    RGTransientBuffer( uint64_t handle, const RGTransientBufferDesc& desc );
+
+    const RGTransientBufferDesc& GetDesc() const { return m_desc; }
+};
+
+struct RGTransientBufferEntry
+{
+    std::unique_ptr<RGTransientBuffer> buffer = nullptr;
+};
+
+// Where a transient resource ended up after Compile()
+struct RGTransientResourceAllocation
+{
+    // only one is set
+    const RGTransientTexture* texture = nullptr;
+    const RGTransientBuffer* buffer = nullptr;
+
+    uint32_t first_pass = 0;
+    uint32_t last_pass = 0;
+
+    // heap is TransientResourceAllocator::InvalidHeap if RHI doesn't support placed resources and the resource has dedicated memory
+    uint32_t heap = TransientResourceAllocator::InvalidHeap;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+
+    // resource that used (part of) this memory before, if any
+    const RGResource* aliased_resource = nullptr;
+};
+
+struct RGTransientResourceStats
+{
+    size_t resource_count = 0;
+    size_t aliased_resource_count = 0;
+
+    uint64_t requested_memory = 0; // memory needed without aliasing
+    uint64_t peak_memory = 0; // memory needed with aliasing
+    uint64_t heap_memory = 0; // memory held by heaps, can be bigger than peak_memory since heaps are reused between frames
+    size_t heap_count = 0;
+};
+
+struct RGTransientTextureCacheEntry
+{
+    RHITexturePtr texture = nullptr;
+    RHITextureROViewPtr ro_view = nullptr;
+    RHIRenderTargetViewPtr rt_view = nullptr;
+};
+
+// Waits are done by the first graphics submission and the semaphore is signaled by the last one,
+// which also waits for all other queues
 struct RGSubmitInfo
 {
     size_t wait_semaphore_count = 0;
@@ -273,6 +471,7 @@ struct RGSubmitInfo
 class Rendergraph
 {
 private:
+    // restarts every frame, so the same sequence of registrations gets the same handles and compiled plans can refer to resources by handle
     uint64_t m_handle_generator = 0;
 
     std::vector<std::unique_ptr<RGPass>> m_passes;
@@ -282,7 +481,36 @@ private:
     std::unordered_map<uint64_t, RGExternalTextureEntry> m_external_textures;
     std::unordered_map<uint64_t, RGExternalBufferEntry> m_external_buffers;
 
-    std::vector<RHITextureBarrier> m_final_barriers;
+    std::unordered_map<uint64_t, RGTransientTextureEntry> m_transient_textures;
+    std::unordered_map<uint64_t, RGTransientBufferEntry> m_transient_buffers;
+
+    // Transient memory and RHI resources survive Reset() and are reused by the next frames while the layout of transient resources stays the same
+    static constexpr uint64_t TransientHeapMaxSize = 256 * SizeMB;
+    TransientResourceAllocator m_transient_allocator;
+    TransientResourceAllocator::Result m_transient_allocator_result;
+    std::vector<RHIMemoryHeapPtr> m_transient_heaps;
+    std::unordered_map<uint64_t, RGTransientTextureCacheEntry> m_transient_texture_cache;
+    std::unordered_map<uint64_t, RHIBufferPtr> m_transient_buffer_cache;
+
+    std::vector<RGTransientResourceAllocation> m_transient_allocations;
+    RGTransientResourceStats m_transient_stats;
+
+    RGScheduleStats m_schedule_stats;
+
+    // Compile() results of recently seen graph structures, see DescribeStructure
+    static constexpr size_t MaxCompiledPlans = 8;
+    std::vector<std::unique_ptr<RGCompiledPlan>> m_compiled_plans;
+    std::vector<uint64_t> m_structure;
+    uint64_t m_compile_count = 0;
+    RGCompileStats m_compile_stats;
+
+    // cross-queue semaphores, reused every frame
+    std::vector<RHIObjectPtr<RHISemaphore>> m_queue_semaphores;
+
+    // one per recording thread, reused every frame
+    std::vector<std::unique_ptr<RGRecordContext>> m_record_contexts;
+    std::vector<RGRecordContext*> m_free_record_contexts;
+    std::mutex m_record_contexts_lock;
 
     std::unique_ptr<DescriptorSetPool> m_descriptors;
     std::unique_ptr<UploadBufferPool> m_upload_buffers_uniform;
@@ -296,12 +524,28 @@ public:
 
     RGExternalTexture* RegisterExternalTexture( const RGExternalTextureDesc& desc );
     RGExternalBuffer* RegisterExternalBuffer( const RGExternalBufferDesc& desc );
-    RGResource* CreateTransientTexture();
+    RGTransientTexture* CreateTransientTexture( const RGTransientTextureDesc& desc );
     RGResource* RegisterExternalAS();
-    RGResource* CreateTransientBuffer();
+    RGTransientBuffer* CreateTransientBuffer( const RGTransientBufferDesc& desc );
 
+    // Passes that don't write external resources, directly or through other passes, are culled.
+    // Passes requested on Compute or Copy queues are moved there if it makes the frame shorter according to pass cost hints.
+    // Otherwise they run on the graphics queue.
+    // If the graph has the same structure as one compiled before (same passes, resource descriptions, usages and external layouts, registered in the same order),
+    // the cached schedule and transient resource placement are reused and only RHI resource pointers are patched
     bool Compile();
 
+    // valid after Compile()
+    std::span<const RGTransientResourceAllocation> GetTransientResourceAllocations() const { return m_transient_allocations; }
+    const RGTransientResourceStats& GetTransientResourceStats() const { return m_transient_stats; }
+    std::span<const RendergraphSubmission> GetSubmissions() const { return m_submissions; }
+    const RGScheduleStats& GetScheduleStats() const { return m_schedule_stats; }
+    const RGCompileStats& GetCompileStats() const { return m_compile_stats; }
+
+    // Records all passes that have a record callback, in parallel on the scheduler threads. Has to be called between Compile() and Submit().
+    // Every pass gets its own command list, lists are still submitted in the compiled pass order regardless of which thread recorded them
+    bool RecordPasses( ITaskScheduler& scheduler );
+
     RHIFence Submit( const RGSubmitInfo& info );
 
     void Reset();
@@ -321,4 +565,16 @@ public:
 
 private:
     uint64_t GenerateHandle() { return m_handle_generator++; }
+
+    void CullPasses();
+    bool ScheduleSubmissions();
+
+    void DescribeStructure( std::vector<uint64_t>& structure ) const;
+    bool ApplyCompiledPlan( const RGCompiledPlan& plan );
+    void StoreCompiledPlan( uint64_t key );
+
+    bool AllocateTransientResources();
+    bool CreateTransientHeaps( std::span<const uint64_t> heap_sizes );
+    void CreateTransientRHIResources();
+    void LogTransientResources() const;
 };
\ No newline at end of file
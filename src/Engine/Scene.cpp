@@ -15,6 +15,52 @@ CVAR_DEFINE( r_debugDisplayMapping, int, 0, "Show debug interface for display ma
 
 CVAR_DEFINE( r_showStats, int, 0, "Show renderer stats" );
 
+CVAR_DEFINE( r_cpuTLASMaxSAHGrowthPercent, uint32_t, 30, "CPU ray query hierarchy is rebuilt once refits made its SAH cost grow by more than this percent" );
+
+CVAR_DEFINE( r_materialUploadMergeGap, uint32_t, 4, "Dirty material ranges separated by at most this many clean materials are uploaded with one copy" );
+
+CVAR_EXTERN( r_tlasUploadMergeGap, uint32_t );
+
+// must be in sync with SceneViewParams.hlsli
+struct GPUTLASItemParams
+{
+    glm::mat3x4 object_to_world_mat;
+    uint32_t geom_buf_index;
+    uint32_t material_index;
+    uint32_t picking_id;
+};
+
+namespace
+{
+    BVHRay MakeRay( const glm::vec3& origin, const glm::vec3& direction, float max_t )
+    {
+        BVHRay ray;
+        for ( int axis = 0; axis < 3; ++axis )
+        {
+            ray.origin[axis] = origin[axis];
+            ray.direction[axis] = direction[axis];
+        }
+        ray.t_max = max_t;
+        return ray;
+    }
+
+    void CopyTransform( const glm::mat3x4& src, float ( &dst )[3][4] )
+    {
+        for ( int row = 0; row < 3; ++row )
+        {
+            for ( int col = 0; col < 4; ++col )
+                dst[row][col] = src[row][col];
+        }
+    }
+
+    BVHBounds CalcWorldBounds( const InstanceBVH::Instance& instance )
+    {
+        if ( instance.blas == nullptr )
+            return BVHBounds();
+        return instance.blas->GetBounds().Transformed( instance.object_to_world );
+    }
+}
+
 // Scene
 
 Scene::Scene()
@@ -22,6 +68,10 @@ Scene::Scene()
     m_tlas = std::make_unique<TLAS>();
 }
 
+Scene::~Scene()
+{
+}
+
 SceneMeshInstanceID Scene::AddMeshInstanceFromAsset( MeshAssetPtr base_asset )
 {
     if ( !SE_ENSURE( base_asset ) )
@@ -32,8 +82,18 @@ SceneMeshInstanceID Scene::AddMeshInstanceFromAsset( MeshAssetPtr base_asset )
     auto& mesh_instance = m_mesh_instances[new_mesh_id];
 
     mesh_instance.m_asset = base_asset;
-    mesh_instance.m_tlas_instance = m_tlas->Instances().emplace();
-    m_tlas->Instances()[mesh_instance.m_tlas_instance].blas = base_asset->GetAccelerationStructure();
+    mesh_instance.m_tlas_instance = m_tlas->AddInstance( base_asset->GetAccelerationStructure(), ToMatrixRowMajor3x4( mesh_instance.m_tf ) );
+
+    // params are filled on synchronization
+    VERIFY_EQUALS( m_tlas->Instances().get_packed_idx( mesh_instance.m_tlas_instance ), m_instance_params.size() );
+    m_instance_params.emplace_back();
+    MarkDirty( new_mesh_id, mesh_instance );
+
+    InstanceBVH::Instance& cpu_instance = m_cpu_instances.emplace_back();
+    cpu_instance.blas = &base_asset->GetCPUBVH();
+    CopyTransform( ToMatrixRowMajor3x4( mesh_instance.m_tf ), cpu_instance.object_to_world );
+    m_cpu_instance_ids.emplace_back( new_mesh_id );
+    m_cpu_tlas_needs_rebuild = true;
 
     return new_mesh_id;
 }
@@ -44,22 +104,247 @@ void Scene::RemoveMeshInstance( SceneMeshInstanceID id )
     if ( !instance )
         return;
 
-    m_tlas->Instances().erase( instance->m_tlas_instance );
+    // TLAS moves its last instance into the freed slot, params follow it
+    const size_t packed_idx = m_tlas->Instances().get_packed_idx( instance->m_tlas_instance );
+    m_tlas->RemoveInstance( instance->m_tlas_instance );
+    if ( packed_idx + 1 < m_instance_params.size() )
+    {
+        m_instance_params[packed_idx] = m_instance_params.back();
+        m_dirty_instance_params.MarkDirty( uint32_t( packed_idx ) );
+        m_cpu_instances[packed_idx] = m_cpu_instances.back();
+        m_cpu_instance_ids[packed_idx] = m_cpu_instance_ids.back();
+    }
+    m_instance_params.pop_back();
+    m_cpu_instances.pop_back();
+    m_cpu_instance_ids.pop_back();
+    m_cpu_tlas_needs_rebuild = true;
 
     m_mesh_instances.erase( id );
 }
 
+void Scene::SetMeshInstanceTransform( SceneMeshInstanceID id, const Transform& tf )
+{
+    SceneMeshInstance* instance = m_mesh_instances.try_get( id );
+    if ( !SE_ENSURE( instance ) )
+        return;
+
+    if ( instance->m_tf.translation == tf.translation && instance->m_tf.orientation == tf.orientation && instance->m_tf.scale == tf.scale )
+        return;
+
+    instance->m_tf = tf;
+    MarkDirty( id, *instance );
+}
+
+void Scene::SetMeshInstancePickingID( SceneMeshInstanceID id, int32_t picking_id )
+{
+    SceneMeshInstance* instance = m_mesh_instances.try_get( id );
+    if ( !SE_ENSURE( instance ) )
+        return;
+
+    if ( instance->m_picking_id == picking_id )
+        return;
+
+    instance->m_picking_id = picking_id;
+    MarkDirty( id, *instance );
+}
+
+RHIBufferViewInfo Scene::GetGPUInstanceParams() const
+{
+    // the buffer written by the last Synchronize call
+    const uint32_t buf_idx = ( m_cur_instance_params_buf + m_num_instance_param_bufs - 1 ) % m_num_instance_param_bufs;
+
+    RHIBufferViewInfo view = {};
+    view.buffer = m_gpu_instance_params[buf_idx] != nullptr ? m_gpu_instance_params[buf_idx]->GetBuffer() : nullptr;
+    view.range = m_instance_params.size() * sizeof( GPUTLASItemParams );
+    return view;
+}
+
 void Scene::Synchronize()
 {
-    UpdateTLASTransforms();
+    SynchronizeDirtyMeshInstances();
+    SynchronizeCPUTLAS();
+    UploadInstanceParams();
 }
 
-void Scene::UpdateTLASTransforms()
+void Scene::MarkDirty( SceneMeshInstanceID id, SceneMeshInstance& mesh_instance )
 {
-    for ( SceneMeshInstance& mesh_instance : m_mesh_instances )
+    if ( mesh_instance.m_dirty )
+        return;
+
+    mesh_instance.m_dirty = true;
+    m_dirty_mesh_instances.emplace_back( id );
+}
+
+void Scene::SynchronizeDirtyMeshInstances()
+{
+    const MaterialAsset* default_material = GetRenderer().GetDefaultMaterial();
+
+    for ( SceneMeshInstanceID id : m_dirty_mesh_instances )
     {
-        m_tlas->Instances()[mesh_instance.m_tlas_instance].transform = ToMatrixRowMajor3x4( mesh_instance.m_tf );
+        // may have been removed after the change
+        SceneMeshInstance* mesh_instance = m_mesh_instances.try_get( id );
+        if ( !mesh_instance )
+            continue;
+
+        mesh_instance->m_dirty = false;
+
+        // picking id changes don't touch the TLAS
+        const glm::mat3x4 object_to_world_mat = ToMatrixRowMajor3x4( mesh_instance->m_tf );
+        const size_t packed_idx = m_tlas->Instances().get_packed_idx( mesh_instance->m_tlas_instance );
+        if ( m_tlas->Instances()[mesh_instance->m_tlas_instance].transform != object_to_world_mat )
+        {
+            m_tlas->SetInstanceTransform( mesh_instance->m_tlas_instance, object_to_world_mat );
+            CopyTransform( object_to_world_mat, m_cpu_instances[packed_idx].object_to_world );
+            m_moved_cpu_instances.push_back( uint32_t( packed_idx ) );
+            m_cpu_tlas_needs_refit = true;
+        }
+
+        const MaterialAsset* material = mesh_instance->m_asset->GetMaterial();
+        if ( material == nullptr )
+        {
+            material = default_material;
+        }
+
+        GPUTLASItemParams& params = m_instance_params[packed_idx];
+        params.object_to_world_mat = object_to_world_mat;
+        params.geom_buf_index = mesh_instance->m_asset->GetGlobalGeomIndex();
+        params.material_index = material->GetGlobalMaterialIndex();
+        params.picking_id = mesh_instance->m_picking_id;
+        m_dirty_instance_params.MarkDirty( uint32_t( packed_idx ) );
     }
+    m_dirty_mesh_instances.clear();
+}
+
+void Scene::SynchronizeCPUTLAS()
+{
+    if ( m_cpu_tlas_needs_rebuild )
+    {
+        m_cpu_tlas.Build( m_cpu_instances.data(), uint32_t( m_cpu_instances.size() ) );
+        BuildCullingBVH();
+
+        m_cpu_tlas_items.resize( m_cpu_instance_ids.size() );
+        for ( size_t i = 0; i < m_cpu_instance_ids.size(); ++i )
+            m_cpu_tlas_items[i] = CPUTLASItem{ m_cpu_instance_ids[i], m_mesh_instances[m_cpu_instance_ids[i]].m_asset };
+    }
+    else if ( m_cpu_tlas_needs_refit )
+    {
+        m_cpu_tlas.Refit( m_cpu_instances.data(), uint32_t( m_cpu_instances.size() ) );
+
+        // refits keep the topology, which degrades as instances move away from their original neighbours
+        const float max_cost = m_cpu_tlas.GetBuildSAHCost() * ( 1.0f + float( r_cpuTLASMaxSAHGrowthPercent.GetValue() ) / 100.0f );
+        if ( m_cpu_tlas.GetSAHCost() > max_cost )
+        {
+            m_cpu_tlas.Build( m_cpu_instances.data(), uint32_t( m_cpu_instances.size() ) );
+            BuildCullingBVH();
+        }
+        else
+        {
+            for ( uint32_t packed_idx : m_moved_cpu_instances )
+                m_culling_bvh.SetBounds( packed_idx, CalcWorldBounds( m_cpu_instances[packed_idx] ) );
+            m_culling_bvh.Refit();
+        }
+    }
+
+    m_cpu_tlas_needs_rebuild = false;
+    m_cpu_tlas_needs_refit = false;
+    m_moved_cpu_instances.clear();
+}
+
+void Scene::BuildCullingBVH()
+{
+    m_culling_bounds.resize( m_cpu_instances.size() );
+    for ( size_t i = 0; i < m_cpu_instances.size(); ++i )
+        m_culling_bounds[i] = CalcWorldBounds( m_cpu_instances[i] );
+
+    m_culling_bvh.Build( m_culling_bounds.data(), uint32_t( m_culling_bounds.size() ) );
+}
+
+void Scene::UploadInstanceParams()
+{
+    if ( m_instance_params.empty() )
+        return;
+
+    const uint32_t buf_idx = m_cur_instance_params_buf;
+    m_cur_instance_params_buf = ( m_cur_instance_params_buf + 1 ) % m_num_instance_param_bufs;
+
+    RHIUploadBufferPtr& gpu_params = m_gpu_instance_params[buf_idx];
+
+    const size_t required_size = m_instance_params.size() * sizeof( GPUTLASItemParams );
+    if ( gpu_params == nullptr || gpu_params->GetBuffer()->GetSize() < required_size )
+    {
+        RHI::BufferInfo buf_info = {};
+        buf_info.size = required_size + required_size / 4; // make some room for new instances
+        buf_info.usage = RHIBufferUsageFlags::StructuredBuffer;
+        gpu_params = GetRHI().CreateUploadBuffer( buf_info );
+        m_dirty_instance_params.MarkAllDirty();
+    }
+
+    if ( m_dirty_instance_params.NeedsFullUpdate( buf_idx ) )
+    {
+        gpu_params->WriteBytes( m_instance_params.data(), required_size, 0 );
+        m_dirty_instance_params.MarkClean( buf_idx );
+        return;
+    }
+
+    m_dirty_instance_params.ConsumeDirtyRanges( buf_idx, uint32_t( m_instance_params.size() ), r_tlasUploadMergeGap.GetValue(), m_instance_params_ranges );
+    for ( const RingBufferDirtyTracker::Range& range : m_instance_params_ranges )
+    {
+        gpu_params->WriteBytes( m_instance_params.data() + range.first, range.count * sizeof( GPUTLASItemParams ), range.first * sizeof( GPUTLASItemParams ) );
+    }
+}
+
+bool Scene::CastRay( const BVHRay& ray, SceneRayHit& hit ) const
+{
+    BVHHit bvh_hit;
+    if ( !m_cpu_tlas.IntersectClosest( ray, bvh_hit ) )
+        return false;
+
+    hit = MakeRayHit( bvh_hit, ray );
+    return true;
+}
+
+bool Scene::CastRay( const glm::vec3& origin, const glm::vec3& direction, float max_t, SceneRayHit& hit ) const
+{
+    return CastRay( MakeRay( origin, direction, max_t ), hit );
+}
+
+bool Scene::HasLineOfSight( const glm::vec3& from, const glm::vec3& to ) const
+{
+    return !m_cpu_tlas.IntersectAny( MakeRay( from, to - from, 1.0f ) );
+}
+
+void Scene::CastRays( std::span<const BVHRay> rays, std::span<SceneRayHit> hits ) const
+{
+    VERIFY( hits.size() >= rays.size() );
+
+    constexpr size_t batch_size = 64;
+    BVHHit bvh_hits[batch_size];
+    for ( size_t first_ray = 0; first_ray < rays.size(); first_ray += batch_size )
+    {
+        const size_t num_rays = std::min( batch_size, rays.size() - first_ray );
+        m_cpu_tlas.IntersectClosest( rays.data() + first_ray, bvh_hits, num_rays );
+
+        for ( size_t i = 0; i < num_rays; ++i )
+            hits[first_ray + i] = bvh_hits[i].IsHit() ? MakeRayHit( bvh_hits[i], rays[first_ray + i] ) : SceneRayHit{};
+    }
+}
+
+void Scene::CullMeshInstances( std::span<const CullingFrustum> frustums, std::span<std::vector<uint32_t>> visible ) const
+{
+    VERIFY( frustums.size() <= CullingBVH::MaxFrustums && visible.size() >= frustums.size() );
+
+    m_culling_bvh.Cull( frustums.data(), uint32_t( frustums.size() ), visible.data() );
+}
+
+SceneRayHit Scene::MakeRayHit( const BVHHit& hit, const BVHRay& ray ) const
+{
+    SceneRayHit res;
+    res.instance = m_cpu_tlas_items[hit.instance].id;
+    res.t = hit.t;
+    res.triangle = hit.triangle;
+    res.barycentrics = glm::vec2( hit.u, hit.v );
+    res.position = glm::vec3( ray.origin[0], ray.origin[1], ray.origin[2] ) + glm::vec3( ray.direction[0], ray.direction[1], ray.direction[2] ) * hit.t;
+    return res;
 }
 
 
@@ -144,6 +429,35 @@ glm::mat4x4 SceneView::CalcProjectionMatrix() const
     return glm::perspective( fovY, aspectRatio, 0.1f, 10.0f );
 }
 
+BVHRay SceneView::CalcPixelRay( glm::uvec2 pixel ) const
+{
+    // same as PixelPositionToWorld in Raytracing.hlsl
+    const glm::mat4x4 view_proj_inv = glm::inverse( CalcProjectionMatrix() * CalcViewMatrix() );
+    const glm::vec2 ndc_xy = ( glm::vec2( pixel ) + glm::vec2( 0.5f, 0.5f ) ) / glm::vec2( m_extents ) * 2.0f - glm::vec2( 1.0f, 1.0f );
+
+    auto to_world = [&]( float ndc_depth )
+    {
+        const glm::vec4 world_pos = view_proj_inv * glm::vec4( ndc_xy.x, -ndc_xy.y, ndc_depth, 1.0f );
+        return glm::vec3( world_pos ) / world_pos.w;
+    };
+
+    const glm::vec3 origin = to_world( 0.0f );
+    return MakeRay( origin, to_world( 1.0f ) - origin, 1.0f );
+}
+
+CullingFrustum SceneView::CalcCullingFrustum() const
+{
+    // glm matrices are column major
+    const glm::mat4x4 clip_from_world = glm::transpose( CalcProjectionMatrix() * CalcViewMatrix() );
+    float m[4][4];
+    for ( int row = 0; row < 4; ++row )
+    {
+        for ( int col = 0; col < 4; ++col )
+            m[row][col] = clip_from_world[row][col];
+    }
+    return CullingFrustum::FromMatrix( m );
+}
+
 void SceneView::DebugUI() const
 {
     if ( r_showStats.GetValue() > 0 )
@@ -152,6 +466,11 @@ void SceneView::DebugUI() const
         if ( ImGui::Begin( "Renderer stats", &window_open ) )
         {
             ImGui::Text( "Num samples = %lu", m_num_accumulated_frames );
+
+            const CullingFrustum frustum = CalcCullingFrustum();
+            std::vector<uint32_t> visible;
+            m_scene->CullMeshInstances( std::span( &frustum, 1 ), std::span( &visible, 1 ) );
+            ImGui::Text( "Instances in view frustum = %zu / %zu", visible.size(), m_scene->GetAllMeshInstances().size() );
         }
         ImGui::End();
 
@@ -180,95 +499,316 @@ namespace
         uint32_t pad[2];
     };
 
-    struct GPUTLASItemParams
-    {
-        glm::mat3x4 object_to_world_mat;
-        uint32_t geom_buf_index;
-        uint32_t material_index;
-        uint32_t picking_id;
-    };
+    static constexpr uint32_t MIN_MATERIAL_CAPACITY = 1024;
+    static constexpr uint32_t MIN_GEOM_CAPACITY = 1024;
 
-    static constexpr int MAX_SCENE_GEOMS = 256;
-    static constexpr int MAX_SCENE_MATERIALS = 256;
+    // bindings of the global set, must be in sync with SceneViewParams.hlsli
+    static constexpr uint32_t MATERIALS_BINDING = 0;
+    // index buffer of a geometry slot at 2 * slot, vertex buffer at 2 * slot + 1
+    static constexpr uint32_t GEOMETRY_BINDING = 1;
 }
 
 GlobalDescriptors::GlobalDescriptors()
+    : m_geom_slots( std::min( BindlessSlotAllocator::MaxSlots, GetRHI().GetMaxBindlessDescriptors( RHIShaderBindingType::StructuredBuffer ) / 2 ) )
 {
-    m_free_geom_slots.resize( MAX_SCENE_GEOMS );
-    for ( uint32_t i = 0; i < m_free_geom_slots.size(); ++i )
     {
-        m_free_geom_slots[i] = uint32_t( m_free_geom_slots.size() ) - i - 1;
+        RHI::DescriptorViewRange ranges[2] = {};
+
+        ranges[MATERIALS_BINDING].type = RHIShaderBindingType::StructuredBuffer;
+        ranges[MATERIALS_BINDING].count = 1;
+        ranges[MATERIALS_BINDING].stages = RHIShaderStageFlags::AllBits;
+
+        // size is set per descriptor set, see UpdateDescSet
+        ranges[GEOMETRY_BINDING].type = RHIShaderBindingType::StructuredBuffer;
+        ranges[GEOMETRY_BINDING].count = -1;
+        ranges[GEOMETRY_BINDING].stages = RHIShaderStageFlags::AllBits;
+
+        RHI::DescriptorSetLayoutInfo dsl_info = {};
+        dsl_info.ranges = ranges;
+        dsl_info.range_count = std::size( ranges );
+
+        m_global_dsl = GetRHI().CreateDescriptorSetLayout( dsl_info );
     }
 
+    ResizeMaterialBuffer( MIN_MATERIAL_CAPACITY );
+
+    // no frame uses it yet, the first FlushUpdates writes to it in place
+    UpdateDescSet( m_cur_desc_set );
+}
 
+GlobalDescriptors::GeometryHandle GlobalDescriptors::AddGeometry( const RHIBufferViewInfo& vertices, const RHIBufferViewInfo& indices )
+{
+    std::scoped_lock lock( m_cs );
+
+    const GeometryHandle handle = m_geom_slots.Allocate();
+    if ( !handle.IsValid() )
     {
-        RHI::DescriptorViewRange ranges[3] = {};
+        SE_LOG_ERROR( Renderer, "Scene geometry table is full, %u geometries", m_geom_slots.GetMaxSlots() );
+        return handle;
+    }
 
-        ranges[0].type = RHIShaderBindingType::StructuredBuffer;
-        ranges[0].count = MAX_SCENE_GEOMS;
-        ranges[0].stages = RHIShaderStageFlags::AllBits;
+    // descriptor sets are written by FlushUpdates, once the frames that use them are completed
+    const uint32_t geom_index = handle.GetIndex();
+    if ( geom_index >= m_geometries.size() )
+        m_geometries.resize( geom_index + 1 );
 
-        ranges[1].type = RHIShaderBindingType::StructuredBuffer;
-        ranges[1].count = MAX_SCENE_GEOMS;
-        ranges[1].stages = RHIShaderStageFlags::AllBits;
+    m_geometries[geom_index] = GeometryViews{ indices, vertices };
+    m_dirty_geometries.MarkDirty( geom_index );
 
-        ranges[2].type = RHIShaderBindingType::StructuredBuffer;
-        ranges[2].count = 1;
-        ranges[2].stages = RHIShaderStageFlags::AllBits;
+    return handle;
+}
 
-        RHI::DescriptorSetLayoutInfo dsl_info = {};
-        dsl_info.ranges = ranges;
-        dsl_info.range_count = std::size( ranges );
+bool GlobalDescriptors::RemoveGeometry( GeometryHandle handle )
+{
+    std::scoped_lock lock( m_cs );
 
-        m_global_dsl = GetRHI().CreateDescriptorSetLayout( dsl_info );
+    if ( !m_geom_slots.Free( handle, m_current_frame ) )
+        return false;
+
+    // descriptors are left bound, partially bound arrays don't need them cleared. Sets written from now on skip the slot
+    m_geometries[handle.GetIndex()] = {};
+    return true;
+}
+
+GlobalDescriptors::MaterialHandle GlobalDescriptors::AddMaterial( const MaterialGPU& material_data )
+{
+    std::scoped_lock lock( m_cs );
+
+    const MaterialHandle handle = m_material_slots.Allocate();
+    if ( !handle.IsValid() )
+    {
+        SE_LOG_ERROR( Renderer, "Scene material table is full, %u materials", m_material_slots.GetMaxSlots() );
+        return handle;
     }
 
-    m_global_descset = GetRHI().CreateDescriptorSet( *m_global_dsl );
+    const uint32_t material_index = handle.GetIndex();
+    if ( material_index >= m_materials.size() )
+        m_materials.resize( material_index + 1 );
+
+    m_materials[material_index] = material_data;
+    m_dirty_materials.MarkDirty( material_index );
+
+    return handle;
+}
+
+bool GlobalDescriptors::UpdateMaterial( MaterialHandle handle, const MaterialGPU& material_data )
+{
+    std::scoped_lock lock( m_cs );
+
+    if ( !m_material_slots.IsAlive( handle ) )
+        return false;
+
+    m_materials[handle.GetIndex()] = material_data;
+    m_dirty_materials.MarkDirty( handle.GetIndex() );
+
+    return true;
+}
 
-    m_free_material_slots.resize( MAX_SCENE_MATERIALS );
-    for ( uint32_t i = 0; i < m_free_material_slots.size(); ++i )
+bool GlobalDescriptors::RemoveMaterial( MaterialHandle handle )
+{
+    std::scoped_lock lock( m_cs );
+
+    return m_material_slots.Free( handle, m_current_frame );
+}
+
+void GlobalDescriptors::FlushUpdates()
+{
+    std::scoped_lock lock( m_cs );
+
+    RecycleSlots();
+
+    m_stats.last_material_upload_size = 0;
+
+    const uint32_t num_materials = uint32_t( m_materials.size() );
+    if ( num_materials > m_stats.material_capacity )
+        ResizeMaterialBuffer( num_materials );
+
+    if ( m_dirty_materials.NeedsFullUpdate( 0 ) )
+    {
+        m_upload_ranges.clear();
+        if ( num_materials > 0 )
+            m_upload_ranges.emplace_back( RingBufferDirtyTracker::Range{ 0, num_materials } );
+        m_dirty_materials.MarkClean( 0 );
+    }
+    else
     {
-        m_free_material_slots[i] = uint32_t( m_free_material_slots.size() ) - i - 1;
+        m_dirty_materials.ConsumeDirtyRanges( 0, num_materials, r_materialUploadMergeGap.GetValue(), m_upload_ranges );
     }
 
-    RHI::BufferInfo material_buffer_info = {};
-    material_buffer_info.name = "global_material_buf";
-    material_buffer_info.size = sizeof( MaterialGPU ) * MAX_SCENE_MATERIALS;
-    material_buffer_info.usage = RHIBufferUsageFlags::StructuredBuffer;
+    if ( !m_upload_ranges.empty() )
+    {
+        GPUUploadManager& upload_mgr = GetUploadManager();
+        for ( const RingBufferDirtyTracker::Range& range : m_upload_ranges )
+        {
+            const size_t size = sizeof( MaterialGPU ) * range.count;
+            upload_mgr.UploadBuffer( *m_material_buffer, sizeof( MaterialGPU ) * range.first, m_materials.data() + range.first, size );
+
+            m_stats.last_material_upload_size += size;
+            m_stats.material_uploads++;
+        }
+        m_stats.material_upload_size += m_stats.last_material_upload_size;
+
+        // queue order puts the copies before the frame
+        upload_mgr.Submit();
+    }
+
+    // an up-to-date set is shared with the frames in flight, nothing is written to it
+    if ( IsDescSetUpToDate( m_cur_desc_set ) )
+    {
+        m_desc_sets[m_cur_desc_set].frame = m_current_frame;
+        return;
+    }
+
+    if ( m_desc_sets[m_cur_desc_set].frame > m_completed_frame )
+    {
+        // the current set may be read by the GPU or be bound in a command list of this frame already, take the next one
+        const uint32_t next_set = ( m_cur_desc_set + 1 ) % NumDescSets;
+        DescSetState& next = m_desc_sets[next_set];
+        if ( next.frame == m_current_frame )
+        {
+            SE_LOG_WARNING( Renderer, "All scene descriptor sets are used by the current frame, geometry changes are postponed to the next frame" );
+            return;
+        }
+        if ( next.frame > m_completed_frame )
+        {
+            // with a ring longer than the number of frames in flight this is rare
+            GetRHI().WaitForFenceCompletion( next.fence );
+            RecycleSlots();
+        }
+        m_cur_desc_set = next_set;
+    }
+
+    UpdateDescSet( m_cur_desc_set );
+    m_desc_sets[m_cur_desc_set].frame = m_current_frame;
+}
+
+void GlobalDescriptors::OnFrameSubmitted( const RHIFence& frame_fence )
+{
+    std::scoped_lock lock( m_cs );
+
+    m_submitted_frames.emplace_back( SubmittedFrame{ m_current_frame, frame_fence } );
+    for ( DescSetState& desc_set : m_desc_sets )
+    {
+        if ( desc_set.frame == m_current_frame )
+            desc_set.fence = frame_fence;
+    }
+    m_current_frame++;
+
+    RecycleSlots();
+}
+
+GlobalDescriptors::Stats GlobalDescriptors::GetStats() const
+{
+    std::scoped_lock lock( m_cs );
+    return m_stats;
+}
+
+uint32_t GlobalDescriptors::GetNumGeometries() const
+{
+    std::scoped_lock lock( m_cs );
+    return m_geom_slots.GetNumAllocated();
+}
+
+uint32_t GlobalDescriptors::GetNumMaterials() const
+{
+    std::scoped_lock lock( m_cs );
+    return m_material_slots.GetNumAllocated();
+}
+
+void GlobalDescriptors::RecycleSlots()
+{
+    uint64_t completed_frame = 0;
+    while ( !m_submitted_frames.empty() && GetRHI().IsFenceCompleted( m_submitted_frames.front().fence ) )
+    {
+        completed_frame = m_submitted_frames.front().frame;
+        m_submitted_frames.pop_front();
+    }
 
-    // @todo - this should be device buffer instead of upload, given how often its updated and accessed
-    m_material_buffer = GetRHI().CreateUploadBuffer( material_buffer_info );
+    if ( completed_frame == 0 )
+        return;
 
-    RHIBufferViewInfo material_buffer_view_info = {};
-    material_buffer_view_info.buffer = m_material_buffer->GetBuffer();
-    m_global_descset->BindStructuredBuffer( 2, 0, material_buffer_view_info );
+    m_completed_frame = completed_frame;
+    m_geom_slots.Recycle( completed_frame );
+    m_material_slots.Recycle( completed_frame );
 }
 
-uint32_t GlobalDescriptors::AddGeometry( const RHIBufferViewInfo& vertices, const RHIBufferViewInfo& indices )
+void GlobalDescriptors::ResizeMaterialBuffer( uint32_t num_materials )
 {
-    if ( m_free_geom_slots.empty() )
-        return -1; // no place left
+    // doubles, so a growing scene reallocates a few times
+    const uint32_t capacity = std::min( std::max( { num_materials, m_stats.material_capacity * 2, MIN_MATERIAL_CAPACITY } ),
+                                        m_material_slots.GetMaxSlots() );
 
-    uint32_t geom_index = m_free_geom_slots.back();
-    m_free_geom_slots.pop_back();
+    RHI::BufferInfo material_buffer_info = {};
+    material_buffer_info.name = "global_material_buf";
+    material_buffer_info.size = sizeof( MaterialGPU ) * capacity;
+    material_buffer_info.usage = RHIBufferUsageFlags::StructuredBuffer | RHIBufferUsageFlags::TransferDst;
 
-    m_global_descset->BindStructuredBuffer( 0, geom_index, indices );
-    m_global_descset->BindStructuredBuffer( 1, geom_index, vertices );
+    // the old buffer is kept alive by the frames in flight, the new one is written from scratch
+    m_material_buffer = GetRHI().CreateDeviceBuffer( material_buffer_info );
+    m_stats.material_capacity = capacity;
+    m_dirty_materials.MarkAllDirty();
+}
 
-    return geom_index;
+bool GlobalDescriptors::IsDescSetUpToDate( uint32_t set_idx ) const
+{
+    const DescSetState& state = m_desc_sets[set_idx];
+    return state.set != nullptr
+        && state.geom_capacity >= m_geometries.size()
+        && state.material_buffer == m_material_buffer.get()
+        && !m_dirty_geometries.NeedsFullUpdate( set_idx )
+        && m_dirty_geometries.GetNumDirty( set_idx ) == 0;
 }
 
-uint32_t GlobalDescriptors::AddMaterial( const MaterialGPU& material_data )
+void GlobalDescriptors::UpdateDescSet( uint32_t set_idx )
 {
-    if ( m_free_material_slots.empty() )
-        return -1; // no place left
+    DescSetState& state = m_desc_sets[set_idx];
 
-    uint32_t material_index = m_free_material_slots.back();
-    m_free_material_slots.pop_back();
+    const uint32_t num_geoms = uint32_t( m_geometries.size() );
+    bool full_update = m_dirty_geometries.NeedsFullUpdate( set_idx );
+    if ( state.set == nullptr || state.geom_capacity < num_geoms )
+    {
+        // the descriptor count is fixed at allocation, so the set is recreated. Doubles, like the material buffer
+        state.geom_capacity = std::min( std::max( { num_geoms, state.geom_capacity * 2, MIN_GEOM_CAPACITY } ), m_geom_slots.GetMaxSlots() );
+        state.set = GetRHI().CreateBindlessDescriptorSet( *m_global_dsl, 2 * state.geom_capacity );
+        state.material_buffer = nullptr;
+        full_update = true;
+    }
+
+    auto bind_geometry = [&]( uint32_t geom_index )
+    {
+        const GeometryViews& views = m_geometries[geom_index];
+        if ( views.indices.buffer == nullptr )
+            return; // removed
 
-    m_material_buffer->WriteBytes( &material_data, sizeof( MaterialGPU ), material_index * sizeof( MaterialGPU ) );
+        state.set->BindStructuredBuffer( GEOMETRY_BINDING, 2 * geom_index, views.indices );
+        state.set->BindStructuredBuffer( GEOMETRY_BINDING, 2 * geom_index + 1, views.vertices );
+    };
 
-    return material_index;
+    if ( full_update )
+    {
+        for ( uint32_t geom_index = 0; geom_index < num_geoms; ++geom_index )
+            bind_geometry( geom_index );
+        m_dirty_geometries.MarkClean( set_idx );
+    }
+    else
+    {
+        m_dirty_geometries.ConsumeDirtyRanges( set_idx, num_geoms, 0, m_geometry_write_ranges );
+        for ( const RingBufferDirtyTracker::Range& range : m_geometry_write_ranges )
+        {
+            for ( uint32_t geom_index = range.first; geom_index < range.first + range.count; ++geom_index )
+                bind_geometry( geom_index );
+        }
+    }
+
+    if ( state.material_buffer != m_material_buffer.get() )
+    {
+        RHIBufferViewInfo material_buffer_view_info = {};
+        material_buffer_view_info.buffer = m_material_buffer.get();
+        state.set->BindStructuredBuffer( MATERIALS_BINDING, 0, material_buffer_view_info );
+        state.material_buffer = m_material_buffer.get();
+    }
+
+    state.set->FlushBinds();
 }
 
 
@@ -651,35 +1191,13 @@ void Renderer::UpdateSceneViewParams( const SceneViewFrameData& view_data )
 
     gpu_buffer.UploadData( svp );
 
-    auto& tlas_instances = view.GetScene().GetTLAS().Instances();
-
-    std::vector<GPUTLASItemParams> tlas_instances_data( tlas_instances.size() );
-    for ( size_t i = 0; i < tlas_instances.size(); ++i )
-    {
-        tlas_instances_data[i].object_to_world_mat = tlas_instances.data()[i].transform;
-    }
-
-    for ( const auto& mesh_instance : view.GetScene().GetAllMeshInstances() )
-    {
-        size_t packed_idx = tlas_instances.get_packed_idx( mesh_instance.m_tlas_instance );
-        tlas_instances_data[packed_idx].geom_buf_index = mesh_instance.m_asset->GetGlobalGeomIndex();
-        tlas_instances_data[packed_idx].material_index = -1;
-        const MaterialAsset* material = mesh_instance.m_asset->GetMaterial();
-        if ( material == nullptr )
-        {
-            material = m_default_material.get();
-        }
-        tlas_instances_data[packed_idx].material_index = material->GetGlobalMaterialIndex();
-        tlas_instances_data[packed_idx].picking_id = mesh_instance.picking_id;
-    }
-
-    UploadBufferRange gpu_tlas_item_params = view_data.rg->AllocateUploadBufferStructured<GPUTLASItemParams>( tlas_instances_data.size() );
-    gpu_tlas_item_params.UploadData( tlas_instances_data.data(), tlas_instances_data.size() );
+    // kept up to date by Scene::Synchronize, only changed instances are uploaded
+    const RHIBufferViewInfo gpu_tlas_item_params = view.GetScene().GetGPUInstanceParams();
 
     // Update descriptor set
     view_data.view_desc_set->BindAccelerationStructure( 0, 0, view.GetScene().GetTLAS().GetRHIAS() );
     view_data.view_desc_set->BindUniformBufferView( 1, 0, gpu_buffer.view );
-    view_data.view_desc_set->BindStructuredBuffer( 2, 0, gpu_tlas_item_params.view );
+    view_data.view_desc_set->BindStructuredBuffer( 2, 0, gpu_tlas_item_params );
     view_data.view_desc_set->BindStructuredBuffer( 3, 0, RHIBufferViewInfo{ view.GetDebugDrawData().m_lines_buf.get() } );
     view_data.view_desc_set->BindStructuredBuffer( 4, 0, RHIBufferViewInfo{ view.GetDebugDrawData().m_lines_indirect_args_buf.get() } );
     view_data.view_desc_set->BindStructuredBuffer( 5, 0, RHIBufferViewInfo{ view_data.readback_buf } );
@@ -717,7 +1235,7 @@ bool Renderer::RenderScene( const RenderSceneParams& parms )
     if ( !SE_ENSURE( parms.view && parms.rg ) )
         return false;
 
-    m_global_descriptors->GetDescSet().FlushBinds();
+    m_global_descriptors->FlushUpdates();
 
     SceneView& scene_view = *parms.view;
     Scene& scene = scene_view.GetScene();
@@ -772,6 +1290,8 @@ bool Renderer::RenderScene( const RenderSceneParams& parms )
 
     RGPass* rt_pass = rg.AddPass( RHI::QueueType::Graphics, "RaytraceScene" );
     rt_pass->UseTextureView( *scene_output[view_frame_data.scene_output_idx]->GetRWView() );
+    // writes the readback buffer and debug lines through the view descriptor set
+    rt_pass->SetHasUntrackedAccesses();
 
     RGExternalTextureDesc level_objects_id_desc = {};
     level_objects_id_desc.initial_layout = RHITextureLayout::ShaderReadOnly;
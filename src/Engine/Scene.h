@@ -6,6 +6,8 @@
 #include "RHIUtils.h"
 #include "Render/DebugDrawing.h"
 
+#include <utils/FrustumCulling.h>
+
 SE_LOG_CATEGORY( Renderer );
 
 class BlitTextureProgram;
@@ -15,49 +17,129 @@ class Rendergraph;
 class RGTexture;
 class DisplayMapping;
 
+struct GPUTLASItemParams;
+
+// Modified through Scene, so that the scene knows which instances have to be synchronized with the renderer
 class SceneMeshInstance
 {
-public:
-    // @todo - incapsulate as soon as it becomes more than simple getter/setter pair
+    friend class Scene;
+
     MeshAssetPtr m_asset = nullptr;
 
     Transform m_tf = {};
 
     TLAS::InstanceID m_tlas_instance = TLAS::InstanceID::nullid;
 
-    int32_t picking_id = -1;
+    int32_t m_picking_id = -1;
+
+    bool m_dirty = false;
+
+public:
+    const MeshAssetPtr& GetAsset() const { return m_asset; }
+    const Transform& GetTransform() const { return m_tf; }
+    TLAS::InstanceID GetTLASInstance() const { return m_tlas_instance; }
+    int32_t GetPickingID() const { return m_picking_id; }
 };
 using SceneMeshInstanceList = packed_freelist<SceneMeshInstance>;
 using SceneMeshInstanceID = SceneMeshInstanceList::id;
 
+struct SceneRayHit
+{
+    SceneMeshInstanceID instance = SceneMeshInstanceID::nullid;
+    float t = FLT_MAX;
+    uint32_t triangle = BVHHit::Invalid;
+    glm::vec2 barycentrics = glm::vec2( 0, 0 ); // of the second and the third triangle vertex
+    glm::vec3 position = ZeroVec3();
+
+    bool IsHit() const { return instance != SceneMeshInstanceID::nullid; }
+};
+
 class Scene
 {
 private:
     std::unique_ptr<TLAS> m_tlas;
     SceneMeshInstanceList m_mesh_instances;
 
+    // changed since the last Synchronize call
+    std::vector<SceneMeshInstanceID> m_dirty_mesh_instances;
+
+    // shader-visible params of mesh instances, in the same order as TLAS instances. Ring of upload buffers, one is written per Synchronize call
+    static constexpr uint32_t m_num_instance_param_bufs = 3;
+    std::vector<GPUTLASItemParams> m_instance_params;
+    RHIUploadBufferPtr m_gpu_instance_params[m_num_instance_param_bufs] = {};
+    uint32_t m_cur_instance_params_buf = 0;
+    RingBufferDirtyTracker m_dirty_instance_params = RingBufferDirtyTracker( m_num_instance_param_bufs );
+    std::vector<RingBufferDirtyTracker::Range> m_instance_params_ranges;
+
+    // CPU hierarchy for ray queries. Instances are in the same order as TLAS instances
+    InstanceBVH m_cpu_tlas;
+    std::vector<InstanceBVH::Instance> m_cpu_instances;
+    std::vector<SceneMeshInstanceID> m_cpu_instance_ids;
+    // as of the last build. Instances may be removed before the next Synchronize, their meshes have to stay alive until then
+    struct CPUTLASItem
+    {
+        SceneMeshInstanceID id;
+        MeshAssetPtr asset;
+    };
+    std::vector<CPUTLASItem> m_cpu_tlas_items;
+    std::vector<uint32_t> m_moved_cpu_instances; // since the last Synchronize call
+    bool m_cpu_tlas_needs_rebuild = false;
+    bool m_cpu_tlas_needs_refit = false;
+
+    // world space bounds of mesh instances for frustum culling, same order as TLAS instances. Rebuilt and refit together with the CPU TLAS
+    CullingBVH m_culling_bvh;
+    std::vector<BVHBounds> m_culling_bounds;
+
     TextureAssetPtr m_env_cubemap;
 
 public:
     Scene();
+    ~Scene();
 
     SceneMeshInstanceID AddMeshInstanceFromAsset( MeshAssetPtr base_asset );
     void RemoveMeshInstance( SceneMeshInstanceID id );
-    SceneMeshInstance* GetMeshInstance( SceneMeshInstanceID id ) { return m_mesh_instances.try_get( id ); };
     const SceneMeshInstance* GetMeshInstance( SceneMeshInstanceID id ) const { return m_mesh_instances.try_get( id ); }
 
+    // Changes are picked up by the next Synchronize call. Setting the same value again is cheap and doesn't mark the instance as changed
+    void SetMeshInstanceTransform( SceneMeshInstanceID id, const Transform& tf );
+    void SetMeshInstancePickingID( SceneMeshInstanceID id, int32_t picking_id );
+
     std::span<const SceneMeshInstance> GetAllMeshInstances() const { return std::span<const SceneMeshInstance>( m_mesh_instances.data(), m_mesh_instances.data() + m_mesh_instances.size() ); }
 
     TLAS& GetTLAS() { return *m_tlas; }
+    const TLAS& GetTLAS() const { return *m_tlas; }
+
+    // Params of all mesh instances, indexed by TLAS instance index. Valid until the next Synchronize call
+    RHIBufferViewInfo GetGPUInstanceParams() const;
 
     void SetEnvCubemap( TextureAssetPtr cubemap ) { m_env_cubemap = std::move( cubemap ); }
     TextureAsset* GetEnvCubemap() const { return m_env_cubemap.get(); }
 
-    // Call before any render operation on the scene. This makes changes made to scene objects (mesh instances, etc.) visible to the renderer
+    // Call once per frame before any render operation on the scene. This makes changes made to scene objects (mesh instances, etc.) visible to the renderer.
+    // Only instances changed since the previous call are processed
     void Synchronize();
 
+    // Ray queries on CPU, against the scene state of the last Synchronize call. Hit instances may have been removed since then.
+    // Direction doesn't have to be normalized, distances are measured in its lengths
+    bool CastRay( const BVHRay& ray, SceneRayHit& hit ) const;
+    bool CastRay( const glm::vec3& origin, const glm::vec3& direction, float max_t, SceneRayHit& hit ) const;
+    bool HasLineOfSight( const glm::vec3& from, const glm::vec3& to ) const;
+    // Rays are traversed in packets of 4, keep coherent rays next to each other
+    void CastRays( std::span<const BVHRay> rays, std::span<SceneRayHit> hits ) const;
+
+    // Culls mesh instances against all frustums in a single pass, as of the last Synchronize call. visible[i] receives TLAS instance indices
+    // (the ones GetGPUInstanceParams is indexed by) of the instances intersecting frustums[i]
+    void CullMeshInstances( std::span<const CullingFrustum> frustums, std::span<std::vector<uint32_t>> visible ) const;
+
 private:
-    void UpdateTLASTransforms();
+    void MarkDirty( SceneMeshInstanceID id, SceneMeshInstance& mesh_instance );
+
+    void SynchronizeDirtyMeshInstances();
+    void SynchronizeCPUTLAS();
+    void BuildCullingBVH();
+    void UploadInstanceParams();
+
+    SceneRayHit MakeRayHit( const BVHHit& hit, const BVHRay& ray ) const;
 };
 
 class SceneView
@@ -121,6 +203,10 @@ public:
     glm::mat4x4 CalcViewMatrix() const;
     glm::mat4x4 CalcProjectionMatrix() const;
 
+    // world space ray through the center of a pixel, from the near to the far plane
+    BVHRay CalcPixelRay( glm::uvec2 pixel ) const;
+    CullingFrustum CalcCullingFrustum() const;
+
     Scene& GetScene() const { return *m_scene; }
 
     void DebugUI() const;
@@ -154,24 +240,104 @@ struct RenderSceneParams
     int32_t outline_id = -1;
 };
 
+// Bindless tables of scene geometry and materials. Geometry goes to a variable-count descriptor array, materials to a device buffer
+// that grows with the number of slots in use. Material changes are uploaded once per frame, only the dirty ranges.
+// Descriptors can't be written while a frame that uses the set is in flight, so there is a ring of sets. Each frame gets the next one,
+// which is brought up to date once its previous frame has completed. A set that is too small for the geometry table is recreated.
+// Removed slots are reused once the frames that may read them are completed, see OnFrameSubmitted
 class GlobalDescriptors
 {
+public:
+    using GeometryHandle = BindlessSlotAllocator::Handle;
+    using MaterialHandle = BindlessSlotAllocator::Handle;
+
+    struct Stats
+    {
+        uint32_t material_capacity = 0; // of the device buffer
+        size_t last_material_upload_size = 0; // by the last FlushUpdates
+        size_t material_upload_size = 0; // since creation
+        uint32_t material_uploads = 0; // ranges written since creation
+    };
+
 private:
     RHIDescriptorSetLayoutPtr m_global_dsl;
-    RHIDescriptorSetPtr m_global_descset;
-    std::vector<uint32_t> m_free_geom_slots;
 
-    RHIUploadBufferPtr m_material_buffer;
-    std::vector<uint32_t> m_free_material_slots;
+    struct DescSetState
+    {
+        RHIDescriptorSetPtr set;
+        uint32_t geom_capacity = 0;
+        const RHIBuffer* material_buffer = nullptr; // bound to the set
+        uint64_t frame = 0; // last one that used the set, 0 if none
+        RHIFence fence = {}; // of that frame, once it's submitted
+    };
+    static constexpr uint32_t NumDescSets = 3;
+    std::array<DescSetState, NumDescSets> m_desc_sets;
+    uint32_t m_cur_desc_set = 0;
+
+    BindlessSlotAllocator m_geom_slots;
+    struct GeometryViews
+    {
+        RHIBufferViewInfo indices;
+        RHIBufferViewInfo vertices;
+    };
+    std::vector<GeometryViews> m_geometries; // covers every allocated slot, the buffer is null for removed ones
+    RingBufferDirtyTracker m_dirty_geometries = RingBufferDirtyTracker( NumDescSets );
+    std::vector<RingBufferDirtyTracker::Range> m_geometry_write_ranges;
+
+    RHIBufferPtr m_material_buffer;
+    BindlessSlotAllocator m_material_slots;
+    std::vector<MaterialGPU> m_materials; // mirror of the device buffer, covers every allocated slot
+    RingBufferDirtyTracker m_dirty_materials = RingBufferDirtyTracker( 1 );
+    std::vector<RingBufferDirtyTracker::Range> m_upload_ranges;
+
+    // frames submitted since the slots were freed, in order
+    struct SubmittedFrame
+    {
+        uint64_t frame = 0;
+        RHIFence fence = {};
+    };
+    std::deque<SubmittedFrame> m_submitted_frames;
+    uint64_t m_current_frame = 1;
+    uint64_t m_completed_frame = 0;
+
+    Stats m_stats = {};
+
+    // assets add and remove their slots from the upload stage, and are released on other threads
+    mutable std::mutex m_cs;
 
 public:
     GlobalDescriptors();
 
-    uint32_t AddGeometry( const RHIBufferViewInfo& vertices, const RHIBufferViewInfo& indices );
-    uint32_t AddMaterial( const MaterialGPU& material_data );
+    // Add returns invalid handles when the table is full. Update and Remove return false for stale handles
+    GeometryHandle AddGeometry( const RHIBufferViewInfo& vertices, const RHIBufferViewInfo& indices );
+    bool RemoveGeometry( GeometryHandle handle );
 
-    RHIDescriptorSet& GetDescSet() const { return *m_global_descset; }
+    MaterialHandle AddMaterial( const MaterialGPU& material_data );
+    bool UpdateMaterial( MaterialHandle handle, const MaterialGPU& material_data );
+    bool RemoveMaterial( MaterialHandle handle );
+
+    // Grows the material buffer if needed, uploads the changed materials with GPUUploadManager and writes the changed descriptors
+    // to the set of this frame. Renderer calls it before recording a frame
+    void FlushUpdates();
+    // The fence of a frame that may have read the tables, slots removed until then are reused once it is signaled
+    void OnFrameSubmitted( const RHIFence& frame_fence );
+
+    Stats GetStats() const;
+    uint32_t GetNumGeometries() const;
+    uint32_t GetNumMaterials() const;
+
+    // the set of the current frame, valid after FlushUpdates
+    RHIDescriptorSet& GetDescSet() const { return *m_desc_sets[m_cur_desc_set].set; }
     RHIDescriptorSetLayout* GetLayout() const { return m_global_dsl.get(); }
+    // replaced when it grows
+    RHIBuffer* GetMaterialBuffer() const { return m_material_buffer.get(); }
+
+private:
+    void RecycleSlots();
+    void ResizeMaterialBuffer( uint32_t num_materials );
+
+    bool IsDescSetUpToDate( uint32_t set_idx ) const;
+    void UpdateDescSet( uint32_t set_idx );
 };
 
 struct ViewFrameReadbackData
@@ -234,6 +400,8 @@ public:
 
     RHIReadbackBufferPtr CreateViewFrameReadbackBuffer() const;
 
+    const MaterialAsset* GetDefaultMaterial() const { return m_default_material.get(); }
+
 private:
 
     void CreatePrograms();
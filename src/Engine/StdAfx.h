@@ -26,6 +26,7 @@ struct EngineGlobals
 {
     class RHI* rhi;
     class AssetManager* asset_mgr = nullptr;
+    class GPUUploadManager* upload_mgr = nullptr;
     class Console* console = nullptr;
     class Renderer* renderer = nullptr;
 };
@@ -34,5 +35,6 @@ extern EngineGlobals g_engine;
 
 inline RHI& GetRHI() { return *g_engine.rhi; }
 inline AssetManager& GetAssetManager() { return *g_engine.asset_mgr; }
+inline GPUUploadManager& GetUploadManager() { return *g_engine.upload_mgr; }
 inline Console& GetConsole() { return *g_engine.console; }
 inline Renderer& GetRenderer() { return *g_engine.renderer; }
\ No newline at end of file
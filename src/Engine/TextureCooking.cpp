@@ -0,0 +1,327 @@
+#include "StdAfx.h"
+
+#include "TextureCooking.h"
+
+#include <filesystem>
+#include <thread>
+
+namespace
+{
+    uint64_t AlignSection( uint64_t offset )
+    {
+        return ( offset + CookedTextureHeader::SectionAlignment - 1 ) & ~( CookedTextureHeader::SectionAlignment - 1 );
+    }
+
+    bool IsSectionValid( uint64_t offset, uint64_t size, uint64_t file_size )
+    {
+        return offset % CookedTextureHeader::SectionAlignment == 0 && offset <= file_size && size <= file_size - offset;
+    }
+
+    MipContent GetMipContent( TextureUsage usage )
+    {
+        switch ( usage )
+        {
+        case TextureUsage::Color:
+            return MipContent::SRGB;
+        case TextureUsage::NormalMap:
+            return MipContent::NormalMap;
+        case TextureUsage::HDR:
+            return MipContent::HDR;
+        default:
+            return MipContent::Linear;
+        }
+    }
+
+    bool ImportEXR( const char* ospath, TextureImage& image )
+    {
+        float* pixels = nullptr;
+        int width = 0;
+        int height = 0;
+        const char* err = nullptr;
+
+        const int ret = LoadEXR( &pixels, &width, &height, ospath, &err );
+
+        BOOST_SCOPE_EXIT( pixels )
+        {
+            if ( pixels )
+            {
+                free( pixels );
+            }
+        } BOOST_SCOPE_EXIT_END
+
+        if ( ret != TINYEXR_SUCCESS || pixels == nullptr )
+        {
+            SE_LOG_ERROR( Engine, "Could not load EXR file at <%s>", ospath );
+            if ( err )
+            {
+                SE_LOG_ERROR( Engine, "[TinyEXR]: %s", err );
+                FreeEXRErrorMessage( err );
+            }
+            return false;
+        }
+
+        image.width = uint32_t( width );
+        image.height = uint32_t( height );
+        image.texels.assign( pixels, pixels + size_t( width ) * height * 4 );
+        return true;
+    }
+}
+
+bool ImportTexture( const char* ospath, TextureImage& image, bool& is_hdr )
+{
+    uint32_t signature = 0;
+    {
+        std::ifstream file_stream( ospath, std::ios_base::in | std::ios_base::binary );
+        if ( !file_stream.good() )
+        {
+            SE_LOG_ERROR( Engine, "Could not load texture file at <%s>", ospath );
+            return false;
+        }
+
+        file_stream.read( reinterpret_cast<char*>( &signature ), sizeof( signature ) );
+        if ( file_stream.eof() || !file_stream.good() )
+        {
+            SE_LOG_ERROR( Engine, "Could not load file signature at <%s>", ospath );
+            return false;
+        }
+    }
+
+    static constexpr uint32_t SIGNATURE_EXR = 0x01312F76;
+    if ( signature == SIGNATURE_EXR )
+    {
+        is_hdr = true;
+        return ImportEXR( ospath, image );
+    }
+
+    is_hdr = stbi_is_hdr( ospath ) != 0;
+
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    if ( is_hdr )
+    {
+        float* pixels = stbi_loadf( ospath, &width, &height, &channels, STBI_rgb_alpha );
+        if ( pixels == nullptr )
+        {
+            SE_LOG_ERROR( Engine, "Could not load texture file at <%s>: %s", ospath, stbi_failure_reason() );
+            return false;
+        }
+        image.texels.assign( pixels, pixels + size_t( width ) * height * 4 );
+        stbi_image_free( pixels );
+    }
+    else
+    {
+        stbi_uc* pixels = stbi_load( ospath, &width, &height, &channels, STBI_rgb_alpha );
+        if ( pixels == nullptr )
+        {
+            SE_LOG_ERROR( Engine, "Could not load texture file at <%s>: %s", ospath, stbi_failure_reason() );
+            return false;
+        }
+        image.texels.resize( size_t( width ) * height * 4 );
+        for ( size_t i = 0; i < image.texels.size(); ++i )
+            image.texels[i] = float( pixels[i] ) / 255.0f;
+        stbi_image_free( pixels );
+    }
+
+    image.width = uint32_t( width );
+    image.height = uint32_t( height );
+    return true;
+}
+
+TextureEncoding GetTextureEncoding( const TextureCookSettings& settings )
+{
+    if ( settings.encoding.has_value() )
+        return *settings.encoding;
+
+    switch ( settings.usage )
+    {
+    case TextureUsage::Data:
+        return settings.compress ? TextureEncoding::BC4 : TextureEncoding::RGBA8;
+    case TextureUsage::NormalMap:
+        return settings.compress ? TextureEncoding::BC5 : TextureEncoding::RGBA8;
+    case TextureUsage::HDR:
+        return settings.compress ? TextureEncoding::BC6H : TextureEncoding::RGB9E5;
+    default:
+        return settings.compress ? TextureEncoding::BC7 : TextureEncoding::RGBA8;
+    }
+}
+
+bool CookTexture( const TextureImage& image, const TextureCookSettings& settings, ITaskScheduler& scheduler, std::vector<uint8_t>& blob )
+{
+    if ( image.width == 0 || image.height == 0 || image.texels.size() != size_t( image.width ) * image.height * 4 )
+        return false;
+
+    const TextureEncoding encoding = GetTextureEncoding( settings );
+    if ( encoding >= TextureEncoding::Count || settings.usage >= TextureUsage::Count )
+        return false;
+
+    std::vector<TextureImage> mips( 1, image );
+    if ( settings.generate_mips )
+    {
+        MipSettings mip_settings;
+        mip_settings.filter = settings.mip_filter;
+        mip_settings.content = GetMipContent( settings.usage );
+        mip_settings.wrap = settings.wrap;
+        GenerateMips( mips, mip_settings, scheduler );
+    }
+
+    CookedTextureHeader header;
+    header.width = image.width;
+    header.height = image.height;
+    header.num_mips = uint32_t( mips.size() );
+    header.encoding = uint8_t( encoding );
+    header.usage = uint8_t( settings.usage );
+
+    std::vector<CookedTextureMip> mip_table( mips.size() );
+    uint64_t data_size = 0;
+    for ( size_t i = 0; i < mips.size(); ++i )
+    {
+        CookedTextureMip& mip = mip_table[i];
+        mip.offset = AlignSection( data_size );
+        mip.size = GetEncodedSize( encoding, mips[i].width, mips[i].height );
+        mip.width = mips[i].width;
+        mip.height = mips[i].height;
+        data_size = mip.offset + mip.size;
+    }
+
+    header.mip_table_offset = AlignSection( sizeof( CookedTextureHeader ) );
+    header.data_offset = AlignSection( header.mip_table_offset + mip_table.size() * sizeof( CookedTextureMip ) );
+    header.data_size = data_size;
+    header.file_size = header.data_offset + header.data_size;
+
+    // zeroed padding keeps cooked files deterministic
+    blob.assign( size_t( header.file_size ), 0 );
+    memcpy( blob.data(), &header, sizeof( header ) );
+    memcpy( blob.data() + header.mip_table_offset, mip_table.data(), mip_table.size() * sizeof( CookedTextureMip ) );
+
+    for ( size_t i = 0; i < mips.size(); ++i )
+    {
+        uint8_t* dst = blob.data() + header.data_offset + mip_table[i].offset;
+        EncodeTexture( encoding, mips[i].texels.data(), mips[i].width, mips[i].height, dst, scheduler );
+    }
+
+    return true;
+}
+
+bool MatchesCookSettings( const CookedTextureHeader& header, const TextureCookSettings& settings )
+{
+    const uint32_t num_mips = settings.generate_mips ? GetNumMips( header.width, header.height ) : 1;
+    return header.usage == uint8_t( settings.usage ) && header.encoding == uint8_t( GetTextureEncoding( settings ) ) && header.num_mips == num_mips;
+}
+
+bool WriteCookedTexture( const char* ospath, const std::span<const uint8_t>& blob )
+{
+    const std::filesystem::path path = ospath;
+    // loader threads may cook the same source at once, each of them writes its own temporary file
+    std::filesystem::path tmp_path = path;
+    tmp_path += ".tmp" + std::to_string( std::hash<std::thread::id>{}( std::this_thread::get_id() ) );
+
+    {
+        std::ofstream file( tmp_path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc );
+        file.write( reinterpret_cast<const char*>( blob.data() ), std::streamsize( blob.size() ) );
+        if ( !file.good() )
+        {
+            SE_LOG_ERROR( Engine, "Could not write cooked texture to <%s>", tmp_path.string().c_str() );
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename( tmp_path, path, ec );
+    if ( ec )
+    {
+        SE_LOG_ERROR( Engine, "Could not move cooked texture to <%s>: %s", ospath, ec.message().c_str() );
+        std::filesystem::remove( tmp_path, ec );
+        return false;
+    }
+
+    return true;
+}
+
+bool CookedTextureView::Init( const std::span<const uint8_t>& blob )
+{
+    m_header = nullptr;
+    m_blob = {};
+
+    if ( blob.size() < sizeof( CookedTextureHeader ) || reinterpret_cast<uintptr_t>( blob.data() ) % alignof( CookedTextureHeader ) != 0 )
+        return false;
+
+    const CookedTextureHeader* header = reinterpret_cast<const CookedTextureHeader*>( blob.data() );
+    if ( header->magic != CookedTextureHeader::Magic || header->version != CookedTextureHeader::CurrentVersion )
+        return false;
+
+    const uint64_t file_size = header->file_size;
+    const bool valid = file_size == blob.size()
+        && header->width > 0 && header->height > 0
+        && header->num_mips > 0 && header->num_mips <= GetNumMips( header->width, header->height )
+        && header->encoding < uint8_t( TextureEncoding::Count )
+        && header->usage < uint8_t( TextureUsage::Count )
+        && IsSectionValid( header->mip_table_offset, uint64_t( header->num_mips ) * sizeof( CookedTextureMip ), file_size )
+        && IsSectionValid( header->data_offset, header->data_size, file_size );
+    if ( !valid )
+        return false;
+
+    m_header = header;
+    m_blob = blob;
+
+    // mips have to match the RHI mip chain, so the table can be used as copy regions
+    bool mips_valid = true;
+    const std::span<const CookedTextureMip> mips = GetMips();
+    for ( uint32_t i = 0; i < header->num_mips; ++i )
+    {
+        const CookedTextureMip& mip = mips[i];
+        mips_valid &= mip.width == std::max( header->width >> i, 1u ) && mip.height == std::max( header->height >> i, 1u )
+            && mip.size == GetEncodedSize( GetEncoding(), mip.width, mip.height )
+            && IsSectionValid( mip.offset, mip.size, header->data_size );
+    }
+
+    if ( !mips_valid )
+    {
+        m_header = nullptr;
+        m_blob = {};
+        return false;
+    }
+
+    return true;
+}
+
+RHIFormat CookedTextureView::GetRHIFormat() const
+{
+    const bool srgb = GetUsage() == TextureUsage::Color;
+    switch ( GetEncoding() )
+    {
+    case TextureEncoding::RGBA8:
+        return srgb ? RHIFormat::R8G8B8A8_SRGB : RHIFormat::R8G8B8A8_UNORM;
+    case TextureEncoding::BC1:
+        return srgb ? RHIFormat::BC1_SRGB : RHIFormat::BC1_UNORM;
+    case TextureEncoding::BC4:
+        return RHIFormat::BC4_UNORM;
+    case TextureEncoding::BC5:
+        return RHIFormat::BC5_UNORM;
+    case TextureEncoding::BC6H:
+        return RHIFormat::BC6H_UFLOAT;
+    case TextureEncoding::BC7:
+        return srgb ? RHIFormat::BC7_SRGB : RHIFormat::BC7_UNORM;
+    case TextureEncoding::RGB9E5:
+        return RHIFormat::RGB9E5;
+    default:
+        NOTIMPL;
+        return RHIFormat::Undefined;
+    }
+}
+
+std::span<const CookedTextureMip> CookedTextureView::GetMips() const
+{
+    return std::span<const CookedTextureMip>( reinterpret_cast<const CookedTextureMip*>( m_blob.data() + m_header->mip_table_offset ), m_header->num_mips );
+}
+
+std::span<const uint8_t> CookedTextureView::GetData() const
+{
+    return m_blob.subspan( size_t( m_header->data_offset ), size_t( m_header->data_size ) );
+}
+
+std::span<const uint8_t> CookedTextureView::GetMipData( uint32_t mip ) const
+{
+    const CookedTextureMip& mip_info = GetMips()[mip];
+    return GetData().subspan( size_t( mip_info.offset ), size_t( mip_info.size ) );
+}
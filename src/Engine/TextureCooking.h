@@ -0,0 +1,102 @@
+#pragma once
+
+#include "StdAfx.h"
+
+#include <utils/TextureCompression.h>
+#include <utils/TextureMips.h>
+
+class ITaskScheduler;
+
+// Offline part of texture loading: source images are imported once, get a mip chain, are encoded and cooked into .setex blobs.
+// The data section of a cooked file is laid out the way it is copied into the texture, so it goes to the upload buffer as is.
+
+enum class TextureUsage : uint8_t
+{
+    Color = 0, // sRGB rgba, BC7
+    Data, // linear single channel like roughness or masks, BC4
+    NormalMap, // tangent space normals stored as n * 0.5 + 0.5, only xy are kept with BC5 and z is reconstructed by shaders
+    HDR, // unbounded linear rgb, BC6H, or RGB9E5 when compression is off
+
+    Count
+};
+
+// stb formats and OpenEXR. LDR images are converted to [0, 1], is_hdr is set for float sources
+bool ImportTexture( const char* ospath, TextureImage& image, bool& is_hdr );
+
+struct TextureCookSettings
+{
+    TextureUsage usage = TextureUsage::Color;
+    bool compress = true; // uncompressed textures are RGBA8, or RGB9E5 for HDR
+    std::optional<TextureEncoding> encoding; // overrides the one picked for the usage, e.g. BC1 for color textures without alpha
+    bool generate_mips = true;
+    MipFilter mip_filter = MipFilter::Kaiser;
+    bool wrap = true; // most textures tile
+};
+
+TextureEncoding GetTextureEncoding( const TextureCookSettings& settings );
+
+struct CookedTextureMip
+{
+    uint64_t offset = 0; // from the start of the data section
+    uint64_t size = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+// .setex layout: header, mip table, then the data section with mips from the largest one, each starting at a multiple of SectionAlignment.
+// All values are little endian
+struct CookedTextureHeader
+{
+    static constexpr uint32_t Magic = 0x58455445; // "ETEX"
+    static constexpr uint32_t CurrentVersion = 1;
+    static constexpr uint64_t SectionAlignment = 64;
+
+    uint32_t magic = Magic;
+    uint32_t version = CurrentVersion;
+    uint64_t file_size = 0;
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t num_mips = 0;
+    uint8_t encoding = 0; // TextureEncoding
+    uint8_t usage = 0; // TextureUsage
+    uint16_t reserved = 0;
+
+    uint64_t mip_table_offset = 0;
+    uint64_t data_offset = 0;
+    uint64_t data_size = 0;
+};
+static_assert( sizeof( CookedTextureHeader ) % 8 == 0 );
+
+// Generates mips if requested and encodes every level in parallel on the scheduler
+bool CookTexture( const TextureImage& image, const TextureCookSettings& settings, ITaskScheduler& scheduler, std::vector<uint8_t>& blob );
+
+// False when cooking with the settings would give a different format or mip count, e.g. after the usage of the asset was changed.
+// Filter settings are not stored and are not compared
+bool MatchesCookSettings( const CookedTextureHeader& header, const TextureCookSettings& settings );
+
+// Writes to a temporary file first, so a concurrent reader never sees a partially written blob
+bool WriteCookedTexture( const char* ospath, const std::span<const uint8_t>& blob );
+
+// Read-only view into a cooked blob, usually a memory mapped file. The header and the mip table are validated,
+// encoded data is trusted. The blob must outlive the view and be 8 byte aligned, mappings and heap allocations are
+class CookedTextureView
+{
+public:
+    bool Init( const std::span<const uint8_t>& blob );
+
+    const CookedTextureHeader& GetHeader() const { return *m_header; }
+    TextureEncoding GetEncoding() const { return TextureEncoding( m_header->encoding ); }
+    TextureUsage GetUsage() const { return TextureUsage( m_header->usage ); }
+    // sRGB variants for color textures
+    RHIFormat GetRHIFormat() const;
+
+    std::span<const CookedTextureMip> GetMips() const;
+    // all mips, copy regions are the mip table offsets
+    std::span<const uint8_t> GetData() const;
+    std::span<const uint8_t> GetMipData( uint32_t mip ) const;
+
+private:
+    const CookedTextureHeader* m_header = nullptr;
+    std::span<const uint8_t> m_blob;
+};
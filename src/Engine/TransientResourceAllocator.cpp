@@ -0,0 +1,139 @@
+#include "StdAfx.h"
+
+#include "TransientResourceAllocator.h"
+
+namespace
+{
+    bool LifetimesOverlap( const TransientResourceAllocator::Request& a, const TransientResourceAllocator::Request& b )
+    {
+        return a.first_pass <= b.last_pass && b.first_pass <= a.last_pass;
+    }
+}
+
+void TransientResourceAllocator::Allocate( std::span<const Request> requests, uint64_t max_heap_size, Result& result )
+{
+    result.placements.assign( requests.size(), Placement{} );
+    result.heap_sizes.clear();
+    result.requested_size = 0;
+    result.total_heap_size = 0;
+    result.aliased_count = 0;
+
+    for ( auto& heap_requests : m_heap_requests )
+        heap_requests.clear();
+
+    m_sorted_requests.resize( requests.size() );
+    for ( uint32_t i = 0; i < uint32_t( requests.size() ); ++i )
+    {
+        m_sorted_requests[i] = i;
+        result.requested_size += requests[i].size;
+    }
+
+    // Big resources first, they are the hardest to fit. Ties are broken by lifetime start to keep the result stable
+    std::sort( m_sorted_requests.begin(), m_sorted_requests.end(), [&requests]( uint32_t a, uint32_t b )
+    {
+        if ( requests[a].size != requests[b].size )
+            return requests[a].size > requests[b].size;
+        if ( requests[a].first_pass != requests[b].first_pass )
+            return requests[a].first_pass < requests[b].first_pass;
+        return a < b;
+    } );
+
+    for ( uint32_t request_idx : m_sorted_requests )
+    {
+        const Request& request = requests[request_idx];
+        Placement& placement = result.placements[request_idx];
+
+        for ( uint32_t heap = 0; heap < uint32_t( result.heap_sizes.size() ); ++heap )
+        {
+            uint64_t offset = 0;
+            if ( TryPlace( requests, result, heap, request_idx, max_heap_size, offset ) )
+            {
+                placement.heap = heap;
+                placement.offset = offset;
+                break;
+            }
+        }
+
+        if ( placement.heap == InvalidHeap )
+        {
+            placement.heap = uint32_t( result.heap_sizes.size() );
+            placement.offset = 0;
+            result.heap_sizes.emplace_back( 0 );
+            if ( m_heap_requests.size() < result.heap_sizes.size() )
+                m_heap_requests.emplace_back();
+        }
+
+        uint64_t& heap_size = result.heap_sizes[placement.heap];
+        heap_size = std::max( heap_size, placement.offset + request.size );
+        m_heap_requests[placement.heap].emplace_back( request_idx );
+    }
+
+    // Aliasing report. For every resource find the one that used intersecting memory most recently before it
+    for ( size_t heap = 0; heap < result.heap_sizes.size(); ++heap )
+    {
+        const auto& heap_requests = m_heap_requests[heap];
+        for ( uint32_t request_idx : heap_requests )
+        {
+            const Request& request = requests[request_idx];
+            Placement& placement = result.placements[request_idx];
+
+            for ( uint32_t other_idx : heap_requests )
+            {
+                const Request& other = requests[other_idx];
+                if ( other.last_pass >= request.first_pass )
+                    continue;
+
+                const Placement& other_placement = result.placements[other_idx];
+                const bool memory_overlaps = other_placement.offset < placement.offset + request.size
+                    && placement.offset < other_placement.offset + other.size;
+                if ( !memory_overlaps )
+                    continue;
+
+                if ( placement.aliased_request == NoAliasing || requests[placement.aliased_request].last_pass < other.last_pass )
+                    placement.aliased_request = other_idx;
+            }
+
+            if ( placement.aliased_request != NoAliasing )
+                result.aliased_count++;
+        }
+
+        result.total_heap_size += result.heap_sizes[heap];
+    }
+}
+
+bool TransientResourceAllocator::TryPlace( std::span<const Request> requests, const Result& result, uint32_t heap, uint32_t request_idx, uint64_t max_heap_size, uint64_t& out_offset )
+{
+    const Request& request = requests[request_idx];
+
+    // Memory ranges of the resources alive at the same time as the new one
+    m_live_ranges.clear();
+    for ( uint32_t placed_idx : m_heap_requests[heap] )
+    {
+        const Request& placed = requests[placed_idx];
+        if ( !LifetimesOverlap( request, placed ) )
+            continue;
+
+        const uint64_t begin = result.placements[placed_idx].offset;
+        m_live_ranges.emplace_back( PlacedRange{ begin, begin + placed.size } );
+    }
+
+    std::sort( m_live_ranges.begin(), m_live_ranges.end(), []( const PlacedRange& a, const PlacedRange& b ) { return a.begin < b.begin; } );
+
+    // First fit into the gaps between live ranges
+    uint64_t candidate = 0;
+    for ( const PlacedRange& range : m_live_ranges )
+    {
+        const uint64_t aligned_candidate = CalcAlignedSize( candidate, request.alignment );
+        if ( aligned_candidate + request.size <= range.begin )
+            break;
+
+        candidate = std::max( candidate, range.end );
+    }
+    candidate = CalcAlignedSize( candidate, request.alignment );
+
+    if ( candidate + request.size > max_heap_size )
+        return false;
+
+    out_offset = candidate;
+    return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "StdAfx.h"
+
+// Packs resources with known lifetimes into as few memory heaps as possible. Lifetimes are inclusive ranges of pass indices,
+// two resources may share memory only if their lifetimes don't overlap.
+// Resources are placed greedily from the largest to the smallest one, each at the lowest offset of the first heap
+// where it doesn't intersect any already placed resource alive at the same time. Not thread-safe, keeps scratch memory between calls.
+class TransientResourceAllocator
+{
+public:
+    static constexpr uint32_t InvalidHeap = uint32_t( -1 );
+    static constexpr uint32_t NoAliasing = uint32_t( -1 );
+
+    struct Request
+    {
+        uint64_t size = 0;
+        uint64_t alignment = 1;
+        uint32_t first_pass = 0;
+        uint32_t last_pass = 0;
+    };
+
+    struct Placement
+    {
+        uint32_t heap = InvalidHeap;
+        uint64_t offset = 0;
+
+        // request that used (part of) this memory range last before this one, NoAliasing if memory is used for the first time
+        uint32_t aliased_request = NoAliasing;
+    };
+
+    struct Result
+    {
+        std::vector<Placement> placements; // one per request
+        std::vector<uint64_t> heap_sizes;
+
+        uint64_t requested_size = 0; // memory needed without aliasing
+        uint64_t total_heap_size = 0;
+        size_t aliased_count = 0;
+    };
+
+    // Requests bigger than max_heap_size get a dedicated heap
+    void Allocate( std::span<const Request> requests, uint64_t max_heap_size, Result& result );
+
+private:
+    struct PlacedRange
+    {
+        uint64_t begin = 0;
+        uint64_t end = 0;
+    };
+
+    std::vector<uint32_t> m_sorted_requests;
+    std::vector<std::vector<uint32_t>> m_heap_requests;
+    std::vector<PlacedRange> m_live_ranges;
+
+    bool TryPlace( std::span<const Request> requests, const Result& result, uint32_t heap, uint32_t request_idx, uint64_t max_heap_size, uint64_t& out_offset );
+};
@@ -2,9 +2,7 @@
 
 #include "Scene.h"
 
-#include <ecs/EntityContainer.h>
-
-// @todo - current ECS design requires all potential component types to be known at compile time. It is not convenient, switch to dynamic component registration later
+#include <ecs/DynamicEntityContainer.h>
 
 struct NameComponent
 {
@@ -42,15 +40,8 @@ struct EditorPickingComponent
 };
 
 
-using World = EntityContainer<
-	NameComponent,
-	DestroyEntityComponent,
-	TransformComponent,
-	MeshInstanceComponent,
-	MeshInstanceSetupComponent,
-	EnvCubemapComponent,
-	EditorPickingComponent
->;
+// Component types are registered in ComponentRegistry on first use, new components don't have to be listed here
+using World = DynamicEntityContainer;
 
 using WorldEntity = World::Entity;
 
@@ -0,0 +1,699 @@
+#include "StdAfx.h"
+
+#include "CommandLists.h"
+
+#include "NullRHIImpl.h"
+#include "Resources.h"
+
+namespace
+{
+    // Fixed-size arguments of the recorded commands. Arrays go to the payload right after them
+
+    struct NoArgs {};
+
+    struct CopyBufferArgs
+    {
+        NullBuffer* src = nullptr;
+        NullBuffer* dst = nullptr;
+        size_t region_count = 0; // payload: RHICommandList::CopyRegion[region_count]
+    };
+
+    struct DrawArgs
+    {
+        uint32_t vertex_count = 0;
+        uint32_t instance_count = 0;
+        uint32_t first_vertex = 0;
+        uint32_t first_instance = 0;
+    };
+
+    struct DrawIndexedArgs
+    {
+        uint32_t index_count = 0;
+        uint32_t instance_count = 0;
+        uint32_t first_index = 0;
+        int32_t vertex_offset = 0;
+        uint32_t first_instance = 0;
+    };
+
+    struct ObjectArgs
+    {
+        const void* object = nullptr;
+    };
+
+    struct BindDescriptorSetArgs
+    {
+        size_t slot_idx = 0;
+        const void* set = nullptr;
+    };
+
+    struct SetVertexBuffersArgs
+    {
+        uint32_t first_binding = 0;
+        size_t buffers_count = 0; // payload: const RHIBuffer*[buffers_count], size_t[buffers_count]
+    };
+
+    struct SetIndexBufferArgs
+    {
+        const RHIBuffer* buffer = nullptr;
+        RHIIndexBufferType type = RHIIndexBufferType::UInt16;
+        size_t offset = 0;
+    };
+
+    struct ArrayArgs
+    {
+        size_t first = 0;
+        size_t count = 0; // payload: count elements
+    };
+
+    struct BeginPassArgs
+    {
+        RHIRect2D render_area = {};
+        size_t render_targets_count = 0; // payload: RHIPassRTVInfo[render_targets_count]
+    };
+
+    struct CopyToTextureArgs
+    {
+        const void* src = nullptr;
+        const RHITexture* dst = nullptr;
+        size_t region_count = 0; // payload: regions
+    };
+
+    struct PushConstantsArgs
+    {
+        size_t offset = 0;
+        size_t size = 0; // payload: size bytes
+    };
+
+    struct BuildASArgs
+    {
+        const RHIBuffer* scratch = nullptr;
+        const RHIAccelerationStructure* dst = nullptr;
+        const RHIAccelerationStructure* src = nullptr;
+        RHIASBuildMode mode = RHIASBuildMode::Build;
+        RHIASBuildFlags flags = RHIASBuildFlags::None;
+        size_t geoms_count = 0; // payload: RHIASGeometryInfo[geoms_count]
+    };
+
+    struct WriteCompactedASSizesArgs
+    {
+        NullBuffer* dst = nullptr;
+        size_t dst_offset = 0;
+        size_t count = 0; // payload: const NullAccelerationStructure*[count]
+    };
+
+    struct CompactASArgs
+    {
+        const RHIAccelerationStructure* src = nullptr;
+        const RHIAccelerationStructure* dst = nullptr;
+    };
+}
+
+NullCommandList::NullCommandList( NullRHI* rhi, RHI::QueueType type, CmdListId list_id )
+    : m_type( type ), m_list_id( list_id ), m_rhi( rhi )
+{
+}
+
+NullCommandList::~NullCommandList()
+{
+}
+
+RHI::QueueType NullCommandList::GetType() const
+{
+    return m_type;
+}
+
+template<typename Args>
+void NullCommandList::Record( NullRHICall type, const Args& args, const void* payload, size_t payload_size )
+{
+    static_assert( std::is_trivially_copyable_v<Args> );
+
+    VERIFY( m_recording );
+
+    m_rhi->CountCall( type );
+
+    NullCommandHeader header = {};
+    header.type = type;
+    header.size = uint32_t( sizeof( Args ) + payload_size );
+
+    const size_t offset = m_commands.size();
+    m_commands.resize( offset + sizeof( header ) + header.size );
+
+    uint8_t* dst = m_commands.data() + offset;
+    std::memcpy( dst, &header, sizeof( header ) );
+    dst += sizeof( header );
+    std::memcpy( dst, &args, sizeof( Args ) );
+    dst += sizeof( Args );
+    if ( payload_size > 0 )
+        std::memcpy( dst, payload, payload_size );
+
+    m_num_commands++;
+}
+
+void NullCommandList::Begin()
+{
+    VERIFY( !m_recording );
+
+    m_recording = true;
+
+    Record( NullRHICall::Begin, NoArgs{} );
+}
+
+void NullCommandList::End()
+{
+    VERIFY( !m_in_pass );
+
+    Record( NullRHICall::End, NoArgs{} );
+
+    m_recording = false;
+}
+
+void NullCommandList::CopyBuffer( RHIBuffer& src, RHIBuffer& dst, size_t region_count, CopyRegion* regions )
+{
+    VERIFY_NOT_EQUAL( region_count, 0 );
+    VERIFY_NOT_EQUAL( regions, nullptr );
+
+    for ( size_t i = 0; i < region_count; ++i )
+    {
+        VERIFY( regions[i].src_offset + regions[i].size <= src.GetSize() );
+        VERIFY( regions[i].dst_offset + regions[i].size <= dst.GetSize() );
+    }
+
+    CopyBufferArgs args;
+    args.src = &RHIImpl( src );
+    args.dst = &RHIImpl( dst );
+    args.region_count = region_count;
+
+    Record( NullRHICall::CopyBuffer, args, regions, sizeof( CopyRegion ) * region_count );
+}
+
+void NullCommandList::Draw( uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance )
+{
+    DrawArgs args;
+    args.vertex_count = vertex_count;
+    args.instance_count = instance_count;
+    args.first_vertex = first_vertex;
+    args.first_instance = first_instance;
+
+    Record( NullRHICall::Draw, args );
+}
+
+void NullCommandList::DrawIndexed( uint32_t index_count, uint32_t instance_count, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance )
+{
+    DrawIndexedArgs args;
+    args.index_count = index_count;
+    args.instance_count = instance_count;
+    args.first_index = first_index;
+    args.vertex_offset = vertex_offset;
+    args.first_instance = first_instance;
+
+    Record( NullRHICall::DrawIndexed, args );
+}
+
+void NullCommandList::DrawIndirect( const RHIBufferViewInfo& indirect_args )
+{
+    VERIFY_NOT_EQUAL( indirect_args.buffer, nullptr );
+
+    Record( NullRHICall::DrawIndirect, indirect_args );
+}
+
+void NullCommandList::Dispatch( glm::uvec3 group_num )
+{
+    Record( NullRHICall::Dispatch, group_num );
+}
+
+void NullCommandList::TraceRays( glm::uvec3 threads_count )
+{
+    Record( NullRHICall::TraceRays, threads_count );
+}
+
+void NullCommandList::SetPSO( const RHIGraphicsPipeline& pso )
+{
+    Record( NullRHICall::SetGraphicsPSO, ObjectArgs{ &pso } );
+}
+
+void NullCommandList::SetPSO( const RHIRaytracingPipeline& pso )
+{
+    Record( NullRHICall::SetRaytracingPSO, ObjectArgs{ &pso } );
+}
+
+void NullCommandList::SetPSO( const RHIComputePipeline& pso )
+{
+    Record( NullRHICall::SetComputePSO, ObjectArgs{ &pso } );
+}
+
+void NullCommandList::BindDescriptorSet( size_t slot_idx, RHIDescriptorSet& set )
+{
+    BindDescriptorSetArgs args;
+    args.slot_idx = slot_idx;
+    args.set = &set;
+
+    Record( NullRHICall::BindDescriptorSet, args );
+}
+
+void NullCommandList::SetVertexBuffers( uint32_t first_binding, const RHIBuffer* buffers, size_t buffers_count, const size_t* opt_offsets )
+{
+    boost::container::small_vector<uint8_t, 64> payload;
+    payload.resize( buffers_count * ( sizeof( const RHIBuffer* ) + sizeof( size_t ) ) );
+
+    const RHIBuffer** payload_buffers = reinterpret_cast< const RHIBuffer** >( payload.data() );
+    size_t* payload_offsets = reinterpret_cast< size_t* >( payload.data() + buffers_count * sizeof( const RHIBuffer* ) );
+    for ( size_t i = 0; i < buffers_count; ++i )
+    {
+        payload_buffers[i] = &buffers[i];
+        payload_offsets[i] = opt_offsets ? opt_offsets[i] : 0;
+    }
+
+    SetVertexBuffersArgs args;
+    args.first_binding = first_binding;
+    args.buffers_count = buffers_count;
+
+    Record( NullRHICall::SetVertexBuffers, args, payload.data(), payload.size() );
+}
+
+void NullCommandList::SetIndexBuffer( const RHIBuffer& index_buf, RHIIndexBufferType type, size_t offset )
+{
+    SetIndexBufferArgs args;
+    args.buffer = &index_buf;
+    args.type = type;
+    args.offset = offset;
+
+    Record( NullRHICall::SetIndexBuffer, args );
+}
+
+void NullCommandList::TextureBarriers( const RHITextureBarrier* barriers, size_t barrier_count )
+{
+    Record( NullRHICall::TextureBarriers, ArrayArgs{ 0, barrier_count }, barriers, sizeof( RHITextureBarrier ) * barrier_count );
+}
+
+void NullCommandList::MemoryBarrierGPU()
+{
+    Record( NullRHICall::MemoryBarrierGPU, NoArgs{} );
+}
+
+void NullCommandList::BeginPass( const RHIPassInfo& pass_info )
+{
+    VERIFY( !m_in_pass );
+
+    BeginPassArgs args;
+    args.render_area = pass_info.render_area;
+    args.render_targets_count = pass_info.render_targets_count;
+
+    Record( NullRHICall::BeginPass, args, pass_info.render_targets, sizeof( RHIPassRTVInfo ) * pass_info.render_targets_count );
+
+    m_in_pass = true;
+}
+
+void NullCommandList::EndPass()
+{
+    VERIFY( m_in_pass );
+
+    Record( NullRHICall::EndPass, NoArgs{} );
+
+    m_in_pass = false;
+}
+
+void NullCommandList::CopyBufferToTexture( const RHIBuffer& buf, RHITexture& texture, const RHIBufferTextureCopyRegion* regions, size_t region_count )
+{
+    CopyToTextureArgs args;
+    args.src = &buf;
+    args.dst = &texture;
+    args.region_count = region_count;
+
+    Record( NullRHICall::CopyBufferToTexture, args, regions, sizeof( RHIBufferTextureCopyRegion ) * region_count );
+}
+
+void NullCommandList::CopyTextureToTexture( const RHITexture& src, const RHITexture& dst, const RHITextureTextureCopyRegion* regions, size_t region_count )
+{
+    CopyToTextureArgs args;
+    args.src = &src;
+    args.dst = &dst;
+    args.region_count = region_count;
+
+    Record( NullRHICall::CopyTextureToTexture, args, regions, sizeof( RHITextureTextureCopyRegion ) * region_count );
+}
+
+void NullCommandList::SetViewports( size_t first_viewport, const RHIViewport* viewports, size_t viewports_count )
+{
+    Record( NullRHICall::SetViewports, ArrayArgs{ first_viewport, viewports_count }, viewports, sizeof( RHIViewport ) * viewports_count );
+}
+
+void NullCommandList::SetScissors( size_t first_scissor, const RHIRect2D* scissors, size_t scissors_count )
+{
+    Record( NullRHICall::SetScissors, ArrayArgs{ first_scissor, scissors_count }, scissors, sizeof( RHIRect2D ) * scissors_count );
+}
+
+void NullCommandList::PushConstants( size_t offset, const void* data, size_t size )
+{
+    Record( NullRHICall::PushConstants, PushConstantsArgs{ offset, size }, data, size );
+}
+
+void NullCommandList::BuildAS( const RHIASBuildInfo& info )
+{
+    VERIFY_NOT_EQUAL( info.dst, nullptr );
+
+    boost::container::small_vector<RHIASGeometryInfo, 4> geoms;
+    geoms.reserve( info.geoms_count );
+    size_t num_primitives = 0;
+    for ( size_t i = 0; i < info.geoms_count; ++i )
+    {
+        const RHIASGeometryInfo& geom = geoms.emplace_back( *info.geoms[i] );
+        if ( geom.type == RHIASGeometryType::Instances )
+        {
+            VERIFY( geom.instances.num_instances <= geom.instances.instance_buf->GetCapacity() );
+            num_primitives += geom.instances.num_instances;
+        }
+        else
+        {
+            const size_t index_size = geom.triangles.idx_type == RHIIndexBufferType::UInt16 ? sizeof( uint16_t ) : sizeof( uint32_t );
+            num_primitives += geom.triangles.idx_buf->GetSize() / index_size / 3;
+        }
+    }
+
+    // the same rules real drivers have, breaking them is undefined behavior there
+    if ( info.mode == RHIASBuildMode::Update )
+    {
+        VERIFY_NOT_EQUAL( info.src, nullptr );
+        VERIFY( RHIImpl( info.src )->CanBeUpdated( info.flags, num_primitives ) );
+        m_rhi->OnASUpdated();
+    }
+    RHIImpl( info.dst )->OnBuildRecorded( info.flags, num_primitives );
+
+    BuildASArgs args;
+    args.scratch = info.scratch;
+    args.dst = info.dst;
+    args.src = info.src;
+    args.mode = info.mode;
+    args.flags = info.flags;
+    args.geoms_count = info.geoms_count;
+
+    Record( NullRHICall::BuildAS, args, geoms.data(), sizeof( RHIASGeometryInfo ) * geoms.size() );
+}
+
+void NullCommandList::WriteCompactedASSizes( const RHIAccelerationStructure* const* structures, size_t count, RHIBuffer& dst, size_t dst_offset )
+{
+    VERIFY( dst_offset + count * sizeof( uint64_t ) <= dst.GetSize() );
+
+    boost::container::small_vector<const NullAccelerationStructure*, 16> null_structures;
+    null_structures.reserve( count );
+    for ( size_t i = 0; i < count; ++i )
+    {
+        VERIFY_NOT_EQUAL( structures[i], nullptr );
+        VERIFY( RHIImpl( structures[i] )->CanBeCompacted() );
+        null_structures.emplace_back( RHIImpl( structures[i] ) );
+    }
+
+    WriteCompactedASSizesArgs args;
+    args.dst = &RHIImpl( dst );
+    args.dst_offset = dst_offset;
+    args.count = count;
+
+    Record( NullRHICall::WriteCompactedASSizes, args, null_structures.data(), sizeof( const NullAccelerationStructure* ) * count );
+}
+
+void NullCommandList::CompactAS( const RHIAccelerationStructure& src, const RHIAccelerationStructure& dst )
+{
+    VERIFY( RHIImpl( src ).CanBeCompacted() );
+    VERIFY( RHIImpl( src ).GetCompactedSize() <= dst.GetSize() );
+    RHIImpl( dst ).OnCompactionRecorded( RHIImpl( src ) );
+
+    Record( NullRHICall::CompactAS, CompactASArgs{ &src, &dst } );
+}
+
+void NullCommandList::Execute() const
+{
+    const auto& command_observer = m_rhi->GetCreateInfo().command_observer;
+    std::vector<RHITextureBarrier> texture_barriers;
+
+    const uint8_t* cur = m_commands.data();
+    const uint8_t* end = cur + m_commands.size();
+    while ( cur < end )
+    {
+        NullCommandHeader header;
+        std::memcpy( &header, cur, sizeof( header ) );
+        cur += sizeof( header );
+
+        if ( command_observer && ( header.type == NullRHICall::TextureBarriers || header.type == NullRHICall::MemoryBarrierGPU || header.type == NullRHICall::Dispatch ) )
+        {
+            NullRHIExecutedCommand command;
+            command.queue = m_type;
+            command.type = header.type;
+            if ( header.type == NullRHICall::TextureBarriers )
+            {
+                ArrayArgs args;
+                std::memcpy( &args, cur, sizeof( args ) );
+                texture_barriers.resize( args.count );
+                std::memcpy( texture_barriers.data(), cur + sizeof( args ), sizeof( RHITextureBarrier ) * args.count );
+                command.texture_barriers = texture_barriers;
+            }
+            else if ( header.type == NullRHICall::Dispatch )
+            {
+                std::memcpy( &command.group_num, cur, sizeof( command.group_num ) );
+            }
+            command_observer( command );
+        }
+
+        if ( header.type == NullRHICall::CopyBuffer )
+        {
+            CopyBufferArgs args;
+            std::memcpy( &args, cur, sizeof( args ) );
+            const uint8_t* regions_data = cur + sizeof( args );
+            for ( size_t i = 0; i < args.region_count; ++i )
+            {
+                CopyRegion region;
+                std::memcpy( &region, regions_data + i * sizeof( CopyRegion ), sizeof( region ) );
+                std::memmove( args.dst->GetData() + region.dst_offset, args.src->GetData() + region.src_offset, region.size );
+            }
+        }
+        else if ( header.type == NullRHICall::WriteCompactedASSizes )
+        {
+            WriteCompactedASSizesArgs args;
+            std::memcpy( &args, cur, sizeof( args ) );
+            const uint8_t* structures_data = cur + sizeof( args );
+            for ( size_t i = 0; i < args.count; ++i )
+            {
+                const NullAccelerationStructure* as = nullptr;
+                std::memcpy( &as, structures_data + i * sizeof( as ), sizeof( as ) );
+                const uint64_t compacted_size = as->GetCompactedSize();
+                std::memcpy( args.dst->GetData() + args.dst_offset + i * sizeof( uint64_t ), &compacted_size, sizeof( compacted_size ) );
+            }
+        }
+
+        cur += header.size;
+    }
+}
+
+void NullCommandList::Reset()
+{
+    m_commands.clear();
+    m_num_commands = 0;
+    m_recording = false;
+    m_in_pass = false;
+}
+
+NullCommandListManager::NullCommandListManager( NullRHI* rhi )
+    : m_rhi( rhi )
+{
+}
+
+NullCommandListManager::~NullCommandListManager()
+{
+    WaitSubmittedUntilCompletion();
+
+    for ( const auto& queue_submitted_lists : m_submitted_lists )
+    {
+        assert( queue_submitted_lists.size() == 0 );
+    }
+
+    for ( auto& queue_cmd_lists : m_cmd_lists )
+    {
+        queue_cmd_lists.clear();
+    }
+}
+
+NullCommandList* NullCommandListManager::GetCommandList( RHI::QueueType type )
+{
+    VERIFY_EQUALS( type < RHI::QueueType::Count, true );
+
+    std::scoped_lock lock( m_lock );
+
+    auto& free_lists = m_free_lists[size_t( type )];
+    if ( !free_lists.empty() )
+    {
+        auto list_id = free_lists.back();
+        free_lists.pop_back();
+        return m_cmd_lists[size_t( type )][list_id].get();
+    }
+
+    CmdListId list_id = m_cmd_lists[size_t( type )].emplace();
+
+    NullCommandList* new_list = new NullCommandList( m_rhi, type, list_id );
+    m_cmd_lists[size_t( type )][list_id].reset( new_list );
+
+    return new_list;
+}
+
+RHIFence NullCommandListManager::SubmitCommandLists( const RHI::SubmitInfo& info )
+{
+    if ( info.cmd_list_count == 0 )
+    {
+        // type of the queue is taken from the lists, so there is nowhere to wait or signal
+        VERIFY_EQUALS( info.wait_semaphore_count + info.signal_semaphore_count, 0 );
+        return RHIFence{};
+    }
+
+    const RHI::QueueType type = info.cmd_lists[0]->GetType();
+    const size_t queue_idx = size_t( type );
+
+    // The "GPU" runs the lists right away, the latency only delays the fence
+    size_t recorded_bytes = 0;
+    for ( size_t i = 0; i < info.cmd_list_count; ++i )
+    {
+        const NullCommandList* list = RHIImpl( info.cmd_lists[i] );
+        VERIFY_EQUALS( list->GetType() == type, true );
+        VERIFY_EQUALS( list->IsRecording(), false );
+
+        list->Execute();
+        recorded_bytes += list->GetCommandStream().size();
+    }
+
+    m_rhi->OnCmdListsSubmitted( info.cmd_list_count, recorded_bytes );
+
+    const NullRHI::Clock::time_point now = NullRHI::Clock::now();
+
+    std::scoped_lock lock( m_lock );
+
+    // Not necessary, but we have to do this somewhere at regular intervals. Why not here?
+    ProcessCompletedNoLock( now );
+
+    NullQueue& queue = m_queues[queue_idx];
+
+    // submission starts once the queue is idle and all semaphores it waits for are signaled
+    NullRHI::Clock::time_point start_time = std::max( now, queue.last_completion_time );
+    for ( size_t i = 0; i < info.wait_semaphore_count; ++i )
+    {
+        VERIFY_NOT_EQUAL( info.semaphores_to_wait[i], nullptr );
+        start_time = std::max( start_time, RHIImpl( info.semaphores_to_wait[i] )->Wait() );
+    }
+
+    queue.submitted_counter++;
+    queue.last_completion_time = start_time + m_rhi->GetGPULatency();
+
+    for ( size_t i = 0; i < info.signal_semaphore_count; ++i )
+    {
+        VERIFY_NOT_EQUAL( info.semaphores_to_signal[i], nullptr );
+        RHIImpl( info.semaphores_to_signal[i] )->Signal( queue.last_completion_time );
+    }
+
+    auto& submitted_lists = m_submitted_lists[queue_idx].emplace();
+    submitted_lists.submission_idx = queue.submitted_counter;
+    submitted_lists.completion_time = queue.last_completion_time;
+    submitted_lists.lists.reserve( info.cmd_list_count );
+    for ( size_t i = 0; i < info.cmd_list_count; ++i )
+        submitted_lists.lists.emplace_back( RHIImpl( info.cmd_lists[i] ) );
+
+    return RHIFence{
+        static_cast< uint64_t >( queue.last_completion_time.time_since_epoch().count() ),
+        queue.submitted_counter,
+        static_cast< uint64_t >( type ),
+    };
+}
+
+void NullCommandListManager::WaitForFence( const RHIFence& fence )
+{
+    // empty submission
+    if ( fence._2 == 0 )
+        return;
+
+    VERIFY_EQUALS( fence._3 < size_t( RHI::QueueType::Count ), true );
+
+    const NullRHI::Clock::time_point completion_time( NullRHI::Clock::duration( fence._1 ) );
+
+    std::this_thread::sleep_until( completion_time );
+
+    std::scoped_lock lock( m_lock );
+    ProcessCompletedNoLock( std::max( NullRHI::Clock::now(), completion_time ) );
+}
+
+bool NullCommandListManager::IsFenceCompleted( const RHIFence& fence )
+{
+    if ( fence._2 == 0 )
+        return true;
+
+    VERIFY_EQUALS( fence._3 < size_t( RHI::QueueType::Count ), true );
+
+    std::scoped_lock lock( m_lock );
+    ProcessCompletedNoLock( NullRHI::Clock::now() );
+    return m_queues[fence._3].completed_counter >= fence._2;
+}
+
+void NullCommandListManager::ProcessCompleted()
+{
+    std::scoped_lock lock( m_lock );
+    ProcessCompletedNoLock( NullRHI::Clock::now() );
+}
+
+void NullCommandListManager::ProcessCompletedNoLock( NullRHI::Clock::time_point now )
+{
+    for ( size_t queue_i = 0; queue_i < m_submitted_lists.size(); ++queue_i )
+    {
+        auto& submitted_lists = m_submitted_lists[queue_i];
+        auto& free_lists = m_free_lists[queue_i];
+        NullQueue& queue = m_queues[queue_i];
+
+        while ( !submitted_lists.empty() )
+        {
+            auto& submitted_info = submitted_lists.front();
+            if ( submitted_info.completion_time > now )
+                break;
+
+            queue.completed_counter = submitted_info.submission_idx;
+
+            for ( NullCommandList* list : submitted_info.lists )
+                free_lists.emplace_back( list->GetListId() );
+
+            submitted_lists.pop();
+        }
+    }
+}
+
+void NullCommandListManager::WaitSubmittedUntilCompletion()
+{
+    NullRHI::Clock::time_point last_completion_time = {};
+    {
+        std::scoped_lock lock( m_lock );
+        for ( size_t queue_i = 0; queue_i < m_submitted_lists.size(); ++queue_i )
+        {
+            if ( !m_submitted_lists[queue_i].empty() )
+                last_completion_time = std::max( last_completion_time, m_submitted_lists[queue_i].back().completion_time );
+        }
+    }
+
+    std::this_thread::sleep_until( last_completion_time );
+
+    std::scoped_lock lock( m_lock );
+    ProcessCompletedNoLock( std::max( NullRHI::Clock::now(), last_completion_time ) );
+}
+
+std::array<uint64_t, size_t( RHI::QueueType::Count )> NullCommandListManager::GetSubmittedCounters() const
+{
+    std::scoped_lock lock( m_lock );
+
+    std::array<uint64_t, size_t( RHI::QueueType::Count )> counters = {};
+    for ( size_t queue_i = 0; queue_i < m_queues.size(); ++queue_i )
+        counters[queue_i] = m_queues[queue_i].submitted_counter;
+
+    return counters;
+}
+
+bool NullCommandListManager::AreSubmissionsCompleted( const std::array<uint64_t, size_t( RHI::QueueType::Count )>& counters ) const
+{
+    std::scoped_lock lock( m_lock );
+
+    for ( size_t queue_i = 0; queue_i < m_queues.size(); ++queue_i )
+    {
+        if ( m_queues[queue_i].completed_counter < counters[queue_i] )
+            return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "StdAfx.h"
+
+#include <RHI/RHI.h>
+
+#include "NullRHIImpl.h"
+
+// Simulated GPU queue. Submissions complete in order, each one after the configured latency has passed since
+// both its submission and the completion of the previous one
+struct NullQueue
+{
+    uint64_t submitted_counter = 0;
+    uint64_t completed_counter = 0;
+    NullRHI::Clock::time_point last_completion_time = {};
+};
+
+class NullCommandListManager
+{
+private:
+    class NullRHI* m_rhi = nullptr;
+
+    // GetCommandList and SubmitCommandLists may be called from several threads
+    mutable std::mutex m_lock;
+
+    std::array<packed_freelist<std::unique_ptr<class NullCommandList>>, size_t( RHI::QueueType::Count )> m_cmd_lists;
+
+public:
+    using CmdListId = std::remove_reference_t<decltype( m_cmd_lists[0] )>::id;
+
+private:
+
+    std::array<std::vector<CmdListId>, size_t( RHI::QueueType::Count )> m_free_lists;
+
+    struct SubmittedListsInfo
+    {
+        std::vector<NullCommandList*> lists;
+        uint64_t submission_idx = 0;
+        NullRHI::Clock::time_point completion_time = {};
+    };
+    std::array<std::queue<SubmittedListsInfo>, size_t( RHI::QueueType::Count )> m_submitted_lists;
+
+    std::array<NullQueue, size_t( RHI::QueueType::Count )> m_queues;
+
+public:
+    NullCommandListManager( NullRHI* rhi );
+    ~NullCommandListManager();
+
+    NullCommandList* GetCommandList( RHI::QueueType type );
+    RHIFence SubmitCommandLists( const RHI::SubmitInfo& info );
+
+    void WaitForFence( const RHIFence& fence );
+    bool IsFenceCompleted( const RHIFence& fence );
+
+    void ProcessCompleted();
+
+    void WaitSubmittedUntilCompletion();
+
+    // for deferred destruction. Objects released after these submissions may be destroyed once they complete
+    std::array<uint64_t, size_t( RHI::QueueType::Count )> GetSubmittedCounters() const;
+    bool AreSubmissionsCompleted( const std::array<uint64_t, size_t( RHI::QueueType::Count )>& counters ) const;
+
+private:
+    void ProcessCompletedNoLock( NullRHI::Clock::time_point now );
+};
+
+// Recorded command layout: NullCommandHeader, fixed-size arguments, then optional array payload.
+// Object arguments are stored as raw pointers, RHI objects must outlive command list submission anyway
+struct NullCommandHeader
+{
+    NullRHICall type = NullRHICall::Count;
+    uint32_t size = 0; // size of everything after the header
+};
+
+class NullCommandList : public RHICommandList
+{
+public:
+    using CmdListId = NullCommandListManager::CmdListId;
+
+private:
+    RHI::QueueType m_type = RHI::QueueType::Graphics;
+    CmdListId m_list_id = CmdListId::nullid;
+    class NullRHI* m_rhi = nullptr;
+
+    std::vector<uint8_t> m_commands;
+    size_t m_num_commands = 0;
+
+    bool m_recording = false;
+    bool m_in_pass = false;
+
+public:
+    NullCommandList( NullRHI* rhi, RHI::QueueType type, CmdListId list_id );
+    virtual ~NullCommandList();
+
+    virtual RHI::QueueType GetType() const override;
+
+    virtual void Begin() override;
+    virtual void End() override;
+
+    virtual void CopyBuffer( RHIBuffer& src, RHIBuffer& dst, size_t region_count, CopyRegion* regions ) override;
+
+    virtual void Draw(
+        uint32_t vertex_count,
+        uint32_t instance_count,
+        uint32_t first_vertex,
+        uint32_t first_instance ) override;
+
+    virtual void DrawIndexed(
+        uint32_t index_count,
+        uint32_t instance_count,
+        uint32_t first_index,
+        int32_t vertex_offset,
+        uint32_t first_instance ) override;
+
+    virtual void DrawIndirect( const RHIBufferViewInfo& indirect_args ) override;
+
+    virtual void Dispatch( glm::uvec3 group_num ) override;
+
+    virtual void TraceRays( glm::uvec3 threads_count ) override;
+
+    virtual void SetPSO( const RHIGraphicsPipeline& pso ) override;
+    virtual void SetPSO( const RHIRaytracingPipeline& pso ) override;
+    virtual void SetPSO( const RHIComputePipeline& pso ) override;
+
+    virtual void BindDescriptorSet( size_t slot_idx, RHIDescriptorSet& set ) override;
+
+    virtual void SetVertexBuffers( uint32_t first_binding, const RHIBuffer* buffers, size_t buffers_count, const size_t* opt_offsets ) override;
+    virtual void SetIndexBuffer( const RHIBuffer& index_buf, RHIIndexBufferType type, size_t offset ) override;
+
+    virtual void TextureBarriers( const RHITextureBarrier* barriers, size_t barrier_count ) override;
+
+    virtual void MemoryBarrierGPU() override;
+
+    virtual void BeginPass( const RHIPassInfo& pass_info ) override;
+    virtual void EndPass() override;
+
+    virtual void CopyBufferToTexture(
+        const RHIBuffer& buf, RHITexture& texture,
+        const RHIBufferTextureCopyRegion* regions, size_t region_count ) override;
+
+    virtual void CopyTextureToTexture(
+        const RHITexture& src, const RHITexture& dst,
+        const RHITextureTextureCopyRegion* regions, size_t region_count ) override;
+
+    virtual void SetViewports( size_t first_viewport, const RHIViewport* viewports, size_t viewports_count ) override;
+    virtual void SetScissors( size_t first_scissor, const RHIRect2D* scissors, size_t scissors_count ) override;
+
+    virtual void PushConstants( size_t offset, const void* data, size_t size ) override;
+
+    virtual void BuildAS( const RHIASBuildInfo& info ) override;
+
+    virtual void WriteCompactedASSizes( const RHIAccelerationStructure* const* structures, size_t count, RHIBuffer& dst, size_t dst_offset ) override;
+    virtual void CompactAS( const RHIAccelerationStructure& src, const RHIAccelerationStructure& dst ) override;
+
+    CmdListId GetListId() const { return m_list_id; }
+
+    bool IsRecording() const { return m_recording; }
+
+    const std::vector<uint8_t>& GetCommandStream() const { return m_commands; }
+    size_t GetNumCommands() const { return m_num_commands; }
+
+    // Runs the recorded stream on the "GPU". Only buffer copies and compacted size queries have visible effects, synchronization commands are reported to the command observer
+    void Execute() const;
+
+    void Reset();
+
+private:
+    template<typename Args>
+    void Record( NullRHICall type, const Args& args, const void* payload = nullptr, size_t payload_size = 0 );
+};
+
+IMPLEMENT_RHI_INTERFACE( RHICommandList, NullCommandList )
@@ -0,0 +1,124 @@
+#include "StdAfx.h"
+
+#include "NullRHI.h"
+
+#include "NullRHIImpl.h"
+
+CorePaths g_core_paths;
+Logger* g_log;
+
+ConsoleVariableBase* g_cvars_head = nullptr;
+
+NULLRHI_API RHI* CreateNullRHI( const NullRHICreateInfo& info )
+{
+    if ( !SE_ENSURE( info.logger ) )
+        return nullptr;
+
+    g_log = info.logger;
+
+    if ( !SE_ENSURE( info.core_paths ) )
+        return nullptr;
+
+    g_core_paths = *info.core_paths;
+
+    return new NullRHI( info );
+}
+
+NULLRHI_API void DestroyNullRHI( RHI* null_rhi )
+{
+    if ( null_rhi )
+        delete null_rhi;
+}
+
+NULLRHI_API ConsoleVariableBase* NullRHI_GetCVarListHead()
+{
+    return g_cvars_head;
+}
+
+NULLRHI_API NullRHIStats NullRHI_GetStats( const RHI& null_rhi )
+{
+    return static_cast< const NullRHI& >( null_rhi ).GetStats();
+}
+
+NULLRHI_API void NullRHI_ResetStats( RHI& null_rhi )
+{
+    static_cast< NullRHI& >( null_rhi ).ResetStats();
+}
+
+NULLRHI_API const char* NullRHI_GetCallName( NullRHICall call )
+{
+    static constexpr const char* names[] =
+    {
+        "CreateSwapChain",
+        "CreateGPUSemaphore",
+        "Present",
+        "WaitIdle",
+        "GetCommandList",
+        "SubmitCommandLists",
+        "WaitForFenceCompletion",
+        "IsFenceCompleted",
+        "CreateShader",
+        "CreateDescriptorSetLayout",
+        "CreateDescriptorSet",
+        "CreateShaderBindingLayout",
+        "CreateGraphicsPSO",
+        "CreateRaytracingPSO",
+        "CreateComputePSO",
+        "CreateUploadBuffer",
+        "CreateReadbackBuffer",
+        "CreateDeviceBuffer",
+        "CreateASInstanceBuffer",
+        "CreateTexture",
+        "CreateUniformBufferView",
+        "CreateTextureROView",
+        "CreateTextureRWView",
+        "CreateRTV",
+        "CreateSampler",
+        "CreateAS",
+        "GetASBuildSize",
+        "ReloadAllShaders",
+        "CreateMemoryHeap",
+        "CreatePlacedTexture",
+        "CreatePlacedBuffer",
+
+        "AcquireNextImage",
+        "BindDescriptor",
+        "FlushBinds",
+        "WriteBytes",
+        "ReadBytes",
+        "UpdateASInstanceBuffer",
+
+        "Begin",
+        "End",
+        "CopyBuffer",
+        "Draw",
+        "DrawIndexed",
+        "DrawIndirect",
+        "Dispatch",
+        "TraceRays",
+        "SetGraphicsPSO",
+        "SetRaytracingPSO",
+        "SetComputePSO",
+        "BindDescriptorSet",
+        "SetVertexBuffers",
+        "SetIndexBuffer",
+        "TextureBarriers",
+        "MemoryBarrierGPU",
+        "BeginPass",
+        "EndPass",
+        "CopyBufferToTexture",
+        "CopyTextureToTexture",
+        "SetViewports",
+        "SetScissors",
+        "PushConstants",
+        "BuildAS",
+        "WriteCompactedASSizes",
+        "CompactAS",
+    };
+    static_assert( std::size( names ) == size_t( NullRHICall::Count ) );
+
+    if ( !SE_ENSURE( call < NullRHICall::Count ) )
+        return "Unknown";
+
+    return names[size_t( call )];
+}
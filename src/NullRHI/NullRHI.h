@@ -0,0 +1,157 @@
+#pragma once
+
+#ifdef NULLRHI_EXPORTS
+#define NULLRHI_API __declspec(dllexport)
+#else
+#define NULLRHI_API __declspec(dllimport)
+#endif
+
+#include <RHI/RHI.h>
+
+#include <functional>
+
+// Headless RHI backend. Buffers live in host memory, command lists are recorded into a binary command stream
+// and the GPU is simulated with a fixed latency per submission. Nothing is rendered, but everything above the RHI
+// (rendergraph, descriptor pools, upload pools, TLAS bookkeeping) runs as usual, so CPU cost of a frame can be measured
+// on machines without a GPU.
+//
+// Every API call is counted, see NullRHI_GetStats
+
+enum class NullRHICall : uint32_t
+{
+    // RHI
+    CreateSwapChain = 0,
+    CreateGPUSemaphore,
+    Present,
+    WaitIdle,
+    GetCommandList,
+    SubmitCommandLists,
+    WaitForFenceCompletion,
+    IsFenceCompleted,
+    CreateShader,
+    CreateDescriptorSetLayout,
+    CreateDescriptorSet,
+    CreateShaderBindingLayout,
+    CreateGraphicsPSO,
+    CreateRaytracingPSO,
+    CreateComputePSO,
+    CreateUploadBuffer,
+    CreateReadbackBuffer,
+    CreateDeviceBuffer,
+    CreateASInstanceBuffer,
+    CreateTexture,
+    CreateUniformBufferView,
+    CreateTextureROView,
+    CreateTextureRWView,
+    CreateRTV,
+    CreateSampler,
+    CreateAS,
+    GetASBuildSize,
+    ReloadAllShaders,
+    CreateMemoryHeap,
+    CreatePlacedTexture,
+    CreatePlacedBuffer,
+
+    // RHI objects
+    AcquireNextImage,
+    BindDescriptor,
+    FlushBinds,
+    WriteBytes,
+    ReadBytes,
+    UpdateASInstanceBuffer,
+
+    // RHICommandList
+    Begin,
+    End,
+    CopyBuffer,
+    Draw,
+    DrawIndexed,
+    DrawIndirect,
+    Dispatch,
+    TraceRays,
+    SetGraphicsPSO,
+    SetRaytracingPSO,
+    SetComputePSO,
+    BindDescriptorSet,
+    SetVertexBuffers,
+    SetIndexBuffer,
+    TextureBarriers,
+    MemoryBarrierGPU,
+    BeginPass,
+    EndPass,
+    CopyBufferToTexture,
+    CopyTextureToTexture,
+    SetViewports,
+    SetScissors,
+    PushConstants,
+    BuildAS,
+    WriteCompactedASSizes,
+    CompactAS,
+
+    Count
+};
+
+struct NullRHIStats
+{
+    std::array<uint64_t, size_t( NullRHICall::Count )> calls = {};
+
+    uint64_t submitted_cmd_lists = 0;
+    uint64_t recorded_bytes = 0; // total size of submitted command streams
+    uint64_t allocated_buffer_memory = 0; // host memory held by alive buffers and memory heaps
+    uint64_t uploaded_as_instances = 0; // instances written to AS instance buffers
+    uint64_t as_updates = 0; // BuildAS calls with RHIASBuildMode::Update
+
+    uint64_t GetCalls( NullRHICall call ) const { return calls[size_t( call )]; }
+};
+
+// Synchronization commands and dispatches, in the order the simulated GPU runs them. Command lists run when they are submitted
+struct NullRHIExecutedCommand
+{
+    RHI::QueueType queue = RHI::QueueType::Graphics;
+    NullRHICall type = NullRHICall::Count; // TextureBarriers, MemoryBarrierGPU or Dispatch
+
+    std::span<const RHITextureBarrier> texture_barriers;
+    glm::uvec3 group_num = glm::uvec3( 0, 0, 0 );
+};
+
+struct NullRHICreateInfo
+{
+    // time between a submission and its fence being signaled. Submissions on the same queue complete in order
+    uint32_t gpu_latency_us = 0;
+
+    bool enable_raytracing = true;
+
+    // Compute and Copy queues. Each queue is simulated independently, so work on different queues overlaps
+    bool enable_async_queues = true;
+
+    glm::uvec2 swapchain_extent = glm::uvec2( 1280, 720 );
+    uint32_t swapchain_surface_num = 2;
+
+    uint64_t uniform_buffer_alignment = 256;
+
+    // limit of CreateBindlessDescriptorSet, for every binding type
+    uint32_t max_bindless_descriptors = 1u << 21;
+
+    // for tests that validate synchronization, called from the thread that submits command lists
+    std::function<void( const NullRHIExecutedCommand& )> command_observer;
+
+    class Logger* logger = nullptr;
+    struct CorePaths* core_paths = nullptr;
+};
+
+NULLRHI_API class RHI* CreateNullRHI( const NullRHICreateInfo& info );
+
+NULLRHI_API void DestroyNullRHI( RHI* null_rhi );
+
+NULLRHI_API class ConsoleVariableBase* NullRHI_GetCVarListHead();
+
+// null_rhi must be created with CreateNullRHI
+NULLRHI_API NullRHIStats NullRHI_GetStats( const RHI& null_rhi );
+NULLRHI_API void NullRHI_ResetStats( RHI& null_rhi );
+
+NULLRHI_API const char* NullRHI_GetCallName( NullRHICall call );
+
+inline RHIPtr CreateNullRHI_RAII( const NullRHICreateInfo& info )
+{
+    return RHIPtr( CreateNullRHI( info ), DestroyNullRHI );
+}
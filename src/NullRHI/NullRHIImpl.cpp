@@ -0,0 +1,432 @@
+#include "StdAfx.h"
+
+#include "NullRHIImpl.h"
+
+#include "CommandLists.h"
+#include "PSO.h"
+#include "Resources.h"
+#include "Swapchain.h"
+
+IMPLEMENT_RHI_OBJECT( NullSemaphore )
+
+void NullSemaphore::Signal( std::chrono::steady_clock::time_point time )
+{
+    VERIFY_EQUALS( m_signaled, false );
+
+    m_signaled = true;
+    m_signal_time = time;
+}
+
+std::chrono::steady_clock::time_point NullSemaphore::Wait()
+{
+    // waits on semaphores without a pending signal deadlock on real hardware
+    VERIFY_EQUALS( m_signaled, true );
+
+    m_signaled = false;
+    return m_signal_time;
+}
+
+NullRHI::NullRHI( const NullRHICreateInfo& info )
+    : m_info( info )
+{
+    SE_LOG_INFO( NullRHI, "Null RHI created. Simulated GPU latency: %u us", m_info.gpu_latency_us );
+
+    m_cmd_list_mgr = std::make_unique<NullCommandListManager>( this );
+
+    if ( m_info.swapchain_surface_num > 0 )
+    {
+        RHISwapChainCreateInfo swapchain_info = {};
+        swapchain_info.surface_num = m_info.swapchain_surface_num;
+        m_main_swap_chain = new NullSwapChain( this, swapchain_info, m_info.swapchain_extent );
+    }
+}
+
+NullRHI::~NullRHI()
+{
+    WaitIdle();
+
+    m_main_swap_chain = nullptr;
+
+    m_cmd_list_mgr = nullptr;
+
+    DestroyCompletedObjects( /*force=*/true );
+}
+
+RHISwapChain* NullRHI::CreateSwapChain( const RHISwapChainCreateInfo& create_info )
+{
+    CountCall( NullRHICall::CreateSwapChain );
+    return new NullSwapChain( this, create_info, m_info.swapchain_extent );
+}
+
+RHISwapChain* NullRHI::GetMainSwapChain()
+{
+    return m_main_swap_chain.get();
+}
+
+RHISemaphore* NullRHI::CreateGPUSemaphore()
+{
+    CountCall( NullRHICall::CreateGPUSemaphore );
+    return new NullSemaphore( this );
+}
+
+void NullRHI::Present( RHISwapChain& swap_chain, const PresentInfo& info )
+{
+    CountCall( NullRHICall::Present );
+
+    for ( size_t i = 0; i < info.semaphore_count; ++i )
+    {
+        VERIFY_NOT_EQUAL( info.wait_semaphores[i], nullptr );
+        RHIImpl( info.wait_semaphores[i] )->Wait();
+    }
+}
+
+void NullRHI::WaitIdle()
+{
+    CountCall( NullRHICall::WaitIdle );
+
+    if ( m_cmd_list_mgr )
+        m_cmd_list_mgr->WaitSubmittedUntilCompletion();
+
+    DestroyCompletedObjects( /*force=*/false );
+}
+
+RHICommandList* NullRHI::GetCommandList( QueueType type )
+{
+    CountCall( NullRHICall::GetCommandList );
+
+    VERIFY_NOT_EQUAL( m_cmd_list_mgr, nullptr );
+    VERIFY_EQUALS( IsQueueSupported( type ), true );
+
+    NullCommandList* cmd_list = m_cmd_list_mgr->GetCommandList( type );
+
+    cmd_list->Reset();
+
+    return cmd_list;
+}
+
+RHIFence NullRHI::SubmitCommandLists( const SubmitInfo& info )
+{
+    CountCall( NullRHICall::SubmitCommandLists );
+
+    VERIFY_NOT_EQUAL( m_cmd_list_mgr, nullptr );
+
+    RHIFence fence = m_cmd_list_mgr->SubmitCommandLists( info );
+
+    // Not necessary, but we have to do this somewhere at regular intervals
+    DestroyCompletedObjects( /*force=*/false );
+
+    return fence;
+}
+
+void NullRHI::WaitForFenceCompletion( const RHIFence& fence )
+{
+    CountCall( NullRHICall::WaitForFenceCompletion );
+
+    VERIFY_NOT_EQUAL( m_cmd_list_mgr, nullptr );
+
+    m_cmd_list_mgr->WaitForFence( fence );
+}
+
+bool NullRHI::IsFenceCompleted( const RHIFence& fence )
+{
+    CountCall( NullRHICall::IsFenceCompleted );
+
+    VERIFY_NOT_EQUAL( m_cmd_list_mgr, nullptr );
+
+    return m_cmd_list_mgr->IsFenceCompleted( fence );
+}
+
+RHIShader* NullRHI::CreateShader( const ShaderCreateInfo& create_info )
+{
+    CountCall( NullRHICall::CreateShader );
+    return new NullShader( this, create_info );
+}
+
+RHIDescriptorSetLayout* NullRHI::CreateDescriptorSetLayout( const DescriptorSetLayoutInfo& info )
+{
+    CountCall( NullRHICall::CreateDescriptorSetLayout );
+    return new NullDescriptorSetLayout( this, info );
+}
+
+RHIDescriptorSet* NullRHI::CreateDescriptorSet( RHIDescriptorSetLayout& layout )
+{
+    CountCall( NullRHICall::CreateDescriptorSet );
+    return new NullDescriptorSet( this, layout );
+}
+
+RHIDescriptorSet* NullRHI::CreateBindlessDescriptorSet( RHIDescriptorSetLayout& layout, uint32_t bindless_count )
+{
+    CountCall( NullRHICall::CreateDescriptorSet );
+    VERIFY( bindless_count <= m_info.max_bindless_descriptors );
+    return new NullDescriptorSet( this, layout, bindless_count );
+}
+
+RHIShaderBindingLayout* NullRHI::CreateShaderBindingLayout( const ShaderBindingLayoutInfo& info )
+{
+    CountCall( NullRHICall::CreateShaderBindingLayout );
+    return new NullShaderBindingLayout( this, info );
+}
+
+RHIGraphicsPipeline* NullRHI::CreatePSO( const RHIGraphicsPipelineInfo& pso_info )
+{
+    CountCall( NullRHICall::CreateGraphicsPSO );
+    return new NullGraphicsPSO( this, pso_info );
+}
+
+RHIRaytracingPipeline* NullRHI::CreatePSO( const RHIRaytracingPipelineInfo& pso_info )
+{
+    CountCall( NullRHICall::CreateRaytracingPSO );
+
+    if ( !SupportsRaytracing() )
+    {
+        SE_LOG_ERROR( NullRHI, "Raytracing pipeline requested, but the null RHI was created with enable_raytracing = false" );
+        return nullptr;
+    }
+
+    return new NullRaytracingPSO( this, pso_info );
+}
+
+RHIComputePipeline* NullRHI::CreatePSO( const RHIComputePipelineInfo& pso_info )
+{
+    CountCall( NullRHICall::CreateComputePSO );
+    return new NullComputePSO( this, pso_info );
+}
+
+RHIUploadBuffer* NullRHI::CreateUploadBuffer( const BufferInfo& buf_info )
+{
+    CountCall( NullRHICall::CreateUploadBuffer );
+    return new NullUploadBuffer( this, buf_info );
+}
+
+RHIReadbackBuffer* NullRHI::CreateReadbackBuffer( const BufferInfo& buf_info )
+{
+    CountCall( NullRHICall::CreateReadbackBuffer );
+    return new NullReadbackBuffer( this, buf_info );
+}
+
+RHIBuffer* NullRHI::CreateDeviceBuffer( const BufferInfo& buf_info )
+{
+    CountCall( NullRHICall::CreateDeviceBuffer );
+    return new NullBuffer( this, buf_info );
+}
+
+RHIASInstanceBuffer* NullRHI::CreateASInstanceBuffer( const ASInstanceBufferInfo& info )
+{
+    CountCall( NullRHICall::CreateASInstanceBuffer );
+    return new NullASInstanceBuffer( this, info );
+}
+
+RHITexture* NullRHI::CreateTexture( const TextureInfo& tex_info )
+{
+    CountCall( NullRHICall::CreateTexture );
+    return new NullTexture( this, tex_info );
+}
+
+RHIUniformBufferView* NullRHI::CreateUniformBufferView( const RHIBufferViewInfo& info )
+{
+    CountCall( NullRHICall::CreateUniformBufferView );
+    return new NullCBV( this, info );
+}
+
+RHITextureROView* NullRHI::CreateTextureROView( const TextureROViewInfo& info )
+{
+    CountCall( NullRHICall::CreateTextureROView );
+    return new NullTextureROView( this, info );
+}
+
+RHITextureRWView* NullRHI::CreateTextureRWView( const TextureRWViewInfo& info )
+{
+    CountCall( NullRHICall::CreateTextureRWView );
+    return new NullTextureRWView( this, /*make_hard_texture_ref=*/true, info );
+}
+
+RHIRenderTargetView* NullRHI::CreateRTV( const RenderTargetViewInfo& info )
+{
+    CountCall( NullRHICall::CreateRTV );
+    return new NullRTV( this, info );
+}
+
+RHISampler* NullRHI::CreateSampler( const SamplerInfo& info )
+{
+    CountCall( NullRHICall::CreateSampler );
+    return new NullSampler( this, info );
+}
+
+RHIAccelerationStructure* NullRHI::CreateAS( const ASInfo& info )
+{
+    CountCall( NullRHICall::CreateAS );
+
+    if ( !SupportsRaytracing() )
+    {
+        SE_LOG_ERROR( NullRHI, "Acceleration structure requested, but the null RHI was created with enable_raytracing = false" );
+        return nullptr;
+    }
+
+    return new NullAccelerationStructure( this, info );
+}
+
+bool NullRHI::GetASBuildSize( RHIAccelerationStructureType type, const RHIASGeometryInfo* geom_infos, size_t num_geoms, RHIASBuildFlags flags, RHIASBuildSizes& out_sizes )
+{
+    CountCall( NullRHICall::GetASBuildSize );
+
+    if ( !SupportsRaytracing() )
+        return false;
+
+    // Sizes only have to grow with the input the same way real ones do, so that callers can exercise their reallocation paths
+    constexpr size_t header_size = 256;
+    constexpr size_t node_size = 64;
+    constexpr size_t scratch_per_primitive = 32;
+
+    size_t num_primitives = 0;
+    for ( size_t i = 0; i < num_geoms; ++i )
+    {
+        const RHIASGeometryInfo& geom = geom_infos[i];
+        switch ( geom.type )
+        {
+        case RHIASGeometryType::Triangles:
+        {
+            if ( !SE_ENSURE( type == RHIAccelerationStructureType::BLAS && geom.triangles.idx_buf != nullptr ) )
+                return false;
+            const size_t index_size = geom.triangles.idx_type == RHIIndexBufferType::UInt16 ? sizeof( uint16_t ) : sizeof( uint32_t );
+            num_primitives += geom.triangles.idx_buf->GetSize() / index_size / 3;
+            break;
+        }
+        case RHIASGeometryType::Instances:
+            if ( !SE_ENSURE( type == RHIAccelerationStructureType::TLAS ) )
+                return false;
+            num_primitives += geom.instances.num_instances;
+            break;
+        default:
+            NOTIMPL;
+            return false;
+        }
+    }
+
+    out_sizes.as_size = header_size + num_primitives * node_size;
+    out_sizes.scratch_size = header_size + num_primitives * scratch_per_primitive;
+    out_sizes.update_scratch_size = 0;
+    if ( ( flags & RHIASBuildFlags::AllowUpdate ) != RHIASBuildFlags::None )
+    {
+        out_sizes.as_size += num_primitives * node_size / 4;
+        out_sizes.update_scratch_size = header_size + num_primitives * scratch_per_primitive / 4;
+    }
+
+    return true;
+}
+
+RHIMemoryHeap* NullRHI::CreateMemoryHeap( const MemoryHeapInfo& info )
+{
+    CountCall( NullRHICall::CreateMemoryHeap );
+    return new NullMemoryHeap( this, info );
+}
+
+RHIMemoryRequirements NullRHI::GetTextureMemoryRequirements( const TextureInfo& info ) const
+{
+    return NullTexture::GetMemoryRequirements( info );
+}
+
+RHIMemoryRequirements NullRHI::GetBufferMemoryRequirements( const BufferInfo& info ) const
+{
+    return NullBuffer::GetMemoryRequirements( info );
+}
+
+RHITexture* NullRHI::CreatePlacedTexture( const TextureInfo& info, RHIMemoryHeap& heap, uint64_t offset )
+{
+    CountCall( NullRHICall::CreatePlacedTexture );
+    return new NullTexture( this, info, RHIImpl( heap ), offset );
+}
+
+RHIBuffer* NullRHI::CreatePlacedBuffer( const BufferInfo& info, RHIMemoryHeap& heap, uint64_t offset )
+{
+    CountCall( NullRHICall::CreatePlacedBuffer );
+    return new NullBuffer( this, info, RHIImpl( heap ), offset );
+}
+
+bool NullRHI::ReloadAllShaders()
+{
+    CountCall( NullRHICall::ReloadAllShaders );
+
+    WaitIdle();
+
+    return true;
+}
+
+void NullRHI::DeferredDestroyRHIObject( RHIObject* obj )
+{
+    DeferredDeletion entry = {};
+    entry.obj = obj;
+    if ( m_cmd_list_mgr )
+        entry.submitted_counters = m_cmd_list_mgr->GetSubmittedCounters();
+
+    std::scoped_lock lock( m_objects_to_delete_lock );
+    m_objects_to_delete.emplace_back( entry );
+}
+
+void NullRHI::DestroyCompletedObjects( bool force )
+{
+    if ( m_cmd_list_mgr )
+        m_cmd_list_mgr->ProcessCompleted();
+
+    // destructors release their members, so repeat until nothing else can be destroyed
+    std::vector<DeferredDeletion> objects_to_check;
+    std::vector<DeferredDeletion> objects_still_in_use;
+    bool destroyed_any = false;
+    do
+    {
+        {
+            std::scoped_lock lock( m_objects_to_delete_lock );
+            objects_to_check.swap( m_objects_to_delete );
+        }
+
+        destroyed_any = false;
+        for ( const DeferredDeletion& entry : objects_to_check )
+        {
+            if ( force || !m_cmd_list_mgr || m_cmd_list_mgr->AreSubmissionsCompleted( entry.submitted_counters ) )
+            {
+                delete entry.obj;
+                destroyed_any = true;
+            }
+            else
+            {
+                objects_still_in_use.emplace_back( entry );
+            }
+        }
+        objects_to_check.clear();
+    } while ( destroyed_any );
+
+    std::scoped_lock lock( m_objects_to_delete_lock );
+    m_objects_to_delete.insert( m_objects_to_delete.end(), objects_still_in_use.begin(), objects_still_in_use.end() );
+}
+
+void NullRHI::OnCmdListsSubmitted( size_t cmd_list_count, size_t recorded_bytes )
+{
+    m_submitted_cmd_lists.fetch_add( cmd_list_count, std::memory_order_relaxed );
+    m_recorded_bytes.fetch_add( recorded_bytes, std::memory_order_relaxed );
+}
+
+NullRHIStats NullRHI::GetStats() const
+{
+    NullRHIStats stats = {};
+    for ( size_t i = 0; i < m_calls.size(); ++i )
+        stats.calls[i] = m_calls[i].load( std::memory_order_relaxed );
+
+    stats.submitted_cmd_lists = m_submitted_cmd_lists.load( std::memory_order_relaxed );
+    stats.recorded_bytes = m_recorded_bytes.load( std::memory_order_relaxed );
+    stats.allocated_buffer_memory = m_allocated_buffer_memory.load( std::memory_order_relaxed );
+    stats.uploaded_as_instances = m_uploaded_as_instances.load( std::memory_order_relaxed );
+    stats.as_updates = m_as_updates.load( std::memory_order_relaxed );
+
+    return stats;
+}
+
+void NullRHI::ResetStats()
+{
+    // allocated memory is a gauge, not a counter, so it is kept
+    for ( auto& calls : m_calls )
+        calls.store( 0, std::memory_order_relaxed );
+
+    m_submitted_cmd_lists.store( 0, std::memory_order_relaxed );
+    m_recorded_bytes.store( 0, std::memory_order_relaxed );
+    m_uploaded_as_instances.store( 0, std::memory_order_relaxed );
+    m_as_updates.store( 0, std::memory_order_relaxed );
+}
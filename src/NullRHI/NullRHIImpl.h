@@ -0,0 +1,148 @@
+#pragma once
+
+#include "StdAfx.h"
+
+#include <RHI/RHI.h>
+
+#include "NullRHI.h"
+
+#include "Swapchain.h"
+
+// Binary semaphore. Every wait has to be submitted after exactly one signal, same as in Vulkan.
+// Waiting submissions don't start until the signaling one completes
+class NullSemaphore : public RHISemaphore
+{
+    GENERATE_RHI_OBJECT_BODY()
+
+private:
+    bool m_signaled = false;
+    std::chrono::steady_clock::time_point m_signal_time = {};
+
+public:
+    NullSemaphore( class NullRHI* rhi ) : m_rhi( rhi ) {}
+
+    virtual ~NullSemaphore() override {}
+
+    // Not thread-safe, submissions are serialized by the command list manager
+    void Signal( std::chrono::steady_clock::time_point time );
+    std::chrono::steady_clock::time_point Wait();
+};
+IMPLEMENT_RHI_INTERFACE( RHISemaphore, NullSemaphore )
+
+class NullRHI : public RHI
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    NullRHICreateInfo m_info = {};
+
+    std::unique_ptr<class NullCommandListManager> m_cmd_list_mgr;
+
+    RHIObjectPtr<NullSwapChain> m_main_swap_chain = nullptr;
+
+    std::array<std::atomic<uint64_t>, size_t( NullRHICall::Count )> m_calls = {};
+    std::atomic<uint64_t> m_submitted_cmd_lists = 0;
+    std::atomic<uint64_t> m_recorded_bytes = 0;
+    std::atomic<uint64_t> m_allocated_buffer_memory = 0;
+    std::atomic<uint64_t> m_uploaded_as_instances = 0;
+    std::atomic<uint64_t> m_as_updates = 0;
+
+    struct DeferredDeletion
+    {
+        RHIObject* obj = nullptr;
+        std::array<uint64_t, size_t( QueueType::Count )> submitted_counters = {};
+    };
+    std::mutex m_objects_to_delete_lock;
+    std::vector<DeferredDeletion> m_objects_to_delete;
+
+public:
+    NullRHI( const NullRHICreateInfo& info );
+    virtual ~NullRHI() override;
+
+    virtual bool SupportsRaytracing() const override { return m_info.enable_raytracing; }
+
+    virtual bool IsQueueSupported( QueueType type ) const override { return type == QueueType::Graphics || ( m_info.enable_async_queues && type < QueueType::Count ); }
+
+    virtual RHISwapChain* CreateSwapChain( const RHISwapChainCreateInfo& create_info ) override;
+    virtual RHISwapChain* GetMainSwapChain() override;
+
+    virtual RHISemaphore* CreateGPUSemaphore() override;
+
+    virtual void Present( RHISwapChain& swap_chain, const PresentInfo& info ) override;
+
+    virtual void WaitIdle() override;
+
+    virtual RHICommandList* GetCommandList( QueueType type ) override;
+
+    virtual RHIFence SubmitCommandLists( const SubmitInfo& info ) override;
+
+    virtual void WaitForFenceCompletion( const RHIFence& fence ) override;
+    virtual bool IsFenceCompleted( const RHIFence& fence ) override;
+
+    virtual RHIShader* CreateShader( const ShaderCreateInfo& create_info ) override;
+
+    virtual RHIDescriptorSetLayout* CreateDescriptorSetLayout( const DescriptorSetLayoutInfo& info ) override;
+    virtual RHIDescriptorSet* CreateDescriptorSet( RHIDescriptorSetLayout& layout ) override;
+    virtual RHIDescriptorSet* CreateBindlessDescriptorSet( RHIDescriptorSetLayout& layout, uint32_t bindless_count ) override;
+    virtual uint32_t GetMaxBindlessDescriptors( RHIShaderBindingType type ) const override { return m_info.max_bindless_descriptors; }
+    virtual RHIShaderBindingLayout* CreateShaderBindingLayout( const ShaderBindingLayoutInfo& info ) override;
+
+    virtual RHIGraphicsPipeline* CreatePSO( const RHIGraphicsPipelineInfo& pso_info ) override;
+    virtual RHIRaytracingPipeline* CreatePSO( const RHIRaytracingPipelineInfo& pso_info ) override;
+    virtual RHIComputePipeline* CreatePSO( const RHIComputePipelineInfo& pso_info ) override;
+
+    virtual RHIUploadBuffer* CreateUploadBuffer( const BufferInfo& buf_info ) override;
+    virtual RHIReadbackBuffer* CreateReadbackBuffer( const BufferInfo& buf_info ) override;
+    virtual RHIBuffer* CreateDeviceBuffer( const BufferInfo& buf_info ) override;
+
+    virtual RHIASInstanceBuffer* CreateASInstanceBuffer( const ASInstanceBufferInfo& info ) override;
+
+    virtual RHITexture* CreateTexture( const TextureInfo& tex_info ) override;
+
+    virtual RHIUniformBufferView* CreateUniformBufferView( const RHIBufferViewInfo& info ) override;
+    virtual RHITextureROView* CreateTextureROView( const TextureROViewInfo& info ) override;
+    virtual RHITextureRWView* CreateTextureRWView( const TextureRWViewInfo& info ) override;
+    virtual RHIRenderTargetView* CreateRTV( const RenderTargetViewInfo& info ) override;
+
+    virtual RHISampler* CreateSampler( const SamplerInfo& info ) override;
+
+    virtual RHIAccelerationStructure* CreateAS( const ASInfo& info ) override;
+
+    virtual bool GetASBuildSize( RHIAccelerationStructureType type, const RHIASGeometryInfo* geom_infos, size_t num_geoms, RHIASBuildFlags flags, RHIASBuildSizes& out_sizes ) override;
+
+    virtual bool SupportsPlacedResources() const override { return true; }
+
+    virtual RHIMemoryHeap* CreateMemoryHeap( const MemoryHeapInfo& info ) override;
+
+    virtual RHIMemoryRequirements GetTextureMemoryRequirements( const TextureInfo& info ) const override;
+    virtual RHIMemoryRequirements GetBufferMemoryRequirements( const BufferInfo& info ) const override;
+
+    virtual RHITexture* CreatePlacedTexture( const TextureInfo& info, RHIMemoryHeap& heap, uint64_t offset ) override;
+    virtual RHIBuffer* CreatePlacedBuffer( const BufferInfo& info, RHIMemoryHeap& heap, uint64_t offset ) override;
+
+    virtual bool ReloadAllShaders() override;
+
+    virtual uint64_t GetUniformBufferMinAlignment() const override { return m_info.uniform_buffer_alignment; }
+
+    // Thread-safe
+    void DeferredDestroyRHIObject( RHIObject* obj );
+
+    // Thread-safe
+    void CountCall( NullRHICall call ) { m_calls[size_t( call )].fetch_add( 1, std::memory_order_relaxed ); }
+    void OnCmdListsSubmitted( size_t cmd_list_count, size_t recorded_bytes );
+    void OnBufferAllocated( size_t size ) { m_allocated_buffer_memory.fetch_add( size, std::memory_order_relaxed ); }
+    void OnBufferFreed( size_t size ) { m_allocated_buffer_memory.fetch_sub( size, std::memory_order_relaxed ); }
+    void OnASInstancesUploaded( size_t num_instances ) { m_uploaded_as_instances.fetch_add( num_instances, std::memory_order_relaxed ); }
+    void OnASUpdated() { m_as_updates.fetch_add( 1, std::memory_order_relaxed ); }
+
+    NullRHIStats GetStats() const;
+    void ResetStats();
+
+    Clock::duration GetGPULatency() const { return std::chrono::microseconds( m_info.gpu_latency_us ); }
+
+    const NullRHICreateInfo& GetCreateInfo() const { return m_info; }
+
+private:
+    void DestroyCompletedObjects( bool force );
+};
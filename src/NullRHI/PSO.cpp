@@ -0,0 +1,211 @@
+#include "StdAfx.h"
+
+#include "PSO.h"
+
+#include "NullRHIImpl.h"
+
+IMPLEMENT_RHI_OBJECT( NullShader )
+
+NullShader::NullShader( NullRHI* rhi, const RHI::ShaderCreateInfo& info )
+    : m_rhi( rhi ), m_frequency( info.frequency )
+{
+    VERIFY_NOT_EQUAL( info.filename, nullptr );
+
+    m_filename = info.filename;
+    m_entry_point = info.entry_point ? info.entry_point : "main";
+}
+
+NullShader::~NullShader()
+{
+}
+
+
+IMPLEMENT_RHI_OBJECT( NullDescriptorSetLayout )
+
+NullDescriptorSetLayout::NullDescriptorSetLayout( NullRHI* rhi, const RHI::DescriptorSetLayoutInfo& info )
+    : m_rhi( rhi )
+{
+    m_ranges.assign( info.ranges, info.ranges + info.range_count );
+}
+
+NullDescriptorSetLayout::~NullDescriptorSetLayout()
+{
+}
+
+
+IMPLEMENT_RHI_OBJECT( NullShaderBindingLayout )
+
+NullShaderBindingLayout::NullShaderBindingLayout( NullRHI* rhi, const RHI::ShaderBindingLayoutInfo& info )
+    : m_rhi( rhi ), m_push_constants_size( info.push_constants_size )
+{
+    m_tables.resize( info.table_count );
+    for ( size_t i = 0; i < info.table_count; ++i )
+    {
+        VERIFY_NOT_EQUAL( info.tables[i], nullptr );
+        m_tables[i] = &RHIImpl( *info.tables[i] );
+    }
+}
+
+NullShaderBindingLayout::~NullShaderBindingLayout()
+{
+}
+
+
+IMPLEMENT_RHI_OBJECT( NullDescriptorSet )
+
+NullDescriptorSet::NullDescriptorSet( NullRHI* rhi, RHIDescriptorSetLayout& layout, int64_t bindless_count )
+    : m_rhi( rhi )
+{
+    m_layout = &RHIImpl( layout );
+
+    const auto& ranges = m_layout->GetRanges();
+    m_ranges.resize( ranges.size() );
+    for ( size_t i = 0; i < ranges.size(); ++i )
+    {
+        if ( ranges[i].count > 0 )
+            m_ranges[i].resize( size_t( ranges[i].count ) );
+    }
+
+    if ( bindless_count >= 0 )
+    {
+        VERIFY( !ranges.empty() && ranges.back().count < 0 );
+        m_ranges.back().resize( size_t( bindless_count ) );
+        m_fixed_bindless_size = true;
+    }
+}
+
+NullDescriptorSet::~NullDescriptorSet()
+{
+}
+
+void NullDescriptorSet::BindUniformBufferView( size_t range_idx, size_t idx_in_range, RHIUniformBufferView& cbv )
+{
+    Bind( RHIShaderBindingType::UniformBuffer, range_idx, idx_in_range, Binding{ &cbv } );
+}
+
+void NullDescriptorSet::BindUniformBufferView( size_t range_idx, size_t idx_in_range, const RHIBufferViewInfo& cbv )
+{
+    VERIFY_NOT_EQUAL( cbv.buffer, nullptr );
+
+    Bind( RHIShaderBindingType::UniformBuffer, range_idx, idx_in_range, Binding{ cbv.buffer, cbv.offset, cbv.range } );
+}
+
+void NullDescriptorSet::BindTextureROView( size_t range_idx, size_t idx_in_range, RHITextureROView& srv )
+{
+    Bind( RHIShaderBindingType::TextureRO, range_idx, idx_in_range, Binding{ &srv } );
+}
+
+void NullDescriptorSet::BindTextureRWView( size_t range_idx, size_t idx_in_range, RHITextureRWView& uav )
+{
+    Bind( RHIShaderBindingType::TextureRW, range_idx, idx_in_range, Binding{ &uav } );
+}
+
+void NullDescriptorSet::BindAccelerationStructure( size_t range_idx, size_t idx_in_range, RHIAccelerationStructure& as )
+{
+    Bind( RHIShaderBindingType::AccelerationStructure, range_idx, idx_in_range, Binding{ &as } );
+}
+
+void NullDescriptorSet::BindSampler( size_t range_idx, size_t idx_in_range, RHISampler& sampler )
+{
+    Bind( RHIShaderBindingType::Sampler, range_idx, idx_in_range, Binding{ &sampler } );
+}
+
+void NullDescriptorSet::BindStructuredBuffer( size_t range_idx, size_t idx_in_range, const RHIBufferViewInfo& view )
+{
+    VERIFY_NOT_EQUAL( view.buffer, nullptr );
+
+    Bind( RHIShaderBindingType::StructuredBuffer, range_idx, idx_in_range, Binding{ view.buffer, view.offset, view.range } );
+}
+
+void NullDescriptorSet::FlushBinds()
+{
+    m_rhi->CountCall( NullRHICall::FlushBinds );
+
+    m_pending_binds = 0;
+}
+
+const void* NullDescriptorSet::GetBoundObject( size_t range_idx, size_t idx_in_range ) const
+{
+    if ( range_idx >= m_ranges.size() || idx_in_range >= m_ranges[range_idx].size() )
+        return nullptr;
+
+    return m_ranges[range_idx][idx_in_range].object;
+}
+
+void NullDescriptorSet::Bind( RHIShaderBindingType type, size_t range_idx, size_t idx_in_range, const Binding& binding )
+{
+    m_rhi->CountCall( NullRHICall::BindDescriptor );
+
+    const auto& layout_ranges = m_layout->GetRanges();
+    VERIFY( range_idx < layout_ranges.size() );
+    VERIFY_EQUALS( layout_ranges[range_idx].type, type );
+
+    auto& range = m_ranges[range_idx];
+    if ( layout_ranges[range_idx].count < 0 && !m_fixed_bindless_size )
+    {
+        // unbounded range
+        if ( idx_in_range >= range.size() )
+            range.resize( idx_in_range + 1 );
+    }
+    VERIFY( idx_in_range < range.size() );
+
+    range[idx_in_range] = binding;
+    m_pending_binds++;
+}
+
+
+IMPLEMENT_RHI_OBJECT( NullGraphicsPSO )
+
+NullGraphicsPSO::NullGraphicsPSO( NullRHI* rhi, const RHIGraphicsPipelineInfo& info )
+    : m_rhi( rhi )
+{
+    VERIFY_NOT_EQUAL( info.binding_layout, nullptr );
+    VERIFY_NOT_EQUAL( info.vs, nullptr );
+
+    m_shader_bindings = &RHIImpl( *info.binding_layout );
+    m_vs = &RHIImpl( *info.vs );
+    if ( info.ps )
+        m_ps = &RHIImpl( *info.ps );
+}
+
+NullGraphicsPSO::~NullGraphicsPSO()
+{
+}
+
+
+IMPLEMENT_RHI_OBJECT( NullRaytracingPSO )
+
+NullRaytracingPSO::NullRaytracingPSO( NullRHI* rhi, const RHIRaytracingPipelineInfo& info )
+    : m_rhi( rhi )
+{
+    VERIFY_NOT_EQUAL( info.binding_layout, nullptr );
+    VERIFY_NOT_EQUAL( info.raygen_shader, nullptr );
+
+    m_shader_bindings = &RHIImpl( *info.binding_layout );
+    m_rgs = &RHIImpl( *info.raygen_shader );
+    if ( info.miss_shader )
+        m_rms = &RHIImpl( *info.miss_shader );
+    if ( info.closest_hit_shader )
+        m_rcs = &RHIImpl( *info.closest_hit_shader );
+}
+
+NullRaytracingPSO::~NullRaytracingPSO()
+{
+}
+
+
+IMPLEMENT_RHI_OBJECT( NullComputePSO )
+
+NullComputePSO::NullComputePSO( NullRHI* rhi, const RHIComputePipelineInfo& info )
+    : m_rhi( rhi )
+{
+    VERIFY_NOT_EQUAL( info.binding_layout, nullptr );
+    VERIFY_NOT_EQUAL( info.compute_shader, nullptr );
+
+    m_shader_bindings = &RHIImpl( *info.binding_layout );
+    m_cs = &RHIImpl( *info.compute_shader );
+}
+
+NullComputePSO::~NullComputePSO()
+{
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "StdAfx.h"
+
+#include <RHI/RHI.h>
+
+// Shaders are never compiled, pipelines only keep references to what they were created from
+
+class NullShader : public RHIShader
+{
+    GENERATE_RHI_OBJECT_BODY()
+
+    std::wstring m_filename;
+    std::string m_entry_point;
+    RHI::ShaderFrequency m_frequency = RHI::ShaderFrequency::Vertex;
+
+public:
+    NullShader( NullRHI* rhi, const RHI::ShaderCreateInfo& info );
+
+    virtual ~NullShader() override;
+
+    const wchar_t* GetFileName() const { return m_filename.c_str(); }
+    const char* GetEntryPoint() const { return m_entry_point.c_str(); }
+    RHI::ShaderFrequency GetFrequency() const { return m_frequency; }
+};
+IMPLEMENT_RHI_INTERFACE( RHIShader, NullShader )
+
+class NullDescriptorSetLayout : public RHIDescriptorSetLayout
+{
+    GENERATE_RHI_OBJECT_BODY()
+
+    std::vector<RHI::DescriptorViewRange> m_ranges;
+
+public:
+    NullDescriptorSetLayout( NullRHI* rhi, const RHI::DescriptorSetLayoutInfo& info );
+
+    virtual ~NullDescriptorSetLayout() override;
+
+    const std::vector<RHI::DescriptorViewRange>& GetRanges() const { return m_ranges; }
+};
+IMPLEMENT_RHI_INTERFACE( RHIDescriptorSetLayout, NullDescriptorSetLayout )
+
+class NullShaderBindingLayout : public RHIShaderBindingLayout
+{
+    GENERATE_RHI_OBJECT_BODY()
+
+    std::vector<RHIObjectPtr<NullDescriptorSetLayout>> m_tables;
+    size_t m_push_constants_size = 0;
+
+public:
+    NullShaderBindingLayout( NullRHI* rhi, const RHI::ShaderBindingLayoutInfo& info );
+
+    virtual ~NullShaderBindingLayout() override;
+
+    size_t GetTableCount() const { return m_tables.size(); }
+    size_t GetPushConstantsSize() const { return m_push_constants_size; }
+};
+IMPLEMENT_RHI_INTERFACE( RHIShaderBindingLayout, NullShaderBindingLayout )
+
+// Bindings are validated against the layout and stored as raw pointers to the bound objects
+class NullDescriptorSet : public RHIDescriptorSet
+{
+    GENERATE_RHI_OBJECT_BODY()
+
+    RHIObjectPtr<NullDescriptorSetLayout> m_layout = nullptr;
+
+    struct Binding
+    {
+        const void* object = nullptr;
+        uint64_t offset = 0;
+        uint64_t range = 0;
+    };
+    std::vector<std::vector<Binding>> m_ranges;
+
+    uint32_t m_pending_binds = 0;
+    bool m_fixed_bindless_size = false;
+
+public:
+    // bindless_count is the size of the unbound range, the last one. Negative means it grows with the binds
+    NullDescriptorSet( NullRHI* rhi, RHIDescriptorSetLayout& layout, int64_t bindless_count = -1 );
+
+    virtual ~NullDescriptorSet() override;
+
+    virtual void BindUniformBufferView( size_t range_idx, size_t idx_in_range, RHIUniformBufferView& cbv ) override;
+    virtual void BindUniformBufferView( size_t range_idx, size_t idx_in_range, const RHIBufferViewInfo& cbv ) override;
+    virtual void BindTextureROView( size_t range_idx, size_t idx_in_range, RHITextureROView& srv ) override;
+    virtual void BindTextureRWView( size_t range_idx, size_t idx_in_range, RHITextureRWView& uav ) override;
+    virtual void BindAccelerationStructure( size_t range_idx, size_t idx_in_range, RHIAccelerationStructure& as ) override;
+    virtual void BindSampler( size_t range_idx, size_t idx_in_range, RHISampler& sampler ) override;
+    virtual void BindStructuredBuffer( size_t range_idx, size_t idx_in_range, const RHIBufferViewInfo& view ) override;
+
+    virtual void FlushBinds() override;
+
+    const void* GetBoundObject( size_t range_idx, size_t idx_in_range ) const;
+
+private:
+    void Bind( RHIShaderBindingType type, size_t range_idx, size_t idx_in_range, const Binding& binding );
+};
+IMPLEMENT_RHI_INTERFACE( RHIDescriptorSet, NullDescriptorSet )
+
+class NullGraphicsPSO : public RHIGraphicsPipeline
+{
+    GENERATE_RHI_OBJECT_BODY()
+
+    RHIObjectPtr<NullShaderBindingLayout> m_shader_bindings = nullptr;
+    RHIObjectPtr<NullShader> m_vs = nullptr;
+    RHIObjectPtr<NullShader> m_ps = nullptr;
+
+public:
+    NullGraphicsPSO( NullRHI* rhi, const RHIGraphicsPipelineInfo& info );
+
+    virtual ~NullGraphicsPSO() override;
+};
+IMPLEMENT_RHI_INTERFACE( RHIGraphicsPipeline, NullGraphicsPSO )
+
+class NullRaytracingPSO : public RHIRaytracingPipeline
+{
+    GENERATE_RHI_OBJECT_BODY()
+
+    RHIObjectPtr<NullShaderBindingLayout> m_shader_bindings = nullptr;
+    RHIObjectPtr<NullShader> m_rgs = nullptr;
+    RHIObjectPtr<NullShader> m_rms = nullptr;
+    RHIObjectPtr<NullShader> m_rcs = nullptr;
+
+public:
+    NullRaytracingPSO( NullRHI* rhi, const RHIRaytracingPipelineInfo& info );
+
+    virtual ~NullRaytracingPSO() override;
+};
+IMPLEMENT_RHI_INTERFACE( RHIRaytracingPipeline, NullRaytracingPSO )
+
+class NullComputePSO : public RHIComputePipeline
+{
+    GENERATE_RHI_OBJECT_BODY()
+
+    RHIObjectPtr<NullShaderBindingLayout> m_shader_bindings = nullptr;
+    RHIObjectPtr<NullShader> m_cs = nullptr;
+
+public:
+    NullComputePSO( NullRHI* rhi, const RHIComputePipelineInfo& info );
+
+    virtual ~NullComputePSO() override;
+};
+IMPLEMENT_RHI_INTERFACE( RHIComputePipeline, NullComputePSO )
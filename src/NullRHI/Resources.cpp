@@ -0,0 +1,326 @@
+#include "StdAfx.h"
+
+#include "Resources.h"
+
+#include "NullRHIImpl.h"
+
+namespace
+{
+    uint32_t GetFormatSize( RHIFormat format )
+    {
+        switch ( format )
+        {
+        case RHIFormat::R32G32_SFLOAT: return 8;
+        case RHIFormat::R32G32B32_SFLOAT: return 12;
+        case RHIFormat::B8G8R8A8_SRGB: return 4;
+        case RHIFormat::R8G8B8A8_SRGB: return 4;
+        case RHIFormat::R8G8B8A8_UNORM: return 4;
+        case RHIFormat::RGB9E5: return 4;
+        case RHIFormat::RGBA32_SFLOAT: return 16;
+        case RHIFormat::R16_UINT: return 2;
+        case RHIFormat::RGB8_SRGB: return 3;
+        // per 4x4 block
+        case RHIFormat::BC1_UNORM: return 8;
+        case RHIFormat::BC1_SRGB: return 8;
+        case RHIFormat::BC4_UNORM: return 8;
+        case RHIFormat::BC5_UNORM: return 16;
+        case RHIFormat::BC6H_UFLOAT: return 16;
+        case RHIFormat::BC7_UNORM: return 16;
+        case RHIFormat::BC7_SRGB: return 16;
+        }
+        NOTIMPL;
+        return 0;
+    }
+
+    uint32_t GetFormatBlockDim( RHIFormat format )
+    {
+        return format >= RHIFormat::BC1_UNORM && format <= RHIFormat::BC7_SRGB ? 4 : 1;
+    }
+}
+
+
+IMPLEMENT_RHI_OBJECT( NullMemoryHeap )
+
+NullMemoryHeap::NullMemoryHeap( NullRHI* rhi, const RHI::MemoryHeapInfo& info )
+    : m_rhi( rhi )
+{
+    VERIFY_NOT_EQUAL( info.size, 0 );
+
+    m_data.resize( info.size );
+
+    m_rhi->OnBufferAllocated( m_data.size() );
+}
+
+NullMemoryHeap::~NullMemoryHeap()
+{
+    m_rhi->OnBufferFreed( m_data.size() );
+}
+
+
+IMPLEMENT_RHI_OBJECT( NullBuffer )
+
+NullBuffer::NullBuffer( NullRHI* rhi, const RHI::BufferInfo& info )
+    : m_rhi( rhi ), m_usage( info.usage )
+{
+    VERIFY_NOT_EQUAL( info.size, 0 );
+
+    m_data.resize( info.size );
+    m_ptr = m_data.data();
+    m_size = m_data.size();
+
+    m_rhi->OnBufferAllocated( m_data.size() );
+}
+
+NullBuffer::NullBuffer( NullRHI* rhi, const RHI::BufferInfo& info, NullMemoryHeap& heap, uint64_t offset )
+    : m_rhi( rhi ), m_usage( info.usage )
+{
+    VERIFY_NOT_EQUAL( info.size, 0 );
+    VERIFY( offset % NullBufferPlacementAlignment == 0 );
+    VERIFY( offset + info.size <= heap.GetSize() );
+
+    // heap memory is already accounted for
+    m_heap = &heap;
+    m_ptr = heap.GetData() + offset;
+    m_size = info.size;
+}
+
+NullBuffer::~NullBuffer()
+{
+    m_rhi->OnBufferFreed( m_data.size() );
+}
+
+RHIMemoryRequirements NullBuffer::GetMemoryRequirements( const RHI::BufferInfo& info )
+{
+    RHIMemoryRequirements requirements = {};
+    requirements.alignment = NullBufferPlacementAlignment;
+    requirements.size = CalcAlignedSize( info.size, requirements.alignment );
+
+    return requirements;
+}
+
+
+IMPLEMENT_RHI_OBJECT( NullUploadBuffer )
+
+NullUploadBuffer::NullUploadBuffer( NullRHI* rhi, const RHI::BufferInfo& info )
+    : m_rhi( rhi )
+{
+    m_buffer = new NullBuffer( rhi, info );
+}
+
+NullUploadBuffer::~NullUploadBuffer()
+{
+}
+
+void NullUploadBuffer::WriteBytes( const void* src, size_t size, size_t offset )
+{
+    m_rhi->CountCall( NullRHICall::WriteBytes );
+
+    VERIFY( offset + size <= m_buffer->GetSize() );
+    memcpy( m_buffer->GetData() + offset, src, size );
+}
+
+
+IMPLEMENT_RHI_OBJECT( NullReadbackBuffer )
+
+NullReadbackBuffer::NullReadbackBuffer( NullRHI* rhi, const RHI::BufferInfo& info )
+    : m_rhi( rhi )
+{
+    m_buffer = new NullBuffer( rhi, info );
+}
+
+NullReadbackBuffer::~NullReadbackBuffer()
+{
+}
+
+void NullReadbackBuffer::ReadBytes( void* dst, size_t size, size_t offset )
+{
+    m_rhi->CountCall( NullRHICall::ReadBytes );
+
+    VERIFY( offset + size <= m_buffer->GetSize() );
+    memcpy( dst, m_buffer->GetData() + offset, size );
+}
+
+
+IMPLEMENT_RHI_OBJECT( NullASInstanceBuffer )
+
+NullASInstanceBuffer::NullASInstanceBuffer( NullRHI* rhi, const RHI::ASInstanceBufferInfo& info )
+    : m_rhi( rhi )
+{
+    m_instances.assign( info.data, info.data + info.num_instances );
+}
+
+NullASInstanceBuffer::~NullASInstanceBuffer()
+{
+}
+
+void NullASInstanceBuffer::UpdateBuffer( const RHIASInstanceData* data, size_t num_instances )
+{
+    m_rhi->CountCall( NullRHICall::UpdateASInstanceBuffer );
+    m_rhi->OnASInstancesUploaded( num_instances );
+
+    // same growth policy as the vulkan backend
+    if ( m_instances.size() < num_instances )
+        m_instances.resize( num_instances + num_instances / 4 );
+    std::copy( data, data + num_instances, m_instances.begin() );
+}
+
+void NullASInstanceBuffer::UpdateBufferRange( const RHIASInstanceData* data, size_t first_instance, size_t num_instances )
+{
+    m_rhi->CountCall( NullRHICall::UpdateASInstanceBuffer );
+    m_rhi->OnASInstancesUploaded( num_instances );
+
+    VERIFY( first_instance + num_instances <= m_instances.size() );
+    std::copy( data, data + num_instances, m_instances.begin() + first_instance );
+}
+
+
+IMPLEMENT_RHI_OBJECT( NullAccelerationStructure )
+
+NullAccelerationStructure::NullAccelerationStructure( NullRHI* rhi, const RHI::ASInfo& info )
+    : m_rhi( rhi ), m_type( info.type )
+{
+    RHI::BufferInfo buffer_info = {};
+    buffer_info.size = info.size;
+    buffer_info.usage = RHIBufferUsageFlags::AccelerationStructure;
+    m_underlying_buffer = new NullBuffer( rhi, buffer_info );
+}
+
+NullAccelerationStructure::~NullAccelerationStructure()
+{
+}
+
+
+IMPLEMENT_RHI_OBJECT( NullTexture )
+
+NullTexture::NullTexture( NullRHI* rhi, const RHI::TextureInfo& info )
+    : m_rhi( rhi ), m_info( info )
+{
+    CreateBaseView();
+}
+
+NullTexture::NullTexture( NullRHI* rhi, const RHI::TextureInfo& info, NullMemoryHeap& heap, uint64_t offset )
+    : m_rhi( rhi ), m_info( info ), m_heap( &heap ), m_heap_offset( offset )
+{
+    VERIFY( offset % NullTexturePlacementAlignment == 0 );
+    VERIFY( offset + GetMemoryRequirements( info ).size <= heap.GetSize() );
+
+    CreateBaseView();
+}
+
+NullTexture::~NullTexture()
+{
+}
+
+RHIMemoryRequirements NullTexture::GetMemoryRequirements( const RHI::TextureInfo& info )
+{
+    const uint64_t element_size = GetFormatSize( info.format );
+    const uint32_t block_dim = GetFormatBlockDim( info.format );
+
+    uint64_t size = 0;
+    for ( uint32_t mip = 0; mip < std::max( info.mips, 1u ); ++mip )
+    {
+        const uint64_t width = ( std::max( info.width >> mip, 1u ) + block_dim - 1 ) / block_dim;
+        const uint64_t height = ( std::max( info.height >> mip, 1u ) + block_dim - 1 ) / block_dim;
+        const uint64_t depth = std::max( info.depth >> mip, 1u );
+        size += width * height * depth * element_size;
+    }
+    size *= std::max( info.array_layers, 1u );
+
+    RHIMemoryRequirements requirements = {};
+    requirements.alignment = NullTexturePlacementAlignment;
+    requirements.size = CalcAlignedSize( size, requirements.alignment );
+
+    return requirements;
+}
+
+void NullTexture::CreateBaseView()
+{
+    if ( bool( m_info.usage & RHITextureUsageFlags::TextureRWView ) )
+    {
+        RHI::TextureRWViewInfo view_info;
+        view_info.format = m_info.format;
+        view_info.texture = this;
+
+        // Not making a hard back reference here to avoid circular dependency
+        m_base_rw_view = new NullTextureRWView( m_rhi, /*make_hard_texture_ref=*/false, view_info );
+    }
+}
+
+
+IMPLEMENT_RHI_OBJECT( NullSampler )
+
+NullSampler::NullSampler( NullRHI* rhi, const RHI::SamplerInfo& info )
+    : m_rhi( rhi ), m_info( info )
+{
+}
+
+NullSampler::~NullSampler()
+{
+}
+
+
+IMPLEMENT_RHI_OBJECT( NullCBV )
+
+NullCBV::NullCBV( NullRHI* rhi, const RHIBufferViewInfo& info )
+    : m_rhi( rhi ), m_view_info( info )
+{
+    VERIFY_NOT_EQUAL( info.buffer, nullptr );
+
+    m_buffer = &RHIImpl( *info.buffer );
+}
+
+NullCBV::~NullCBV()
+{
+}
+
+
+IMPLEMENT_RHI_OBJECT( NullTextureROView )
+
+NullTextureROView::NullTextureROView( NullRHI* rhi, const RHI::TextureROViewInfo& info )
+    : m_rhi( rhi )
+{
+    VERIFY_NOT_EQUAL( info.texture, nullptr );
+
+    m_texture = &RHIImpl( *info.texture );
+}
+
+NullTextureROView::~NullTextureROView()
+{
+}
+
+
+IMPLEMENT_RHI_OBJECT( NullTextureRWView )
+
+NullTextureRWView::NullTextureRWView( NullRHI* rhi, bool make_hard_texture_ref, const RHI::TextureRWViewInfo& info )
+    : m_rhi( rhi )
+{
+    VERIFY_NOT_EQUAL( info.texture, nullptr );
+
+    m_texture = &RHIImpl( *info.texture );
+    if ( make_hard_texture_ref )
+    {
+        m_texture_ref = &RHIImpl( *info.texture );
+    }
+
+    m_format = info.format == RHIFormat::Undefined ? m_texture->GetFormat() : info.format;
+}
+
+NullTextureRWView::~NullTextureRWView()
+{
+}
+
+
+IMPLEMENT_RHI_OBJECT( NullRTV )
+
+NullRTV::NullRTV( NullRHI* rhi, const RHI::RenderTargetViewInfo& info )
+    : m_rhi( rhi )
+{
+    VERIFY_NOT_EQUAL( info.texture, nullptr );
+
+    m_texture = &RHIImpl( *info.texture );
+    m_format = info.format == RHIFormat::Undefined ? m_texture->GetFormat() : info.format;
+}
+
+NullRTV::~NullRTV()
+{
+}
@@ -0,0 +1,277 @@
+#pragma once
+
+#include "StdAfx.h"
+
+#include <RHI/RHI.h>
+
+// Buffers are plain host memory, so uploads, buffer copies and readbacks carry real data.
+// Textures only keep their description, copies into them are recorded and skipped on execution.
+// Placed buffers point into their heap's memory, so aliased buffers really share data
+
+// Resources placed into the same heap are aligned the same way on every platform to keep aliasing decisions comparable
+static constexpr uint64_t NullTexturePlacementAlignment = 64 * SizeKB;
+static constexpr uint64_t NullBufferPlacementAlignment = 256;
+
+class NullMemoryHeap : public RHIMemoryHeap
+{
+    GENERATE_RHI_OBJECT_BODY()
+
+    std::vector<uint8_t> m_data;
+
+public:
+    NullMemoryHeap( NullRHI* rhi, const RHI::MemoryHeapInfo& info );
+
+    virtual ~NullMemoryHeap() override;
+
+    virtual uint64_t GetSize() const override { return m_data.size(); }
+
+    uint8_t* GetData() { return m_data.data(); }
+};
+IMPLEMENT_RHI_INTERFACE( RHIMemoryHeap, NullMemoryHeap )
+using NullMemoryHeapPtr = RHIObjectPtr<NullMemoryHeap>;
+
+class NullBuffer : public RHIBuffer
+{
+    GENERATE_RHI_OBJECT_BODY()
+
+    // either owned memory or a range of m_heap
+    std::vector<uint8_t> m_data;
+    NullMemoryHeapPtr m_heap = nullptr;
+    uint8_t* m_ptr = nullptr;
+    size_t m_size = 0;
+
+    RHIBufferUsageFlags m_usage = RHIBufferUsageFlags::None;
+
+public:
+    NullBuffer( NullRHI* rhi, const RHI::BufferInfo& info );
+    NullBuffer( NullRHI* rhi, const RHI::BufferInfo& info, NullMemoryHeap& heap, uint64_t offset );
+
+    virtual ~NullBuffer() override;
+
+    virtual size_t GetSize() const override { return m_size; }
+
+    RHIBufferUsageFlags GetUsage() const { return m_usage; }
+
+    uint8_t* GetData() { return m_ptr; }
+    const uint8_t* GetData() const { return m_ptr; }
+
+    const NullMemoryHeap* GetHeap() const { return m_heap.get(); }
+
+    static RHIMemoryRequirements GetMemoryRequirements( const RHI::BufferInfo& info );
+};
+IMPLEMENT_RHI_INTERFACE( RHIBuffer, NullBuffer )
+using NullBufferPtr = RHIObjectPtr<NullBuffer>;
+
+class NullUploadBuffer : public RHIUploadBuffer
+{
+    GENERATE_RHI_OBJECT_BODY()
+
+    NullBufferPtr m_buffer = nullptr;
+
+public:
+    NullUploadBuffer( NullRHI* rhi, const RHI::BufferInfo& info );
+
+    virtual ~NullUploadBuffer() override;
+
+    virtual void WriteBytes( const void* src, size_t size, size_t offset ) override;
+
+    virtual RHIBuffer* GetBuffer() override { return m_buffer.get(); }
+    virtual const RHIBuffer* GetBuffer() const override { return m_buffer.get(); }
+};
+IMPLEMENT_RHI_INTERFACE( RHIUploadBuffer, NullUploadBuffer )
+using NullUploadBufferPtr = RHIObjectPtr<NullUploadBuffer>;
+
+class NullReadbackBuffer : public RHIReadbackBuffer
+{
+    GENERATE_RHI_OBJECT_BODY()
+
+    NullBufferPtr m_buffer = nullptr;
+
+public:
+    NullReadbackBuffer( NullRHI* rhi, const RHI::BufferInfo& info );
+
+    virtual ~NullReadbackBuffer() override;
+
+    virtual void ReadBytes( void* dst, size_t size, size_t offset ) override;
+
+    virtual RHIBuffer* GetBuffer() override { return m_buffer.get(); }
+    virtual const RHIBuffer* GetBuffer() const override { return m_buffer.get(); }
+};
+IMPLEMENT_RHI_INTERFACE( RHIReadbackBuffer, NullReadbackBuffer )
+using NullReadbackBufferPtr = RHIObjectPtr<NullReadbackBuffer>;
+
+class NullASInstanceBuffer : public RHIASInstanceBuffer
+{
+    GENERATE_RHI_OBJECT_BODY()
+
+    std::vector<RHIASInstanceData> m_instances;
+
+public:
+    NullASInstanceBuffer( NullRHI* rhi, const RHI::ASInstanceBufferInfo& info );
+
+    virtual ~NullASInstanceBuffer() override;
+
+    virtual void UpdateBuffer( const RHIASInstanceData* data, size_t num_instances ) override;
+    virtual void UpdateBufferRange( const RHIASInstanceData* data, size_t first_instance, size_t num_instances ) override;
+    virtual size_t GetCapacity() const override { return m_instances.size(); }
+
+    size_t GetNumInstances() const { return m_instances.size(); }
+};
+IMPLEMENT_RHI_INTERFACE( RHIASInstanceBuffer, NullASInstanceBuffer )
+
+class NullAccelerationStructure : public RHIAccelerationStructure
+{
+    GENERATE_RHI_OBJECT_BODY()
+
+    NullBufferPtr m_underlying_buffer = nullptr;
+
+    RHIAccelerationStructureType m_type = RHIAccelerationStructureType::BLAS;
+
+    // state of the last recorded build, to validate updates. Build commands only get const pointers to the structure
+    mutable RHIASBuildFlags m_build_flags = RHIASBuildFlags::None;
+    mutable size_t m_num_primitives = 0;
+    mutable bool m_built = false;
+
+public:
+    NullAccelerationStructure( NullRHI* rhi, const RHI::ASInfo& info );
+
+    virtual ~NullAccelerationStructure() override;
+
+    virtual size_t GetSize() const override { return m_underlying_buffer->GetSize(); }
+
+    RHIAccelerationStructureType GetType() const { return m_type; }
+
+    void OnBuildRecorded( RHIASBuildFlags flags, size_t num_primitives ) const { m_build_flags = flags; m_num_primitives = num_primitives; m_built = true; }
+    bool CanBeUpdated( RHIASBuildFlags flags, size_t num_primitives ) const
+    {
+        return m_built && m_build_flags == flags && m_num_primitives == num_primitives
+            && ( flags & RHIASBuildFlags::AllowUpdate ) != RHIASBuildFlags::None;
+    }
+
+    bool CanBeCompacted() const { return m_built && ( m_build_flags & RHIASBuildFlags::AllowCompaction ) != RHIASBuildFlags::None; }
+    // GetASBuildSize is conservative, compaction drops about half of it, close to what drivers report for static geometry
+    size_t GetCompactedSize() const { return std::min<size_t>( GetSize(), 256 + m_num_primitives * 32 ); }
+    void OnCompactionRecorded( const NullAccelerationStructure& src ) const { OnBuildRecorded( src.m_build_flags, src.m_num_primitives ); }
+};
+IMPLEMENT_RHI_INTERFACE( RHIAccelerationStructure, NullAccelerationStructure )
+
+class NullTexture : public RHITexture
+{
+    GENERATE_RHI_OBJECT_BODY()
+
+    RHI::TextureInfo m_info = {};
+
+    RHITextureRWViewPtr m_base_rw_view = nullptr;
+
+    NullMemoryHeapPtr m_heap = nullptr;
+    uint64_t m_heap_offset = 0;
+
+public:
+    NullTexture( NullRHI* rhi, const RHI::TextureInfo& info );
+    NullTexture( NullRHI* rhi, const RHI::TextureInfo& info, NullMemoryHeap& heap, uint64_t offset );
+
+    virtual ~NullTexture() override;
+
+    virtual glm::uvec3 GetExtent() const override { return glm::uvec3( m_info.width, m_info.height, m_info.depth ); }
+    virtual RHIFormat GetFormat() const override { return m_info.format; }
+
+    virtual RHITextureRWView* GetBaseRWView() const override { return m_base_rw_view.get(); }
+
+    const RHI::TextureInfo& GetInfo() const { return m_info; }
+
+    const NullMemoryHeap* GetHeap() const { return m_heap.get(); }
+    uint64_t GetHeapOffset() const { return m_heap_offset; }
+
+    static RHIMemoryRequirements GetMemoryRequirements( const RHI::TextureInfo& info );
+
+private:
+    void CreateBaseView();
+};
+IMPLEMENT_RHI_INTERFACE( RHITexture, NullTexture )
+using NullTexturePtr = RHIObjectPtr<NullTexture>;
+
+class NullSampler : public RHISampler
+{
+    GENERATE_RHI_OBJECT_BODY()
+
+    RHI::SamplerInfo m_info = {};
+
+public:
+    NullSampler( NullRHI* rhi, const RHI::SamplerInfo& info );
+
+    virtual ~NullSampler() override;
+};
+IMPLEMENT_RHI_INTERFACE( RHISampler, NullSampler )
+
+// Views
+
+class NullCBV : public RHIUniformBufferView
+{
+    GENERATE_RHI_OBJECT_BODY()
+
+    NullBufferPtr m_buffer = nullptr;
+    RHIBufferViewInfo m_view_info = {};
+
+public:
+    NullCBV( NullRHI* rhi, const RHIBufferViewInfo& info );
+
+    virtual ~NullCBV() override;
+
+    const RHIBufferViewInfo& GetViewInfo() const { return m_view_info; }
+};
+IMPLEMENT_RHI_INTERFACE( RHIUniformBufferView, NullCBV )
+
+class NullTextureROView : public RHITextureROView
+{
+    GENERATE_RHI_OBJECT_BODY()
+
+    NullTexturePtr m_texture = nullptr;
+
+public:
+    NullTextureROView( NullRHI* rhi, const RHI::TextureROViewInfo& info );
+
+    virtual ~NullTextureROView() override;
+
+    const NullTexture* GetTexture() const { return m_texture.get(); }
+};
+IMPLEMENT_RHI_INTERFACE( RHITextureROView, NullTextureROView )
+
+class NullTextureRWView : public RHITextureRWView
+{
+    GENERATE_RHI_OBJECT_BODY()
+
+    // the texture's own base view does not hold a reference to avoid circular dependency
+    NullTexturePtr m_texture_ref = nullptr;
+    const NullTexture* m_texture = nullptr;
+
+    RHIFormat m_format = RHIFormat::Undefined;
+
+public:
+    NullTextureRWView( NullRHI* rhi, bool make_hard_texture_ref, const RHI::TextureRWViewInfo& info );
+
+    virtual ~NullTextureRWView() override;
+
+    virtual glm::uvec3 GetSize() const override { return m_texture->GetExtent(); }
+
+    const NullTexture* GetTexture() const { return m_texture; }
+};
+IMPLEMENT_RHI_INTERFACE( RHITextureRWView, NullTextureRWView )
+
+class NullRTV : public RHIRenderTargetView
+{
+    GENERATE_RHI_OBJECT_BODY()
+
+    NullTexturePtr m_texture = nullptr;
+    RHIFormat m_format = RHIFormat::Undefined;
+
+public:
+    NullRTV( NullRHI* rhi, const RHI::RenderTargetViewInfo& info );
+
+    virtual ~NullRTV() override;
+
+    virtual glm::uvec3 GetSize() const override { return m_texture->GetExtent(); }
+    virtual RHIFormat GetFormat() const override { return m_format; }
+
+    const NullTexture* GetTexture() const { return m_texture.get(); }
+};
+IMPLEMENT_RHI_INTERFACE( RHIRenderTargetView, NullRTV )
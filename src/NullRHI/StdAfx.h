@@ -0,0 +1,13 @@
+#pragma once
+
+#include <Core/RHICommon.h>
+
+SE_LOG_CATEGORY( NullRHI );
+
+#include <thread>
+
+// use this macro to define RHIObject body
+#define GENERATE_RHI_OBJECT_BODY() \
+protected: \
+    class NullRHI* m_rhi = nullptr; \
+    GENERATE_RHI_OBJECT_BODY_NO_RHI()
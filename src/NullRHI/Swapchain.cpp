@@ -0,0 +1,71 @@
+#include "StdAfx.h"
+
+#include "Swapchain.h"
+
+#include "NullRHIImpl.h"
+
+IMPLEMENT_RHI_OBJECT( NullSwapChain )
+
+NullSwapChain::NullSwapChain( NullRHI* rhi, const RHISwapChainCreateInfo& create_info, glm::uvec2 extent )
+    : m_rhi( rhi ), m_extent( extent ), m_surface_num( create_info.surface_num )
+{
+    Init();
+}
+
+NullSwapChain::~NullSwapChain()
+{
+}
+
+void NullSwapChain::Init()
+{
+    VERIFY_NOT_EQUAL( m_surface_num, 0 );
+
+    SE_LOG_INFO( NullRHI, "Swap chain creation:" );
+    SE_LOG_INFO( NullRHI, "\twidth = %u\theight = %u", m_extent.x, m_extent.y );
+    SE_LOG_INFO( NullRHI, "\tNum images = %u", m_surface_num );
+
+    RHI::TextureInfo tex_info = {};
+    tex_info.dimensions = RHITextureDimensions::T2D;
+    tex_info.depth = 1;
+    tex_info.width = m_extent.x;
+    tex_info.height = m_extent.y;
+    tex_info.mips = 1;
+    tex_info.format = GetFormat();
+    tex_info.array_layers = 0;
+    tex_info.usage = RHITextureUsageFlags::RenderTargetView | RHITextureUsageFlags::TransferDst;
+
+    // swapchain images are not counted as API calls, same as on the real backends
+    m_images.clear();
+    m_image_views.clear();
+    for ( uint32_t i = 0; i < m_surface_num; ++i )
+    {
+        NullTexture* image = new NullTexture( m_rhi, tex_info );
+        m_images.emplace_back( image );
+
+        RHI::RenderTargetViewInfo rtv_info = {};
+        rtv_info.texture = image;
+        rtv_info.format = tex_info.format;
+        m_image_views.emplace_back( new NullRTV( m_rhi, rtv_info ) );
+    }
+
+    m_cur_image_index = 0;
+}
+
+void NullSwapChain::AcquireNextImage( RHISemaphore* semaphore_to_signal, bool& out_recreated )
+{
+    m_rhi->CountCall( NullRHICall::AcquireNextImage );
+
+    out_recreated = false;
+    m_cur_image_index = ( m_cur_image_index + 1 ) % m_surface_num;
+
+    // images are always available right away
+    if ( semaphore_to_signal != nullptr )
+        RHIImpl( semaphore_to_signal )->Signal( NullRHI::Clock::now() );
+}
+
+void NullSwapChain::Recreate()
+{
+    m_rhi->WaitIdle();
+
+    Init();
+}
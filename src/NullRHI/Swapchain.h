@@ -0,0 +1,39 @@
+#pragma once
+
+#include "StdAfx.h"
+
+#include <RHI/RHI.h>
+
+#include "Resources.h"
+
+class NullSwapChain : public RHISwapChain
+{
+    GENERATE_RHI_OBJECT_BODY()
+
+private:
+    std::vector<NullTexturePtr> m_images;
+    std::vector<RHIObjectPtr<NullRTV>> m_image_views;
+
+    glm::uvec2 m_extent = glm::uvec2( 0, 0 );
+    uint32_t m_surface_num = 0;
+
+    uint32_t m_cur_image_index = 0;
+
+public:
+    NullSwapChain( class NullRHI* rhi, const RHISwapChainCreateInfo& create_info, glm::uvec2 extent );
+
+    virtual ~NullSwapChain() override;
+
+    virtual glm::uvec2 GetExtent() const override { return m_extent; }
+    virtual void AcquireNextImage( class RHISemaphore* semaphore_to_signal, bool& out_recreated ) override;
+    virtual void Recreate() override;
+    virtual RHIFormat GetFormat() const override { return RHIFormat::B8G8R8A8_SRGB; }
+    virtual RHITexture* GetTexture() override { return m_images[m_cur_image_index].get(); }
+
+    virtual RHIRenderTargetView* GetRTV() override { return m_image_views[m_cur_image_index].get(); }
+
+    uint32_t GetCurrentImageIndex() const { return m_cur_image_index; }
+
+private:
+    void Init();
+};
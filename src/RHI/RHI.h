@@ -24,6 +24,7 @@ class RHITextureROView;
 class RHITextureRWView;
 class RHIRenderTargetView;
 class RHISampler;
+class RHIMemoryHeap;
 struct RHIASGeometryInfo;
 struct RHIASInstanceData;
 struct RHIGraphicsPipelineInfo;
@@ -119,7 +120,16 @@ enum class RHIFormat : uint8_t
     R16_UINT,
 
     // Beware that some implementation don't support this format. @todo - query format support form rhi if really needed
-    RGB8_SRGB
+    RGB8_SRGB,
+
+    // Block compressed, every 4x4 texel block is stored in 8 (BC1, BC4) or 16 bytes. Produced by the texture cooker
+    BC1_UNORM,
+    BC1_SRGB,
+    BC4_UNORM,
+    BC5_UNORM,
+    BC6H_UFLOAT,
+    BC7_UNORM,
+    BC7_SRGB
 };
 
 enum class RHIShaderBindingType : uint8_t
@@ -162,10 +172,33 @@ enum class RHIAccelerationStructureType : uint8_t
     TLAS
 };
 
+enum class RHIASBuildFlags : uint32_t
+{
+    None = 0,
+    AllowUpdate = 0x1, // the structure may later be refit with RHIASBuildMode::Update. Costs some memory and trace performance
+    AllowCompaction = 0x2, // the structure may be copied into a smaller one with RHICommandList::CompactAS once it is built
+
+    NumFlags = 2
+};
+IMPLEMENT_SCOPED_ENUM_FLAGS( RHIASBuildFlags )
+
+enum class RHIASBuildMode : uint8_t
+{
+    Build = 0,
+    Update // refit, keeps the hierarchy of src and only recomputes bounds. Much faster to build, but trace performance degrades with every refit
+};
+
 struct RHIASBuildSizes
 {
     size_t as_size = 0;
     size_t scratch_size = 0;
+    size_t update_scratch_size = 0; // only valid for RHIASBuildFlags::AllowUpdate
+};
+
+struct RHIMemoryRequirements
+{
+    uint64_t size = 0;
+    uint64_t alignment = 1;
 };
 
 struct RHIBufferViewInfo
@@ -202,12 +235,18 @@ public:
     enum class QueueType : uint8_t
     {
         Graphics = 0,
+        Compute,
+        Copy,
         Count
     };
 
+    // Graphics queue is always supported and can execute any command
+    virtual bool IsQueueSupported( QueueType type ) const { return type == QueueType::Graphics; }
+
+    // Thread-safe. Different command lists may be recorded on different threads at the same time, one list must only be used by one thread
     virtual RHICommandList* GetCommandList( QueueType type ) { NOTIMPL; return nullptr; }
 
-    // command lists here must belong to the same QueueType
+    // Thread-safe. Command lists here must belong to the same QueueType
     struct SubmitInfo
     {
         size_t cmd_list_count = 0;
@@ -215,11 +254,14 @@ public:
         size_t wait_semaphore_count = 0;
         class RHISemaphore* const* semaphores_to_wait = nullptr;
         const RHIPipelineStageFlags* stages_to_wait = nullptr;
-        class RHISemaphore* semaphore_to_signal = nullptr; // optional
+        size_t signal_semaphore_count = 0;
+        class RHISemaphore* const* semaphores_to_signal = nullptr;
     };
     virtual RHIFence SubmitCommandLists( const SubmitInfo& info ) { NOTIMPL; }
 
     virtual void WaitForFenceCompletion( const RHIFence& fence ) { NOTIMPL; }
+    // Doesn't block, for callers that have other work to do meanwhile
+    virtual bool IsFenceCompleted( const RHIFence& fence ) { NOTIMPL; return false; }
 
     enum class ShaderFrequency : uint8_t
     {
@@ -264,6 +306,12 @@ public:
 
     virtual RHIDescriptorSet* CreateDescriptorSet( RHIDescriptorSetLayout& layout ) { NOTIMPL; return nullptr; }
 
+    // The unbound range of the layout (negative count) must be the last one, the set gets bindless_count descriptors in it.
+    // The size is fixed at allocation, a set that needs more has to be recreated
+    virtual RHIDescriptorSet* CreateBindlessDescriptorSet( RHIDescriptorSetLayout& layout, uint32_t bindless_count ) { NOTIMPL; return nullptr; }
+    // Upper bound for bindless_count of a range of this type
+    virtual uint32_t GetMaxBindlessDescriptors( RHIShaderBindingType type ) const { NOTIMPL; return 0; }
+
     struct ShaderBindingLayoutInfo
     {
         RHIDescriptorSetLayout* const* tables = nullptr;
@@ -355,7 +403,25 @@ public:
     };
     virtual RHIAccelerationStructure* CreateAS( const ASInfo& info ) { NOTIMPL; return nullptr; }
 
-    virtual bool GetASBuildSize( RHIAccelerationStructureType type, const RHIASGeometryInfo* geom_infos, size_t num_geoms, RHIASBuildSizes& out_sizes ) { NOTIMPL; return false; }
+    virtual bool GetASBuildSize( RHIAccelerationStructureType type, const RHIASGeometryInfo* geom_infos, size_t num_geoms, RHIASBuildFlags flags, RHIASBuildSizes& out_sizes ) { NOTIMPL; return false; }
+
+    // Placed resources live at a given offset inside a memory heap. Resources with non-overlapping lifetimes may be placed at overlapping
+    // ranges of the same heap (aliasing). Contents of an aliased resource are undefined on its first use, so textures must be transitioned from RHITextureLayout::Undefined
+    virtual bool SupportsPlacedResources() const { return false; }
+
+    struct MemoryHeapInfo
+    {
+        uint64_t size = 0;
+        const char* name = nullptr;
+    };
+    virtual RHIMemoryHeap* CreateMemoryHeap( const MemoryHeapInfo& info ) { NOTIMPL; return nullptr; }
+
+    virtual RHIMemoryRequirements GetTextureMemoryRequirements( const TextureInfo& info ) const { NOTIMPL; return {}; }
+    virtual RHIMemoryRequirements GetBufferMemoryRequirements( const BufferInfo& info ) const { NOTIMPL; return {}; }
+
+    // offset must be aligned as returned by Get*MemoryRequirements
+    virtual RHITexture* CreatePlacedTexture( const TextureInfo& info, RHIMemoryHeap& heap, uint64_t offset ) { NOTIMPL; return nullptr; }
+    virtual RHIBuffer* CreatePlacedBuffer( const BufferInfo& info, RHIMemoryHeap& heap, uint64_t offset ) { NOTIMPL; return nullptr; }
 
     // Causes a full pipeline flush
     virtual bool ReloadAllShaders() { NOTIMPL; return false; }
@@ -440,6 +506,11 @@ struct RHITextureBarrier
     RHITextureSubresourceRange subresources;
     RHITextureLayout layout_src = RHITextureLayout::Undefined;
     RHITextureLayout layout_dst = RHITextureLayout::Undefined;
+
+    // Queue ownership transfer. Recorded twice with the same layouts: as a release on queue_src and as an acquire on queue_dst.
+    // Both are QueueType::Count for barriers that don't transfer ownership
+    RHI::QueueType queue_src = RHI::QueueType::Count;
+    RHI::QueueType queue_dst = RHI::QueueType::Count;
 };
 
 struct RHIBufferTextureCopyRegion
@@ -553,6 +624,12 @@ struct RHIASBuildInfo
     const RHIAccelerationStructure* dst = nullptr;
     const RHIASGeometryInfo** geoms = nullptr;
     size_t geoms_count = 0;
+
+    RHIASBuildMode mode = RHIASBuildMode::Build;
+    RHIASBuildFlags flags = RHIASBuildFlags::None; // must be the same for a build and all subsequent updates of the structure
+
+    // Update mode only, may be the same as dst. Must have been built with RHIASBuildFlags::AllowUpdate and the same number of primitives
+    const RHIAccelerationStructure* src = nullptr;
 };
 
 class RHICommandList
@@ -609,6 +686,7 @@ public:
 
     virtual void TextureBarriers( const RHITextureBarrier* barriers, size_t barrier_count ) { NOTIMPL; }
 
+    // Makes all earlier writes on the queue visible to all later commands.
     // GPU suffix is needed because MemoryBarrier is sadly a macro in winrt
     // @todo - do proper buffer barriers
     virtual void MemoryBarrierGPU() { NOTIMPL; }
@@ -634,6 +712,12 @@ public:
     virtual void PushConstants( size_t offset, const void* data, size_t size ) { NOTIMPL; }
 
     virtual void BuildAS( const RHIASBuildInfo& info ) { NOTIMPL; }
+
+    // Writes the size every structure would have after compaction, as uint64_t each, to dst starting at dst_offset.
+    // The structures must have been built with RHIASBuildFlags::AllowCompaction, and the builds made visible with MemoryBarrierGPU
+    virtual void WriteCompactedASSizes( const RHIAccelerationStructure* const* structures, size_t count, RHIBuffer& dst, size_t dst_offset ) { NOTIMPL; }
+    // dst must be at least as large as the compacted size of src. The copy keeps the build flags of src, so it can be updated if src could
+    virtual void CompactAS( const RHIAccelerationStructure& src, const RHIAccelerationStructure& dst ) { NOTIMPL; }
 };
 
 class RHIShader : public RHIObject
@@ -828,7 +912,13 @@ class RHIASInstanceBuffer : public RHIObject
 public:
     virtual ~RHIASInstanceBuffer() override {}
 
+    // Grows the buffer if needed, previous contents are lost in that case
     virtual void UpdateBuffer( const RHIASInstanceData* data, size_t num_instances ) { NOTIMPL; }
+
+    // Writes data[0..num_instances) to instances starting from first_instance, the rest of the buffer is kept intact. The range must fit into GetCapacity()
+    virtual void UpdateBufferRange( const RHIASInstanceData* data, size_t first_instance, size_t num_instances ) { NOTIMPL; }
+
+    virtual size_t GetCapacity() const { NOTIMPL; return 0; }
 };
 using RHIASInstanceBufferPtr = RHIObjectPtr<RHIASInstanceBuffer>;
 
@@ -892,6 +982,15 @@ public:
 };
 using RHIAccelerationStructurePtr = RHIObjectPtr<RHIAccelerationStructure>;
 
+class RHIMemoryHeap : public RHIObject
+{
+public:
+    virtual ~RHIMemoryHeap() override {}
+
+    virtual uint64_t GetSize() const { NOTIMPL; return 0; }
+};
+using RHIMemoryHeapPtr = RHIObjectPtr<RHIMemoryHeap>;
+
 template<typename T>
 using UniquePtrWithDeleter = std::unique_ptr<T, void( * )( T* )>;
 
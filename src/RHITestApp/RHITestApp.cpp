@@ -569,7 +569,9 @@ void RHITestApp::DrawFrame()
     RHISemaphore* wait_semaphores[] = { m_image_available_semaphores[m_current_frame].get() };
     submit_info.semaphores_to_wait = wait_semaphores;
     submit_info.wait_semaphore_count = 1;
-    submit_info.semaphore_to_signal = m_render_finished_semaphores[m_current_frame].get();
+    RHISemaphore* signal_semaphores[] = { m_render_finished_semaphores[m_current_frame].get() };
+    submit_info.semaphores_to_signal = signal_semaphores;
+    submit_info.signal_semaphore_count = 1;
     RHIPipelineStageFlags stages_to_wait[] = { RHIPipelineStageFlags::ColorAttachmentOutput };
     submit_info.stages_to_wait = stages_to_wait;
 
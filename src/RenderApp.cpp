@@ -564,24 +564,17 @@ World::Entity RenderApp::CastRayToWorld( DirectX::XMVECTOR origin, DirectX::XMVE
         if ( !mesh )
             continue;
 
-        const auto& vertices = mesh->Vertices();
-        const auto& indices = mesh->Indices();
-
-        for ( size_t i = 0; i < indices.size(); i += 3 )
+        // local direction is not normalized, so the distance is comparable between meshes
+        BVHRay ray;
+        XMStoreFloat3( reinterpret_cast<XMFLOAT3*>( ray.origin ), camera_pos_local );
+        XMStoreFloat3( reinterpret_cast<XMFLOAT3*>( ray.direction ), camera_dir_local );
+        ray.t_max = closest_dist;
+
+        BVHHit hit;
+        if ( mesh->CPUBVH().IntersectClosest( ray, hit ) )
         {
-            auto intersection_res = IntersectRayTriangle(
-                &vertices[indices[i]].pos.x, &vertices[indices[i + 1]].pos.x, &vertices[indices[i + 2]].pos.x,
-                camera_pos_local.m128_f32, camera_dir_local.m128_f32 );
-
-            if ( intersection_res.HitDetected( std::sqrt( FLT_EPSILON ), FLT_EPSILON, FLT_EPSILON ) )
-            {
-                const float distance = intersection_res.coords.m128_f32[2];
-                if ( closest_dist > distance )
-                {
-                    closest_dist = distance;
-                    closest_entity = id;
-                }
-            }
+            closest_dist = hit.t;
+            closest_entity = id;
         }
     }
 
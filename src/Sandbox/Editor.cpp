@@ -129,6 +129,20 @@ bool LevelEditor::OpenLevel( const char* filepath )
 
     m_level_objects.clear();
 
+    // every asset of the level is requested first, so they are loaded in parallel while objects are deserialized one by one
+    std::vector<std::string> asset_paths;
+    for ( auto& v : object_property->value.GetArray() )
+    {
+        LevelObject::GetAssetPaths( v, asset_paths );
+    }
+
+    std::vector<AssetLoadHandle> asset_loads;
+    asset_loads.reserve( asset_paths.size() );
+    for ( const std::string& path : asset_paths )
+    {
+        asset_loads.emplace_back( GetAssetManager().LoadAsync( AssetId( path.c_str() ) ) );
+    }
+
     for ( auto& v : object_property->value.GetArray() )
     {
         auto& new_object = m_level_objects.emplace_back( std::make_unique<LevelObject>( m_world.get() ) );
@@ -326,8 +340,6 @@ bool LevelEditor::Draw( Rendergraph& framegraph, ISceneRenderExtension* required
 
 void LevelEditor::UpdateReadback( const ViewFrameReadbackData& readback_data )
 {
-    m_mouse_hover_picking_id = readback_data.picking_id_under_cursor;
-
     if ( ImGui::IsKeyDown( ImGuiKey_P ) ) {
         SE_LOG_INFO( Sandbox, "fresnel %.3f, lambert %.3f, ggx %.3f, bsdf %.3f, throughput %.3f, radiance %.3f",
             readback_data.fresnel,
@@ -360,14 +372,10 @@ void LevelEditor::UpdateScene()
 {
     // this should be somewhere in the engine code
 
-    // @todo - run only for dirty transforms
+    // @todo - run only for dirty transforms. Scene ignores unchanged ones, but the loop still touches every entity
     for ( const auto& [entity_id, tf, mesh_instance_component] : m_world->CreateView<TransformComponent, MeshInstanceComponent>() )
     {
-        SceneMeshInstance* smi = m_scene->GetMeshInstance( mesh_instance_component.scene_mesh_instance );
-        if ( !SE_ENSURE( smi ) )
-            continue;
-
-        smi->m_tf = tf.tf;
+        m_scene->SetMeshInstanceTransform( mesh_instance_component.scene_mesh_instance, tf.tf );
     }
 
     uint32_t num_cubemaps = 0;
@@ -382,11 +390,7 @@ void LevelEditor::UpdateScene()
 
     for ( const auto& [entity_id, mesh_instance_component, picking_component] : m_world->CreateView<MeshInstanceComponent, EditorPickingComponent>() )
     {
-        SceneMeshInstance* smi = m_scene->GetMeshInstance( mesh_instance_component.scene_mesh_instance );
-        if ( !SE_ENSURE( smi ) )
-            continue;
-
-        smi->picking_id = picking_component.picking_id;
+        m_scene->SetMeshInstancePickingID( mesh_instance_component.scene_mesh_instance, picking_component.picking_id );
     }
 
     ImVec2 imgui_mouse_pos = ImGui::GetMousePos();
@@ -399,19 +403,25 @@ bool LevelEditor::HandleMousePicking()
     if ( !ImGui::IsMouseClicked( ImGuiMouseButton_Left ) )
         return false;
 
-    if ( m_mouse_hover_picking_id < 0 )
-    {
-        m_selected_object = -1;
+    m_selected_object = -1;
+
+    const glm::uvec2 cursor_pos = m_scene_view->GetCursorPosition();
+    const glm::uvec2 extent = m_scene_view->GetExtent();
+    if ( cursor_pos.x >= extent.x || cursor_pos.y >= extent.y )
         return true;
-    }
 
-    if ( m_mouse_hover_picking_id >= m_level_objects.size() )
-    {
-        m_selected_object = -1;
+    // picked on CPU against the last synchronized scene state, no need to wait for the GPU readback
+    SceneRayHit hit;
+    if ( !m_scene->CastRay( m_scene_view->CalcPixelRay( cursor_pos ), hit ) )
         return true;
-    }
 
-    m_selected_object = m_mouse_hover_picking_id;
-    
+    const SceneMeshInstance* mesh_instance = m_scene->GetMeshInstance( hit.instance );
+    if ( mesh_instance == nullptr )
+        return true;
+
+    const int32_t picking_id = mesh_instance->GetPickingID();
+    if ( picking_id >= 0 && picking_id < int32_t( m_level_objects.size() ) )
+        m_selected_object = picking_id;
+
     return true;
 }
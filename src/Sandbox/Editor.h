@@ -34,8 +34,6 @@ private:
 
 	int m_selected_object = -1;
 
-	int m_mouse_hover_picking_id = -1;
-
 	EditorCamera m_editor_camera;
 
 	std::unique_ptr<World> m_world;
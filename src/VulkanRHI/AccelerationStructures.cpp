@@ -54,10 +54,32 @@ void VulkanASInstanceBuffer::UpdateBuffer( const RHIASInstanceData* data, size_t
         Init( required_mem + required_mem / 4 );
     }
 
-    std::vector<VkAccelerationStructureInstanceKHR> vk_cpu_data( num_instances );
+    WriteInstances( data, 0, num_instances );
+}
+
+void VulkanASInstanceBuffer::UpdateBufferRange( const RHIASInstanceData* data, size_t first_instance, size_t num_instances )
+{
+    VERIFY( first_instance + num_instances <= GetCapacity() );
+
+    WriteInstances( data, first_instance, num_instances );
+}
+
+size_t VulkanASInstanceBuffer::GetCapacity() const
+{
+    return m_gpu_buf->GetBuffer()->GetSize() / sizeof( VkAccelerationStructureInstanceKHR );
+}
+
+VkDeviceAddress VulkanASInstanceBuffer::GetVkDeviceAddress() const
+{
+    return RHIImpl( m_gpu_buf->GetBuffer() )->GetDeviceAddress();
+}
+
+void VulkanASInstanceBuffer::WriteInstances( const RHIASInstanceData* data, size_t first_instance, size_t num_instances )
+{
+    m_vk_cpu_data.resize( num_instances );
     for ( size_t i = 0; i < num_instances; ++i )
     {
-        auto& vk_instance_data = vk_cpu_data[i];
+        auto& vk_instance_data = m_vk_cpu_data[i];
         const auto& rhi_instance = data[i];
 
         vk_instance_data = {};
@@ -70,12 +92,7 @@ void VulkanASInstanceBuffer::UpdateBuffer( const RHIASInstanceData* data, size_t
         vk_instance_data.accelerationStructureReference = rhi_blas->GetVkASDeviceAddress();
     }
 
-    m_gpu_buf->WriteBytes( vk_cpu_data.data(), vk_cpu_data.size() * sizeof( vk_cpu_data[0] ), 0 );
-}
-
-VkDeviceAddress VulkanASInstanceBuffer::GetVkDeviceAddress() const
-{
-    return RHIImpl( m_gpu_buf->GetBuffer() )->GetDeviceAddress();
+    m_gpu_buf->WriteBytes( m_vk_cpu_data.data(), CalcRequiredMem( num_instances ), CalcRequiredMem( first_instance ) );
 }
 
 void VulkanASInstanceBuffer::Init( size_t size )
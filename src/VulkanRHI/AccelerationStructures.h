@@ -39,6 +39,7 @@ class VulkanASInstanceBuffer : public RHIASInstanceBuffer
 	GENERATE_RHI_OBJECT_BODY()
 
 	VulkanUploadBufferPtr m_gpu_buf = nullptr;
+	std::vector<VkAccelerationStructureInstanceKHR> m_vk_cpu_data; // conversion scratch
 
 public:
 	VulkanASInstanceBuffer( VulkanRHI* rhi, size_t initial_instances_num );
@@ -46,12 +47,16 @@ public:
 	virtual ~VulkanASInstanceBuffer() override;
 
 	virtual void UpdateBuffer( const RHIASInstanceData* data, size_t num_instances ) override;
+	virtual void UpdateBufferRange( const RHIASInstanceData* data, size_t first_instance, size_t num_instances ) override;
+	virtual size_t GetCapacity() const override;
 
 	VkDeviceAddress GetVkDeviceAddress() const;
 
 private:
 	static size_t CalcRequiredMem( size_t num_instances ) { return num_instances * sizeof( VkAccelerationStructureInstanceKHR ); }
 
+	void WriteInstances( const RHIASInstanceData* data, size_t first_instance, size_t num_instances );
+
 	void Init( size_t size );
 };
 IMPLEMENT_RHI_INTERFACE( RHIASInstanceBuffer, VulkanASInstanceBuffer )
\ No newline at end of file
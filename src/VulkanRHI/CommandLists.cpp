@@ -39,6 +39,9 @@ VulkanCommandList::VulkanCommandList( VulkanRHI* rhi, RHI::QueueType type, CmdLi
 
 VulkanCommandList::~VulkanCommandList()
 {
+    for ( VkQueryPool query_pool : m_compacted_size_query_pools )
+        vkDestroyQueryPool( m_rhi->GetDevice(), query_pool, nullptr );
+
     vkFreeCommandBuffers( m_rhi->GetDevice(), m_vk_cmd_pool, 1, &m_vk_cmd_buffer );
 
     vkDestroyCommandPool( m_rhi->GetDevice(), m_vk_cmd_pool, nullptr );
@@ -55,6 +58,8 @@ void VulkanCommandList::Begin()
     begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
     VK_VERIFY( vkBeginCommandBuffer( m_vk_cmd_buffer, &begin_info ) );
+
+    m_used_compacted_size_queries = 0;
 }
 
 void VulkanCommandList::End()
@@ -289,13 +294,14 @@ void VulkanCommandList::TextureBarriers( const RHITextureBarrier* barriers, size
 
 void VulkanCommandList::MemoryBarrierGPU()
 {
+    // Rendergraph only asks for it on real hazards, so it can afford to cover all writes, acceleration structure builds included
     VkMemoryBarrier vk_barrier = {};
     vk_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
-    vk_barrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
-    vk_barrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+    vk_barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+    vk_barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
     vkCmdPipelineBarrier(
         m_vk_cmd_buffer,
-        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT | VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT | VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0,
+        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
         1, &vk_barrier,
         0, nullptr,
         0, nullptr );
@@ -413,7 +419,14 @@ void VulkanCommandList::BuildAS( const RHIASBuildInfo& info )
     vk_geom_build_info = {};
     vk_geom_build_info.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
     vk_geom_build_info.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+    vk_geom_build_info.flags = VulkanRHI::GetVkASBuildFlags( info.flags );
     vk_geom_build_info.dstAccelerationStructure = RHIImpl( info.dst )->GetVkAS();
+    if ( info.mode == RHIASBuildMode::Update )
+    {
+        VERIFY_NOT_EQUAL( info.src, nullptr );
+        vk_geom_build_info.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR;
+        vk_geom_build_info.srcAccelerationStructure = RHIImpl( info.src )->GetVkAS();
+    }
     vk_geom_build_info.scratchData.deviceAddress = RHIImpl( info.scratch )->GetDeviceAddress();
 
     const size_t required_alignment = m_rhi->GetFeatures().as_props.minAccelerationStructureScratchOffsetAlignment;
@@ -427,6 +440,54 @@ void VulkanCommandList::BuildAS( const RHIASBuildInfo& info )
     vkCmdBuildAccelerationStructuresKHR( m_vk_cmd_buffer, 1, &vk_geom_build_info, &range_infos );
 }
 
+void VulkanCommandList::WriteCompactedASSizes( const RHIAccelerationStructure* const* structures, size_t count, RHIBuffer& dst, size_t dst_offset )
+{
+    bc::small_vector<VkAccelerationStructureKHR, 16> vk_structures;
+    vk_structures.reserve( count );
+    for ( size_t i = 0; i < count; ++i )
+        vk_structures.emplace_back( RHIImpl( structures[i] )->GetVkAS() );
+
+    // queries are reset right before they are written, so a list may be recorded again as soon as its previous submission completed
+    size_t written = 0;
+    while ( written < count )
+    {
+        const size_t pool_idx = m_used_compacted_size_queries / m_queries_per_pool;
+        const uint32_t first_query = m_used_compacted_size_queries % m_queries_per_pool;
+        if ( pool_idx == m_compacted_size_query_pools.size() )
+        {
+            VkQueryPoolCreateInfo pool_info = {};
+            pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            pool_info.queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR;
+            pool_info.queryCount = m_queries_per_pool;
+            VK_VERIFY( vkCreateQueryPool( m_rhi->GetDevice(), &pool_info, nullptr, &m_compacted_size_query_pools.emplace_back() ) );
+        }
+        VkQueryPool query_pool = m_compacted_size_query_pools[pool_idx];
+
+        const uint32_t num_queries = uint32_t( std::min<size_t>( count - written, m_queries_per_pool - first_query ) );
+        vkCmdResetQueryPool( m_vk_cmd_buffer, query_pool, first_query, num_queries );
+        vkCmdWriteAccelerationStructuresPropertiesKHR(
+            m_vk_cmd_buffer, num_queries, vk_structures.data() + written,
+            VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR, query_pool, first_query );
+        vkCmdCopyQueryPoolResults(
+            m_vk_cmd_buffer, query_pool, first_query, num_queries,
+            RHIImpl( dst ).GetVkBuffer(), dst_offset + written * sizeof( uint64_t ), sizeof( uint64_t ),
+            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT );
+
+        written += num_queries;
+        m_used_compacted_size_queries += num_queries;
+    }
+}
+
+void VulkanCommandList::CompactAS( const RHIAccelerationStructure& src, const RHIAccelerationStructure& dst )
+{
+    VkCopyAccelerationStructureInfoKHR copy_info = {};
+    copy_info.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR;
+    copy_info.src = RHIImpl( src ).GetVkAS();
+    copy_info.dst = RHIImpl( dst ).GetVkAS();
+    copy_info.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR;
+    vkCmdCopyAccelerationStructureKHR( m_vk_cmd_buffer, &copy_info );
+}
+
 void VulkanCommandList::Reset()
 {
     VK_VERIFY( vkResetCommandBuffer( m_vk_cmd_buffer, 0 ) );
@@ -491,6 +552,12 @@ VulkanCommandListManager::~VulkanCommandListManager()
 }
 
 VulkanCommandList* VulkanCommandListManager::GetCommandList( RHI::QueueType type )
+{
+    std::scoped_lock lock( m_lock );
+    return GetCommandListNoLock( type );
+}
+
+VulkanCommandList* VulkanCommandListManager::GetCommandListNoLock( RHI::QueueType type )
 {
     VERIFY_EQUALS( type < RHI::QueueType::Count, true );
 
@@ -517,8 +584,11 @@ RHIFence VulkanCommandListManager::SubmitCommandLists( const RHI::SubmitInfo& in
 
     const size_t queue_idx = size_t( info.cmd_lists[0]->GetType() );
 
+    // queue submission has to be externally synchronized too
+    std::scoped_lock lock( m_lock );
+
     // Not necessary, but we have to do this somewhere at regular intervals. Why not here?
-    ProcessCompleted();
+    ProcessCompletedNoLock();
 
     VkSubmitInfo submit_info = {};
     submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -528,6 +598,7 @@ RHIFence VulkanCommandListManager::SubmitCommandLists( const RHI::SubmitInfo& in
     boost::container::small_vector<VkCommandBuffer, typical_num_lists> cmd_lists;
     boost::container::small_vector<VkSemaphore, typical_num_lists> semaphores_to_wait;
     boost::container::small_vector<VkPipelineStageFlags, typical_num_lists> stages_to_wait;
+    boost::container::small_vector<VkSemaphore, typical_num_lists> semaphores_to_signal;
 
     const bool has_deferred_layout_transitions = m_deferred_layout_transitions_lists[queue_idx] != nullptr;
 
@@ -559,9 +630,14 @@ RHIFence VulkanCommandListManager::SubmitCommandLists( const RHI::SubmitInfo& in
     submit_info.commandBufferCount = uint32_t( cmd_lists.size() );
     submit_info.pCommandBuffers = cmd_lists.data();
 
-    VkSemaphore semaphore_to_signal = info.semaphore_to_signal ? static_cast< VulkanSemaphore* >( info.semaphore_to_signal )->GetVkSemaphore() : VK_NULL_HANDLE;
-    submit_info.signalSemaphoreCount = info.semaphore_to_signal ? 1 : 0;
-    submit_info.pSignalSemaphores = ( semaphore_to_signal != VK_NULL_HANDLE ) ? &semaphore_to_signal : nullptr;
+    semaphores_to_signal.reserve( info.signal_semaphore_count );
+    for ( size_t i = 0; i < info.signal_semaphore_count; ++i )
+    {
+        semaphores_to_signal.emplace_back( static_cast< VulkanSemaphore* >( info.semaphores_to_signal[i] )->GetVkSemaphore() );
+    }
+
+    submit_info.signalSemaphoreCount = uint32_t( semaphores_to_signal.size() );
+    submit_info.pSignalSemaphores = semaphores_to_signal.data();
 
     auto& submitted_lists = m_submitted_lists[queue_idx].emplace();
     submitted_lists.completion_fence = VK_NULL_HANDLE;
@@ -603,11 +679,20 @@ RHIFence VulkanCommandListManager::SubmitCommandLists( const RHI::SubmitInfo& in
 }
 
 void VulkanCommandListManager::ProcessCompleted()
+{
+    std::scoped_lock lock( m_lock );
+    ProcessCompletedNoLock();
+}
+
+void VulkanCommandListManager::ProcessCompletedNoLock()
 {
     boost::container::small_vector<VkFence, 8> fences_to_reset;
     for ( size_t queue_i = 0; queue_i < m_submitted_lists.size(); ++queue_i )
     {
         auto& submitted_lists = m_submitted_lists[queue_i];
+        if ( submitted_lists.empty() )
+            continue; // also skips queues the device doesn't have
+
         auto& free_lists = m_free_lists[queue_i];
         VulkanQueue* vk_queue = m_rhi->GetQueue( RHI::QueueType( queue_i ) );
         VERIFY_NOT_EQUAL( vk_queue, nullptr );
@@ -641,13 +726,16 @@ void VulkanCommandListManager::ProcessCompleted()
 void VulkanCommandListManager::WaitSubmittedUntilCompletion()
 {
     boost::container::static_vector<VkFence, size_t( RHI::QueueType::Count )> fences_to_wait;
-    for ( size_t queue_i = 0; queue_i < m_submitted_lists.size(); ++queue_i )
     {
-        auto& submitted_lists = m_submitted_lists[queue_i];
+        std::scoped_lock lock( m_lock );
+        for ( size_t queue_i = 0; queue_i < m_submitted_lists.size(); ++queue_i )
+        {
+            auto& submitted_lists = m_submitted_lists[queue_i];
 
-        if ( !submitted_lists.empty() )
-            fences_to_wait.push_back( submitted_lists.back().completion_fence );
+            if ( !submitted_lists.empty() )
+                fences_to_wait.push_back( submitted_lists.back().completion_fence );
 
+        }
     }
     VK_VERIFY( vkWaitForFences( m_rhi->GetDevice(), uint32_t( fences_to_wait.size() ), fences_to_wait.data(), VK_TRUE, std::numeric_limits<uint64_t>::max() ) );
 
@@ -657,11 +745,15 @@ void VulkanCommandListManager::WaitSubmittedUntilCompletion()
 void VulkanCommandListManager::DeferImageLayoutTransition( VkImage image, RHI::QueueType queue_type, VkImageLayout old_layout, VkImageLayout new_layout )
 {
     VERIFY_EQUALS( queue_type < RHI::QueueType::Count, true );
+
+    std::scoped_lock lock( m_lock );
+
     VulkanCommandList*& cmd_list = m_deferred_layout_transitions_lists[size_t( queue_type )];
 
     if ( !cmd_list )
     {
-        cmd_list = RHIImpl( m_rhi->GetCommandList( queue_type ) );
+        cmd_list = GetCommandListNoLock( queue_type );
+        cmd_list->Reset();
         cmd_list->Begin();
     }
 
@@ -9,6 +9,9 @@ class VulkanCommandListManager
 private:
 	class VulkanRHI* m_rhi = nullptr;
 
+	// GetCommandList and SubmitCommandLists may be called from several threads
+	std::mutex m_lock;
+
 	std::array<packed_freelist<std::unique_ptr<class VulkanCommandList>>, size_t(RHI::QueueType::Count)> m_cmd_lists;
 	std::vector<VkFence> m_free_fences;
 
@@ -41,6 +44,9 @@ public:
 
 	void DeferImageLayoutTransition(VkImage image, RHI::QueueType queue, VkImageLayout old_layout, VkImageLayout new_layout);
 
+private:
+	VulkanCommandList* GetCommandListNoLock(RHI::QueueType type);
+	void ProcessCompletedNoLock();
 };
 
 class VulkanCommandList : public RHICommandList
@@ -63,6 +69,11 @@ private:
 	std::vector<uint8_t> m_push_constants;
 	bool m_need_push_constants = false;
 
+	// for WriteCompactedASSizes. Pools are created on demand and reused by the next recordings
+	static constexpr uint32_t m_queries_per_pool = 64;
+	std::vector<VkQueryPool> m_compacted_size_query_pools;
+	uint32_t m_used_compacted_size_queries = 0;
+
 public:
 	VulkanCommandList(VulkanRHI* rhi, RHI::QueueType type, CmdListId list_id);
 	virtual ~VulkanCommandList();
@@ -120,6 +131,9 @@ public:
 
 	virtual void BuildAS( const RHIASBuildInfo& info ) override;
 
+	virtual void WriteCompactedASSizes( const RHIAccelerationStructure* const* structures, size_t count, RHIBuffer& dst, size_t dst_offset ) override;
+	virtual void CompactAS( const RHIAccelerationStructure& src, const RHIAccelerationStructure& dst ) override;
+
 	CmdListId GetListId() const { return m_list_id; }
 
 	VkCommandBuffer GetVkCmdList() const { return m_vk_cmd_buffer; }
@@ -64,6 +64,18 @@ DEFINE_VK_FUNCTION2( VkDeviceAddress, vkGetAccelerationStructureDeviceAddressKHR
     VkDevice, device,
     const VkAccelerationStructureDeviceAddressInfoKHR*, pInfo );
 
+DEFINE_VK_FUNCTION6( void, vkCmdWriteAccelerationStructuresPropertiesKHR,
+    VkCommandBuffer,                             commandBuffer,
+    uint32_t,                                    accelerationStructureCount,
+    const VkAccelerationStructureKHR*, pAccelerationStructures,
+    VkQueryType,                                 queryType,
+    VkQueryPool,                                 queryPool,
+    uint32_t,                                    firstQuery );
+
+DEFINE_VK_FUNCTION2( void, vkCmdCopyAccelerationStructureKHR,
+    VkCommandBuffer,                             commandBuffer,
+    const VkCopyAccelerationStructureInfoKHR*, pInfo );
+
 DEFINE_VK_FUNCTION6( VkResult, vkGetRayTracingShaderGroupHandlesKHR,
     VkDevice,                                    device,
     VkPipeline,                                  pipeline,
@@ -108,6 +120,8 @@ void Extensions::LoadRT( VkDevice device )
     DEVICE_LEVEL_VULKAN_FUNCTION( vkCmdBuildAccelerationStructuresKHR );
     DEVICE_LEVEL_VULKAN_FUNCTION( vkGetAccelerationStructureBuildSizesKHR );
     DEVICE_LEVEL_VULKAN_FUNCTION( vkGetAccelerationStructureDeviceAddressKHR );
+    DEVICE_LEVEL_VULKAN_FUNCTION( vkCmdWriteAccelerationStructuresPropertiesKHR );
+    DEVICE_LEVEL_VULKAN_FUNCTION( vkCmdCopyAccelerationStructureKHR );
     DEVICE_LEVEL_VULKAN_FUNCTION( vkGetRayTracingShaderGroupHandlesKHR );
     DEVICE_LEVEL_VULKAN_FUNCTION( vkCreateRayTracingPipelinesKHR );
     DEVICE_LEVEL_VULKAN_FUNCTION( vkCmdTraceRaysKHR );
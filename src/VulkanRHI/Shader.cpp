@@ -321,16 +321,25 @@ VulkanDescriptorSetLayout::VulkanDescriptorSetLayout(VulkanRHI* rhi, const RHI::
         auto& vk_bind = vk_bindings[i];
         auto& rhi_bind = info.ranges[i];
 
-        if (rhi_bind.count <= 0)
-        {
-            NOTIMPL; // bindless is not supported right now
-        }
-
         vk_bind.binding = uint32_t(i);
-        vk_bind.descriptorCount = uint32_t(rhi_bind.count);
         vk_bind.pImmutableSamplers = nullptr;
         vk_bind.stageFlags = VulkanRHI::GetVkShaderStageFlags(rhi_bind.stages);
         vk_bind.descriptorType = VulkanRHI::GetVkDescriptorType(rhi_bind.type);
+
+        if (rhi_bind.count <= 0)
+        {
+            // variable count, must be the last binding. The actual size is set by CreateBindlessDescriptorSet
+            VERIFY(i + 1 == info.range_count);
+            vk_bind.descriptorCount = m_rhi->GetMaxBindlessDescriptors(rhi_bind.type);
+            m_bindless_type = vk_bind.descriptorType;
+            m_bindless_binding = uint32_t(i);
+            m_max_bindless_count = vk_bind.descriptorCount;
+        }
+        else
+        {
+            vk_bind.descriptorCount = uint32_t(rhi_bind.count);
+            m_fixed_pool_sizes.emplace_back(VkDescriptorPoolSize{ vk_bind.descriptorType, vk_bind.descriptorCount });
+        }
     }
 
     VkDescriptorSetLayoutCreateInfo layout_info = {};
@@ -343,6 +352,8 @@ VulkanDescriptorSetLayout::VulkanDescriptorSetLayout(VulkanRHI* rhi, const RHI::
     {
         flags.emplace_back( VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT );
     }
+    if ( HasBindlessRange() )
+        flags[m_bindless_binding] |= VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT;
     VkDescriptorSetLayoutBindingFlagsCreateInfo binding_info = {};
     binding_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
     binding_info.pBindingFlags = flags.data();
@@ -357,8 +368,10 @@ IMPLEMENT_RHI_OBJECT(VulkanDescriptorSet)
 
 VulkanDescriptorSet::~VulkanDescriptorSet()
 {
-    if (m_vk_desc_set)
-        vkFreeDescriptorSets(m_rhi->GetDevice(), m_rhi->GetVkDescriptorPool(), 1, &m_vk_desc_set);
+    if (m_vk_own_pool)
+        vkDestroyDescriptorPool(m_rhi->GetDevice(), m_vk_own_pool, nullptr); // frees the set as well
+    else if (m_vk_desc_set)
+        m_rhi->FreeVkDescriptorSet(m_vk_desc_set);
 }
 
 VulkanDescriptorSet::VulkanDescriptorSet(VulkanRHI* rhi, RHIDescriptorSetLayout& layout)
@@ -366,11 +379,39 @@ VulkanDescriptorSet::VulkanDescriptorSet(VulkanRHI* rhi, RHIDescriptorSetLayout&
 {
     m_dsl = &RHIImpl(layout);
 
+    m_vk_desc_set = m_rhi->AllocateVkDescriptorSet(m_dsl->GetVkDescriptorSetLayout());
+}
+
+VulkanDescriptorSet::VulkanDescriptorSet(VulkanRHI* rhi, RHIDescriptorSetLayout& layout, uint32_t bindless_count)
+    : m_rhi(rhi)
+{
+    m_dsl = &RHIImpl(layout);
+    VERIFY(m_dsl->HasBindlessRange());
+    VERIFY(bindless_count <= m_dsl->GetMaxBindlessCount());
+
+    bc::small_vector<VkDescriptorPoolSize, 8> pool_sizes = m_dsl->GetFixedPoolSizes();
+    // pool sizes must not be empty
+    pool_sizes.emplace_back(VkDescriptorPoolSize{ m_dsl->GetBindlessType(), std::max(bindless_count, 1u) });
+
+    VkDescriptorPoolCreateInfo pool_info = {};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.poolSizeCount = uint32_t(pool_sizes.size());
+    pool_info.pPoolSizes = pool_sizes.data();
+    pool_info.maxSets = 1;
+
+    VK_VERIFY(vkCreateDescriptorPool(m_rhi->GetDevice(), &pool_info, nullptr, &m_vk_own_pool));
+
+    VkDescriptorSetVariableDescriptorCountAllocateInfo count_info = {};
+    count_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+    count_info.descriptorSetCount = 1;
+    count_info.pDescriptorCounts = &bindless_count;
+
     VkDescriptorSetLayout vk_layout = m_dsl->GetVkDescriptorSetLayout();
 
     VkDescriptorSetAllocateInfo alloc_info = {};
     alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    alloc_info.descriptorPool = m_rhi->GetVkDescriptorPool();
+    alloc_info.pNext = &count_info;
+    alloc_info.descriptorPool = m_vk_own_pool;
     alloc_info.descriptorSetCount = 1;
     alloc_info.pSetLayouts = &vk_layout;
 
@@ -4,6 +4,8 @@
 
 #include <RHI/RHI.h>
 
+#include <deque>
+
 struct ShaderDefine
 {
     std::string name;
@@ -84,12 +86,24 @@ class VulkanDescriptorSetLayout : public RHIDescriptorSetLayout
 
     VkDescriptorSetLayout m_vk_desc_set_layout = VK_NULL_HANDLE;
 
+    // descriptors of the bindings with a fixed count, for sets that get their own pool
+    bc::small_vector<VkDescriptorPoolSize, 8> m_fixed_pool_sizes;
+    // the last binding, if its count is set at allocation
+    VkDescriptorType m_bindless_type = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+    uint32_t m_bindless_binding = 0;
+    uint32_t m_max_bindless_count = 0;
+
 public:
     virtual ~VulkanDescriptorSetLayout() override;
 
     VulkanDescriptorSetLayout(VulkanRHI* rhi, const RHI::DescriptorSetLayoutInfo& info);
 
     VkDescriptorSetLayout GetVkDescriptorSetLayout() const { return m_vk_desc_set_layout; }
+
+    bool HasBindlessRange() const { return m_bindless_type != VK_DESCRIPTOR_TYPE_MAX_ENUM; }
+    VkDescriptorType GetBindlessType() const { return m_bindless_type; }
+    uint32_t GetMaxBindlessCount() const { return m_max_bindless_count; }
+    const auto& GetFixedPoolSizes() const { return m_fixed_pool_sizes; }
 };
 IMPLEMENT_RHI_INTERFACE(RHIDescriptorSetLayout, VulkanDescriptorSetLayout);
 
@@ -119,19 +133,25 @@ class VulkanDescriptorSet : public RHIDescriptorSet
     VkDescriptorSet m_vk_desc_set = VK_NULL_HANDLE;
     RHIObjectPtr<VulkanDescriptorSetLayout> m_dsl = nullptr;
 
+    // bindless sets are too big for the shared pool, each of them gets a pool of its own
+    VkDescriptorPool m_vk_own_pool = VK_NULL_HANDLE;
+
     bc::small_vector<VkWriteDescriptorSet, 4> m_pending_writes;
 
     // we need this to make sure pBufferInfo and such are valid at the time of FlushBinds
     bc::small_vector<RHIObjectPtr<RHIObject>, 4> m_referenced_objects;
 
-    // must be static to avoid reallocations (VkWriteDescriptorSet uses raw pointers to these structures)
+    // must not reallocate (VkWriteDescriptorSet uses raw pointers to these structures). A bindless table may be rewritten
+    // in one flush, so buffer infos go to a deque
     bc::static_vector<VkWriteDescriptorSetAccelerationStructureKHR, 4> m_as_infos;
-    bc::static_vector<VkDescriptorBufferInfo, 16> m_buffer_infos;
+    std::deque<VkDescriptorBufferInfo> m_buffer_infos;
 
 public:
     virtual ~VulkanDescriptorSet() override;
 
     VulkanDescriptorSet(VulkanRHI* rhi, RHIDescriptorSetLayout& layout);
+    // bindless_count descriptors in the last range of the layout
+    VulkanDescriptorSet(VulkanRHI* rhi, RHIDescriptorSetLayout& layout, uint32_t bindless_count);
 
     virtual void BindUniformBufferView( size_t range_idx, size_t idx_in_range, RHIUniformBufferView& view ) override;
     virtual void BindUniformBufferView( size_t range_idx, size_t idx_in_range, const RHIBufferViewInfo& view ) override;
@@ -118,6 +118,11 @@ RHIDescriptorSet* VulkanRHI::CreateDescriptorSet( RHIDescriptorSetLayout& layout
     return new VulkanDescriptorSet( this, layout );
 }
 
+RHIDescriptorSet* VulkanRHI::CreateBindlessDescriptorSet( RHIDescriptorSetLayout& layout, uint32_t bindless_count )
+{
+    return new VulkanDescriptorSet( this, layout, bindless_count );
+}
+
 RHIUniformBufferView* VulkanRHI::CreateUniformBufferView( const RHIBufferViewInfo& info )
 {
     return new VulkanCBV( this, info );
@@ -174,6 +179,27 @@ VkFormat VulkanRHI::GetVkFormat( RHIFormat format )
     case RHIFormat::R16_UINT:
         vk_format = VK_FORMAT_R16_UINT;
         break;
+    case RHIFormat::BC1_UNORM:
+        vk_format = VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        break;
+    case RHIFormat::BC1_SRGB:
+        vk_format = VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+        break;
+    case RHIFormat::BC4_UNORM:
+        vk_format = VK_FORMAT_BC4_UNORM_BLOCK;
+        break;
+    case RHIFormat::BC5_UNORM:
+        vk_format = VK_FORMAT_BC5_UNORM_BLOCK;
+        break;
+    case RHIFormat::BC6H_UFLOAT:
+        vk_format = VK_FORMAT_BC6H_UFLOAT_BLOCK;
+        break;
+    case RHIFormat::BC7_UNORM:
+        vk_format = VK_FORMAT_BC7_UNORM_BLOCK;
+        break;
+    case RHIFormat::BC7_SRGB:
+        vk_format = VK_FORMAT_BC7_SRGB_BLOCK;
+        break;
     default:
         NOTIMPL;
     }
@@ -217,6 +243,27 @@ RHIFormat VulkanRHI::GetRHIFormat( VkFormat format )
     case VK_FORMAT_R16_UINT:
         rhi_format = RHIFormat::R16_UINT;
         break;
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        rhi_format = RHIFormat::BC1_UNORM;
+        break;
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        rhi_format = RHIFormat::BC1_SRGB;
+        break;
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+        rhi_format = RHIFormat::BC4_UNORM;
+        break;
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+        rhi_format = RHIFormat::BC5_UNORM;
+        break;
+    case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+        rhi_format = RHIFormat::BC6H_UFLOAT;
+        break;
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+        rhi_format = RHIFormat::BC7_UNORM;
+        break;
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        rhi_format = RHIFormat::BC7_SRGB;
+        break;
     default:
         NOTIMPL;
     }
@@ -242,6 +289,7 @@ uint32_t VulkanRHI::GetVkFormatSize( RHIFormat format )
     case RHIFormat::B8G8R8A8_SRGB:
     case RHIFormat::R8G8B8A8_SRGB:
     case RHIFormat::R8G8B8A8_UNORM:
+    case RHIFormat::RGB9E5:
         size = 4;
         break;
     case RHIFormat::R32G32_SFLOAT:
@@ -253,6 +301,18 @@ uint32_t VulkanRHI::GetVkFormatSize( RHIFormat format )
     case RHIFormat::RGBA32_SFLOAT:
         size = 16;
         break;
+    // per 4x4 block
+    case RHIFormat::BC1_UNORM:
+    case RHIFormat::BC1_SRGB:
+    case RHIFormat::BC4_UNORM:
+        size = 8;
+        break;
+    case RHIFormat::BC5_UNORM:
+    case RHIFormat::BC6H_UFLOAT:
+    case RHIFormat::BC7_UNORM:
+    case RHIFormat::BC7_SRGB:
+        size = 16;
+        break;
     default:
         NOTIMPL;
     }
@@ -302,11 +362,65 @@ VkDescriptorType VulkanRHI::GetVkDescriptorType( RHIShaderBindingType type )
     return vk_type;
 }
 
+uint32_t VulkanRHI::GetMaxBindlessDescriptors( RHIShaderBindingType type ) const
+{
+    const VkPhysicalDeviceLimits& limits = m_vk_phys_device_props.limits;
+
+    uint32_t max_descriptors = 0;
+    switch ( type )
+    {
+    case RHIShaderBindingType::UniformBuffer:
+        max_descriptors = std::min( limits.maxPerStageDescriptorUniformBuffers, limits.maxDescriptorSetUniformBuffers );
+        break;
+    case RHIShaderBindingType::TextureRO:
+        max_descriptors = std::min( limits.maxPerStageDescriptorSampledImages, limits.maxDescriptorSetSampledImages );
+        break;
+    case RHIShaderBindingType::Sampler:
+        max_descriptors = std::min( limits.maxPerStageDescriptorSamplers, limits.maxDescriptorSetSamplers );
+        break;
+    case RHIShaderBindingType::TextureRW:
+        max_descriptors = std::min( limits.maxPerStageDescriptorStorageImages, limits.maxDescriptorSetStorageImages );
+        break;
+    case RHIShaderBindingType::StructuredBuffer:
+        max_descriptors = std::min( limits.maxPerStageDescriptorStorageBuffers, limits.maxDescriptorSetStorageBuffers );
+        break;
+    default:
+        NOTIMPL;
+    }
+
+    // the limits cover every set of a pipeline layout, leave some for the other bindings of the same type
+    constexpr uint32_t reserved_descriptors = 64;
+    return max_descriptors > reserved_descriptors ? max_descriptors - reserved_descriptors : 0;
+}
+
 void VulkanRHI::DeferredDestroyRHIObject( RHIObject* obj )
 {
+    ScopedSpinLock cs( m_objects_to_delete_lock );
     m_objects_to_delete.emplace_back( obj );
 }
 
+VkDescriptorSet VulkanRHI::AllocateVkDescriptorSet( VkDescriptorSetLayout layout )
+{
+    VkDescriptorSetAllocateInfo alloc_info = {};
+    alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.descriptorPool = m_desc_pool;
+    alloc_info.descriptorSetCount = 1;
+    alloc_info.pSetLayouts = &layout;
+
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    {
+        ScopedSpinLock cs( m_desc_pool_lock );
+        VK_VERIFY( vkAllocateDescriptorSets( m_vk_device, &alloc_info, &set ) );
+    }
+    return set;
+}
+
+void VulkanRHI::FreeVkDescriptorSet( VkDescriptorSet set )
+{
+    ScopedSpinLock cs( m_desc_pool_lock );
+    vkFreeDescriptorSets( m_vk_device, m_desc_pool, 1, &set );
+}
+
 VkBufferUsageFlags VulkanRHI::GetVkBufferUsageFlags( RHIBufferUsageFlags usage )
 {
     VkBufferUsageFlags retval = 0;
@@ -465,6 +579,17 @@ VkAccelerationStructureTypeKHR VulkanRHI::GetVkASType( RHIAccelerationStructureT
     NOTIMPL;
 }
 
+VkBuildAccelerationStructureFlagsKHR VulkanRHI::GetVkASBuildFlags( RHIASBuildFlags flags )
+{
+    VkBuildAccelerationStructureFlagsKHR vk_flags = 0;
+    if ( ( flags & RHIASBuildFlags::AllowUpdate ) != RHIASBuildFlags::None )
+        vk_flags |= VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+    if ( ( flags & RHIASBuildFlags::AllowCompaction ) != RHIASBuildFlags::None )
+        vk_flags |= VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR;
+
+    return vk_flags;
+}
+
 void VulkanRHI::Present( RHISwapChain& swap_chain, const PresentInfo& info )
 {
     boost::container::small_vector<VkSemaphore, 4> semaphores;
@@ -921,6 +1046,9 @@ bool VulkanRHI::IsDeviceSuitable( VkPhysicalDevice device, VkSurfaceKHR surface,
     if ( !features.vk12.descriptorBindingPartiallyBound )
         return false;
 
+    if ( !features.vk12.descriptorBindingVariableDescriptorCount || !features.vk12.runtimeDescriptorArray )
+        return false;
+
     if ( need_raytracing )
     {
         if ( !features.as.accelerationStructure )
@@ -1345,9 +1473,11 @@ void VulkanRHI::CreateDescriptorPool()
     constexpr uint32_t descriptor_count_sampler = 128;
     constexpr uint32_t descriptor_count_as = 128;
     constexpr uint32_t descriptor_count_storage_image = 128;
+    // bindless sets allocate from pools of their own
+    constexpr uint32_t descriptor_count_storage_buffer = 1024;
     constexpr uint32_t descriptor_set_count = 1024;
 
-    std::array<VkDescriptorPoolSize, 5> pool_sizes = {};
+    std::array<VkDescriptorPoolSize, 6> pool_sizes = {};
     pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     pool_sizes[0].descriptorCount = descriptor_count_ub;
     pool_sizes[1].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
@@ -1358,6 +1488,8 @@ void VulkanRHI::CreateDescriptorPool()
     pool_sizes[3].descriptorCount = descriptor_count_as;
     pool_sizes[4].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
     pool_sizes[4].descriptorCount = descriptor_count_storage_image;    
+    pool_sizes[5].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    pool_sizes[5].descriptorCount = descriptor_count_storage_buffer;
 
     VkDescriptorPoolCreateInfo pool_info = {};
     pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -1538,6 +1670,18 @@ void VulkanRHI::WaitForFenceCompletion( const RHIFence& fence )
     VK_VERIFY( vkWaitForFences( m_vk_device, 1, &vk_fence, VK_TRUE, std::numeric_limits<uint64_t>::max() ) );
 }
 
+bool VulkanRHI::IsFenceCompleted( const RHIFence& fence )
+{
+    VulkanQueue* queue = GetQueue( static_cast< QueueType >( fence._3 ) );
+
+    VERIFY_NOT_EQUAL( queue, nullptr );
+
+    // fences of completed submissions are recycled, so only the counter can be trusted
+    m_cmd_list_mgr->ProcessCompleted();
+
+    return queue->completed_counter >= fence._2;
+}
+
 RHIUploadBuffer* VulkanRHI::CreateUploadBuffer( const RHI::BufferInfo& buf_info )
 {
     return new VulkanUploadBuffer( this, buf_info );
@@ -1563,7 +1707,7 @@ RHISampler* VulkanRHI::CreateSampler( const SamplerInfo& info )
     return new VulkanSampler( this, info );
 }
 
-bool VulkanRHI::GetASBuildSize( RHIAccelerationStructureType type, const RHIASGeometryInfo* geom_infos, size_t num_geoms, RHIASBuildSizes& out_sizes )
+bool VulkanRHI::GetASBuildSize( RHIAccelerationStructureType type, const RHIASGeometryInfo* geom_infos, size_t num_geoms, RHIASBuildFlags flags, RHIASBuildSizes& out_sizes )
 {
     constexpr size_t sv_size = 4;
     VkAccelerationStructureBuildGeometryInfoKHR vk_buildgeominfo = {};
@@ -1584,12 +1728,14 @@ bool VulkanRHI::GetASBuildSize( RHIAccelerationStructureType type, const RHIASGe
     vk_buildgeominfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
     vk_buildgeominfo.geometryCount = uint32_t( num_geoms );
     vk_buildgeominfo.type = VulkanRHI::GetVkASType( type );
+    vk_buildgeominfo.flags = VulkanRHI::GetVkASBuildFlags( flags );
     
     vkGetAccelerationStructureBuildSizesKHR(
         m_vk_device, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &vk_buildgeominfo, vk_geom_primitive_counts.data(), &vk_sizes );
 
     out_sizes.as_size = vk_sizes.accelerationStructureSize;
     out_sizes.scratch_size = vk_sizes.buildScratchSize + GetFeatures().as_props.minAccelerationStructureScratchOffsetAlignment;
+    out_sizes.update_scratch_size = vk_sizes.updateScratchSize + GetFeatures().as_props.minAccelerationStructureScratchOffsetAlignment;
 
     return true;
 }
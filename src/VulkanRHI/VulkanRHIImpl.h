@@ -87,10 +87,13 @@ private:
 
 	VkCommandPool m_cmd_pool = VK_NULL_HANDLE;
 
+	// descriptor pools have to be externally synchronized, descriptor sets may be allocated while recording on worker threads
+	SpinLock m_desc_pool_lock;
 	VkDescriptorPool m_desc_pool = VK_NULL_HANDLE;
 
 	std::unique_ptr<class VulkanCommandListManager> m_cmd_list_mgr;
 
+	SpinLock m_objects_to_delete_lock;
 	std::vector<RHIObject*> m_objects_to_delete;
 
 	SpinLock m_loaded_shaders_lock;
@@ -124,6 +127,7 @@ public:
 	virtual RHIFence SubmitCommandLists( const SubmitInfo& info ) override;
 
 	virtual void WaitForFenceCompletion( const RHIFence& fence ) override;
+	virtual bool IsFenceCompleted( const RHIFence& fence ) override;
 
 	virtual RHIShader* CreateShader( const ShaderCreateInfo& create_info ) override;
 
@@ -145,6 +149,8 @@ public:
 	virtual RHISampler* CreateSampler( const SamplerInfo& info ) override;
 
 	virtual RHIDescriptorSet* CreateDescriptorSet( RHIDescriptorSetLayout& layout ) override;
+	virtual RHIDescriptorSet* CreateBindlessDescriptorSet( RHIDescriptorSetLayout& layout, uint32_t bindless_count ) override;
+	virtual uint32_t GetMaxBindlessDescriptors( RHIShaderBindingType type ) const override;
 
 	virtual RHIAccelerationStructure* CreateAS( const RHI::ASInfo& info ) override;
 
@@ -155,7 +161,7 @@ public:
 
 	virtual bool ReloadAllShaders() override;
 
-	virtual bool GetASBuildSize( RHIAccelerationStructureType type, const RHIASGeometryInfo* geom_infos, size_t num_geoms, RHIASBuildSizes& out_sizes ) override;
+	virtual bool GetASBuildSize( RHIAccelerationStructureType type, const RHIASGeometryInfo* geom_infos, size_t num_geoms, RHIASBuildFlags flags, RHIASBuildSizes& out_sizes ) override;
 
 	virtual uint64_t GetUniformBufferMinAlignment() const override { return m_vk_phys_device_props.limits.minUniformBufferOffsetAlignment; }
 
@@ -173,7 +179,9 @@ public:
 
 	const VkPhysicalDeviceProperties& GetPhysDeviceProps() const { return m_vk_phys_device_props; }
 
-	VkDescriptorPool GetVkDescriptorPool() const { return m_desc_pool; }
+	// Thread-safe
+	VkDescriptorSet AllocateVkDescriptorSet( VkDescriptorSetLayout layout );
+	void FreeVkDescriptorSet( VkDescriptorSet set );
 
 	// Should probably be thread-safe
 	// This method places an image layout transition call before any command list is executed on the next submit
@@ -188,7 +196,7 @@ public:
 
 	static VkFormat GetVkFormat( RHIFormat format );
 	static RHIFormat GetRHIFormat( VkFormat format );
-	static uint32_t GetVkFormatSize( RHIFormat format );
+	static uint32_t GetVkFormatSize( RHIFormat format ); // per 4x4 block for block compressed formats
 
 	static VkVertexInputRate GetVkVertexInputRate( RHIPrimitiveFrequency frequency );
 
@@ -214,6 +222,7 @@ public:
 	static VkBlendFactor GetVkBlendFactor( RHIBlendFactor rhi_blend_factor );
 
 	static VkAccelerationStructureTypeKHR GetVkASType( RHIAccelerationStructureType type );
+	static VkBuildAccelerationStructureFlagsKHR GetVkASBuildFlags( RHIASBuildFlags flags );
 
 	static VkIndexType GetVkIndexType( RHIIndexBufferType type );
 	static uint8_t GetVkIndexTypeByteSize( RHIIndexBufferType type );
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <boost/container/flat_map.hpp>
+
+#include "ComponentRegistry.h"
+
+#include "utils/packed_freelist.h"
+#include "utils/TaskScheduler.h"
+
+#include <cstddef>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+
+namespace details
+{
+    template<typename T, typename ... Ts>
+    struct ArchetypeComponentIndex;
+
+    template<typename T, typename ... Ts>
+    struct ArchetypeComponentIndex<T, T, Ts...>
+    {
+        static constexpr uint32_t value = 0;
+    };
+
+    template<typename T, typename U, typename ... Ts>
+    struct ArchetypeComponentIndex<T, U, Ts...>
+    {
+        static constexpr uint32_t value = 1 + ArchetypeComponentIndex<T, Ts...>::value;
+    };
+}
+
+
+// Archetype-based alternative to EntityContainer with the same public API.
+// Entities with the same set of components live together in fixed-size chunks, each chunk stores
+// its components as separate arrays (SoA), so views iterate over contiguous memory instead of merge-joining btrees.
+//
+// Any structural change (Add/RemoveComponent for a component the entity does not have yet or has, DestroyEntity)
+// moves entities between chunks, so it invalidates view iterators and component pointers.
+// Component types must be nothrow movable
+template<typename ... Components>
+class ArchetypeEntityContainer
+{
+    static_assert( sizeof...( Components ) <= 64, "component mask is 64 bit wide" );
+
+    using ComponentMask = uint64_t;
+
+    struct EntityLocation
+    {
+        uint32_t archetype;
+        uint32_t chunk;
+        uint32_t row;
+    };
+
+    using Entity2Location = packed_freelist<EntityLocation>;
+
+public:
+    using Entity = typename Entity2Location::id;
+
+    static constexpr size_t ChunkSize = 16 * 1024;
+
+private:
+    static constexpr uint32_t NumComponents = uint32_t( sizeof...( Components ) );
+    static constexpr uint32_t InvalidArchetype = std::numeric_limits<uint32_t>::max();
+
+    template<typename Component>
+    static constexpr uint32_t ComponentIdx = details::ArchetypeComponentIndex<std::remove_const_t<Component>, Components...>::value;
+
+    template<typename Component>
+    static constexpr ComponentMask ComponentBit = ComponentMask( 1 ) << ComponentIdx<Component>;
+
+    static constexpr ComponentTypeInfo ComponentInfos[] = { MakeComponentTypeInfo<Components>()... };
+
+    struct alignas( 64 ) ChunkStorage
+    {
+        std::byte data[ChunkSize];
+    };
+
+    struct Chunk
+    {
+        std::unique_ptr<ChunkStorage> storage;
+        uint32_t num_entities = 0;
+    };
+
+    struct Archetype
+    {
+        ComponentMask mask = 0;
+        uint32_t chunk_capacity = 0;
+
+        // Entity array always starts at offset 0, component arrays follow it. Offsets are only valid for components in the mask
+        uint32_t component_offsets[NumComponents] = {};
+
+        // cached archetype indices for entities with one component added or removed
+        uint32_t transitions[NumComponents];
+
+        // only the last chunk may be partially filled
+        std::vector<Chunk> chunks;
+
+        Entity* GetEntities( const Chunk& chunk ) const { return reinterpret_cast<Entity*>( chunk.storage->data ); }
+        void* GetComponent( const Chunk& chunk, uint32_t component_idx, uint32_t row ) const
+        {
+            return chunk.storage->data + component_offsets[component_idx] + size_t( row ) * ComponentInfos[component_idx].size;
+        }
+    };
+
+public:
+
+    // Noncopyable, nonmovable
+    ArchetypeEntityContainer();
+    ArchetypeEntityContainer( const ArchetypeEntityContainer& ) = delete;
+    ArchetypeEntityContainer( ArchetypeEntityContainer&& ) = delete;
+    ArchetypeEntityContainer& operator=( const ArchetypeEntityContainer& ) = delete;
+    ArchetypeEntityContainer& operator=( ArchetypeEntityContainer&& ) = delete;
+
+    ~ArchetypeEntityContainer();
+
+    Entity CreateEntity();
+    void DestroyEntity( Entity entity );
+
+    template<typename Component, typename ... Args>
+    Component& AddComponent( Entity entity, Args&&... comp_args ); // replaces the old component if it already exists
+
+    template<typename Component>
+    Component* GetComponent( Entity entity ); // returns nullptr if the component of that type doesn't exist
+
+    template<typename Component>
+    const Component* GetComponent( Entity entity ) const;
+
+    template<typename Component>
+    bool HasComponent( Entity entity ) const;
+
+    template<typename Component>
+    void RemoveComponent( Entity entity );
+
+    uint64_t GetEntityCount() const;
+
+    size_t GetArchetypeCount() const { return m_archetypes.size(); }
+
+    // Views
+    template<typename ...ViewComponents>
+    class View
+    {
+    public:
+        class Iterator
+        {
+        public:
+            std::tuple<Entity, ViewComponents&...> operator*();
+            Iterator& operator++();
+            bool operator!=( const Iterator& rhs ) const;
+
+        private:
+            friend class View;
+            Iterator( const std::vector<Archetype>& archetypes, ComponentMask mask, uint32_t archetype_idx )
+                : m_archetypes( &archetypes ), m_mask( mask ), m_archetype( archetype_idx )
+            {}
+
+            // moves to the first row of the next non-empty chunk of a matching archetype, starting from the current chunk
+            void SkipToValidChunk();
+
+            const std::vector<Archetype>* m_archetypes;
+            ComponentMask m_mask;
+            uint32_t m_archetype = 0;
+            uint32_t m_chunk = 0;
+            uint32_t m_row = 0;
+
+            // arrays of the current chunk
+            uint32_t m_chunk_size = 0;
+            const Entity* m_chunk_entities = nullptr;
+            std::tuple<ViewComponents*...> m_chunk_components;
+        };
+
+        Iterator begin();
+        Iterator end();
+
+    private:
+        friend class ArchetypeEntityContainer;
+        View( const std::vector<Archetype>& archetypes )
+            : m_archetypes( archetypes )
+        {}
+
+        const std::vector<Archetype>& m_archetypes;
+    };
+
+    template<typename ...ViewComponents>
+    View<ViewComponents...> CreateView();
+
+    template<typename ...ViewComponents>
+    View<const ViewComponents...> CreateView() const;
+
+    // Same as EntityContainer::ParallelForEach, tasks are made of whole chunks or chunk parts of up to grain_size entities
+    template<typename ...ViewComponents, typename Fn>
+    void ParallelForEach( View<const ViewComponents...> view, Fn&& fn, size_t grain_size, ITaskScheduler& scheduler ) const;
+
+private:
+
+    uint32_t GetOrCreateArchetype( ComponentMask mask );
+    uint32_t GetTransition( uint32_t archetype_idx, uint32_t component_idx );
+    void CalcChunkLayout( Archetype& archetype ) const;
+
+    EntityLocation AllocateRow( uint32_t archetype_idx );
+
+    // destroys all components in the row and fills the hole with the last row of the archetype
+    void RemoveRow( const EntityLocation& location );
+
+    // moves all shared components to the new archetype, new components are left uninitialized
+    EntityLocation MoveEntity( Entity entity, uint32_t new_archetype_idx );
+
+    Entity2Location m_entities;
+
+    std::vector<Archetype> m_archetypes;
+    boost::container::flat_map<ComponentMask, uint32_t /*archetype_idx*/> m_archetype_lookup;
+};
+
+#include "ArchetypeEntityContainer.hpp"
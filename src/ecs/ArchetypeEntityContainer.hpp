@@ -0,0 +1,433 @@
+#pragma once
+
+#include "ArchetypeEntityContainer.h"
+
+#include <algorithm>
+#include <cassert>
+
+
+template<typename ... Components>
+ArchetypeEntityContainer<Components...>::ArchetypeEntityContainer()
+{
+    // archetype 0 is always the one without any components, new entities go there
+    GetOrCreateArchetype( 0 );
+}
+
+
+template<typename ... Components>
+ArchetypeEntityContainer<Components...>::~ArchetypeEntityContainer()
+{
+    for ( const Archetype& archetype : m_archetypes )
+        for ( const Chunk& chunk : archetype.chunks )
+            for ( uint32_t component_idx = 0; component_idx < NumComponents; ++component_idx )
+                if ( archetype.mask & ( ComponentMask( 1 ) << component_idx ) )
+                    for ( uint32_t row = 0; row < chunk.num_entities; ++row )
+                        ComponentInfos[component_idx].destroy( archetype.GetComponent( chunk, component_idx, row ) );
+}
+
+
+template<typename ... Components>
+typename ArchetypeEntityContainer<Components...>::Entity ArchetypeEntityContainer<Components...>::CreateEntity()
+{
+    Entity entity = m_entities.emplace();
+
+    EntityLocation location = AllocateRow( 0 );
+    const Archetype& archetype = m_archetypes[location.archetype];
+    archetype.GetEntities( archetype.chunks[location.chunk] )[location.row] = entity;
+    m_entities[entity] = location;
+
+    return entity;
+}
+
+
+template<typename ... Components>
+void ArchetypeEntityContainer<Components...>::DestroyEntity( Entity entity )
+{
+    assert( entity != Entity::nullid );
+    assert( m_entities.has( entity ) );
+
+    RemoveRow( m_entities[entity] );
+    m_entities.erase( entity );
+}
+
+
+template<typename ... Components>
+template<typename Component, typename ... Args>
+Component& ArchetypeEntityContainer<Components...>::AddComponent( Entity entity, Args&&... comp_args )
+{
+    assert( entity != Entity::nullid );
+    assert( m_entities.has( entity ) );
+
+    constexpr uint32_t component_idx = ComponentIdx<Component>;
+
+    EntityLocation location = m_entities[entity];
+    if ( m_archetypes[location.archetype].mask & ComponentBit<Component> )
+    {
+        const Archetype& archetype = m_archetypes[location.archetype];
+        Component& component = *static_cast<Component*>( archetype.GetComponent( archetype.chunks[location.chunk], component_idx, location.row ) );
+        component = Component( std::forward<Args>( comp_args )... );
+        return component;
+    }
+
+    // construct the component before the move, args may reference the components of this entity
+    Component new_component( std::forward<Args>( comp_args )... );
+
+    location = MoveEntity( entity, GetTransition( location.archetype, component_idx ) );
+
+    const Archetype& archetype = m_archetypes[location.archetype];
+    void* storage = archetype.GetComponent( archetype.chunks[location.chunk], component_idx, location.row );
+
+    return *new( storage ) Component( std::move( new_component ) );
+}
+
+
+template<typename ... Components>
+template<typename Component>
+Component* ArchetypeEntityContainer<Components...>::GetComponent( Entity entity )
+{
+    assert( entity != Entity::nullid );
+    assert( m_entities.has( entity ) );
+
+    const EntityLocation& location = m_entities[entity];
+    const Archetype& archetype = m_archetypes[location.archetype];
+    if ( ! ( archetype.mask & ComponentBit<Component> ) )
+        return nullptr;
+
+    return static_cast<Component*>( archetype.GetComponent( archetype.chunks[location.chunk], ComponentIdx<Component>, location.row ) );
+}
+
+
+template<typename ... Components>
+template<typename Component>
+const Component* ArchetypeEntityContainer<Components...>::GetComponent( Entity entity ) const
+{
+    assert( entity != Entity::nullid );
+    assert( m_entities.has( entity ) );
+
+    const EntityLocation& location = m_entities[entity];
+    const Archetype& archetype = m_archetypes[location.archetype];
+    if ( ! ( archetype.mask & ComponentBit<Component> ) )
+        return nullptr;
+
+    return static_cast<const Component*>( archetype.GetComponent( archetype.chunks[location.chunk], ComponentIdx<Component>, location.row ) );
+}
+
+
+template<typename ... Components>
+template<typename Component>
+bool ArchetypeEntityContainer<Components...>::HasComponent( Entity entity ) const
+{
+    assert( entity != Entity::nullid );
+    assert( m_entities.has( entity ) );
+
+    return ( m_archetypes[m_entities[entity].archetype].mask & ComponentBit<Component> ) != 0;
+}
+
+
+template<typename ... Components>
+template<typename Component>
+void ArchetypeEntityContainer<Components...>::RemoveComponent( Entity entity )
+{
+    assert( entity != Entity::nullid );
+    assert( m_entities.has( entity ) );
+
+    const EntityLocation& location = m_entities[entity];
+    if ( ! ( m_archetypes[location.archetype].mask & ComponentBit<Component> ) )
+        return;
+
+    MoveEntity( entity, GetTransition( location.archetype, ComponentIdx<Component> ) );
+}
+
+
+template<typename ... Components>
+uint64_t ArchetypeEntityContainer<Components...>::GetEntityCount() const
+{
+    return m_entities.size();
+}
+
+
+template<typename ... Components>
+uint32_t ArchetypeEntityContainer<Components...>::GetOrCreateArchetype( ComponentMask mask )
+{
+    auto it = m_archetype_lookup.find( mask );
+    if ( it != m_archetype_lookup.end() )
+        return it->second;
+
+    uint32_t archetype_idx = uint32_t( m_archetypes.size() );
+    Archetype& archetype = m_archetypes.emplace_back();
+    archetype.mask = mask;
+    for ( uint32_t& transition : archetype.transitions )
+        transition = InvalidArchetype;
+
+    CalcChunkLayout( archetype );
+
+    m_archetype_lookup.emplace( mask, archetype_idx );
+
+    return archetype_idx;
+}
+
+
+template<typename ... Components>
+uint32_t ArchetypeEntityContainer<Components...>::GetTransition( uint32_t archetype_idx, uint32_t component_idx )
+{
+    uint32_t transition = m_archetypes[archetype_idx].transitions[component_idx];
+    if ( transition == InvalidArchetype )
+    {
+        transition = GetOrCreateArchetype( m_archetypes[archetype_idx].mask ^ ( ComponentMask( 1 ) << component_idx ) );
+        m_archetypes[archetype_idx].transitions[component_idx] = transition;
+    }
+    return transition;
+}
+
+
+template<typename ... Components>
+void ArchetypeEntityContainer<Components...>::CalcChunkLayout( Archetype& archetype ) const
+{
+    size_t row_size = sizeof( Entity );
+    for ( uint32_t component_idx = 0; component_idx < NumComponents; ++component_idx )
+        if ( archetype.mask & ( ComponentMask( 1 ) << component_idx ) )
+            row_size += ComponentInfos[component_idx].size;
+
+    // start from the capacity without alignment padding and shrink it until everything fits
+    for ( size_t capacity = ChunkSize / row_size; capacity > 0; --capacity )
+    {
+        size_t offset = sizeof( Entity ) * capacity;
+        for ( uint32_t component_idx = 0; component_idx < NumComponents; ++component_idx )
+        {
+            if ( ! ( archetype.mask & ( ComponentMask( 1 ) << component_idx ) ) )
+                continue;
+
+            const size_t alignment = ComponentInfos[component_idx].alignment;
+            offset = ( offset + alignment - 1 ) / alignment * alignment;
+            archetype.component_offsets[component_idx] = uint32_t( offset );
+            offset += size_t( ComponentInfos[component_idx].size ) * capacity;
+        }
+
+        if ( offset <= ChunkSize )
+        {
+            archetype.chunk_capacity = uint32_t( capacity );
+            return;
+        }
+    }
+
+    assert( false && "a single entity does not fit into a chunk" );
+}
+
+
+template<typename ... Components>
+typename ArchetypeEntityContainer<Components...>::EntityLocation ArchetypeEntityContainer<Components...>::AllocateRow( uint32_t archetype_idx )
+{
+    Archetype& archetype = m_archetypes[archetype_idx];
+    if ( archetype.chunks.empty() || archetype.chunks.back().num_entities == archetype.chunk_capacity )
+    {
+        Chunk& new_chunk = archetype.chunks.emplace_back();
+        new_chunk.storage = std::make_unique<ChunkStorage>();
+    }
+
+    Chunk& chunk = archetype.chunks.back();
+    return EntityLocation{ archetype_idx, uint32_t( archetype.chunks.size() - 1 ), chunk.num_entities++ };
+}
+
+
+template<typename ... Components>
+void ArchetypeEntityContainer<Components...>::RemoveRow( const EntityLocation& location )
+{
+    Archetype& archetype = m_archetypes[location.archetype];
+    Chunk& chunk = archetype.chunks[location.chunk];
+    Chunk& last_chunk = archetype.chunks.back();
+    const uint32_t last_row = last_chunk.num_entities - 1;
+
+    const bool is_last = &chunk == &last_chunk && location.row == last_row;
+
+    for ( uint32_t component_idx = 0; component_idx < NumComponents; ++component_idx )
+    {
+        if ( ! ( archetype.mask & ( ComponentMask( 1 ) << component_idx ) ) )
+            continue;
+
+        void* hole = archetype.GetComponent( chunk, component_idx, location.row );
+        ComponentInfos[component_idx].destroy( hole );
+        if ( ! is_last )
+        {
+            void* last = archetype.GetComponent( last_chunk, component_idx, last_row );
+            ComponentInfos[component_idx].move_construct( hole, last );
+            ComponentInfos[component_idx].destroy( last );
+        }
+    }
+
+    if ( ! is_last )
+    {
+        Entity moved_entity = archetype.GetEntities( last_chunk )[last_row];
+        archetype.GetEntities( chunk )[location.row] = moved_entity;
+        m_entities[moved_entity] = location;
+    }
+
+    if ( --last_chunk.num_entities == 0 )
+        archetype.chunks.pop_back();
+}
+
+
+template<typename ... Components>
+typename ArchetypeEntityContainer<Components...>::EntityLocation ArchetypeEntityContainer<Components...>::MoveEntity( Entity entity, uint32_t new_archetype_idx )
+{
+    const EntityLocation old_location = m_entities[entity];
+    const EntityLocation new_location = AllocateRow( new_archetype_idx );
+
+    const Archetype& old_archetype = m_archetypes[old_location.archetype];
+    const Archetype& new_archetype = m_archetypes[new_location.archetype];
+    const Chunk& old_chunk = old_archetype.chunks[old_location.chunk];
+    const Chunk& new_chunk = new_archetype.chunks[new_location.chunk];
+
+    const ComponentMask shared_mask = old_archetype.mask & new_archetype.mask;
+    for ( uint32_t component_idx = 0; component_idx < NumComponents; ++component_idx )
+        if ( shared_mask & ( ComponentMask( 1 ) << component_idx ) )
+            ComponentInfos[component_idx].move_construct(
+                new_archetype.GetComponent( new_chunk, component_idx, new_location.row ),
+                old_archetype.GetComponent( old_chunk, component_idx, old_location.row ) );
+
+    new_archetype.GetEntities( new_chunk )[new_location.row] = entity;
+
+    // moved-from components are destroyed here along with the ones the entity no longer has
+    RemoveRow( old_location );
+
+    m_entities[entity] = new_location;
+
+    return new_location;
+}
+
+
+// Views
+template<typename ...Components>
+template<typename ...ViewComponents>
+typename ArchetypeEntityContainer<Components...>::View<ViewComponents...>
+    ArchetypeEntityContainer<Components...>::CreateView()
+{
+    View<ViewComponents...> retval( m_archetypes );
+    return retval;
+}
+
+
+template<typename ...Components>
+template<typename ...ViewComponents>
+typename ArchetypeEntityContainer<Components...>::View<const ViewComponents...>
+    ArchetypeEntityContainer<Components...>::CreateView() const
+{
+    View<const ViewComponents...> retval( m_archetypes );
+    return retval;
+}
+
+
+template<typename ...Components>
+template<typename ...ViewComponents, typename Fn>
+void ArchetypeEntityContainer<Components...>::ParallelForEach( View<const ViewComponents...> view, Fn&& fn, size_t grain_size, ITaskScheduler& scheduler ) const
+{
+    struct ChunkRange
+    {
+        const Archetype* archetype;
+        const Chunk* chunk;
+        uint32_t row_begin;
+        uint32_t row_end;
+    };
+
+    grain_size = std::max<size_t>( grain_size, 1 );
+
+    const ComponentMask view_mask = ( ComponentBit<ViewComponents> | ... | ComponentMask( 0 ) );
+    std::vector<ChunkRange> ranges;
+    for ( const Archetype& archetype : view.m_archetypes )
+    {
+        if ( ( archetype.mask & view_mask ) != view_mask )
+            continue;
+
+        for ( const Chunk& chunk : archetype.chunks )
+            for ( size_t row_begin = 0; row_begin < chunk.num_entities; row_begin += grain_size )
+                ranges.push_back( ChunkRange{ &archetype, &chunk, uint32_t( row_begin ), uint32_t( std::min<size_t>( row_begin + grain_size, chunk.num_entities ) ) } );
+    }
+
+    scheduler.ParallelFor( ranges.size(), [&]( size_t range_idx )
+    {
+        const ChunkRange& range = ranges[range_idx];
+        const Entity* entities = range.archetype->GetEntities( *range.chunk );
+        const std::tuple<const ViewComponents*...> components(
+            static_cast<const ViewComponents*>( range.archetype->GetComponent( *range.chunk, ComponentIdx<ViewComponents>, 0 ) )... );
+
+        for ( uint32_t row = range.row_begin; row < range.row_end; ++row )
+            fn( entities[row], std::get<const ViewComponents*>( components )[row]... );
+    } );
+}
+
+
+template<typename ...Components>
+template<typename ...ViewComponents>
+typename ArchetypeEntityContainer<Components...>::View<ViewComponents...>::Iterator
+    ArchetypeEntityContainer<Components...>::View<ViewComponents...>::begin()
+{
+    Iterator retval( m_archetypes, ( ComponentBit<ViewComponents> | ... | ComponentMask( 0 ) ), 0 );
+    retval.SkipToValidChunk();
+    return retval;
+}
+
+
+template<typename ...Components>
+template<typename ...ViewComponents>
+typename ArchetypeEntityContainer<Components...>::View<ViewComponents...>::Iterator
+    ArchetypeEntityContainer<Components...>::View<ViewComponents...>::end()
+{
+    return Iterator( m_archetypes, ( ComponentBit<ViewComponents> | ... | ComponentMask( 0 ) ), uint32_t( m_archetypes.size() ) );
+}
+
+
+template<typename ...Components>
+template<typename ...ViewComponents>
+std::tuple<typename ArchetypeEntityContainer<Components...>::Entity, ViewComponents&...>
+    ArchetypeEntityContainer<Components...>::View<ViewComponents...>::Iterator::operator*()
+{
+    assert( m_row < m_chunk_size );
+    return std::tuple<Entity, ViewComponents&...>( m_chunk_entities[m_row], std::get<ViewComponents*>( m_chunk_components )[m_row]... );
+}
+
+
+template<typename ...Components>
+template<typename ...ViewComponents>
+typename ArchetypeEntityContainer<Components...>::View<ViewComponents...>::Iterator&
+    ArchetypeEntityContainer<Components...>::View<ViewComponents...>::Iterator::operator++()
+{
+    if ( ++m_row < m_chunk_size )
+        return *this;
+
+    m_row = 0;
+    m_chunk++;
+    SkipToValidChunk();
+
+    return *this;
+}
+
+
+template<typename ...Components>
+template<typename ...ViewComponents>
+void ArchetypeEntityContainer<Components...>::View<ViewComponents...>::Iterator::SkipToValidChunk()
+{
+    const auto& archetypes = *m_archetypes;
+    for ( ; m_archetype < archetypes.size(); ++m_archetype, m_chunk = 0 )
+    {
+        const Archetype& archetype = archetypes[m_archetype];
+        if ( ( archetype.mask & m_mask ) != m_mask || m_chunk >= archetype.chunks.size() )
+            continue;
+
+        // chunks are never empty, empty ones are released right away
+        const Chunk& chunk = archetype.chunks[m_chunk];
+        m_chunk_size = chunk.num_entities;
+        m_chunk_entities = archetype.GetEntities( chunk );
+        m_chunk_components = std::make_tuple( static_cast<ViewComponents*>( archetype.GetComponent( chunk, ComponentIdx<ViewComponents>, 0 ) )... );
+        return;
+    }
+
+    m_chunk = 0;
+    m_chunk_size = 0;
+}
+
+
+template<typename ...Components>
+template<typename ...ViewComponents>
+bool ArchetypeEntityContainer<Components...>::View<ViewComponents...>::Iterator::operator!=( const Iterator& rhs ) const
+{
+    return m_archetype != rhs.m_archetype || m_chunk != rhs.m_chunk || m_row != rhs.m_row;
+}
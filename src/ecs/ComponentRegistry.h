@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+
+using ComponentID = uint32_t;
+
+
+// type-erased component operations, so that storages do not have to know the component types
+struct ComponentTypeInfo
+{
+    uint32_t size;
+    uint32_t alignment;
+    void ( *move_construct )( void* dst, void* src );
+    void ( *destroy )( void* ptr );
+};
+
+template<typename Component>
+constexpr ComponentTypeInfo MakeComponentTypeInfo()
+{
+    return ComponentTypeInfo
+    {
+        uint32_t( sizeof( Component ) ),
+        uint32_t( alignof( Component ) ),
+        []( void* dst, void* src ) { new( dst ) Component( std::move( *static_cast<Component*>( src ) ) ); },
+        []( void* ptr ) { static_cast<Component*>( ptr )->~Component(); }
+    };
+}
+
+
+// Process-wide registry of component types, assigns dense ids in registration order.
+// C++ types are registered automatically on the first GetID<T>() call, components without a C++ type
+// (e.g. coming from tools or scripts) can be registered directly with a type info.
+// Registration is thread-safe, ids are never reused
+class ComponentRegistry
+{
+public:
+    static constexpr uint32_t MaxComponents = 128;
+    static constexpr ComponentID InvalidID = std::numeric_limits<ComponentID>::max();
+
+    static ComponentRegistry& Get()
+    {
+        static ComponentRegistry registry;
+        return registry;
+    }
+
+    // cv-qualifiers are ignored, GetID<const T>() == GetID<T>()
+    template<typename Component>
+    static ComponentID GetID()
+    {
+        return GetUnqualifiedID<std::remove_cv_t<Component>>();
+    }
+
+    // Returns InvalidID if the registry is full
+    ComponentID Register( const ComponentTypeInfo& type_info, const char* name )
+    {
+        std::lock_guard<std::mutex> lock( m_register_cs );
+
+        const ComponentID id = m_num_components.load( std::memory_order_relaxed );
+        if ( id == MaxComponents )
+            return InvalidID;
+
+        m_type_infos[id] = type_info;
+        m_names[id] = name ? name : "";
+
+        m_num_components.store( id + 1, std::memory_order_release );
+        return id;
+    }
+
+    const ComponentTypeInfo& GetTypeInfo( ComponentID id ) const { return m_type_infos[id]; }
+    const std::string& GetName( ComponentID id ) const { return m_names[id]; }
+
+    uint32_t GetNumComponents() const { return m_num_components.load( std::memory_order_acquire ); }
+
+    // O(n), meant for tools and serialization
+    ComponentID FindByName( const char* name ) const
+    {
+        for ( ComponentID id = 0, num_components = GetNumComponents(); id < num_components; ++id )
+            if ( m_names[id] == name )
+                return id;
+        return InvalidID;
+    }
+
+private:
+    ComponentRegistry() = default;
+
+    template<typename Component>
+    static ComponentID GetUnqualifiedID()
+    {
+        static const ComponentID id = Get().Register( MakeComponentTypeInfo<Component>(), typeid( Component ).name() );
+        return id;
+    }
+
+    std::mutex m_register_cs;
+    std::atomic<uint32_t> m_num_components = 0;
+    std::array<ComponentTypeInfo, MaxComponents> m_type_infos = {};
+    std::array<std::string, MaxComponents> m_names;
+};
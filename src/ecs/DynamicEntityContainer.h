@@ -0,0 +1,176 @@
+#pragma once
+
+#include "ComponentRegistry.h"
+
+#include "utils/packed_freelist.h"
+#include "utils/TaskScheduler.h"
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+
+// Entity container with runtime component registration. Unlike EntityContainer, the set of component types
+// is not a part of the container type, any type gets a dense id from ComponentRegistry on first use.
+// Each entity keeps a bitset signature of its components, so HasComponent is a single bit test,
+// components of one type are stored in a type-erased sparse set (ComponentPool).
+//
+// Adding or removing components of type T invalidates pointers to other components of type T
+// and views that iterate over T. Components of other types may be added or removed while iterating.
+// Component types must be nothrow movable
+class DynamicEntityContainer
+{
+public:
+    using ComponentMask = std::bitset<ComponentRegistry::MaxComponents>;
+
+private:
+    using Entity2Components = packed_freelist<ComponentMask>;
+
+public:
+    using Entity = Entity2Components::id;
+
+private:
+    // Type-erased packed storage for one component type, addressed by entity slot index (Entity::idx).
+    // Removal moves the last element into the hole
+    class ComponentPool
+    {
+    public:
+        static constexpr uint32_t InvalidIdx = std::numeric_limits<uint32_t>::max();
+
+        explicit ComponentPool( const ComponentTypeInfo& type_info ) : m_type_info( type_info ) {}
+        ~ComponentPool();
+
+        ComponentPool( const ComponentPool& ) = delete;
+        ComponentPool& operator=( const ComponentPool& ) = delete;
+
+        // returns uninitialized storage for the entity's component, the entity must not be in the pool
+        void* Allocate( Entity entity );
+        // destroys the entity's component, the entity must be in the pool
+        void Erase( Entity entity );
+
+        uint32_t GetDenseIdx( uint32_t slot ) const { return slot < m_sparse.size() ? m_sparse[slot] : InvalidIdx; }
+        void* GetByDenseIdx( uint32_t dense_idx ) const { return m_data + size_t( dense_idx ) * m_type_info.size; }
+        void* Get( uint32_t slot ) const
+        {
+            const uint32_t dense_idx = GetDenseIdx( slot );
+            return dense_idx == InvalidIdx ? nullptr : GetByDenseIdx( dense_idx );
+        }
+
+        Entity GetEntity( uint32_t dense_idx ) const { return m_dense_entities[dense_idx]; }
+        uint32_t Size() const { return uint32_t( m_dense_entities.size() ); }
+
+    private:
+        void Reserve( uint32_t new_capacity );
+
+        ComponentTypeInfo m_type_info;
+        std::vector<uint32_t> m_sparse; // entity slot -> dense idx
+        std::vector<Entity> m_dense_entities;
+        std::byte* m_data = nullptr;
+        uint32_t m_capacity = 0;
+    };
+
+public:
+
+    // Noncopyable, nonmovable
+    DynamicEntityContainer() = default;
+    DynamicEntityContainer( const DynamicEntityContainer& ) = delete;
+    DynamicEntityContainer( DynamicEntityContainer&& ) = delete;
+    DynamicEntityContainer& operator=( const DynamicEntityContainer& ) = delete;
+    DynamicEntityContainer& operator=( DynamicEntityContainer&& ) = delete;
+
+    Entity CreateEntity();
+    void DestroyEntity( Entity entity );
+
+    template<typename Component, typename ... Args>
+    Component* AddComponent( Entity entity, Args&&... comp_args ); // replaces the old component if it already exists. Returns nullptr if the component registry is full
+
+    template<typename Component>
+    Component* GetComponent( Entity entity ); // returns nullptr if the component of that type doesn't exist
+
+    template<typename Component>
+    const Component* GetComponent( Entity entity ) const;
+
+    template<typename Component>
+    bool HasComponent( Entity entity ) const;
+
+    template<typename Component>
+    void RemoveComponent( Entity entity );
+
+    // Type-erased interface for components registered at runtime
+    // Returns uninitialized storage, the caller must construct the component there. The component must not exist yet.
+    // Returns nullptr if the id is not registered
+    void* AddComponentStorage( Entity entity, ComponentID component_id );
+    void* GetComponent( Entity entity, ComponentID component_id ) const;
+    bool HasComponent( Entity entity, ComponentID component_id ) const;
+    void RemoveComponent( Entity entity, ComponentID component_id );
+
+    const ComponentMask& GetSignature( Entity entity ) const;
+
+    uint64_t GetEntityCount() const;
+
+    // Views
+    // Iterate over the smallest pool of the view components and skip entities with mismatching signatures
+    template<typename ...ViewComponents>
+    class View
+    {
+    public:
+        class Iterator
+        {
+        public:
+            std::tuple<Entity, ViewComponents&...> operator*();
+            Iterator& operator++();
+            bool operator!=( const Iterator& rhs ) const;
+
+        private:
+            friend class View;
+            Iterator( const View& view, uint32_t dense_idx )
+                : m_view( &view ), m_dense_idx( dense_idx )
+            {}
+
+            const View* m_view;
+            uint32_t m_dense_idx;
+        };
+
+        Iterator begin();
+        Iterator end();
+
+    private:
+        friend class DynamicEntityContainer;
+        View( const DynamicEntityContainer& container );
+
+        uint32_t Size() const { return m_driving_pool ? m_driving_pool->Size() : 0; }
+        bool Matches( uint32_t dense_idx ) const;
+        uint32_t FindNextMatch( uint32_t dense_idx ) const;
+
+        template<size_t ... Is>
+        std::tuple<Entity, ViewComponents&...> GetElement( uint32_t dense_idx, std::index_sequence<Is...> ) const;
+
+        const Entity2Components& m_entities;
+        ComponentMask m_mask;
+        const ComponentPool* m_driving_pool = nullptr; // nullptr if one of the components has never been added to any entity
+        std::array<const ComponentPool*, sizeof...( ViewComponents )> m_pools = {};
+    };
+
+    template<typename ...ViewComponents>
+    View<ViewComponents...> CreateView();
+
+    template<typename ...ViewComponents>
+    View<const ViewComponents...> CreateView() const;
+
+    // Same as EntityContainer::ParallelForEach, tasks are made of grain_size-sized parts of the view's smallest pool
+    template<typename ...ViewComponents, typename Fn>
+    void ParallelForEach( View<const ViewComponents...> view, Fn&& fn, size_t grain_size, ITaskScheduler& scheduler ) const;
+
+private:
+    const ComponentPool* GetPool( ComponentID component_id ) const;
+    ComponentPool& GetOrCreatePool( ComponentID component_id );
+
+    Entity2Components m_entities;
+
+    std::vector<std::unique_ptr<ComponentPool>> m_pools; // indexed by ComponentID
+};
+
+#include "DynamicEntityContainer.hpp"
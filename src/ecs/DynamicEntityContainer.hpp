@@ -0,0 +1,367 @@
+#pragma once
+
+#include "DynamicEntityContainer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+
+// ComponentPool
+
+inline DynamicEntityContainer::ComponentPool::~ComponentPool()
+{
+    for ( uint32_t i = 0; i < Size(); ++i )
+        m_type_info.destroy( GetByDenseIdx( i ) );
+
+    if ( m_data )
+        ::operator delete( m_data, std::align_val_t( m_type_info.alignment ) );
+}
+
+
+inline void* DynamicEntityContainer::ComponentPool::Allocate( Entity entity )
+{
+    assert( GetDenseIdx( entity.idx ) == InvalidIdx );
+
+    if ( Size() == m_capacity )
+        Reserve( std::max<uint32_t>( m_capacity * 2, 16 ) );
+
+    if ( entity.idx >= m_sparse.size() )
+        m_sparse.resize( size_t( entity.idx ) + 1, InvalidIdx );
+
+    const uint32_t dense_idx = Size();
+    m_sparse[entity.idx] = dense_idx;
+    m_dense_entities.push_back( entity );
+
+    return GetByDenseIdx( dense_idx );
+}
+
+
+inline void DynamicEntityContainer::ComponentPool::Erase( Entity entity )
+{
+    const uint32_t dense_idx = GetDenseIdx( entity.idx );
+    assert( dense_idx != InvalidIdx );
+
+    const uint32_t last_idx = Size() - 1;
+
+    void* hole = GetByDenseIdx( dense_idx );
+    m_type_info.destroy( hole );
+    if ( dense_idx != last_idx )
+    {
+        void* last = GetByDenseIdx( last_idx );
+        m_type_info.move_construct( hole, last );
+        m_type_info.destroy( last );
+
+        const Entity moved_entity = m_dense_entities[last_idx];
+        m_dense_entities[dense_idx] = moved_entity;
+        m_sparse[moved_entity.idx] = dense_idx;
+    }
+
+    m_dense_entities.pop_back();
+    m_sparse[entity.idx] = InvalidIdx;
+}
+
+
+inline void DynamicEntityContainer::ComponentPool::Reserve( uint32_t new_capacity )
+{
+    assert( new_capacity > m_capacity );
+
+    std::byte* new_data = static_cast<std::byte*>(
+        ::operator new( size_t( new_capacity ) * m_type_info.size, std::align_val_t( m_type_info.alignment ) ) );
+
+    for ( uint32_t i = 0; i < Size(); ++i )
+    {
+        void* old_elem = GetByDenseIdx( i );
+        m_type_info.move_construct( new_data + size_t( i ) * m_type_info.size, old_elem );
+        m_type_info.destroy( old_elem );
+    }
+
+    if ( m_data )
+        ::operator delete( m_data, std::align_val_t( m_type_info.alignment ) );
+
+    m_data = new_data;
+    m_capacity = new_capacity;
+    m_dense_entities.reserve( new_capacity );
+}
+
+
+// DynamicEntityContainer
+
+inline DynamicEntityContainer::Entity DynamicEntityContainer::CreateEntity()
+{
+    return m_entities.emplace();
+}
+
+
+inline void DynamicEntityContainer::DestroyEntity( Entity entity )
+{
+    assert( entity != Entity::nullid );
+    assert( m_entities.has( entity ) );
+
+    const ComponentMask& signature = m_entities[entity];
+    for ( ComponentID component_id = 0; component_id < m_pools.size(); ++component_id )
+        if ( signature.test( component_id ) )
+            m_pools[component_id]->Erase( entity );
+
+    m_entities.erase( entity );
+}
+
+
+template<typename Component, typename ... Args>
+Component* DynamicEntityContainer::AddComponent( Entity entity, Args&&... comp_args )
+{
+    assert( entity != Entity::nullid );
+    assert( m_entities.has( entity ) );
+
+    const ComponentID component_id = ComponentRegistry::GetID<Component>();
+    if ( component_id >= ComponentRegistry::MaxComponents )
+        return nullptr;
+
+    if ( m_entities[entity].test( component_id ) )
+    {
+        Component* component = static_cast<Component*>( m_pools[component_id]->Get( entity.idx ) );
+        *component = Component( std::forward<Args>( comp_args )... );
+        return component;
+    }
+
+    // construct the component first, args may reference other components in the same pool
+    Component new_component( std::forward<Args>( comp_args )... );
+
+    return new( AddComponentStorage( entity, component_id ) ) Component( std::move( new_component ) );
+}
+
+
+template<typename Component>
+Component* DynamicEntityContainer::GetComponent( Entity entity )
+{
+    return static_cast<Component*>( GetComponent( entity, ComponentRegistry::GetID<Component>() ) );
+}
+
+
+template<typename Component>
+const Component* DynamicEntityContainer::GetComponent( Entity entity ) const
+{
+    return static_cast<const Component*>( GetComponent( entity, ComponentRegistry::GetID<Component>() ) );
+}
+
+
+template<typename Component>
+bool DynamicEntityContainer::HasComponent( Entity entity ) const
+{
+    return HasComponent( entity, ComponentRegistry::GetID<Component>() );
+}
+
+
+template<typename Component>
+void DynamicEntityContainer::RemoveComponent( Entity entity )
+{
+    RemoveComponent( entity, ComponentRegistry::GetID<Component>() );
+}
+
+
+inline void* DynamicEntityContainer::AddComponentStorage( Entity entity, ComponentID component_id )
+{
+    assert( entity != Entity::nullid );
+    assert( m_entities.has( entity ) );
+
+    // InvalidID from a full registry, or an id that was never registered
+    if ( component_id >= ComponentRegistry::Get().GetNumComponents() )
+        return nullptr;
+
+    ComponentMask& signature = m_entities[entity];
+    assert( ! signature.test( component_id ) );
+
+    signature.set( component_id );
+    return GetOrCreatePool( component_id ).Allocate( entity );
+}
+
+
+inline void* DynamicEntityContainer::GetComponent( Entity entity, ComponentID component_id ) const
+{
+    assert( entity != Entity::nullid );
+    assert( m_entities.has( entity ) );
+
+    if ( component_id >= ComponentRegistry::MaxComponents || ! m_entities[entity].test( component_id ) )
+        return nullptr;
+
+    return m_pools[component_id]->Get( entity.idx );
+}
+
+
+inline bool DynamicEntityContainer::HasComponent( Entity entity, ComponentID component_id ) const
+{
+    assert( entity != Entity::nullid );
+    assert( m_entities.has( entity ) );
+
+    return component_id < ComponentRegistry::MaxComponents && m_entities[entity].test( component_id );
+}
+
+
+inline void DynamicEntityContainer::RemoveComponent( Entity entity, ComponentID component_id )
+{
+    assert( entity != Entity::nullid );
+    assert( m_entities.has( entity ) );
+
+    if ( component_id >= ComponentRegistry::MaxComponents )
+        return;
+
+    ComponentMask& signature = m_entities[entity];
+    if ( ! signature.test( component_id ) )
+        return;
+
+    m_pools[component_id]->Erase( entity );
+    signature.reset( component_id );
+}
+
+
+inline const DynamicEntityContainer::ComponentMask& DynamicEntityContainer::GetSignature( Entity entity ) const
+{
+    assert( m_entities.has( entity ) );
+    return m_entities[entity];
+}
+
+
+inline uint64_t DynamicEntityContainer::GetEntityCount() const
+{
+    return m_entities.size();
+}
+
+
+inline const DynamicEntityContainer::ComponentPool* DynamicEntityContainer::GetPool( ComponentID component_id ) const
+{
+    return component_id < m_pools.size() ? m_pools[component_id].get() : nullptr;
+}
+
+
+inline DynamicEntityContainer::ComponentPool& DynamicEntityContainer::GetOrCreatePool( ComponentID component_id )
+{
+    if ( component_id >= m_pools.size() )
+        m_pools.resize( size_t( component_id ) + 1 );
+
+    if ( ! m_pools[component_id] )
+        m_pools[component_id] = std::make_unique<ComponentPool>( ComponentRegistry::Get().GetTypeInfo( component_id ) );
+
+    return *m_pools[component_id];
+}
+
+
+// Views
+template<typename ...ViewComponents>
+DynamicEntityContainer::View<ViewComponents...> DynamicEntityContainer::CreateView()
+{
+    return View<ViewComponents...>( *this );
+}
+
+
+template<typename ...ViewComponents>
+DynamicEntityContainer::View<const ViewComponents...> DynamicEntityContainer::CreateView() const
+{
+    return View<const ViewComponents...>( *this );
+}
+
+
+template<typename ...ViewComponents, typename Fn>
+void DynamicEntityContainer::ParallelForEach( View<const ViewComponents...> view, Fn&& fn, size_t grain_size, ITaskScheduler& scheduler ) const
+{
+    grain_size = std::max<size_t>( grain_size, 1 );
+
+    const size_t view_size = view.Size();
+    const size_t num_ranges = ( view_size + grain_size - 1 ) / grain_size;
+
+    scheduler.ParallelFor( num_ranges, [&]( size_t range_idx )
+    {
+        const uint32_t range_end = uint32_t( std::min( ( range_idx + 1 ) * grain_size, view_size ) );
+        for ( uint32_t dense_idx = uint32_t( range_idx * grain_size ); dense_idx < range_end; ++dense_idx )
+            if ( view.Matches( dense_idx ) )
+                std::apply( fn, view.GetElement( dense_idx, std::index_sequence_for<ViewComponents...>() ) );
+    } );
+}
+
+
+template<typename ...ViewComponents>
+DynamicEntityContainer::View<ViewComponents...>::View( const DynamicEntityContainer& container )
+    : m_entities( container.m_entities )
+{
+    const std::array<ComponentID, sizeof...( ViewComponents )> component_ids = { ComponentRegistry::GetID<ViewComponents>()... };
+    for ( size_t i = 0; i < component_ids.size(); ++i )
+    {
+        // also covers InvalidID, there is no pool for it
+        m_pools[i] = container.GetPool( component_ids[i] );
+        if ( ! m_pools[i] )
+        {
+            m_driving_pool = nullptr;
+            return;
+        }
+        m_mask.set( component_ids[i] );
+        if ( ! m_driving_pool || m_pools[i]->Size() < m_driving_pool->Size() )
+            m_driving_pool = m_pools[i];
+    }
+}
+
+
+template<typename ...ViewComponents>
+typename DynamicEntityContainer::View<ViewComponents...>::Iterator DynamicEntityContainer::View<ViewComponents...>::begin()
+{
+    return Iterator( *this, FindNextMatch( 0 ) );
+}
+
+
+template<typename ...ViewComponents>
+typename DynamicEntityContainer::View<ViewComponents...>::Iterator DynamicEntityContainer::View<ViewComponents...>::end()
+{
+    return Iterator( *this, Size() );
+}
+
+
+template<typename ...ViewComponents>
+bool DynamicEntityContainer::View<ViewComponents...>::Matches( uint32_t dense_idx ) const
+{
+    if constexpr ( sizeof...( ViewComponents ) == 1 )
+        return true;
+
+    return ( m_entities[m_driving_pool->GetEntity( dense_idx )] & m_mask ) == m_mask;
+}
+
+
+template<typename ...ViewComponents>
+uint32_t DynamicEntityContainer::View<ViewComponents...>::FindNextMatch( uint32_t dense_idx ) const
+{
+    const uint32_t size = Size();
+    while ( dense_idx < size && ! Matches( dense_idx ) )
+        dense_idx++;
+    return dense_idx;
+}
+
+
+template<typename ...ViewComponents>
+template<size_t ... Is>
+std::tuple<DynamicEntityContainer::Entity, ViewComponents&...> DynamicEntityContainer::View<ViewComponents...>::GetElement( uint32_t dense_idx, std::index_sequence<Is...> ) const
+{
+    const Entity entity = m_driving_pool->GetEntity( dense_idx );
+    return std::tuple<Entity, ViewComponents&...>(
+        entity,
+        *static_cast<ViewComponents*>( m_pools[Is] == m_driving_pool ? m_pools[Is]->GetByDenseIdx( dense_idx ) : m_pools[Is]->Get( entity.idx ) )... );
+}
+
+
+template<typename ...ViewComponents>
+std::tuple<DynamicEntityContainer::Entity, ViewComponents&...> DynamicEntityContainer::View<ViewComponents...>::Iterator::operator*()
+{
+    assert( m_dense_idx < m_view->Size() );
+    return m_view->GetElement( m_dense_idx, std::index_sequence_for<ViewComponents...>() );
+}
+
+
+template<typename ...ViewComponents>
+typename DynamicEntityContainer::View<ViewComponents...>::Iterator& DynamicEntityContainer::View<ViewComponents...>::Iterator::operator++()
+{
+    m_dense_idx = m_view->FindNextMatch( m_dense_idx + 1 );
+    return *this;
+}
+
+
+template<typename ...ViewComponents>
+bool DynamicEntityContainer::View<ViewComponents...>::Iterator::operator!=( const Iterator& rhs ) const
+{
+    return m_dense_idx != rhs.m_dense_idx;
+}
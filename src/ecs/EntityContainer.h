@@ -4,6 +4,7 @@
 
 #include "utils/btree.h"
 #include "utils/packed_freelist.h"
+#include "utils/TaskScheduler.h"
 
 
 namespace details
@@ -28,12 +29,6 @@ class EntityContainer
         char data[12];
     };
 
-    template<typename Component>
-    static constexpr uint32_t CalcBTreeFactor( uint32_t memblock_size )
-    {
-        return 10; // ToDo: actual btree factor calculation
-    }
-
     using Entity2Components =
         packed_freelist<
             boost::container::flat_map<
@@ -46,6 +41,11 @@ public:
     using Entity = typename Entity2Components::id;
 
 private:
+    template<typename Component>
+    static constexpr uint32_t CalcBTreeFactor()
+    {
+        return btree_map_cache_line_policy<Entity, Component>::factor;
+    }
 
     friend struct details::ECSBTreeCallback<EntityContainer<Components...>>;
 
@@ -56,11 +56,15 @@ private:
     using ComponentBtree = btree_map<
         Entity,
         Component,
-        CalcBTreeFactor<Component>( 0 ),
-        std::allocator<btree_map_node<Entity, Component, CalcBTreeFactor<Component>( 0 )>>,
+        CalcBTreeFactor<Component>(),
+        std::allocator<btree_map_node<Entity, Component, CalcBTreeFactor<Component>()>>,
         BTreeCallback<Component>
     >;
 
+    // const view components share btrees with mutable ones
+    template<typename Component>
+    using ViewBtree = ComponentBtree<std::remove_const_t<Component>>;
+
      // reflection stuff to be able to remove components from entities by a component typeid
     struct IBtree
     {
@@ -105,6 +109,8 @@ public:
 
     Entity CreateEntity();
     void DestroyEntity( Entity entity );
+    // faster than DestroyEntity for big batches, each component btree is rebuilt at most once
+    void DestroyEntities( std::vector<Entity> entities );
 
     template<typename Component, typename ... Args>
     Component& AddComponent( Entity entity, Args&&... comp_args ); // replaces the old component if it already exists
@@ -115,6 +121,9 @@ public:
     template<typename Component>
     const Component* GetComponent( Entity entity ) const;
 
+    template<typename Component>
+    bool HasComponent( Entity entity ) const;
+
     template<typename Component>
     void RemoveComponent( Entity entity );
 
@@ -136,13 +145,13 @@ public:
 
         private:
             friend class View;
-            Iterator( const std::tuple<typename ComponentBtree<ViewComponents>::cursor_t...>& cursors, std::tuple<ComponentBtree<Components>...>& components )
+            Iterator( const std::tuple<typename ViewBtree<ViewComponents>::cursor_t...>& cursors, std::tuple<ComponentBtree<Components>...>& components )
                 : m_cursors( cursors ), m_components( components )
             {}
 
             void MakeCursorsEqual();
 
-            std::tuple<typename ComponentBtree<ViewComponents>::cursor_t...> m_cursors;
+            std::tuple<typename ViewBtree<ViewComponents>::cursor_t...> m_cursors;
             std::tuple<ComponentBtree<Components>...>& m_components;
         };
 
@@ -155,16 +164,26 @@ public:
             : m_components( components )
         {}
 
+        // visits entities in [*range_begin, *range_end), nullptr means the range is unbounded on that side
+        template<typename Fn>
+        void ForEachInRange( const Entity* range_begin, const Entity* range_end, Fn& fn );
+
         std::tuple<ComponentBtree<Components>...>& m_components;
     };
 
     template<typename ...ViewComponents>
     View<ViewComponents...> CreateView();
 
-    // todo: const views
     template<typename ...ViewComponents>
     View<const ViewComponents...> CreateView() const;
 
+    // Splits a const view into independent entity ranges of roughly grain_size entities each and calls
+    // fn( entity, const components&... ) for every entity of the view, ranges are distributed through the scheduler.
+    // fn may be called concurrently and must not modify the container.
+    // With SerialTaskScheduler entities are visited in the same order as with a regular view iteration
+    template<typename ...ViewComponents, typename Fn>
+    void ParallelForEach( View<const ViewComponents...> view, Fn&& fn, size_t grain_size, ITaskScheduler& scheduler ) const;
+
 
 private:
 
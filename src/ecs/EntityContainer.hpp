@@ -2,6 +2,7 @@
 
 #include "EntityContainer.h"
 
+#include <algorithm>
 #include <typeindex>
 
 
@@ -42,6 +43,26 @@ void EntityContainer<Components...>::DestroyEntity( Entity entity )
 }
 
 
+template<typename ... Components>
+void EntityContainer<Components...>::DestroyEntities( std::vector<Entity> entities )
+{
+    std::sort( entities.begin(), entities.end() );
+
+    auto is_destroyed = [&entities]( const Entity& entity, const auto& component )
+    {
+        return std::binary_search( entities.begin(), entities.end(), entity );
+    };
+    ( std::get<ComponentBtree<Components>>( m_components ).erase_if( is_destroyed ), ... );
+
+    for ( Entity entity : entities )
+    {
+        assert( entity != Entity::nullid );
+        assert( m_entities.has( entity ) );
+        m_entities.erase( entity );
+    }
+}
+
+
 template<typename ... Components>
 template<typename Component, typename ... Args>
 Component& EntityContainer<Components...>::AddComponent( Entity entity, Args&&... comp_args )
@@ -96,6 +117,14 @@ const Component* EntityContainer<Components...>::GetComponent( Entity entity ) c
 }
 
 
+template<typename ... Components>
+template<typename Component>
+bool EntityContainer<Components...>::HasComponent( Entity entity ) const
+{
+    return GetComponent<Component>( entity ) != nullptr;
+}
+
+
 template<typename ... Components>
 template<typename Component>
 void EntityContainer<Components...>::RemoveComponent( Entity entity )
@@ -140,13 +169,58 @@ typename EntityContainer<Components...>::View<const ViewComponents...>
 }
 
 
+template<typename ...Components>
+template<typename ...ViewComponents, typename Fn>
+void EntityContainer<Components...>::ParallelForEach( View<const ViewComponents...> view, Fn&& fn, size_t grain_size, ITaskScheduler& scheduler ) const
+{
+    // view iteration is driven by the first component btree, so split it
+    using FirstComponent = std::tuple_element_t<0, std::tuple<ViewComponents...>>;
+    const auto& first_btree = std::get<ComponentBtree<FirstComponent>>( m_components );
+
+    const size_t num_ranges = std::max<size_t>( first_btree.size() / std::max<size_t>( grain_size, 1 ), 1 );
+    const std::vector<Entity> split_keys = first_btree.get_split_keys( num_ranges );
+
+    scheduler.ParallelFor( split_keys.size() + 1, [&]( size_t range_idx )
+    {
+        const Entity* range_begin = range_idx > 0 ? &split_keys[range_idx - 1] : nullptr;
+        const Entity* range_end = range_idx < split_keys.size() ? &split_keys[range_idx] : nullptr;
+        view.ForEachInRange( range_begin, range_end, fn );
+    } );
+}
+
+
+template<typename ...Components>
+template<typename ...ViewComponents>
+template<typename Fn>
+void EntityContainer<Components...>::View<ViewComponents...>::ForEachInRange( const Entity* range_begin, const Entity* range_end, Fn& fn )
+{
+    using ViewBtreeTuple = std::tuple<ViewBtree<ViewComponents>&...>;
+    ViewBtreeTuple view_btrees( std::get<ViewBtree<ViewComponents>>( m_components )... );
+    auto make_cursor_tuples = [range_begin]( auto& ...tuple_btree )
+    {
+        return std::make_tuple( ( range_begin ? tuple_btree.lower_bound( *range_begin ) : tuple_btree.begin() ) ... );
+    };
+
+    Iterator it( std::apply( make_cursor_tuples, view_btrees ), m_components );
+    it.MakeCursorsEqual();
+
+    const Iterator end_it = end();
+    for ( ; it != end_it; ++it )
+    {
+        if ( range_end && ! ( std::get<0>( it.m_cursors ).key() < *range_end ) )
+            break;
+        std::apply( fn, *it );
+    }
+}
+
+
 template<typename ...Components>
 template<typename ...ViewComponents>
 typename EntityContainer<Components...>::View<ViewComponents...>::Iterator
     EntityContainer<Components...>::View<ViewComponents...>::begin()
 {
-    using ViewBtreeTuple = std::tuple<ComponentBtree<ViewComponents>&...>;
-    ViewBtreeTuple view_btrees( std::get<ComponentBtree<ViewComponents>>( m_components )... );
+    using ViewBtreeTuple = std::tuple<ViewBtree<ViewComponents>&...>;
+    ViewBtreeTuple view_btrees( std::get<ViewBtree<ViewComponents>>( m_components )... );
     auto make_cursor_tuples = []( auto& ...tuple_btree )
     {
         return std::make_tuple( tuple_btree.begin() ... );
@@ -163,7 +237,7 @@ typename EntityContainer<Components...>::View<ViewComponents...>::Iterator
     const bool everything_is_equal = (
 		are_cursors_equal(
 			std::get<0>( retval.m_cursors ),
-			std::get<typename ComponentBtree<ViewComponents>::cursor_t>( retval.m_cursors ) )
+			std::get<typename ViewBtree<ViewComponents>::cursor_t>( retval.m_cursors ) )
 		&& ... );
 
     if ( ! everything_is_equal )
@@ -178,8 +252,8 @@ template<typename ...ViewComponents>
 typename EntityContainer<Components...>::View<ViewComponents...>::Iterator
     EntityContainer<Components...>::View<ViewComponents...>::end()
 {
-    using ViewBtreeTuple = std::tuple<ComponentBtree<ViewComponents>&...>;
-    ViewBtreeTuple view_btrees( std::get<ComponentBtree<ViewComponents>>( m_components )... );
+    using ViewBtreeTuple = std::tuple<ViewBtree<ViewComponents>&...>;
+    ViewBtreeTuple view_btrees( std::get<ViewBtree<ViewComponents>>( m_components )... );
     auto make_cursor_tuples = []( auto& ...tuple_btree )
     {
         return std::make_tuple( tuple_btree.end() ... );
@@ -194,8 +268,8 @@ template<typename ...ViewComponents>
 std::tuple<typename EntityContainer<Components...>::Entity, ViewComponents&...>
     EntityContainer<Components...>::View<ViewComponents...>::Iterator::operator*()
 {
-    assert( ( ( std::get<0>( m_cursors ).key() == std::get<typename ComponentBtree<ViewComponents>::cursor_t>( m_cursors ).key() ) && ... ) );
-    return std::tie( std::get<0>( m_cursors ).key(), std::get<typename ComponentBtree<ViewComponents>::cursor_t>( m_cursors ).value()... );
+    assert( ( ( std::get<0>( m_cursors ).key() == std::get<typename ViewBtree<ViewComponents>::cursor_t>( m_cursors ).key() ) && ... ) );
+    return std::tie( std::get<0>( m_cursors ).key(), std::get<typename ViewBtree<ViewComponents>::cursor_t>( m_cursors ).value()... );
 }
 
 
@@ -226,9 +300,9 @@ void EntityContainer<Components...>::View<ViewComponents...>::Iterator::MakeCurs
     auto everything_is_equal = [&]() -> bool
     {
         return 
-            ( ( std::get<0>( m_cursors ).valid() == std::get<typename ComponentBtree<ViewComponents>::cursor_t>( m_cursors ).valid()
+            ( ( std::get<0>( m_cursors ).valid() == std::get<typename ViewBtree<ViewComponents>::cursor_t>( m_cursors ).valid()
                 && ( std::get<0>( m_cursors ).valid()
-                    ? ( std::get<0>( m_cursors ).key() == std::get<typename ComponentBtree<ViewComponents>::cursor_t>( m_cursors ).key() )
+                    ? ( std::get<0>( m_cursors ).key() == std::get<typename ViewBtree<ViewComponents>::cursor_t>( m_cursors ).key() )
                     : true ) ) && ... );
     };
 
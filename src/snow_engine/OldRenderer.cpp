@@ -10,6 +10,8 @@
 
 #include "GPUResourceHolder.h"
 
+#include "RenderItemSorting.h"
+
 #include <utils/CGUtils.h>
 
 #include <dxtk12/DDSTextureLoader.h>
@@ -494,24 +496,47 @@ OldRenderer::RenderItemStorage OldRenderer::CreateRenderItems( const RenderTask&
 			list.reserve( nentities );
 	}
 
-	// prepare frustum culling data
-    const DirectX::XMMATRIX& proj = main_frustum.proj;
-
-    DirectX::BoundingFrustum main_bf( proj );
-    if ( main_bf.Far < main_bf.Near ) // reversed z
-        std::swap( main_bf.Far, main_bf.Near );
-
-    const DirectX::XMMATRIX& view = main_frustum.view;
-
-    DirectX::XMVECTOR det;
-    main_bf.Transform( main_bf, DirectX::XMMatrixInverse( &det, view ) );
+	// prepare frustum culling data. Main frustum goes first, then shadow cascades, list_frustums maps render lists to culling frustums
+	auto make_culling_frustum = []( const DirectX::XMMATRIX& view_proj )
+	{
+		DirectX::XMFLOAT4X4 clip_from_world;
+		DirectX::XMStoreFloat4x4( &clip_from_world, DirectX::XMMatrixTranspose( view_proj ) );
+		return CullingFrustum::FromMatrix( clip_from_world.m );
+	};
+
+	bc::small_vector<CullingFrustum, CullingBVH::MaxFrustums> culling_frustums;
+	std::vector<int> list_frustums( lists.size(), -1 ); // -1 if the list is not culled by a frustum
+	std::vector<DirectX::XMFLOAT4X4> list_views( lists.size() ); // for depth sorting
+	culling_frustums.push_back( make_culling_frustum( main_frustum.view * main_frustum.proj ) );
+	list_frustums[0] = 0;
+	DirectX::XMStoreFloat4x4( &list_views[0], main_frustum.view );
+	{
+		size_t list_idx = 1;
+		for ( const auto& shadow : shadow_frustums )
+		{
+			// only pssm matrices are computed for now
+			const bool has_matrices = shadow.light->GetData().type == Light::LightType::Parallel;
+			for ( const auto& cascade : shadow.frustum )
+			{
+				if ( has_matrices && culling_frustums.size() < CullingBVH::MaxFrustums )
+				{
+					list_frustums[list_idx] = int( culling_frustums.size() );
+					culling_frustums.push_back( make_culling_frustum( cascade.viewproj ) );
+				}
+				DirectX::XMStoreFloat4x4( &list_views[list_idx], has_matrices ? cascade.view : DirectX::XMMatrixIdentity() );
+				list_idx++;
+			}
+		}
+	}
 
     m_num_renderitems_total = 0;
     m_num_renderitems_to_draw = 0;
-	
-	bc::small_vector<bool, MAX_CASCADE_SIZE> splits;
 
-	auto& opaque_list = lists[0];
+	std::vector<RenderItem> items;
+	m_item_bounds.clear();
+	for ( auto& coords : m_item_spheres )
+		coords.clear();
+	m_item_sort_keys.clear();
 
     for ( const auto& [entity, transform, drawable] : GetScene().GetWorld().CreateView<Transform, DrawableMesh>() )
     {
@@ -558,43 +583,117 @@ OldRenderer::RenderItemStorage OldRenderer::CreateRenderItems( const RenderTask&
 
         item_box.Transform( item_box, transform.local2world );
 
-        m_num_renderitems_total++;
-        if ( item_box.Intersects( main_bf ) )
-            opaque_list.push_back( item );
+        DirectX::XMFLOAT3 corners[DirectX::BoundingOrientedBox::CORNER_COUNT];
+        item_box.GetCorners( corners );
+        BVHBounds& bounds = m_item_bounds.emplace_back();
+        for ( const DirectX::XMFLOAT3& corner : corners )
+            bounds.Extend( &corner.x );
 
-		// Shadow culling
-		const DirectX::XMFLOAT3 center = item_box.Center;
-		const float radius = std::sqrt( XMFloat3LenSquared( item_box.Extents ) );
-		DirectX::XMVECTOR center_to_camera = DirectX::XMLoadFloat3(&center) - camera_pos;
+        m_item_spheres[0].push_back( item_box.Center.x );
+        m_item_spheres[1].push_back( item_box.Center.y );
+        m_item_spheres[2].push_back( item_box.Center.z );
+        m_item_spheres[3].push_back( std::sqrt( XMFloat3LenSquared( item_box.Extents ) ) );
 
-		size_t list_idx = 1;
-		for ( size_t shadow_idx = 0; shadow_idx < shadow_frustums.size(); ++shadow_idx )
+        // MaterialPBR uses the pass pipeline state, so pso stays 0. Depth is added per render list
+        RenderSortKey sort_key;
+        sort_key.material = drawable.material.idx;
+        sort_key.mesh = drawable.mesh.idx;
+        m_item_sort_keys.push_back( sort_key.Encode() );
+
+        items.push_back( item );
+    }
+
+    m_num_renderitems_total = items.size();
+
+	// all frustums are tested in a single pass over the items
+	m_culling_bvh.Build( m_item_bounds.data(), uint32_t( m_item_bounds.size() ) );
+	m_visible_items.resize( culling_frustums.size() );
+	m_culling_bvh.Cull( culling_frustums.data(), uint32_t( culling_frustums.size() ), m_visible_items.data() );
+
+	// item indices per render list, sorted and turned into render items at the end
+	m_list_items.resize( lists.size() );
+	for ( auto& list_items : m_list_items )
+		list_items.clear();
+	m_list_items[0] = m_visible_items[0];
+
+	if ( !shadow_frustums.empty() )
+	{
+		// bit per culling frustum
+		std::vector<uint32_t> item_frustum_masks( items.size(), 0 );
+		for ( size_t frustum_idx = 1; frustum_idx < m_visible_items.size(); ++frustum_idx )
+		{
+			for ( uint32_t item_idx : m_visible_items[frustum_idx] )
+				item_frustum_masks[item_idx] |= 1u << frustum_idx;
+		}
+
+		// cascade selection for all lights at once, bit i of a cascade mask goes to render list i + 1
+		bc::small_vector<ParallelSplitShadowMapping::CascadeCullingLight, 4> cascade_lights;
+		for ( const auto& shadow : shadow_frustums )
 		{
-			const auto& shadow = shadow_frustums[shadow_idx];
 			assert( !shadow.frustum.empty() );
 			assert( shadow.frustum[0].type == RenderTask::Frustum::Type::Orthographic );
 			assert( shadow.light != nullptr );
 
-			splits.resize( shadow.split_positions.size() + 1 );
-			for ( bool& in_split : splits )
-				in_split = false;
+			cascade_lights.push_back( { shadow.light->GetData().dir, make_span( shadow.split_positions ) } );
+		}
+
+		ParallelSplitShadowMapping::BoundingSpheresSoA spheres;
+		spheres.x = m_item_spheres[0].data();
+		spheres.y = m_item_spheres[1].data();
+		spheres.z = m_item_spheres[2].data();
+		spheres.radius = m_item_spheres[3].data();
+		spheres.count = items.size();
+
+		DirectX::XMFLOAT3 camera_pos_ws;
+		DirectX::XMStoreFloat3( &camera_pos_ws, camera_pos );
 
-			FindPSSMFrustumsForItem(
-				center_to_camera, radius,
-				XMLoadFloat3( &shadow.light->GetData().dir ), make_span( shadow.split_positions ),
-				make_span( splits ) );
+		m_item_cascade_masks.resize( items.size() );
+		ParallelSplitShadowMapping::CalcCascadeMasks( camera_pos_ws, spheres, make_span( cascade_lights ), make_span( m_item_cascade_masks ) );
 
-			for ( size_t split_idx = 0; split_idx < splits.size(); ++split_idx )
+		const size_t num_cascade_lists = std::min<size_t>( lists.size() - 1, 32 );
+		for ( size_t item_idx = 0; item_idx < items.size(); ++item_idx )
+		{
+			const uint32_t cascades = m_item_cascade_masks[item_idx];
+			if ( cascades == 0 )
+				continue;
+
+			for ( size_t cascade_idx = 0; cascade_idx < num_cascade_lists; ++cascade_idx )
 			{
-				if ( splits[split_idx] )
-					lists[list_idx + split_idx].push_back( item );
+				if ( ( cascades & ( 1u << cascade_idx ) ) == 0 )
+					continue;
+
+				const size_t list_idx = cascade_idx + 1;
+
+				const int frustum_idx = list_frustums[list_idx];
+				const bool in_frustum = frustum_idx < 0 || ( item_frustum_masks[item_idx] & ( 1u << frustum_idx ) ) != 0;
+				if ( in_frustum )
+					m_list_items[list_idx].push_back( uint32_t( item_idx ) );
 			}
-			list_idx += splits.size();
 		}
-    }
+	}
+
+	// state first, then front to back. Instanced batches are made from the runs of the same mesh and material
+	for ( size_t list_idx = 0; list_idx < lists.size(); ++list_idx )
+	{
+		std::vector<uint32_t>& list_items = m_list_items[list_idx];
+		const DirectX::XMFLOAT4X4& view = list_views[list_idx];
 
-	for ( auto& list : lists )
-		boost::sort( list, []( const auto& lhs, const auto& rhs ) { return lhs.material < rhs.material; } );
+		m_sort_keys.resize( list_items.size() );
+		for ( size_t i = 0; i < list_items.size(); ++i )
+		{
+			const uint32_t item_idx = list_items[i];
+			const float depth = m_item_spheres[0][item_idx] * view._13 + m_item_spheres[1][item_idx] * view._23
+				+ m_item_spheres[2][item_idx] * view._33 + view._43;
+			m_sort_keys[i] = m_item_sort_keys[item_idx] | RenderSortKey::QuantizeDepth( depth );
+		}
+
+		m_sort_keys_scratch.resize( list_items.size() );
+		m_sort_items_scratch.resize( list_items.size() );
+		RadixSortKeys( make_span( m_sort_keys ), make_span( list_items ), make_span( m_sort_keys_scratch ), make_span( m_sort_items_scratch ) );
+
+		for ( uint32_t item_idx : list_items )
+			lists[list_idx].push_back( items[item_idx] );
+	}
 
     m_num_renderitems_to_draw = lists[0].size();
 
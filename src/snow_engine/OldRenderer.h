@@ -15,6 +15,8 @@
 #include "Renderer.h"
 #include "resources/GPUDevice.h"
 
+#include "utils/FrustumCulling.h"
+
 class Renderer;
 
 // throws SnowEngineExceptions and DxExceptions for non-recoverable faults
@@ -126,6 +128,18 @@ private:
     uint64_t m_num_renderitems_total = 0; // last frame
     uint64_t m_num_renderitems_to_draw = 0; // last frame
 
+    // CreateRenderItems temporaries, kept between frames to reuse memory
+    CullingBVH m_culling_bvh;
+    std::vector<BVHBounds> m_item_bounds;
+    std::vector<std::vector<uint32_t>> m_visible_items;
+    std::vector<float> m_item_spheres[4]; // SoA x, y, z, radius
+    std::vector<uint32_t> m_item_cascade_masks;
+    std::vector<uint64_t> m_item_sort_keys; // without depth
+    std::vector<std::vector<uint32_t>> m_list_items;
+    std::vector<uint64_t> m_sort_keys;
+    std::vector<uint64_t> m_sort_keys_scratch;
+    std::vector<uint32_t> m_sort_items_scratch;
+
     // methods
     void CreateDevice();
     void CreateSwapChain();
@@ -179,6 +179,128 @@ span<DirectX::XMMATRIX> ParallelSplitShadowMapping::CalcShadowMatricesWS( const
 }
 
 
+namespace
+{
+    // Same inflation as in FindPSSMFrustumsForItem, so the results match up to rounding
+    float InflateCullingRadius( float radius )
+    {
+        return radius * 1.001f + 1.e-3f;
+    }
+
+    // Scalar path for the tail, same logic as the SIMD loop below
+    uint32_t CalcCascadeMaskForSphere( const float center_to_camera[3], float radius, const float light_dir[3],
+                                       const span<const float>& split_positions, uint32_t first_bit )
+    {
+        const float proj = center_to_camera[0] * light_dir[0] + center_to_camera[1] * light_dir[1] + center_to_camera[2] * light_dir[2];
+        float dist_sq = 0;
+        for ( int i = 0; i < 3; ++i )
+        {
+            const float to_axis = center_to_camera[i] - light_dir[i] * proj;
+            dist_sq += to_axis * to_axis;
+        }
+        const float dist = std::sqrt( dist_sq );
+        radius = InflateCullingRadius( radius );
+        const float min_dist = std::max( dist - radius, 0.0f );
+        const float max_dist = dist + radius;
+
+        uint32_t mask = 0;
+        bool not_completely_inside = true;
+        for ( size_t i = 0; i < split_positions.size(); ++i )
+        {
+            if ( not_completely_inside && min_dist < split_positions[i] )
+                mask |= 1u << ( first_bit + i );
+            not_completely_inside = not_completely_inside && max_dist > split_positions[i];
+        }
+        if ( not_completely_inside )
+            mask |= 1u << ( first_bit + split_positions.size() );
+
+        return mask;
+    }
+}
+
+void ParallelSplitShadowMapping::CalcCascadeMasks( const XMFLOAT3& camera_pos, const BoundingSpheresSoA& spheres,
+                                                   const span<const CascadeCullingLight>& lights, const span<uint32_t>& cascade_masks ) noexcept
+{
+    assert( cascade_masks.size() >= spheres.count );
+
+    std::fill( cascade_masks.begin(), cascade_masks.begin() + spheres.count, 0u );
+
+    uint32_t first_bit = 0;
+    for ( const CascadeCullingLight& light : lights )
+    {
+        const uint32_t num_splits = uint32_t( light.split_positions.size() );
+        assert( first_bit + num_splits + 1 <= 32 );
+        assert( std::abs( XMFloat3LenSquared( light.dir ) - 1.0f ) < 1.e-3f );
+
+        const float light_dir[3] = { light.dir.x, light.dir.y, light.dir.z };
+
+        const __m128 cam_x = _mm_set1_ps( camera_pos.x );
+        const __m128 cam_y = _mm_set1_ps( camera_pos.y );
+        const __m128 cam_z = _mm_set1_ps( camera_pos.z );
+        const __m128 dir_x = _mm_set1_ps( light.dir.x );
+        const __m128 dir_y = _mm_set1_ps( light.dir.y );
+        const __m128 dir_z = _mm_set1_ps( light.dir.z );
+        const __m128 radius_scale = _mm_set1_ps( 1.001f );
+        const __m128 radius_bias = _mm_set1_ps( 1.e-3f );
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 all_ones = _mm_castsi128_ps( _mm_set1_epi32( -1 ) );
+
+        __m128 splits[32];
+        __m128i split_bits[32];
+        for ( uint32_t i = 0; i < num_splits; ++i )
+        {
+            splits[i] = _mm_set1_ps( light.split_positions[i] );
+            split_bits[i] = _mm_set1_epi32( int( 1u << ( first_bit + i ) ) );
+        }
+        const __m128i last_bit = _mm_set1_epi32( int( 1u << ( first_bit + num_splits ) ) );
+
+        size_t sphere_idx = 0;
+        for ( ; sphere_idx + 4 <= spheres.count; sphere_idx += 4 )
+        {
+            const __m128 x = _mm_sub_ps( _mm_loadu_ps( spheres.x + sphere_idx ), cam_x );
+            const __m128 y = _mm_sub_ps( _mm_loadu_ps( spheres.y + sphere_idx ), cam_y );
+            const __m128 z = _mm_sub_ps( _mm_loadu_ps( spheres.z + sphere_idx ), cam_z );
+
+            // distance to the light axis through the camera
+            const __m128 proj = _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, dir_x ), _mm_mul_ps( y, dir_y ) ), _mm_mul_ps( z, dir_z ) );
+            const __m128 to_axis_x = _mm_sub_ps( x, _mm_mul_ps( dir_x, proj ) );
+            const __m128 to_axis_y = _mm_sub_ps( y, _mm_mul_ps( dir_y, proj ) );
+            const __m128 to_axis_z = _mm_sub_ps( z, _mm_mul_ps( dir_z, proj ) );
+            const __m128 dist = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( to_axis_x, to_axis_x ), _mm_mul_ps( to_axis_y, to_axis_y ) ),
+                                                         _mm_mul_ps( to_axis_z, to_axis_z ) ) );
+
+            const __m128 radius = _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( spheres.radius + sphere_idx ), radius_scale ), radius_bias );
+            const __m128 min_dist = _mm_max_ps( _mm_sub_ps( dist, radius ), zero );
+            const __m128 max_dist = _mm_add_ps( dist, radius );
+
+            __m128i mask = _mm_loadu_si128( reinterpret_cast<const __m128i*>( cascade_masks.begin() + sphere_idx ) );
+            __m128 not_completely_inside = all_ones;
+            for ( uint32_t i = 0; i < num_splits; ++i )
+            {
+                const __m128 in_split = _mm_and_ps( not_completely_inside, _mm_cmplt_ps( min_dist, splits[i] ) );
+                mask = _mm_or_si128( mask, _mm_and_si128( _mm_castps_si128( in_split ), split_bits[i] ) );
+                not_completely_inside = _mm_and_ps( not_completely_inside, _mm_cmpgt_ps( max_dist, splits[i] ) );
+            }
+            mask = _mm_or_si128( mask, _mm_and_si128( _mm_castps_si128( not_completely_inside ), last_bit ) );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( cascade_masks.begin() + sphere_idx ), mask );
+        }
+
+        for ( ; sphere_idx < spheres.count; ++sphere_idx )
+        {
+            const float center_to_camera[3] =
+            {
+                spheres.x[sphere_idx] - camera_pos.x,
+                spheres.y[sphere_idx] - camera_pos.y,
+                spheres.z[sphere_idx] - camera_pos.z
+            };
+            cascade_masks[sphere_idx] |= CalcCascadeMaskForSphere( center_to_camera, spheres.radius[sphere_idx], light_dir, light.split_positions, first_bit );
+        }
+
+        first_bit += num_splits + 1;
+    }
+}
+
+
 void ParallelSplitShadowMapping::SetUniformFactor( float uniform_factor ) noexcept
 {
     assert( uniform_factor >= 0 && uniform_factor <= 1 );
@@ -26,6 +26,28 @@ public:
     // light must be parallel, split_positions must be initialized
     span<DirectX::XMMATRIX> CalcShadowMatricesWS( const Camera::Data& camera, const Light& light, const span<float>& split_positions, span<DirectX::XMMATRIX> matrices_storage ) const;
 
+    // Batched shadow caster selection, FindPSSMFrustumsForItem for every cascade of every light at once.
+    // Bounding spheres are SoA in world space, camera_pos is the origin of the split positions
+    struct BoundingSpheresSoA
+    {
+        const float* x = nullptr;
+        const float* y = nullptr;
+        const float* z = nullptr;
+        const float* radius = nullptr;
+        size_t count = 0;
+    };
+
+    struct CascadeCullingLight
+    {
+        DirectX::XMFLOAT3 dir; // normalized
+        span<const float> split_positions; // sorted, split_positions.size() + 1 cascades
+    };
+
+    // Cascades of a light take split_positions.size() + 1 consecutive bits of the mask, lights follow each other in order, 32 cascades max.
+    // cascade_masks must have space for spheres.count masks. Spheres are tested 4 at a time against the cylinders around the light axes
+    static void CalcCascadeMasks( const DirectX::XMFLOAT3& camera_pos, const BoundingSpheresSoA& spheres,
+                                  const span<const CascadeCullingLight>& lights, const span<uint32_t>& cascade_masks ) noexcept;
+
     // settings
     void SetUniformFactor( float uniform_factor ) noexcept;
     float GetUniformFactor() const noexcept { return m_uniform_factor; }
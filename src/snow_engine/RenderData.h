@@ -86,6 +86,11 @@ struct GPUObjectConstants
     DirectX::XMFLOAT4X4 model_inv_transpose;
 };
 
+// per object constant buffer of a batch is an array of GPUObjectConstants indexed by SV_InstanceID,
+// 64KB constant buffer limit. Must match MAX_INSTANCES_PER_BATCH in object_cb.hlsli
+constexpr uint32_t MAX_INSTANCES_PER_BATCH = 512;
+static_assert( sizeof( GPUObjectConstants ) * MAX_INSTANCES_PER_BATCH <= D3D12_REQ_CONSTANT_BUFFER_ELEMENT_COUNT * 16 );
+
 struct MaterialConstants
 {
     DirectX::XMFLOAT4X4 mat_transform;
@@ -0,0 +1,155 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+#include "stdafx.h"
+
+#include "RenderItemSorting.h"
+
+namespace
+{
+    constexpr uint64_t FieldMask( uint32_t bits ) { return ( uint64_t( 1 ) << bits ) - 1; }
+
+    constexpr uint32_t DepthShift = 0;
+    constexpr uint32_t MeshShift = DepthShift + RenderSortKey::DepthBits;
+    constexpr uint32_t MaterialShift = MeshShift + RenderSortKey::MeshBits;
+    constexpr uint32_t PSOShift = MaterialShift + RenderSortKey::MaterialBits;
+    constexpr uint32_t PassShift = PSOShift + RenderSortKey::PSOBits;
+    static_assert( PassShift + RenderSortKey::PassBits == 64 );
+}
+
+
+uint64_t RenderSortKey::Encode() const noexcept
+{
+    return ( ( pass & FieldMask( PassBits ) ) << PassShift )
+        | ( ( pso & FieldMask( PSOBits ) ) << PSOShift )
+        | ( ( material & FieldMask( MaterialBits ) ) << MaterialShift )
+        | ( ( mesh & FieldMask( MeshBits ) ) << MeshShift )
+        | ( ( depth & FieldMask( DepthBits ) ) << DepthShift );
+}
+
+
+RenderSortKey RenderSortKey::Decode( uint64_t key ) noexcept
+{
+    RenderSortKey res;
+    res.pass = uint32_t( ( key >> PassShift ) & FieldMask( PassBits ) );
+    res.pso = uint32_t( ( key >> PSOShift ) & FieldMask( PSOBits ) );
+    res.material = uint32_t( ( key >> MaterialShift ) & FieldMask( MaterialBits ) );
+    res.mesh = uint32_t( ( key >> MeshShift ) & FieldMask( MeshBits ) );
+    res.depth = uint32_t( ( key >> DepthShift ) & FieldMask( DepthBits ) );
+    return res;
+}
+
+
+uint32_t RenderSortKey::QuantizeDepth( float view_depth ) noexcept
+{
+    // bit patterns of non-negative floats are ordered like the floats themselves.
+    // The sign bit is always 0 here, take the next 16 bits: 8 bits of exponent and 8 bits of mantissa
+    if ( !( view_depth > 0.0f ) )
+        return 0;
+
+    uint32_t bits;
+    memcpy( &bits, &view_depth, sizeof( bits ) );
+    return bits >> ( 31 - DepthBits );
+}
+
+
+void RadixSortKeys( const span<uint64_t>& keys, const span<uint32_t>& payload,
+                    const span<uint64_t>& keys_scratch, const span<uint32_t>& payload_scratch ) noexcept
+{
+    const size_t n = keys.size();
+    assert( payload.size() == n );
+    assert( keys_scratch.size() >= n && payload_scratch.size() >= n );
+
+    if ( n < 2 )
+        return;
+
+    // histograms of all 8 digits in a single pass
+    constexpr size_t NumDigits = sizeof( uint64_t );
+    uint32_t histograms[NumDigits][256] = {};
+    for ( size_t i = 0; i < n; ++i )
+    {
+        const uint64_t key = keys[i];
+        for ( size_t digit = 0; digit < NumDigits; ++digit )
+            histograms[digit][( key >> ( digit * 8 ) ) & 0xff]++;
+    }
+
+    uint64_t* src_keys = keys.begin();
+    uint32_t* src_payload = payload.begin();
+    uint64_t* dst_keys = keys_scratch.begin();
+    uint32_t* dst_payload = payload_scratch.begin();
+
+    for ( size_t digit = 0; digit < NumDigits; ++digit )
+    {
+        uint32_t* histogram = histograms[digit];
+        const uint32_t shift = uint32_t( digit * 8 );
+
+        // every key has the same byte here, the pass wouldn't change the order
+        if ( histogram[( src_keys[0] >> shift ) & 0xff] == n )
+            continue;
+
+        uint32_t offset = 0;
+        for ( size_t bucket = 0; bucket < 256; ++bucket )
+        {
+            const uint32_t count = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += count;
+        }
+
+        for ( size_t i = 0; i < n; ++i )
+        {
+            const uint32_t dst = histogram[( src_keys[i] >> shift ) & 0xff]++;
+            dst_keys[dst] = src_keys[i];
+            dst_payload[dst] = src_payload[i];
+        }
+
+        std::swap( src_keys, dst_keys );
+        std::swap( src_payload, dst_payload );
+    }
+
+    if ( src_keys != keys.begin() )
+    {
+        std::copy( src_keys, src_keys + n, keys.begin() );
+        std::copy( src_payload, src_payload + n, payload.begin() );
+    }
+}
+
+
+bool CanBatchRenderItems( const RenderItem& lhs, const RenderItem& rhs ) noexcept
+{
+    return lhs.material == rhs.material
+        && lhs.item_id == rhs.item_id
+        && lhs.vbv.BufferLocation == rhs.vbv.BufferLocation
+        && lhs.vbv.SizeInBytes == rhs.vbv.SizeInBytes
+        && lhs.vbv.StrideInBytes == rhs.vbv.StrideInBytes
+        && lhs.ibv.BufferLocation == rhs.ibv.BufferLocation
+        && lhs.ibv.SizeInBytes == rhs.ibv.SizeInBytes
+        && lhs.ibv.Format == rhs.ibv.Format
+        && lhs.index_count == rhs.index_count
+        && lhs.index_offset == rhs.index_offset
+        && lhs.vertex_offset == rhs.vertex_offset;
+}
+
+
+void BatchRenderItems( const span<const RenderItem>& sorted_items, uint32_t max_instances, std::vector<RenderItemBatchRange>& batches )
+{
+    assert( max_instances > 0 );
+
+    batches.clear();
+    if ( sorted_items.size() == 0 )
+        return;
+
+    RenderItemBatchRange current;
+    current.count = 1;
+    for ( uint32_t i = 1; i < uint32_t( sorted_items.size() ); ++i )
+    {
+        if ( current.count < max_instances && CanBatchRenderItems( sorted_items[current.first], sorted_items[i] ) )
+        {
+            current.count++;
+            continue;
+        }
+
+        batches.push_back( current );
+        current.first = i;
+        current.count = 1;
+    }
+    batches.push_back( current );
+}
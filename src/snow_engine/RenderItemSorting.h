@@ -0,0 +1,49 @@
+#pragma once
+
+#include "RenderData.h"
+
+#include "utils/span.h"
+
+// 64 bit sort keys for render items, from the most significant bits:
+// pass (4) | pso (12) | material (16) | mesh (16) | depth (16)
+// Sorting by the key groups items by state first, items of the same material and mesh end up next to each other, closer ones first.
+// Ids wider than their fields are truncated. It only makes the order less coherent, batching compares the actual draw arguments
+struct RenderSortKey
+{
+    static constexpr uint32_t PassBits = 4;
+    static constexpr uint32_t PSOBits = 12;
+    static constexpr uint32_t MaterialBits = 16;
+    static constexpr uint32_t MeshBits = 16;
+    static constexpr uint32_t DepthBits = 16;
+
+    uint32_t pass = 0; // layer inside a render list, e.g. opaque, alpha tested
+    uint32_t pso = 0;
+    uint32_t material = 0;
+    uint32_t mesh = 0;
+    uint32_t depth = 0; // see QuantizeDepth
+
+    uint64_t Encode() const noexcept;
+    static RenderSortKey Decode( uint64_t key ) noexcept;
+
+    // Monotonic for view_depth >= 0, negative depth goes to 0. Keeps the upper bits of the float,
+    // so the precision is relative to the distance and no depth range is needed
+    static uint32_t QuantizeDepth( float view_depth ) noexcept;
+};
+
+// Stable LSD radix sort of the keys together with their payload, 8 bits per pass.
+// Passes over bytes that are the same for all keys are skipped. Scratch spans must be as large as keys
+void RadixSortKeys( const span<uint64_t>& keys, const span<uint32_t>& payload,
+                    const span<uint64_t>& keys_scratch, const span<uint32_t>& payload_scratch ) noexcept;
+
+// run of sorted items drawn with a single instanced call
+struct RenderItemBatchRange
+{
+    uint32_t first = 0;
+    uint32_t count = 0;
+};
+
+// items with the same material, geometry and draw arguments can share a draw
+bool CanBatchRenderItems( const RenderItem& lhs, const RenderItem& rhs ) noexcept;
+
+// Merges adjacent items into instanced batches of at most max_instances items. Sort the items by RenderSortKey first
+void BatchRenderItems( const span<const RenderItem>& sorted_items, uint32_t max_instances, std::vector<RenderItemBatchRange>& batches );
@@ -4,6 +4,8 @@
 
 #include "Renderer.h"
 
+#include "RenderItemSorting.h"
+
 #include "resources/GPUDevice.h"
 
 Renderer Renderer::Create( const DeviceContext& ctx, uint32_t width, uint32_t height )
@@ -545,10 +547,16 @@ Renderer::RenderBatchList Renderer::CreateRenderitems( const span<const RenderIt
     if ( render_list.size() == 0 )
         return items;
 
-    items.batches.reserve( render_list.size() );
+    // adjacent items with the same mesh and material become a single instanced draw
+    std::vector<RenderItemBatchRange> ranges;
+    BatchRenderItems( render_list, MAX_INSTANCES_PER_BATCH, ranges );
+
+    items.batches.reserve( ranges.size() );
 
-    constexpr UINT obj_cb_stride = Utils::CalcConstantBufferByteSize( sizeof( GPUObjectConstants ) ) ;
-    const uint64_t buffer_size = obj_cb_stride * render_list.size();
+    // instance constants of a batch are tightly packed, every batch starts at a constant buffer boundary
+    uint64_t buffer_size = 0;
+    for ( const RenderItemBatchRange& range : ranges )
+        buffer_size += Utils::CalcConstantBufferByteSize( UINT( sizeof( GPUObjectConstants ) * range.count ) );
 
     auto gpu_allocation = frame_allocator.Alloc( buffer_size );
 
@@ -563,24 +571,30 @@ Renderer::RenderBatchList Renderer::CreateRenderitems( const span<const RenderIt
 
     D3D12_GPU_VIRTUAL_ADDRESS gpu_addr = items.per_obj_cb->GetGPUVirtualAddress();
 
-    for ( const auto& item : render_list )
+    for ( const RenderItemBatchRange& range : ranges )
     {
-        GPUObjectConstants obj_cb;
-        MakeObjectCB( DirectX::XMLoadFloat4x4( &item.local2world ), obj_cb );
-        memcpy( mapped_cb, &obj_cb, sizeof( obj_cb ) );
+        for ( uint32_t i = 0; i < range.count; ++i )
+        {
+            GPUObjectConstants obj_cb;
+            MakeObjectCB( DirectX::XMLoadFloat4x4( &render_list[range.first + i].local2world ), obj_cb );
+            memcpy( mapped_cb + sizeof( obj_cb ) * i, &obj_cb, sizeof( obj_cb ) );
+        }
+
+        const auto& item = render_list[range.first];
 
         items.batches.emplace_back();
         auto& batch = items.batches.back();
         
+        const UINT batch_cb_size = Utils::CalcConstantBufferByteSize( UINT( sizeof( GPUObjectConstants ) * range.count ) );
         batch.per_object_cb = gpu_addr;
-        gpu_addr += obj_cb_stride;
-        mapped_cb += obj_cb_stride;
+        gpu_addr += batch_cb_size;
+        mapped_cb += batch_cb_size;
 
         batch.item_id = item.item_id;
         batch.vbv = item.vbv;
         batch.ibv = item.ibv;
         batch.material = item.material;
-        batch.instance_count = 1;
+        batch.instance_count = range.count;
         batch.index_count = item.index_count;
         batch.index_offset = item.index_offset;
         batch.vertex_offset = item.vertex_offset;
@@ -13,6 +13,18 @@ void StaticMesh::SubscribeToLoad( const std::function<void()>& callback )
     m_loaded_callbacks.emplace_back( callback );
 }
 
+void StaticMesh::BuildCPUBVH()
+{
+    if ( m_vertices.empty() )
+    {
+        m_cpu_bvh.Clear();
+        return;
+    }
+
+    m_cpu_bvh.Build( &m_vertices.data()->pos, uint32_t( m_vertices.size() ), sizeof( Vertex ),
+                     m_indices.data(), uint32_t( m_indices.size() ) );
+}
+
 void StaticMesh::OnLoaded()
 {
     if ( !SE_ENSURE( m_is_loaded ) )
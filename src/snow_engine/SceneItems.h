@@ -10,6 +10,7 @@
 #include "resources/Mesh.h"
 
 #include "utils/packed_freelist.h"
+#include "utils/BVH.h"
 
 class Scene;
 
@@ -72,6 +73,10 @@ public:
     D3D_PRIMITIVE_TOPOLOGY Topology() const noexcept { return m_topology; }
     D3D_PRIMITIVE_TOPOLOGY& Topology() noexcept { return m_topology; }
 
+    // CPU ray queries. Built from Vertices() and Indices() by BuildCPUBVH
+    const MeshBVH& CPUBVH() const noexcept { return m_cpu_bvh; }
+    void BuildCPUBVH();
+
     bool IsLoaded() const noexcept { return m_is_loaded; }
     void Load( const D3D12_VERTEX_BUFFER_VIEW& vbv, const D3D12_INDEX_BUFFER_VIEW& ibvy ) noexcept;
 
@@ -85,6 +90,7 @@ private:
 
     std::vector<Vertex> m_vertices;
     std::vector<uint32_t> m_indices;
+    MeshBVH m_cpu_bvh;
 
     D3D12_VERTEX_BUFFER_VIEW m_vbv;
     D3D12_INDEX_BUFFER_VIEW m_ibv;
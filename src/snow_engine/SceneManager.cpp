@@ -21,6 +21,7 @@ StaticMeshID SceneClientView::LoadStaticMesh( std::string name, std::vector<Vert
     mesh->Vertices() = std::move( vertices );
     mesh->Indices() = std::move( indices );
     mesh->Topology() = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+    mesh->BuildCPUBVH();
     return mesh_id;
 }
 
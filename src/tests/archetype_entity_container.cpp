@@ -0,0 +1,280 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <boost/test/unit_test.hpp>
+
+#include <ecs/ArchetypeEntityContainer.h>
+#include <ecs/EntityContainer.h>
+
+#include <chrono>
+#include <map>
+#include <random>
+
+
+BOOST_AUTO_TEST_SUITE( archetype_entity_container )
+
+struct Float3
+{
+    float x, y, z;
+};
+
+struct Position
+{
+    Float3 v;
+};
+
+struct Velocity
+{
+    Float3 v;
+};
+
+struct Acceleration
+{
+    Float3 v;
+};
+
+struct Name
+{
+    std::string name;
+};
+
+BOOST_AUTO_TEST_CASE( creation )
+{
+    ArchetypeEntityContainer<Position, Velocity> world;
+    using Entity = decltype( world )::Entity;
+    Entity test_obj = world.CreateEntity();
+
+    BOOST_TEST( world.GetEntityCount() == 1 );
+
+    auto& pos = world.AddComponent<Position>( test_obj, Position{ Float3{ 1, 2, 3 } } );
+    BOOST_TEST( ( ( pos.v.x == 1.0f ) && ( pos.v.y == 2.0f ) && ( pos.v.z == 3.0f ) ) );
+}
+
+BOOST_AUTO_TEST_CASE( find_component )
+{
+    ArchetypeEntityContainer<Position, Velocity> world;
+    using Entity = decltype( world )::Entity;
+
+    Entity o1 = world.CreateEntity();
+    Entity o2 = world.CreateEntity();
+
+    BOOST_TEST( world.GetComponent<Position>( o2 ) == nullptr );
+
+    world.AddComponent<Position>( o2, Position{ Float3{ 1, 2, 3 } } );
+    world.AddComponent<Velocity>( o2, Velocity{ Float3{ 4, 5, 6 } } );
+
+    Position* pos_comp = world.GetComponent<Position>( o2 );
+    BOOST_TEST( pos_comp != nullptr );
+    BOOST_TEST( ( ( pos_comp->v.x == 1.0f ) && ( pos_comp->v.y == 2.0f ) && ( pos_comp->v.z == 3.0f ) ) );
+
+    BOOST_TEST( world.GetComponent<Position>( o1 ) == nullptr );
+    BOOST_TEST( world.GetArchetypeCount() == 3 );
+}
+
+BOOST_AUTO_TEST_CASE( replace_component )
+{
+    ArchetypeEntityContainer<Position, Velocity> world;
+
+    auto o1 = world.CreateEntity();
+    world.AddComponent<Position>( o1, Position{ Float3{ 1, 2, 3 } } );
+    world.AddComponent<Position>( o1, Position{ Float3{ 4, 5, 6 } } );
+
+    BOOST_TEST( world.GetComponent<Position>( o1 )->v.x == 4.0f );
+    BOOST_TEST( world.GetArchetypeCount() == 2 );
+}
+
+BOOST_AUTO_TEST_CASE( remove_component )
+{
+    ArchetypeEntityContainer<Position, Velocity> world;
+    using Entity = decltype( world )::Entity;
+
+    Entity o2 = world.CreateEntity();
+
+    world.AddComponent<Position>( o2, Position{ Float3{ 1, 2, 3 } } );
+    world.AddComponent<Velocity>( o2, Velocity{ Float3{ 4, 5, 6 } } );
+
+    world.RemoveComponent<Position>( o2 );
+    BOOST_TEST( world.GetComponent<Position>( o2 ) == nullptr );
+
+    Velocity* vel_comp = world.GetComponent<Velocity>( o2 );
+    BOOST_TEST_REQUIRE( vel_comp != nullptr );
+    BOOST_TEST( ( ( vel_comp->v.x == 4.0f ) && ( vel_comp->v.y == 5.0f ) && ( vel_comp->v.z == 6.0f ) ) );
+}
+
+BOOST_AUTO_TEST_CASE( remove_multiple_entities )
+{
+    ArchetypeEntityContainer<Position, Name> world;
+    using Entity = decltype( world )::Entity;
+
+    Entity o2 = world.CreateEntity();
+    Entity o3 = world.CreateEntity();
+    Entity o4 = world.CreateEntity();
+
+    world.AddComponent<Name>( o2, Name{ "o2" } );
+    world.AddComponent<Name>( o3, Name{ "o3" } );
+    world.AddComponent<Name>( o4, Name{ "o4" } );
+
+    world.DestroyEntity( o2 );
+    BOOST_TEST( world.GetComponent<Name>( o4 )->name == "o4" );
+
+    world.DestroyEntity( o3 );
+    world.DestroyEntity( o4 );
+    BOOST_TEST( world.GetEntityCount() == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( iterate_over_view )
+{
+    ArchetypeEntityContainer<Position, Velocity> world;
+    using Entity = decltype( world )::Entity;
+
+    Entity o1 = world.CreateEntity();
+    Entity o2 = world.CreateEntity();
+    Entity o3 = world.CreateEntity();
+
+    world.AddComponent<Position>( o2, Position{ Float3{ 1, 2, 3 } } );
+    world.AddComponent<Velocity>( o1, Velocity{ Float3{ 4, 5, 6 } } );
+    world.AddComponent<Position>( o3, Position{ Float3{ 7, 8, 9 } } );
+    world.AddComponent<Velocity>( o3, Velocity{ Float3{ 10, 11, 12 } } );
+
+    int num_visited = 0;
+    for ( auto&& [entity, pos, vel] : world.CreateView<Position, Velocity>() )
+    {
+        BOOST_TEST( ( entity != o1 && entity != o2 ) );
+        pos.v.x += vel.v.x;
+        num_visited++;
+    }
+    BOOST_TEST( num_visited == 1 );
+    BOOST_TEST( world.GetComponent<Position>( o3 )->v.x == 17.0f );
+
+    num_visited = 0;
+    const auto& const_world = world;
+    for ( const auto& [entity, pos] : const_world.CreateView<Position>() )
+        num_visited++;
+    BOOST_TEST( num_visited == 2 );
+}
+
+BOOST_AUTO_TEST_CASE( churn_matches_btree_backend )
+{
+    constexpr int num_entities = 20000;
+    constexpr int num_ops = 100000;
+
+    ArchetypeEntityContainer<Position, Velocity, Name> world;
+    EntityContainer<Position, Velocity, Name> reference_world;
+
+    using Entity = decltype( world )::Entity;
+    using RefEntity = decltype( reference_world )::Entity;
+
+    // entity ids are allocated identically in both containers
+    std::vector<std::pair<Entity, RefEntity>> entities;
+    for ( int i = 0; i < num_entities; ++i )
+        entities.emplace_back( world.CreateEntity(), reference_world.CreateEntity() );
+
+    std::mt19937 rng( 42 );
+    for ( int op = 0; op < num_ops; ++op )
+    {
+        const auto& [entity, ref_entity] = entities[rng() % entities.size()];
+        const float val = float( op );
+        switch ( rng() % 4 )
+        {
+        case 0:
+            world.AddComponent<Position>( entity, Position{ Float3{ val, val, val } } );
+            reference_world.AddComponent<Position>( ref_entity, Position{ Float3{ val, val, val } } );
+            break;
+        case 1:
+            world.AddComponent<Velocity>( entity, Velocity{ Float3{ val, val, val } } );
+            reference_world.AddComponent<Velocity>( ref_entity, Velocity{ Float3{ val, val, val } } );
+            break;
+        case 2:
+            world.AddComponent<Name>( entity, Name{ std::to_string( op ) } );
+            reference_world.AddComponent<Name>( ref_entity, Name{ std::to_string( op ) } );
+            break;
+        case 3:
+            world.RemoveComponent<Position>( entity );
+            reference_world.RemoveComponent<Position>( ref_entity );
+            break;
+        }
+    }
+
+    for ( const auto& [entity, ref_entity] : entities )
+    {
+        const Position* pos = world.GetComponent<Position>( entity );
+        const Position* ref_pos = reference_world.GetComponent<Position>( ref_entity );
+        BOOST_TEST_REQUIRE( ( pos == nullptr ) == ( ref_pos == nullptr ) );
+        if ( pos )
+            BOOST_TEST( pos->v.x == ref_pos->v.x );
+
+        const Name* name = world.GetComponent<Name>( entity );
+        const Name* ref_name = reference_world.GetComponent<Name>( ref_entity );
+        BOOST_TEST_REQUIRE( ( name == nullptr ) == ( ref_name == nullptr ) );
+        if ( name )
+            BOOST_TEST( name->name == ref_name->name );
+    }
+
+    std::map<uint64_t, float> view_contents;
+    for ( auto&& [entity, pos, vel] : world.CreateView<Position, Velocity>() )
+        view_contents[entity.comparator] = pos.v.x + vel.v.x;
+
+    size_t ref_view_size = 0;
+    for ( auto&& [entity, pos, vel] : reference_world.CreateView<Position, Velocity>() )
+    {
+        ref_view_size++;
+        auto it = view_contents.find( entity.comparator );
+        BOOST_TEST_REQUIRE( ( it != view_contents.end() ) );
+        BOOST_TEST( it->second == pos.v.x + vel.v.x );
+    }
+    BOOST_TEST( ref_view_size == view_contents.size() );
+
+    for ( size_t i = 0; i < entities.size(); i += 2 )
+    {
+        world.DestroyEntity( entities[i].first );
+        reference_world.DestroyEntity( entities[i].second );
+    }
+    BOOST_TEST( world.GetEntityCount() == reference_world.GetEntityCount() );
+}
+
+// Run explicitly with --run_test=archetype_entity_container/benchmark_iteration --log_level=message
+BOOST_AUTO_TEST_CASE( benchmark_iteration, * boost::unit_test::disabled() )
+{
+    constexpr int num_entities = 1000000;
+    constexpr int num_iterations = 10;
+    constexpr float time_step = 0.001f;
+
+    auto fill_world = []( auto& world )
+    {
+        for ( int i = 0; i < num_entities; ++i )
+        {
+            auto entity = world.CreateEntity();
+            world.template AddComponent<Position>( entity, Position{ Float3{ float( i ), 0, 0 } } );
+            world.template AddComponent<Velocity>( entity, Velocity{ Float3{ 1, 0, 0 } } );
+            world.template AddComponent<Acceleration>( entity, Acceleration{ Float3{ 1, 0, 0 } } );
+        }
+    };
+
+    auto run_iterations = []( auto& world ) -> double
+    {
+        const auto start = std::chrono::high_resolution_clock::now();
+        for ( int iteration = 0; iteration < num_iterations; ++iteration )
+        {
+            for ( auto&& [entity, pos, vel, acc] : world.template CreateView<Position, Velocity, Acceleration>() )
+            {
+                vel.v.x += acc.v.x * time_step;
+                pos.v.x += vel.v.x * time_step;
+            }
+        }
+        const auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::milli>( end - start ).count() / num_iterations;
+    };
+
+    auto btree_world = std::make_unique<EntityContainer<Position, Velocity, Acceleration>>();
+    fill_world( *btree_world );
+    const double btree_ms = run_iterations( *btree_world );
+    btree_world.reset();
+
+    auto archetype_world = std::make_unique<ArchetypeEntityContainer<Position, Velocity, Acceleration>>();
+    fill_world( *archetype_world );
+    const double archetype_ms = run_iterations( *archetype_world );
+
+    BOOST_TEST_MESSAGE( "1M entities x 3 components, view iteration: btree " << btree_ms << " ms, archetype " << archetype_ms << " ms" );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
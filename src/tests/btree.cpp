@@ -4,8 +4,14 @@
 #include <boost/test/unit_test.hpp>
 
 #include "../src/utils/btree.h"
+#include "../src/utils/packed_freelist.h"
 
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
 #include <random>
+#include <string>
 
 BOOST_AUTO_TEST_SUITE( btree_tests )
 
@@ -293,4 +299,467 @@ BOOST_AUTO_TEST_CASE( stress_test )
 	BOOST_TEST( g_btree.size() == 0 );
 }
 
+template<typename Key>
+void CheckNodeSearch( const std::vector<Key>& sorted_keys, const std::vector<Key>& probes )
+{
+    btree_map_node<Key, int, 16> node;
+    BOOST_REQUIRE( sorted_keys.size() <= 31 );
+    for ( uint32_t num_keys = 0; num_keys <= sorted_keys.size(); ++num_keys )
+    {
+        // fill the whole storage with garbage first, search must ignore keys after num_elems
+        memset( node.key_storage, 0xA5, sizeof( node.key_storage ) );
+        std::uninitialized_copy( sorted_keys.begin(), sorted_keys.begin() + num_keys, node.keys() );
+        node.num_elems = num_keys;
+
+        for ( const Key& probe : probes )
+        {
+            const uint32_t expected = uint32_t( std::lower_bound( sorted_keys.begin(), sorted_keys.begin() + num_keys, probe ) - sorted_keys.begin() );
+            BOOST_TEST( node.lower_bound_pos( probe ) == expected );
+        }
+
+        std::destroy( node.keys(), node.keys() + num_keys );
+    }
+}
+
+template<typename Key>
+void CheckNodeSearchRandom( std::mt19937_64& rng )
+{
+    std::vector<Key> keys;
+    for ( int i = 0; i < 31; ++i )
+        keys.push_back( Key( rng() ) );
+    std::sort( keys.begin(), keys.end() );
+    keys.erase( std::unique( keys.begin(), keys.end() ), keys.end() );
+
+    std::vector<Key> probes = keys;
+    for ( const Key& key : keys )
+    {
+        probes.push_back( key + 1 );
+        probes.push_back( key - 1 );
+    }
+    probes.push_back( std::numeric_limits<Key>::min() );
+    probes.push_back( std::numeric_limits<Key>::max() );
+
+    CheckNodeSearch( keys, probes );
+}
+
+BOOST_AUTO_TEST_CASE( node_search )
+{
+    std::mt19937_64 rng( 12345 );
+    for ( int repeat = 0; repeat < 20; ++repeat )
+    {
+        CheckNodeSearchRandom<int32_t>( rng );
+        CheckNodeSearchRandom<uint32_t>( rng );
+        CheckNodeSearchRandom<int64_t>( rng );
+        CheckNodeSearchRandom<uint64_t>( rng );
+    }
+
+    // keys without an integer representation use the scalar path
+    CheckNodeSearch<std::string>( { "a", "b", "bb", "c", "x" }, { "", "a", "aa", "bc", "x", "z" } );
+    CheckNodeSearch<double>( { -1.5, 0.0, 2.25, 1e10 }, { -2.0, -1.5, 1.0, 1e10, 1e11 } );
+}
+
+BOOST_AUTO_TEST_CASE( cache_line_policy )
+{
+    using int_policy = btree_map_cache_line_policy<int, int>;
+    BOOST_TEST( int_policy::factor * 2 - 1 <= 4 * 64 / sizeof( int ) );
+    BOOST_TEST( int_policy::factor * 2 + 1 > 4 * 64 / sizeof( int ) );
+
+    // huge values are limited by the node size
+    struct Big { char data[1024]; };
+    BOOST_TEST( ( btree_map_cache_line_policy<uint64_t, Big>::factor == 2 ) );
+
+    using node_t = btree_map_node<uint64_t, int, btree_map_cache_line_policy<uint64_t, int>::factor>;
+    BOOST_TEST( alignof( node_t ) == 64 );
+    BOOST_TEST( sizeof( node_t::key_storage ) % 64 == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( compare_with_std_map )
+{
+    // unsigned keys with the high bit set check the biased SIMD comparison
+    btree_map<uint64_t, uint64_t> test_btree;
+    std::map<uint64_t, uint64_t> reference;
+
+    std::mt19937_64 rng( 7 );
+    for ( int i = 0; i < 100000; ++i )
+    {
+        const uint64_t key = rng() % 4096 + ( ( rng() & 1 ) ? 0x8000000000000000ull : 0 );
+        if ( rng() % 3 == 0 )
+        {
+            auto cursor = test_btree.find( key );
+            BOOST_REQUIRE( cursor.valid() == ( reference.count( key ) != 0 ) );
+            if ( cursor.valid() )
+                test_btree.erase( cursor );
+            reference.erase( key );
+        }
+        else
+        {
+            test_btree.insert( key, uint64_t( i ) );
+            reference[key] = uint64_t( i );
+        }
+    }
+
+    BOOST_TEST( test_btree.size() == reference.size() );
+    auto cursor = test_btree.begin();
+    for ( const auto& [key, value] : reference )
+    {
+        BOOST_REQUIRE( cursor.valid() );
+        BOOST_TEST( cursor.key() == key );
+        BOOST_TEST( cursor.value() == value );
+        cursor = test_btree.get_next( cursor );
+    }
+    BOOST_TEST( ! cursor.valid() );
+}
+
+// checks node fill, leaf depth, key order and parent links, returns the number of elements in the subtree
+template<typename Node>
+size_t ValidateSubtree( const Node* node, uint32_t factor, bool is_root, int depth, int& leaf_depth )
+{
+    BOOST_TEST( node->num_elems <= 2 * factor - 1 );
+    if ( ! is_root )
+        BOOST_TEST( node->num_elems >= factor - 1 );
+    for ( uint32_t i = 1; i < node->num_elems; ++i )
+        BOOST_TEST( node->keys()[i - 1] < node->keys()[i] );
+
+    if ( node->is_leaf() )
+    {
+        if ( leaf_depth < 0 )
+            leaf_depth = depth;
+        BOOST_TEST( leaf_depth == depth );
+        return node->num_elems;
+    }
+
+    size_t size = node->num_elems;
+    for ( uint32_t i = 0; i <= node->num_elems; ++i )
+    {
+        const Node* child = node->children[i];
+        BOOST_TEST( child->parent.node == node );
+        BOOST_TEST( child->parent.position == i );
+        if ( i > 0 )
+            BOOST_TEST( node->keys()[i - 1] < child->keys()[0] );
+        if ( i < node->num_elems )
+            BOOST_TEST( child->keys()[child->num_elems - 1] < node->keys()[i] );
+        size += ValidateSubtree( child, factor, false, depth + 1, leaf_depth );
+    }
+    return size;
+}
+
+BOOST_AUTO_TEST_CASE( bulk_operations )
+{
+    constexpr uint32_t factor = 4;
+
+    // keeps track of element positions like the ECS does
+    std::map<int, std::pair<const void*, uint32_t>> positions;
+    auto callback = [&positions]( int key, const auto& new_cursor )
+    {
+        positions[key] = { new_cursor.node, new_cursor.position };
+    };
+    using Btree = btree_map<int, int, factor, std::allocator<btree_map_node<int, int, factor>>, decltype( callback )>;
+
+    auto check = [&]( const Btree& test_btree, const std::map<int, int>& reference )
+    {
+        BOOST_TEST_REQUIRE( test_btree.size() == reference.size() );
+
+        auto cursor = test_btree.begin();
+        for ( const auto& [key, value] : reference )
+        {
+            BOOST_TEST_REQUIRE( cursor.valid() );
+            BOOST_TEST( cursor.key() == key );
+            BOOST_TEST( cursor.value() == value );
+            BOOST_TEST( ( positions[key] == std::pair<const void*, uint32_t>( cursor.node, cursor.position ) ) );
+            cursor = test_btree.get_next( cursor );
+        }
+        BOOST_TEST( ! cursor.valid() );
+
+        if ( reference.empty() )
+            return;
+
+        auto* root = test_btree.begin().node;
+        while ( root->parent.node )
+            root = root->parent.node;
+        int leaf_depth = -1;
+        BOOST_TEST( ValidateSubtree( root, factor, true, 0, leaf_depth ) == reference.size() );
+    };
+
+    std::mt19937 rng( 3 );
+    for ( int num_elems : { 0, 1, 2, 7, 8, 9, 63, 64, 65, 100, 1000, 12345 } )
+    {
+        for ( int repeat = 0; repeat < 3; ++repeat )
+        {
+            positions.clear();
+            std::map<int, int> reference;
+            while ( int( reference.size() ) < num_elems )
+                reference[int( rng() % ( 4 * num_elems ) )] = int( rng() );
+
+            Btree test_btree( callback );
+
+            // bulk load into an empty tree
+            std::vector<std::pair<int, int>> elems( reference.begin(), reference.end() );
+            test_btree.bulk_insert_sorted( elems.begin(), elems.end() );
+            check( test_btree, reference );
+
+            // the tree stays valid for regular operations
+            for ( int i = 0; i < num_elems / 2; ++i )
+            {
+                const int key = int( rng() % ( 4 * num_elems + 1 ) );
+                if ( rng() % 2 )
+                {
+                    // the callback is not called for the inserted element itself
+                    auto cursor = test_btree.insert( key, i );
+                    positions[key] = { cursor.node, cursor.position };
+                    reference[key] = i;
+                }
+                else if ( auto cursor = test_btree.find( key ); cursor.valid() )
+                {
+                    test_btree.erase( cursor );
+                    reference.erase( key );
+                }
+            }
+            check( test_btree, reference );
+
+            // merge into a non-empty tree, new values replace the old ones
+            std::vector<std::pair<int, int>> more_elems;
+            for ( int key = 0; key < 4 * num_elems; key += 5 )
+                more_elems.emplace_back( key, -key );
+            test_btree.bulk_insert_sorted( std::make_move_iterator( more_elems.begin() ), std::make_move_iterator( more_elems.end() ) );
+            for ( const auto& [key, value] : more_elems )
+                reference[key] = value;
+            check( test_btree, reference );
+
+            // erase_if, both a few elements and most of them
+            for ( int divisor : { 97, 3 } )
+            {
+                auto pred = [divisor]( int key, int value ) { return key % divisor == 1; };
+                size_t expected_erased = 0;
+                for ( auto it = reference.begin(); it != reference.end(); )
+                {
+                    if ( pred( it->first, it->second ) )
+                    {
+                        it = reference.erase( it );
+                        expected_erased++;
+                    }
+                    else
+                    {
+                        ++it;
+                    }
+                }
+                BOOST_TEST( test_btree.erase_if( pred ) == expected_erased );
+                check( test_btree, reference );
+            }
+
+            // erase_range, a short range and a long one
+            for ( auto [first_key, last_key] : { std::pair( num_elems, num_elems + 3 ), std::pair( num_elems / 3, 3 * num_elems ) } )
+            {
+                const size_t expected_erased = std::distance( reference.lower_bound( first_key ), reference.lower_bound( last_key ) );
+                reference.erase( reference.lower_bound( first_key ), reference.lower_bound( last_key ) );
+                BOOST_TEST( test_btree.erase_range( first_key, last_key ) == expected_erased );
+                check( test_btree, reference );
+            }
+
+            BOOST_TEST( test_btree.erase_range( 10, 10 ) == 0 );
+            test_btree.erase_if( []( int, int ) { return true; } );
+            reference.clear();
+            check( test_btree, reference );
+        }
+    }
+}
+
+namespace
+{
+    template<uint32_t F>
+    void CheckDenseEraseRange( std::mt19937& rng )
+    {
+        for ( int num_elems : { 10, 100, 1000, 5000 } )
+        {
+            btree_map<int, int, F> test_btree;
+            std::map<int, int> reference;
+            for ( int key = 0; key < num_elems; ++key )
+            {
+                test_btree.insert( key, -key );
+                reference[key] = -key;
+            }
+
+            // short ranges go through the element by element path, long ones rebuild the tree
+            for ( int i = 0; i < 40 && ! reference.empty(); ++i )
+            {
+                const int first_key = int( rng() % ( num_elems + 2 ) );
+                const int max_length = ( i % 2 ) ? 4 : num_elems / 4 + 2;
+                const int last_key = first_key + int( rng() % max_length );
+
+                const size_t expected_erased = std::distance( reference.lower_bound( first_key ), reference.lower_bound( last_key ) );
+                reference.erase( reference.lower_bound( first_key ), reference.lower_bound( last_key ) );
+                BOOST_TEST( test_btree.erase_range( first_key, last_key ) == expected_erased );
+
+                BOOST_TEST_REQUIRE( test_btree.size() == reference.size() );
+                auto cursor = test_btree.begin();
+                for ( const auto& [key, value] : reference )
+                {
+                    BOOST_TEST_REQUIRE( cursor.valid() );
+                    BOOST_TEST_REQUIRE( cursor.key() == key );
+                    BOOST_TEST( cursor.value() == value );
+                    cursor = test_btree.get_next( cursor );
+                }
+                BOOST_TEST( ! cursor.valid() );
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( erase_range_dense_keys )
+{
+    // with consecutive keys erasing an inner element pulls its successor into the same slot
+    std::mt19937 rng( 5 );
+    CheckDenseEraseRange<3>( rng );
+    CheckDenseEraseRange<4>( rng );
+    CheckDenseEraseRange<5>( rng );
+    CheckDenseEraseRange<16>( rng );
+}
+
+namespace
+{
+    template<typename Map>
+    struct MapBenchmarkOps;
+
+    template<typename Key, typename T, uint32_t F>
+    struct MapBenchmarkOps<btree_map<Key, T, F>>
+    {
+        static void insert( btree_map<Key, T, F>& map, Key key, T value ) { map.insert( key, value ); }
+        static bool find( const btree_map<Key, T, F>& map, Key key ) { return map.find( key ).valid(); }
+        static void erase( btree_map<Key, T, F>& map, Key key ) { map.erase( map.find( key ) ); }
+        static T sum( const btree_map<Key, T, F>& map )
+        {
+            T res = 0;
+            for ( auto cursor = map.begin(); cursor.valid(); cursor = map.get_next( cursor ) )
+                res += cursor.value();
+            return res;
+        }
+    };
+
+    template<typename Key, typename T>
+    struct MapBenchmarkOps<std::map<Key, T>>
+    {
+        static void insert( std::map<Key, T>& map, Key key, T value ) { map[key] = value; }
+        static bool find( const std::map<Key, T>& map, Key key ) { return map.find( key ) != map.end(); }
+        static void erase( std::map<Key, T>& map, Key key ) { map.erase( key ); }
+        static T sum( const std::map<Key, T>& map )
+        {
+            T res = 0;
+            for ( const auto& [key, value] : map )
+                res += value;
+            return res;
+        }
+    };
+
+    template<typename Map>
+    void RunMapBenchmark( const char* name, const std::vector<uint64_t>& keys, const std::vector<uint64_t>& lookups )
+    {
+        using ops = MapBenchmarkOps<Map>;
+        using clock = std::chrono::high_resolution_clock;
+        auto ms_since = []( clock::time_point start ) { return std::chrono::duration<double, std::milli>( clock::now() - start ).count(); };
+
+        auto map = std::make_unique<Map>();
+
+        auto start = clock::now();
+        for ( uint64_t key : keys )
+            ops::insert( *map, key, key );
+        const double insert_ms = ms_since( start );
+
+        start = clock::now();
+        size_t num_found = 0;
+        for ( uint64_t key : lookups )
+            num_found += ops::find( *map, key );
+        const double find_ms = ms_since( start );
+
+        start = clock::now();
+        const uint64_t sum = ops::sum( *map );
+        const double iterate_ms = ms_since( start );
+
+        start = clock::now();
+        for ( uint64_t key : keys )
+            ops::erase( *map, key );
+        const double erase_ms = ms_since( start );
+
+        BOOST_TEST_MESSAGE( name << ": insert " << insert_ms << " ms, find " << find_ms << " ms, iterate " << iterate_ms
+                            << " ms, erase " << erase_ms << " ms (found " << num_found << ", sum " << sum << ")" );
+    }
+}
+
+// Run explicitly with --run_test=btree_tests/benchmark_operations --log_level=message
+BOOST_AUTO_TEST_CASE( benchmark_operations, * boost::unit_test::disabled() )
+{
+    for ( size_t num_keys : { 1000, 100000, 10000000 } )
+    {
+        std::mt19937_64 rng( 1 );
+        std::vector<uint64_t> keys( num_keys );
+        for ( uint64_t& key : keys )
+            key = rng();
+
+        // the same number of lookups for every size, half of them are misses
+        std::vector<uint64_t> lookups( 10000000 );
+        for ( size_t i = 0; i < lookups.size(); ++i )
+            lookups[i] = ( i % 2 ) ? keys[rng() % num_keys] : rng();
+
+        BOOST_TEST_MESSAGE( num_keys << " keys:" );
+        RunMapBenchmark<btree_map<uint64_t, uint64_t, 10>>( "  btree_map F=10", keys, lookups );
+        RunMapBenchmark<btree_map<uint64_t, uint64_t>>( "  btree_map cache line policy", keys, lookups );
+        RunMapBenchmark<std::map<uint64_t, uint64_t>>( "  std::map", keys, lookups );
+    }
+}
+
+// Run explicitly with --run_test=btree_tests/benchmark_bulk_load --log_level=message
+BOOST_AUTO_TEST_CASE( benchmark_bulk_load, * boost::unit_test::disabled() )
+{
+    constexpr uint32_t num_entities = 500000;
+
+    // mimics an ECS component btree: entity keys, a transform-sized component, a callback that stores cursors
+    using Entity = packed_freelist<int>::id;
+    struct Transform { float m[16]; };
+    using Node = btree_map_node<Entity, Transform, btree_map_cache_line_policy<Entity, Transform>::factor>;
+
+    std::vector<std::pair<const void*, uint32_t>> cursors( num_entities );
+    auto callback = [&cursors]( const Entity& entity, const auto& new_cursor )
+    {
+        cursors[entity.idx] = { new_cursor.node, new_cursor.position };
+    };
+    using Btree = btree_map<Entity, Transform, btree_map_cache_line_policy<Entity, Transform>::factor, std::allocator<Node>, decltype( callback )>;
+
+    std::vector<std::pair<Entity, Transform>> components( num_entities );
+    for ( uint32_t i = 0; i < num_entities; ++i )
+    {
+        components[i].first.idx = i;
+        components[i].first.inner_id = 0;
+        components[i].second.m[0] = float( i );
+    }
+
+    using clock = std::chrono::high_resolution_clock;
+    auto ms_since = []( clock::time_point start ) { return std::chrono::duration<double, std::milli>( clock::now() - start ).count(); };
+
+    auto per_element = std::make_unique<Btree>( callback );
+    auto start = clock::now();
+    for ( const auto& [entity, transform] : components )
+    {
+        auto cursor = per_element->emplace( entity, transform );
+        cursors[entity.idx] = { cursor.node, cursor.position };
+    }
+    const double emplace_ms = ms_since( start );
+
+    auto bulk = std::make_unique<Btree>( callback );
+    start = clock::now();
+    bulk->bulk_insert_sorted( components.begin(), components.end() );
+    const double bulk_insert_ms = ms_since( start );
+
+    // destroy every other entity
+    start = clock::now();
+    for ( uint32_t i = 0; i < num_entities; i += 2 )
+        per_element->erase( per_element->find( components[i].first ) );
+    const double erase_ms = ms_since( start );
+
+    start = clock::now();
+    bulk->erase_if( []( const Entity& entity, const Transform& ) { return entity.idx % 2 == 0; } );
+    const double erase_if_ms = ms_since( start );
+
+    BOOST_TEST( per_element->size() == bulk->size() );
+    BOOST_TEST_MESSAGE( num_entities << " entities: emplace " << emplace_ms << " ms, bulk_insert_sorted " << bulk_insert_ms << " ms" );
+    BOOST_TEST_MESSAGE( "destroy half: erase " << erase_ms << " ms, erase_if " << erase_if_ms << " ms" );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -0,0 +1,220 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <boost/test/unit_test.hpp>
+
+#include "../src/utils/concurrent_packed_freelist.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE( concurrent_packed_freelist_tests )
+
+BOOST_AUTO_TEST_CASE( staged_changes )
+{
+	concurrent_packed_freelist<int> lst;
+
+	using id = decltype( lst )::id;
+
+	id id3 = lst.insert( 3 );
+	id id2 = lst.emplace( 2 );
+
+	// nothing is visible before commit
+	BOOST_TEST( ! lst.has( id3 ) );
+	BOOST_TEST( lst.size() == 0 );
+
+	lst.commit();
+	BOOST_TEST( lst[id3] == 3 );
+	BOOST_TEST( lst[id2] == 2 );
+	BOOST_TEST( lst.size() == 2 );
+
+	lst.erase( id2 );
+	BOOST_TEST( lst.has( id2 ) );
+	lst.commit();
+	BOOST_TEST( ! lst.has( id2 ) );
+	BOOST_TEST( lst.try_get( id2 ) == nullptr );
+	BOOST_TEST( lst.has( id3 ) );
+
+	// the slot is reused, but the old id stays invalid
+	id id5 = lst.insert( 5 );
+	BOOST_TEST( id5.idx == id2.idx );
+	lst.commit();
+	BOOST_TEST( lst[id5] == 5 );
+	BOOST_TEST( ! lst.has( id2 ) );
+
+	// inserted and erased before the same commit
+	id id6 = lst.insert( 6 );
+	lst.erase( id6 );
+	lst.erase( id6 );
+	lst.commit();
+	BOOST_TEST( ! lst.has( id6 ) );
+	BOOST_TEST( lst.size() == 2 );
+
+	int sum = 0;
+	for ( int elem : lst )
+		sum += elem;
+	BOOST_TEST( sum == 8 );
+}
+
+BOOST_AUTO_TEST_CASE( stress_test )
+{
+	// writers insert and erase, readers look up committed elements at the same time
+	constexpr int num_writers = 4;
+	constexpr int num_readers = 2;
+	constexpr int num_frames = 20;
+	constexpr int inserts_per_frame = 500;
+
+	concurrent_packed_freelist<uint64_t> lst;
+	using id = decltype( lst )::id;
+
+	std::map<uint64_t, uint64_t> alive; // id comparator -> value
+	std::vector<id> committed_ids;
+
+	// Boost.Test assertions are not thread-safe, reader threads only count failures
+	std::atomic<int> read_failures = 0;
+
+	std::mt19937 rng( 5 );
+	for ( int frame = 0; frame < num_frames; ++frame )
+	{
+		// each writer erases its own part of the committed ids
+		std::vector<std::vector<id>> inserted( num_writers );
+		std::vector<std::vector<id>> to_erase( num_writers );
+		for ( id elem_id : committed_ids )
+			if ( rng() % 3 == 0 )
+				to_erase[rng() % num_writers].push_back( elem_id );
+
+		std::vector<std::thread> threads;
+		for ( int writer = 0; writer < num_writers; ++writer )
+		{
+			threads.emplace_back( [&, writer]()
+			{
+				for ( int i = 0; i < inserts_per_frame; ++i )
+				{
+					const uint64_t value = uint64_t( frame ) << 32 | uint64_t( writer ) << 16 | uint64_t( i );
+					inserted[writer].push_back( lst.insert( value ) );
+					if ( i % 10 == 0 )
+						lst.erase( inserted[writer].back() );
+				}
+				for ( id elem_id : to_erase[writer] )
+					lst.erase( elem_id );
+			} );
+		}
+		for ( int reader = 0; reader < num_readers; ++reader )
+		{
+			threads.emplace_back( [&]()
+			{
+				for ( id elem_id : committed_ids )
+				{
+					const uint64_t* value = lst.try_get( elem_id );
+					if ( value == nullptr || *value != alive.at( elem_id.comparator ) )
+						read_failures++;
+				}
+			} );
+		}
+		for ( auto& thread : threads )
+			thread.join();
+
+		BOOST_TEST( read_failures == 0 );
+
+		lst.commit();
+
+		for ( int writer = 0; writer < num_writers; ++writer )
+		{
+			for ( int i = 0; i < inserts_per_frame; ++i )
+				if ( i % 10 != 0 )
+					alive[inserted[writer][i].comparator] = uint64_t( frame ) << 32 | uint64_t( writer ) << 16 | uint64_t( i );
+			for ( id elem_id : to_erase[writer] )
+				alive.erase( elem_id.comparator );
+		}
+
+		// all ids handed out in one frame are unique
+		std::vector<uint64_t> frame_ids;
+		for ( const auto& writer_ids : inserted )
+			for ( id elem_id : writer_ids )
+				frame_ids.push_back( elem_id.comparator );
+		std::sort( frame_ids.begin(), frame_ids.end() );
+		BOOST_TEST( ( std::adjacent_find( frame_ids.begin(), frame_ids.end() ) == frame_ids.end() ) );
+
+		BOOST_TEST( lst.size() == alive.size() );
+		committed_ids.clear();
+		for ( const auto& writer_ids : inserted )
+			for ( id elem_id : writer_ids )
+				BOOST_TEST( lst.has( elem_id ) == ( alive.count( elem_id.comparator ) != 0 ) );
+		for ( const auto& writer_ids : to_erase )
+			for ( id elem_id : writer_ids )
+				BOOST_TEST( ! lst.has( elem_id ) );
+
+		for ( const auto& [comparator, value] : alive )
+		{
+			id elem_id;
+			elem_id.comparator = comparator;
+			BOOST_TEST( lst[elem_id] == value );
+			committed_ids.push_back( elem_id );
+		}
+	}
+}
+
+// Run explicitly with --run_test=concurrent_packed_freelist_tests/benchmark_insert_throughput --log_level=message
+BOOST_AUTO_TEST_CASE( benchmark_insert_throughput, * boost::unit_test::disabled() )
+{
+	constexpr int inserts_per_thread = 1000000;
+
+	struct Elem
+	{
+		float data[16];
+	};
+
+	using clock = std::chrono::high_resolution_clock;
+	auto ms_since = []( clock::time_point start ) { return std::chrono::duration<double, std::milli>( clock::now() - start ).count(); };
+
+	const uint32_t max_threads = std::max( std::thread::hardware_concurrency(), 1u );
+	for ( uint32_t num_threads = 1; num_threads <= max_threads; num_threads *= 2 )
+	{
+		packed_freelist<Elem> locked_lst;
+		std::mutex cs;
+		auto start = clock::now();
+		{
+			std::vector<std::thread> threads;
+			for ( uint32_t thread = 0; thread < num_threads; ++thread )
+				threads.emplace_back( [&]()
+				{
+					for ( int i = 0; i < inserts_per_thread; ++i )
+					{
+						std::lock_guard<std::mutex> lock( cs );
+						locked_lst.insert( Elem{ { float( i ) } } );
+					}
+				} );
+			for ( auto& thread : threads )
+				thread.join();
+		}
+		const double locked_ms = ms_since( start );
+
+		concurrent_packed_freelist<Elem> concurrent_lst;
+		start = clock::now();
+		{
+			std::vector<std::thread> threads;
+			for ( uint32_t thread = 0; thread < num_threads; ++thread )
+				threads.emplace_back( [&]()
+				{
+					for ( int i = 0; i < inserts_per_thread; ++i )
+						concurrent_lst.insert( Elem{ { float( i ) } } );
+				} );
+			for ( auto& thread : threads )
+				thread.join();
+		}
+		const double staged_ms = ms_since( start );
+		start = clock::now();
+		concurrent_lst.commit();
+		const double commit_ms = ms_since( start );
+
+		BOOST_TEST( locked_lst.size() == concurrent_lst.size() );
+		BOOST_TEST_MESSAGE( num_threads << " threads: mutex " << locked_ms << " ms, concurrent " << staged_ms << " ms + commit " << commit_ms << " ms" );
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,377 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <boost/test/unit_test.hpp>
+
+#include <ecs/DynamicEntityContainer.h>
+#include <ecs/EntityContainer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+
+
+BOOST_AUTO_TEST_SUITE( dynamic_entity_container )
+
+struct Position
+{
+    float x, y, z;
+};
+
+struct Velocity
+{
+    float x, y, z;
+};
+
+struct Name
+{
+    std::string name;
+};
+
+struct Tag
+{
+};
+
+// counts live instances to check that pools construct and destroy components properly
+struct Tracked
+{
+    static inline int num_alive = 0;
+
+    std::unique_ptr<int> value;
+
+    Tracked( int v ) : value( std::make_unique<int>( v ) ) { num_alive++; }
+    Tracked( Tracked&& other ) noexcept : value( std::move( other.value ) ) { num_alive++; }
+    Tracked& operator=( Tracked&& other ) noexcept { value = std::move( other.value ); return *this; }
+    ~Tracked() { num_alive--; }
+};
+
+BOOST_AUTO_TEST_CASE( registration )
+{
+    const ComponentID position_id = ComponentRegistry::GetID<Position>();
+    const ComponentID velocity_id = ComponentRegistry::GetID<Velocity>();
+
+    BOOST_TEST( position_id != ComponentRegistry::InvalidID );
+    BOOST_TEST( velocity_id != ComponentRegistry::InvalidID );
+    BOOST_TEST( position_id != velocity_id );
+    BOOST_TEST( ComponentRegistry::GetID<Position>() == position_id );
+    BOOST_TEST( ComponentRegistry::GetID<const Position>() == position_id );
+    BOOST_TEST( ComponentRegistry::Get().GetNumComponents() > std::max( position_id, velocity_id ) );
+    BOOST_TEST( ComponentRegistry::Get().GetTypeInfo( position_id ).size == sizeof( Position ) );
+    BOOST_TEST( ComponentRegistry::Get().FindByName( ComponentRegistry::Get().GetName( velocity_id ).c_str() ) == velocity_id );
+}
+
+BOOST_AUTO_TEST_CASE( typed_components )
+{
+    DynamicEntityContainer world;
+
+    auto entity1 = world.CreateEntity();
+    auto entity2 = world.CreateEntity();
+
+    world.AddComponent<Position>( entity1, Position{ 1, 2, 3 } );
+    world.AddComponent<Name>( entity1, Name{ "entity1" } );
+    world.AddComponent<Tag>( entity2 );
+
+    BOOST_TEST( world.GetEntityCount() == 2 );
+    BOOST_TEST( world.HasComponent<Position>( entity1 ) );
+    BOOST_TEST( ! world.HasComponent<Position>( entity2 ) );
+    BOOST_TEST( world.HasComponent<Tag>( entity2 ) );
+    BOOST_TEST( world.GetComponent<Velocity>( entity1 ) == nullptr );
+    BOOST_TEST( world.GetComponent<Position>( entity1 )->y == 2 );
+    BOOST_TEST( world.GetComponent<Name>( entity1 )->name == "entity1" );
+    BOOST_TEST( world.GetSignature( entity1 ).count() == 2 );
+
+    // replace
+    world.AddComponent<Position>( entity1, Position{ 4, 5, 6 } );
+    BOOST_TEST( world.GetComponent<Position>( entity1 )->x == 4 );
+
+    world.RemoveComponent<Name>( entity1 );
+    BOOST_TEST( world.GetComponent<Name>( entity1 ) == nullptr );
+    world.RemoveComponent<Name>( entity1 ); // no-op
+
+    world.DestroyEntity( entity1 );
+    BOOST_TEST( world.GetEntityCount() == 1 );
+}
+
+BOOST_AUTO_TEST_CASE( runtime_registered_component )
+{
+    // a component without a C++ type, e.g. described by a script
+    ComponentTypeInfo type_info = {};
+    type_info.size = 3 * sizeof( double );
+    type_info.alignment = alignof( double );
+    type_info.move_construct = []( void* dst, void* src ) { memcpy( dst, src, 3 * sizeof( double ) ); };
+    type_info.destroy = []( void* ) {};
+
+    const ComponentID script_id = ComponentRegistry::Get().Register( type_info, "dynamic_entity_container.ScriptVec3" );
+    BOOST_REQUIRE( script_id != ComponentRegistry::InvalidID );
+    BOOST_TEST( ComponentRegistry::Get().FindByName( "dynamic_entity_container.ScriptVec3" ) == script_id );
+
+    DynamicEntityContainer world;
+    std::vector<DynamicEntityContainer::Entity> entities;
+    for ( int i = 0; i < 100; ++i )
+    {
+        auto entity = world.CreateEntity();
+        entities.push_back( entity );
+        double* data = static_cast<double*>( world.AddComponentStorage( entity, script_id ) );
+        data[0] = i;
+        data[1] = i * 2;
+        data[2] = i * 3;
+    }
+
+    for ( int i = 0; i < 100; i += 3 )
+        world.RemoveComponent( entities[i], script_id );
+
+    for ( int i = 0; i < 100; ++i )
+    {
+        BOOST_TEST( world.HasComponent( entities[i], script_id ) == ( i % 3 != 0 ) );
+        if ( const double* data = static_cast<const double*>( world.GetComponent( entities[i], script_id ) ) )
+            BOOST_TEST( data[2] == i * 3 );
+    }
+
+    // ids that failed to register are rejected at runtime, not only by asserts
+    const ComponentID unregistered_id = ComponentRegistry::Get().GetNumComponents();
+    for ( ComponentID bad_id : { ComponentRegistry::InvalidID, unregistered_id } )
+    {
+        BOOST_TEST( world.AddComponentStorage( entities[1], bad_id ) == nullptr );
+        BOOST_TEST( ! world.HasComponent( entities[1], bad_id ) );
+        BOOST_TEST( world.GetComponent( entities[1], bad_id ) == nullptr );
+        world.RemoveComponent( entities[1], bad_id );
+    }
+    BOOST_TEST( world.HasComponent( entities[1], script_id ) );
+}
+
+BOOST_AUTO_TEST_CASE( component_lifetime )
+{
+    Tracked::num_alive = 0;
+    {
+        DynamicEntityContainer world;
+        std::vector<DynamicEntityContainer::Entity> entities;
+        for ( int i = 0; i < 1000; ++i )
+        {
+            entities.push_back( world.CreateEntity() );
+            world.AddComponent<Tracked>( entities.back(), i );
+        }
+        BOOST_TEST( Tracked::num_alive == 1000 );
+
+        for ( int i = 0; i < 1000; i += 2 )
+            world.RemoveComponent<Tracked>( entities[i] );
+        for ( int i = 1; i < 1000; i += 4 )
+            world.DestroyEntity( entities[i] );
+        BOOST_TEST( Tracked::num_alive == 250 );
+
+        for ( int i = 3; i < 1000; i += 4 )
+            BOOST_TEST( *world.GetComponent<Tracked>( entities[i] )->value == i );
+    }
+    BOOST_TEST( Tracked::num_alive == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( add_remove_churn )
+{
+    // compare against a simple reference model
+    DynamicEntityContainer world;
+    std::map<uint64_t, DynamicEntityContainer::Entity> alive;
+    std::map<uint64_t, Position> ref_positions;
+    std::map<uint64_t, Velocity> ref_velocities;
+
+    std::mt19937 rng( 42 );
+    for ( int step = 0; step < 50000; ++step )
+    {
+        const uint32_t action = rng() % 6;
+        if ( action == 0 || alive.empty() )
+        {
+            auto entity = world.CreateEntity();
+            alive[entity.comparator] = entity;
+            continue;
+        }
+
+        auto it = alive.begin();
+        std::advance( it, rng() % alive.size() );
+        const auto entity = it->second;
+        const float value = float( step );
+
+        switch ( action )
+        {
+            case 1:
+                world.AddComponent<Position>( entity, Position{ value, 0, 0 } );
+                ref_positions[entity.comparator] = Position{ value, 0, 0 };
+                break;
+            case 2:
+                world.AddComponent<Velocity>( entity, Velocity{ 0, value, 0 } );
+                ref_velocities[entity.comparator] = Velocity{ 0, value, 0 };
+                break;
+            case 3:
+                world.RemoveComponent<Position>( entity );
+                ref_positions.erase( entity.comparator );
+                break;
+            case 4:
+                world.RemoveComponent<Velocity>( entity );
+                ref_velocities.erase( entity.comparator );
+                break;
+            case 5:
+                world.DestroyEntity( entity );
+                ref_positions.erase( entity.comparator );
+                ref_velocities.erase( entity.comparator );
+                alive.erase( it );
+                break;
+        }
+    }
+
+    BOOST_TEST( world.GetEntityCount() == alive.size() );
+    for ( const auto& [comparator, entity] : alive )
+    {
+        const Position* pos = world.GetComponent<Position>( entity );
+        const Velocity* vel = world.GetComponent<Velocity>( entity );
+        BOOST_TEST( ( pos != nullptr ) == ( ref_positions.count( comparator ) != 0 ) );
+        BOOST_TEST( ( vel != nullptr ) == ( ref_velocities.count( comparator ) != 0 ) );
+        if ( pos )
+            BOOST_TEST( pos->x == ref_positions[comparator].x );
+        if ( vel )
+            BOOST_TEST( vel->y == ref_velocities[comparator].y );
+    }
+
+    size_t num_in_view = 0;
+    for ( auto&& [entity, pos, vel] : world.CreateView<Position, Velocity>() )
+    {
+        BOOST_TEST( pos.x == ref_positions[entity.comparator].x );
+        BOOST_TEST( vel.y == ref_velocities[entity.comparator].y );
+        num_in_view++;
+    }
+
+    size_t expected_in_view = 0;
+    for ( const auto& [comparator, pos] : ref_positions )
+        expected_in_view += ref_velocities.count( comparator );
+    BOOST_TEST( num_in_view == expected_in_view );
+}
+
+BOOST_AUTO_TEST_CASE( iterate_over_view )
+{
+    DynamicEntityContainer world;
+
+    // view over a component that was never added is empty
+    for ( auto&& [entity, name] : world.CreateView<Name>() )
+        BOOST_FAIL( "unexpected entity" );
+
+    for ( int i = 0; i < 10; ++i )
+    {
+        auto entity = world.CreateEntity();
+        world.AddComponent<Position>( entity, Position{ float( i ), 0, 0 } );
+        if ( i % 2 == 0 )
+            world.AddComponent<Velocity>( entity, Velocity{ 1, 0, 0 } );
+    }
+
+    int num_entities = 0;
+    for ( auto&& [entity, pos, vel] : world.CreateView<Position, Velocity>() )
+    {
+        pos.x += vel.x;
+        num_entities++;
+    }
+    BOOST_TEST( num_entities == 5 );
+
+    const DynamicEntityContainer& const_world = world;
+    float sum = 0;
+    for ( auto&& [entity, pos] : const_world.CreateView<Position>() )
+        sum += pos.x;
+    BOOST_TEST( sum == 45 + 5 );
+
+    // other component types can be added while iterating
+    for ( auto&& [entity, pos] : world.CreateView<Position>() )
+        world.AddComponent<Name>( entity, Name{ std::to_string( pos.x ) } );
+
+    int num_named = 0;
+    for ( auto&& [entity, name] : world.CreateView<Name>() )
+        num_named++;
+    BOOST_TEST( num_named == 10 );
+}
+
+BOOST_AUTO_TEST_CASE( parallel_for_each )
+{
+    DynamicEntityContainer world;
+    for ( int i = 0; i < 10000; ++i )
+    {
+        auto entity = world.CreateEntity();
+        world.AddComponent<Position>( entity, Position{ 1, 0, 0 } );
+        if ( i % 3 != 0 )
+            world.AddComponent<Velocity>( entity, Velocity{ 1, 0, 0 } );
+    }
+
+    ThreadPoolTaskScheduler scheduler( 4 );
+    std::atomic<int> num_visited = 0;
+    const DynamicEntityContainer& const_world = world;
+    const_world.ParallelForEach( const_world.CreateView<Position, Velocity>(),
+        [&]( auto entity, const Position& pos, const Velocity& vel ) { num_visited++; },
+        256, scheduler );
+
+    BOOST_TEST( num_visited == 6666 );
+}
+
+// Run explicitly with --run_test=dynamic_entity_container/benchmark_component_access --log_level=message
+BOOST_AUTO_TEST_CASE( benchmark_component_access, * boost::unit_test::disabled() )
+{
+    constexpr int num_entities = 1000000;
+    constexpr int num_iterations = 10;
+
+    auto static_world = std::make_unique<EntityContainer<Position, Velocity, Name>>();
+    auto dynamic_world = std::make_unique<DynamicEntityContainer>();
+    std::vector<EntityContainer<Position, Velocity, Name>::Entity> static_entities;
+    std::vector<DynamicEntityContainer::Entity> dynamic_entities;
+    for ( int i = 0; i < num_entities; ++i )
+    {
+        static_entities.push_back( static_world->CreateEntity() );
+        dynamic_entities.push_back( dynamic_world->CreateEntity() );
+        static_world->AddComponent<Position>( static_entities.back(), Position{ float( i ), 0, 0 } );
+        dynamic_world->AddComponent<Position>( dynamic_entities.back(), Position{ float( i ), 0, 0 } );
+        if ( i % 2 == 0 )
+        {
+            static_world->AddComponent<Velocity>( static_entities.back(), Velocity{ 1, 0, 0 } );
+            dynamic_world->AddComponent<Velocity>( dynamic_entities.back(), Velocity{ 1, 0, 0 } );
+        }
+    }
+
+    // random access order, the usual case for gameplay code
+    std::mt19937 rng( 1 );
+    std::vector<int> order( num_entities );
+    for ( int i = 0; i < num_entities; ++i )
+        order[i] = i;
+    std::shuffle( order.begin(), order.end(), rng );
+
+    auto measure = [&]( auto&& fn ) -> double
+    {
+        const auto start = std::chrono::high_resolution_clock::now();
+        for ( int iteration = 0; iteration < num_iterations; ++iteration )
+            fn();
+        const auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::milli>( end - start ).count() / num_iterations;
+    };
+
+    size_t checksum = 0;
+    const double static_has_ms = measure( [&]()
+    {
+        for ( int i : order )
+            checksum += static_world->HasComponent<Velocity>( static_entities[i] );
+    } );
+    const double dynamic_has_ms = measure( [&]()
+    {
+        for ( int i : order )
+            checksum += dynamic_world->HasComponent<Velocity>( dynamic_entities[i] );
+    } );
+    const double static_get_ms = measure( [&]()
+    {
+        for ( int i : order )
+            checksum += size_t( static_world->GetComponent<Position>( static_entities[i] )->x );
+    } );
+    const double dynamic_get_ms = measure( [&]()
+    {
+        for ( int i : order )
+            checksum += size_t( dynamic_world->GetComponent<Position>( dynamic_entities[i] )->x );
+    } );
+
+    BOOST_TEST_MESSAGE( "HasComponent: btree " << static_has_ms << " ms, dynamic " << dynamic_has_ms << " ms" );
+    BOOST_TEST_MESSAGE( "GetComponent: btree " << static_get_ms << " ms, dynamic " << dynamic_get_ms << " ms" );
+    BOOST_TEST( checksum > 0 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,418 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "null_engine_fixture.h"
+
+#include <Engine/LevelObjects.h>
+
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+
+namespace
+{
+	// Registry as it was before sharding, for comparison: string keys and three locks on every lookup
+	class LegacyAssetRegistry
+	{
+		std::unordered_map<std::string, Asset*> m_assets;
+		std::unordered_map<std::string, Asset*> m_orphans;
+		std::mutex m_write_cs;
+		std::mutex m_read_cs;
+		std::mutex m_orphan_cs;
+
+	public:
+		void Register( Asset* asset )
+		{
+			std::scoped_lock lock_read( m_read_cs );
+			std::scoped_lock lock( m_write_cs );
+			m_assets[asset->GetPath()] = asset;
+		}
+
+		AssetPtr Find( const char* path )
+		{
+			const std::string id = path;
+
+			std::scoped_lock lock( m_read_cs );
+			auto entry = m_assets.find( id );
+			if ( entry != m_assets.end() )
+				return entry->second;
+
+			std::scoped_lock lock2( m_orphan_cs );
+			entry = m_orphans.find( id );
+			if ( entry == m_orphans.end() )
+				return nullptr;
+
+			std::scoped_lock lock3( m_write_cs );
+			Asset* asset = entry->second;
+			m_assets[id] = asset;
+			m_orphans.erase( entry );
+			return asset;
+		}
+	};
+}
+
+BOOST_AUTO_TEST_SUITE( asset_manager_tests )
+
+BOOST_FIXTURE_TEST_CASE( async_load_same_asset_concurrently, NullEngineFixture )
+{
+	const std::filesystem::path content = g_core_paths.engine_content;
+	WriteTextFile( content / "Meshes/AsyncQuad.obj", "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3 4\n" );
+	WriteTextFile( content / "Meshes/Async.sea", R"({ "_generator": "MeshAsset", "source": "#engine/Meshes/AsyncQuad.obj", "material": "#engine/Materials/Async.sea" })" );
+	WriteTextFile( content / "Materials/Async.sea", R"({ "_generator": "MaterialAsset", "parms": { "roughness": 0.25, "albedo": [ 0.5, 0.5, 0.5 ], "f0": [ 0.04, 0.04, 0.04 ] } })" );
+
+	constexpr uint32_t thread_count = 8;
+	std::vector<AssetLoadHandle> handles( thread_count );
+	std::vector<std::thread> threads;
+	for ( uint32_t i = 0; i < thread_count; ++i )
+		threads.emplace_back( [&handles, i]() { handles[i] = GetAssetManager().LoadAsync( AssetId( "#engine/Meshes/Async.sea" ) ); } );
+	for ( std::thread& thread : threads )
+		thread.join();
+
+	// uploads only run on this thread
+	for ( const AssetLoadHandle& handle : handles )
+		BOOST_TEST( !handle.IsDone() );
+
+	const AssetPtr asset = handles[0].Wait();
+	BOOST_REQUIRE( asset != nullptr );
+	for ( AssetLoadHandle& handle : handles )
+	{
+		BOOST_TEST( handle.IsDone() );
+		BOOST_TEST( handle.Wait() == asset );
+	}
+	BOOST_TEST( asset_mgr->GetNumLoadsInFlight() == 0u );
+
+	// the dependency is uploaded before the mesh and registered like any other asset
+	const MeshAsset* mesh = dynamic_cast<const MeshAsset*>( asset.get() );
+	BOOST_REQUIRE( mesh != nullptr );
+	BOOST_TEST( mesh->GetMaterial() != nullptr );
+	BOOST_TEST( mesh->GetMaterial() == LoadAsset<MaterialAsset>( "#engine/Materials/Async.sea" ).get() );
+	BOOST_TEST( LoadAsset<MeshAsset>( "#engine/Meshes/Async.sea" ).get() == mesh );
+	BOOST_TEST( mesh->GetNumIndices() == 6u );
+}
+
+BOOST_FIXTURE_TEST_CASE( async_load_cancel, NullEngineFixture )
+{
+	const std::filesystem::path content = g_core_paths.engine_content;
+	WriteTextFile( content / "Meshes/CancelQuad.obj", "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3 4\n" );
+	WriteTextFile( content / "Meshes/Cancel.sea", R"({ "_generator": "MeshAsset", "source": "#engine/Meshes/CancelQuad.obj", "material": "#engine/Materials/Cancel.sea" })" );
+	WriteTextFile( content / "Materials/Cancel.sea", R"({ "_generator": "MaterialAsset", "parms": { "roughness": 0.75 } })" );
+
+	const AssetId mesh_id( "#engine/Meshes/Cancel.sea" );
+	const AssetId material_id( "#engine/Materials/Cancel.sea" );
+
+	// nothing is uploaded before ProcessUploads, so the load can't finish before it is cancelled
+	AssetLoadHandle cancelled = asset_mgr->LoadAsync( mesh_id );
+	cancelled.Cancel();
+	BOOST_TEST( cancelled.IsDone() );
+	BOOST_TEST( cancelled.Wait() == nullptr );
+
+	// the dependency is only cancelled when no other load waits for it
+	BOOST_TEST( asset_mgr->GetNumLoadsInFlight() == 0u );
+	asset_mgr->ProcessUploads();
+	BOOST_TEST( asset_mgr->FindLoadedAsset( mesh_id ) == nullptr );
+	BOOST_TEST( asset_mgr->FindLoadedAsset( material_id ) == nullptr );
+
+	AssetLoadHandle first = asset_mgr->LoadAsync( mesh_id, AssetLoadPriority::Low );
+	AssetLoadHandle second = asset_mgr->LoadAsync( mesh_id, AssetLoadPriority::Low );
+	first.Cancel();
+	BOOST_TEST( second.Wait() != nullptr );
+	BOOST_TEST( first.GetAsset() == second.GetAsset() );
+	BOOST_TEST( asset_mgr->FindLoadedAsset( material_id ) != nullptr );
+
+	// cancelling a finished load does nothing
+	second.Cancel();
+	BOOST_TEST( second.GetAsset() != nullptr );
+}
+
+BOOST_FIXTURE_TEST_CASE( async_load_dependency_cycle, NullEngineFixture )
+{
+	const std::filesystem::path content = g_core_paths.engine_content;
+	for ( const char* name : { "CycleA", "CycleB", "CycleSelf" } )
+		WriteTextFile( content / "Meshes" / ( std::string( name ) + ".obj" ), "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3 4\n" );
+	WriteTextFile( content / "Meshes/CycleA.sea", R"({ "_generator": "MeshAsset", "source": "#engine/Meshes/CycleA.obj", "material": "#engine/Meshes/CycleB.sea" })" );
+	WriteTextFile( content / "Meshes/CycleB.sea", R"({ "_generator": "MeshAsset", "source": "#engine/Meshes/CycleB.obj", "material": "#engine/Meshes/CycleA.sea" })" );
+	WriteTextFile( content / "Meshes/CycleSelf.sea", R"({ "_generator": "MeshAsset", "source": "#engine/Meshes/CycleSelf.obj", "material": "#engine/Meshes/CycleSelf.sea" })" );
+
+	// one edge of the cycle is dropped, so the assets don't wait for each other forever
+	AssetLoadHandle a = asset_mgr->LoadAsync( AssetId( "#engine/Meshes/CycleA.sea" ) );
+	AssetLoadHandle b = asset_mgr->LoadAsync( AssetId( "#engine/Meshes/CycleB.sea" ) );
+	const AssetPtr mesh_a = a.Wait();
+	const AssetPtr mesh_b = b.Wait();
+	BOOST_TEST( mesh_a != nullptr );
+	BOOST_TEST( mesh_b != nullptr );
+
+	MeshAssetPtr self = LoadAsset<MeshAsset>( "#engine/Meshes/CycleSelf.sea" );
+	BOOST_REQUIRE( self != nullptr );
+	// a mesh is not a material
+	BOOST_TEST( self->GetMaterial() == nullptr );
+
+	BOOST_TEST( asset_mgr->GetNumLoadsInFlight() == 0u );
+}
+
+// Run explicitly with --run_test=asset_manager_tests/benchmark_level_load --log_level=message
+BOOST_FIXTURE_TEST_CASE( benchmark_level_load, NullEngineFixture, * boost::unit_test::disabled() )
+{
+	if ( LevelObject::GetAllTraits().empty() )
+		LevelObject::RegisterTraits();
+
+	// 1000 meshes with a material each, 2000 assets
+	constexpr int mesh_count = 1000;
+	const std::filesystem::path content = g_core_paths.engine_content;
+	std::string level = R"({ "_generator": "LevelAsset", "objects": [)";
+	for ( int i = 0; i < mesh_count; ++i )
+	{
+		const std::string name = "#engine/Benchmark/Mesh" + std::to_string( i );
+		const std::filesystem::path path = content / "Benchmark" / ( "Mesh" + std::to_string( i ) );
+		WriteTextFile( std::filesystem::path( path ).concat( ".obj" ), "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 2 0 0\nv 2 1 0\nf 1 2 3 4\nf 2 5 6 3\n" );
+		WriteTextFile( std::filesystem::path( path ).concat( ".sea" ),
+			( R"({ "_generator": "MeshAsset", "source": ")" + name + R"(.obj", "material": ")" + name + R"(Material.sea" })" ).c_str() );
+		WriteTextFile( std::filesystem::path( path ).concat( "Material.sea" ),
+			R"({ "_generator": "MaterialAsset", "parms": { "roughness": 0.5, "albedo": [ 0.8, 0.8, 0.8 ], "f0": [ 0.04, 0.04, 0.04 ] } })" );
+
+		level += ( i > 0 ? "," : "" );
+		level += R"({ "name": "Mesh)" + std::to_string( i ) + R"(", "traits": [ { "_type": "MeshInstanceTrait", "value": { "asset": ")" + name + R"(.sea" } } ] })";
+	}
+	level += "] }";
+	WriteTextFile( content / "Benchmark/Generated.sel", level.c_str() );
+
+	const uint32_t max_threads = std::max( std::thread::hardware_concurrency(), 1u );
+	std::vector<uint32_t> thread_counts = { 1 };
+	for ( uint32_t threads = 2; threads < max_threads; threads *= 2 )
+		thread_counts.push_back( threads );
+	if ( max_threads > 1 )
+		thread_counts.push_back( max_threads );
+
+	const std::string test_content = g_core_paths.engine_content;
+	const auto benchmark_level = [&]( const char* label, const std::filesystem::path& level_path, const std::string& content_root )
+	{
+		Json level_json;
+		std::ifstream file( level_path );
+		rapidjson::IStreamWrapper isw( file );
+		BOOST_REQUIRE( !level_json.ParseStream( isw ).HasParseError() );
+
+		std::vector<std::string> paths;
+		for ( const auto& object : level_json["objects"].GetArray() )
+			LevelObject::GetAssetPaths( object, paths );
+
+		g_core_paths.engine_content = content_root;
+
+		// the first pass cooks the sources, the measured ones load cooked files
+		thread_counts.insert( thread_counts.begin(), max_threads );
+		for ( size_t pass = 0; pass < thread_counts.size(); ++pass )
+		{
+			AssetManager mgr( thread_counts[pass] );
+			g_engine.asset_mgr = &mgr;
+
+			size_t loaded = 0;
+			const auto start = std::chrono::steady_clock::now();
+			{
+				std::vector<AssetLoadHandle> handles;
+				for ( const std::string& path : paths )
+					handles.emplace_back( mgr.LoadAsync( AssetId( path.c_str() ) ) );
+				for ( AssetLoadHandle& handle : handles )
+					loaded += handle.Wait() != nullptr ? 1 : 0;
+			}
+			const double ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+
+			if ( pass > 0 )
+				BOOST_TEST_MESSAGE( label << ", " << thread_counts[pass] << " loader threads: " << ms << " ms, " << loaded << "/" << paths.size() << " level assets loaded" );
+
+			g_engine.asset_mgr = asset_mgr.get();
+		}
+		thread_counts.erase( thread_counts.begin() );
+
+		g_core_paths.engine_content = test_content;
+	};
+
+	const std::filesystem::path default_level = "../EngineContent/Levels/Default.sel";
+	if ( std::filesystem::exists( default_level ) )
+		benchmark_level( "Default.sel", default_level, std::filesystem::absolute( "../EngineContent" ).string() + "/" );
+	else
+		BOOST_TEST_MESSAGE( "Default.sel is not found, skipped" );
+
+	benchmark_level( "generated level", content / "Benchmark/Generated.sel", test_content );
+}
+
+BOOST_FIXTURE_TEST_CASE( orphans_unloaded_by_lru_within_budget, NullEngineFixture )
+{
+	const std::filesystem::path content = g_core_paths.engine_content;
+	for ( int i = 0; i < 3; ++i )
+		WriteTextFile( content / "Materials" / ( "Orphan" + std::to_string( i ) + ".sea" ), R"({ "_generator": "MaterialAsset", "parms": { "roughness": 0.5 } })" );
+
+	const AssetId ids[3] = { AssetId( "#engine/Materials/Orphan0.sea" ), AssetId( "#engine/Materials/Orphan1.sea" ), AssetId( "#engine/Materials/Orphan2.sea" ) };
+	BOOST_TEST( ( ids[0] == AssetId( "#engine/Materials/Orphan0.sea" ) ) );
+	BOOST_TEST( !( ids[0] == ids[1] ) );
+
+	// orphans of the default assets don't take part
+	asset_mgr->UnloadOrphans( 0 );
+	BOOST_REQUIRE( asset_mgr->GetOrphanMemoryUsage() == 0u );
+
+	std::vector<AssetPtr> assets;
+	for ( const AssetId& id : ids )
+		assets.push_back( asset_mgr->Load( id ) );
+	BOOST_REQUIRE( assets[0] != nullptr );
+	const size_t asset_size = assets[0]->GetMemoryUsage();
+	BOOST_REQUIRE( asset_size > 0u );
+
+	const uint32_t num_loaded = asset_mgr->GetNumLoadedAssets();
+	for ( AssetPtr& asset : assets )
+		asset = nullptr;
+	BOOST_TEST( asset_mgr->GetOrphanMemoryUsage() == 3 * asset_size );
+	BOOST_TEST( asset_mgr->GetNumLoadedAssets() == num_loaded );
+
+	// the least recently orphaned one goes first
+	BOOST_TEST( asset_mgr->UnloadOrphans( 2 * asset_size ) == 1u );
+	BOOST_TEST( asset_mgr->FindLoadedAsset( ids[0] ) == nullptr );
+	BOOST_TEST( asset_mgr->GetNumLoadedAssets() == num_loaded - 1 );
+
+	// a lookup revives an orphan, it is orphaned again with a newer tick once released
+	BOOST_TEST( asset_mgr->FindLoadedAsset( ids[1] ) != nullptr );
+	BOOST_TEST( asset_mgr->GetOrphanMemoryUsage() == 2 * asset_size );
+	BOOST_TEST( asset_mgr->UnloadOrphans( asset_size ) == 1u );
+	BOOST_TEST( asset_mgr->FindLoadedAsset( ids[2] ) == nullptr );
+
+	AssetPtr kept = asset_mgr->FindLoadedAsset( ids[1] );
+	BOOST_REQUIRE( kept != nullptr );
+	BOOST_TEST( asset_mgr->UnloadOrphans( 0 ) == 0u );
+	BOOST_TEST( asset_mgr->FindLoadedAsset( ids[1] ) == kept );
+
+	kept = nullptr;
+	BOOST_TEST( asset_mgr->UnloadOrphans( 0 ) == 1u );
+	BOOST_TEST( asset_mgr->GetOrphanMemoryUsage() == 0u );
+	BOOST_TEST( asset_mgr->GetNumLoadedAssets() == num_loaded - 3 );
+}
+
+// Meant to be run with ThreadSanitizer too: lookups, loads and releases race with uploads and unloading within a tiny budget
+BOOST_FIXTURE_TEST_CASE( registry_concurrent_churn, NullEngineFixture )
+{
+	constexpr int asset_count = 64;
+	const std::filesystem::path content = g_core_paths.engine_content;
+	std::vector<std::string> paths;
+	for ( int i = 0; i < asset_count; ++i )
+	{
+		paths.push_back( "#engine/Churn/Material" + std::to_string( i ) + ".sea" );
+		WriteTextFile( content / "Churn" / ( "Material" + std::to_string( i ) + ".sea" ), R"({ "_generator": "MaterialAsset", "parms": { "roughness": 0.5 } })" );
+	}
+
+	constexpr uint32_t thread_count = 8;
+	constexpr int iterations = 2000;
+	std::atomic<uint32_t> num_finished = 0;
+	std::atomic<uint32_t> num_failed = 0;
+	std::vector<std::thread> threads;
+	for ( uint32_t t = 0; t < thread_count; ++t )
+	{
+		threads.emplace_back( [&, t]()
+		{
+			std::mt19937 rng( t );
+			std::vector<AssetPtr> held;
+			for ( int i = 0; i < iterations; ++i )
+			{
+				const AssetId id( paths[rng() % asset_count].c_str() );
+				AssetPtr asset = GetAssetManager().FindLoadedAsset( id );
+				if ( !asset )
+					asset = GetAssetManager().LoadAsync( id, AssetLoadPriority( rng() % 3 ) ).Wait();
+				if ( !asset || asset->GetStatus() != AssetStatus::Ready )
+					num_failed++;
+
+				// keep a few alive for a while, so some are released from other points in time
+				held.push_back( std::move( asset ) );
+				if ( held.size() > 4 )
+					held.erase( held.begin() + ( rng() % held.size() ) );
+			}
+			num_finished++;
+		} );
+	}
+
+	const size_t budget = 8 * sizeof( MaterialAsset );
+	uint32_t num_unloaded = 0;
+	while ( num_finished < thread_count )
+	{
+		asset_mgr->ProcessUploads();
+		num_unloaded += asset_mgr->UnloadOrphans( budget );
+	}
+	for ( std::thread& thread : threads )
+		thread.join();
+
+	BOOST_TEST( num_failed.load() == 0u );
+	BOOST_TEST( num_unloaded > 0u );
+	BOOST_TEST( asset_mgr->GetNumLoadsInFlight() == 0u );
+
+	asset_mgr->UnloadOrphans( budget );
+	BOOST_TEST( asset_mgr->GetOrphanMemoryUsage() <= budget );
+	for ( const std::string& path : paths )
+	{
+		AssetPtr asset = asset_mgr->Load( AssetId( path.c_str() ) );
+		BOOST_TEST( asset != nullptr );
+	}
+}
+
+// Run explicitly with --run_test=asset_manager_tests/benchmark_asset_lookups --log_level=message
+BOOST_FIXTURE_TEST_CASE( benchmark_asset_lookups, NullEngineFixture, * boost::unit_test::disabled() )
+{
+	constexpr int asset_count = 1024;
+	constexpr int lookups_per_thread = 1000000;
+	const std::filesystem::path content = g_core_paths.engine_content;
+
+	std::vector<std::string> paths;
+	std::vector<AssetId> ids;
+	std::vector<AssetLoadHandle> handles;
+	for ( int i = 0; i < asset_count; ++i )
+	{
+		paths.push_back( "#engine/Benchmark/Lookup" + std::to_string( i ) + ".sea" );
+		ids.emplace_back( paths.back().c_str() );
+		WriteTextFile( content / "Benchmark" / ( "Lookup" + std::to_string( i ) + ".sea" ), R"({ "_generator": "MaterialAsset", "parms": { "roughness": 0.5 } })" );
+		handles.push_back( asset_mgr->LoadAsync( ids.back() ) );
+	}
+
+	// assets stay referenced, lookups don't revive orphans
+	std::vector<AssetPtr> assets;
+	LegacyAssetRegistry legacy;
+	for ( AssetLoadHandle& handle : handles )
+	{
+		assets.push_back( handle.Wait() );
+		BOOST_REQUIRE( assets.back() != nullptr );
+		legacy.Register( assets.back().get() );
+	}
+
+	const auto measure = [&]( uint32_t thread_count, const auto& lookup )
+	{
+		std::atomic<bool> go = false;
+		std::atomic<uint32_t> num_found = 0;
+		std::vector<std::thread> threads;
+		for ( uint32_t t = 0; t < thread_count; ++t )
+		{
+			threads.emplace_back( [&, t]()
+			{
+				while ( !go )
+					std::this_thread::yield();
+
+				uint32_t found = 0;
+				for ( int i = 0; i < lookups_per_thread; ++i )
+					found += lookup( ( size_t( i ) * 7 + t * 131 ) % asset_count ) != nullptr ? 1 : 0;
+				num_found += found;
+			} );
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		go = true;
+		for ( std::thread& thread : threads )
+			thread.join();
+		const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+		BOOST_TEST( num_found.load() == thread_count * uint32_t( lookups_per_thread ) );
+		return double( thread_count ) * lookups_per_thread / seconds;
+	};
+
+	for ( uint32_t thread_count : { 1u, 2u, 4u, 8u, 16u } )
+	{
+		const double legacy_rate = measure( thread_count, [&]( size_t i ) { return legacy.Find( paths[i].c_str() ); } );
+		const double id_rate = measure( thread_count, [&]( size_t i ) { return asset_mgr->FindLoadedAsset( ids[i] ); } );
+		const double path_rate = measure( thread_count, [&]( size_t i ) { return asset_mgr->FindLoadedAsset( AssetId( paths[i].c_str() ) ); } );
+
+		BOOST_TEST_MESSAGE( thread_count << " threads, Mlookups/s: three locks " << legacy_rate / 1e6
+			<< ", sharded " << id_rate / 1e6 << ", sharded with path interning " << path_rate / 1e6 );
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,341 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "null_engine_fixture.h"
+
+#include <chrono>
+#include <random>
+
+BOOST_AUTO_TEST_SUITE( bindless_tests )
+
+BOOST_AUTO_TEST_CASE( bindless_slot_allocator )
+{
+	BindlessSlotAllocator slots( 3 );
+	const BindlessSlotAllocator::Handle handles[3] = { slots.Allocate(), slots.Allocate(), slots.Allocate() };
+	for ( const BindlessSlotAllocator::Handle& handle : handles )
+		BOOST_TEST( slots.IsAlive( handle ) );
+	BOOST_TEST( !slots.Allocate().IsValid() );
+
+	// the slot is kept until the frame that freed it completes
+	BOOST_TEST( slots.Free( handles[1], 5 ) );
+	BOOST_TEST( !slots.IsAlive( handles[1] ) );
+	BOOST_TEST( !slots.Free( handles[1], 5 ) );
+	BOOST_TEST( slots.GetNumPendingFree() == 1u );
+	BOOST_TEST( !slots.Allocate().IsValid() );
+	BOOST_TEST( slots.Recycle( 4 ) == 0u );
+	BOOST_TEST( slots.Recycle( 5 ) == 1u );
+
+	const BindlessSlotAllocator::Handle reused = slots.Allocate();
+	BOOST_TEST( reused.GetIndex() == handles[1].GetIndex() );
+	BOOST_TEST( !( reused == handles[1] ) );
+	BOOST_TEST( !slots.IsAlive( handles[1] ) );
+	BOOST_TEST( slots.GetNumAllocated() == 3u );
+	BOOST_TEST( slots.GetHighWatermark() == 3u );
+
+	// generations wrap without producing the invalid handle
+	BindlessSlotAllocator single( 1 );
+	BindlessSlotAllocator::Handle prev = single.Allocate();
+	for ( uint64_t frame = 0; frame < 10000; ++frame )
+	{
+		BOOST_REQUIRE( single.Free( prev, frame ) );
+		single.Recycle( frame );
+		const BindlessSlotAllocator::Handle next = single.Allocate();
+		BOOST_REQUIRE( next.IsValid() );
+		BOOST_REQUIRE( !single.IsAlive( prev ) );
+		prev = next;
+	}
+
+	// the whole index range
+	BindlessSlotAllocator big;
+	std::vector<BindlessSlotAllocator::Handle> all( BindlessSlotAllocator::MaxSlots );
+	for ( BindlessSlotAllocator::Handle& handle : all )
+		handle = big.Allocate();
+	BOOST_TEST( std::all_of( all.begin(), all.end(), []( const auto& handle ) { return handle.IsValid(); } ) );
+	BOOST_TEST( all.back().GetIndex() == BindlessSlotAllocator::MaxSlots - 1 );
+	BOOST_TEST( !big.Allocate().IsValid() );
+	for ( const BindlessSlotAllocator::Handle& handle : all )
+		big.Free( handle, 1 );
+	BOOST_TEST( big.Recycle( 1 ) == BindlessSlotAllocator::MaxSlots );
+	BOOST_TEST( big.Allocate().IsValid() );
+}
+
+BOOST_AUTO_TEST_CASE( global_descriptors_recycle_after_frame_fence )
+{
+	constexpr uint32_t latency_us = 20000;
+	RHIPtr rhi = CreateTestRHI( latency_us );
+	g_engine.rhi = rhi.get();
+
+	{
+		GlobalDescriptors descriptors;
+
+		const MaterialGPU material = { glm::vec3( 1.0f ), glm::vec3( 0.04f ), 0.5f };
+		const GlobalDescriptors::MaterialHandle removed = descriptors.AddMaterial( material );
+		BOOST_TEST( descriptors.RemoveMaterial( removed ) );
+		BOOST_TEST( !descriptors.RemoveMaterial( removed ) );
+		BOOST_TEST( !descriptors.UpdateMaterial( removed, material ) );
+
+		// the frame may still read the slot
+		const GlobalDescriptors::MaterialHandle during_frame = descriptors.AddMaterial( material );
+		BOOST_TEST( during_frame.GetIndex() != removed.GetIndex() );
+
+		RHICommandList* cmd_list = rhi->GetCommandList( RHI::QueueType::Graphics );
+		cmd_list->Begin();
+		cmd_list->End();
+		RHI::SubmitInfo submit_info = {};
+		submit_info.cmd_list_count = 1;
+		submit_info.cmd_lists = &cmd_list;
+		const RHIFence frame_fence = rhi->SubmitCommandLists( submit_info );
+		descriptors.OnFrameSubmitted( frame_fence );
+
+		const GlobalDescriptors::MaterialHandle in_flight = descriptors.AddMaterial( material );
+		BOOST_TEST( in_flight.GetIndex() != removed.GetIndex() );
+
+		rhi->WaitForFenceCompletion( frame_fence );
+		descriptors.OnFrameSubmitted( frame_fence );
+
+		const GlobalDescriptors::MaterialHandle recycled = descriptors.AddMaterial( material );
+		BOOST_TEST( recycled.GetIndex() == removed.GetIndex() );
+		BOOST_TEST( !descriptors.UpdateMaterial( removed, material ) );
+		BOOST_TEST( descriptors.UpdateMaterial( recycled, material ) );
+		BOOST_TEST( descriptors.GetNumMaterials() == 3u );
+	}
+
+	rhi->WaitIdle();
+	g_engine.rhi = nullptr;
+}
+
+BOOST_AUTO_TEST_CASE( global_descriptors_write_sets_after_frame_fence )
+{
+	NullRHICreateInfo create_info = {};
+	create_info.gpu_latency_us = 20000;
+	create_info.logger = g_log;
+	create_info.core_paths = &g_core_paths;
+	// two descriptors per geometry
+	create_info.max_bindless_descriptors = 2 * 4096;
+	RHIPtr rhi = CreateNullRHI_RAII( create_info );
+	g_engine.rhi = rhi.get();
+
+	{
+		GlobalDescriptors descriptors;
+
+		RHI::BufferInfo buffer_info = {};
+		buffer_info.size = 256;
+		buffer_info.usage = RHIBufferUsageFlags::StructuredBuffer;
+		RHIBufferPtr buffer = rhi->CreateDeviceBuffer( buffer_info );
+		RHIBufferViewInfo view = {};
+		view.buffer = buffer.get();
+
+		const auto submit_frame = [&]()
+		{
+			RHICommandList* cmd_list = rhi->GetCommandList( RHI::QueueType::Graphics );
+			cmd_list->Begin();
+			cmd_list->BindDescriptorSet( 0, descriptors.GetDescSet() );
+			cmd_list->End();
+			RHI::SubmitInfo submit_info = {};
+			submit_info.cmd_list_count = 1;
+			submit_info.cmd_lists = &cmd_list;
+			const RHIFence fence = rhi->SubmitCommandLists( submit_info );
+			descriptors.OnFrameSubmitted( fence );
+			return fence;
+		};
+
+		// no frame has used the set yet, it's written in place
+		const GlobalDescriptors::GeometryHandle first_geom = descriptors.AddGeometry( view, view );
+		BOOST_REQUIRE( first_geom.IsValid() );
+		const RHIDescriptorSet* first_set = &descriptors.GetDescSet();
+		descriptors.FlushUpdates();
+		BOOST_TEST( &descriptors.GetDescSet() == first_set );
+		const RHIFence first_fence = submit_frame();
+
+		// nothing changed, the set in flight is shared by the next frame without writes
+		NullRHI_ResetStats( *rhi );
+		descriptors.FlushUpdates();
+		BOOST_TEST( &descriptors.GetDescSet() == first_set );
+		BOOST_TEST( NullRHI_GetStats( *rhi ).GetCalls( NullRHICall::BindDescriptor ) == 0u );
+
+		// a change goes to another set while the first frame is in flight
+		const GlobalDescriptors::GeometryHandle second_geom = descriptors.AddGeometry( view, view );
+		descriptors.FlushUpdates();
+		BOOST_TEST( !rhi->IsFenceCompleted( first_fence ) );
+		BOOST_TEST( &descriptors.GetDescSet() != first_set );
+		// both geometries, the set had never been written
+		BOOST_TEST( NullRHI_GetStats( *rhi ).GetCalls( NullRHICall::BindDescriptor ) == 5u );
+		submit_frame();
+
+		// the third set is new, it gets every geometry that is still alive
+		BOOST_TEST( descriptors.RemoveGeometry( first_geom ) );
+		const GlobalDescriptors::GeometryHandle third_geom = descriptors.AddGeometry( view, view );
+		BOOST_TEST( third_geom.GetIndex() == 2u );
+		NullRHI_ResetStats( *rhi );
+		descriptors.FlushUpdates();
+		BOOST_TEST( NullRHI_GetStats( *rhi ).GetCalls( NullRHICall::BindDescriptor ) == 5u );
+		const RHIFence third_fence = submit_frame();
+
+		// the ring wraps around to the first set once its frames complete, it only gets the slots changed since it was written
+		descriptors.AddGeometry( view, view );
+		NullRHI_ResetStats( *rhi );
+		descriptors.FlushUpdates();
+		BOOST_TEST( &descriptors.GetDescSet() == first_set );
+		BOOST_TEST( NullRHI_GetStats( *rhi ).GetCalls( NullRHICall::BindDescriptor ) == 6u );
+		BOOST_TEST( NullRHI_GetStats( *rhi ).GetCalls( NullRHICall::CreateDescriptorSet ) == 0u );
+		// the removed slot is reused after this
+		rhi->WaitForFenceCompletion( third_fence );
+		submit_frame();
+
+		// a set too small for the table is recreated, up to the limit of the RHI
+		std::vector<GlobalDescriptors::GeometryHandle> handles;
+		for ( GlobalDescriptors::GeometryHandle handle = descriptors.AddGeometry( view, view ); handle.IsValid(); handle = descriptors.AddGeometry( view, view ) )
+			handles.emplace_back( handle );
+		BOOST_TEST( descriptors.GetNumGeometries() == 4096u );
+
+		NullRHI_ResetStats( *rhi );
+		descriptors.FlushUpdates();
+		BOOST_TEST( NullRHI_GetStats( *rhi ).GetCalls( NullRHICall::CreateDescriptorSet ) == 1u );
+		BOOST_TEST( NullRHI_GetStats( *rhi ).GetCalls( NullRHICall::BindDescriptor ) == 2 * 4096u + 1 );
+		submit_frame();
+
+		BOOST_TEST( descriptors.RemoveGeometry( second_geom ) );
+		for ( const GlobalDescriptors::GeometryHandle& handle : handles )
+			BOOST_TEST_REQUIRE( descriptors.RemoveGeometry( handle ) );
+	}
+
+	rhi->WaitIdle();
+	g_engine.rhi = nullptr;
+}
+
+BOOST_FIXTURE_TEST_CASE( global_materials_delta_upload, NullEngineFixture )
+{
+	GlobalDescriptors& descriptors = renderer->GetGlobalDescriptors();
+
+	const auto make_material = []( uint32_t i, float roughness )
+	{
+		return MaterialGPU{ glm::vec3( float( i ), 0.0f, 1.0f ), glm::vec3( 0.04f ), roughness };
+	};
+
+	// more than the initial capacity of the buffer
+	constexpr uint32_t material_count = 3000;
+	std::vector<GlobalDescriptors::MaterialHandle> handles;
+	for ( uint32_t i = 0; i < material_count; ++i )
+	{
+		handles.emplace_back( descriptors.AddMaterial( make_material( i, 0.5f ) ) );
+		BOOST_REQUIRE( handles.back().IsValid() );
+	}
+
+	const auto read_materials = [&]()
+	{
+		upload_mgr->WaitAll();
+
+		RHIBuffer& material_buffer = *descriptors.GetMaterialBuffer();
+		RHI::BufferInfo readback_info = {};
+		readback_info.size = material_buffer.GetSize();
+		readback_info.usage = RHIBufferUsageFlags::TransferDst;
+		RHIReadbackBufferPtr readback = rhi->CreateReadbackBuffer( readback_info );
+
+		RHICommandList* cmd_list = rhi->GetCommandList( RHI::QueueType::Graphics );
+		cmd_list->Begin();
+		RHICommandList::CopyRegion region = {};
+		region.size = material_buffer.GetSize();
+		cmd_list->CopyBuffer( material_buffer, *readback->GetBuffer(), 1, &region );
+		cmd_list->End();
+
+		RHI::SubmitInfo submit_info = {};
+		submit_info.cmd_list_count = 1;
+		submit_info.cmd_lists = &cmd_list;
+		rhi->WaitForFenceCompletion( rhi->SubmitCommandLists( submit_info ) );
+
+		std::vector<MaterialGPU> materials( material_buffer.GetSize() / sizeof( MaterialGPU ) );
+		readback->ReadBytes( materials.data(), materials.size() * sizeof( MaterialGPU ) );
+		return materials;
+	};
+
+	descriptors.FlushUpdates();
+	BOOST_TEST( descriptors.GetStats().material_capacity >= material_count );
+
+	std::vector<MaterialGPU> materials = read_materials();
+	for ( uint32_t i = 0; i < material_count; ++i )
+	{
+		BOOST_TEST_REQUIRE( materials[handles[i].GetIndex()].albedo.x == float( i ) );
+		BOOST_TEST_REQUIRE( materials[handles[i].GetIndex()].roughness == 0.5f );
+	}
+
+	// changes far apart from each other are uploaded one by one
+	constexpr uint32_t changed_count = 10;
+	for ( uint32_t i = 0; i < changed_count; ++i )
+		BOOST_TEST( descriptors.UpdateMaterial( handles[i * 100], make_material( i * 100, 0.25f ) ) );
+
+	descriptors.FlushUpdates();
+	BOOST_TEST( descriptors.GetStats().last_material_upload_size == changed_count * sizeof( MaterialGPU ) );
+
+	materials = read_materials();
+	for ( uint32_t i = 0; i < material_count; ++i )
+		BOOST_TEST_REQUIRE( materials[handles[i].GetIndex()].roughness == ( i % 100 == 0 && i < changed_count * 100 ? 0.25f : 0.5f ) );
+
+	descriptors.FlushUpdates();
+	BOOST_TEST( descriptors.GetStats().last_material_upload_size == 0u );
+
+	for ( const GlobalDescriptors::MaterialHandle& handle : handles )
+		BOOST_TEST_REQUIRE( descriptors.RemoveMaterial( handle ) );
+}
+
+// Run explicitly with --run_test=bindless_tests/benchmark_bindless_material_churn --log_level=message
+BOOST_FIXTURE_TEST_CASE( benchmark_bindless_material_churn, NullEngineFixture, * boost::unit_test::disabled() )
+{
+	constexpr uint32_t material_count = 100000;
+	constexpr uint32_t changed_per_frame = material_count / 100;
+	constexpr int frame_count = 100;
+
+	// allocate/free churn of the slot allocator alone, half of the slots are replaced every round
+	{
+		BindlessSlotAllocator slots;
+		std::vector<BindlessSlotAllocator::Handle> handles( material_count );
+		for ( BindlessSlotAllocator::Handle& handle : handles )
+			handle = slots.Allocate();
+
+		constexpr int round_count = 100;
+		const auto start = std::chrono::steady_clock::now();
+		for ( int round = 0; round < round_count; ++round )
+		{
+			for ( uint32_t i = round % 2; i < material_count; i += 2 )
+				slots.Free( handles[i], round );
+			slots.Recycle( round );
+			for ( uint32_t i = round % 2; i < material_count; i += 2 )
+				handles[i] = slots.Allocate();
+		}
+		const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+		BOOST_TEST_MESSAGE( "slot churn: " << double( round_count ) * material_count / seconds / 1e6 << " M alloc+free/s" );
+	}
+
+	GlobalDescriptors& descriptors = renderer->GetGlobalDescriptors();
+
+	std::vector<GlobalDescriptors::MaterialHandle> handles;
+	for ( uint32_t i = 0; i < material_count; ++i )
+		handles.emplace_back( descriptors.AddMaterial( MaterialGPU{ glm::vec3( 0.8f ), glm::vec3( 0.04f ), 0.5f } ) );
+	descriptors.FlushUpdates();
+	upload_mgr->WaitAll();
+
+	std::mt19937 rng( 3 );
+	size_t upload_size = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for ( int frame = 0; frame < frame_count; ++frame )
+	{
+		for ( uint32_t i = 0; i < changed_per_frame; ++i )
+		{
+			const uint32_t idx = rng() % material_count;
+			descriptors.UpdateMaterial( handles[idx], MaterialGPU{ glm::vec3( float( frame ) ), glm::vec3( 0.04f ), 0.5f } );
+		}
+		descriptors.FlushUpdates();
+		upload_size += descriptors.GetStats().last_material_upload_size;
+		upload_mgr->Update();
+	}
+	upload_mgr->WaitAll();
+	const double ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+
+	const size_t full_size = sizeof( MaterialGPU ) * material_count;
+	BOOST_TEST_MESSAGE( material_count << " materials, " << changed_per_frame << " changed per frame: " << upload_size / frame_count
+		<< " bytes uploaded per frame, a full rewrite is " << full_size << " bytes; cpu ms/frame: " << ms / frame_count );
+
+	for ( const GlobalDescriptors::MaterialHandle& handle : handles )
+		descriptors.RemoveMaterial( handle );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
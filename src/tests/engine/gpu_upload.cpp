@@ -0,0 +1,227 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "null_engine_fixture.h"
+
+#include <chrono>
+#include <random>
+
+BOOST_AUTO_TEST_SUITE( gpu_upload_tests )
+
+BOOST_FIXTURE_TEST_CASE( upload_batching_data_integrity, NullEngineFixture )
+{
+	// small ring, so allocations skip its end, wait for batches in flight and go to dedicated buffers
+	GPUUploadManager mgr( 16 * 1024, 4 * 1024 );
+
+	std::mt19937 rng( 7 );
+	std::vector<std::vector<uint8_t>> sources( 200 );
+	std::vector<RHIBufferPtr> buffers;
+	GPUUploadManager::Token last_token = GPUUploadManager::CompletedToken;
+	for ( size_t i = 0; i < sources.size(); ++i )
+	{
+		std::vector<uint8_t>& src = sources[i];
+		src.resize( i % 50 == 0 ? 12 * 1024 : 1 + rng() % 3000 );
+		for ( uint8_t& byte : src )
+			byte = uint8_t( rng() );
+
+		RHI::BufferInfo buf_info = {};
+		buf_info.size = src.size();
+		buf_info.usage = RHIBufferUsageFlags::TransferSrc;
+		GPUUploadManager::Token token = GPUUploadManager::CompletedToken;
+		buffers.emplace_back( mgr.CreateInitializedBuffer( buf_info, src.data(), src.size(), token ) );
+		BOOST_REQUIRE( buffers.back() != nullptr );
+		BOOST_TEST( token >= last_token );
+		last_token = token;
+	}
+
+	mgr.Wait( last_token );
+	BOOST_TEST( mgr.IsCompleted( last_token ) );
+
+	const GPUUploadManager::Stats& stats = mgr.GetStats();
+	BOOST_TEST( stats.uploads == sources.size() );
+	BOOST_TEST( stats.dedicated_staging_buffers == 4u );
+	BOOST_TEST( stats.ring_stalls > 0u );
+
+	RHICommandList* cmd_list = rhi->GetCommandList( RHI::QueueType::Graphics );
+	cmd_list->Begin();
+	std::vector<RHIReadbackBufferPtr> readbacks;
+	for ( size_t i = 0; i < sources.size(); ++i )
+	{
+		RHI::BufferInfo readback_info = {};
+		readback_info.size = sources[i].size();
+		readback_info.usage = RHIBufferUsageFlags::TransferDst;
+		readbacks.emplace_back( rhi->CreateReadbackBuffer( readback_info ) );
+
+		RHICommandList::CopyRegion region = {};
+		region.size = sources[i].size();
+		cmd_list->CopyBuffer( *buffers[i], *readbacks.back()->GetBuffer(), 1, &region );
+	}
+	cmd_list->End();
+
+	RHI::SubmitInfo submit_info = {};
+	submit_info.cmd_list_count = 1;
+	submit_info.cmd_lists = &cmd_list;
+	rhi->WaitForFenceCompletion( rhi->SubmitCommandLists( submit_info ) );
+
+	for ( size_t i = 0; i < sources.size(); ++i )
+	{
+		std::vector<uint8_t> dst( sources[i].size() );
+		readbacks[i]->ReadBytes( dst.data(), dst.size() );
+		BOOST_TEST( dst == sources[i], boost::test_tools::per_element() );
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE( upload_batching_submissions, NullEngineFixture )
+{
+	GPUUploadManager mgr( 64 * 1024 * 1024, 16 * 1024 * 1024 );
+
+	constexpr size_t upload_count = 1000;
+	constexpr size_t upload_size = 16 * 1024;
+	const std::vector<uint8_t> src( upload_size, 0x5a );
+
+	NullRHI_ResetStats( *rhi );
+
+	std::vector<RHIBufferPtr> buffers;
+	GPUUploadManager::Token last_token = GPUUploadManager::CompletedToken;
+	for ( size_t i = 0; i < upload_count; ++i )
+	{
+		RHI::BufferInfo buf_info = {};
+		buf_info.size = upload_size;
+		buffers.emplace_back( mgr.CreateInitializedBuffer( buf_info, src.data(), src.size(), last_token ) );
+	}
+	// end of the frame
+	mgr.Submit();
+	mgr.Wait( last_token );
+
+	// 16 MB of data, a submission per batch instead of one per buffer
+	const NullRHIStats stats = NullRHI_GetStats( *rhi );
+	BOOST_TEST( stats.GetCalls( NullRHICall::SubmitCommandLists ) <= 2u );
+	BOOST_TEST( stats.GetCalls( NullRHICall::CopyBuffer ) == upload_count );
+	BOOST_TEST( mgr.GetStats().ring_stalls == 0u );
+}
+
+BOOST_FIXTURE_TEST_CASE( blas_build_compaction, NullEngineFixture )
+{
+	GPUUploadManager mgr( 1024 * 1024, 1024 * 1024 );
+
+	std::vector<glm::vec3> vertices;
+	std::vector<uint16_t> indices;
+	for ( uint16_t i = 0; i < 64; ++i )
+	{
+		vertices.emplace_back( float( i ), 0.0f, 0.0f );
+		vertices.emplace_back( float( i ), 1.0f, 0.0f );
+		vertices.emplace_back( float( i ) + 1.0f, 0.0f, 0.0f );
+		for ( uint16_t j = 0; j < 3; ++j )
+			indices.push_back( uint16_t( i * 3 + j ) );
+	}
+
+	RHI::BufferInfo vertex_buf_info = {};
+	vertex_buf_info.size = vertices.size() * sizeof( glm::vec3 );
+	vertex_buf_info.usage = RHIBufferUsageFlags::AccelerationStructureInput;
+	GPUUploadManager::Token vertex_token = GPUUploadManager::CompletedToken;
+	RHIBufferPtr vertex_buf = mgr.CreateInitializedBuffer( vertex_buf_info, vertices.data(), vertex_buf_info.size, vertex_token );
+
+	RHI::BufferInfo index_buf_info = {};
+	index_buf_info.size = indices.size() * sizeof( uint16_t );
+	index_buf_info.usage = RHIBufferUsageFlags::AccelerationStructureInput;
+	GPUUploadManager::Token index_token = GPUUploadManager::CompletedToken;
+	RHIBufferPtr index_buf = mgr.CreateInitializedBuffer( index_buf_info, indices.data(), index_buf_info.size, index_token );
+
+	RHIASGeometryInfo geom = {};
+	geom.type = RHIASGeometryType::Triangles;
+	geom.triangles.idx_buf = index_buf.get();
+	geom.triangles.idx_type = RHIIndexBufferType::UInt16;
+	geom.triangles.vtx_buf = vertex_buf.get();
+	geom.triangles.vtx_format = RHIFormat::R32G32B32_SFLOAT;
+	geom.triangles.vtx_stride = sizeof( glm::vec3 );
+
+	NullRHI_ResetStats( *rhi );
+
+	GPUUploadManager::BLASPtr blas = mgr.BuildBLAS( geom );
+	BOOST_REQUIRE( blas != nullptr );
+	// built by the batch of the uploads
+	BOOST_TEST( blas->token == index_token );
+	const size_t built_size = blas->as->GetSize();
+
+	// the way assets poll their tokens, once per frame
+	const GPUUploadManager::Token build_token = blas->token;
+	for ( int frame = 0; frame < 10 && !mgr.IsCompleted( blas->token ); ++frame )
+	{
+		mgr.Submit();
+		mgr.Update();
+	}
+	BOOST_REQUIRE( mgr.IsCompleted( blas->token ) );
+	BOOST_TEST( blas->token > build_token );
+
+	const NullRHIStats stats = NullRHI_GetStats( *rhi );
+	BOOST_TEST( stats.GetCalls( NullRHICall::BuildAS ) == 1u );
+	BOOST_TEST( stats.GetCalls( NullRHICall::WriteCompactedASSizes ) == 1u );
+	BOOST_TEST( stats.GetCalls( NullRHICall::CompactAS ) == 1u );
+
+	BOOST_TEST( blas->as->GetSize() < built_size );
+	BOOST_TEST( mgr.GetStats().compacted_blas == 1u );
+	BOOST_TEST( mgr.GetStats().compaction_saved_bytes == built_size - blas->as->GetSize() );
+
+	// nobody holds the handle, the structure is not compacted
+	const size_t compactions = mgr.GetStats().compacted_blas;
+	mgr.BuildBLAS( geom );
+	mgr.WaitAll();
+	BOOST_TEST( mgr.GetStats().compacted_blas == compactions );
+}
+
+// Run explicitly with --run_test=gpu_upload_tests/benchmark_upload_batching --log_level=message
+BOOST_AUTO_TEST_CASE( benchmark_upload_batching, * boost::unit_test::disabled() )
+{
+	constexpr uint32_t latency_us = 200;
+	constexpr size_t upload_count = 1000;
+
+	RHIPtr rhi = CreateTestRHI( latency_us );
+	g_engine.rhi = rhi.get();
+
+	for ( size_t upload_size : { size_t( 256 ), size_t( 16 * 1024 ), size_t( 256 * 1024 ) } )
+	{
+		const std::vector<uint8_t> src( upload_size, 0x5a );
+		std::vector<RHIBufferPtr> buffers;
+		buffers.reserve( upload_count );
+
+		NullRHI_ResetStats( *rhi );
+		auto start = std::chrono::steady_clock::now();
+		for ( size_t i = 0; i < upload_count; ++i )
+		{
+			RHI::BufferInfo buf_info = {};
+			buf_info.size = upload_size;
+			buffers.emplace_back( RHIUtils::CreateInitializedGPUBuffer( buf_info, src.data(), src.size() ) );
+		}
+		const double flush_ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+		const uint64_t flush_submissions = NullRHI_GetStats( *rhi ).GetCalls( NullRHICall::SubmitCommandLists );
+
+		buffers.clear();
+		rhi->WaitIdle();
+
+		NullRHI_ResetStats( *rhi );
+		start = std::chrono::steady_clock::now();
+		{
+			GPUUploadManager mgr( 64 * 1024 * 1024, 16 * 1024 * 1024 );
+			GPUUploadManager::Token last_token = GPUUploadManager::CompletedToken;
+			for ( size_t i = 0; i < upload_count; ++i )
+			{
+				RHI::BufferInfo buf_info = {};
+				buf_info.size = upload_size;
+				buffers.emplace_back( mgr.CreateInitializedBuffer( buf_info, src.data(), src.size(), last_token ) );
+			}
+			mgr.Wait( last_token );
+		}
+		const double batched_ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+		const uint64_t batched_submissions = NullRHI_GetStats( *rhi ).GetCalls( NullRHICall::SubmitCommandLists );
+
+		buffers.clear();
+		rhi->WaitIdle();
+
+		BOOST_TEST_MESSAGE( upload_count << " uploads of " << upload_size << " bytes, gpu latency " << latency_us << " us: flush per buffer "
+			<< flush_ms << " ms, " << flush_submissions << " submissions; batched " << batched_ms << " ms, " << batched_submissions << " submissions" );
+	}
+
+	g_engine.rhi = nullptr;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,483 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <boost/test/unit_test.hpp>
+
+#include <Engine/MeshCooking.h>
+
+#include <utils/MemoryMappedFile.h>
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+	std::filesystem::path GetTestDirectory()
+	{
+		std::filesystem::path dir = std::filesystem::temp_directory_path() / "snow_engine_mesh_cooking_tests";
+		std::filesystem::create_directories( dir );
+		return dir;
+	}
+
+	// quads_x * quads_y quads in the xz plane, split into two submeshes
+	MeshImportData MakeGridMesh( uint32_t quads_x, uint32_t quads_y )
+	{
+		MeshImportData mesh;
+		for ( uint32_t y = 0; y <= quads_y; ++y )
+		{
+			for ( uint32_t x = 0; x <= quads_x; ++x )
+			{
+				MeshVertex vertex = {};
+				vertex.position = glm::vec3( float( x ), 0.01f * float( ( x * 7 + y * 13 ) % 17 ), float( y ) );
+				vertex.normal = glm::vec3( 0.0f, 1.0f, 0.0f );
+				vertex.uv = glm::vec2( float( x ) / float( quads_x ), float( y ) / float( quads_y ) );
+				mesh.vertices.push_back( vertex );
+			}
+		}
+		for ( uint32_t y = 0; y < quads_y; ++y )
+		{
+			for ( uint32_t x = 0; x < quads_x; ++x )
+			{
+				const uint32_t a = y * ( quads_x + 1 ) + x;
+				const uint32_t b = a + 1;
+				const uint32_t c = a + quads_x + 1;
+				const uint32_t d = c + 1;
+				mesh.indices.insert( mesh.indices.end(), { a, c, b, b, c, d } );
+			}
+		}
+
+		const uint32_t half = uint32_t( mesh.indices.size() / 6 * 3 );
+		mesh.submeshes.push_back( MeshSubmesh{ 0, half } );
+		mesh.submeshes.push_back( MeshSubmesh{ half, uint32_t( mesh.indices.size() ) - half } );
+		return mesh;
+	}
+
+	// same grid as an obj file with positions, normals and uvs, every face is a quad
+	void WriteGridObj( const std::filesystem::path& path, uint32_t quads_x, uint32_t quads_y )
+	{
+		std::ofstream file( path );
+		file << "o grid\n";
+		for ( uint32_t y = 0; y <= quads_y; ++y )
+			for ( uint32_t x = 0; x <= quads_x; ++x )
+				file << "v " << x << ' ' << 0.01f * float( ( x * 7 + y * 13 ) % 17 ) << ' ' << y << '\n';
+		for ( uint32_t y = 0; y <= quads_y; ++y )
+			for ( uint32_t x = 0; x <= quads_x; ++x )
+				file << "vt " << float( x ) / float( quads_x ) << ' ' << float( y ) / float( quads_y ) << '\n';
+		file << "vn 0 1 0\n";
+		for ( uint32_t y = 0; y < quads_y; ++y )
+		{
+			for ( uint32_t x = 0; x < quads_x; ++x )
+			{
+				const uint32_t a = y * ( quads_x + 1 ) + x + 1;
+				const uint32_t b = a + 1;
+				const uint32_t c = a + quads_x + 1;
+				const uint32_t d = c + 1;
+				file << "f " << a << '/' << a << "/1 " << c << '/' << c << "/1 " << d << '/' << d << "/1 " << b << '/' << b << "/1\n";
+			}
+		}
+	}
+
+	template<typename IndexT>
+	uint32_t ReadIndex( std::span<const uint8_t> index_data, size_t i )
+	{
+		IndexT index;
+		memcpy( &index, index_data.data() + i * sizeof( IndexT ), sizeof( IndexT ) );
+		return uint32_t( index );
+	}
+
+	void CheckCookedMesh( const CookedMeshView& cooked, const MeshImportData& mesh )
+	{
+		const CookedMeshHeader& header = cooked.GetHeader();
+		BOOST_TEST( header.num_vertices == mesh.vertices.size() );
+		BOOST_TEST( header.num_indices == mesh.indices.size() );
+		BOOST_TEST( header.index_size == ( mesh.vertices.size() <= 65536 ? 2u : 4u ) );
+
+		const std::span<const MeshVertex> vertices = cooked.GetVertices();
+		BOOST_TEST_REQUIRE( vertices.size() == mesh.vertices.size() );
+		BOOST_TEST( memcmp( vertices.data(), mesh.vertices.data(), vertices.size_bytes() ) == 0 );
+
+		const std::span<const uint8_t> index_data = cooked.GetIndexData();
+		for ( size_t i = 0; i < mesh.indices.size(); ++i )
+		{
+			const uint32_t index = header.index_size == 2 ? ReadIndex<uint16_t>( index_data, i ) : ReadIndex<uint32_t>( index_data, i );
+			BOOST_TEST_REQUIRE( index == mesh.indices[i] );
+		}
+
+		BOOST_TEST_REQUIRE( cooked.GetSubmeshes().size() == mesh.submeshes.size() );
+		for ( size_t i = 0; i < mesh.submeshes.size(); ++i )
+		{
+			BOOST_TEST( cooked.GetSubmeshes()[i].first_index == mesh.submeshes[i].first_index );
+			BOOST_TEST( cooked.GetSubmeshes()[i].num_indices == mesh.submeshes[i].num_indices );
+
+			// LOD 0 is the mesh itself
+			BOOST_TEST_REQUIRE( cooked.GetLODRanges().size() >= mesh.submeshes.size() );
+			BOOST_TEST( cooked.GetLODRanges()[i].first_index == mesh.submeshes[i].first_index );
+			BOOST_TEST( cooked.GetLODRanges()[i].num_indices == mesh.submeshes[i].num_indices );
+		}
+		BOOST_TEST_REQUIRE( cooked.GetLODErrors().size() == header.num_lods );
+		BOOST_TEST( cooked.GetLODErrors()[0] == 0.0f );
+
+		BVHBounds expected_bounds;
+		for ( const MeshVertex& vertex : mesh.vertices )
+			expected_bounds.Extend( &vertex.position.x );
+		const BVHBounds bounds = cooked.GetBounds();
+		for ( int axis = 0; axis < 3; ++axis )
+		{
+			BOOST_TEST( bounds.min[axis] == expected_bounds.min[axis] );
+			BOOST_TEST( bounds.max[axis] == expected_bounds.max[axis] );
+		}
+
+		// every section starts aligned, so the streams can be read in place
+		for ( uint64_t offset : { header.vertex_offset, header.index_offset, header.submesh_offset, header.bvh_offset, header.lod_error_offset, header.lod_range_offset,
+								  header.lod_index_offset, header.meshlet_offset, header.meshlet_bounds_offset, header.meshlet_vertex_offset, header.meshlet_triangle_offset } )
+			BOOST_TEST( offset % CookedMeshHeader::SectionAlignment == 0 );
+	}
+
+	double MillisecondsSince( std::chrono::steady_clock::time_point start )
+	{
+		return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+	}
+
+	// Both paths end with the data in an upload-sized scratch buffer, like MeshAsset passes it to the RHI.
+	// The cooked file has just been written, so the file cache is warm for both
+	void BenchmarkMeshLoad( const char* name, const std::filesystem::path& obj_path )
+	{
+		std::vector<uint8_t> upload;
+
+		auto start = std::chrono::steady_clock::now();
+		MeshImportData mesh;
+		BOOST_REQUIRE( ImportObj( obj_path.string().c_str(), mesh ) );
+		MeshBVH obj_bvh;
+		obj_bvh.Build( &mesh.vertices.data()->position, uint32_t( mesh.vertices.size() ), sizeof( MeshVertex ), mesh.indices.data(), uint32_t( mesh.indices.size() ) );
+		upload.resize( mesh.vertices.size() * sizeof( MeshVertex ) + mesh.indices.size() * sizeof( uint32_t ) );
+		memcpy( upload.data(), mesh.vertices.data(), mesh.vertices.size() * sizeof( MeshVertex ) );
+		memcpy( upload.data() + mesh.vertices.size() * sizeof( MeshVertex ), mesh.indices.data(), mesh.indices.size() * sizeof( uint32_t ) );
+		const double obj_ms = MillisecondsSince( start );
+
+		start = std::chrono::steady_clock::now();
+		std::vector<uint8_t> blob;
+		BOOST_REQUIRE( CookMesh( mesh, MeshCookSettings{}, blob ) );
+		std::filesystem::path cooked_path = obj_path;
+		cooked_path += ".semesh";
+		BOOST_REQUIRE( WriteCookedMesh( cooked_path.string().c_str(), blob ) );
+		const double cook_ms = MillisecondsSince( start );
+
+		start = std::chrono::steady_clock::now();
+		MemoryMappedFile file;
+		BOOST_REQUIRE( file.Open( cooked_path.string() ) );
+		CookedMeshView cooked;
+		BOOST_REQUIRE( cooked.Init( std::span<const uint8_t>( file.GetData().cbegin(), file.GetData().size() ) ) );
+		MeshBVH cooked_bvh;
+		BOOST_REQUIRE( cooked_bvh.Deserialize( cooked.GetBVHData().data(), cooked.GetBVHData().size() ) );
+		const size_t vertex_bytes = cooked.GetVertices().size_bytes();
+		upload.resize( vertex_bytes + cooked.GetIndexData().size() );
+		memcpy( upload.data(), cooked.GetVertices().data(), vertex_bytes );
+		memcpy( upload.data() + vertex_bytes, cooked.GetIndexData().data(), cooked.GetIndexData().size() );
+		const double cooked_ms = MillisecondsSince( start );
+
+		BOOST_TEST( cooked_bvh.GetNumNodes() == obj_bvh.GetNumNodes() );
+
+		const size_t num_triangles = mesh.indices.size() / 3;
+		BOOST_TEST_MESSAGE( name << ": " << num_triangles << " triangles, " << mesh.vertices.size() << " vertices, cooked size " << blob.size() / 1024 << " KB" );
+		BOOST_TEST_MESSAGE( "  obj load ms: " << obj_ms << ", cook ms: " << cook_ms << ", cooked load ms: " << cooked_ms );
+	}
+}
+
+BOOST_AUTO_TEST_SUITE( mesh_cooking_tests )
+
+BOOST_AUTO_TEST_CASE( cooked_mesh_roundtrip )
+{
+	// 16 bit indices, the largest mesh they can address, and 32 bit indices
+	for ( auto [quads_x, quads_y] : { std::pair{ 10u, 7u }, std::pair{ 255u, 255u }, std::pair{ 300u, 300u } } )
+	{
+		const MeshImportData mesh = MakeGridMesh( quads_x, quads_y );
+
+		for ( bool build_bvh : { true, false } )
+		{
+			// LODs and meshlets are optional sections too, they are left out with the BVH to keep the test short
+			MeshCookSettings settings;
+			settings.build_bvh = build_bvh;
+			settings.build_lods = build_bvh;
+			settings.build_meshlets = build_bvh;
+
+			std::vector<uint8_t> blob;
+			BOOST_TEST_REQUIRE( CookMesh( mesh, settings, blob ) );
+
+			CookedMeshView cooked;
+			BOOST_TEST_REQUIRE( cooked.Init( blob ) );
+			CheckCookedMesh( cooked, mesh );
+
+			BOOST_TEST( cooked.GetBVHData().empty() == !build_bvh );
+			BOOST_TEST( ( cooked.GetHeader().num_lods > 1 ) == build_bvh );
+			BOOST_TEST( cooked.GetMeshlets().empty() == !build_bvh );
+			if ( build_bvh )
+			{
+				MeshBVH bvh;
+				BOOST_TEST_REQUIRE( bvh.Deserialize( cooked.GetBVHData().data(), cooked.GetBVHData().size() ) );
+				BOOST_TEST( bvh.GetNumTriangles() == mesh.indices.size() / 3 );
+
+				BVHRay ray;
+				ray.origin[0] = 3.5f;
+				ray.origin[1] = 10.0f;
+				ray.origin[2] = 2.25f;
+				ray.direction[1] = -1.0f;
+				BVHHit hit;
+				BOOST_TEST( bvh.IntersectClosest( ray, hit ) );
+			}
+
+			// cooking is deterministic, the mapped file has the same bytes as the blob
+			const std::filesystem::path path = GetTestDirectory() / "roundtrip.semesh";
+			BOOST_TEST_REQUIRE( WriteCookedMesh( path.string().c_str(), blob ) );
+
+			MemoryMappedFile file;
+			BOOST_TEST_REQUIRE( file.Open( path.string() ) );
+			BOOST_TEST_REQUIRE( file.GetData().size() == blob.size() );
+			BOOST_TEST( memcmp( file.GetData().cbegin(), blob.data(), blob.size() ) == 0 );
+
+			CookedMeshView mapped;
+			BOOST_TEST_REQUIRE( mapped.Init( std::span<const uint8_t>( file.GetData().cbegin(), file.GetData().size() ) ) );
+			CheckCookedMesh( mapped, mesh );
+
+			std::vector<uint8_t> recooked;
+			BOOST_TEST_REQUIRE( CookMesh( mesh, settings, recooked ) );
+			BOOST_TEST( recooked == blob );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( invalid_cooked_mesh_is_rejected )
+{
+	const MeshImportData mesh = MakeGridMesh( 4, 4 );
+	std::vector<uint8_t> blob;
+	BOOST_TEST_REQUIRE( CookMesh( mesh, MeshCookSettings{}, blob ) );
+
+	auto init_modified = [&blob]( auto&& modify )
+	{
+		std::vector<uint8_t> modified = blob;
+		CookedMeshHeader header;
+		memcpy( &header, modified.data(), sizeof( header ) );
+		modify( header, modified );
+		memcpy( modified.data(), &header, sizeof( header ) );
+
+		CookedMeshView cooked;
+		return cooked.Init( modified );
+	};
+
+	BOOST_TEST( init_modified( []( CookedMeshHeader&, std::vector<uint8_t>& ) {} ) );
+	BOOST_TEST( !init_modified( []( CookedMeshHeader& header, std::vector<uint8_t>& ) { header.magic = 0; } ) );
+	BOOST_TEST( !init_modified( []( CookedMeshHeader& header, std::vector<uint8_t>& ) { header.version++; } ) );
+	BOOST_TEST( !init_modified( []( CookedMeshHeader&, std::vector<uint8_t>& data ) { data.pop_back(); } ) );
+	BOOST_TEST( !init_modified( []( CookedMeshHeader& header, std::vector<uint8_t>& ) { header.index_size = 1; } ) );
+	BOOST_TEST( !init_modified( []( CookedMeshHeader& header, std::vector<uint8_t>& ) { header.num_vertices = 1u << 30; } ) );
+	BOOST_TEST( !init_modified( []( CookedMeshHeader& header, std::vector<uint8_t>& ) { header.index_offset += 4; } ) );
+	BOOST_TEST( !init_modified( []( CookedMeshHeader& header, std::vector<uint8_t>& ) { header.bvh_size = ~0ull; } ) );
+	BOOST_TEST( !init_modified( []( CookedMeshHeader& header, std::vector<uint8_t>& data )
+	{
+		MeshSubmesh submesh = { header.num_indices - 3, 6 };
+		memcpy( data.data() + header.submesh_offset, &submesh, sizeof( submesh ) );
+	} ) );
+	BOOST_TEST( !init_modified( []( CookedMeshHeader& header, std::vector<uint8_t>& ) { header.num_lods = 0; } ) );
+	BOOST_TEST( !init_modified( []( CookedMeshHeader& header, std::vector<uint8_t>& data )
+	{
+		// ranges of LODs after the first one address the LOD index section
+		MeshLODRange range = { header.num_lod_indices, 3, 0, 0 };
+		memcpy( data.data() + header.lod_range_offset + sizeof( MeshLODRange ) * ( header.num_lods - 1 ) * header.num_submeshes, &range, sizeof( range ) );
+	} ) );
+	BOOST_TEST( !init_modified( []( CookedMeshHeader& header, std::vector<uint8_t>& data )
+	{
+		Meshlet meshlet = { header.num_meshlet_vertices - 1, 0, 3, 1 };
+		memcpy( data.data() + header.meshlet_offset, &meshlet, sizeof( meshlet ) );
+	} ) );
+
+	CookedMeshView cooked;
+	BOOST_TEST( !cooked.Init( std::span<const uint8_t>( blob.data(), sizeof( CookedMeshHeader ) - 1 ) ) );
+}
+
+BOOST_AUTO_TEST_CASE( obj_import )
+{
+	// two shapes with quads, vertices repeated inside the first shape are merged, the second one uses a different normal
+	const std::filesystem::path path = GetTestDirectory() / "import.obj";
+	{
+		std::ofstream file( path );
+		file << "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 2 0 0\nv 2 1 0\n";
+		file << "vn 0 0 1\nvn 0 0 -1\n";
+		file << "vt 0 0\nvt 1 1\n";
+		file << "o first\nf 1/1/1 2/1/1 3/2/1 4/2/1\nf 2/1/1 5/1/1 6/2/1 3/2/1\n";
+		file << "o second\nf 1/1/2 3/2/2 2/1/2\n";
+	}
+
+	MeshImportData mesh;
+	BOOST_TEST_REQUIRE( ImportObj( path.string().c_str(), mesh ) );
+
+	BOOST_TEST( mesh.indices.size() == 15u );
+	BOOST_TEST( mesh.vertices.size() == 9u );
+	BOOST_TEST_REQUIRE( mesh.submeshes.size() == 2u );
+	BOOST_TEST( mesh.submeshes[0].first_index == 0u );
+	BOOST_TEST( mesh.submeshes[0].num_indices == 12u );
+	BOOST_TEST( mesh.submeshes[1].first_index == 12u );
+	BOOST_TEST( mesh.submeshes[1].num_indices == 3u );
+
+	for ( uint32_t index : mesh.indices )
+		BOOST_TEST_REQUIRE( index < mesh.vertices.size() );
+
+	const MeshVertex& last = mesh.vertices[mesh.indices.back()];
+	BOOST_TEST( last.position.x == 1.0f );
+	BOOST_TEST( last.normal.z == -1.0f );
+	BOOST_TEST( last.uv.x == 0.0f );
+}
+
+BOOST_AUTO_TEST_CASE( mesh_optimization_keeps_submeshes )
+{
+	// triangles by positions, rotated to start from the smallest position so the winding is kept
+	auto get_triangles = []( const MeshImportData& mesh, const MeshSubmesh& submesh )
+	{
+		std::vector<std::array<float, 9>> triangles;
+		for ( uint32_t i = submesh.first_index; i < submesh.first_index + submesh.num_indices; i += 3 )
+		{
+			std::array<std::array<float, 3>, 3> corners;
+			for ( uint32_t corner = 0; corner < 3; ++corner )
+			{
+				const glm::vec3& p = mesh.vertices[mesh.indices[i + corner]].position;
+				corners[corner] = { p.x, p.y, p.z };
+			}
+			std::rotate( corners.begin(), std::min_element( corners.begin(), corners.end() ), corners.end() );
+			triangles.push_back( { corners[0][0], corners[0][1], corners[0][2], corners[1][0], corners[1][1], corners[1][2], corners[2][0], corners[2][1], corners[2][2] } );
+		}
+		std::sort( triangles.begin(), triangles.end() );
+		return triangles;
+	};
+
+	const MeshImportData mesh = MakeGridMesh( 40, 30 );
+	MeshImportData optimized = mesh;
+	// an unreferenced vertex is dropped
+	optimized.vertices.push_back( MeshVertex{} );
+	OptimizeMesh( optimized );
+
+	BOOST_TEST( optimized.vertices.size() == mesh.vertices.size() );
+	BOOST_TEST_REQUIRE( optimized.indices.size() == mesh.indices.size() );
+	BOOST_TEST_REQUIRE( optimized.submeshes.size() == mesh.submeshes.size() );
+	for ( size_t i = 0; i < mesh.submeshes.size(); ++i )
+	{
+		BOOST_TEST( optimized.submeshes[i].first_index == mesh.submeshes[i].first_index );
+		BOOST_TEST( optimized.submeshes[i].num_indices == mesh.submeshes[i].num_indices );
+		BOOST_TEST( ( get_triangles( optimized, optimized.submeshes[i] ) == get_triangles( mesh, mesh.submeshes[i] ) ) );
+	}
+
+	std::vector<uint8_t> blob;
+	BOOST_TEST_REQUIRE( CookMesh( optimized, MeshCookSettings{}, blob ) );
+	CookedMeshView cooked;
+	BOOST_TEST_REQUIRE( cooked.Init( blob ) );
+	CheckCookedMesh( cooked, optimized );
+}
+
+BOOST_AUTO_TEST_CASE( cooked_mesh_lods )
+{
+	MeshImportData mesh = MakeGridMesh( 60, 40 );
+	OptimizeMesh( mesh );
+
+	std::vector<uint8_t> blob;
+	BOOST_TEST_REQUIRE( CookMesh( mesh, MeshCookSettings{}, blob ) );
+	CookedMeshView cooked;
+	BOOST_TEST_REQUIRE( cooked.Init( blob ) );
+	CheckCookedMesh( cooked, mesh );
+
+	const CookedMeshHeader& header = cooked.GetHeader();
+	const std::span<const float> errors = cooked.GetLODErrors();
+	const std::span<const MeshLODRange> ranges = cooked.GetLODRanges();
+	BOOST_TEST_REQUIRE( header.num_lods > 2u );
+	BOOST_TEST_REQUIRE( ranges.size() == header.num_lods * mesh.submeshes.size() );
+
+	auto get_indices = [&]( uint32_t lod, uint32_t submesh )
+	{
+		const MeshLODRange& range = ranges[lod * mesh.submeshes.size() + submesh];
+		const std::span<const uint8_t> index_data = lod == 0 ? cooked.GetIndexData() : cooked.GetLODIndexData();
+		std::vector<uint32_t> indices;
+		for ( uint32_t i = range.first_index; i < range.first_index + range.num_indices; ++i )
+			indices.push_back( header.index_size == 2 ? ReadIndex<uint16_t>( index_data, i ) : ReadIndex<uint32_t>( index_data, i ) );
+		return indices;
+	};
+
+	// the submeshes share the middle row of the grid, it is locked so the LODs of both halves still meet there
+	std::vector<uint32_t> shared_vertices;
+	{
+		const std::vector<uint32_t> first = get_indices( 0, 0 );
+		const std::vector<uint32_t> second = get_indices( 0, 1 );
+		for ( uint32_t vertex : first )
+			if ( std::find( second.begin(), second.end(), vertex ) != second.end() )
+				shared_vertices.push_back( vertex );
+		std::sort( shared_vertices.begin(), shared_vertices.end() );
+		shared_vertices.erase( std::unique( shared_vertices.begin(), shared_vertices.end() ), shared_vertices.end() );
+	}
+	BOOST_TEST( shared_vertices.size() == 61u );
+
+	size_t previous_num_indices = mesh.indices.size();
+	for ( uint32_t lod = 0; lod < header.num_lods; ++lod )
+	{
+		if ( lod > 0 )
+			BOOST_TEST( errors[lod] >= errors[lod - 1] );
+
+		size_t num_indices = 0;
+		for ( uint32_t submesh = 0; submesh < mesh.submeshes.size(); ++submesh )
+		{
+			const std::vector<uint32_t> indices = get_indices( lod, submesh );
+			num_indices += indices.size();
+			for ( uint32_t index : indices )
+				BOOST_TEST_REQUIRE( index < mesh.vertices.size() );
+			for ( uint32_t vertex : shared_vertices )
+				BOOST_TEST_REQUIRE( ( std::find( indices.begin(), indices.end(), vertex ) != indices.end() ) );
+
+			// meshlets of the range hold the same triangles
+			const MeshLODRange& range = ranges[lod * mesh.submeshes.size() + submesh];
+			std::vector<std::array<uint32_t, 3>> triangles;
+			for ( size_t i = 0; i < indices.size(); i += 3 )
+				triangles.push_back( { indices[i], indices[i + 1], indices[i + 2] } );
+			std::vector<std::array<uint32_t, 3>> meshlet_triangles;
+			for ( uint32_t meshlet_idx = range.first_meshlet; meshlet_idx < range.first_meshlet + range.num_meshlets; ++meshlet_idx )
+			{
+				const Meshlet& meshlet = cooked.GetMeshlets()[meshlet_idx];
+				BOOST_TEST_REQUIRE( meshlet.num_vertices <= MaxMeshletVertices );
+				BOOST_TEST_REQUIRE( meshlet.num_triangles <= MaxMeshletTriangles );
+				for ( uint32_t triangle = 0; triangle < meshlet.num_triangles; ++triangle )
+				{
+					const uint8_t* local = cooked.GetMeshletTriangles().data() + meshlet.triangle_offset + triangle * 3;
+					const uint32_t* vertices = cooked.GetMeshletVertices().data() + meshlet.vertex_offset;
+					meshlet_triangles.push_back( { vertices[local[0]], vertices[local[1]], vertices[local[2]] } );
+				}
+			}
+			BOOST_TEST( ( meshlet_triangles == triangles ) );
+		}
+
+		BOOST_TEST( num_indices < previous_num_indices * ( lod == 0 ? 2 : 1 ) );
+		previous_num_indices = num_indices;
+	}
+	BOOST_TEST( cooked.GetMeshletBounds().size() == cooked.GetMeshlets().size() );
+}
+
+// Run explicitly with --run_test=mesh_cooking_tests/benchmark_mesh_load --log_level=message
+BOOST_AUTO_TEST_CASE( benchmark_mesh_load, * boost::unit_test::disabled() )
+{
+	const std::filesystem::path bunny_path = "../EngineContent/Meshes/bunny_with_normals.obj";
+	if ( std::filesystem::exists( bunny_path ) )
+	{
+		const std::filesystem::path bunny_copy = GetTestDirectory() / "bunny.obj";
+		std::filesystem::copy_file( bunny_path, bunny_copy, std::filesystem::copy_options::overwrite_existing );
+		BenchmarkMeshLoad( "bunny", bunny_copy );
+	}
+	else
+	{
+		BOOST_TEST_MESSAGE( "bunny_with_normals.obj is not found, skipped" );
+	}
+
+	// 1581 * 1582 quads, 5M triangles
+	const std::filesystem::path grid_path = GetTestDirectory() / "grid_5m.obj";
+	WriteGridObj( grid_path, 1581, 1582 );
+	BenchmarkMeshLoad( "grid", grid_path );
+
+	// both files take a few hundred MB
+	std::filesystem::remove( grid_path );
+	std::filesystem::remove( std::filesystem::path( grid_path ).concat( ".semesh" ) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
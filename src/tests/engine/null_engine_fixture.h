@@ -0,0 +1,128 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#pragma once
+
+#include <boost/test/unit_test.hpp>
+
+#include <NullRHI/NullRHI.h>
+
+#include <Engine/AssetManager.h>
+#include <Engine/Rendergraph.h>
+#include <Engine/RHIUtils.h>
+#include <Engine/Scene.h>
+
+#include <filesystem>
+#include <fstream>
+
+// Helpers shared by the engine tests that run on the null RHI. Globals are defined in null_rhi.cpp
+
+inline RHIPtr CreateTestRHI( uint32_t gpu_latency_us = 0 )
+{
+	NullRHICreateInfo create_info = {};
+	create_info.gpu_latency_us = gpu_latency_us;
+	create_info.logger = g_log;
+	create_info.core_paths = &g_core_paths;
+
+	return CreateNullRHI_RAII( create_info );
+}
+
+inline void WriteTextFile( const std::filesystem::path& path, const char* contents )
+{
+	std::filesystem::create_directories( path.parent_path() );
+	std::ofstream file( path );
+	file << contents;
+}
+
+// Minimal engine content needed by Renderer::LoadDefaultAssets and a single cube mesh
+inline std::string CreateTestEngineContent()
+{
+	std::filesystem::path content = std::filesystem::temp_directory_path() / "snow_engine_null_rhi_tests";
+
+	WriteTextFile( content / "Meshes/Cube.sea", R"({ "_generator": "CubeAsset" })" );
+	WriteTextFile( content / "Materials/Default.sea", R"({ "_generator": "MaterialAsset", "parms": { "roughness": 0.5, "albedo": [ 0.8, 0.8, 0.8 ], "f0": [ 0.04, 0.04, 0.04 ] } })" );
+	WriteTextFile( content / "Textures/Missing.sea", R"({ "_generator": "TextureAsset", "source": "#engine/Textures/Missing.png" })" );
+
+	const uint8_t magenta[4] = { 255, 0, 255, 255 };
+	std::string png_path = ( content / "Textures/Missing.png" ).string();
+	stbi_write_png( png_path.c_str(), 1, 1, 4, magenta, 4 );
+
+	// ToOSPath appends the path after #engine/ as is
+	return content.string() + "/";
+}
+
+inline Transform MakeGridTransform( int i, float offset = 0.0f )
+{
+	Transform tf = {};
+	tf.translation = glm::vec3( float( i % 32 ), float( i / 32 ), offset );
+	return tf;
+}
+
+
+struct NullEngineFixture
+{
+	RHIPtr rhi = { nullptr, DestroyNullRHI };
+	std::unique_ptr<AssetManager> asset_mgr;
+	std::unique_ptr<GPUUploadManager> upload_mgr;
+	std::unique_ptr<Renderer> renderer;
+
+	NullEngineFixture()
+	{
+		g_core_paths.engine_content = CreateTestEngineContent();
+
+		Logger::CreateInfo log_info = {};
+		log_info.mirror_to_stdout = false;
+		g_log = new Logger( log_info );
+
+		rhi = CreateTestRHI();
+		g_engine.rhi = rhi.get();
+
+		asset_mgr = std::make_unique<AssetManager>();
+		g_engine.asset_mgr = asset_mgr.get();
+
+		upload_mgr = std::make_unique<GPUUploadManager>( 8 * 1024 * 1024, 4 * 1024 * 1024 );
+		g_engine.upload_mgr = upload_mgr.get();
+
+		renderer = std::make_unique<Renderer>();
+		g_engine.renderer = renderer.get();
+
+		BOOST_REQUIRE( renderer->LoadDefaultAssets() );
+	}
+
+	~NullEngineFixture()
+	{
+		rhi->WaitIdle();
+
+		g_engine.renderer = nullptr;
+		renderer = nullptr;
+
+		g_engine.asset_mgr = nullptr;
+		asset_mgr = nullptr;
+
+		g_engine.upload_mgr = nullptr;
+		upload_mgr = nullptr;
+
+		g_engine.rhi = nullptr;
+		rhi = nullptr;
+
+		delete g_log;
+		g_log = nullptr;
+	}
+
+	RHIFence RenderFrame( SceneView& view, Rendergraph& rg, RHIBuffer* readback_buffer )
+	{
+		rg.Reset();
+
+		view.GetScene().Synchronize();
+
+		RenderSceneParams parms = {};
+		parms.view = &view;
+		parms.rg = &rg;
+		parms.readback_buffer = readback_buffer;
+		BOOST_REQUIRE( renderer->RenderScene( parms ) );
+
+		const RHIFence fence = rg.Submit( RGSubmitInfo{} );
+		renderer->GetGlobalDescriptors().OnFrameSubmitted( fence );
+		return fence;
+	}
+};
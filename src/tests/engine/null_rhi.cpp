@@ -0,0 +1,350 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "null_engine_fixture.h"
+
+#include <chrono>
+#include <random>
+
+CorePaths g_core_paths;
+Logger* g_log;
+EngineGlobals g_engine;
+ConsoleVariableBase* g_cvars_head = nullptr;
+
+CVAR_EXTERN( r_tlasRefitMaxQualityLossPercent, uint32_t );
+
+BOOST_AUTO_TEST_SUITE( null_rhi_tests )
+
+BOOST_AUTO_TEST_CASE( buffer_copy_roundtrip )
+{
+	RHIPtr rhi = CreateTestRHI();
+
+	constexpr size_t size = 256;
+
+	RHI::BufferInfo buf_info = {};
+	buf_info.size = size;
+	buf_info.usage = RHIBufferUsageFlags::TransferSrc | RHIBufferUsageFlags::TransferDst;
+
+	RHIUploadBufferPtr upload = rhi->CreateUploadBuffer( buf_info );
+	RHIBufferPtr device = rhi->CreateDeviceBuffer( buf_info );
+	RHIReadbackBufferPtr readback = rhi->CreateReadbackBuffer( buf_info );
+
+	std::vector<uint8_t> src( size );
+	for ( size_t i = 0; i < size; ++i )
+		src[i] = uint8_t( i * 7 );
+	upload->WriteBytes( src.data(), size, 0 );
+
+	RHICommandList* cmd_list = rhi->GetCommandList( RHI::QueueType::Graphics );
+	cmd_list->Begin();
+	RHICommandList::CopyRegion region = {};
+	region.size = size;
+	cmd_list->CopyBuffer( *upload->GetBuffer(), *device, 1, &region );
+	cmd_list->CopyBuffer( *device, *readback->GetBuffer(), 1, &region );
+	cmd_list->End();
+
+	RHI::SubmitInfo submit_info = {};
+	submit_info.cmd_list_count = 1;
+	submit_info.cmd_lists = &cmd_list;
+	rhi->WaitForFenceCompletion( rhi->SubmitCommandLists( submit_info ) );
+
+	std::vector<uint8_t> dst( size );
+	readback->ReadBytes( dst.data(), size, 0 );
+	BOOST_TEST( src == dst, boost::test_tools::per_element() );
+
+	NullRHIStats stats = NullRHI_GetStats( *rhi );
+	BOOST_TEST( stats.GetCalls( NullRHICall::CopyBuffer ) == 2 );
+	BOOST_TEST( stats.GetCalls( NullRHICall::SubmitCommandLists ) == 1 );
+	BOOST_TEST( stats.submitted_cmd_lists == 1 );
+	BOOST_TEST( stats.recorded_bytes > 0 );
+}
+
+BOOST_AUTO_TEST_CASE( fence_latency )
+{
+	constexpr uint32_t latency_us = 20000;
+	RHIPtr rhi = CreateTestRHI( latency_us );
+
+	RHICommandList* cmd_list = rhi->GetCommandList( RHI::QueueType::Graphics );
+	cmd_list->Begin();
+	cmd_list->End();
+
+	RHI::SubmitInfo submit_info = {};
+	submit_info.cmd_list_count = 1;
+	submit_info.cmd_lists = &cmd_list;
+
+	const auto start = std::chrono::steady_clock::now();
+	RHIFence fence = rhi->SubmitCommandLists( submit_info );
+	rhi->WaitForFenceCompletion( fence );
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+
+	BOOST_TEST( std::chrono::duration_cast<std::chrono::microseconds>( elapsed ).count() >= latency_us );
+
+	// already signaled fences return immediately
+	const auto start_signaled = std::chrono::steady_clock::now();
+	rhi->WaitForFenceCompletion( fence );
+	BOOST_TEST( std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - start_signaled ).count() < latency_us );
+}
+
+BOOST_AUTO_TEST_CASE( deferred_destruction_waits_for_gpu )
+{
+	RHIPtr rhi = CreateTestRHI( 10000 );
+
+	RHI::BufferInfo buf_info = {};
+	buf_info.size = 1024;
+	buf_info.usage = RHIBufferUsageFlags::TransferDst;
+
+	RHIBufferPtr buffer = rhi->CreateDeviceBuffer( buf_info );
+	BOOST_TEST( NullRHI_GetStats( *rhi ).allocated_buffer_memory == 1024 );
+
+	RHICommandList* cmd_list = rhi->GetCommandList( RHI::QueueType::Graphics );
+	cmd_list->Begin();
+	cmd_list->End();
+
+	RHI::SubmitInfo submit_info = {};
+	submit_info.cmd_list_count = 1;
+	submit_info.cmd_lists = &cmd_list;
+	rhi->SubmitCommandLists( submit_info );
+
+	// the submission is still in flight, so the buffer must survive its last reference
+	buffer = nullptr;
+	BOOST_TEST( NullRHI_GetStats( *rhi ).allocated_buffer_memory == 1024 );
+
+	rhi->WaitIdle();
+	BOOST_TEST( NullRHI_GetStats( *rhi ).allocated_buffer_memory == 0 );
+}
+
+BOOST_FIXTURE_TEST_CASE( renderer_frame, NullEngineFixture )
+{
+	Scene scene;
+	BOOST_REQUIRE( scene.AddMeshInstanceFromAsset( LoadAsset<MeshAsset>( "#engine/Meshes/Cube.sea" ) ) != SceneMeshInstanceID::nullid );
+
+	SceneView view( &scene );
+	view.SetExtents( glm::uvec2( 320, 240 ) );
+	view.SetLookAt( glm::vec3( 3, 3, 3 ), glm::vec3( 0, 0, 0 ) );
+
+	RHIReadbackBufferPtr readback = renderer->CreateViewFrameReadbackBuffer();
+
+	Rendergraph rg;
+
+	NullRHI_ResetStats( *rhi );
+	rhi->WaitForFenceCompletion( RenderFrame( view, rg, readback->GetBuffer() ) );
+
+	NullRHIStats stats = NullRHI_GetStats( *rhi );
+	BOOST_TEST( stats.GetCalls( NullRHICall::TraceRays ) == 1 );
+	BOOST_TEST( stats.GetCalls( NullRHICall::BuildAS ) >= 1 );
+	BOOST_TEST( stats.submitted_cmd_lists > 0 );
+}
+
+// Run explicitly with --run_test=null_rhi_tests/benchmark_frame --log_level=message
+BOOST_FIXTURE_TEST_CASE( benchmark_frame, NullEngineFixture, * boost::unit_test::disabled() )
+{
+	constexpr int mesh_count = 1000;
+	constexpr int frame_count = 200;
+
+	Scene scene;
+	MeshAssetPtr cube = LoadAsset<MeshAsset>( "#engine/Meshes/Cube.sea" );
+	for ( int i = 0; i < mesh_count; ++i )
+	{
+		SceneMeshInstanceID id = scene.AddMeshInstanceFromAsset( cube );
+		scene.SetMeshInstanceTransform( id, MakeGridTransform( i ) );
+	}
+
+	SceneView view( &scene );
+	view.SetExtents( glm::uvec2( 1280, 720 ) );
+
+	RHIReadbackBufferPtr readback = renderer->CreateViewFrameReadbackBuffer();
+
+	Rendergraph rg;
+
+	// warmup, creates view render targets and pipelines
+	rhi->WaitForFenceCompletion( RenderFrame( view, rg, readback->GetBuffer() ) );
+	NullRHI_ResetStats( *rhi );
+
+	const auto start = std::chrono::steady_clock::now();
+	for ( int i = 0; i < frame_count; ++i )
+		rhi->WaitForFenceCompletion( RenderFrame( view, rg, readback->GetBuffer() ) );
+	const double ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+
+	const NullRHIStats stats = NullRHI_GetStats( *rhi );
+	BOOST_TEST_MESSAGE( "meshes: " << mesh_count << " frames: " << frame_count << " cpu ms/frame: " << ms / frame_count );
+	for ( size_t i = 0; i < size_t( NullRHICall::Count ); ++i )
+	{
+		if ( stats.calls[i] > 0 )
+			BOOST_TEST_MESSAGE( "  " << NullRHI_GetCallName( NullRHICall( i ) ) << ": " << stats.calls[i] / frame_count << " per frame" );
+	}
+	BOOST_TEST_MESSAGE( "  recorded bytes per frame: " << stats.recorded_bytes / frame_count );
+}
+
+BOOST_FIXTURE_TEST_CASE( incremental_tlas_updates, NullEngineFixture )
+{
+	constexpr int mesh_count = 1000;
+
+	Scene scene;
+	MeshAssetPtr cube = LoadAsset<MeshAsset>( "#engine/Meshes/Cube.sea" );
+	std::vector<SceneMeshInstanceID> ids;
+	for ( int i = 0; i < mesh_count; ++i )
+	{
+		ids.emplace_back( scene.AddMeshInstanceFromAsset( cube ) );
+		scene.SetMeshInstanceTransform( ids.back(), MakeGridTransform( i ) );
+	}
+
+	SceneView view( &scene );
+	view.SetExtents( glm::uvec2( 320, 240 ) );
+
+	RHIReadbackBufferPtr readback = renderer->CreateViewFrameReadbackBuffer();
+
+	Rendergraph rg;
+
+	const TLAS& tlas = scene.GetTLAS();
+
+	// the first frames fill the ring of instance buffers
+	for ( int i = 0; i < 3; ++i )
+	{
+		rhi->WaitForFenceCompletion( RenderFrame( view, rg, readback->GetBuffer() ) );
+		BOOST_TEST( ( tlas.GetLastBuildStats().type == ( i == 0 ? TLAS::BuildType::Build : TLAS::BuildType::Skipped ) ) );
+	}
+
+	// nothing changed, nothing is uploaded or built. Setting the same transform again is not a change
+	NullRHI_ResetStats( *rhi );
+	scene.SetMeshInstanceTransform( ids[0], MakeGridTransform( 0 ) );
+	rhi->WaitForFenceCompletion( RenderFrame( view, rg, readback->GetBuffer() ) );
+	BOOST_TEST( ( tlas.GetLastBuildStats().type == TLAS::BuildType::Skipped ) );
+	BOOST_TEST( NullRHI_GetStats( *rhi ).GetCalls( NullRHICall::BuildAS ) == 0 );
+	BOOST_TEST( NullRHI_GetStats( *rhi ).uploaded_as_instances == 0 );
+
+	// 1% moved, the structure is refit and only changed ranges are uploaded
+	NullRHI_ResetStats( *rhi );
+	for ( int i = 0; i < mesh_count / 100; ++i )
+		scene.SetMeshInstanceTransform( ids[i * 100], MakeGridTransform( i * 100, 1.0f ) );
+	rhi->WaitForFenceCompletion( RenderFrame( view, rg, readback->GetBuffer() ) );
+	BOOST_TEST( ( tlas.GetLastBuildStats().type == TLAS::BuildType::Refit ) );
+	BOOST_TEST( tlas.GetLastBuildStats().moved_instances == mesh_count / 100 );
+	BOOST_TEST( NullRHI_GetStats( *rhi ).as_updates == 1 );
+	BOOST_TEST( NullRHI_GetStats( *rhi ).uploaded_as_instances == mesh_count / 100 );
+	for ( int i = 0; i < mesh_count / 100; ++i )
+	{
+		const size_t packed_idx = tlas.Instances().get_packed_idx( scene.GetMeshInstance( ids[i * 100] )->GetTLASInstance() );
+		BOOST_TEST( tlas.Instances().data()[packed_idx].transform[2][3] == 1.0f );
+	}
+
+	// most instances moved, refit would degrade the structure too much
+	for ( int i = 0; i < mesh_count / 2; ++i )
+		scene.SetMeshInstanceTransform( ids[i], MakeGridTransform( i, 2.0f ) );
+	rhi->WaitForFenceCompletion( RenderFrame( view, rg, readback->GetBuffer() ) );
+	BOOST_TEST( ( tlas.GetLastBuildStats().type == TLAS::BuildType::Build ) );
+
+	// small moves keep refitting until the accumulated quality loss calls for a rebuild
+	std::mt19937 rng( 7 );
+	int refits = 0;
+	for ( int frame = 0; frame < 100; ++frame )
+	{
+		for ( int i = 0; i < mesh_count / 100; ++i )
+			scene.SetMeshInstanceTransform( ids[rng() % mesh_count], MakeGridTransform( frame, float( frame + 3 ) ) );
+		rhi->WaitForFenceCompletion( RenderFrame( view, rg, readback->GetBuffer() ) );
+		if ( tlas.GetLastBuildStats().type != TLAS::BuildType::Refit )
+			break;
+
+		refits++;
+		BOOST_TEST( tlas.GetLastBuildStats().refit_quality_loss * 100.0f <= float( r_tlasRefitMaxQualityLossPercent.GetValue() ) );
+	}
+	BOOST_TEST( ( tlas.GetLastBuildStats().type == TLAS::BuildType::Build ) );
+	BOOST_TEST( refits > 1 );
+
+	// removal moves the last instance into the freed slot, the set of instances changed so the structure is rebuilt
+	const uint64_t params_range = scene.GetGPUInstanceParams().range;
+	scene.RemoveMeshInstance( ids[10] );
+	rhi->WaitForFenceCompletion( RenderFrame( view, rg, readback->GetBuffer() ) );
+	BOOST_TEST( ( tlas.GetLastBuildStats().type == TLAS::BuildType::Build ) );
+	BOOST_TEST( tlas.Instances().size() == mesh_count - 1 );
+	BOOST_TEST( scene.GetGPUInstanceParams().range * mesh_count == params_range * ( mesh_count - 1 ) );
+	BOOST_TEST( tlas.Instances().get_packed_idx( scene.GetMeshInstance( ids.back() )->GetTLASInstance() ) == 10 );
+}
+
+// Run explicitly with --run_test=null_rhi_tests/benchmark_tlas_updates --log_level=message
+BOOST_FIXTURE_TEST_CASE( benchmark_tlas_updates, NullEngineFixture, * boost::unit_test::disabled() )
+{
+	constexpr int mesh_count = 100000;
+	constexpr int moved_per_frame = mesh_count / 100;
+	constexpr int frame_count = 200;
+
+	Scene scene;
+	MeshAssetPtr cube = LoadAsset<MeshAsset>( "#engine/Meshes/Cube.sea" );
+	std::vector<SceneMeshInstanceID> ids;
+	ids.reserve( mesh_count );
+	for ( int i = 0; i < mesh_count; ++i )
+	{
+		ids.emplace_back( scene.AddMeshInstanceFromAsset( cube ) );
+		scene.SetMeshInstanceTransform( ids.back(), MakeGridTransform( i ) );
+	}
+
+	SceneView view( &scene );
+	view.SetExtents( glm::uvec2( 1280, 720 ) );
+
+	RHIReadbackBufferPtr readback = renderer->CreateViewFrameReadbackBuffer();
+
+	Rendergraph rg;
+
+	// warmup, creates view render targets, pipelines and the ring of instance buffers
+	for ( int i = 0; i < 3; ++i )
+		rhi->WaitForFenceCompletion( RenderFrame( view, rg, readback->GetBuffer() ) );
+	NullRHI_ResetStats( *rhi );
+
+	std::mt19937 rng( 1 );
+	int builds = 0;
+	int refits = 0;
+	double render_ms = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+	for ( int frame = 0; frame < frame_count; ++frame )
+	{
+		for ( int i = 0; i < moved_per_frame; ++i )
+			scene.SetMeshInstanceTransform( ids[rng() % mesh_count], MakeGridTransform( int( rng() % mesh_count ), float( frame ) ) );
+
+		const auto render_start = std::chrono::steady_clock::now();
+		rhi->WaitForFenceCompletion( RenderFrame( view, rg, readback->GetBuffer() ) );
+		render_ms += std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - render_start ).count();
+
+		builds += scene.GetTLAS().GetLastBuildStats().type == TLAS::BuildType::Build ? 1 : 0;
+		refits += scene.GetTLAS().GetLastBuildStats().type == TLAS::BuildType::Refit ? 1 : 0;
+	}
+	const double ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+
+	const NullRHIStats stats = NullRHI_GetStats( *rhi );
+	BOOST_TEST_MESSAGE( "meshes: " << mesh_count << " moved per frame: " << moved_per_frame << " frames: " << frame_count );
+	BOOST_TEST_MESSAGE( "  cpu ms/frame: " << ms / frame_count << " (render: " << render_ms / frame_count << ")" );
+	BOOST_TEST_MESSAGE( "  tlas builds: " << builds << " refits: " << refits );
+	BOOST_TEST_MESSAGE( "  uploaded tlas instances per frame: " << stats.uploaded_as_instances / frame_count );
+}
+
+BOOST_FIXTURE_TEST_CASE( cooked_mesh_asset, NullEngineFixture )
+{
+	const std::filesystem::path meshes = std::filesystem::path( g_core_paths.engine_content ) / "Meshes";
+	std::filesystem::remove( meshes / "Quads.obj.semesh" );
+	WriteTextFile( meshes / "Quads.obj", "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 2 0 0\nv 2 1 0\nf 1 2 3 4\nf 2 5 6 3\n" );
+	WriteTextFile( meshes / "Quads.sea", R"({ "_generator": "MeshAsset", "source": "#engine/Meshes/Quads.obj", "material": "#engine/Materials/Default.sea" })" );
+	WriteTextFile( meshes / "QuadsCooked.sea", R"({ "_generator": "MeshAsset", "source": "#engine/Meshes/Quads.obj.semesh", "material": "#engine/Materials/Default.sea" })" );
+
+	// the first load cooks the obj, the second asset is loaded straight from the cooked file
+	MeshAssetPtr from_obj = LoadAsset<MeshAsset>( "#engine/Meshes/Quads.sea" );
+	BOOST_REQUIRE( from_obj != nullptr );
+	BOOST_TEST( std::filesystem::exists( meshes / "Quads.obj.semesh" ) );
+
+	MeshAssetPtr from_cooked = LoadAsset<MeshAsset>( "#engine/Meshes/QuadsCooked.sea" );
+	BOOST_REQUIRE( from_cooked != nullptr );
+
+	for ( const MeshAsset* mesh : { from_obj.get(), from_cooked.get() } )
+	{
+		BOOST_TEST( mesh->GetNumIndices() == 12u );
+		BOOST_TEST( ( mesh->GetIndexBufferType() == RHIIndexBufferType::UInt16 ) );
+		BOOST_TEST( mesh->GetCPUBVH().GetNumTriangles() == 4u );
+		BOOST_TEST( mesh->GetCPUBVH().GetBounds().max[0] == 2.0f );
+
+		BVHRay ray;
+		ray.origin[0] = 1.5f;
+		ray.origin[1] = 0.5f;
+		ray.origin[2] = -1.0f;
+		ray.direction[2] = 1.0f;
+		BOOST_TEST( mesh->GetCPUBVH().IntersectAny( ray ) );
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
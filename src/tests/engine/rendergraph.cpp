@@ -0,0 +1,1664 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <boost/test/unit_test.hpp>
+
+#include <NullRHI/NullRHI.h>
+
+#include <Engine/Rendergraph.h>
+#include <Engine/TransientResourceAllocator.h>
+
+#include <utils/TaskScheduler.h>
+
+#include <chrono>
+#include <map>
+#include <numeric>
+#include <random>
+#include <sstream>
+
+CVAR_EXTERN( rg_asyncQueues, int );
+CVAR_EXTERN( rg_cacheCompiledGraphs, int );
+CVAR_EXTERN( rg_cullPasses, int );
+CVAR_EXTERN( rg_optimizeBarriers, int );
+
+namespace
+{
+	using Request = TransientResourceAllocator::Request;
+
+	void CheckPlacements( std::span<const Request> requests, const TransientResourceAllocator::Result& result )
+	{
+		BOOST_REQUIRE( result.placements.size() == requests.size() );
+
+		for ( size_t i = 0; i < requests.size(); ++i )
+		{
+			const auto& placement = result.placements[i];
+			BOOST_REQUIRE( placement.heap < result.heap_sizes.size() );
+			BOOST_TEST( placement.offset % requests[i].alignment == 0 );
+			BOOST_TEST( placement.offset + requests[i].size <= result.heap_sizes[placement.heap] );
+
+			for ( size_t j = i + 1; j < requests.size(); ++j )
+			{
+				const auto& other = result.placements[j];
+				if ( other.heap != placement.heap )
+					continue;
+
+				const bool lifetimes_overlap = requests[i].first_pass <= requests[j].last_pass && requests[j].first_pass <= requests[i].last_pass;
+				const bool memory_overlaps = placement.offset < other.offset + requests[j].size && other.offset < placement.offset + requests[i].size;
+				BOOST_TEST( !( lifetimes_overlap && memory_overlaps ), "requests " << i << " and " << j << " are alive at the same time and share memory" );
+			}
+		}
+	}
+
+	struct NullRHIFixture
+	{
+		RHIPtr rhi = { nullptr, DestroyNullRHI };
+
+		NullRHIFixture( bool enable_async_queues = true, std::function<void( const NullRHIExecutedCommand& )> command_observer = {} )
+		{
+			Logger::CreateInfo log_info = {};
+			log_info.mirror_to_stdout = false;
+			g_log = new Logger( log_info );
+
+			NullRHICreateInfo create_info = {};
+			create_info.logger = g_log;
+			create_info.core_paths = &g_core_paths;
+			create_info.enable_async_queues = enable_async_queues;
+			create_info.command_observer = std::move( command_observer );
+			rhi = CreateNullRHI_RAII( create_info );
+			g_engine.rhi = rhi.get();
+		}
+
+		~NullRHIFixture()
+		{
+			rhi->WaitIdle();
+
+			g_engine.rhi = nullptr;
+			rhi = nullptr;
+
+			delete g_log;
+			g_log = nullptr;
+		}
+	};
+
+	struct GraphicsOnlyNullRHIFixture : NullRHIFixture
+	{
+		GraphicsOnlyNullRHIFixture() : NullRHIFixture( false ) {}
+	};
+
+	RGTransientTextureDesc MakeTextureDesc( const char* name, uint32_t width, uint32_t height )
+	{
+		RGTransientTextureDesc desc = {};
+		desc.name = name;
+		desc.info.dimensions = RHITextureDimensions::T2D;
+		desc.info.format = RHIFormat::RGBA32_SFLOAT;
+		desc.info.width = width;
+		desc.info.height = height;
+		desc.info.depth = 1;
+		desc.info.mips = 1;
+		desc.info.array_layers = 1;
+		desc.info.usage = RHITextureUsageFlags::TextureROView | RHITextureUsageFlags::TextureRWView;
+		return desc;
+	}
+
+	RGTransientBufferDesc MakeBufferDesc( const char* name, uint64_t size )
+	{
+		RGTransientBufferDesc desc = {};
+		desc.name = name;
+		desc.info.size = size;
+		desc.info.usage = RHIBufferUsageFlags::StructuredBuffer | RHIBufferUsageFlags::TransferSrc | RHIBufferUsageFlags::TransferDst;
+		return desc;
+	}
+
+	// Chain of passes where every pass reads the output of the previous one and writes a new texture
+	void BuildTextureChain( Rendergraph& rg, size_t pass_count )
+	{
+		static std::vector<std::string> names;
+		names.resize( std::max( names.size(), pass_count ) );
+
+		RGTransientTexture* prev = nullptr;
+		RGPass* last_pass = nullptr;
+		for ( size_t i = 0; i < pass_count; ++i )
+		{
+			names[i] = "ChainTexture" + std::to_string( i );
+			// a few different sizes, like a real frame with half-res and quarter-res effects
+			const uint32_t divisor = 1u << ( i % 3 );
+			RGTransientTexture* texture = rg.CreateTransientTexture( MakeTextureDesc( names[i].c_str(), 1920 / divisor, 1080 / divisor ) );
+
+			RGPass* pass = last_pass = rg.AddPass( RHI::QueueType::Graphics, "ChainPass" );
+			if ( prev != nullptr )
+				pass->UseTextureView( *prev->GetROView() );
+			pass->UseTextureView( *texture->GetRWView() );
+
+			prev = texture;
+		}
+
+		// the chain result is consumed outside of the graph, otherwise the whole chain is culled
+		if ( last_pass != nullptr )
+			last_pass->SetHasUntrackedAccesses();
+	}
+
+	// Resources used by one pass, kept by the test to check the schedule independently of the rendergraph
+	struct TestPassUses
+	{
+		std::vector<const RGResource*> textures_read;
+		std::vector<const RGResource*> textures_written;
+		std::vector<const RGResource*> buffers_read;
+		std::vector<const RGResource*> buffers_written;
+	};
+
+	// Checks that every pair of conflicting passes is ordered by queue order and semaphore waits, and that no wait is redundant
+	void CheckSchedule( const Rendergraph& rg, std::span<RGPass* const> passes, std::span<const TestPassUses> uses )
+	{
+		const auto submissions = rg.GetSubmissions();
+		BOOST_REQUIRE( !submissions.empty() );
+		BOOST_TEST( ( submissions.back().type == RHI::QueueType::Graphics ) );
+
+		// happens-before between submissions
+		const size_t submission_count = submissions.size();
+		std::vector<std::vector<bool>> reachable( submission_count, std::vector<bool>( submission_count, false ) );
+		std::array<size_t, size_t( RHI::QueueType::Count )> last_on_queue;
+		last_on_queue.fill( size_t( -1 ) );
+		for ( size_t i = 0; i < submission_count; ++i )
+		{
+			const RendergraphSubmission& submission = submissions[i];
+			const size_t prev = last_on_queue[size_t( submission.type )];
+
+			auto add_edge = [&]( size_t from )
+			{
+				reachable[from][i] = true;
+				for ( size_t k = 0; k < i; ++k )
+					if ( reachable[k][from] )
+						reachable[k][i] = true;
+			};
+
+			for ( uint32_t wait : submission.wait_submissions )
+			{
+				BOOST_REQUIRE( wait < i );
+				BOOST_TEST( ( submissions[wait].type != submission.type ) );
+
+				// minimal waits: not implied by the queue order or by another wait
+				if ( prev != size_t( -1 ) )
+					BOOST_TEST( !( wait == prev || reachable[wait][prev] ), "submission " << i << " has a redundant wait for " << wait );
+				for ( uint32_t other_wait : submission.wait_submissions )
+					BOOST_TEST( !reachable[wait][other_wait], "submission " << i << " has a redundant wait for " << wait );
+			}
+
+			if ( prev != size_t( -1 ) )
+				add_edge( prev );
+			for ( uint32_t wait : submission.wait_submissions )
+				add_edge( wait );
+
+			last_on_queue[size_t( submission.type )] = i;
+
+			for ( const RGPass* pass : submission.passes )
+				BOOST_TEST( ( pass->GetQueueType() == submission.type ) );
+		}
+
+		// frame fence is taken from the last submission
+		for ( size_t i = 0; i + 1 < submission_count; ++i )
+			BOOST_TEST( reachable[i][submission_count - 1], "submission " << i << " is not finished by the last one" );
+
+		std::unordered_map<const RGPass*, std::pair<size_t, size_t>> pass_positions;
+		for ( size_t i = 0; i < submission_count; ++i )
+			for ( size_t j = 0; j < submissions[i].passes.size(); ++j )
+				BOOST_TEST( pass_positions.try_emplace( submissions[i].passes[j], i, j ).second );
+
+		// culled passes are not submitted
+		const size_t culled_count = std::count_if( passes.begin(), passes.end(), []( const RGPass* pass ) { return pass->IsCulled(); } );
+		BOOST_REQUIRE( pass_positions.size() == passes.size() - culled_count );
+		BOOST_TEST( rg.GetScheduleStats().culled_pass_count == culled_count );
+
+		auto happens_before = [&]( size_t a, size_t b )
+		{
+			const auto [submission_a, position_a] = pass_positions[passes[a]];
+			const auto [submission_b, position_b] = pass_positions[passes[b]];
+			if ( submission_a == submission_b )
+				return position_a < position_b;
+			return bool( reachable[submission_a][submission_b] );
+		};
+
+		auto contains = []( const std::vector<const RGResource*>& resources, const RGResource* resource )
+		{
+			return std::find( resources.begin(), resources.end(), resource ) != resources.end();
+		};
+
+		for ( size_t a = 0; a < passes.size(); ++a )
+		{
+			for ( size_t b = a + 1; b < passes.size(); ++b )
+			{
+				if ( passes[a]->IsCulled() || passes[b]->IsCulled() )
+					continue;
+
+				const bool cross_queue = passes[a]->GetQueueType() != passes[b]->GetQueueType();
+
+				bool conflict = false;
+				for ( const RGResource* texture : uses[a].textures_written )
+					conflict |= contains( uses[b].textures_read, texture ) || contains( uses[b].textures_written, texture );
+				for ( const RGResource* texture : uses[a].textures_read )
+					conflict |= contains( uses[b].textures_written, texture ) || ( cross_queue && contains( uses[b].textures_read, texture ) ); // ownership transfer
+				for ( const RGResource* buffer : uses[a].buffers_written )
+					conflict |= contains( uses[b].buffers_read, buffer ) || contains( uses[b].buffers_written, buffer );
+				for ( const RGResource* buffer : uses[a].buffers_read )
+					conflict |= contains( uses[b].buffers_written, buffer );
+
+				if ( conflict )
+					BOOST_TEST( happens_before( a, b ), "passes " << a << " and " << b << " conflict but are not ordered" );
+			}
+		}
+
+		// memory of aliased transient resources can't be reused until all users of the previous resource are done
+		auto uses_resource = [&]( size_t pass_idx, const RGResource* resource )
+		{
+			if ( passes[pass_idx]->IsCulled() )
+				return false;
+
+			const TestPassUses& pass_uses = uses[pass_idx];
+			return contains( pass_uses.textures_read, resource ) || contains( pass_uses.textures_written, resource )
+				|| contains( pass_uses.buffers_read, resource ) || contains( pass_uses.buffers_written, resource );
+		};
+
+		const auto allocations = rg.GetTransientResourceAllocations();
+		for ( const RGTransientResourceAllocation& earlier : allocations )
+		{
+			const RGResource* earlier_resource = earlier.texture ? static_cast<const RGResource*>( earlier.texture ) : earlier.buffer;
+			for ( const RGTransientResourceAllocation& later : allocations )
+			{
+				const bool memory_overlaps = earlier.offset < later.offset + later.size && later.offset < earlier.offset + earlier.size;
+				if ( earlier.heap != later.heap || earlier.heap == TransientResourceAllocator::InvalidHeap || !memory_overlaps || earlier.last_pass >= later.first_pass )
+					continue;
+
+				for ( size_t pass_idx = earlier.first_pass; pass_idx <= earlier.last_pass; ++pass_idx )
+				{
+					if ( uses_resource( pass_idx, earlier_resource ) )
+						BOOST_TEST( happens_before( pass_idx, later.first_pass ), "pass " << pass_idx << " may overlap with aliased memory reuse in pass " << later.first_pass );
+				}
+			}
+		}
+	}
+
+	// Every pass records a dispatch with its index as a marker, right after the barriers at its start
+	void RecordAndSubmit( RHI& rhi, Rendergraph& rg, std::span<RGPass* const> passes )
+	{
+		for ( size_t pass_idx = 0; pass_idx < passes.size(); ++pass_idx )
+		{
+			RGPass* pass = passes[pass_idx];
+			if ( pass->IsCulled() )
+				continue;
+
+			RHICommandList* cmd_list = rhi.GetCommandList( pass->GetQueueType() );
+			cmd_list->Begin();
+			pass->AddCommandList( *cmd_list );
+			cmd_list->Dispatch( glm::uvec3( uint32_t( pass_idx ), 1, 1 ) );
+			cmd_list->End();
+			pass->EndPass();
+		}
+
+		// null RHI validates that every semaphore is signaled before it is waited on
+		rhi.WaitForFenceCompletion( rg.Submit( RGSubmitInfo{} ) );
+	}
+
+	// Replays the commands of a frame in the order the null RHI executes them. Checks that every pass sees its textures
+	// in the right layout and on the right queue, and that its accesses are separated from conflicting earlier accesses on the same queue
+	// by a memory barrier or a barrier of the texture. Ordering between queues is checked by CheckSchedule.
+	// Passes are recognized by the dispatches recorded by RecordAndSubmit
+	class HazardChecker
+	{
+	public:
+		void BeginFrame( const Rendergraph& rg, std::span<RGPass* const> passes, std::span<const TestPassUses> uses )
+		{
+			m_passes.assign( passes.begin(), passes.end() );
+			m_uses.assign( uses.begin(), uses.end() );
+			m_executed.assign( passes.size(), false );
+			m_textures.clear();
+			m_unsynchronized.clear();
+			m_used.clear();
+			m_aliased.clear();
+
+			for ( const TestPassUses& pass_uses : uses )
+			{
+				for ( const auto* resources : { &pass_uses.textures_read, &pass_uses.textures_written } )
+				{
+					for ( const RGResource* resource : *resources )
+					{
+						const RGTexture* texture = static_cast<const RGTexture*>( resource );
+						TextureState state;
+						state.texture = texture;
+						if ( texture->IsExternal() )
+						{
+							state.layout = static_cast<const RGExternalTexture*>( texture )->GetDesc().initial_layout;
+							state.owner = RHI::QueueType::Graphics;
+						}
+						if ( texture->GetRHITexture() != nullptr )
+							m_textures.try_emplace( texture->GetRHITexture(), state );
+					}
+				}
+			}
+
+			const auto allocations = rg.GetTransientResourceAllocations();
+			for ( const RGTransientResourceAllocation& later : allocations )
+			{
+				for ( const RGTransientResourceAllocation& earlier : allocations )
+				{
+					const bool memory_overlaps = earlier.offset < later.offset + later.size && later.offset < earlier.offset + earlier.size;
+					if ( earlier.heap == later.heap && earlier.heap != TransientResourceAllocator::InvalidHeap && memory_overlaps && earlier.last_pass < later.first_pass )
+						m_aliased[GetResource( later )].emplace_back( GetResource( earlier ) );
+				}
+			}
+		}
+
+		void OnCommand( const NullRHIExecutedCommand& command )
+		{
+			switch ( command.type )
+			{
+			case NullRHICall::MemoryBarrierGPU:
+				for ( auto& [key, accesses] : m_unsynchronized )
+				{
+					if ( key.second == command.queue )
+						accesses = {};
+				}
+				m_memory_barrier_count++;
+				break;
+			case NullRHICall::TextureBarriers:
+				for ( const RHITextureBarrier& barrier : command.texture_barriers )
+					OnTextureBarrier( command.queue, barrier );
+				break;
+			case NullRHICall::Dispatch:
+				OnPass( command.queue, command.group_num.x );
+				break;
+			default:
+				break;
+			}
+		}
+
+		void EndFrame()
+		{
+			for ( size_t pass_idx = 0; pass_idx < m_passes.size(); ++pass_idx )
+				BOOST_TEST( m_executed[pass_idx] == !m_passes[pass_idx]->IsCulled(), "pass " << pass_idx );
+
+			// external textures are returned to the graphics queue in their final layouts
+			for ( const auto& [rhi_texture, state] : m_textures )
+			{
+				if ( !state.texture->IsExternal() )
+					continue;
+
+				BOOST_TEST( ( state.owner == RHI::QueueType::Graphics ) );
+				BOOST_TEST( ( state.layout == static_cast<const RGExternalTexture*>( state.texture )->GetDesc().final_layout ) );
+			}
+		}
+
+		size_t GetMemoryBarrierCount() const { return m_memory_barrier_count; }
+
+	private:
+		struct TextureState
+		{
+			const RGTexture* texture = nullptr;
+			RHITextureLayout layout = RHITextureLayout::Undefined;
+			RHI::QueueType owner = RHI::QueueType::Count; // Count while the texture is not used or is being transferred
+			RHI::QueueType transfer_dst = RHI::QueueType::Count;
+		};
+
+		// Accesses on a queue that no barrier has synchronized yet
+		struct Accesses
+		{
+			bool read = false;
+			bool write = false;
+		};
+
+		std::vector<RGPass*> m_passes;
+		std::vector<TestPassUses> m_uses;
+		std::vector<bool> m_executed;
+		std::unordered_map<const RHITexture*, TextureState> m_textures;
+		std::map<std::pair<const RGResource*, RHI::QueueType>, Accesses> m_unsynchronized;
+		std::unordered_set<const RGResource*> m_used;
+		std::unordered_map<const RGResource*, std::vector<const RGResource*>> m_aliased;
+		size_t m_memory_barrier_count = 0;
+
+		static const RGResource* GetResource( const RGTransientResourceAllocation& allocation )
+		{
+			return allocation.texture ? static_cast<const RGResource*>( allocation.texture ) : allocation.buffer;
+		}
+
+		void OnTextureBarrier( RHI::QueueType queue, const RHITextureBarrier& barrier )
+		{
+			// textures that no pass uses only get their final transitions
+			auto texture_it = m_textures.find( barrier.texture );
+			if ( texture_it == m_textures.end() )
+				return;
+
+			TextureState& state = texture_it->second;
+
+			m_unsynchronized[{ state.texture, queue }] = {};
+
+			if ( barrier.queue_src == barrier.queue_dst || barrier.queue_src == queue )
+			{
+				// layout transition or release
+				BOOST_TEST( ( state.owner == queue || state.owner == RHI::QueueType::Count ), "barrier of a texture owned by another queue" );
+				BOOST_TEST( ( barrier.layout_src == state.layout ) );
+				state.layout = barrier.layout_dst;
+				state.owner = queue;
+				if ( barrier.queue_src != barrier.queue_dst )
+				{
+					state.owner = RHI::QueueType::Count;
+					state.transfer_dst = barrier.queue_dst;
+				}
+			}
+			else
+			{
+				BOOST_TEST( ( barrier.queue_dst == queue && state.transfer_dst == queue ), "acquire without a release" );
+				BOOST_TEST( ( barrier.layout_dst == state.layout ) );
+				state.owner = queue;
+				state.transfer_dst = RHI::QueueType::Count;
+			}
+		}
+
+		void Access( RHI::QueueType queue, uint32_t pass_idx, const RGResource* resource, bool write )
+		{
+			// memory of aliased resources is reused on the first use
+			if ( m_used.insert( resource ).second )
+			{
+				for ( const RGResource* aliased : m_aliased[resource] )
+				{
+					const Accesses& aliased_accesses = m_unsynchronized[{ aliased, queue }];
+					BOOST_TEST( !( aliased_accesses.read || aliased_accesses.write ), "pass " << pass_idx << " reuses memory before earlier accesses are synchronized" );
+				}
+			}
+
+			Accesses& accesses = m_unsynchronized[{ resource, queue }];
+			BOOST_TEST( !( accesses.write || ( write && accesses.read ) ), "pass " << pass_idx << " has an unsynchronized hazard with an earlier pass" );
+			( write ? accesses.write : accesses.read ) = true;
+		}
+
+		void OnPass( RHI::QueueType queue, uint32_t pass_idx )
+		{
+			BOOST_REQUIRE( pass_idx < m_passes.size() );
+			BOOST_TEST( !m_executed[pass_idx] );
+			BOOST_TEST( ( m_passes[pass_idx]->GetQueueType() == queue ) );
+			m_executed[pass_idx] = true;
+
+			const TestPassUses& uses = m_uses[pass_idx];
+			for ( const bool write : { false, true } )
+			{
+				for ( const RGResource* resource : write ? uses.textures_written : uses.textures_read )
+				{
+					TextureState& state = m_textures[static_cast<const RGTexture*>( resource )->GetRHITexture()];
+					BOOST_TEST( ( state.owner == queue ), "pass " << pass_idx << " uses a texture owned by another queue" );
+					BOOST_TEST( ( state.layout == ( write ? RHITextureLayout::ShaderReadWrite : RHITextureLayout::ShaderReadOnly ) ), "pass " << pass_idx << " uses a texture in a wrong layout" );
+					Access( queue, pass_idx, resource, write );
+				}
+				for ( const RGResource* resource : write ? uses.buffers_written : uses.buffers_read )
+					Access( queue, pass_idx, resource, write );
+			}
+		}
+	};
+
+	struct HazardCheckingNullRHIFixture : NullRHIFixture
+	{
+		HazardChecker checker;
+
+		HazardCheckingNullRHIFixture()
+			: NullRHIFixture( true, [this]( const NullRHIExecutedCommand& command ) { checker.OnCommand( command ); } )
+		{}
+	};
+
+	// Reference for pass culling: a pass is needed if there is a chain of passes from it to an external write,
+	// where every pass writes something the next one uses
+	std::vector<bool> CalcNeededPasses( std::span<const TestPassUses> uses )
+	{
+		auto contains = []( const std::vector<const RGResource*>& resources, const RGResource* resource )
+		{
+			return std::find( resources.begin(), resources.end(), resource ) != resources.end();
+		};
+
+		const size_t pass_count = uses.size();
+		std::vector<bool> needed( pass_count, false );
+		for ( size_t pass_idx = 0; pass_idx < pass_count; ++pass_idx )
+		{
+			for ( const RGResource* texture : uses[pass_idx].textures_written )
+				if ( static_cast<const RGTexture*>( texture )->IsExternal() )
+					needed[pass_idx] = true;
+		}
+
+		bool changed = true;
+		while ( changed )
+		{
+			changed = false;
+			for ( size_t a = 0; a < pass_count; ++a )
+			{
+				for ( size_t b = a + 1; b < pass_count && !needed[a]; ++b )
+				{
+					if ( !needed[b] )
+						continue;
+
+					const TestPassUses& later = uses[b];
+					for ( const RGResource* texture : uses[a].textures_written )
+						needed[a] = needed[a] || contains( later.textures_read, texture ) || contains( later.textures_written, texture );
+					for ( const RGResource* buffer : uses[a].buffers_written )
+						needed[a] = needed[a] || contains( later.buffers_read, buffer ) || contains( later.buffers_written, buffer );
+					changed |= needed[a];
+				}
+			}
+		}
+		return needed;
+	}
+
+	// Graphics chain of four passes with an independent compute pass, joined by the last graphics pass
+	void BuildAsyncComputeGraph( Rendergraph& rg, std::vector<RGPass*>& passes )
+	{
+		RGTransientTexture* texture = rg.CreateTransientTexture( MakeTextureDesc( "GraphicsTexture", 64, 64 ) );
+		RGTransientBuffer* buffer = rg.CreateTransientBuffer( MakeBufferDesc( "ComputeBuffer", 4 * SizeKB ) );
+
+		for ( int i = 0; i < 4; ++i )
+		{
+			RGPass* pass = passes.emplace_back( rg.AddPass( RHI::QueueType::Graphics, "GraphicsPass" ) );
+			pass->UseTextureView( *texture->GetRWView() );
+		}
+
+		RGPass* compute = passes.emplace_back( rg.AddPass( RHI::QueueType::Compute, "ComputePass" ) );
+		compute->UseBuffer( *buffer, RGBufferUsage::ShaderWriteOnly );
+		compute->SetCostHint( 300 );
+
+		RGPass* join = passes.emplace_back( rg.AddPass( RHI::QueueType::Graphics, "JoinPass" ) );
+		join->UseTextureView( *texture->GetROView() );
+		join->UseBuffer( *buffer, RGBufferUsage::ShaderRead );
+		join->SetHasUntrackedAccesses(); // writes the result outside of the graph
+	}
+
+	struct SyntheticDrawConstants
+	{
+		float transform[12];
+		uint32_t draw_idx;
+		uint32_t padding[3];
+	};
+
+	// Passes that record draws with per-draw constants, like a pass that renders visible meshes
+	void BuildDrawPasses( Rendergraph& rg, RHIDescriptorSetLayout& dsl, size_t pass_count, size_t draws_per_pass )
+	{
+		RGTransientTexture* target = rg.CreateTransientTexture( MakeTextureDesc( "Target", 64, 64 ) );
+		for ( size_t pass_idx = 0; pass_idx < pass_count; ++pass_idx )
+		{
+			RGPass* pass = rg.AddPass( RHI::QueueType::Graphics, "SyntheticDraws" );
+			pass->UseTextureView( *target->GetRWView() );
+			pass->SetRecordCallback( [&dsl, pass_idx, draws_per_pass]( RHICommandList& cmd_list, RGRecordContext& ctx )
+			{
+				UploadBufferRange constants = ctx.AllocateUploadBufferStructured( sizeof( SyntheticDrawConstants ) * draws_per_pass );
+				RHIDescriptorSet* desc_set = ctx.AllocateFrameDescSet( dsl );
+				desc_set->BindStructuredBuffer( 0, 0, constants.view );
+				cmd_list.BindDescriptorSet( 0, *desc_set );
+
+				std::vector<SyntheticDrawConstants> draw_constants( draws_per_pass );
+				for ( size_t draw_idx = 0; draw_idx < draws_per_pass; ++draw_idx )
+				{
+					SyntheticDrawConstants& draw = draw_constants[draw_idx];
+					const float angle = float( pass_idx * draws_per_pass + draw_idx ) * 0.001f;
+					for ( int row = 0; row < 3; ++row )
+						for ( int column = 0; column < 4; ++column )
+							draw.transform[row * 4 + column] = std::cos( angle * float( row + 1 ) ) * std::sin( angle * float( column + 1 ) );
+					draw.draw_idx = uint32_t( draw_idx );
+
+					cmd_list.PushConstants( 0, &draw.draw_idx, sizeof( draw.draw_idx ) );
+					cmd_list.Draw( 36, 1, 0, 0 );
+				}
+				constants.UploadData( draw_constants.data(), draw_constants.size() );
+			} );
+		}
+	}
+
+	constexpr size_t RandomGraphTextureCount = 6;
+	constexpr size_t RandomGraphBufferCount = 6;
+
+	// a third of the textures of random graphs are external, they start and end on the graphics queue
+	std::vector<RHITexturePtr> CreateRandomGraphExternalTextures( RHI& rhi )
+	{
+		std::vector<RHITexturePtr> external_textures;
+		for ( size_t i = 0; i < RandomGraphTextureCount / 3; ++i )
+			external_textures.emplace_back( rhi.CreateTexture( MakeTextureDesc( "External", 64, 64 ).info ) );
+		return external_textures;
+	}
+
+	// Passes on random queues with random costs, each one reads or writes a few random resources
+	void BuildRandomGraph( Rendergraph& rg, std::mt19937& rng, std::span<const RHITexturePtr> external_textures, std::vector<RGPass*>& passes, std::vector<TestPassUses>& uses )
+	{
+		std::uniform_int_distribution<size_t> pass_count_dist( 8, 40 );
+		std::uniform_int_distribution<uint32_t> cost_dist( 10, 400 );
+		std::uniform_int_distribution<size_t> use_count_dist( 1, 3 );
+
+		const RHI::QueueType queues[] = { RHI::QueueType::Graphics, RHI::QueueType::Compute, RHI::QueueType::Copy };
+		const RHITextureLayout external_layouts[] = { RHITextureLayout::ShaderReadOnly, RHITextureLayout::ShaderReadWrite };
+
+		std::vector<const RGTexture*> textures;
+		for ( size_t i = 0; i < external_textures.size(); ++i )
+		{
+			RGExternalTextureDesc desc = {};
+			desc.name = "External";
+			desc.rhi_texture = external_textures[i].get();
+			desc.initial_layout = external_layouts[rng() % std::size( external_layouts )];
+			desc.final_layout = external_layouts[rng() % std::size( external_layouts )];
+			textures.emplace_back( rg.RegisterExternalTexture( desc ) );
+		}
+		while ( textures.size() < RandomGraphTextureCount )
+			textures.emplace_back( rg.CreateTransientTexture( MakeTextureDesc( "Transient", 64, 64 ) ) );
+
+		std::vector<const RGBuffer*> buffers;
+		for ( size_t i = 0; i < RandomGraphBufferCount; ++i )
+			buffers.emplace_back( rg.CreateTransientBuffer( MakeBufferDesc( "Transient", 4 * SizeKB ) ) );
+
+		const size_t pass_count = pass_count_dist( rng );
+		passes.clear();
+		uses.assign( pass_count, {} );
+		for ( size_t pass_idx = 0; pass_idx < pass_count; ++pass_idx )
+		{
+			RGPass* pass = passes.emplace_back( rg.AddPass( queues[rng() % std::size( queues )], "RandomPass" ) );
+			pass->SetCostHint( cost_dist( rng ) );
+
+			std::vector<size_t> resources( RandomGraphTextureCount + RandomGraphBufferCount );
+			std::iota( resources.begin(), resources.end(), 0 );
+			std::shuffle( resources.begin(), resources.end(), rng );
+			resources.resize( use_count_dist( rng ) );
+
+			for ( size_t resource : resources )
+			{
+				const bool write = rng() % 2 == 0;
+				if ( resource < RandomGraphTextureCount )
+				{
+					const RGTexture* texture = textures[resource];
+					BOOST_REQUIRE( pass->UseTexture( *texture, write ? RGTextureUsage::ShaderReadWrite : RGTextureUsage::ShaderRead ) );
+					( write ? uses[pass_idx].textures_written : uses[pass_idx].textures_read ).emplace_back( texture );
+				}
+				else
+				{
+					const RGBuffer* buffer = buffers[resource - RandomGraphTextureCount];
+					BOOST_REQUIRE( pass->UseBuffer( *buffer, write ? RGBufferUsage::ShaderReadWrite : RGBufferUsage::ShaderRead ) );
+					( write ? uses[pass_idx].buffers_written : uses[pass_idx].buffers_read ).emplace_back( buffer );
+				}
+			}
+		}
+	}
+
+	void DescribeBarriers( std::ostream& out, std::span<const RHITextureBarrier> barriers )
+	{
+		for ( const RHITextureBarrier& barrier : barriers )
+		{
+			out << " [" << barrier.texture << " " << int( barrier.layout_src ) << "->" << int( barrier.layout_dst )
+				<< " q" << int( barrier.queue_src ) << "->q" << int( barrier.queue_dst ) << "]";
+		}
+	}
+
+	// Text dump of everything Compile() produced. Passes are identified by index and transient resources by handle,
+	// so results of different frames with the same graph can be compared
+	std::string DescribeCompiledGraph( const Rendergraph& rg, std::span<RGPass* const> passes )
+	{
+		std::ostringstream out;
+		for ( const RendergraphSubmission& submission : rg.GetSubmissions() )
+		{
+			out << "submission q" << int( submission.type ) << " passes:";
+			for ( const RGPass* pass : submission.passes )
+				out << " " << std::find( passes.begin(), passes.end(), pass ) - passes.begin();
+			out << " waits:";
+			for ( uint32_t wait : submission.wait_submissions )
+				out << " " << wait;
+			out << " end barriers:";
+			DescribeBarriers( out, submission.end_barriers );
+			out << "\n";
+		}
+
+		for ( size_t pass_idx = 0; pass_idx < passes.size(); ++pass_idx )
+		{
+			out << "pass " << pass_idx << " q" << int( passes[pass_idx]->GetQueueType() ) << ( passes[pass_idx]->IsCulled() ? " culled" : "" ) << " start barriers:";
+			DescribeBarriers( out, passes[pass_idx]->GetStartBarriers() );
+			out << ( passes[pass_idx]->HasStartMemoryBarrier() ? " memory" : "" ) << "\n";
+		}
+
+		for ( const RGTransientResourceAllocation& allocation : rg.GetTransientResourceAllocations() )
+		{
+			const RGResource* resource = allocation.texture ? static_cast<const RGResource*>( allocation.texture ) : allocation.buffer;
+			out << "resource " << resource->GetHandle() << " passes " << allocation.first_pass << "-" << allocation.last_pass
+				<< " heap " << allocation.heap << " offset " << allocation.offset << " size " << allocation.size
+				<< " aliased " << ( allocation.aliased_resource ? int64_t( allocation.aliased_resource->GetHandle() ) : -1 ) << "\n";
+		}
+
+		const RGScheduleStats& stats = rg.GetScheduleStats();
+		out << "cost " << stats.serial_cost << " " << stats.scheduled_cost << " " << stats.critical_path << "\n";
+		return out.str();
+	}
+
+	// Post-processing heavy frame: gbuffer, lighting, bloom chains and tonemapping into the backbuffer, once per view
+	void BuildFrameGraph( Rendergraph& rg, const RHITexture& backbuffer, size_t view_count )
+	{
+		RGExternalTextureDesc backbuffer_desc = {};
+		backbuffer_desc.name = "Backbuffer";
+		backbuffer_desc.rhi_texture = &backbuffer;
+		backbuffer_desc.initial_layout = RHITextureLayout::Undefined;
+		backbuffer_desc.final_layout = RHITextureLayout::ShaderReadOnly;
+		const RGExternalTexture* output = rg.RegisterExternalTexture( backbuffer_desc );
+
+		constexpr int bloom_mips = 5;
+		for ( size_t view = 0; view < view_count; ++view )
+		{
+			RGTransientTexture* gbuffer[3] = {};
+			for ( RGTransientTexture*& texture : gbuffer )
+				texture = rg.CreateTransientTexture( MakeTextureDesc( "GBuffer", 1920, 1080 ) );
+			RGTransientTexture* shadows = rg.CreateTransientTexture( MakeTextureDesc( "Shadows", 1920, 1080 ) );
+			RGTransientTexture* hdr = rg.CreateTransientTexture( MakeTextureDesc( "HDR", 1920, 1080 ) );
+			RGTransientBuffer* histogram = rg.CreateTransientBuffer( MakeBufferDesc( "Histogram", 1 * SizeKB ) );
+			RGTransientBuffer* exposure = rg.CreateTransientBuffer( MakeBufferDesc( "Exposure", 256 ) );
+
+			RGPass* gbuffer_pass = rg.AddPass( RHI::QueueType::Graphics, "GBuffer" );
+			gbuffer_pass->SetCostHint( 1500 );
+			for ( RGTransientTexture* texture : gbuffer )
+				gbuffer_pass->UseTextureView( *texture->GetRWView() );
+
+			// traced from the scene, independent of the gbuffer so it can overlap with it on the compute queue
+			RGPass* shadows_pass = rg.AddPass( RHI::QueueType::Compute, "RTShadows" );
+			shadows_pass->SetCostHint( 1200 );
+			shadows_pass->UseTextureView( *shadows->GetRWView() );
+
+			RGPass* lighting_pass = rg.AddPass( RHI::QueueType::Compute, "Lighting" );
+			lighting_pass->SetCostHint( 800 );
+			for ( RGTransientTexture* texture : gbuffer )
+				lighting_pass->UseTextureView( *texture->GetROView() );
+			lighting_pass->UseTextureView( *shadows->GetROView() );
+			lighting_pass->UseTextureView( *hdr->GetRWView() );
+
+			RGPass* histogram_pass = rg.AddPass( RHI::QueueType::Compute, "Histogram" );
+			histogram_pass->SetCostHint( 150 );
+			histogram_pass->UseTextureView( *hdr->GetROView() );
+			histogram_pass->UseBuffer( *histogram, RGBufferUsage::ShaderWriteOnly );
+
+			RGPass* exposure_pass = rg.AddPass( RHI::QueueType::Compute, "Exposure" );
+			exposure_pass->SetCostHint( 20 );
+			exposure_pass->UseBuffer( *histogram, RGBufferUsage::ShaderRead );
+			exposure_pass->UseBuffer( *exposure, RGBufferUsage::ShaderReadWrite );
+
+			const RGTransientTexture* prev = hdr;
+			std::vector<const RGTransientTexture*> downsampled;
+			for ( int mip = 1; mip <= bloom_mips; ++mip )
+			{
+				RGTransientTexture* texture = rg.CreateTransientTexture( MakeTextureDesc( "BloomDown", 1920 >> mip, 1080 >> mip ) );
+				RGPass* pass = rg.AddPass( RHI::QueueType::Compute, "BloomDownsample" );
+				pass->SetCostHint( 200 >> mip );
+				pass->UseTextureView( *prev->GetROView() );
+				pass->UseTextureView( *texture->GetRWView() );
+				downsampled.emplace_back( texture );
+				prev = texture;
+			}
+			for ( int mip = bloom_mips - 1; mip >= 1; --mip )
+			{
+				RGTransientTexture* texture = rg.CreateTransientTexture( MakeTextureDesc( "BloomUp", 1920 >> mip, 1080 >> mip ) );
+				RGPass* pass = rg.AddPass( RHI::QueueType::Compute, "BloomUpsample" );
+				pass->SetCostHint( 200 >> mip );
+				pass->UseTextureView( *prev->GetROView() );
+				pass->UseTextureView( *downsampled[mip - 1]->GetROView() );
+				pass->UseTextureView( *texture->GetRWView() );
+				prev = texture;
+			}
+
+			RGPass* tonemap_pass = rg.AddPass( RHI::QueueType::Graphics, "Tonemap" );
+			tonemap_pass->SetCostHint( 150 );
+			tonemap_pass->UseTextureView( *hdr->GetROView() );
+			tonemap_pass->UseTextureView( *prev->GetROView() );
+			tonemap_pass->UseBuffer( *exposure, RGBufferUsage::ShaderRead );
+			tonemap_pass->UseTexture( *output, RGTextureUsage::ShaderReadWrite );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE( rendergraph_tests )
+
+BOOST_AUTO_TEST_CASE( transient_allocator_random_lifetimes )
+{
+	std::mt19937 rng( 1337 );
+	std::uniform_int_distribution<uint32_t> pass_dist( 0, 63 );
+	std::uniform_int_distribution<uint32_t> length_dist( 0, 8 );
+	std::uniform_int_distribution<uint64_t> size_dist( 1, 4 * SizeMB );
+	const uint64_t alignments[] = { 1, 256, 4 * SizeKB, 64 * SizeKB };
+
+	TransientResourceAllocator allocator;
+	TransientResourceAllocator::Result result;
+
+	for ( int iteration = 0; iteration < 20; ++iteration )
+	{
+		std::vector<Request> requests( 200 );
+		for ( Request& request : requests )
+		{
+			request.first_pass = pass_dist( rng );
+			request.last_pass = request.first_pass + length_dist( rng );
+			request.size = size_dist( rng );
+			request.alignment = alignments[rng() % std::size( alignments )];
+		}
+
+		allocator.Allocate( requests, 64 * SizeMB, result );
+
+		CheckPlacements( requests, result );
+		BOOST_TEST( result.total_heap_size <= result.requested_size );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( transient_allocator_aliases_disjoint_lifetimes )
+{
+	// each resource only lives for one pass, so all of them fit into the memory of the biggest one
+	std::vector<Request> requests;
+	for ( uint32_t i = 0; i < 8; ++i )
+	{
+		Request& request = requests.emplace_back();
+		request.size = SizeMB * ( 1 + i % 2 );
+		request.alignment = 64 * SizeKB;
+		request.first_pass = i;
+		request.last_pass = i;
+	}
+
+	TransientResourceAllocator allocator;
+	TransientResourceAllocator::Result result;
+	allocator.Allocate( requests, 256 * SizeMB, result );
+
+	CheckPlacements( requests, result );
+	BOOST_TEST( result.heap_sizes.size() == 1 );
+	BOOST_TEST( result.total_heap_size == 2 * SizeMB );
+	BOOST_TEST( result.requested_size == 12 * SizeMB );
+	BOOST_TEST( result.aliased_count == 7 );
+
+	// the first resource in pass order uses fresh memory, the next ones alias the previous pass
+	BOOST_TEST( result.placements[0].aliased_request == TransientResourceAllocator::NoAliasing );
+	for ( uint32_t i = 1; i < 8; ++i )
+	{
+		if ( result.placements[i].offset == 0 )
+			BOOST_TEST( result.placements[i].aliased_request == i - 1 );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( transient_allocator_heap_limit )
+{
+	std::vector<Request> requests( 3 );
+	requests[0].size = 3 * SizeMB;
+	requests[1].size = 3 * SizeMB;
+	requests[2].size = 10 * SizeMB; // bigger than the heap limit
+	for ( Request& request : requests )
+		request.last_pass = 1;
+
+	TransientResourceAllocator allocator;
+	TransientResourceAllocator::Result result;
+	allocator.Allocate( requests, 4 * SizeMB, result );
+
+	CheckPlacements( requests, result );
+	BOOST_TEST( result.heap_sizes.size() == 3 );
+	BOOST_TEST( result.aliased_count == 0 );
+	BOOST_TEST( result.heap_sizes[result.placements[2].heap] == 10 * SizeMB );
+}
+
+BOOST_FIXTURE_TEST_CASE( transient_resources_placed, NullRHIFixture )
+{
+	Rendergraph rg;
+
+	RGTransientBuffer* first = rg.CreateTransientBuffer( MakeBufferDesc( "First", 4 * SizeKB ) );
+	RGTransientBuffer* second = rg.CreateTransientBuffer( MakeBufferDesc( "Second", 4 * SizeKB ) );
+	RGTransientTexture* texture = rg.CreateTransientTexture( MakeTextureDesc( "Texture", 64, 64 ) );
+
+	RGPass* pass0 = rg.AddPass( RHI::QueueType::Graphics, "Pass0" );
+	pass0->UseBuffer( *first, RGBufferUsage::ShaderWriteOnly );
+	pass0->UseTextureView( *texture->GetRWView() );
+	RGPass* pass1 = rg.AddPass( RHI::QueueType::Graphics, "Pass1" );
+	pass1->UseBuffer( *second, RGBufferUsage::ShaderWriteOnly );
+	pass1->UseTextureView( *texture->GetROView() );
+	pass1->SetHasUntrackedAccesses(); // the second buffer is read back below
+
+	NullRHI_ResetStats( *rhi );
+	BOOST_REQUIRE( rg.Compile() );
+
+	BOOST_REQUIRE( first->GetRHIBuffer() != nullptr );
+	BOOST_REQUIRE( second->GetRHIBuffer() != nullptr );
+	BOOST_REQUIRE( texture->GetRHITexture() != nullptr );
+	BOOST_TEST( texture->GetROView()->GetRHIView() != nullptr );
+	BOOST_TEST( texture->GetRWView()->GetRHIView() != nullptr );
+
+	const RGTransientResourceStats& stats = rg.GetTransientResourceStats();
+	BOOST_TEST( stats.resource_count == 3 );
+	BOOST_TEST( stats.aliased_resource_count == 1 );
+	BOOST_TEST( stats.heap_count == 1 );
+	BOOST_TEST( stats.peak_memory < stats.requested_memory );
+
+	// buffers have disjoint lifetimes, so they share memory
+	const RGTransientResourceAllocation* first_allocation = nullptr;
+	const RGTransientResourceAllocation* second_allocation = nullptr;
+	for ( const RGTransientResourceAllocation& allocation : rg.GetTransientResourceAllocations() )
+	{
+		if ( allocation.buffer == first )
+			first_allocation = &allocation;
+		if ( allocation.buffer == second )
+			second_allocation = &allocation;
+	}
+	BOOST_REQUIRE( first_allocation != nullptr );
+	BOOST_REQUIRE( second_allocation != nullptr );
+	BOOST_TEST( first_allocation->heap == second_allocation->heap );
+	BOOST_TEST( first_allocation->offset == second_allocation->offset );
+	BOOST_TEST( second_allocation->aliased_resource == first );
+
+	// and the memory is really shared: data written through the first buffer is visible through the second one
+	RHI::BufferInfo upload_info = {};
+	upload_info.size = 4 * SizeKB;
+	upload_info.usage = RHIBufferUsageFlags::TransferSrc;
+	RHIUploadBufferPtr upload = rhi->CreateUploadBuffer( upload_info );
+	RHIReadbackBufferPtr readback = rhi->CreateReadbackBuffer( upload_info );
+
+	std::vector<uint32_t> src( upload_info.size / sizeof( uint32_t ) );
+	for ( size_t i = 0; i < src.size(); ++i )
+		src[i] = uint32_t( i * 31 );
+	upload->WriteBytes( src.data(), upload_info.size, 0 );
+
+	RHICommandList* cmd_list = rhi->GetCommandList( RHI::QueueType::Graphics );
+	cmd_list->Begin();
+	RHICommandList::CopyRegion region = {};
+	region.size = upload_info.size;
+	cmd_list->CopyBuffer( *upload->GetBuffer(), *first->GetRHIBuffer(), 1, &region );
+	cmd_list->CopyBuffer( *second->GetRHIBuffer(), *readback->GetBuffer(), 1, &region );
+	cmd_list->End();
+
+	RHI::SubmitInfo submit_info = {};
+	submit_info.cmd_list_count = 1;
+	submit_info.cmd_lists = &cmd_list;
+	rhi->WaitForFenceCompletion( rhi->SubmitCommandLists( submit_info ) );
+
+	std::vector<uint32_t> dst( src.size() );
+	readback->ReadBytes( dst.data(), upload_info.size, 0 );
+	BOOST_TEST( src == dst, boost::test_tools::per_element() );
+
+	const NullRHIStats rhi_stats = NullRHI_GetStats( *rhi );
+	BOOST_TEST( rhi_stats.GetCalls( NullRHICall::CreateMemoryHeap ) == 1 );
+	BOOST_TEST( rhi_stats.GetCalls( NullRHICall::CreatePlacedBuffer ) == 2 );
+	BOOST_TEST( rhi_stats.GetCalls( NullRHICall::CreatePlacedTexture ) == 1 );
+}
+
+BOOST_FIXTURE_TEST_CASE( transient_resources_reused_between_frames, NullRHIFixture )
+{
+	Rendergraph rg;
+
+	BuildTextureChain( rg, 16 );
+	BOOST_REQUIRE( rg.Compile() );
+
+	const RGTransientResourceStats first_frame_stats = rg.GetTransientResourceStats();
+	BOOST_TEST( first_frame_stats.resource_count == 16 );
+	BOOST_TEST( first_frame_stats.aliased_resource_count > 0 );
+
+	rg.Reset();
+	NullRHI_ResetStats( *rhi );
+
+	// same graph layout next frame, heaps and placed resources are taken from the cache
+	BuildTextureChain( rg, 16 );
+	BOOST_REQUIRE( rg.Compile() );
+
+	const NullRHIStats stats = NullRHI_GetStats( *rhi );
+	BOOST_TEST( stats.GetCalls( NullRHICall::CreateMemoryHeap ) == 0 );
+	BOOST_TEST( stats.GetCalls( NullRHICall::CreatePlacedTexture ) == 0 );
+	BOOST_TEST( stats.GetCalls( NullRHICall::CreateTextureROView ) == 0 );
+	BOOST_TEST( rg.GetTransientResourceStats().peak_memory == first_frame_stats.peak_memory );
+}
+
+BOOST_FIXTURE_TEST_CASE( async_queues_random_graphs, NullRHIFixture )
+{
+	constexpr int graph_count = 50;
+
+	std::mt19937 rng( 4242 );
+	const std::vector<RHITexturePtr> external_textures = CreateRandomGraphExternalTextures( *rhi );
+
+	// most passes of random graphs don't contribute to external textures, keep all of them to schedule the whole graph
+	rg_cullPasses.SetValue( 0 );
+
+	Rendergraph rg;
+
+	uint64_t total_serial_cost = 0;
+	uint64_t total_scheduled_cost = 0;
+	uint64_t total_critical_path = 0;
+	for ( int graph = 0; graph < graph_count; ++graph )
+	{
+		rg.Reset();
+
+		std::vector<RGPass*> passes;
+		std::vector<TestPassUses> uses;
+		BuildRandomGraph( rg, rng, external_textures, passes, uses );
+
+		BOOST_REQUIRE( rg.Compile() );
+		CheckSchedule( rg, passes, uses );
+
+		const RGScheduleStats& stats = rg.GetScheduleStats();
+		BOOST_TEST( stats.critical_path <= stats.scheduled_cost );
+		BOOST_TEST( stats.scheduled_cost <= stats.serial_cost );
+		BOOST_TEST( stats.submission_count == rg.GetSubmissions().size() );
+
+		total_serial_cost += stats.serial_cost;
+		total_scheduled_cost += stats.scheduled_cost;
+		total_critical_path += stats.critical_path;
+
+		RecordAndSubmit( *rhi, rg, passes );
+	}
+
+	BOOST_TEST_MESSAGE( "random graphs: " << graph_count << " estimated us, graphics queue only: " << total_serial_cost
+		<< " scheduled: " << total_scheduled_cost << " critical path: " << total_critical_path );
+
+	rg_cullPasses.SetValue( 1 );
+}
+
+BOOST_FIXTURE_TEST_CASE( async_queues_overlap_compute, NullRHIFixture )
+{
+	Rendergraph rg;
+	std::vector<RGPass*> passes;
+	BuildAsyncComputeGraph( rg, passes );
+
+	BOOST_REQUIRE( rg.Compile() );
+
+	BOOST_TEST( ( passes[4]->GetQueueType() == RHI::QueueType::Compute ) );
+
+	const RGScheduleStats& stats = rg.GetScheduleStats();
+	BOOST_TEST( stats.pass_count[size_t( RHI::QueueType::Graphics )] == 5 );
+	BOOST_TEST( stats.pass_count[size_t( RHI::QueueType::Compute )] == 1 );
+	BOOST_TEST( stats.serial_cost == 800 );
+	BOOST_TEST( stats.scheduled_cost == 500 );
+	BOOST_TEST( stats.critical_path == 500 );
+
+	// the join pass starts a new graphics submission that waits for the compute one
+	BOOST_TEST( stats.submission_count == 3 );
+	BOOST_TEST( stats.semaphore_count == 1 );
+	BOOST_TEST( stats.ownership_transfer_count == 0 );
+
+	const auto submissions = rg.GetSubmissions();
+	BOOST_REQUIRE( submissions.size() == 3 );
+	BOOST_TEST( submissions[2].passes.size() == 1 );
+	BOOST_TEST( submissions[2].passes[0] == passes[5] );
+	BOOST_TEST( submissions[2].wait_submissions == std::vector<uint32_t>{ 1 } );
+
+	RecordAndSubmit( *rhi, rg, passes );
+}
+
+BOOST_FIXTURE_TEST_CASE( async_queues_short_dependent_pass_stays_on_graphics, NullRHIFixture )
+{
+	Rendergraph rg;
+
+	RGTransientTexture* texture = rg.CreateTransientTexture( MakeTextureDesc( "Texture", 64, 64 ) );
+	RGTransientBuffer* buffer = rg.CreateTransientBuffer( MakeBufferDesc( "Buffer", 4 * SizeKB ) );
+
+	std::vector<RGPass*> passes;
+	passes.emplace_back( rg.AddPass( RHI::QueueType::Graphics, "Producer" ) )->UseTextureView( *texture->GetRWView() );
+
+	// waiting for the graphics queue and back costs more than the pass itself
+	RGPass* compute = passes.emplace_back( rg.AddPass( RHI::QueueType::Compute, "ShortCompute" ) );
+	compute->UseTextureView( *texture->GetROView() );
+	compute->UseBuffer( *buffer, RGBufferUsage::ShaderWriteOnly );
+	compute->SetCostHint( 10 );
+
+	RGPass* consumer = passes.emplace_back( rg.AddPass( RHI::QueueType::Graphics, "Consumer" ) );
+	consumer->UseBuffer( *buffer, RGBufferUsage::ShaderRead );
+	consumer->SetHasUntrackedAccesses();
+
+	BOOST_REQUIRE( rg.Compile() );
+
+	BOOST_TEST( ( compute->GetRequestedQueueType() == RHI::QueueType::Compute ) );
+	BOOST_TEST( ( compute->GetQueueType() == RHI::QueueType::Graphics ) );
+	BOOST_TEST( rg.GetScheduleStats().submission_count == 1 );
+	BOOST_TEST( rg.GetScheduleStats().scheduled_cost == rg.GetScheduleStats().serial_cost );
+
+	RecordAndSubmit( *rhi, rg, passes );
+}
+
+BOOST_FIXTURE_TEST_CASE( async_queues_texture_ownership_transfer, NullRHIFixture )
+{
+	Rendergraph rg;
+
+	RHITexturePtr rhi_texture = rhi->CreateTexture( MakeTextureDesc( "External", 64, 64 ).info );
+	RGExternalTextureDesc desc = {};
+	desc.name = "External";
+	desc.rhi_texture = rhi_texture.get();
+	desc.initial_layout = RHITextureLayout::ShaderReadOnly;
+	desc.final_layout = RHITextureLayout::ShaderReadOnly;
+	RGExternalTexture* texture = rg.RegisterExternalTexture( desc );
+	RGTransientTexture* graphics_texture = rg.CreateTransientTexture( MakeTextureDesc( "GraphicsTexture", 64, 64 ) );
+
+	std::vector<RGPass*> passes;
+	RGPass* compute = passes.emplace_back( rg.AddPass( RHI::QueueType::Compute, "ComputeWrite" ) );
+	compute->UseTexture( *texture, RGTextureUsage::ShaderReadWrite );
+	compute->SetCostHint( 1000 );
+
+	RGPass* graphics = passes.emplace_back( rg.AddPass( RHI::QueueType::Graphics, "GraphicsWork" ) );
+	graphics->UseTextureView( *graphics_texture->GetRWView() );
+	graphics->SetCostHint( 1000 );
+	graphics->SetHasUntrackedAccesses();
+
+	BOOST_REQUIRE( rg.Compile() );
+	BOOST_TEST( ( compute->GetQueueType() == RHI::QueueType::Compute ) );
+
+	// graphics -> compute before the pass, compute -> graphics at the end of the frame
+	const RGScheduleStats& stats = rg.GetScheduleStats();
+	BOOST_TEST( stats.ownership_transfer_count == 2 );
+
+	// releases end the submissions that used the texture last, the final acquire is done by the last submission
+	size_t release_count = 0;
+	size_t acquire_count = 0;
+	for ( const RendergraphSubmission& submission : rg.GetSubmissions() )
+	{
+		for ( const RHITextureBarrier& barrier : submission.end_barriers )
+		{
+			if ( barrier.texture != rhi_texture.get() || barrier.queue_src == barrier.queue_dst )
+				continue;
+
+			release_count += barrier.queue_src == submission.type;
+			acquire_count += barrier.queue_dst == submission.type;
+		}
+	}
+	BOOST_TEST( release_count == 2 );
+	BOOST_TEST( acquire_count == 1 );
+	BOOST_TEST( ( rg.GetSubmissions().back().end_barriers.back().queue_dst == RHI::QueueType::Graphics ) );
+
+	RecordAndSubmit( *rhi, rg, passes );
+}
+
+BOOST_FIXTURE_TEST_CASE( async_queues_fallback_to_graphics, GraphicsOnlyNullRHIFixture )
+{
+	BOOST_TEST( !rhi->IsQueueSupported( RHI::QueueType::Compute ) );
+
+	Rendergraph rg;
+	std::vector<RGPass*> passes;
+	BuildAsyncComputeGraph( rg, passes );
+
+	BOOST_REQUIRE( rg.Compile() );
+
+	for ( const RGPass* pass : passes )
+		BOOST_TEST( ( pass->GetQueueType() == RHI::QueueType::Graphics ) );
+
+	const RGScheduleStats& stats = rg.GetScheduleStats();
+	BOOST_TEST( stats.submission_count == 1 );
+	BOOST_TEST( stats.semaphore_count == 0 );
+	BOOST_TEST( stats.scheduled_cost == stats.serial_cost );
+
+	RecordAndSubmit( *rhi, rg, passes );
+}
+
+BOOST_FIXTURE_TEST_CASE( record_passes_in_parallel, NullRHIFixture )
+{
+	constexpr size_t pass_count = 64;
+	constexpr uint32_t value = 0xC0FFEE;
+
+	RHI::BufferInfo buf_info = {};
+	buf_info.size = pass_count * sizeof( value );
+	buf_info.usage = RHIBufferUsageFlags::TransferSrc | RHIBufferUsageFlags::TransferDst;
+	RHIBufferPtr data = rhi->CreateDeviceBuffer( buf_info );
+	RHIReadbackBufferPtr readback = rhi->CreateReadbackBuffer( buf_info );
+
+	Rendergraph rg;
+
+	RGExternalBufferDesc data_desc = {};
+	data_desc.name = "Data";
+	data_desc.rhi_buffer = data.get();
+	RGExternalBuffer* rg_data = rg.RegisterExternalBuffer( data_desc );
+
+	RGExternalBufferDesc readback_desc = {};
+	readback_desc.name = "Readback";
+	readback_desc.rhi_buffer = readback->GetBuffer();
+	RGExternalBuffer* rg_readback = rg.RegisterExternalBuffer( readback_desc );
+
+	// every pass copies the value written by the previous one, so the result is only right if the lists are executed in pass order
+	for ( size_t pass_idx = 0; pass_idx < pass_count; ++pass_idx )
+	{
+		RGPass* pass = rg.AddPass( RHI::QueueType::Graphics, "CopyChain" );
+		pass->UseBuffer( *rg_data, RGBufferUsage::ShaderReadWrite );
+		pass->SetRecordCallback( [&data, pass_idx, value]( RHICommandList& cmd_list, RGRecordContext& ctx )
+		{
+			RHICommandList::CopyRegion region = {};
+			region.size = sizeof( value );
+			region.dst_offset = pass_idx * sizeof( value );
+			if ( pass_idx == 0 )
+			{
+				UploadBufferRange initial = ctx.AllocateUploadBufferStructured( sizeof( value ) );
+				initial.UploadData( value );
+				region.src_offset = initial.view.offset;
+				cmd_list.CopyBuffer( *initial.buffer->GetBuffer(), *data, 1, &region );
+			}
+			else
+			{
+				region.src_offset = ( pass_idx - 1 ) * sizeof( value );
+				cmd_list.CopyBuffer( *data, *data, 1, &region );
+			}
+		} );
+	}
+
+	RGPass* readback_pass = rg.AddPass( RHI::QueueType::Graphics, "Readback" );
+	readback_pass->UseBuffer( *rg_data, RGBufferUsage::ShaderRead );
+	readback_pass->UseBuffer( *rg_readback, RGBufferUsage::ShaderWriteOnly );
+	readback_pass->SetRecordCallback( [&data, &readback, &buf_info]( RHICommandList& cmd_list, RGRecordContext& ctx )
+	{
+		RHICommandList::CopyRegion region = {};
+		region.size = buf_info.size;
+		cmd_list.CopyBuffer( *data, *readback->GetBuffer(), 1, &region );
+	} );
+
+	BOOST_REQUIRE( rg.Compile() );
+
+	ThreadPoolTaskScheduler scheduler( 4 );
+	NullRHI_ResetStats( *rhi );
+	BOOST_REQUIRE( rg.RecordPasses( scheduler ) );
+	rhi->WaitForFenceCompletion( rg.Submit( RGSubmitInfo{} ) );
+
+	std::vector<uint32_t> result( pass_count );
+	readback->ReadBytes( result.data(), buf_info.size, 0 );
+	BOOST_TEST( result == std::vector<uint32_t>( pass_count, value ), boost::test_tools::per_element() );
+
+	const NullRHIStats stats = NullRHI_GetStats( *rhi );
+	BOOST_TEST( stats.submitted_cmd_lists == pass_count + 1 );
+	BOOST_TEST( stats.GetCalls( NullRHICall::CopyBuffer ) == pass_count + 1 );
+}
+
+BOOST_FIXTURE_TEST_CASE( compile_cache_matches_full_compile, NullRHIFixture )
+{
+	constexpr int graph_count = 20;
+
+	const std::vector<RHITexturePtr> external_textures = CreateRandomGraphExternalTextures( *rhi );
+
+	Rendergraph rg;
+	for ( int graph = 0; graph < graph_count; ++graph )
+	{
+		std::string full_compile;
+		for ( int frame = 0; frame < 3; ++frame )
+		{
+			rg.Reset();
+
+			std::mt19937 rng( 1000 + graph );
+			std::vector<RGPass*> passes;
+			std::vector<TestPassUses> uses;
+			BuildRandomGraph( rg, rng, external_textures, passes, uses );
+
+			BOOST_REQUIRE( rg.Compile() );
+			BOOST_TEST( rg.GetCompileStats().cached == ( frame > 0 ) );
+			CheckSchedule( rg, passes, uses );
+
+			if ( frame == 0 )
+				full_compile = DescribeCompiledGraph( rg, passes );
+			else
+				BOOST_TEST( DescribeCompiledGraph( rg, passes ) == full_compile );
+
+			RecordAndSubmit( *rhi, rg, passes );
+		}
+	}
+
+	BOOST_TEST( rg.GetCompileStats().cache_hits == graph_count * 2 );
+	BOOST_TEST( rg.GetCompileStats().cache_misses == graph_count );
+}
+
+BOOST_FIXTURE_TEST_CASE( compile_cache_invalidation, NullRHIFixture )
+{
+	const RHITexturePtr backbuffers[2] = {
+		rhi->CreateTexture( MakeTextureDesc( "Backbuffer0", 64, 64 ).info ),
+		rhi->CreateTexture( MakeTextureDesc( "Backbuffer1", 64, 64 ).info ) };
+
+	struct GraphParams
+	{
+		const RHITexture* backbuffer = nullptr;
+		RGBufferUsage compute_usage = RGBufferUsage::ShaderWriteOnly;
+		uint32_t compute_cost = 300;
+		RHITextureLayout final_layout = RHITextureLayout::ShaderReadOnly;
+		uint32_t texture_size = 64;
+		bool swap_scratch_usages = false;
+	};
+
+	Rendergraph rg;
+
+	// Returns whether the compiled plan was reused
+	auto compile = [&]( const GraphParams& params )
+	{
+		rg.Reset();
+
+		std::vector<RGPass*> passes;
+		BuildAsyncComputeGraph( rg, passes );
+		RGPass* compute = passes[4];
+		RGPass* join = passes[5];
+
+		RGTransientTexture* texture = rg.CreateTransientTexture( MakeTextureDesc( "Texture", params.texture_size, params.texture_size ) );
+		RGTransientBuffer* buffer = rg.CreateTransientBuffer( MakeBufferDesc( "Buffer", 4 * SizeKB ) );
+		compute->UseTextureView( *texture->GetRWView() );
+		compute->UseBuffer( *buffer, params.compute_usage );
+		compute->SetCostHint( params.compute_cost );
+
+		// same resources and the same set of usages, only assigned the other way around
+		RGTransientBuffer* scratch[2] = {
+			rg.CreateTransientBuffer( MakeBufferDesc( "Scratch0", 4 * SizeKB ) ),
+			rg.CreateTransientBuffer( MakeBufferDesc( "Scratch1", 4 * SizeKB ) ) };
+		compute->UseBuffer( *scratch[params.swap_scratch_usages], RGBufferUsage::ShaderReadWrite );
+		compute->UseBuffer( *scratch[!params.swap_scratch_usages], RGBufferUsage::ShaderWriteOnly );
+
+		RGExternalTextureDesc backbuffer_desc = {};
+		backbuffer_desc.name = "Backbuffer";
+		backbuffer_desc.rhi_texture = params.backbuffer;
+		backbuffer_desc.initial_layout = RHITextureLayout::ShaderReadOnly;
+		backbuffer_desc.final_layout = params.final_layout;
+		join->UseTexture( *rg.RegisterExternalTexture( backbuffer_desc ), RGTextureUsage::ShaderReadWrite );
+		join->UseTextureView( *texture->GetROView() );
+
+		BOOST_REQUIRE( rg.Compile() );
+
+		// patched barriers only reference this frame's backbuffer
+		for ( const RHITexture* other_backbuffer : { backbuffers[0].get(), backbuffers[1].get() } )
+		{
+			size_t barrier_count = 0;
+			for ( const RHITextureBarrier& barrier : join->GetStartBarriers() )
+				barrier_count += barrier.texture == other_backbuffer;
+			BOOST_TEST( barrier_count == size_t( other_backbuffer == params.backbuffer ) );
+		}
+
+		RecordAndSubmit( *rhi, rg, passes );
+		return rg.GetCompileStats().cached;
+	};
+
+	GraphParams base = {};
+	base.backbuffer = backbuffers[0].get();
+	BOOST_TEST( !compile( base ) );
+	BOOST_TEST( compile( base ) );
+
+	// external RHI textures are patched, swapchain images change every frame
+	GraphParams other_backbuffer = base;
+	other_backbuffer.backbuffer = backbuffers[1].get();
+	BOOST_TEST( compile( other_backbuffer ) );
+
+	GraphParams changed_usage = base;
+	changed_usage.compute_usage = RGBufferUsage::ShaderReadWrite;
+	BOOST_TEST( !compile( changed_usage ) );
+	BOOST_TEST( compile( changed_usage ) );
+
+	GraphParams changed_cost = base;
+	changed_cost.compute_cost = 10;
+	BOOST_TEST( !compile( changed_cost ) );
+
+	GraphParams changed_layout = base;
+	changed_layout.final_layout = RHITextureLayout::ShaderReadWrite;
+	BOOST_TEST( !compile( changed_layout ) );
+
+	GraphParams changed_size = base;
+	changed_size.texture_size = 128;
+	BOOST_TEST( !compile( changed_size ) );
+
+	GraphParams swapped_usages = base;
+	swapped_usages.swap_scratch_usages = true;
+	BOOST_TEST( !compile( swapped_usages ) );
+	BOOST_TEST( compile( swapped_usages ) );
+
+	rg_asyncQueues.SetValue( 0 );
+	BOOST_TEST( !compile( base ) );
+	rg_asyncQueues.SetValue( 1 );
+
+	// earlier plans are still cached
+	BOOST_TEST( compile( base ) );
+	BOOST_TEST( compile( changed_usage ) );
+
+	rg_cacheCompiledGraphs.SetValue( 0 );
+	BOOST_TEST( !compile( base ) );
+	rg_cacheCompiledGraphs.SetValue( 1 );
+}
+
+BOOST_FIXTURE_TEST_CASE( cull_passes_random_graphs, HazardCheckingNullRHIFixture )
+{
+	constexpr int graph_count = 50;
+
+	std::mt19937 rng( 777 );
+	const std::vector<RHITexturePtr> external_textures = CreateRandomGraphExternalTextures( *rhi );
+
+	Rendergraph rg;
+
+	size_t total_pass_count = 0;
+	size_t total_culled_count = 0;
+	for ( int graph = 0; graph < graph_count; ++graph )
+	{
+		rg.Reset();
+
+		std::vector<RGPass*> passes;
+		std::vector<TestPassUses> uses;
+		BuildRandomGraph( rg, rng, external_textures, passes, uses );
+
+		BOOST_REQUIRE( rg.Compile() );
+
+		const std::vector<bool> needed = CalcNeededPasses( uses );
+		for ( size_t pass_idx = 0; pass_idx < passes.size(); ++pass_idx )
+			BOOST_TEST( passes[pass_idx]->IsCulled() == !needed[pass_idx], "graph " << graph << " pass " << pass_idx );
+
+		// culled passes don't keep transient resources alive
+		for ( const RGTransientResourceAllocation& allocation : rg.GetTransientResourceAllocations() )
+		{
+			BOOST_TEST( !passes[allocation.first_pass]->IsCulled() );
+			BOOST_TEST( !passes[allocation.last_pass]->IsCulled() );
+		}
+
+		if ( std::find( needed.begin(), needed.end(), true ) == needed.end() )
+			continue; // nothing is submitted
+
+		CheckSchedule( rg, passes, uses );
+
+		checker.BeginFrame( rg, passes, uses );
+		RecordAndSubmit( *rhi, rg, passes );
+		checker.EndFrame();
+
+		total_pass_count += passes.size();
+		total_culled_count += rg.GetScheduleStats().culled_pass_count;
+	}
+
+	BOOST_TEST( total_culled_count > 0 );
+	BOOST_TEST( total_culled_count < total_pass_count );
+}
+
+BOOST_FIXTURE_TEST_CASE( barriers_random_graphs_hazards, HazardCheckingNullRHIFixture )
+{
+	constexpr int graph_count = 50;
+
+	const std::vector<RHITexturePtr> external_textures = CreateRandomGraphExternalTextures( *rhi );
+
+	Rendergraph rg;
+
+	// the same graphs with all combinations of culling and barrier optimization
+	for ( int settings = 0; settings < 4; ++settings )
+	{
+		rg_cullPasses.SetValue( settings & 1 );
+		rg_optimizeBarriers.SetValue( ( settings >> 1 ) & 1 );
+
+		std::mt19937 rng( 9001 );
+		size_t total_memory_barrier_count = 0;
+		size_t total_pass_count = 0;
+		for ( int graph = 0; graph < graph_count; ++graph )
+		{
+			rg.Reset();
+
+			std::vector<RGPass*> passes;
+			std::vector<TestPassUses> uses;
+			BuildRandomGraph( rg, rng, external_textures, passes, uses );
+
+			BOOST_REQUIRE( rg.Compile() );
+			if ( rg.GetSubmissions().empty() )
+				continue;
+
+			const size_t memory_barriers_before = checker.GetMemoryBarrierCount();
+			checker.BeginFrame( rg, passes, uses );
+			RecordAndSubmit( *rhi, rg, passes );
+			checker.EndFrame();
+
+			const RGScheduleStats& stats = rg.GetScheduleStats();
+			BOOST_TEST( checker.GetMemoryBarrierCount() - memory_barriers_before == stats.memory_barrier_count );
+			total_memory_barrier_count += stats.memory_barrier_count;
+			total_pass_count += passes.size() - stats.culled_pass_count;
+		}
+
+		if ( rg_optimizeBarriers.GetValue() == 0 )
+			BOOST_TEST( total_memory_barrier_count == total_pass_count );
+		else
+			BOOST_TEST( total_memory_barrier_count < total_pass_count );
+	}
+
+	rg_cullPasses.SetValue( 1 );
+	rg_optimizeBarriers.SetValue( 1 );
+}
+
+BOOST_FIXTURE_TEST_CASE( barriers_frame_graph, NullRHIFixture )
+{
+	constexpr size_t view_count = 2;
+	RHITexturePtr backbuffer = rhi->CreateTexture( MakeTextureDesc( "Backbuffer", 1920, 1080 ).info );
+
+	struct FrameBarriers
+	{
+		size_t pass_count = 0;
+		uint64_t texture_barrier_calls = 0;
+		uint64_t memory_barrier_calls = 0;
+	};
+
+	auto render_frame = [&]( bool optimize )
+	{
+		rg_cullPasses.SetValue( int( optimize ) );
+		rg_optimizeBarriers.SetValue( int( optimize ) );
+
+		Rendergraph rg;
+		BuildFrameGraph( rg, *backbuffer, view_count );
+
+		// debug visualization that nothing displays
+		RGTransientTexture* debug_texture = rg.CreateTransientTexture( MakeTextureDesc( "DebugView", 1920, 1080 ) );
+		RGPass* debug_pass = rg.AddPass( RHI::QueueType::Compute, "DebugView" );
+		debug_pass->UseTextureView( *debug_texture->GetRWView() );
+
+		BOOST_REQUIRE( rg.Compile() );
+		BOOST_TEST( debug_pass->IsCulled() == optimize );
+
+		std::vector<RGPass*> passes;
+		for ( const RendergraphSubmission& submission : rg.GetSubmissions() )
+			passes.insert( passes.end(), submission.passes.begin(), submission.passes.end() );
+
+		NullRHI_ResetStats( *rhi );
+		RecordAndSubmit( *rhi, rg, passes );
+
+		const NullRHIStats stats = NullRHI_GetStats( *rhi );
+		const RGScheduleStats& schedule_stats = rg.GetScheduleStats();
+		BOOST_TEST( stats.GetCalls( NullRHICall::MemoryBarrierGPU ) == schedule_stats.memory_barrier_count );
+
+		FrameBarriers barriers;
+		barriers.pass_count = passes.size();
+		barriers.texture_barrier_calls = stats.GetCalls( NullRHICall::TextureBarriers );
+		barriers.memory_barrier_calls = stats.GetCalls( NullRHICall::MemoryBarrierGPU );
+		return barriers;
+	};
+
+	const FrameBarriers before = render_frame( false );
+	const FrameBarriers after = render_frame( true );
+
+	rg_cullPasses.SetValue( 1 );
+	rg_optimizeBarriers.SetValue( 1 );
+
+	BOOST_TEST( before.memory_barrier_calls == before.pass_count );
+	BOOST_TEST( after.pass_count < before.pass_count );
+	BOOST_TEST( after.memory_barrier_calls < before.memory_barrier_calls );
+	BOOST_TEST( after.texture_barrier_calls < before.texture_barrier_calls );
+
+	BOOST_TEST_MESSAGE( "barriers per frame, " << view_count << " views. Before: " << before.pass_count << " passes, "
+		<< before.texture_barrier_calls << " texture barrier calls, " << before.memory_barrier_calls << " memory barriers. After: "
+		<< after.pass_count << " passes, " << after.texture_barrier_calls << " texture barrier calls, " << after.memory_barrier_calls << " memory barriers" );
+}
+
+// Run explicitly with --run_test=rendergraph_tests/benchmark_parallel_recording --log_level=message
+BOOST_FIXTURE_TEST_CASE( benchmark_parallel_recording, NullRHIFixture, * boost::unit_test::disabled() )
+{
+	constexpr size_t pass_count = 200;
+	constexpr size_t draws_per_pass = 2000;
+	constexpr int frame_count = 20;
+
+	const RHI::DescriptorViewRange range = { RHIShaderBindingType::StructuredBuffer, 1 };
+	RHI::DescriptorSetLayoutInfo dsl_info = {};
+	dsl_info.ranges = &range;
+	dsl_info.range_count = 1;
+	RHIDescriptorSetLayoutPtr dsl = rhi->CreateDescriptorSetLayout( dsl_info );
+
+	for ( uint32_t thread_count : { 1u, 2u, 4u, 8u } )
+	{
+		ThreadPoolTaskScheduler scheduler( thread_count );
+		Rendergraph rg;
+
+		// warmup, fills descriptor and upload buffer pools of every thread
+		BuildDrawPasses( rg, *dsl, pass_count, draws_per_pass );
+		BOOST_REQUIRE( rg.Compile() );
+		BOOST_REQUIRE( rg.RecordPasses( scheduler ) );
+		rhi->WaitForFenceCompletion( rg.Submit( RGSubmitInfo{} ) );
+
+		double record_ms = 0;
+		for ( int i = 0; i < frame_count; ++i )
+		{
+			rg.Reset();
+			BuildDrawPasses( rg, *dsl, pass_count, draws_per_pass );
+			BOOST_REQUIRE( rg.Compile() );
+
+			const auto start = std::chrono::steady_clock::now();
+			BOOST_REQUIRE( rg.RecordPasses( scheduler ) );
+			record_ms += std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+
+			rhi->WaitForFenceCompletion( rg.Submit( RGSubmitInfo{} ) );
+		}
+
+		BOOST_TEST_MESSAGE( "passes: " << pass_count << " draws per pass: " << draws_per_pass << " threads: " << thread_count
+			<< " record ms/frame: " << record_ms / frame_count );
+	}
+}
+
+// Run explicitly with --run_test=rendergraph_tests/benchmark_transient_aliasing --log_level=message
+BOOST_FIXTURE_TEST_CASE( benchmark_transient_aliasing, NullRHIFixture, * boost::unit_test::disabled() )
+{
+	constexpr size_t pass_count = 500;
+	constexpr int frame_count = 50;
+
+	Rendergraph rg;
+
+	// warmup, creates heaps and placed resources
+	BuildTextureChain( rg, pass_count );
+	BOOST_REQUIRE( rg.Compile() );
+
+	const auto start = std::chrono::steady_clock::now();
+	for ( int i = 0; i < frame_count; ++i )
+	{
+		rg.Reset();
+		BuildTextureChain( rg, pass_count );
+		BOOST_REQUIRE( rg.Compile() );
+	}
+	const double ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+
+	const RGTransientResourceStats& stats = rg.GetTransientResourceStats();
+	BOOST_TEST_MESSAGE( "passes: " << pass_count << " transient textures: " << stats.resource_count << " aliased: " << stats.aliased_resource_count );
+	BOOST_TEST_MESSAGE( "  memory without aliasing: " << stats.requested_memory / SizeMB << " MB, with aliasing: " << stats.peak_memory / SizeMB
+		<< " MB (" << double( stats.peak_memory ) * 100.0 / double( stats.requested_memory ) << "%), heaps: " << stats.heap_count );
+	BOOST_TEST_MESSAGE( "  build + compile ms/frame: " << ms / frame_count );
+}
+
+// Run explicitly with --run_test=rendergraph_tests/benchmark_compile_cache --log_level=message
+BOOST_FIXTURE_TEST_CASE( benchmark_compile_cache, NullRHIFixture, * boost::unit_test::disabled() )
+{
+	constexpr int frame_count = 200;
+
+	const RHITexturePtr backbuffers[2] = {
+		rhi->CreateTexture( MakeTextureDesc( "Backbuffer0", 1920, 1080 ).info ),
+		rhi->CreateTexture( MakeTextureDesc( "Backbuffer1", 1920, 1080 ).info ) };
+
+	for ( size_t view_count : { 1, 4, 16 } )
+	{
+		for ( int cache : { 0, 1 } )
+		{
+			rg_cacheCompiledGraphs.SetValue( int( cache ) );
+
+			Rendergraph rg;
+
+			// warmup, creates heaps, placed resources and the compiled plan
+			BuildFrameGraph( rg, *backbuffers[0], view_count );
+			BOOST_REQUIRE( rg.Compile() );
+
+			std::chrono::steady_clock::duration compile_time = {};
+			for ( int i = 0; i < frame_count; ++i )
+			{
+				rg.Reset();
+				BuildFrameGraph( rg, *backbuffers[i % 2], view_count );
+
+				const auto start = std::chrono::steady_clock::now();
+				BOOST_REQUIRE( rg.Compile() );
+				compile_time += std::chrono::steady_clock::now() - start;
+			}
+
+			const double us = std::chrono::duration<double, std::micro>( compile_time ).count();
+			BOOST_TEST_MESSAGE( "views: " << view_count << " submissions: " << rg.GetScheduleStats().submission_count
+				<< " transient resources: " << rg.GetTransientResourceStats().resource_count << " cache " << ( cache ? "on" : "off" )
+				<< ": compile us/frame: " << us / frame_count << " (hits: " << rg.GetCompileStats().cache_hits << ")" );
+		}
+	}
+
+	rg_cacheCompiledGraphs.SetValue( 1 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
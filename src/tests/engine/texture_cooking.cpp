@@ -0,0 +1,237 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <boost/test/unit_test.hpp>
+
+#include <Engine/TextureCooking.h>
+
+#include <utils/MemoryMappedFile.h>
+#include <utils/TaskScheduler.h>
+
+#include <filesystem>
+
+namespace
+{
+	std::filesystem::path GetTestDirectory()
+	{
+		std::filesystem::path dir = std::filesystem::temp_directory_path() / "snow_engine_texture_cooking_tests";
+		std::filesystem::create_directories( dir );
+		return dir;
+	}
+
+	// smooth gradients with a little alpha, every block has some variation
+	TextureImage MakeGradientImage( uint32_t width, uint32_t height )
+	{
+		TextureImage image;
+		image.width = width;
+		image.height = height;
+		image.texels.resize( size_t( width ) * height * 4 );
+		for ( uint32_t y = 0; y < height; ++y )
+		{
+			for ( uint32_t x = 0; x < width; ++x )
+			{
+				float* texel = &image.texels[( size_t( y ) * width + x ) * 4];
+				texel[0] = float( x ) / float( width );
+				texel[1] = float( y ) / float( height );
+				texel[2] = 0.5f + 0.25f * float( ( x + y ) % 3 ) / 2.0f;
+				texel[3] = 1.0f - 0.5f * float( y ) / float( height );
+			}
+		}
+		return image;
+	}
+
+	void CheckCookedTexture( const CookedTextureView& cooked, const TextureImage& image, const TextureCookSettings& settings )
+	{
+		const CookedTextureHeader& header = cooked.GetHeader();
+		BOOST_TEST( header.width == image.width );
+		BOOST_TEST( header.height == image.height );
+		BOOST_TEST( ( cooked.GetEncoding() == GetTextureEncoding( settings ) ) );
+		BOOST_TEST( ( cooked.GetUsage() == settings.usage ) );
+		BOOST_TEST( MatchesCookSettings( header, settings ) );
+		BOOST_TEST( header.num_mips == ( settings.generate_mips ? GetNumMips( image.width, image.height ) : 1u ) );
+
+		// the mip table follows the RHI mip chain and every mip starts aligned, so the data section can be uploaded as is
+		const std::span<const CookedTextureMip> mips = cooked.GetMips();
+		BOOST_TEST_REQUIRE( mips.size() == header.num_mips );
+		for ( uint32_t i = 0; i < header.num_mips; ++i )
+		{
+			BOOST_TEST( mips[i].width == std::max( image.width >> i, 1u ) );
+			BOOST_TEST( mips[i].height == std::max( image.height >> i, 1u ) );
+			BOOST_TEST( mips[i].offset % CookedTextureHeader::SectionAlignment == 0 );
+			BOOST_TEST( cooked.GetMipData( i ).size() == GetEncodedSize( cooked.GetEncoding(), mips[i].width, mips[i].height ) );
+		}
+		BOOST_TEST( header.data_offset % CookedTextureHeader::SectionAlignment == 0 );
+
+		// the first mip is the source encoded as is
+		SerialTaskScheduler scheduler;
+		std::vector<uint8_t> expected( GetEncodedSize( cooked.GetEncoding(), image.width, image.height ) );
+		EncodeTexture( cooked.GetEncoding(), image.texels.data(), image.width, image.height, expected.data(), scheduler );
+		const std::span<const uint8_t> mip_data = cooked.GetMipData( 0 );
+		BOOST_TEST( std::equal( mip_data.begin(), mip_data.end(), expected.begin(), expected.end() ) );
+	}
+}
+
+BOOST_AUTO_TEST_SUITE( texture_cooking_tests )
+
+BOOST_AUTO_TEST_CASE( cooked_texture_roundtrip )
+{
+	ThreadPoolTaskScheduler scheduler( 4 );
+
+	// power of two, odd sizes with partial blocks and a single texel
+	for ( auto [width, height] : { std::pair{ 64u, 32u }, std::pair{ 37u, 5u }, std::pair{ 1u, 1u } } )
+	{
+		const TextureImage image = MakeGradientImage( width, height );
+
+		for ( TextureUsage usage : { TextureUsage::Color, TextureUsage::Data, TextureUsage::NormalMap, TextureUsage::HDR } )
+		{
+			for ( bool compress : { true, false } )
+			{
+				TextureCookSettings settings;
+				settings.usage = usage;
+				settings.compress = compress;
+				settings.generate_mips = width != 37;
+
+				std::vector<uint8_t> blob;
+				BOOST_TEST_REQUIRE( CookTexture( image, settings, scheduler, blob ) );
+
+				CookedTextureView cooked;
+				BOOST_TEST_REQUIRE( cooked.Init( blob ) );
+				CheckCookedTexture( cooked, image, settings );
+
+				// cooking is deterministic regardless of the thread count
+				std::vector<uint8_t> serial_blob;
+				SerialTaskScheduler serial_scheduler;
+				BOOST_TEST_REQUIRE( CookTexture( image, settings, serial_scheduler, serial_blob ) );
+				BOOST_TEST( serial_blob == blob );
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( cooked_texture_formats )
+{
+	TextureCookSettings settings;
+	settings.usage = TextureUsage::Color;
+	BOOST_TEST( ( GetTextureEncoding( settings ) == TextureEncoding::BC7 ) );
+	settings.encoding = TextureEncoding::BC1;
+	BOOST_TEST( ( GetTextureEncoding( settings ) == TextureEncoding::BC1 ) );
+
+	SerialTaskScheduler scheduler;
+	const TextureImage image = MakeGradientImage( 8, 8 );
+	std::vector<uint8_t> blob;
+	BOOST_TEST_REQUIRE( CookTexture( image, settings, scheduler, blob ) );
+	CookedTextureView cooked;
+	BOOST_TEST_REQUIRE( cooked.Init( blob ) );
+	BOOST_TEST( ( cooked.GetRHIFormat() == RHIFormat::BC1_SRGB ) );
+
+	// settings of a cooked file are compared on load, a texture cooked for another usage is cooked again
+	TextureCookSettings normal_settings;
+	normal_settings.usage = TextureUsage::NormalMap;
+	BOOST_TEST( !MatchesCookSettings( cooked.GetHeader(), normal_settings ) );
+	settings.generate_mips = false;
+	BOOST_TEST( !MatchesCookSettings( cooked.GetHeader(), settings ) );
+
+	settings = TextureCookSettings{};
+	settings.usage = TextureUsage::HDR;
+	settings.compress = false;
+	BOOST_TEST_REQUIRE( CookTexture( image, settings, scheduler, blob ) );
+	BOOST_TEST_REQUIRE( cooked.Init( blob ) );
+	BOOST_TEST( ( cooked.GetRHIFormat() == RHIFormat::RGB9E5 ) );
+
+	settings.usage = TextureUsage::Data;
+	BOOST_TEST_REQUIRE( CookTexture( image, settings, scheduler, blob ) );
+	BOOST_TEST_REQUIRE( cooked.Init( blob ) );
+	BOOST_TEST( ( cooked.GetRHIFormat() == RHIFormat::R8G8B8A8_UNORM ) );
+}
+
+BOOST_AUTO_TEST_CASE( invalid_cooked_texture_is_rejected )
+{
+	SerialTaskScheduler scheduler;
+	std::vector<uint8_t> blob;
+	BOOST_TEST_REQUIRE( CookTexture( MakeGradientImage( 16, 8 ), TextureCookSettings{}, scheduler, blob ) );
+
+	auto init_modified = [&blob]( auto&& modify )
+	{
+		std::vector<uint8_t> modified = blob;
+		CookedTextureHeader header;
+		memcpy( &header, modified.data(), sizeof( header ) );
+		modify( header, modified );
+		memcpy( modified.data(), &header, sizeof( header ) );
+
+		CookedTextureView cooked;
+		return cooked.Init( modified );
+	};
+
+	auto modify_mip = []( const CookedTextureHeader& header, std::vector<uint8_t>& data, uint32_t mip_idx, auto&& modify )
+	{
+		CookedTextureMip mip;
+		uint8_t* mip_data = data.data() + header.mip_table_offset + mip_idx * sizeof( CookedTextureMip );
+		memcpy( &mip, mip_data, sizeof( mip ) );
+		modify( mip );
+		memcpy( mip_data, &mip, sizeof( mip ) );
+	};
+
+	BOOST_TEST( init_modified( []( CookedTextureHeader&, std::vector<uint8_t>& ) {} ) );
+	BOOST_TEST( !init_modified( []( CookedTextureHeader& header, std::vector<uint8_t>& ) { header.magic = 0; } ) );
+	BOOST_TEST( !init_modified( []( CookedTextureHeader& header, std::vector<uint8_t>& ) { header.version++; } ) );
+	BOOST_TEST( !init_modified( []( CookedTextureHeader&, std::vector<uint8_t>& data ) { data.pop_back(); } ) );
+	BOOST_TEST( !init_modified( []( CookedTextureHeader& header, std::vector<uint8_t>& ) { header.encoding = uint8_t( TextureEncoding::Count ); } ) );
+	BOOST_TEST( !init_modified( []( CookedTextureHeader& header, std::vector<uint8_t>& ) { header.usage = uint8_t( TextureUsage::Count ); } ) );
+	BOOST_TEST( !init_modified( []( CookedTextureHeader& header, std::vector<uint8_t>& ) { header.num_mips = 6; } ) );
+	BOOST_TEST( !init_modified( []( CookedTextureHeader& header, std::vector<uint8_t>& ) { header.width = 0; } ) );
+	BOOST_TEST( !init_modified( []( CookedTextureHeader& header, std::vector<uint8_t>& ) { header.data_size = ~0ull; } ) );
+	BOOST_TEST( !init_modified( []( CookedTextureHeader& header, std::vector<uint8_t>& ) { header.encoding = uint8_t( TextureEncoding::RGBA8 ); } ) );
+	BOOST_TEST( !init_modified( [&]( CookedTextureHeader& header, std::vector<uint8_t>& data )
+	{
+		modify_mip( header, data, 1, []( CookedTextureMip& mip ) { mip.offset += 4; } );
+	} ) );
+	BOOST_TEST( !init_modified( [&]( CookedTextureHeader& header, std::vector<uint8_t>& data )
+	{
+		modify_mip( header, data, header.num_mips - 1, [&header]( CookedTextureMip& mip ) { mip.offset = header.data_size; } );
+	} ) );
+	BOOST_TEST( !init_modified( [&]( CookedTextureHeader& header, std::vector<uint8_t>& data )
+	{
+		modify_mip( header, data, 2, []( CookedTextureMip& mip ) { mip.width++; } );
+	} ) );
+
+	CookedTextureView cooked;
+	BOOST_TEST( !cooked.Init( std::span<const uint8_t>( blob.data(), sizeof( CookedTextureHeader ) - 1 ) ) );
+}
+
+BOOST_AUTO_TEST_CASE( texture_import_and_cooked_file )
+{
+	// 8 bit source, values come back in [0, 1]
+	const std::filesystem::path png_path = GetTestDirectory() / "gradient.png";
+	std::vector<uint8_t> pixels( 6 * 3 * 4 );
+	for ( size_t i = 0; i < pixels.size(); ++i )
+		pixels[i] = uint8_t( i * 3 );
+	BOOST_TEST_REQUIRE( stbi_write_png( png_path.string().c_str(), 6, 3, 4, pixels.data(), 6 * 4 ) != 0 );
+
+	TextureImage image;
+	bool is_hdr = true;
+	BOOST_TEST_REQUIRE( ImportTexture( png_path.string().c_str(), image, is_hdr ) );
+	BOOST_TEST( !is_hdr );
+	BOOST_TEST( image.width == 6u );
+	BOOST_TEST( image.height == 3u );
+	BOOST_TEST_REQUIRE( image.texels.size() == pixels.size() );
+	for ( size_t i = 0; i < pixels.size(); ++i )
+		BOOST_TEST_REQUIRE( image.texels[i] == float( pixels[i] ) / 255.0f );
+
+	BOOST_TEST( !ImportTexture( ( GetTestDirectory() / "missing.png" ).string().c_str(), image, is_hdr ) );
+
+	// cooked files are mapped and read in place
+	SerialTaskScheduler scheduler;
+	std::vector<uint8_t> blob;
+	BOOST_TEST_REQUIRE( CookTexture( image, TextureCookSettings{}, scheduler, blob ) );
+	std::filesystem::path cooked_path = png_path;
+	cooked_path += ".setex";
+	BOOST_TEST_REQUIRE( WriteCookedTexture( cooked_path.string().c_str(), blob ) );
+
+	MemoryMappedFile file;
+	BOOST_TEST_REQUIRE( file.Open( cooked_path.string() ) );
+	CookedTextureView cooked;
+	BOOST_TEST_REQUIRE( cooked.Init( std::span<const uint8_t>( file.GetData().cbegin(), file.GetData().size() ) ) );
+	CheckCookedTexture( cooked, image, TextureCookSettings{} );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
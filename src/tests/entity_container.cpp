@@ -105,6 +105,42 @@ BOOST_AUTO_TEST_CASE( remove_multiple_entities )
     BOOST_TEST( world.GetEntityCount() == 0 );
 }
 
+BOOST_AUTO_TEST_CASE( destroy_entity_batch )
+{
+    EntityContainer<Position, Velocity> world;
+    using Entity = decltype( world )::Entity;
+
+    std::vector<Entity> entities;
+    for ( int i = 0; i < 1000; ++i )
+    {
+        Entity entity = world.CreateEntity();
+        entities.push_back( entity );
+        world.AddComponent<Position>( entity, Position{ DirectX::XMFLOAT3( float( i ), 0, 0 ) } );
+        if ( i % 2 == 0 )
+            world.AddComponent<Velocity>( entity, Velocity{ DirectX::XMFLOAT3( float( i ), 0, 0 ) } );
+    }
+
+    // big batch rebuilds the btrees, small one erases components one by one
+    std::vector<Entity> big_batch;
+    for ( int i = 0; i < 1000; i += 3 )
+        big_batch.push_back( entities[i] );
+    world.DestroyEntities( big_batch );
+    world.DestroyEntities( { entities[1], entities[997] } );
+
+    BOOST_TEST( world.GetEntityCount() == 1000 - big_batch.size() - 2 );
+    for ( int i = 0; i < 1000; ++i )
+    {
+        if ( i % 3 == 0 || i == 1 || i == 997 )
+            continue;
+        BOOST_TEST( world.GetComponent<Position>( entities[i] )->v.x == float( i ) );
+        BOOST_TEST( ( world.GetComponent<Velocity>( entities[i] ) != nullptr ) == ( i % 2 == 0 ) );
+
+        // cursors kept by the container must still be valid
+        world.DestroyEntity( entities[i] );
+    }
+    BOOST_TEST( world.GetEntityCount() == 0 );
+}
+
 BOOST_AUTO_TEST_CASE( iterate_over_view )
 {
     EntityContainer<Position, Velocity> world;
@@ -0,0 +1,287 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+#include <boost/test/unit_test.hpp>
+
+#include <Windows.h>
+#include <DirectXMath.h>
+
+#include <utils/FrustumCulling.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+namespace
+{
+	CullingFrustum MakeFrustum( const DirectX::XMMATRIX& view_proj )
+	{
+		// DirectXMath matrices are for row vectors
+		DirectX::XMFLOAT4X4 m;
+		DirectX::XMStoreFloat4x4( &m, DirectX::XMMatrixTranspose( view_proj ) );
+		return CullingFrustum::FromMatrix( m.m );
+	}
+
+	DirectX::XMVECTOR RandomVector( std::mt19937& rng, float range )
+	{
+		std::uniform_real_distribution<float> dist( -range, range );
+		return DirectX::XMVectorSet( dist( rng ), dist( rng ), dist( rng ), 0.0f );
+	}
+
+	// main camera and shadow cascades of a directional light, all looking into the scene from random points
+	std::vector<CullingFrustum> MakeRandomFrustums( std::mt19937& rng, float scene_size, uint32_t num_cascades )
+	{
+		std::uniform_real_distribution<float> dist( 0.0f, 1.0f );
+
+		std::vector<CullingFrustum> frustums;
+		const DirectX::XMVECTOR eye = RandomVector( rng, scene_size );
+		const DirectX::XMVECTOR target = RandomVector( rng, scene_size * 0.5f );
+		const DirectX::XMMATRIX view = DirectX::XMMatrixLookAtLH( eye, target, DirectX::XMVectorSet( 0, 1, 0, 0 ) );
+		const float fov = 0.5f + dist( rng ) * 1.5f;
+		const float far_z = scene_size * ( 0.5f + dist( rng ) );
+		// reversed depth
+		frustums.push_back( MakeFrustum( view * DirectX::XMMatrixPerspectiveFovLH( fov, 16.0f / 9.0f, far_z, 0.1f ) ) );
+
+		const DirectX::XMVECTOR light_dir = DirectX::XMVector3Normalize( DirectX::XMVectorAdd( RandomVector( rng, 1.0f ), DirectX::XMVectorSet( 0, -2, 0, 0 ) ) );
+		for ( uint32_t i = 0; i < num_cascades; ++i )
+		{
+			const float cascade_size = scene_size * float( i + 1 ) / float( num_cascades ) * 0.5f;
+			const DirectX::XMVECTOR center = RandomVector( rng, scene_size * 0.5f );
+			const DirectX::XMVECTOR light_eye = DirectX::XMVectorSubtract( center, DirectX::XMVectorScale( light_dir, scene_size ) );
+			const DirectX::XMMATRIX light_view = DirectX::XMMatrixLookToLH( light_eye, light_dir, DirectX::XMVectorSet( 1, 0, 0, 0 ) );
+			frustums.push_back( MakeFrustum( light_view * DirectX::XMMatrixOrthographicLH( cascade_size, cascade_size, 0.0f, scene_size * 2.0f ) ) );
+		}
+		return frustums;
+	}
+
+	// boxes of different sizes, clustered like objects in a level. Some of them are empty
+	std::vector<BVHBounds> MakeRandomBoxes( std::mt19937& rng, uint32_t num_boxes, float scene_size )
+	{
+		std::uniform_real_distribution<float> position( -scene_size, scene_size );
+		std::uniform_real_distribution<float> cluster_offset( -scene_size * 0.05f, scene_size * 0.05f );
+		std::exponential_distribution<float> extent( 2.0f );
+
+		std::vector<BVHBounds> boxes( num_boxes );
+		float cluster[3] = {};
+		for ( uint32_t i = 0; i < num_boxes; ++i )
+		{
+			if ( i % 100 == 0 )
+			{
+				for ( float& coord : cluster )
+					coord = position( rng );
+			}
+			if ( i % 97 == 13 )
+				continue;
+
+			for ( int axis = 0; axis < 3; ++axis )
+			{
+				const float center = cluster[axis] + cluster_offset( rng );
+				const float half_size = extent( rng );
+				boxes[i].min[axis] = center - half_size;
+				boxes[i].max[axis] = center + half_size;
+			}
+		}
+		return boxes;
+	}
+
+	// Plain loop over all boxes, the same p-vertex test as the culling kernels
+	std::vector<uint32_t> CullReference( const std::vector<BVHBounds>& boxes, const CullingFrustum& frustum )
+	{
+		std::vector<uint32_t> visible;
+		for ( uint32_t i = 0; i < boxes.size(); ++i )
+		{
+			bool inside = true;
+			for ( const auto& plane : frustum.planes )
+			{
+				float p[3];
+				for ( int axis = 0; axis < 3; ++axis )
+					p[axis] = plane[axis] >= 0.0f ? boxes[i].max[axis] : boxes[i].min[axis];
+				inside &= ( ( plane[0] * p[0] + plane[1] * p[1] ) + plane[2] * p[2] ) + plane[3] >= 0.0f;
+			}
+			if ( inside )
+				visible.push_back( i );
+		}
+		return visible;
+	}
+
+	std::vector<CullingSIMD> GetTestedSIMD()
+	{
+		std::vector<CullingSIMD> res = { CullingSIMD::Scalar, CullingSIMD::SSE };
+		if ( GetSupportedCullingSIMD() == CullingSIMD::AVX2 )
+			res.push_back( CullingSIMD::AVX2 );
+		return res;
+	}
+
+	void CheckAgainstReference( const CullingBVH& bvh, const std::vector<BVHBounds>& boxes, const std::vector<CullingFrustum>& frustums )
+	{
+		std::vector<std::vector<uint32_t>> visible( frustums.size() );
+		for ( CullingSIMD simd : GetTestedSIMD() )
+		{
+			bvh.Cull( frustums.data(), uint32_t( frustums.size() ), visible.data(), simd );
+			for ( size_t i = 0; i < frustums.size(); ++i )
+			{
+				std::sort( visible[i].begin(), visible[i].end() );
+				const std::vector<uint32_t> expected = CullReference( boxes, frustums[i] );
+				BOOST_TEST( visible[i] == expected, boost::test_tools::per_element() );
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE( frustum_culling )
+
+BOOST_AUTO_TEST_CASE( frustum_from_matrix )
+{
+	const DirectX::XMMATRIX view = DirectX::XMMatrixLookAtLH( DirectX::XMVectorSet( 0, 0, -10, 1 ), DirectX::XMVectorZero(), DirectX::XMVectorSet( 0, 1, 0, 0 ) );
+
+	for ( bool reversed_depth : { false, true } )
+	{
+		const DirectX::XMMATRIX proj = reversed_depth ? DirectX::XMMatrixPerspectiveFovLH( DirectX::XM_PIDIV2, 1.0f, 100.0f, 1.0f )
+			: DirectX::XMMatrixPerspectiveFovLH( DirectX::XM_PIDIV2, 1.0f, 1.0f, 100.0f );
+		const CullingFrustum frustum = MakeFrustum( view * proj );
+
+		auto is_inside = [&]( float x, float y, float z )
+		{
+			for ( const auto& plane : frustum.planes )
+			{
+				if ( plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f )
+					return false;
+			}
+			return true;
+		};
+
+		BOOST_TEST( is_inside( 0, 0, 0 ) );
+		BOOST_TEST( is_inside( 9, 0, 0 ) ); // 90 degree fov, 10 units away from the camera
+		BOOST_TEST( !is_inside( 11, 0, 0 ) );
+		BOOST_TEST( !is_inside( 0, -11, 0 ) );
+		BOOST_TEST( !is_inside( 0, 0, -9.5f ) ); // before the near plane
+		BOOST_TEST( is_inside( 0, 0, 89 ) );
+		BOOST_TEST( !is_inside( 0, 0, 91 ) ); // behind the far plane
+	}
+}
+
+BOOST_AUTO_TEST_CASE( cull_random_scenes )
+{
+	std::mt19937 rng( 42 );
+
+	for ( uint32_t num_boxes : { 1u, 7u, 100u, 5000u } )
+	{
+		for ( uint32_t max_leaf_size : { 1u, 8u, 32u, 100u } )
+		{
+			const float scene_size = 100.0f;
+			const std::vector<BVHBounds> boxes = MakeRandomBoxes( rng, num_boxes, scene_size );
+
+			CullingBVH bvh;
+			bvh.Build( boxes.data(), num_boxes, max_leaf_size );
+			BOOST_TEST( bvh.GetNumObjects() == num_boxes );
+
+			for ( int i = 0; i < 10; ++i )
+				CheckAgainstReference( bvh, boxes, MakeRandomFrustums( rng, scene_size, 4 ) );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( cull_max_frustums )
+{
+	std::mt19937 rng( 1 );
+
+	const std::vector<BVHBounds> boxes = MakeRandomBoxes( rng, 2000, 100.0f );
+	CullingBVH bvh;
+	bvh.Build( boxes.data(), uint32_t( boxes.size() ) );
+
+	std::vector<CullingFrustum> frustums;
+	while ( frustums.size() < CullingBVH::MaxFrustums )
+	{
+		for ( const CullingFrustum& frustum : MakeRandomFrustums( rng, 100.0f, 3 ) )
+			frustums.push_back( frustum );
+	}
+	frustums.resize( CullingBVH::MaxFrustums );
+
+	CheckAgainstReference( bvh, boxes, frustums );
+}
+
+BOOST_AUTO_TEST_CASE( refit_moved_objects )
+{
+	std::mt19937 rng( 3 );
+	std::uniform_real_distribution<float> offset( -30.0f, 30.0f );
+
+	std::vector<BVHBounds> boxes = MakeRandomBoxes( rng, 3000, 100.0f );
+	CullingBVH bvh;
+	bvh.Build( boxes.data(), uint32_t( boxes.size() ) );
+
+	for ( int iteration = 0; iteration < 5; ++iteration )
+	{
+		for ( uint32_t i = 0; i < boxes.size(); i += 3 )
+		{
+			if ( boxes[i].IsEmpty() )
+				continue;
+
+			for ( int axis = 0; axis < 3; ++axis )
+			{
+				const float delta = offset( rng );
+				boxes[i].min[axis] += delta;
+				boxes[i].max[axis] += delta;
+			}
+			bvh.SetBounds( i, boxes[i] );
+		}
+		BOOST_TEST( bvh.NeedsRefit() );
+		bvh.Refit();
+
+		CheckAgainstReference( bvh, boxes, MakeRandomFrustums( rng, 100.0f, 4 ) );
+	}
+}
+
+namespace
+{
+	void BenchmarkCulling( uint32_t num_boxes )
+	{
+		constexpr int frame_count = 20;
+		const float scene_size = 1000.0f;
+
+		std::mt19937 rng( 1 );
+		const std::vector<BVHBounds> boxes = MakeRandomBoxes( rng, num_boxes, scene_size );
+		// main view and 4 cascades
+		const std::vector<CullingFrustum> frustums = MakeRandomFrustums( rng, scene_size, 4 );
+		std::vector<std::vector<uint32_t>> visible( frustums.size() );
+
+		auto start = std::chrono::steady_clock::now();
+		CullingBVH bvh;
+		bvh.Build( boxes.data(), num_boxes );
+		const double build_ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+		BOOST_TEST_MESSAGE( num_boxes << " boxes, " << frustums.size() << " frustums, build ms: " << build_ms << ", nodes: " << bvh.GetNumNodes() );
+
+		start = std::chrono::steady_clock::now();
+		size_t reference_visible = 0;
+		for ( const CullingFrustum& frustum : frustums )
+			reference_visible += CullReference( boxes, frustum ).size();
+		const double reference_ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+		BOOST_TEST_MESSAGE( "  reference (one box at a time, no hierarchy) ms: " << reference_ms << ", visible: " << reference_visible );
+
+		const char* names[] = { "scalar", "sse", "avx2" };
+		for ( CullingSIMD simd : GetTestedSIMD() )
+		{
+			start = std::chrono::steady_clock::now();
+			for ( int i = 0; i < frame_count; ++i )
+				bvh.Cull( frustums.data(), uint32_t( frustums.size() ), visible.data(), simd );
+			const double ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count() / frame_count;
+
+			size_t total_visible = 0;
+			for ( const auto& list : visible )
+				total_visible += list.size();
+			BOOST_TEST_MESSAGE( "  " << names[size_t( simd )] << " ms: " << ms << ", visible: " << total_visible );
+		}
+	}
+}
+
+// Run explicitly with --run_test=frustum_culling/benchmark_100k --log_level=message
+BOOST_AUTO_TEST_CASE( benchmark_100k, * boost::unit_test::disabled() )
+{
+	BenchmarkCulling( 100'000 );
+}
+
+// Run explicitly with --run_test=frustum_culling/benchmark_1m --log_level=message
+BOOST_AUTO_TEST_CASE( benchmark_1m, * boost::unit_test::disabled() )
+{
+	BenchmarkCulling( 1'000'000 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,241 @@
 #include <boost/test/unit_test.hpp>
 
 #include <utils/MathUtils.h>
+#include <utils/BVH.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace
+{
+	struct TestMesh
+	{
+		std::vector<float> positions; // float3
+		std::vector<uint32_t> indices;
+
+		uint32_t NumVertices() const { return uint32_t( positions.size() / 3 ); }
+		uint32_t NumTriangles() const { return uint32_t( indices.size() / 3 ); }
+		const float* Vertex( uint32_t triangle, uint32_t corner ) const { return positions.data() + 3 * indices[triangle * 3 + corner]; }
+	};
+
+	// random triangles of different sizes inside [-1, 1]^3, overlapping and intersecting each other
+	TestMesh MakeTriangleSoup( uint32_t num_triangles, std::mt19937& rng )
+	{
+		std::uniform_real_distribution<float> center( -1.0f, 1.0f );
+		std::uniform_real_distribution<float> offset( -0.2f, 0.2f );
+
+		TestMesh mesh;
+		for ( uint32_t i = 0; i < num_triangles; ++i )
+		{
+			const float c[3] = { center( rng ), center( rng ), center( rng ) };
+			for ( int corner = 0; corner < 3; ++corner )
+			{
+				for ( int axis = 0; axis < 3; ++axis )
+					mesh.positions.push_back( c[axis] + offset( rng ) );
+				mesh.indices.push_back( i * 3 + corner );
+			}
+		}
+		return mesh;
+	}
+
+	// closed uv sphere with noisy radius, vertices are shared between triangles
+	TestMesh MakeBumpySphere( uint32_t segments, uint32_t rings, std::mt19937& rng )
+	{
+		std::uniform_real_distribution<float> noise( 0.95f, 1.05f );
+
+		TestMesh mesh;
+		for ( uint32_t ring = 0; ring <= rings; ++ring )
+		{
+			const float theta = float( ring ) / float( rings ) * DirectX::XM_PI;
+			for ( uint32_t segment = 0; segment < segments; ++segment )
+			{
+				const float phi = float( segment ) / float( segments ) * DirectX::XM_2PI;
+				const float r = ( ring == 0 || ring == rings ) ? 1.0f : noise( rng );
+				mesh.positions.push_back( r * std::sin( theta ) * std::cos( phi ) );
+				mesh.positions.push_back( r * std::cos( theta ) );
+				mesh.positions.push_back( r * std::sin( theta ) * std::sin( phi ) );
+			}
+		}
+		for ( uint32_t ring = 0; ring < rings; ++ring )
+		{
+			for ( uint32_t segment = 0; segment < segments; ++segment )
+			{
+				const uint32_t a = ring * segments + segment;
+				const uint32_t b = ring * segments + ( segment + 1 ) % segments;
+				const uint32_t c = a + segments;
+				const uint32_t d = b + segments;
+				mesh.indices.insert( mesh.indices.end(), { a, c, b, b, c, d } );
+			}
+		}
+		return mesh;
+	}
+
+	// positions and faces only, polygons are triangulated as fans
+	bool LoadObjPositions( const char* path, TestMesh& mesh )
+	{
+		std::ifstream file( path );
+		if ( !file )
+			return false;
+
+		std::string line;
+		while ( std::getline( file, line ) )
+		{
+			std::istringstream stream( line );
+			std::string tag;
+			stream >> tag;
+			if ( tag == "v" )
+			{
+				float p[3] = {};
+				stream >> p[0] >> p[1] >> p[2];
+				mesh.positions.insert( mesh.positions.end(), p, p + 3 );
+			}
+			else if ( tag == "f" )
+			{
+				std::vector<uint32_t> face;
+				std::string vertex;
+				while ( stream >> vertex )
+					face.push_back( uint32_t( std::stoul( vertex ) - 1 ) ); // "v/vt/vn", stoul stops at the first slash
+				for ( size_t i = 2; i < face.size(); ++i )
+					mesh.indices.insert( mesh.indices.end(), { face[0], face[i - 1], face[i] } );
+			}
+		}
+		return !mesh.indices.empty();
+	}
+
+	BVHRay MakeRandomRay( std::mt19937& rng )
+	{
+		std::uniform_real_distribution<float> dist( -2.0f, 2.0f );
+
+		BVHRay ray;
+		for ( int axis = 0; axis < 3; ++axis )
+		{
+			ray.origin[axis] = dist( rng );
+			ray.direction[axis] = dist( rng ) * 0.5f - ray.origin[axis]; // roughly towards the center
+		}
+		return ray;
+	}
+
+	struct BruteForceHit
+	{
+		float t = FLT_MAX;
+		uint32_t triangle = BVHHit::Invalid;
+	};
+
+	// Reference path. A hit with t in [ray.t_min + t_margin, ray.t_max - t_margin) counts when it is detected with the given triangle tolerance,
+	// negative tolerance only accepts hits that are safely inside the triangle
+	BruteForceHit BruteForceClosest( const TestMesh& mesh, const BVHRay& ray, float triangle_tolerance, float t_margin )
+	{
+		BruteForceHit res;
+		for ( uint32_t i = 0; i < mesh.NumTriangles(); ++i )
+		{
+			const auto intersection = IntersectRayTriangle( mesh.Vertex( i, 0 ), mesh.Vertex( i, 1 ), mesh.Vertex( i, 2 ), ray.origin, ray.direction );
+			const float t = intersection.coords.m128_f32[2];
+			if ( intersection.HitDetected( 1.e-6f, -ray.t_min - t_margin, triangle_tolerance ) && t < ray.t_max - t_margin && t < res.t )
+			{
+				res.t = t;
+				res.triangle = i;
+			}
+		}
+		return res;
+	}
+
+	float HitPrecision( float t ) { return 1.e-3f * std::max( 1.0f, std::abs( t ) ); }
+
+	// Triangle edges and near-parallel rays are ambiguous for any float implementation, so the result is checked against
+	// two brute force passes: every strict hit must be found, every reported hit must be at least a loose hit
+	void CheckClosestHit( const TestMesh& mesh, const BVHRay& ray, const BVHHit& hit, bool has_hit )
+	{
+		constexpr float strict_tolerance = -1.e-3f;
+		constexpr float loose_tolerance = 1.e-3f;
+
+		const BruteForceHit strict = BruteForceClosest( mesh, ray, strict_tolerance, HitPrecision( ray.t_min ) );
+		if ( strict.triangle != BVHHit::Invalid )
+		{
+			BOOST_REQUIRE( has_hit );
+			BOOST_TEST( hit.t <= strict.t + HitPrecision( strict.t ) );
+		}
+
+		if ( has_hit )
+		{
+			BOOST_REQUIRE( hit.triangle < mesh.NumTriangles() );
+			const auto intersection = IntersectRayTriangle(
+				mesh.Vertex( hit.triangle, 0 ), mesh.Vertex( hit.triangle, 1 ), mesh.Vertex( hit.triangle, 2 ), ray.origin, ray.direction );
+			BOOST_TEST( intersection.HitDetected( 0.0f, HitPrecision( hit.t ), loose_tolerance ) );
+			BOOST_TEST( std::abs( intersection.coords.m128_f32[2] - hit.t ) <= HitPrecision( hit.t ) );
+			// BVHHit barycentrics belong to the second and the third vertex, IntersectRayTriangle ones to the first and the second
+			BOOST_TEST( std::abs( intersection.coords.m128_f32[1] - hit.u ) <= loose_tolerance );
+			BOOST_TEST( std::abs( 1.0f - intersection.coords.m128_f32[0] - intersection.coords.m128_f32[1] - hit.v ) <= loose_tolerance );
+			BOOST_TEST( hit.t >= ray.t_min );
+			BOOST_TEST( hit.t < ray.t_max );
+		}
+	}
+
+	double MillisecondsSince( std::chrono::steady_clock::time_point start )
+	{
+		return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+	}
+
+	void BenchmarkBVH( const char* name, const TestMesh& mesh )
+	{
+		constexpr uint32_t build_count = 5;
+		constexpr uint32_t image_size = 1024;
+
+		MeshBVH bvh;
+		auto start = std::chrono::steady_clock::now();
+		for ( uint32_t i = 0; i < build_count; ++i )
+			bvh.Build( mesh.positions.data(), mesh.NumVertices(), sizeof( float ) * 3, mesh.indices.data(), uint32_t( mesh.indices.size() ) );
+		const double build_ms = MillisecondsSince( start ) / build_count;
+
+		// primary rays of a pinhole camera looking at the mesh, row by row
+		const BVHBounds bounds = bvh.GetBounds();
+		float center[3], extent = 0;
+		for ( int axis = 0; axis < 3; ++axis )
+		{
+			center[axis] = ( bounds.min[axis] + bounds.max[axis] ) * 0.5f;
+			extent = std::max( extent, bounds.max[axis] - bounds.min[axis] );
+		}
+		std::vector<BVHRay> rays( image_size * image_size );
+		for ( uint32_t y = 0; y < image_size; ++y )
+		{
+			for ( uint32_t x = 0; x < image_size; ++x )
+			{
+				BVHRay& ray = rays[y * image_size + x];
+				ray.origin[0] = center[0];
+				ray.origin[1] = center[1];
+				ray.origin[2] = center[2] - extent * 2.0f;
+				ray.direction[0] = ( ( float( x ) + 0.5f ) / image_size - 0.5f ) * 0.6f;
+				ray.direction[1] = ( ( float( y ) + 0.5f ) / image_size - 0.5f ) * 0.6f;
+				ray.direction[2] = 1.0f;
+			}
+		}
+		std::vector<BVHHit> hits( rays.size() );
+		std::vector<uint8_t> occluded( rays.size() );
+
+		start = std::chrono::steady_clock::now();
+		for ( size_t i = 0; i < rays.size(); ++i )
+			bvh.IntersectClosest( rays[i], hits[i] );
+		const double single_ms = MillisecondsSince( start );
+
+		start = std::chrono::steady_clock::now();
+		bvh.IntersectClosest( rays.data(), hits.data(), rays.size() );
+		const double packet_ms = MillisecondsSince( start );
+
+		start = std::chrono::steady_clock::now();
+		bvh.IntersectAny( rays.data(), occluded.data(), rays.size() );
+		const double any_ms = MillisecondsSince( start );
+
+		const size_t hit_count = std::count_if( hits.begin(), hits.end(), []( const BVHHit& hit ) { return hit.IsHit(); } );
+		const double mrays = double( rays.size() ) * 1.e-3;
+		BOOST_TEST_MESSAGE( name << ": " << mesh.NumTriangles() << " triangles, " << bvh.GetNumNodes() << " nodes, "
+			<< bvh.GetMemoryUsage() / ( 1024 * 1024 ) << " MB, build ms: " << build_ms );
+		BOOST_TEST_MESSAGE( "  " << rays.size() << " primary rays, " << hit_count << " hits" );
+		BOOST_TEST_MESSAGE( "  Mrays/s closest single: " << mrays / single_ms << " closest packets: " << mrays / packet_ms
+			<< " any packets: " << mrays / any_ms );
+	}
+}
 
 BOOST_AUTO_TEST_SUITE( intersections )
 
@@ -115,4 +350,268 @@ BOOST_AUTO_TEST_CASE( ray_triangle_regression )
 	}
 }
 
-BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
+BOOST_AUTO_TEST_CASE( mesh_bvh_closest_hit )
+{
+	std::mt19937 rng( 42 );
+
+	for ( uint32_t num_triangles : { 1u, 7u, 200u, 5000u } )
+	{
+		const TestMesh mesh = MakeTriangleSoup( num_triangles, rng );
+
+		// small leaves make deep trees, large ones test leaves with several triangle quads
+		for ( uint32_t max_leaf_size : { 1u, 8u, 16u } )
+		{
+			BVHBuildSettings settings;
+			settings.max_leaf_size = max_leaf_size;
+
+			MeshBVH bvh;
+			bvh.Build( mesh.positions.data(), mesh.NumVertices(), sizeof( float ) * 3, mesh.indices.data(), uint32_t( mesh.indices.size() ), settings );
+			BOOST_TEST( bvh.GetNumTriangles() == num_triangles );
+
+			for ( int i = 0; i < 300; ++i )
+			{
+				BVHRay ray = MakeRandomRay( rng );
+				if ( i % 3 == 1 )
+					ray.t_max = 0.5f;
+				if ( i % 3 == 2 )
+					ray.t_min = 0.3f;
+
+				BVHHit hit;
+				const bool has_hit = bvh.IntersectClosest( ray, hit );
+				BOOST_TEST( has_hit == hit.IsHit() );
+				CheckClosestHit( mesh, ray, hit, has_hit );
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( mesh_bvh_any_hit_and_batches )
+{
+	std::mt19937 rng( 7 );
+	const TestMesh mesh = MakeTriangleSoup( 3000, rng );
+
+	// 16 bit indices go through the same builder
+	std::vector<uint16_t> indices16( mesh.indices.begin(), mesh.indices.end() );
+	MeshBVH bvh;
+	bvh.Build( mesh.positions.data(), mesh.NumVertices(), sizeof( float ) * 3, indices16.data(), uint32_t( indices16.size() ) );
+
+	// batch size is not a multiple of the packet size, so the tail packet is partially filled
+	constexpr size_t num_rays = 1001;
+	std::vector<BVHRay> rays( num_rays );
+	for ( size_t i = 0; i < num_rays; ++i )
+	{
+		// groups of coherent and incoherent rays
+		rays[i] = ( i % 8 < 4 && i > 0 ) ? rays[i - 1] : MakeRandomRay( rng );
+		rays[i].direction[0] += float( i % 4 ) * 0.01f;
+		if ( i % 5 == 0 )
+			rays[i].t_max = 0.7f;
+	}
+
+	std::vector<BVHHit> hits( num_rays );
+	std::vector<uint8_t> occluded( num_rays );
+	bvh.IntersectClosest( rays.data(), hits.data(), num_rays );
+	bvh.IntersectAny( rays.data(), occluded.data(), num_rays );
+
+	for ( size_t i = 0; i < num_rays; ++i )
+	{
+		BVHHit single_hit;
+		const bool has_hit = bvh.IntersectClosest( rays[i], single_hit );
+		CheckClosestHit( mesh, rays[i], hits[i], hits[i].IsHit() );
+
+		BOOST_TEST( hits[i].IsHit() == has_hit );
+		if ( has_hit && hits[i].IsHit() )
+			BOOST_TEST( std::abs( hits[i].t - single_hit.t ) <= HitPrecision( single_hit.t ) );
+
+		BOOST_TEST( bvh.IntersectAny( rays[i] ) == has_hit );
+		BOOST_TEST( bool( occluded[i] ) == has_hit );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( mesh_bvh_serialization )
+{
+	std::mt19937 rng( 11 );
+	const TestMesh mesh = MakeTriangleSoup( 2000, rng );
+
+	MeshBVH bvh;
+	bvh.Build( mesh.positions.data(), mesh.NumVertices(), sizeof( float ) * 3, mesh.indices.data(), uint32_t( mesh.indices.size() ) );
+
+	// unaligned on purpose, cooked files don't guarantee the alignment of the source
+	std::vector<uint8_t> data( bvh.GetSerializedSize() + 1 );
+	bvh.Serialize( data.data() + 1 );
+
+	MeshBVH loaded;
+	BOOST_TEST_REQUIRE( loaded.Deserialize( data.data() + 1, data.size() - 1 ) );
+	BOOST_TEST( loaded.GetNumNodes() == bvh.GetNumNodes() );
+	BOOST_TEST( loaded.GetNumTriangles() == bvh.GetNumTriangles() );
+
+	for ( int i = 0; i < 300; ++i )
+	{
+		const BVHRay ray = MakeRandomRay( rng );
+		BVHHit expected;
+		BVHHit hit;
+		BOOST_TEST( bvh.IntersectClosest( ray, expected ) == loaded.IntersectClosest( ray, hit ) );
+		BOOST_TEST( hit.triangle == expected.triangle );
+		BOOST_TEST( hit.t == expected.t );
+	}
+
+	// truncated data, a different version and child links pointing backwards are rejected
+	BOOST_TEST( !loaded.Deserialize( data.data() + 1, data.size() - 2 ) );
+	BOOST_TEST( loaded.IsEmpty() );
+
+	std::vector<uint8_t> corrupted( data.begin() + 1, data.end() );
+	corrupted[0] ^= 0xff;
+	BOOST_TEST( !loaded.Deserialize( corrupted.data(), corrupted.size() ) );
+
+	corrupted.assign( data.begin() + 1, data.end() );
+	const size_t root_first_offset = 16 + offsetof( BVHNode, first ); // root follows the 16 byte header
+	const uint32_t self_link = 0;
+	memcpy( corrupted.data() + root_first_offset, &self_link, sizeof( self_link ) );
+	BOOST_TEST( !loaded.Deserialize( corrupted.data(), corrupted.size() ) );
+
+	MeshBVH empty;
+	data.resize( empty.GetSerializedSize() );
+	empty.Serialize( data.data() );
+	BOOST_TEST( loaded.Deserialize( data.data(), data.size() ) );
+	BOOST_TEST( loaded.IsEmpty() );
+}
+
+BOOST_AUTO_TEST_CASE( instance_bvh_refit )
+{
+	std::mt19937 rng( 3 );
+	std::uniform_real_distribution<float> dist( -10.0f, 10.0f );
+
+	const TestMesh meshes[2] = { MakeTriangleSoup( 100, rng ), MakeBumpySphere( 16, 8, rng ) };
+	MeshBVH blases[2];
+	for ( int i = 0; i < 2; ++i )
+		blases[i].Build( meshes[i].positions.data(), meshes[i].NumVertices(), sizeof( float ) * 3, meshes[i].indices.data(), uint32_t( meshes[i].indices.size() ) );
+
+	constexpr uint32_t num_instances = 64;
+	std::vector<InstanceBVH::Instance> instances( num_instances );
+	auto randomize_transform = [&]( InstanceBVH::Instance& instance )
+	{
+		const DirectX::XMMATRIX m = DirectX::XMMatrixAffineTransformation(
+			DirectX::XMVectorReplicate( 0.5f + std::abs( dist( rng ) ) * 0.1f ), DirectX::XMVectorZero(),
+			DirectX::XMQuaternionRotationRollPitchYaw( dist( rng ), dist( rng ), dist( rng ) ),
+			DirectX::XMVectorSet( dist( rng ), dist( rng ), dist( rng ), 1.0f ) );
+		DirectX::XMFLOAT4X4 m44;
+		DirectX::XMStoreFloat4x4( &m44, m );
+		// DirectXMath transforms row vectors, object_to_world is for column vectors
+		for ( int row = 0; row < 3; ++row )
+			for ( int col = 0; col < 4; ++col )
+				instance.object_to_world[row][col] = m44.m[col][row];
+	};
+	for ( uint32_t i = 0; i < num_instances; ++i )
+	{
+		instances[i].blas = &blases[i % 2];
+		randomize_transform( instances[i] );
+	}
+
+	// reference: every instance baked into one world space mesh
+	auto bake = [&]( std::vector<uint32_t>& instance_of_triangle )
+	{
+		TestMesh world;
+		instance_of_triangle.clear();
+		for ( uint32_t i = 0; i < num_instances; ++i )
+		{
+			const TestMesh& mesh = meshes[i % 2];
+			const auto& m = instances[i].object_to_world;
+			const uint32_t base_vertex = world.NumVertices();
+			for ( uint32_t v = 0; v < mesh.NumVertices(); ++v )
+			{
+				const float* p = mesh.positions.data() + v * 3;
+				for ( int row = 0; row < 3; ++row )
+					world.positions.push_back( m[row][0] * p[0] + m[row][1] * p[1] + m[row][2] * p[2] + m[row][3] );
+			}
+			for ( uint32_t index : mesh.indices )
+				world.indices.push_back( base_vertex + index );
+			instance_of_triangle.insert( instance_of_triangle.end(), mesh.NumTriangles(), i );
+		}
+		return world;
+	};
+
+	auto check = [&]( const InstanceBVH& tlas )
+	{
+		std::vector<uint32_t> instance_of_triangle;
+		const TestMesh world = bake( instance_of_triangle );
+
+		std::vector<BVHRay> rays( 200 );
+		for ( BVHRay& ray : rays )
+		{
+			ray = MakeRandomRay( rng );
+			for ( int axis = 0; axis < 3; ++axis )
+			{
+				ray.origin[axis] *= 8.0f;
+				ray.direction[axis] *= 8.0f;
+			}
+		}
+		std::vector<BVHHit> hits( rays.size() );
+		tlas.IntersectClosest( rays.data(), hits.data(), rays.size() );
+
+		for ( size_t i = 0; i < rays.size(); ++i )
+		{
+			BVHHit hit;
+			const bool has_hit = tlas.IntersectClosest( rays[i], hit );
+			BOOST_TEST( has_hit == hits[i].IsHit() );
+			BOOST_TEST( tlas.IntersectAny( rays[i] ) == has_hit );
+
+			// convert to the world mesh triangle index
+			BVHHit world_hit = hit;
+			if ( has_hit )
+			{
+				BOOST_REQUIRE( hit.instance < num_instances );
+				const auto first = std::find( instance_of_triangle.begin(), instance_of_triangle.end(), hit.instance );
+				world_hit.triangle = uint32_t( first - instance_of_triangle.begin() ) + hit.triangle;
+			}
+			CheckClosestHit( world, rays[i], world_hit, has_hit );
+		}
+	};
+
+	InstanceBVH tlas;
+	tlas.Build( instances.data(), num_instances );
+	BOOST_TEST( tlas.GetNumInstances() == num_instances );
+	BOOST_TEST( tlas.GetSAHCost() == tlas.GetBuildSAHCost() );
+	check( tlas );
+
+	// move everything, topology stays and the tree gets worse
+	for ( InstanceBVH::Instance& instance : instances )
+		randomize_transform( instance );
+	tlas.Refit( instances.data(), num_instances );
+	check( tlas );
+	BOOST_TEST( tlas.GetSAHCost() >= tlas.GetBuildSAHCost() );
+
+	// instances without a blas never hit
+	for ( uint32_t i = 0; i < num_instances; i += 2 )
+		instances[i].blas = nullptr;
+	tlas.Refit( instances.data(), num_instances );
+	std::vector<BVHRay> rays( 200 );
+	for ( BVHRay& ray : rays )
+	{
+		ray = MakeRandomRay( rng );
+		BVHHit hit;
+		if ( tlas.IntersectClosest( ray, hit ) )
+			BOOST_TEST( hit.instance % 2 == 1 );
+	}
+}
+
+// Run explicitly with --run_test=intersections/benchmark_bvh_bunny --log_level=message
+BOOST_AUTO_TEST_CASE( benchmark_bvh_bunny, * boost::unit_test::disabled() )
+{
+	TestMesh mesh;
+	if ( !LoadObjPositions( "../EngineContent/Meshes/bunny_with_normals.obj", mesh ) )
+	{
+		// the source obj is not in the repository, use a mesh with the same triangle count
+		BOOST_TEST_MESSAGE( "bunny_with_normals.obj not found, using a generated mesh instead" );
+		std::mt19937 rng( 1 );
+		mesh = MakeBumpySphere( 264, 132, rng );
+	}
+	BenchmarkBVH( "bunny", mesh );
+}
+
+// Run explicitly with --run_test=intersections/benchmark_bvh_1m_triangles --log_level=message
+BOOST_AUTO_TEST_CASE( benchmark_bvh_1m_triangles, * boost::unit_test::disabled() )
+{
+	std::mt19937 rng( 1 );
+	BenchmarkBVH( "sphere", MakeBumpySphere( 1024, 512, rng ) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
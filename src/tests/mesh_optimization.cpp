@@ -0,0 +1,269 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+#include <boost/test/unit_test.hpp>
+
+#include <Windows.h>
+#include <DirectXMath.h>
+
+#include <snow_engine/stdafx.h>
+#include <snow_engine/GeomGeneration.h>
+
+#include <utils/MeshOptimization.h>
+
+#include <array>
+#include <chrono>
+#include <random>
+
+namespace
+{
+	struct TestMesh
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	TestMesh MakeGridMesh( size_t nx, size_t ny )
+	{
+		TestMesh mesh;
+		GeomGeneration::MakeGrid( nx, ny, 10.0f, 10.0f,
+								  [&mesh]( float x, float z ) { mesh.vertices.push_back( Vertex{ DirectX::XMFLOAT3( x, 0.0f, z ) } ); },
+								  [&mesh]( size_t idx ) { mesh.indices.push_back( uint32_t( idx ) ); },
+								  [&mesh]( size_t idx, const DirectX::XMFLOAT2& uv ) { mesh.vertices[idx].uv = uv; } );
+		return mesh;
+	}
+
+	TestMesh MakeCubeMesh()
+	{
+		TestMesh mesh;
+		mesh.vertices.assign( GeomGeneration::CubeVertices.cbegin(), GeomGeneration::CubeVertices.cend() );
+		mesh.indices.assign( GeomGeneration::CubeIndices.cbegin(), GeomGeneration::CubeIndices.cend() );
+		return mesh;
+	}
+
+	// closed uv sphere with noisy radius
+	TestMesh MakeNoisySphereMesh( uint32_t segments, uint32_t rings, std::mt19937& rng )
+	{
+		std::uniform_real_distribution<float> noise( 0.9f, 1.1f );
+
+		TestMesh mesh;
+		for ( uint32_t ring = 0; ring <= rings; ++ring )
+		{
+			const float theta = float( ring ) / float( rings ) * DirectX::XM_PI;
+			for ( uint32_t segment = 0; segment < segments; ++segment )
+			{
+				const float phi = float( segment ) / float( segments ) * DirectX::XM_2PI;
+				const float r = noise( rng );
+				mesh.vertices.push_back( Vertex{ DirectX::XMFLOAT3( r * std::sin( theta ) * std::cos( phi ), r * std::cos( theta ), r * std::sin( theta ) * std::sin( phi ) ) } );
+			}
+		}
+		for ( uint32_t ring = 0; ring < rings; ++ring )
+		{
+			for ( uint32_t segment = 0; segment < segments; ++segment )
+			{
+				const uint32_t a = ring * segments + segment;
+				const uint32_t b = ring * segments + ( segment + 1 ) % segments;
+				mesh.indices.insert( mesh.indices.end(), { a, a + segments, b, b, a + segments, b + segments } );
+			}
+		}
+		return mesh;
+	}
+
+	// triangle order of a mesh exported without any optimization
+	void ShuffleTriangles( std::vector<uint32_t>& indices, std::mt19937& rng )
+	{
+		std::vector<std::array<uint32_t, 3>> triangles( indices.size() / 3 );
+		memcpy( triangles.data(), indices.data(), indices.size() * sizeof( uint32_t ) );
+		std::shuffle( triangles.begin(), triangles.end(), rng );
+		memcpy( indices.data(), triangles.data(), indices.size() * sizeof( uint32_t ) );
+	}
+
+	// triangles by vertex positions, rotated to start from the smallest position so the winding is kept
+	std::vector<std::array<float, 9>> GetCanonicalTriangles( const TestMesh& mesh )
+	{
+		std::vector<std::array<float, 9>> triangles;
+		for ( size_t i = 0; i < mesh.indices.size(); i += 3 )
+		{
+			std::array<std::array<float, 3>, 3> corners;
+			for ( size_t corner = 0; corner < 3; ++corner )
+			{
+				const DirectX::XMFLOAT3& p = mesh.vertices[mesh.indices[i + corner]].pos;
+				corners[corner] = { p.x, p.y, p.z };
+			}
+			std::rotate( corners.begin(), std::min_element( corners.begin(), corners.end() ), corners.end() );
+
+			std::array<float, 9> triangle;
+			for ( size_t corner = 0; corner < 3; ++corner )
+				std::copy( corners[corner].begin(), corners[corner].end(), triangle.begin() + corner * 3 );
+			triangles.push_back( triangle );
+		}
+		std::sort( triangles.begin(), triangles.end() );
+		return triangles;
+	}
+
+	struct OptimizedMesh
+	{
+		TestMesh mesh;
+		std::vector<uint32_t> tipsify_indices;
+		std::vector<uint32_t> hard_boundaries;
+	};
+
+	OptimizedMesh OptimizeTestMesh( const TestMesh& mesh )
+	{
+		const uint32_t num_vertices = uint32_t( mesh.vertices.size() );
+
+		OptimizedMesh res;
+		res.tipsify_indices.resize( mesh.indices.size() );
+		OptimizeVertexCacheTipsify( res.tipsify_indices.data(), mesh.indices.data(), mesh.indices.size(), num_vertices, 16, &res.hard_boundaries );
+
+		std::vector<uint32_t> indices( mesh.indices.size() );
+		OptimizeOverdraw( indices.data(), res.tipsify_indices.data(), indices.size(), &mesh.vertices.data()->pos.x, num_vertices, sizeof( Vertex ), res.hard_boundaries );
+
+		std::vector<uint32_t> remap( num_vertices );
+		const uint32_t num_used_vertices = OptimizeVertexFetchRemap( remap.data(), indices.data(), indices.size(), num_vertices );
+		RemapIndices( indices.data(), indices.size(), remap.data() );
+
+		res.mesh.vertices.resize( num_used_vertices );
+		RemapVertices( res.mesh.vertices.data(), mesh.vertices.data(), num_vertices, sizeof( Vertex ), remap.data() );
+		res.mesh.indices = std::move( indices );
+		return res;
+	}
+
+	VertexCacheStats GetCacheStats( const std::vector<uint32_t>& indices, size_t num_vertices )
+	{
+		return AnalyzeVertexCache( indices.data(), indices.size(), uint32_t( num_vertices ) );
+	}
+}
+
+BOOST_AUTO_TEST_SUITE( mesh_optimization )
+
+BOOST_AUTO_TEST_CASE( cache_stats )
+{
+	// a single quad: 4 vertices, 2 triangles
+	const std::vector<uint32_t> quad = { 0, 1, 2, 2, 1, 3 };
+	const VertexCacheStats quad_stats = GetCacheStats( quad, 4 );
+	BOOST_TEST( quad_stats.transformed_vertices == 4u );
+	BOOST_TEST( quad_stats.acmr == 2.0f );
+	BOOST_TEST( quad_stats.atvr == 1.0f );
+
+	// a vertex evicted from a 16 entry cache is transformed again
+	std::vector<uint32_t> strip;
+	for ( uint32_t i = 0; i < 20; ++i )
+		strip.insert( strip.end(), { 3 * i, 3 * i + 1, 3 * i + 2 } );
+	strip.insert( strip.end(), { 0, 1, 2 } );
+	BOOST_TEST( GetCacheStats( strip, 60 ).transformed_vertices == 63u );
+
+	// sequential vertices are fetched once, vertices far apart pull whole cache lines
+	const std::vector<uint32_t> sequential = { 0, 1, 2, 3, 4, 5 };
+	BOOST_TEST( AnalyzeVertexFetchOverfetch( sequential.data(), sequential.size(), 6, 32 ) == 1.0f );
+	const std::vector<uint32_t> scattered = { 0, 100, 200, 300, 400, 500 };
+	BOOST_TEST( AnalyzeVertexFetchOverfetch( scattered.data(), scattered.size(), 501, 32 ) == 2.0f );
+}
+
+BOOST_AUTO_TEST_CASE( optimization_preserves_topology )
+{
+	std::mt19937 rng( 5 );
+
+	std::vector<TestMesh> meshes;
+	meshes.push_back( MakeGridMesh( 40, 30 ) );
+	meshes.push_back( MakeCubeMesh() );
+	meshes.push_back( MakeNoisySphereMesh( 48, 24, rng ) );
+	meshes.push_back( MakeGridMesh( 64, 64 ) );
+	ShuffleTriangles( meshes.back().indices, rng );
+
+	// vertex 0 is not referenced by any triangle and gets dropped
+	TestMesh with_unused = MakeGridMesh( 10, 10 );
+	with_unused.vertices.insert( with_unused.vertices.begin(), Vertex{ DirectX::XMFLOAT3( 100.0f, 100.0f, 100.0f ) } );
+	for ( uint32_t& index : with_unused.indices )
+		index++;
+	meshes.push_back( with_unused );
+
+	for ( const TestMesh& mesh : meshes )
+	{
+		const OptimizedMesh optimized = OptimizeTestMesh( mesh );
+
+		BOOST_TEST_REQUIRE( optimized.mesh.indices.size() == mesh.indices.size() );
+		BOOST_TEST( ( GetCanonicalTriangles( optimized.mesh ) == GetCanonicalTriangles( mesh ) ) );
+
+		TestMesh tipsify_mesh = mesh;
+		tipsify_mesh.indices = optimized.tipsify_indices;
+		BOOST_TEST( ( GetCanonicalTriangles( tipsify_mesh ) == GetCanonicalTriangles( mesh ) ) );
+
+		BOOST_TEST_REQUIRE( !optimized.hard_boundaries.empty() );
+		BOOST_TEST( optimized.hard_boundaries.front() == 0u );
+		BOOST_TEST( std::is_sorted( optimized.hard_boundaries.begin(), optimized.hard_boundaries.end() ) );
+		BOOST_TEST( optimized.hard_boundaries.back() < mesh.indices.size() / 3 );
+
+		// every vertex is referenced and they are numbered in the order of first use
+		uint32_t next_new_vertex = 0;
+		for ( uint32_t index : optimized.mesh.indices )
+		{
+			BOOST_TEST_REQUIRE( index <= next_new_vertex );
+			if ( index == next_new_vertex )
+				next_new_vertex++;
+		}
+		BOOST_TEST( next_new_vertex == optimized.mesh.vertices.size() );
+	}
+
+	BOOST_TEST( meshes.back().vertices.size() == OptimizeTestMesh( meshes.back() ).mesh.vertices.size() + 1 );
+}
+
+BOOST_AUTO_TEST_CASE( optimization_improves_cache_and_fetch )
+{
+	std::mt19937 rng( 6 );
+
+	TestMesh sphere = MakeNoisySphereMesh( 96, 48, rng );
+	ShuffleTriangles( sphere.indices, rng );
+
+	const VertexCacheStats before = GetCacheStats( sphere.indices, sphere.vertices.size() );
+	const OptimizedMesh optimized = OptimizeTestMesh( sphere );
+	const VertexCacheStats tipsify = GetCacheStats( optimized.tipsify_indices, sphere.vertices.size() );
+	const VertexCacheStats after = GetCacheStats( optimized.mesh.indices, optimized.mesh.vertices.size() );
+
+	BOOST_TEST( before.acmr > 2.5f );
+	BOOST_TEST( tipsify.acmr < 0.8f );
+	// overdraw ordering only splits where the cost of a cold cache stays within the 5% threshold,
+	// the tail cluster of every run is not bounded
+	BOOST_TEST( after.acmr < tipsify.acmr * 1.1f );
+
+	const float overfetch_before = AnalyzeVertexFetchOverfetch( sphere.indices.data(), sphere.indices.size(), uint32_t( sphere.vertices.size() ), sizeof( Vertex ) );
+	const float overfetch_after = AnalyzeVertexFetchOverfetch( optimized.mesh.indices.data(), optimized.mesh.indices.size(), uint32_t( optimized.mesh.vertices.size() ), sizeof( Vertex ) );
+	BOOST_TEST( overfetch_after < overfetch_before / 4.0f );
+	BOOST_TEST( overfetch_after < 1.6f );
+}
+
+// Run explicitly with --run_test=mesh_optimization/benchmark_mesh_optimization --log_level=message
+BOOST_AUTO_TEST_CASE( benchmark_mesh_optimization, * boost::unit_test::disabled() )
+{
+	std::mt19937 rng( 1 );
+
+	std::vector<std::pair<const char*, TestMesh>> meshes;
+	meshes.emplace_back( "cube", MakeCubeMesh() );
+	meshes.emplace_back( "grid 512x512", MakeGridMesh( 512, 512 ) );
+	meshes.emplace_back( "shuffled grid 512x512", MakeGridMesh( 512, 512 ) );
+	ShuffleTriangles( meshes.back().second.indices, rng );
+	meshes.emplace_back( "noisy sphere 512x256", MakeNoisySphereMesh( 512, 256, rng ) );
+	meshes.emplace_back( "shuffled noisy sphere 1024x1024", MakeNoisySphereMesh( 1024, 1024, rng ) );
+	ShuffleTriangles( meshes.back().second.indices, rng );
+
+	for ( const auto& [name, mesh] : meshes )
+	{
+		const auto start = std::chrono::steady_clock::now();
+		const OptimizedMesh optimized = OptimizeTestMesh( mesh );
+		const double ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+
+		const VertexCacheStats before = GetCacheStats( mesh.indices, mesh.vertices.size() );
+		const VertexCacheStats tipsify = GetCacheStats( optimized.tipsify_indices, mesh.vertices.size() );
+		const VertexCacheStats after = GetCacheStats( optimized.mesh.indices, optimized.mesh.vertices.size() );
+		const float overfetch_before = AnalyzeVertexFetchOverfetch( mesh.indices.data(), mesh.indices.size(), uint32_t( mesh.vertices.size() ), sizeof( Vertex ) );
+		const float overfetch_after = AnalyzeVertexFetchOverfetch( optimized.mesh.indices.data(), optimized.mesh.indices.size(), uint32_t( optimized.mesh.vertices.size() ), sizeof( Vertex ) );
+
+		const size_t num_triangles = mesh.indices.size() / 3;
+		const double mtris_per_second = double( num_triangles ) / ms / 1000.0;
+		BOOST_TEST_MESSAGE( name << ": " << num_triangles << " triangles, optimized in " << ms << " ms (" << mtris_per_second << " Mtris/s)" );
+		BOOST_TEST_MESSAGE( "  ACMR " << before.acmr << " -> tipsify " << tipsify.acmr << " -> overdraw " << after.acmr );
+		BOOST_TEST_MESSAGE( "  ATVR " << before.atvr << " -> tipsify " << tipsify.atvr << " -> overdraw " << after.atvr );
+		BOOST_TEST_MESSAGE( "  overfetch " << overfetch_before << " -> " << overfetch_after );
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,456 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+#include <boost/test/unit_test.hpp>
+
+#include <Windows.h>
+#include <DirectXMath.h>
+
+#include <snow_engine/stdafx.h>
+#include <snow_engine/GeomGeneration.h>
+
+#include <utils/MeshOptimization.h>
+#include <utils/MeshSimplification.h>
+#include <utils/Meshlets.h>
+
+#include <array>
+#include <chrono>
+#include <map>
+#include <random>
+
+namespace
+{
+	struct TestMesh
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	// heightfield with an open border
+	TestMesh MakeGridMesh( size_t nx, size_t ny, std::mt19937& rng )
+	{
+		std::uniform_real_distribution<float> noise( 0.0f, 0.05f );
+
+		TestMesh mesh;
+		GeomGeneration::MakeGrid( nx, ny, 10.0f, 10.0f,
+								  [&]( float x, float z ) { mesh.vertices.push_back( Vertex{ DirectX::XMFLOAT3( x, noise( rng ), z ) } ); },
+								  [&mesh]( size_t idx ) { mesh.indices.push_back( uint32_t( idx ) ); },
+								  [&mesh]( size_t idx, const DirectX::XMFLOAT2& uv ) { mesh.vertices[idx].uv = uv; } );
+		return mesh;
+	}
+
+	// Closed uv sphere with noisy radius and one vertex per pole. With uv_seam the first column is duplicated with u = 1,
+	// so the mesh is only closed by positions
+	TestMesh MakeSphereMesh( uint32_t segments, uint32_t rings, bool uv_seam, float noise_amplitude, std::mt19937& rng )
+	{
+		std::uniform_real_distribution<float> noise( 1.0f - noise_amplitude, 1.0f + noise_amplitude );
+		const uint32_t columns = uv_seam ? segments + 1 : segments;
+
+		TestMesh mesh;
+		mesh.vertices.push_back( Vertex{ DirectX::XMFLOAT3( 0.0f, 1.0f, 0.0f ), DirectX::XMFLOAT3( 0.0f, 1.0f, 0.0f ) } );
+		mesh.vertices.back().uv = DirectX::XMFLOAT2( 0.5f, 0.0f );
+		for ( uint32_t ring = 1; ring < rings; ++ring )
+		{
+			const float theta = float( ring ) / float( rings ) * DirectX::XM_PI;
+			for ( uint32_t column = 0; column < columns; ++column )
+			{
+				if ( column == segments )
+				{
+					// same position as the first vertex of the ring
+					Vertex seam_vertex = mesh.vertices[mesh.vertices.size() - segments];
+					seam_vertex.uv.x = 1.0f;
+					mesh.vertices.push_back( seam_vertex );
+					continue;
+				}
+				const float phi = float( column ) / float( segments ) * DirectX::XM_2PI;
+				const float r = noise( rng );
+				const DirectX::XMFLOAT3 n( std::sin( theta ) * std::cos( phi ), std::cos( theta ), std::sin( theta ) * std::sin( phi ) );
+				mesh.vertices.push_back( Vertex{ DirectX::XMFLOAT3( r * n.x, r * n.y, r * n.z ), n } );
+				mesh.vertices.back().uv = DirectX::XMFLOAT2( float( column ) / float( segments ), float( ring ) / float( rings ) );
+			}
+		}
+		mesh.vertices.push_back( Vertex{ DirectX::XMFLOAT3( 0.0f, -1.0f, 0.0f ), DirectX::XMFLOAT3( 0.0f, -1.0f, 0.0f ) } );
+		mesh.vertices.back().uv = DirectX::XMFLOAT2( 0.5f, 1.0f );
+
+		const uint32_t north = 0;
+		const uint32_t south = uint32_t( mesh.vertices.size() - 1 );
+		auto ring_vertex = [&]( uint32_t ring, uint32_t segment )
+		{
+			return 1 + ( ring - 1 ) * columns + ( uv_seam ? segment : segment % segments );
+		};
+		for ( uint32_t segment = 0; segment < segments; ++segment )
+		{
+			mesh.indices.insert( mesh.indices.end(), { north, ring_vertex( 1, segment ), ring_vertex( 1, segment + 1 ) } );
+			for ( uint32_t ring = 1; ring + 1 < rings; ++ring )
+			{
+				const uint32_t a = ring_vertex( ring, segment ), b = ring_vertex( ring, segment + 1 );
+				const uint32_t c = ring_vertex( ring + 1, segment ), d = ring_vertex( ring + 1, segment + 1 );
+				mesh.indices.insert( mesh.indices.end(), { a, c, b, b, c, d } );
+			}
+			mesh.indices.insert( mesh.indices.end(), { south, ring_vertex( rings - 1, segment + 1 ), ring_vertex( rings - 1, segment ) } );
+		}
+		return mesh;
+	}
+
+	using Position = std::array<float, 3>;
+
+	Position GetPosition( const TestMesh& mesh, uint32_t vertex )
+	{
+		const DirectX::XMFLOAT3& p = mesh.vertices[vertex].pos;
+		return { p.x, p.y, p.z };
+	}
+
+	// half-edges by position which have no twin
+	std::vector<std::pair<Position, Position>> GetOpenEdges( const TestMesh& mesh, const std::vector<uint32_t>& indices )
+	{
+		std::map<std::pair<Position, Position>, int> edges;
+		for ( size_t i = 0; i < indices.size(); ++i )
+		{
+			const Position from = GetPosition( mesh, indices[i] );
+			const Position to = GetPosition( mesh, indices[i - i % 3 + ( i + 1 ) % 3] );
+			BOOST_TEST_REQUIRE( ( from != to ) );
+			edges[{ from, to }]++;
+		}
+
+		std::vector<std::pair<Position, Position>> open_edges;
+		for ( const auto& [edge, count] : edges )
+		{
+			BOOST_TEST_REQUIRE( count == 1 );
+			if ( edges.find( { edge.second, edge.first } ) == edges.end() )
+				open_edges.push_back( edge );
+		}
+		return open_edges;
+	}
+
+	const float AttributeWeights[5] = { 0.5f, 0.5f, 0.5f, 1.0f, 1.0f };
+
+	size_t Simplify( const TestMesh& mesh, const std::vector<uint32_t>& indices, std::vector<uint32_t>& result, size_t target_index_count,
+					 float target_error, float* result_error, bool use_attributes )
+	{
+		result.resize( indices.size() );
+		const size_t num_indices = SimplifyMesh( result.data(), indices.data(), indices.size(), &mesh.vertices.data()->pos.x, uint32_t( mesh.vertices.size() ), sizeof( Vertex ),
+												 target_index_count, target_error, result_error,
+												 use_attributes ? &mesh.vertices.data()->normal.x : nullptr, sizeof( Vertex ), AttributeWeights, use_attributes ? 3 : 0 );
+		result.resize( num_indices );
+		return num_indices;
+	}
+
+	// largest distance from the vertices of the source to the simplified surface
+	float MeasureDeviation( const TestMesh& mesh, const std::vector<uint32_t>& simplified )
+	{
+		using namespace DirectX;
+		float max_distance = 0.0f;
+		for ( const Vertex& vertex : mesh.vertices )
+		{
+			const XMVECTOR p = XMLoadFloat3( &vertex.pos );
+			float min_distance = FLT_MAX;
+			for ( size_t i = 0; i < simplified.size(); i += 3 )
+			{
+				const XMVECTOR a = XMLoadFloat3( &mesh.vertices[simplified[i]].pos );
+				const XMVECTOR b = XMLoadFloat3( &mesh.vertices[simplified[i + 1]].pos );
+				const XMVECTOR c = XMLoadFloat3( &mesh.vertices[simplified[i + 2]].pos );
+				const XMVECTOR n = XMVector3Normalize( XMVector3Cross( b - a, c - a ) );
+				// plane distance is exact inside the triangle, vertex distance is an upper bound outside of it
+				const XMVECTOR projected = p - n * XMVector3Dot( p - a, n );
+				const bool inside = XMVectorGetX( XMVector3Dot( XMVector3Cross( b - a, projected - a ), n ) ) >= 0.0f
+					&& XMVectorGetX( XMVector3Dot( XMVector3Cross( c - b, projected - b ), n ) ) >= 0.0f
+					&& XMVectorGetX( XMVector3Dot( XMVector3Cross( a - c, projected - c ), n ) ) >= 0.0f;
+				const float distance = inside
+					? std::abs( XMVectorGetX( XMVector3Dot( p - a, n ) ) )
+					: std::min( { XMVectorGetX( XMVector3Length( p - a ) ), XMVectorGetX( XMVector3Length( p - b ) ), XMVectorGetX( XMVector3Length( p - c ) ) } );
+				min_distance = std::min( min_distance, distance );
+			}
+			max_distance = std::max( max_distance, min_distance );
+		}
+		return max_distance;
+	}
+
+	void CheckMeshlets( const std::vector<uint32_t>& indices, const std::vector<Meshlet>& meshlets, const std::vector<uint32_t>& meshlet_vertices,
+						const std::vector<uint8_t>& meshlet_triangles, uint32_t max_vertices, uint32_t max_triangles )
+	{
+		std::vector<uint32_t> reconstructed;
+		for ( const Meshlet& meshlet : meshlets )
+		{
+			BOOST_TEST_REQUIRE( meshlet.num_vertices <= max_vertices );
+			BOOST_TEST_REQUIRE( meshlet.num_triangles <= max_triangles );
+			BOOST_TEST_REQUIRE( meshlet.num_triangles > 0u );
+			BOOST_TEST_REQUIRE( meshlet.triangle_offset % 4 == 0u );
+			BOOST_TEST_REQUIRE( meshlet.vertex_offset + meshlet.num_vertices <= meshlet_vertices.size() );
+			BOOST_TEST_REQUIRE( meshlet.triangle_offset + meshlet.num_triangles * 3 <= meshlet_triangles.size() );
+
+			for ( uint32_t i = 0; i < meshlet.num_triangles * 3; ++i )
+			{
+				const uint8_t local = meshlet_triangles[meshlet.triangle_offset + i];
+				BOOST_TEST_REQUIRE( local < meshlet.num_vertices );
+				reconstructed.push_back( meshlet_vertices[meshlet.vertex_offset + local] );
+			}
+		}
+		BOOST_TEST( ( reconstructed == indices ) );
+	}
+}
+
+BOOST_AUTO_TEST_SUITE( mesh_simplification )
+
+BOOST_AUTO_TEST_CASE( closed_mesh_stays_watertight )
+{
+	std::mt19937 rng( 3 );
+
+	for ( bool uv_seam : { false, true } )
+	{
+		const TestMesh sphere = MakeSphereMesh( 64, 32, uv_seam, 0.05f, rng );
+		BOOST_TEST_REQUIRE( GetOpenEdges( sphere, sphere.indices ).empty() );
+
+		for ( size_t target_triangles : { 1000, 200, 40 } )
+		{
+			std::vector<uint32_t> simplified;
+			float error = 0.0f;
+			Simplify( sphere, sphere.indices, simplified, target_triangles * 3, FLT_MAX, &error, uv_seam );
+
+			BOOST_TEST( simplified.size() <= target_triangles * 3 );
+			BOOST_TEST( simplified.size() >= target_triangles * 3 / 2 );
+			BOOST_TEST( GetOpenEdges( sphere, simplified ).empty() );
+			BOOST_TEST( error > 0.0f );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( open_border_is_kept )
+{
+	std::mt19937 rng( 4 );
+	const TestMesh grid = MakeGridMesh( 48, 48, rng );
+
+	const size_t target_index_count = grid.indices.size() / 60 * 3;
+	std::vector<uint32_t> simplified;
+	Simplify( grid, grid.indices, simplified, target_index_count, FLT_MAX, nullptr, true );
+	BOOST_TEST( simplified.size() <= target_index_count );
+
+	float side_min = FLT_MAX;
+	float side_max = -FLT_MAX;
+	for ( const Vertex& vertex : grid.vertices )
+	{
+		side_min = std::min( side_min, vertex.pos.x );
+		side_max = std::max( side_max, vertex.pos.x );
+	}
+
+	// the border only collapses along itself, so it stays a single loop on the sides of the grid through all corners
+	const auto open_edges = GetOpenEdges( grid, simplified );
+	BOOST_TEST( !open_edges.empty() );
+	std::map<Position, Position> next;
+	for ( const auto& [from, to] : open_edges )
+	{
+		BOOST_TEST_REQUIRE( next.count( from ) == 0u );
+		next[from] = to;
+
+		const bool same_side = from[0] == to[0] || from[2] == to[2];
+		const bool on_side = from[0] == side_min || from[0] == side_max || from[2] == side_min || from[2] == side_max;
+		BOOST_TEST( same_side );
+		BOOST_TEST( on_side );
+	}
+
+	Position position = next.begin()->first;
+	for ( size_t i = 0; i < open_edges.size(); ++i )
+	{
+		BOOST_TEST_REQUIRE( next.count( position ) == 1u );
+		position = next[position];
+	}
+	BOOST_TEST( ( position == next.begin()->first ) );
+
+	size_t corners = 0;
+	for ( const auto& [from, to] : open_edges )
+		corners += ( from[0] == to[0] ) != ( next[to][0] == to[0] ) ? 1 : 0;
+	BOOST_TEST( corners == 4u );
+}
+
+BOOST_AUTO_TEST_CASE( lod_chain_error_is_monotonic )
+{
+	std::mt19937 rng( 5 );
+	const TestMesh sphere = MakeSphereMesh( 48, 24, true, 0.05f, rng );
+
+	// every LOD is simplified from the previous one, errors add up
+	std::vector<uint32_t> lod = sphere.indices;
+	std::vector<float> lod_errors = { 0.0f };
+	std::vector<float> deviations = { 0.0f };
+	while ( lod.size() > 60 )
+	{
+		std::vector<uint32_t> next;
+		float error = 0.0f;
+		Simplify( sphere, lod, next, lod.size() / 2, FLT_MAX, &error, true );
+		BOOST_TEST_REQUIRE( next.size() < lod.size() );
+
+		lod_errors.push_back( lod_errors.back() + error );
+		deviations.push_back( MeasureDeviation( sphere, next ) );
+		lod = std::move( next );
+	}
+
+	BOOST_TEST( lod_errors.size() > 4u );
+	for ( size_t i = 1; i < lod_errors.size(); ++i )
+	{
+		BOOST_TEST( lod_errors[i] > lod_errors[i - 1] );
+		BOOST_TEST( deviations[i] >= deviations[i - 1] * 0.9f );
+		// quadric error is an average over the planes, the largest deviation stays within a small multiple of it
+		BOOST_TEST( deviations[i] <= lod_errors[i] * 4.0f + 1.e-3f );
+	}
+
+	// error bound
+	for ( float target_error : { 0.005f, 0.02f, 0.05f } )
+	{
+		std::vector<uint32_t> simplified;
+		float error = 0.0f;
+		Simplify( sphere, sphere.indices, simplified, 0, target_error, &error, false );
+		BOOST_TEST( error <= target_error );
+		BOOST_TEST( simplified.size() < sphere.indices.size() );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( lod_selection )
+{
+	const float lod_errors[] = { 0.0f, 0.01f, 0.04f, 0.2f };
+	const float projection_scale = GetLODProjectionScale( DirectX::XM_PIDIV2, 1000.0f );
+	BOOST_TEST( projection_scale == 500.0f, boost::test_tools::tolerance( 1.e-4f ) );
+
+	// 0.01 projects to 1 pixel at 5 units
+	BOOST_TEST( SelectLOD( lod_errors, 4, 0.0f, projection_scale, 1.0f ) == 0u );
+	BOOST_TEST( SelectLOD( lod_errors, 4, 4.9f, projection_scale, 1.0f ) == 0u );
+	BOOST_TEST( SelectLOD( lod_errors, 4, 5.0f, projection_scale, 1.0f ) == 1u );
+	BOOST_TEST( SelectLOD( lod_errors, 4, 20.0f, projection_scale, 1.0f ) == 2u );
+	BOOST_TEST( SelectLOD( lod_errors, 4, 1000.0f, projection_scale, 1.0f ) == 3u );
+	BOOST_TEST( SelectLOD( lod_errors, 4, 10.0f, projection_scale, 4.0f ) == 2u );
+	BOOST_TEST( SelectLOD( lod_errors, 1, 1000.0f, projection_scale, 1.0f ) == 0u );
+
+	uint32_t prev_lod = 0;
+	for ( float distance = 0.0f; distance < 200.0f; distance += 0.5f )
+	{
+		const uint32_t lod = SelectLOD( lod_errors, 4, distance, projection_scale, 1.0f );
+		BOOST_TEST( lod >= prev_lod );
+		prev_lod = lod;
+	}
+}
+
+BOOST_AUTO_TEST_CASE( meshlets_cover_mesh )
+{
+	std::mt19937 rng( 6 );
+	const TestMesh sphere = MakeSphereMesh( 96, 48, false, 0.05f, rng );
+	std::vector<uint32_t> indices( sphere.indices.size() );
+	OptimizeVertexCacheTipsify( indices.data(), sphere.indices.data(), indices.size(), uint32_t( sphere.vertices.size() ) );
+
+	for ( auto [max_vertices, max_triangles] : { std::pair{ MaxMeshletVertices, MaxMeshletTriangles }, std::pair{ 3u, 1u }, std::pair{ 32u, 64u } } )
+	{
+		std::vector<Meshlet> meshlets;
+		std::vector<uint32_t> meshlet_vertices;
+		std::vector<uint8_t> meshlet_triangles;
+		BuildMeshlets( meshlets, meshlet_vertices, meshlet_triangles, indices.data(), indices.size(), uint32_t( sphere.vertices.size() ), max_vertices, max_triangles );
+		CheckMeshlets( indices, meshlets, meshlet_vertices, meshlet_triangles, max_vertices, max_triangles );
+
+		if ( max_vertices == MaxMeshletVertices )
+		{
+			// cache optimized order keeps meshlets full
+			const float average_triangles = float( indices.size() / 3 ) / float( meshlets.size() );
+			BOOST_TEST( average_triangles > 60.0f );
+		}
+	}
+
+	// appending keeps the meshlets of earlier ranges
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> meshlet_vertices;
+	std::vector<uint8_t> meshlet_triangles;
+	const size_t half = indices.size() / 6 * 3;
+	BuildMeshlets( meshlets, meshlet_vertices, meshlet_triangles, indices.data(), half, uint32_t( sphere.vertices.size() ) );
+	BuildMeshlets( meshlets, meshlet_vertices, meshlet_triangles, indices.data() + half, indices.size() - half, uint32_t( sphere.vertices.size() ) );
+	CheckMeshlets( indices, meshlets, meshlet_vertices, meshlet_triangles, MaxMeshletVertices, MaxMeshletTriangles );
+}
+
+BOOST_AUTO_TEST_CASE( meshlet_bounds )
+{
+	using namespace DirectX;
+	std::mt19937 rng( 7 );
+	const TestMesh sphere = MakeSphereMesh( 64, 32, false, 0.002f, rng );
+
+	// rows of the sphere go all the way around, cache order makes compact meshlets
+	std::vector<uint32_t> indices( sphere.indices.size() );
+	OptimizeVertexCacheTipsify( indices.data(), sphere.indices.data(), indices.size(), uint32_t( sphere.vertices.size() ) );
+
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> meshlet_vertices;
+	std::vector<uint8_t> meshlet_triangles;
+	BuildMeshlets( meshlets, meshlet_vertices, meshlet_triangles, indices.data(), indices.size(), uint32_t( sphere.vertices.size() ) );
+
+	std::uniform_real_distribution<float> camera_coord( -3.0f, 3.0f );
+	size_t culled = 0;
+	size_t tested = 0;
+	for ( const Meshlet& meshlet : meshlets )
+	{
+		const MeshletBounds bounds = ComputeMeshletBounds( meshlet, meshlet_vertices.data(), meshlet_triangles.data(), &sphere.vertices.data()->pos.x, sizeof( Vertex ) );
+		const XMVECTOR center = XMVectorSet( bounds.center[0], bounds.center[1], bounds.center[2], 0.0f );
+		for ( uint32_t i = 0; i < meshlet.num_vertices; ++i )
+		{
+			const XMVECTOR p = XMLoadFloat3( &sphere.vertices[meshlet_vertices[meshlet.vertex_offset + i]].pos );
+			BOOST_TEST_REQUIRE( XMVectorGetX( XMVector3Length( p - center ) ) <= bounds.radius * 1.0001f );
+		}
+
+		// the cone test is conservative, a culled meshlet has only back faces
+		for ( int camera_idx = 0; camera_idx < 32; ++camera_idx )
+		{
+			const float camera[3] = { camera_coord( rng ), camera_coord( rng ), camera_coord( rng ) };
+			tested++;
+			if ( !IsMeshletBackfacing( bounds, camera ) )
+				continue;
+			culled++;
+
+			const XMVECTOR camera_pos = XMVectorSet( camera[0], camera[1], camera[2], 0.0f );
+			for ( uint32_t triangle = 0; triangle < meshlet.num_triangles; ++triangle )
+			{
+				const uint8_t* local = meshlet_triangles.data() + meshlet.triangle_offset + triangle * 3;
+				const XMVECTOR a = XMLoadFloat3( &sphere.vertices[meshlet_vertices[meshlet.vertex_offset + local[0]]].pos );
+				const XMVECTOR b = XMLoadFloat3( &sphere.vertices[meshlet_vertices[meshlet.vertex_offset + local[1]]].pos );
+				const XMVECTOR c = XMLoadFloat3( &sphere.vertices[meshlet_vertices[meshlet.vertex_offset + local[2]]].pos );
+				const XMVECTOR n = XMVector3Cross( b - a, c - a );
+				BOOST_TEST_REQUIRE( XMVectorGetX( XMVector3Dot( camera_pos - a, n ) ) <= 0.0f );
+			}
+		}
+	}
+	// meshlet cones are around 30 degrees wide, nearby cameras still cull some of them
+	BOOST_TEST( culled > tested / 20 );
+}
+
+// Run explicitly with --run_test=mesh_simplification/benchmark_mesh_simplification --log_level=message
+BOOST_AUTO_TEST_CASE( benchmark_mesh_simplification, * boost::unit_test::disabled() )
+{
+	std::mt19937 rng( 1 );
+
+	std::vector<std::pair<const char*, TestMesh>> meshes;
+	meshes.emplace_back( "grid 2048x1024", MakeGridMesh( 2048, 1024, rng ) );
+	meshes.emplace_back( "sphere 2048x1024", MakeSphereMesh( 2048, 1024, true, 0.05f, rng ) );
+
+	for ( const auto& [name, mesh] : meshes )
+	{
+		const size_t num_triangles = mesh.indices.size() / 3;
+		BOOST_TEST_MESSAGE( name << ": " << num_triangles << " triangles" );
+
+		for ( bool use_attributes : { false, true } )
+		{
+			for ( float ratio : { 0.5f, 0.1f, 0.01f } )
+			{
+				std::vector<uint32_t> simplified;
+				float error = 0.0f;
+				const auto start = std::chrono::steady_clock::now();
+				Simplify( mesh, mesh.indices, simplified, size_t( float( mesh.indices.size() ) * ratio ), FLT_MAX, &error, use_attributes );
+				const double ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+
+				BOOST_TEST_MESSAGE( "  " << ( use_attributes ? "with attributes" : "positions only" ) << ", to " << ratio * 100.0f << "%: "
+									<< simplified.size() / 3 << " triangles, error " << error << ", " << ms << " ms ("
+									<< double( num_triangles ) / ms / 1000.0 << " Mtris/s)" );
+			}
+		}
+
+		std::vector<Meshlet> meshlets;
+		std::vector<uint32_t> meshlet_vertices;
+		std::vector<uint8_t> meshlet_triangles;
+		const auto start = std::chrono::steady_clock::now();
+		BuildMeshlets( meshlets, meshlet_vertices, meshlet_triangles, mesh.indices.data(), mesh.indices.size(), uint32_t( mesh.vertices.size() ) );
+		for ( const Meshlet& meshlet : meshlets )
+			ComputeMeshletBounds( meshlet, meshlet_vertices.data(), meshlet_triangles.data(), &mesh.vertices.data()->pos.x, sizeof( Vertex ) );
+		const double ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+		BOOST_TEST_MESSAGE( "  " << meshlets.size() << " meshlets with bounds in " << ms << " ms" );
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
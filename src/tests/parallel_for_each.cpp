@@ -0,0 +1,214 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <boost/test/unit_test.hpp>
+
+#include <ecs/ArchetypeEntityContainer.h>
+#include <ecs/EntityContainer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <random>
+
+
+BOOST_AUTO_TEST_SUITE( parallel_for_each )
+
+struct Position
+{
+    float x, y, z;
+};
+
+struct Velocity
+{
+    float x, y, z;
+};
+
+template<typename World>
+struct Fixture
+{
+    World world;
+    std::vector<typename World::Entity> entities;
+
+    Fixture( int num_entities )
+    {
+        std::mt19937 rng( 7 );
+        for ( int i = 0; i < num_entities; ++i )
+        {
+            auto entity = world.CreateEntity();
+            entities.push_back( entity );
+            if ( rng() % 4 != 0 )
+                world.template AddComponent<Position>( entity, Position{ float( i ), 0, 0 } );
+            if ( rng() % 3 != 0 )
+                world.template AddComponent<Velocity>( entity, Velocity{ 1, float( i ), 0 } );
+        }
+        // leave some holes in entity ids
+        for ( size_t i = 0; i < entities.size(); i += 7 )
+            world.DestroyEntity( entities[i] );
+    }
+};
+
+template<typename World>
+void CheckSerialOrderMatchesView( World& world )
+{
+    std::vector<uint64_t> view_order;
+    for ( auto&& [entity, pos, vel] : world.template CreateView<Position, Velocity>() )
+        view_order.push_back( entity.comparator );
+
+    SerialTaskScheduler scheduler;
+    std::vector<uint64_t> serial_order;
+    const World& const_world = world;
+    const_world.ParallelForEach( const_world.template CreateView<Position, Velocity>(),
+        [&]( auto entity, const Position& pos, const Velocity& vel )
+        {
+            serial_order.push_back( entity.comparator );
+        }, 100, scheduler );
+
+    BOOST_TEST( view_order == serial_order );
+}
+
+template<typename World>
+void CheckThreadedMatchesSerial( World& world, uint32_t num_threads, size_t grain_size )
+{
+    std::vector<uint64_t> serial_entities;
+    double serial_sum = 0;
+
+    const World& const_world = world;
+    SerialTaskScheduler serial_scheduler;
+    const_world.ParallelForEach( const_world.template CreateView<Position, Velocity>(),
+        [&]( auto entity, const Position& pos, const Velocity& vel )
+        {
+            serial_entities.push_back( entity.comparator );
+            serial_sum += pos.x * vel.y;
+        }, grain_size, serial_scheduler );
+
+    ThreadPoolTaskScheduler threaded_scheduler( num_threads );
+    std::mutex cs;
+    std::vector<uint64_t> threaded_entities;
+    std::atomic<uint64_t> num_visited = 0;
+    const_world.ParallelForEach( const_world.template CreateView<Position, Velocity>(),
+        [&]( auto entity, const Position& pos, const Velocity& vel )
+        {
+            num_visited++;
+            std::lock_guard<std::mutex> lock( cs );
+            threaded_entities.push_back( entity.comparator );
+        }, grain_size, threaded_scheduler );
+
+    std::sort( serial_entities.begin(), serial_entities.end() );
+    std::sort( threaded_entities.begin(), threaded_entities.end() );
+    BOOST_TEST( num_visited == serial_entities.size() );
+    BOOST_TEST( serial_entities == threaded_entities );
+    BOOST_TEST( serial_sum > 0 );
+}
+
+BOOST_AUTO_TEST_CASE( btree_split_keys )
+{
+    btree_map<int, int, 4> test_btree;
+    for ( int i = 0; i < 10000; ++i )
+        test_btree.insert( i * 2, i );
+
+    for ( size_t num_ranges : { 1, 2, 8, 100, 50000 } )
+    {
+        std::vector<int> split_keys = test_btree.get_split_keys( num_ranges );
+        BOOST_TEST( split_keys.size() < std::max<size_t>( num_ranges, 1 ) );
+        BOOST_TEST( std::is_sorted( split_keys.begin(), split_keys.end() ) );
+        BOOST_TEST( ( std::adjacent_find( split_keys.begin(), split_keys.end() ) == split_keys.end() ) );
+    }
+
+    BOOST_TEST( test_btree.lower_bound( 0 ).key() == 0 );
+    BOOST_TEST( test_btree.lower_bound( 1 ).key() == 2 );
+    BOOST_TEST( test_btree.lower_bound( 777 ).key() == 778 );
+    BOOST_TEST( test_btree.lower_bound( 19998 ).key() == 19998 );
+    BOOST_TEST( ! test_btree.lower_bound( 19999 ).valid() );
+}
+
+BOOST_AUTO_TEST_CASE( btree_backend_serial_order )
+{
+    Fixture<EntityContainer<Position, Velocity>> fixture( 5000 );
+    CheckSerialOrderMatchesView( fixture.world );
+}
+
+BOOST_AUTO_TEST_CASE( archetype_backend_serial_order )
+{
+    Fixture<ArchetypeEntityContainer<Position, Velocity>> fixture( 5000 );
+    CheckSerialOrderMatchesView( fixture.world );
+}
+
+BOOST_AUTO_TEST_CASE( btree_backend_threaded )
+{
+    Fixture<EntityContainer<Position, Velocity>> fixture( 20000 );
+    for ( size_t grain_size : { 1, 64, 1000, 100000 } )
+        CheckThreadedMatchesSerial( fixture.world, 4, grain_size );
+}
+
+BOOST_AUTO_TEST_CASE( archetype_backend_threaded )
+{
+    Fixture<ArchetypeEntityContainer<Position, Velocity>> fixture( 20000 );
+    for ( size_t grain_size : { 1, 64, 1000, 100000 } )
+        CheckThreadedMatchesSerial( fixture.world, 4, grain_size );
+}
+
+BOOST_AUTO_TEST_CASE( scheduler_runs_every_task_once )
+{
+    ThreadPoolTaskScheduler scheduler( 8 );
+    for ( size_t num_tasks : { 0, 1, 7, 1000 } )
+    {
+        std::vector<std::atomic<int>> counters( num_tasks );
+        for ( int repeat = 0; repeat < 10; ++repeat )
+            scheduler.ParallelFor( num_tasks, [&]( size_t task_idx ) { counters[task_idx]++; } );
+
+        for ( const auto& counter : counters )
+            BOOST_TEST( counter == 10 );
+    }
+}
+
+// Run explicitly with --run_test=parallel_for_each/benchmark_scaling --log_level=message
+BOOST_AUTO_TEST_CASE( benchmark_scaling, * boost::unit_test::disabled() )
+{
+    constexpr int num_entities = 1000000;
+    constexpr size_t grain_size = 4096;
+    constexpr int num_iterations = 10;
+
+    auto btree_world = std::make_unique<EntityContainer<Position, Velocity>>();
+    auto archetype_world = std::make_unique<ArchetypeEntityContainer<Position, Velocity>>();
+    for ( int i = 0; i < num_entities; ++i )
+    {
+        auto e1 = btree_world->CreateEntity();
+        btree_world->AddComponent<Position>( e1, Position{ float( i ), 0, 0 } );
+        btree_world->AddComponent<Velocity>( e1, Velocity{ 1, 0, 0 } );
+        auto e2 = archetype_world->CreateEntity();
+        archetype_world->AddComponent<Position>( e2, Position{ float( i ), 0, 0 } );
+        archetype_world->AddComponent<Velocity>( e2, Velocity{ 1, 0, 0 } );
+    }
+
+    auto run = []( const auto& world, ITaskScheduler& scheduler ) -> double
+    {
+        const auto start = std::chrono::high_resolution_clock::now();
+        for ( int iteration = 0; iteration < num_iterations; ++iteration )
+        {
+            std::atomic<uint64_t> checksum = 0;
+            world.ParallelForEach( world.template CreateView<Position, Velocity>(),
+                [&]( auto entity, const Position& pos, const Velocity& vel )
+                {
+                    // some math to make the loop body non-trivial
+                    if ( std::sqrt( pos.x * pos.x + vel.x * vel.x ) < 0 )
+                        checksum++;
+                }, grain_size, scheduler );
+        }
+        const auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::milli>( end - start ).count() / num_iterations;
+    };
+
+    const uint32_t max_threads = std::max( std::thread::hardware_concurrency(), 1u );
+    for ( uint32_t num_threads = 1; num_threads <= max_threads; num_threads *= 2 )
+    {
+        ThreadPoolTaskScheduler scheduler( num_threads );
+        const double btree_ms = run( *btree_world, scheduler );
+        const double archetype_ms = run( *archetype_world, scheduler );
+        BOOST_TEST_MESSAGE( num_threads << " threads: btree " << btree_ms << " ms, archetype " << archetype_ms << " ms" );
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
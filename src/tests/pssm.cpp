@@ -8,6 +8,11 @@
 #include <snow_engine/stdafx.h>
 #include <snow_engine/ParallelSplitShadowMapping.h>
 
+#include <utils/CGUtils.h>
+
+#include <chrono>
+#include <random>
+
 BOOST_AUTO_TEST_SUITE( pssm )
 
 BOOST_AUTO_TEST_CASE( split_pos_calc )
@@ -25,4 +30,217 @@ BOOST_AUTO_TEST_CASE( split_pos_calc )
 	BOOST_CHECK_CLOSE( split_positions[0], 16.777, 1 );
 }
 
+namespace
+{
+	struct TestSpheres
+	{
+		std::vector<float> x, y, z, radius;
+
+		ParallelSplitShadowMapping::BoundingSpheresSoA GetSoA() const
+		{
+			ParallelSplitShadowMapping::BoundingSpheresSoA res;
+			res.x = x.data();
+			res.y = y.data();
+			res.z = z.data();
+			res.radius = radius.data();
+			res.count = x.size();
+			return res;
+		}
+	};
+
+	TestSpheres MakeRandomSpheres( std::mt19937& rng, size_t count, float scene_size )
+	{
+		std::uniform_real_distribution<float> pos( -scene_size, scene_size );
+		std::exponential_distribution<float> radius( 1.0f );
+
+		TestSpheres spheres;
+		for ( size_t i = 0; i < count; ++i )
+		{
+			spheres.x.push_back( pos( rng ) );
+			spheres.y.push_back( pos( rng ) );
+			spheres.z.push_back( pos( rng ) );
+			spheres.radius.push_back( i % 16 == 0 ? 0.0f : radius( rng ) * scene_size * 0.01f );
+		}
+		return spheres;
+	}
+
+	struct TestLight
+	{
+		DirectX::XMFLOAT3 dir;
+		std::vector<float> split_positions;
+	};
+
+	std::vector<TestLight> MakeRandomLights( std::mt19937& rng, size_t count, size_t num_cascades, float far_z )
+	{
+		std::uniform_real_distribution<float> coord( -1.0f, 1.0f );
+		std::uniform_real_distribution<float> uniform_factor( 0.0f, 1.0f );
+
+		std::vector<TestLight> lights( count );
+		for ( TestLight& light : lights )
+		{
+			DirectX::XMStoreFloat3( &light.dir, DirectX::XMVector3Normalize( DirectX::XMVectorSet( coord( rng ), coord( rng ) - 1.5f, coord( rng ), 0 ) ) );
+			light.split_positions.resize( num_cascades - 1 );
+			if ( num_cascades > 1 )
+				ParallelSplitShadowMapping::CalcSplitPositionsVS( 0.1f, far_z, uniform_factor( rng ), make_span( light.split_positions ) );
+		}
+		return lights;
+	}
+
+	std::vector<ParallelSplitShadowMapping::CascadeCullingLight> MakeCullingLights( const std::vector<TestLight>& lights )
+	{
+		std::vector<ParallelSplitShadowMapping::CascadeCullingLight> res;
+		for ( const TestLight& light : lights )
+			res.push_back( { light.dir, make_span( light.split_positions ) } );
+		return res;
+	}
+
+	// per item per light, the way OldRenderer used to do it
+	std::vector<uint32_t> CalcMasksReference( const DirectX::XMFLOAT3& camera_pos, const TestSpheres& spheres, const std::vector<TestLight>& lights )
+	{
+		std::vector<uint32_t> masks( spheres.x.size(), 0 );
+		bc::small_vector<bool, MAX_CASCADE_SIZE> splits;
+		for ( size_t item = 0; item < masks.size(); ++item )
+		{
+			const DirectX::XMVECTOR center_to_camera = DirectX::XMVectorSubtract( DirectX::XMVectorSet( spheres.x[item], spheres.y[item], spheres.z[item], 0 ),
+			                                                                      DirectX::XMLoadFloat3( &camera_pos ) );
+			uint32_t first_bit = 0;
+			for ( const TestLight& light : lights )
+			{
+				splits.resize( light.split_positions.size() + 1 );
+				for ( bool& in_split : splits )
+					in_split = false;
+
+				span<bool> splits_span = make_span( splits );
+				FindPSSMFrustumsForItem( center_to_camera, spheres.radius[item], DirectX::XMLoadFloat3( &light.dir ), make_span( light.split_positions ), splits_span );
+
+				for ( size_t i = 0; i < splits.size(); ++i )
+					if ( splits[i] )
+						masks[item] |= 1u << ( first_bit + i );
+				first_bit += uint32_t( splits.size() );
+			}
+		}
+		return masks;
+	}
+
+	// FindPSSMFrustumsForItem uses an estimated vector length, so spheres touching a split boundary may go either way
+	bool IsNearSplitBoundary( const DirectX::XMFLOAT3& camera_pos, const TestSpheres& spheres, size_t item, const std::vector<TestLight>& lights )
+	{
+		const double c[3] = { double( spheres.x[item] ) - camera_pos.x, double( spheres.y[item] ) - camera_pos.y, double( spheres.z[item] ) - camera_pos.z };
+		const double radius = spheres.radius[item] * 1.001 + 1.e-3;
+		for ( const TestLight& light : lights )
+		{
+			const double l[3] = { light.dir.x, light.dir.y, light.dir.z };
+			const double proj = c[0] * l[0] + c[1] * l[1] + c[2] * l[2];
+			double dist_sq = 0;
+			for ( int i = 0; i < 3; ++i )
+				dist_sq += ( c[i] - l[i] * proj ) * ( c[i] - l[i] * proj );
+			const double dist = std::sqrt( dist_sq );
+			const double tolerance = 2.e-3 * std::max( dist, 1.0 );
+
+			for ( float split : light.split_positions )
+			{
+				if ( std::abs( dist - radius - split ) < tolerance || std::abs( dist + radius - split ) < tolerance )
+					return true;
+			}
+		}
+		return false;
+	}
+
+	void CheckAgainstReference( const DirectX::XMFLOAT3& camera_pos, const TestSpheres& spheres, const std::vector<TestLight>& lights )
+	{
+		const auto culling_lights = MakeCullingLights( lights );
+		std::vector<uint32_t> masks( spheres.x.size(), ~0u );
+		ParallelSplitShadowMapping::CalcCascadeMasks( camera_pos, spheres.GetSoA(), make_span( culling_lights ), make_span( masks ) );
+
+		const std::vector<uint32_t> reference = CalcMasksReference( camera_pos, spheres, lights );
+
+		size_t num_checked = 0;
+		for ( size_t item = 0; item < masks.size(); ++item )
+		{
+			if ( IsNearSplitBoundary( camera_pos, spheres, item, lights ) )
+				continue;
+
+			if ( masks[item] != reference[item] )
+				BOOST_TEST_FAIL( "item " << item << ": " << masks[item] << " != " << reference[item] );
+			num_checked++;
+		}
+		BOOST_TEST( num_checked > masks.size() * 9 / 10 );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( cascade_masks_bit_layout )
+{
+	// 3 lights with 1, 3 and 4 cascades, one sphere at the camera and one far away from every light axis
+	const std::vector<TestLight> lights =
+	{
+		{ { 0, -1, 0 }, {} },
+		{ { 1, 0, 0 }, { 10.0f, 20.0f } },
+		{ { 0, 0, 1 }, { 10.0f, 20.0f, 30.0f } },
+	};
+	TestSpheres spheres;
+	spheres.x = { 5.0f, 105.0f };
+	spheres.y = { 0.0f, 100.0f };
+	spheres.z = { 0.0f, 100.0f };
+	spheres.radius = { 1.0f, 1.0f };
+
+	const auto culling_lights = MakeCullingLights( lights );
+	std::vector<uint32_t> masks( 2, ~0u );
+	ParallelSplitShadowMapping::CalcCascadeMasks( DirectX::XMFLOAT3( 5, 0, 0 ), spheres.GetSoA(), make_span( culling_lights ), make_span( masks ) );
+
+	// light 0: bit 0, light 1: bits 1-3, light 2: bits 4-7
+	BOOST_TEST( masks[0] == ( ( 1u << 0 ) | ( 1u << 1 ) | ( 1u << 4 ) ) );
+	BOOST_TEST( masks[1] == ( ( 1u << 0 ) | ( 1u << 3 ) | ( 1u << 7 ) ) );
+}
+
+BOOST_AUTO_TEST_CASE( cascade_masks_match_per_item )
+{
+	std::mt19937 rng( 1 );
+	std::uniform_real_distribution<float> camera_coord( -50.0f, 50.0f );
+
+	for ( size_t num_cascades = 1; num_cascades <= MAX_CASCADE_SIZE; ++num_cascades )
+	{
+		for ( size_t num_lights : { 1, 2, 4 } )
+		{
+			// odd count for the scalar tail
+			const TestSpheres spheres = MakeRandomSpheres( rng, 4001, 200.0f );
+			const std::vector<TestLight> lights = MakeRandomLights( rng, num_lights, num_cascades, 300.0f );
+			const DirectX::XMFLOAT3 camera_pos( camera_coord( rng ), camera_coord( rng ), camera_coord( rng ) );
+
+			CheckAgainstReference( camera_pos, spheres, lights );
+		}
+	}
+}
+
+// Run explicitly with --run_test=pssm/benchmark_cascade_masks --log_level=message
+BOOST_AUTO_TEST_CASE( benchmark_cascade_masks, * boost::unit_test::disabled() )
+{
+	constexpr int frame_count = 20;
+	constexpr size_t num_items = 200'000;
+
+	std::mt19937 rng( 1 );
+	const TestSpheres spheres = MakeRandomSpheres( rng, num_items, 1000.0f );
+	const std::vector<TestLight> lights = MakeRandomLights( rng, 4, 4, 1000.0f );
+	const auto culling_lights = MakeCullingLights( lights );
+	const DirectX::XMFLOAT3 camera_pos( 10, 20, 30 );
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<uint32_t> reference;
+	for ( int i = 0; i < frame_count; ++i )
+		reference = CalcMasksReference( camera_pos, spheres, lights );
+	const double reference_ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count() / frame_count;
+
+	std::vector<uint32_t> masks( num_items );
+	start = std::chrono::steady_clock::now();
+	for ( int i = 0; i < frame_count; ++i )
+		ParallelSplitShadowMapping::CalcCascadeMasks( camera_pos, spheres.GetSoA(), make_span( culling_lights ), make_span( masks ) );
+	const double batched_ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count() / frame_count;
+
+	size_t num_different = 0;
+	for ( size_t i = 0; i < num_items; ++i )
+		num_different += masks[i] != reference[i];
+
+	BOOST_TEST_MESSAGE( num_items << " items, 4 lights x 4 cascades. Per item ms: " << reference_ms << ", batched ms: " << batched_ms
+	                    << ", masks differing on split boundaries: " << num_different );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
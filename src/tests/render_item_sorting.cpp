@@ -0,0 +1,260 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+#include <boost/test/unit_test.hpp>
+
+#include <Windows.h>
+#include <DirectXMath.h>
+
+#include <snow_engine/stdafx.h>
+#include <snow_engine/RenderItemSorting.h>
+
+#include <chrono>
+#include <random>
+
+BOOST_AUTO_TEST_SUITE( render_item_sorting )
+
+BOOST_AUTO_TEST_CASE( sort_key_field_order )
+{
+	RenderSortKey base;
+	base.pass = 1;
+	base.pso = 100;
+	base.material = 1000;
+	base.mesh = 2000;
+	base.depth = 3000;
+
+	const RenderSortKey decoded = RenderSortKey::Decode( base.Encode() );
+	BOOST_TEST( decoded.pass == base.pass );
+	BOOST_TEST( decoded.pso == base.pso );
+	BOOST_TEST( decoded.material == base.material );
+	BOOST_TEST( decoded.mesh == base.mesh );
+	BOOST_TEST( decoded.depth == base.depth );
+
+	// a larger value of a more significant field wins over any value of the less significant ones
+	uint32_t RenderSortKey::* fields[] = { &RenderSortKey::pass, &RenderSortKey::pso, &RenderSortKey::material, &RenderSortKey::mesh, &RenderSortKey::depth };
+	for ( size_t i = 0; i < std::size( fields ); ++i )
+	{
+		RenderSortKey larger = base;
+		larger.*fields[i] += 1;
+		for ( size_t j = i + 1; j < std::size( fields ); ++j )
+			larger.*fields[j] = 0;
+
+		RenderSortKey smaller = base;
+		for ( size_t j = i + 1; j < std::size( fields ); ++j )
+			smaller.*fields[j] = 0xffffffff;
+
+		BOOST_TEST( larger.Encode() > smaller.Encode() );
+	}
+
+	// wide ids are truncated instead of spilling into the other fields
+	RenderSortKey wide;
+	wide.mesh = 0x12345;
+	BOOST_TEST( RenderSortKey::Decode( wide.Encode() ).mesh == 0x2345u );
+	BOOST_TEST( RenderSortKey::Decode( wide.Encode() ).material == 0u );
+}
+
+BOOST_AUTO_TEST_CASE( quantized_depth_is_monotonic )
+{
+	BOOST_TEST( RenderSortKey::QuantizeDepth( -1.0f ) == 0u );
+	BOOST_TEST( RenderSortKey::QuantizeDepth( 0.0f ) == 0u );
+	BOOST_TEST( RenderSortKey::QuantizeDepth( 1.e30f ) < ( 1u << RenderSortKey::DepthBits ) );
+
+	uint32_t prev = 0;
+	for ( float depth = 1.e-3f; depth < 1.e5f; depth *= 1.01f )
+	{
+		const uint32_t quantized = RenderSortKey::QuantizeDepth( depth );
+		BOOST_TEST_REQUIRE( quantized >= prev );
+		prev = quantized;
+
+		// 8 bits of mantissa are kept, so depths 1% apart never share a value
+		BOOST_TEST_REQUIRE( RenderSortKey::QuantizeDepth( depth * 1.01f ) > quantized );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( radix_sort_matches_stable_sort )
+{
+	std::mt19937_64 rng( 1 );
+
+	// full range keys, keys with constant bytes (skipped passes) and many duplicates
+	const uint64_t key_masks[] = { ~0ull, 0x0000ffff00ff0000ull, 0xf000000000000001ull, 0ull };
+	for ( uint64_t key_mask : key_masks )
+	{
+		for ( size_t n : { 0, 1, 2, 100, 10000 } )
+		{
+			std::vector<uint64_t> keys( n );
+			std::vector<uint32_t> payload( n );
+			for ( size_t i = 0; i < n; ++i )
+			{
+				keys[i] = ( rng() & key_mask ) | 0x0100000000000000ull;
+				payload[i] = uint32_t( i );
+			}
+
+			std::vector<std::pair<uint64_t, uint32_t>> reference;
+			for ( size_t i = 0; i < n; ++i )
+				reference.emplace_back( keys[i], payload[i] );
+			std::stable_sort( reference.begin(), reference.end(), []( const auto& lhs, const auto& rhs ) { return lhs.first < rhs.first; } );
+
+			std::vector<uint64_t> keys_scratch( n );
+			std::vector<uint32_t> payload_scratch( n );
+			RadixSortKeys( make_span( keys ), make_span( payload ), make_span( keys_scratch ), make_span( payload_scratch ) );
+
+			for ( size_t i = 0; i < n; ++i )
+			{
+				BOOST_TEST_REQUIRE( keys[i] == reference[i].first );
+				BOOST_TEST_REQUIRE( payload[i] == reference[i].second );
+			}
+		}
+	}
+}
+
+namespace
+{
+	struct TestScene
+	{
+		std::vector<RenderItem> items;
+		std::vector<uint64_t> keys;
+	};
+
+	// items share a handful of meshes and materials, as a scene made from a small set of assets
+	TestScene MakeTestScene( std::mt19937& rng, size_t num_items, uint32_t num_meshes, uint32_t num_materials )
+	{
+		std::uniform_int_distribution<uint32_t> mesh_dist( 0, num_meshes - 1 );
+		std::uniform_int_distribution<uint32_t> material_dist( 0, num_materials - 1 );
+		std::uniform_real_distribution<float> depth_dist( 0.1f, 1000.0f );
+
+		TestScene scene;
+		for ( size_t i = 0; i < num_items; ++i )
+		{
+			const uint32_t mesh = mesh_dist( rng );
+			const uint32_t material = material_dist( rng );
+
+			RenderItem item;
+			// never dereferenced
+			item.material = reinterpret_cast<const IRenderMaterial*>( uintptr_t( 0x1000 ) + material * 64 );
+			item.vbv.BufferLocation = 0x100000 + mesh / 4 * 0x10000;
+			item.vbv.SizeInBytes = 0x10000;
+			item.vbv.StrideInBytes = 32;
+			item.ibv.BufferLocation = 0x800000 + mesh / 4 * 0x10000;
+			item.ibv.SizeInBytes = 0x10000;
+			item.ibv.Format = DXGI_FORMAT_R32_UINT;
+			item.index_count = 300;
+			item.index_offset = ( mesh % 4 ) * 300;
+			item.local2world._41 = float( i );
+			scene.items.push_back( item );
+
+			RenderSortKey key;
+			key.material = material;
+			key.mesh = mesh;
+			key.depth = RenderSortKey::QuantizeDepth( depth_dist( rng ) );
+			scene.keys.push_back( key.Encode() );
+		}
+		return scene;
+	}
+
+	std::vector<RenderItem> SortByKeys( const TestScene& scene )
+	{
+		std::vector<uint64_t> keys = scene.keys;
+		std::vector<uint32_t> order( keys.size() );
+		for ( size_t i = 0; i < order.size(); ++i )
+			order[i] = uint32_t( i );
+
+		std::vector<uint64_t> keys_scratch( keys.size() );
+		std::vector<uint32_t> order_scratch( keys.size() );
+		RadixSortKeys( make_span( keys ), make_span( order ), make_span( keys_scratch ), make_span( order_scratch ) );
+
+		std::vector<RenderItem> sorted;
+		sorted.reserve( order.size() );
+		for ( uint32_t item_idx : order )
+			sorted.push_back( scene.items[item_idx] );
+		return sorted;
+	}
+}
+
+BOOST_AUTO_TEST_CASE( batches_cover_sorted_items )
+{
+	std::mt19937 rng( 2 );
+
+	for ( uint32_t max_instances : { 1u, 7u, uint32_t( MAX_INSTANCES_PER_BATCH ) } )
+	{
+		const TestScene scene = MakeTestScene( rng, 5000, 20, 5 );
+		const std::vector<RenderItem> sorted = SortByKeys( scene );
+
+		std::vector<RenderItemBatchRange> batches;
+		BatchRenderItems( make_span( sorted ), max_instances, batches );
+
+		// batches are consecutive, cover every item once and only hold items that can share a draw
+		uint32_t next_item = 0;
+		for ( size_t batch_idx = 0; batch_idx < batches.size(); ++batch_idx )
+		{
+			const RenderItemBatchRange& batch = batches[batch_idx];
+			BOOST_TEST_REQUIRE( batch.first == next_item );
+			BOOST_TEST_REQUIRE( batch.count > 0u );
+			BOOST_TEST_REQUIRE( batch.count <= max_instances );
+			for ( uint32_t i = 1; i < batch.count; ++i )
+				BOOST_TEST_REQUIRE( CanBatchRenderItems( sorted[batch.first], sorted[batch.first + i] ) );
+
+			// batches are only split by the instance limit or by a state change
+			if ( batch_idx + 1 < batches.size() && batch.count < max_instances )
+				BOOST_TEST_REQUIRE( !CanBatchRenderItems( sorted[batch.first], sorted[batch.first + batch.count] ) );
+
+			next_item += batch.count;
+		}
+		BOOST_TEST( next_item == sorted.size() );
+
+		// 20 meshes x 5 materials
+		if ( max_instances == MAX_INSTANCES_PER_BATCH )
+			BOOST_TEST( batches.size() <= 100u );
+	}
+}
+
+// Run explicitly with --run_test=render_item_sorting/benchmark_50k --log_level=message
+BOOST_AUTO_TEST_CASE( benchmark_50k, * boost::unit_test::disabled() )
+{
+	constexpr int frame_count = 20;
+	constexpr size_t num_items = 50'000;
+
+	std::mt19937 rng( 1 );
+	const TestScene scene = MakeTestScene( rng, num_items, 200, 50 );
+
+	// comparison sort by material pointer, every item is a draw
+	auto start = std::chrono::steady_clock::now();
+	std::vector<RenderItem> reference;
+	for ( int i = 0; i < frame_count; ++i )
+	{
+		reference = scene.items;
+		boost::sort( reference, []( const auto& lhs, const auto& rhs ) { return lhs.material < rhs.material; } );
+	}
+	const double reference_ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count() / frame_count;
+
+	std::vector<uint64_t> keys( num_items );
+	std::vector<uint32_t> order( num_items );
+	std::vector<uint64_t> keys_scratch( num_items );
+	std::vector<uint32_t> order_scratch( num_items );
+	std::vector<RenderItem> sorted;
+	sorted.reserve( num_items );
+	std::vector<RenderItemBatchRange> batches;
+
+	double sort_ms = 0;
+	double batch_ms = 0;
+	for ( int frame = 0; frame < frame_count; ++frame )
+	{
+		start = std::chrono::steady_clock::now();
+		keys = scene.keys;
+		for ( size_t i = 0; i < num_items; ++i )
+			order[i] = uint32_t( i );
+		RadixSortKeys( make_span( keys ), make_span( order ), make_span( keys_scratch ), make_span( order_scratch ) );
+		sorted.clear();
+		for ( uint32_t item_idx : order )
+			sorted.push_back( scene.items[item_idx] );
+		const auto sorted_time = std::chrono::steady_clock::now();
+
+		BatchRenderItems( make_span( sorted ), MAX_INSTANCES_PER_BATCH, batches );
+
+		sort_ms += std::chrono::duration<double, std::milli>( sorted_time - start ).count() / frame_count;
+		batch_ms += std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - sorted_time ).count() / frame_count;
+	}
+
+	BOOST_TEST_MESSAGE( num_items << " items. Comparison sort ms: " << reference_ms << ", draws: " << reference.size() );
+	BOOST_TEST_MESSAGE( "  radix sort ms: " << sort_ms << ", batching ms: " << batch_ms << ", draws: " << batches.size() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
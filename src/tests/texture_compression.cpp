@@ -0,0 +1,511 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+#include <boost/test/unit_test.hpp>
+
+#include <utils/TaskScheduler.h>
+#include <utils/TextureCompression.h>
+#include <utils/TextureMips.h>
+
+#include <chrono>
+#include <cmath>
+#include <random>
+
+namespace
+{
+	constexpr float Pi = 3.14159265f;
+
+	// Smooth random lattice with bilinear interpolation, the low frequency part of the reference images
+	class ValueNoise
+	{
+	public:
+		ValueNoise( uint32_t cells_x, uint32_t cells_y, std::mt19937& rng )
+			: m_cells_x( cells_x ), m_cells_y( cells_y )
+		{
+			std::uniform_real_distribution<float> value( 0.0f, 1.0f );
+			m_lattice.resize( size_t( cells_x + 1 ) * ( cells_y + 1 ) );
+			for ( float& v : m_lattice )
+				v = value( rng );
+		}
+
+		// u and v in [0, 1]
+		float Sample( float u, float v ) const
+		{
+			const float x = u * float( m_cells_x );
+			const float y = v * float( m_cells_y );
+			const uint32_t x0 = std::min( uint32_t( x ), m_cells_x - 1 );
+			const uint32_t y0 = std::min( uint32_t( y ), m_cells_y - 1 );
+			const float fx = x - float( x0 );
+			const float fy = y - float( y0 );
+			auto at = [&]( uint32_t cx, uint32_t cy ) { return m_lattice[size_t( cy ) * ( m_cells_x + 1 ) + cx]; };
+			const float top = at( x0, y0 ) * ( 1.0f - fx ) + at( x0 + 1, y0 ) * fx;
+			const float bottom = at( x0, y0 + 1 ) * ( 1.0f - fx ) + at( x0 + 1, y0 + 1 ) * fx;
+			return top * ( 1.0f - fy ) + bottom * fy;
+		}
+
+	private:
+		uint32_t m_cells_x = 0;
+		uint32_t m_cells_y = 0;
+		std::vector<float> m_lattice;
+	};
+
+	// Stand-in for a photograph: smooth correlated color regions, a few sharp edges and some grain
+	TextureImage MakeColorImage( uint32_t width, uint32_t height, std::mt19937& rng )
+	{
+		ValueNoise base( 8, 8, rng );
+		ValueNoise hue( 5, 5, rng );
+		ValueNoise detail( width / 8, height / 8, rng );
+		std::normal_distribution<float> grain( 0.0f, 0.01f );
+
+		TextureImage image;
+		image.width = width;
+		image.height = height;
+		image.texels.resize( size_t( width ) * height * 4 );
+		for ( uint32_t y = 0; y < height; ++y )
+		{
+			for ( uint32_t x = 0; x < width; ++x )
+			{
+				const float u = ( float( x ) + 0.5f ) / float( width );
+				const float v = ( float( y ) + 0.5f ) / float( height );
+				const float luminance = base.Sample( u, v ) * 0.7f + detail.Sample( u, v ) * 0.2f + ( ( x / 64 + y / 64 ) % 5 == 0 ? 0.1f : 0.0f );
+				const float h = hue.Sample( u, v ) * 2.0f * Pi;
+				float* texel = &image.texels[( size_t( y ) * width + x ) * 4];
+				texel[0] = luminance * ( 0.75f + 0.25f * std::cos( h ) ) + grain( rng );
+				texel[1] = luminance * ( 0.75f + 0.25f * std::cos( h - 2.0f * Pi / 3.0f ) ) + grain( rng );
+				texel[2] = luminance * ( 0.75f + 0.25f * std::cos( h + 2.0f * Pi / 3.0f ) ) + grain( rng );
+				texel[3] = std::clamp( base.Sample( v, u ) * 1.5f - 0.25f, 0.0f, 1.0f );
+				for ( int c = 0; c < 3; ++c )
+					texel[c] = std::clamp( texel[c], 0.0f, 1.0f );
+			}
+		}
+		return image;
+	}
+
+	// Tangent space normals of a bumpy height field, stored as n * 0.5 + 0.5
+	TextureImage MakeNormalMap( uint32_t width, uint32_t height, std::mt19937& rng )
+	{
+		ValueNoise bumps( width / 16, height / 16, rng );
+		auto height_at = [&]( int x, int y )
+		{
+			const float u = std::clamp( ( float( x ) + 0.5f ) / float( width ), 0.0f, 1.0f );
+			const float v = std::clamp( ( float( y ) + 0.5f ) / float( height ), 0.0f, 1.0f );
+			return bumps.Sample( u, v ) * 8.0f;
+		};
+
+		TextureImage image;
+		image.width = width;
+		image.height = height;
+		image.texels.resize( size_t( width ) * height * 4 );
+		for ( uint32_t y = 0; y < height; ++y )
+		{
+			for ( uint32_t x = 0; x < width; ++x )
+			{
+				const float dx = height_at( int( x ) + 1, int( y ) ) - height_at( int( x ) - 1, int( y ) );
+				const float dy = height_at( int( x ), int( y ) + 1 ) - height_at( int( x ), int( y ) - 1 );
+				const float length = std::sqrt( dx * dx + dy * dy + 1.0f );
+				float* texel = &image.texels[( size_t( y ) * width + x ) * 4];
+				texel[0] = -dx / length * 0.5f + 0.5f;
+				texel[1] = -dy / length * 0.5f + 0.5f;
+				texel[2] = 1.0f / length * 0.5f + 0.5f;
+				texel[3] = 1.0f;
+			}
+		}
+		return image;
+	}
+
+	// Sky-like radiance from 0.01 to a few hundred with a bright sun disc
+	TextureImage MakeHDRImage( uint32_t width, uint32_t height, std::mt19937& rng )
+	{
+		ValueNoise clouds( 12, 6, rng );
+
+		TextureImage image;
+		image.width = width;
+		image.height = height;
+		image.texels.resize( size_t( width ) * height * 4 );
+		for ( uint32_t y = 0; y < height; ++y )
+		{
+			for ( uint32_t x = 0; x < width; ++x )
+			{
+				const float u = ( float( x ) + 0.5f ) / float( width );
+				const float v = ( float( y ) + 0.5f ) / float( height );
+				const float sun_distance = std::hypot( u - 0.7f, v - 0.3f );
+				const float exposure = std::exp2( 8.0f * clouds.Sample( u, v ) - 6.0f ) + ( sun_distance < 0.03f ? 300.0f : 0.0f );
+				float* texel = &image.texels[( size_t( y ) * width + x ) * 4];
+				texel[0] = exposure * ( 0.6f + 0.4f * v );
+				texel[1] = exposure * 0.8f;
+				texel[2] = exposure * ( 1.0f - 0.5f * v );
+				texel[3] = 1.0f;
+			}
+		}
+		return image;
+	}
+
+	// over the first num_channels channels of values in [0, 1]
+	double PSNR( const std::vector<float>& reference, const std::vector<float>& decoded, uint32_t num_channels )
+	{
+		double squared_error = 0.0;
+		for ( size_t i = 0; i < reference.size(); i += 4 )
+			for ( uint32_t c = 0; c < num_channels; ++c )
+				squared_error += double( reference[i + c] - decoded[i + c] ) * double( reference[i + c] - decoded[i + c] );
+		const double mse = squared_error / double( reference.size() / 4 * num_channels );
+		return 10.0 * std::log10( 1.0 / std::max( mse, 1e-12 ) );
+	}
+
+	// HDR values are compared after a Reinhard tonemap, so the error is relative to the brightness
+	std::vector<float> Tonemap( std::vector<float> texels )
+	{
+		for ( float& value : texels )
+			value = value / ( 1.0f + value );
+		return texels;
+	}
+
+	std::vector<float> EncodeAndDecode( TextureEncoding encoding, const TextureImage& image, ITaskScheduler& scheduler )
+	{
+		std::vector<uint8_t> encoded( GetEncodedSize( encoding, image.width, image.height ) );
+		EncodeTexture( encoding, image.texels.data(), image.width, image.height, encoded.data(), scheduler );
+
+		std::vector<float> decoded( image.texels.size() );
+		BOOST_TEST_REQUIRE( DecodeTexture( encoding, encoded.data(), image.width, image.height, decoded.data() ) );
+		return decoded;
+	}
+
+	double Luminance( const TextureImage& image, uint32_t x, uint32_t y )
+	{
+		const float* texel = &image.texels[( size_t( y ) * image.width + x ) * 4];
+		return ( texel[0] + texel[1] + texel[2] ) / 3.0;
+	}
+}
+
+BOOST_AUTO_TEST_SUITE( texture_compression )
+
+BOOST_AUTO_TEST_CASE( encoded_sizes )
+{
+	BOOST_TEST( GetEncodedSize( TextureEncoding::BC1, 256, 256 ) == 256 * 256 / 2 );
+	BOOST_TEST( GetEncodedSize( TextureEncoding::BC4, 256, 256 ) == 256 * 256 / 2 );
+	BOOST_TEST( GetEncodedSize( TextureEncoding::BC5, 256, 256 ) == 256 * 256 );
+	BOOST_TEST( GetEncodedSize( TextureEncoding::BC6H, 256, 256 ) == 256 * 256 );
+	BOOST_TEST( GetEncodedSize( TextureEncoding::BC7, 256, 256 ) == 256 * 256 );
+	BOOST_TEST( GetEncodedSize( TextureEncoding::RGB9E5, 256, 256 ) == 256 * 256 * 4 );
+	BOOST_TEST( GetEncodedSize( TextureEncoding::RGBA8, 256, 256 ) == 256 * 256 * 4 );
+
+	// partial blocks take a whole block
+	BOOST_TEST( GetEncodedSize( TextureEncoding::BC7, 1, 1 ) == 16 );
+	BOOST_TEST( GetEncodedSize( TextureEncoding::BC1, 13, 7 ) == 4 * 2 * 8 );
+	BOOST_TEST( GetEncodedSize( TextureEncoding::RGBA8, 13, 7 ) == 13 * 7 * 4 );
+}
+
+BOOST_AUTO_TEST_CASE( rgb9e5 )
+{
+	// powers of two and small integers are exact
+	const float exact[] = { 0.0f, 1.0f, 0.5f, 2.0f, 3.0f, 100.0f, 1024.0f, 1.0f / 1024.0f };
+	for ( float value : exact )
+	{
+		float rgb[3];
+		UnpackRGB9E5( PackRGB9E5( value, value * 0.5f, 0.0f ), rgb );
+		BOOST_TEST( rgb[0] == value );
+		BOOST_TEST( rgb[1] == value * 0.5f );
+		BOOST_TEST( rgb[2] == 0.0f );
+	}
+
+	// the largest channel keeps 9 bits of mantissa, smaller ones share its exponent
+	std::mt19937 rng( 1 );
+	std::uniform_real_distribution<float> log_value( -10.0f, 15.0f );
+	for ( int i = 0; i < 10000; ++i )
+	{
+		const float value[3] = { std::exp2( log_value( rng ) ), std::exp2( log_value( rng ) ), std::exp2( log_value( rng ) ) };
+		const float max_value = std::max( { value[0], value[1], value[2] } );
+		float rgb[3];
+		UnpackRGB9E5( PackRGB9E5( value[0], value[1], value[2] ), rgb );
+		for ( int c = 0; c < 3; ++c )
+			BOOST_TEST_REQUIRE( std::abs( rgb[c] - value[c] ) <= max_value / 512.0f );
+	}
+
+	float rgb[3];
+	UnpackRGB9E5( PackRGB9E5( -1.0f, std::nanf( "" ), 1e10f ), rgb );
+	BOOST_TEST( rgb[0] == 0.0f );
+	BOOST_TEST( rgb[1] == 0.0f );
+	BOOST_TEST( rgb[2] == 65408.0f );
+}
+
+BOOST_AUTO_TEST_CASE( constant_blocks )
+{
+	// a block of one color must come back as close as the endpoint precision allows
+	std::mt19937 rng( 2 );
+	std::uniform_real_distribution<float> value( 0.0f, 1.0f );
+	for ( int i = 0; i < 200; ++i )
+	{
+		const float color[4] = { value( rng ), value( rng ), value( rng ), value( rng ) };
+		float texels[16 * 4];
+		for ( int t = 0; t < 16; ++t )
+			std::copy_n( color, 4, texels + t * 4 );
+
+		uint8_t block[16];
+		float decoded[16 * 4];
+
+		EncodeBC1Block( texels, block );
+		DecodeBC1Block( block, decoded );
+		for ( int c = 0; c < 3; ++c )
+			BOOST_TEST_REQUIRE( std::abs( decoded[c] - color[c] ) <= 1.5f / 255.0f );
+
+		EncodeBC4Block( texels, 0, block );
+		DecodeBC4Block( block, 0, decoded );
+		BOOST_TEST_REQUIRE( std::abs( decoded[0] - color[0] ) <= 0.5f / 255.0f );
+
+		EncodeBC7Block( texels, block );
+		BOOST_TEST_REQUIRE( DecodeBC7Block( block, decoded ) );
+		for ( int c = 0; c < 4; ++c )
+			BOOST_TEST_REQUIRE( std::abs( decoded[c] - color[c] ) <= 1.5f / 255.0f );
+
+		for ( int t = 0; t < 16; ++t )
+			for ( int c = 0; c < 3; ++c )
+				texels[t * 4 + c] = color[c] * 100.0f;
+		EncodeBC6HBlock( texels, block );
+		BOOST_TEST_REQUIRE( DecodeBC6HBlock( block, decoded ) );
+		for ( int c = 0; c < 3; ++c )
+			BOOST_TEST_REQUIRE( std::abs( decoded[c] - color[c] * 100.0f ) <= color[c] * 100.0f * 0.02f + 1e-3f );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( psnr )
+{
+	std::mt19937 rng( 3 );
+	ThreadPoolTaskScheduler scheduler( 4 );
+
+	const TextureImage color = MakeColorImage( 256, 256, rng );
+	const TextureImage normals = MakeNormalMap( 256, 256, rng );
+	const TextureImage hdr = MakeHDRImage( 256, 128, rng );
+
+	const double bc1 = PSNR( color.texels, EncodeAndDecode( TextureEncoding::BC1, color, scheduler ), 3 );
+	const double bc7 = PSNR( color.texels, EncodeAndDecode( TextureEncoding::BC7, color, scheduler ), 4 );
+	const double bc4 = PSNR( color.texels, EncodeAndDecode( TextureEncoding::BC4, color, scheduler ), 1 );
+	const double bc5 = PSNR( normals.texels, EncodeAndDecode( TextureEncoding::BC5, normals, scheduler ), 2 );
+	const double rgba8 = PSNR( color.texels, EncodeAndDecode( TextureEncoding::RGBA8, color, scheduler ), 4 );
+	const double bc6h = PSNR( Tonemap( hdr.texels ), Tonemap( EncodeAndDecode( TextureEncoding::BC6H, hdr, scheduler ) ), 3 );
+	const double rgb9e5 = PSNR( Tonemap( hdr.texels ), Tonemap( EncodeAndDecode( TextureEncoding::RGB9E5, hdr, scheduler ) ), 3 );
+	BOOST_TEST_MESSAGE( "PSNR dB: BC1 " << bc1 << ", BC7 " << bc7 << ", BC4 " << bc4 << ", BC5 " << bc5 << ", RGBA8 " << rgba8
+						<< ", BC6H " << bc6h << ", RGB9E5 " << rgb9e5 );
+
+	BOOST_TEST( bc1 > 36.0 );
+	BOOST_TEST( bc7 > 38.0 );
+	BOOST_TEST( bc4 > 45.0 );
+	BOOST_TEST( bc5 > 45.0 );
+	BOOST_TEST( rgba8 > 55.0 );
+	BOOST_TEST( bc6h > 45.0 );
+	BOOST_TEST( rgb9e5 > 60.0 );
+}
+
+BOOST_AUTO_TEST_CASE( partial_blocks )
+{
+	std::mt19937 rng( 4 );
+	SerialTaskScheduler scheduler;
+
+	// a smooth image keeps its quality when the edge blocks are padded
+	const TextureImage color = MakeColorImage( 64, 64, rng );
+	TextureImage cropped;
+	cropped.width = 13;
+	cropped.height = 7;
+	for ( uint32_t y = 0; y < cropped.height; ++y )
+		cropped.texels.insert( cropped.texels.end(), color.texels.begin() + y * 64 * 4, color.texels.begin() + ( y * 64 + cropped.width ) * 4 );
+
+	for ( TextureEncoding encoding : { TextureEncoding::BC1, TextureEncoding::BC4, TextureEncoding::BC5, TextureEncoding::BC7 } )
+		BOOST_TEST( PSNR( cropped.texels, EncodeAndDecode( encoding, cropped, scheduler ), 1 ) > 30.0 );
+}
+
+BOOST_AUTO_TEST_CASE( threads_match_serial )
+{
+	std::mt19937 rng( 5 );
+	const TextureImage color = MakeColorImage( 128, 96, rng );
+
+	SerialTaskScheduler serial;
+	ThreadPoolTaskScheduler threaded( 4 );
+	for ( uint32_t i = 0; i < uint32_t( TextureEncoding::Count ); ++i )
+	{
+		const TextureEncoding encoding = TextureEncoding( i );
+		std::vector<uint8_t> serial_result( GetEncodedSize( encoding, color.width, color.height ) );
+		std::vector<uint8_t> threaded_result( serial_result.size() );
+		EncodeTexture( encoding, color.texels.data(), color.width, color.height, serial_result.data(), serial );
+		EncodeTexture( encoding, color.texels.data(), color.width, color.height, threaded_result.data(), threaded );
+		BOOST_TEST( serial_result == threaded_result );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( unsupported_modes )
+{
+	// BC7 mode 0 and BC6H mode 0 blocks
+	uint8_t bc7_block[16] = { 0x01 };
+	uint8_t bc6h_block[16] = {};
+	float texels[16 * 4];
+	BOOST_TEST( !DecodeBC7Block( bc7_block, texels ) );
+	BOOST_TEST( !DecodeBC6HBlock( bc6h_block, texels ) );
+	BOOST_TEST( texels[0] == 1.0f );
+	BOOST_TEST( texels[1] == 0.0f );
+}
+
+BOOST_AUTO_TEST_CASE( mip_chain )
+{
+	SerialTaskScheduler scheduler;
+
+	BOOST_TEST( GetNumMips( 1, 1 ) == 1 );
+	BOOST_TEST( GetNumMips( 256, 256 ) == 9 );
+	BOOST_TEST( GetNumMips( 37, 10 ) == 6 );
+
+	// odd sizes round down, a constant image stays constant with both filters
+	for ( MipFilter filter : { MipFilter::Box, MipFilter::Kaiser } )
+	{
+		std::vector<TextureImage> mips( 1 );
+		mips[0].width = 37;
+		mips[0].height = 10;
+		mips[0].texels.assign( 37 * 10 * 4, 0.25f );
+
+		MipSettings settings;
+		settings.filter = filter;
+		settings.content = MipContent::Linear;
+		GenerateMips( mips, settings, scheduler );
+
+		const uint32_t expected[][2] = { { 37, 10 }, { 18, 5 }, { 9, 2 }, { 4, 1 }, { 2, 1 }, { 1, 1 } };
+		BOOST_TEST_REQUIRE( mips.size() == std::size( expected ) );
+		for ( size_t level = 0; level < mips.size(); ++level )
+		{
+			BOOST_TEST( mips[level].width == expected[level][0] );
+			BOOST_TEST( mips[level].height == expected[level][1] );
+			BOOST_TEST_REQUIRE( mips[level].texels.size() == size_t( expected[level][0] ) * expected[level][1] * 4 );
+			for ( float value : mips[level].texels )
+				BOOST_TEST_REQUIRE( std::abs( value - 0.25f ) < 1e-5f );
+		}
+
+		settings.max_mips = 3;
+		GenerateMips( mips, settings, scheduler );
+		BOOST_TEST( mips.size() == 3 );
+	}
+}
+
+BOOST_AUTO_TEST_CASE( mip_gamma )
+{
+	SerialTaskScheduler scheduler;
+
+	// black and white checkerboard averages to half the light, which is not 0.5 in sRGB
+	std::vector<TextureImage> mips( 1 );
+	mips[0].width = 16;
+	mips[0].height = 16;
+	for ( uint32_t y = 0; y < 16; ++y )
+		for ( uint32_t x = 0; x < 16; ++x )
+			mips[0].texels.insert( mips[0].texels.end(), 4, ( x + y ) % 2 == 0 ? 1.0f : 0.0f );
+
+	MipSettings settings;
+	settings.filter = MipFilter::Box;
+	settings.content = MipContent::SRGB;
+	GenerateMips( mips, settings, scheduler );
+	BOOST_TEST( std::abs( mips[1].texels[0] - LinearToSRGB( 0.5f ) ) < 1e-4f );
+	BOOST_TEST( std::abs( mips[1].texels[3] - 0.5f ) < 1e-4f ); // alpha is linear
+
+	settings.content = MipContent::Linear;
+	GenerateMips( mips, settings, scheduler );
+	BOOST_TEST( std::abs( mips[1].texels[0] - 0.5f ) < 1e-4f );
+
+	BOOST_TEST( std::abs( SRGBToLinear( LinearToSRGB( 0.2f ) ) - 0.2f ) < 1e-5f );
+}
+
+BOOST_AUTO_TEST_CASE( mip_normal_map )
+{
+	std::mt19937 rng( 6 );
+	SerialTaskScheduler scheduler;
+
+	std::vector<TextureImage> mips = { MakeNormalMap( 64, 64, rng ) };
+	MipSettings settings;
+	settings.content = MipContent::NormalMap;
+	GenerateMips( mips, settings, scheduler );
+
+	for ( size_t level = 1; level < mips.size(); ++level )
+	{
+		for ( size_t i = 0; i < mips[level].texels.size(); i += 4 )
+		{
+			const float* texel = &mips[level].texels[i];
+			const float n[3] = { texel[0] * 2.0f - 1.0f, texel[1] * 2.0f - 1.0f, texel[2] * 2.0f - 1.0f };
+			BOOST_TEST_REQUIRE( std::abs( std::sqrt( n[0] * n[0] + n[1] * n[1] + n[2] * n[2] ) - 1.0f ) < 1e-4f );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( mip_aliasing )
+{
+	SerialTaskScheduler scheduler;
+
+	// stripes with a period of 2.5 texels are above the Nyquist limit of the next level and should mostly vanish from it.
+	// The box filter lets a lot more of them through as a moire pattern
+	std::vector<TextureImage> source( 1 );
+	source[0].width = 200;
+	source[0].height = 4;
+	for ( uint32_t y = 0; y < 4; ++y )
+		for ( uint32_t x = 0; x < 200; ++x )
+			source[0].texels.insert( source[0].texels.end(), 4, 0.5f + 0.5f * std::sin( 2.0f * Pi * float( x ) / 2.5f ) );
+
+	double amplitude[2] = {};
+	for ( MipFilter filter : { MipFilter::Box, MipFilter::Kaiser } )
+	{
+		std::vector<TextureImage> mips = source;
+		MipSettings settings;
+		settings.filter = filter;
+		settings.content = MipContent::Linear;
+		settings.wrap = true;
+		settings.max_mips = 2;
+		GenerateMips( mips, settings, scheduler );
+
+		double max_deviation = 0.0;
+		for ( uint32_t x = 0; x < mips[1].width; ++x )
+			max_deviation = std::max( max_deviation, std::abs( Luminance( mips[1], x, 0 ) - 0.5 ) );
+		amplitude[size_t( filter )] = max_deviation;
+	}
+	BOOST_TEST_MESSAGE( "Aliased amplitude: box " << amplitude[0] << ", kaiser " << amplitude[1] );
+	BOOST_TEST( amplitude[1] < amplitude[0] * 0.5 );
+}
+
+// Run explicitly with --run_test=texture_compression/benchmark_texture_compression --log_level=message
+BOOST_AUTO_TEST_CASE( benchmark_texture_compression, * boost::unit_test::disabled() )
+{
+	std::mt19937 rng( 7 );
+	const TextureImage color = MakeColorImage( 2048, 2048, rng );
+	const TextureImage hdr = MakeHDRImage( 2048, 2048, rng );
+	const double megapixels = double( color.width ) * color.height / 1e6;
+
+	const uint32_t max_threads = std::max( std::thread::hardware_concurrency(), 1u );
+	std::vector<uint32_t> thread_counts = { 1 };
+	for ( uint32_t threads = 2; threads < max_threads; threads *= 2 )
+		thread_counts.push_back( threads );
+	if ( max_threads > 1 )
+		thread_counts.push_back( max_threads );
+
+	for ( uint32_t i = 0; i < uint32_t( TextureEncoding::Count ); ++i )
+	{
+		const TextureEncoding encoding = TextureEncoding( i );
+		const TextureImage& image = encoding == TextureEncoding::BC6H || encoding == TextureEncoding::RGB9E5 ? hdr : color;
+		std::vector<uint8_t> encoded( GetEncodedSize( encoding, image.width, image.height ) );
+
+		const char* names[] = { "RGBA8", "BC1", "BC4", "BC5", "BC6H", "BC7", "RGB9E5" };
+		static_assert( std::size( names ) == size_t( TextureEncoding::Count ) );
+		for ( uint32_t threads : thread_counts )
+		{
+			ThreadPoolTaskScheduler scheduler( threads );
+			const auto start = std::chrono::steady_clock::now();
+			EncodeTexture( encoding, image.texels.data(), image.width, image.height, encoded.data(), scheduler );
+			const double ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+			BOOST_TEST_MESSAGE( names[i] << ", " << threads << " threads: " << ms << " ms (" << megapixels / ms * 1000.0 << " MP/s)" );
+		}
+	}
+
+	for ( MipFilter filter : { MipFilter::Box, MipFilter::Kaiser } )
+	{
+		for ( uint32_t threads : thread_counts )
+		{
+			ThreadPoolTaskScheduler scheduler( threads );
+			std::vector<TextureImage> mips = { color };
+			MipSettings settings;
+			settings.filter = filter;
+			const auto start = std::chrono::steady_clock::now();
+			GenerateMips( mips, settings, scheduler );
+			const double ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+			BOOST_TEST_MESSAGE( ( filter == MipFilter::Box ? "Box" : "Kaiser" ) << " sRGB mips, " << threads << " threads: " << ms << " ms ("
+								<< megapixels / ms * 1000.0 << " MP/s)" );
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
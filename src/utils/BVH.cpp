@@ -0,0 +1,1274 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "BVH.h"
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    // traversal stacks hold at most one entry per tree level
+    constexpr uint32_t MaxBuildDepth = 60;
+    constexpr uint32_t TraversalStackSize = MaxBuildDepth + 4;
+    constexpr uint32_t MaxBins = 32;
+    constexpr uint32_t TrianglesPerQuad = 4;
+
+    // bounds are kept in SSE registers during the build, w lanes are unused. Centroids are doubled, only their relative positions matter
+    struct BuildBounds
+    {
+        __m128 min;
+        __m128 max;
+
+        static BuildBounds Empty() { return BuildBounds{ _mm_set1_ps( FLT_MAX ), _mm_set1_ps( -FLT_MAX ) }; }
+        static BuildBounds FromBounds( const BVHBounds& bounds )
+        {
+            return BuildBounds{ _mm_setr_ps( bounds.min[0], bounds.min[1], bounds.min[2], 0.0f ), _mm_setr_ps( bounds.max[0], bounds.max[1], bounds.max[2], 0.0f ) };
+        }
+
+        void Extend( __m128 p ) { min = _mm_min_ps( min, p ); max = _mm_max_ps( max, p ); }
+        void Extend( __m128 other_min, __m128 other_max ) { min = _mm_min_ps( min, other_min ); max = _mm_max_ps( max, other_max ); }
+        void Extend( const BuildBounds& other ) { Extend( other.min, other.max ); }
+
+        float HalfArea() const
+        {
+            alignas( 16 ) float extent[4];
+            _mm_store_ps( extent, _mm_sub_ps( max, min ) );
+            if ( extent[0] < 0.0f )
+                return 0.0f;
+            return extent[0] * extent[1] + extent[1] * extent[2] + extent[2] * extent[0];
+        }
+
+        void Store( BVHNode& node ) const
+        {
+            alignas( 16 ) float values[2][4];
+            _mm_store_ps( values[0], min );
+            _mm_store_ps( values[1], max );
+            for ( int axis = 0; axis < 3; ++axis )
+            {
+                node.min[axis] = values[0][axis];
+                node.max[axis] = values[1][axis];
+            }
+        }
+    };
+
+    struct BuildPrimitive
+    {
+        __m128 min;
+        __m128 max;
+        uint32_t id;
+
+        __m128 Centroid() const { return _mm_add_ps( min, max ); }
+    };
+
+    struct BuildBin
+    {
+        BuildBounds bounds;
+        BuildBounds centroid_bounds;
+        uint32_t count;
+    };
+
+    struct BuildTask
+    {
+        uint32_t node;
+        uint32_t first;
+        uint32_t count;
+        uint32_t depth;
+        BuildBounds bounds;
+        BuildBounds centroid_bounds;
+    };
+
+    float LeafCost( uint32_t count, uint32_t group_size, const BVHBuildSettings& settings )
+    {
+        // primitives are tested group_size at a time, a partially filled group costs as much as a full one
+        return float( ( count + group_size - 1 ) / group_size ) * settings.intersection_cost;
+    }
+
+    float NodeHalfArea( const BVHNode& node )
+    {
+        const float dx = node.max[0] - node.min[0];
+        const float dy = node.max[1] - node.min[1];
+        const float dz = node.max[2] - node.min[2];
+        return dx * dy + dy * dz + dz * dx;
+    }
+
+    void SetNodeBounds( BVHNode& node, const BVHBounds& bounds )
+    {
+        for ( int axis = 0; axis < 3; ++axis )
+        {
+            node.min[axis] = bounds.min[axis];
+            node.max[axis] = bounds.max[axis];
+        }
+    }
+
+    // Binned SAH build, all three axes are binned in a single pass. Children of a node are allocated next to each other after their parent.
+    // Primitives are partitioned in place, leaves reference ranges of the reordered array
+    void BuildHierarchy( std::vector<BuildPrimitive>& prims, uint32_t group_size, const BVHBuildSettings& settings, std::vector<BVHNode>& nodes )
+    {
+        nodes.clear();
+        if ( prims.empty() )
+            return;
+
+        const uint32_t num_bins = std::clamp<uint32_t>( settings.num_bins, 2, MaxBins );
+        const uint32_t max_leaf_size = std::max<uint32_t>( settings.max_leaf_size, 1 );
+        const __m128 max_bin = _mm_set1_ps( float( num_bins - 1 ) );
+
+        nodes.reserve( 2 * prims.size() - 1 );
+        nodes.emplace_back();
+
+        // bounds of children come from the bins of their parent, only the root needs a pass over the primitives
+        BuildTask root = { 0, 0, uint32_t( prims.size() ), 0, BuildBounds::Empty(), BuildBounds::Empty() };
+        for ( const BuildPrimitive& prim : prims )
+        {
+            root.bounds.Extend( prim.min, prim.max );
+            root.centroid_bounds.Extend( prim.Centroid() );
+        }
+
+        std::vector<BuildTask> tasks;
+        tasks.emplace_back( root );
+
+        BuildBin bins[3][MaxBins];
+        BuildBounds right_bounds[MaxBins];
+        BuildBounds right_centroid_bounds[MaxBins];
+        uint32_t right_counts[MaxBins];
+
+        while ( !tasks.empty() )
+        {
+            const BuildTask task = tasks.back();
+            tasks.pop_back();
+
+            task.bounds.Store( nodes[task.node] );
+
+            const bool can_split = task.count > 1 && task.depth < MaxBuildDepth;
+
+            const __m128 centroid_min = task.centroid_bounds.min;
+            const __m128 centroid_extent = _mm_sub_ps( task.centroid_bounds.max, centroid_min );
+            const __m128 scale = _mm_and_ps( _mm_cmpgt_ps( centroid_extent, _mm_setzero_ps() ), _mm_div_ps( _mm_set1_ps( float( num_bins ) ), centroid_extent ) );
+            alignas( 16 ) float scales[4];
+            _mm_store_ps( scales, scale );
+
+            auto calc_bins = [&]( const BuildPrimitive& prim, int32_t* bin_indices )
+            {
+                const __m128 bin = _mm_min_ps( _mm_mul_ps( _mm_sub_ps( prim.Centroid(), centroid_min ), scale ), max_bin );
+                _mm_store_si128( reinterpret_cast<__m128i*>( bin_indices ), _mm_cvttps_epi32( bin ) );
+            };
+
+            for ( int axis = 0; can_split && axis < 3; ++axis )
+            {
+                for ( uint32_t bin = 0; bin < num_bins; ++bin )
+                    bins[axis][bin] = BuildBin{ BuildBounds::Empty(), BuildBounds::Empty(), 0 };
+            }
+
+            for ( uint32_t i = task.first; can_split && i < task.first + task.count; ++i )
+            {
+                const BuildPrimitive& prim = prims[i];
+                alignas( 16 ) int32_t bin_indices[4];
+                calc_bins( prim, bin_indices );
+                for ( int axis = 0; axis < 3; ++axis )
+                {
+                    BuildBin& bin = bins[axis][bin_indices[axis]];
+                    bin.bounds.Extend( prim.min, prim.max );
+                    bin.centroid_bounds.Extend( prim.Centroid() );
+                    bin.count++;
+                }
+            }
+
+            const float leaf_cost = LeafCost( task.count, group_size, settings );
+            const float parent_area = std::max( task.bounds.HalfArea(), FLT_MIN );
+
+            int best_axis = -1;
+            uint32_t best_split = 0;
+            float best_cost = FLT_MAX;
+            BuildBounds best_bounds[2];
+            BuildBounds best_centroid_bounds[2];
+
+            for ( int axis = 0; can_split && axis < 3; ++axis )
+            {
+                if ( scales[axis] == 0.0f )
+                    continue;
+
+                // right side of every split plane, swept from the last bin
+                BuildBounds accumulated = BuildBounds::Empty();
+                BuildBounds accumulated_centroids = BuildBounds::Empty();
+                uint32_t accumulated_count = 0;
+                for ( uint32_t bin = num_bins - 1; bin > 0; --bin )
+                {
+                    accumulated.Extend( bins[axis][bin].bounds );
+                    accumulated_centroids.Extend( bins[axis][bin].centroid_bounds );
+                    accumulated_count += bins[axis][bin].count;
+                    right_bounds[bin] = accumulated;
+                    right_centroid_bounds[bin] = accumulated_centroids;
+                    right_counts[bin] = accumulated_count;
+                }
+
+                accumulated = BuildBounds::Empty();
+                accumulated_centroids = BuildBounds::Empty();
+                accumulated_count = 0;
+                for ( uint32_t split = 1; split < num_bins; ++split )
+                {
+                    accumulated.Extend( bins[axis][split - 1].bounds );
+                    accumulated_centroids.Extend( bins[axis][split - 1].centroid_bounds );
+                    accumulated_count += bins[axis][split - 1].count;
+                    if ( accumulated_count == 0 || right_counts[split] == 0 )
+                        continue;
+
+                    const float cost = settings.traversal_cost
+                        + ( accumulated.HalfArea() * LeafCost( accumulated_count, group_size, settings )
+                            + right_bounds[split].HalfArea() * LeafCost( right_counts[split], group_size, settings ) ) / parent_area;
+                    if ( cost < best_cost )
+                    {
+                        best_cost = cost;
+                        best_axis = axis;
+                        best_split = split;
+                        best_bounds[0] = accumulated;
+                        best_bounds[1] = right_bounds[split];
+                        best_centroid_bounds[0] = accumulated_centroids;
+                        best_centroid_bounds[1] = right_centroid_bounds[split];
+                    }
+                }
+            }
+
+            bool make_leaf = !can_split;
+            if ( !make_leaf && best_axis >= 0 )
+                make_leaf = best_cost >= leaf_cost && task.count <= max_leaf_size;
+            else if ( !make_leaf )
+                make_leaf = task.count <= max_leaf_size; // all centroids are in the same spot, nothing to gain from splitting small ranges
+
+            if ( make_leaf )
+            {
+                nodes[task.node].first = task.first;
+                nodes[task.node].count = task.count;
+                continue;
+            }
+
+            uint32_t mid = task.first + task.count / 2;
+            if ( best_axis >= 0 )
+            {
+                const auto range_begin = prims.begin() + task.first;
+                const auto mid_it = std::partition( range_begin, range_begin + task.count, [&]( const BuildPrimitive& prim )
+                {
+                    alignas( 16 ) int32_t bin_indices[4];
+                    calc_bins( prim, bin_indices );
+                    return uint32_t( bin_indices[best_axis] ) < best_split;
+                } );
+                mid = uint32_t( mid_it - prims.begin() );
+            }
+            else
+            {
+                // arbitrary halves of coincident primitives
+                for ( int side = 0; side < 2; ++side )
+                {
+                    best_bounds[side] = BuildBounds::Empty();
+                    best_centroid_bounds[side] = task.centroid_bounds;
+                }
+                for ( uint32_t i = task.first; i < task.first + task.count; ++i )
+                    best_bounds[i < mid ? 0 : 1].Extend( prims[i].min, prims[i].max );
+            }
+
+            const uint32_t left = uint32_t( nodes.size() );
+            nodes.emplace_back();
+            nodes.emplace_back();
+            nodes[task.node].first = left;
+            nodes[task.node].count = 0;
+
+            // left is processed first, so that subtrees are laid out depth first
+            tasks.emplace_back( BuildTask{ left + 1, mid, task.first + task.count - mid, task.depth + 1, best_bounds[1], best_centroid_bounds[1] } );
+            tasks.emplace_back( BuildTask{ left, task.first, mid - task.first, task.depth + 1, best_bounds[0], best_centroid_bounds[0] } );
+        }
+    }
+
+
+    float CalcTreeSAHCost( const std::vector<BVHNode>& nodes, uint32_t group_size, const BVHBuildSettings& settings )
+    {
+        if ( nodes.empty() )
+            return 0.0f;
+
+        const float root_area = NodeHalfArea( nodes[0] );
+        if ( root_area <= 0.0f )
+            return 0.0f;
+
+        float cost = 0.0f;
+        for ( const BVHNode& node : nodes )
+        {
+            const float node_cost = node.IsLeaf() ? LeafCost( node.count, group_size, settings ) : settings.traversal_cost;
+            cost += node_cost * NodeHalfArea( node ) / root_area;
+        }
+        return cost;
+    }
+
+    float SafeInverse( float d )
+    {
+        constexpr float min_abs = 1.e-20f;
+        if ( std::abs( d ) < min_abs )
+            d = std::copysign( min_abs, d );
+        return 1.0f / d;
+    }
+
+    __m128 SafeInverse( __m128 d )
+    {
+        const __m128 sign_mask = _mm_set1_ps( -0.0f );
+        const __m128 min_abs = _mm_set1_ps( 1.e-20f );
+        const __m128 is_small = _mm_cmplt_ps( _mm_andnot_ps( sign_mask, d ), min_abs );
+        const __m128 replacement = _mm_or_ps( _mm_and_ps( d, sign_mask ), min_abs );
+        d = _mm_or_ps( _mm_and_ps( is_small, replacement ), _mm_andnot_ps( is_small, d ) );
+        return _mm_div_ps( _mm_set1_ps( 1.0f ), d );
+    }
+
+    __m128 Select( __m128 mask, __m128 if_true, __m128 if_false )
+    {
+        return _mm_or_ps( _mm_and_ps( mask, if_true ), _mm_andnot_ps( mask, if_false ) );
+    }
+
+    struct Vec3x4
+    {
+        __m128 x;
+        __m128 y;
+        __m128 z;
+    };
+
+    Vec3x4 Sub( const Vec3x4& a, const Vec3x4& b )
+    {
+        return Vec3x4{ _mm_sub_ps( a.x, b.x ), _mm_sub_ps( a.y, b.y ), _mm_sub_ps( a.z, b.z ) };
+    }
+
+    Vec3x4 Cross( const Vec3x4& a, const Vec3x4& b )
+    {
+        return Vec3x4{
+            _mm_sub_ps( _mm_mul_ps( a.y, b.z ), _mm_mul_ps( a.z, b.y ) ),
+            _mm_sub_ps( _mm_mul_ps( a.z, b.x ), _mm_mul_ps( a.x, b.z ) ),
+            _mm_sub_ps( _mm_mul_ps( a.x, b.y ), _mm_mul_ps( a.y, b.x ) ) };
+    }
+
+    __m128 Dot( const Vec3x4& a, const Vec3x4& b )
+    {
+        return _mm_add_ps( _mm_add_ps( _mm_mul_ps( a.x, b.x ), _mm_mul_ps( a.y, b.y ) ), _mm_mul_ps( a.z, b.z ) );
+    }
+
+    Vec3x4 Broadcast( const float v[3] )
+    {
+        return Vec3x4{ _mm_set1_ps( v[0] ), _mm_set1_ps( v[1] ), _mm_set1_ps( v[2] ) };
+    }
+
+    Vec3x4 Load( const float v[3][4] )
+    {
+        return Vec3x4{ _mm_load_ps( v[0] ), _mm_load_ps( v[1] ), _mm_load_ps( v[2] ) };
+    }
+
+    Vec3x4 BroadcastLane( const float v[3][4], int lane )
+    {
+        return Vec3x4{ _mm_set1_ps( v[0][lane] ), _mm_set1_ps( v[1][lane] ), _mm_set1_ps( v[2][lane] ) };
+    }
+
+    // Moller-Trumbore for 4 independent ray/triangle pairs. Two-sided.
+    // Degenerate triangles and zero padding produce NaNs or infinities that fail the range checks. Returns the mask of lanes with t_min <= t < t_max
+    __m128 IntersectTriangles4( const Vec3x4& origin, const Vec3x4& dir, const Vec3x4& v0, const Vec3x4& e1, const Vec3x4& e2,
+                                __m128 t_min, __m128 t_max, __m128& t, __m128& u, __m128& v )
+    {
+        const Vec3x4 p = Cross( dir, e2 );
+        const __m128 inv_det = _mm_div_ps( _mm_set1_ps( 1.0f ), Dot( e1, p ) );
+        const Vec3x4 to_origin = Sub( origin, v0 );
+        u = _mm_mul_ps( Dot( to_origin, p ), inv_det );
+        const Vec3x4 q = Cross( to_origin, e1 );
+        v = _mm_mul_ps( Dot( dir, q ), inv_det );
+        t = _mm_mul_ps( Dot( e2, q ), inv_det );
+
+        const __m128 zero = _mm_setzero_ps();
+        __m128 mask = _mm_and_ps( _mm_cmpge_ps( u, zero ), _mm_cmpge_ps( v, zero ) );
+        mask = _mm_and_ps( mask, _mm_cmple_ps( _mm_add_ps( u, v ), _mm_set1_ps( 1.0f ) ) );
+        mask = _mm_and_ps( mask, _mm_cmpge_ps( t, t_min ) );
+        mask = _mm_and_ps( mask, _mm_cmplt_ps( t, t_max ) );
+        return mask;
+    }
+
+    struct SingleRay
+    {
+        __m128 origin;
+        __m128 inv_dir;
+        float t_min;
+    };
+
+    SingleRay MakeSingleRay( const BVHRay& ray )
+    {
+        SingleRay res;
+        res.origin = _mm_setr_ps( ray.origin[0], ray.origin[1], ray.origin[2], 0.0f );
+        res.inv_dir = _mm_setr_ps( SafeInverse( ray.direction[0] ), SafeInverse( ray.direction[1] ), SafeInverse( ray.direction[2] ), 0.0f );
+        res.t_min = ray.t_min;
+        return res;
+    }
+
+    // Slab test. Returns the entry distance or FLT_MAX on a miss
+    float IntersectNode( const BVHNode& node, const SingleRay& ray, float t_max )
+    {
+        // w lanes hold node indices, masked out to avoid denormal arithmetic on them
+        const __m128 xyz_mask = _mm_castsi128_ps( _mm_setr_epi32( -1, -1, -1, 0 ) );
+        const __m128 t0 = _mm_mul_ps( _mm_sub_ps( _mm_and_ps( _mm_load_ps( node.min ), xyz_mask ), ray.origin ), ray.inv_dir );
+        const __m128 t1 = _mm_mul_ps( _mm_sub_ps( _mm_and_ps( _mm_load_ps( node.max ), xyz_mask ), ray.origin ), ray.inv_dir );
+        const __m128 t_near = _mm_min_ps( t0, t1 );
+        const __m128 t_far = _mm_max_ps( t0, t1 );
+
+        const __m128 near = _mm_max_ss(
+            _mm_max_ss( t_near, _mm_shuffle_ps( t_near, t_near, _MM_SHUFFLE( 1, 1, 1, 1 ) ) ),
+            _mm_max_ss( _mm_shuffle_ps( t_near, t_near, _MM_SHUFFLE( 2, 2, 2, 2 ) ), _mm_set_ss( ray.t_min ) ) );
+        const __m128 far = _mm_min_ss(
+            _mm_min_ss( t_far, _mm_shuffle_ps( t_far, t_far, _MM_SHUFFLE( 1, 1, 1, 1 ) ) ),
+            _mm_min_ss( _mm_shuffle_ps( t_far, t_far, _MM_SHUFFLE( 2, 2, 2, 2 ) ), _mm_set_ss( t_max ) ) );
+
+        const float near_dist = _mm_cvtss_f32( near );
+        return near_dist <= _mm_cvtss_f32( far ) ? near_dist : FLT_MAX;
+    }
+
+    // Front to back traversal of a single ray. visit_leaf( leaf, t_max ) may shorten t_max and returns true to stop the traversal
+    template<typename LeafFunc>
+    void TraverseSingle( const std::vector<BVHNode>& nodes, const SingleRay& ray, float& t_max, LeafFunc&& visit_leaf )
+    {
+        if ( nodes.empty() || IntersectNode( nodes[0], ray, t_max ) == FLT_MAX )
+            return;
+
+        struct StackEntry
+        {
+            uint32_t node;
+            float t_near;
+        };
+        StackEntry stack[TraversalStackSize];
+        uint32_t stack_size = 0;
+
+        uint32_t node_idx = 0;
+        while ( true )
+        {
+            const BVHNode& node = nodes[node_idx];
+            if ( node.IsLeaf() )
+            {
+                if ( visit_leaf( node, t_max ) )
+                    return;
+            }
+            else
+            {
+                uint32_t near_idx = node.first;
+                uint32_t far_idx = node.first + 1;
+                float near_dist = IntersectNode( nodes[near_idx], ray, t_max );
+                float far_dist = IntersectNode( nodes[far_idx], ray, t_max );
+                if ( far_dist < near_dist )
+                {
+                    std::swap( near_idx, far_idx );
+                    std::swap( near_dist, far_dist );
+                }
+
+                if ( near_dist != FLT_MAX )
+                {
+                    if ( far_dist != FLT_MAX )
+                        stack[stack_size++] = StackEntry{ far_idx, far_dist };
+                    node_idx = near_idx;
+                    continue;
+                }
+            }
+
+            // skip nodes that are behind hits found since they were pushed
+            bool has_next = false;
+            while ( stack_size > 0 && !has_next )
+            {
+                const StackEntry& entry = stack[--stack_size];
+                if ( entry.t_near < t_max )
+                {
+                    node_idx = entry.node;
+                    has_next = true;
+                }
+            }
+            if ( !has_next )
+                return;
+        }
+    }
+
+    template<typename PacketT>
+    int IntersectNodePacket( const BVHNode& node, const PacketT& packet )
+    {
+        __m128 t_near = packet.t_min;
+        __m128 t_far = packet.t_max;
+
+        const __m128* origin = &packet.origin.x;
+        const __m128* inv_dir = &packet.inv_dir.x;
+        for ( int axis = 0; axis < 3; ++axis )
+        {
+            const __m128 t0 = _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( node.min[axis] ), origin[axis] ), inv_dir[axis] );
+            const __m128 t1 = _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( node.max[axis] ), origin[axis] ), inv_dir[axis] );
+            t_near = _mm_max_ps( t_near, _mm_min_ps( t0, t1 ) );
+            t_far = _mm_min_ps( t_far, _mm_max_ps( t0, t1 ) );
+        }
+        return _mm_movemask_ps( _mm_cmple_ps( t_near, t_far ) );
+    }
+
+    // Traversal of a packet of 4 rays. A node is visited if any active ray hits it.
+    // visit_leaf( leaf, node_mask ) returns the new active mask, the traversal stops when no lanes are left
+    template<typename PacketT, typename LeafFunc>
+    void TraversePacket( const std::vector<BVHNode>& nodes, const PacketT& packet, int active_mask, LeafFunc&& visit_leaf )
+    {
+        if ( nodes.empty() || active_mask == 0 )
+            return;
+
+        // children are ordered by the first ray direction, the rays of a packet are expected to be coherent
+        const float dir[3] = { _mm_cvtss_f32( packet.dir.x ), _mm_cvtss_f32( packet.dir.y ), _mm_cvtss_f32( packet.dir.z ) };
+
+        uint32_t stack[TraversalStackSize * 2];
+        uint32_t stack_size = 0;
+        stack[stack_size++] = 0;
+
+        while ( stack_size > 0 )
+        {
+            const BVHNode& node = nodes[stack[--stack_size]];
+            const int node_mask = IntersectNodePacket( node, packet ) & active_mask;
+            if ( node_mask == 0 )
+                continue;
+
+            if ( node.IsLeaf() )
+            {
+                active_mask = visit_leaf( node, node_mask );
+                if ( active_mask == 0 )
+                    return;
+                continue;
+            }
+
+            const BVHNode& left = nodes[node.first];
+            const BVHNode& right = nodes[node.first + 1];
+            float centers_delta = 0.0f;
+            for ( int axis = 0; axis < 3; ++axis )
+                centers_delta += ( left.min[axis] + left.max[axis] - right.min[axis] - right.max[axis] ) * dir[axis];
+
+            // the nearer child goes last, so it is popped first
+            if ( centers_delta > 0.0f )
+            {
+                stack[stack_size++] = node.first;
+                stack[stack_size++] = node.first + 1;
+            }
+            else
+            {
+                stack[stack_size++] = node.first + 1;
+                stack[stack_size++] = node.first;
+            }
+        }
+    }
+
+    uint32_t PacketSize( size_t num_rays, size_t first_ray )
+    {
+        return uint32_t( std::min<size_t>( num_rays - first_ray, 4 ) );
+    }
+
+    int LaneMask( uint32_t num_lanes )
+    {
+        return ( 1 << num_lanes ) - 1;
+    }
+}
+
+float BVHBounds::HalfArea() const
+{
+    if ( IsEmpty() )
+        return 0.0f;
+
+    const float dx = max[0] - min[0];
+    const float dy = max[1] - min[1];
+    const float dz = max[2] - min[2];
+    return dx * dy + dy * dz + dz * dx;
+}
+
+void BVHBounds::Extend( const float p[3] )
+{
+    for ( int axis = 0; axis < 3; ++axis )
+    {
+        min[axis] = std::min( min[axis], p[axis] );
+        max[axis] = std::max( max[axis], p[axis] );
+    }
+}
+
+void BVHBounds::Extend( const BVHBounds& other )
+{
+    for ( int axis = 0; axis < 3; ++axis )
+    {
+        min[axis] = std::min( min[axis], other.min[axis] );
+        max[axis] = std::max( max[axis], other.max[axis] );
+    }
+}
+
+BVHBounds BVHBounds::Transformed( const float ( &m )[3][4] ) const
+{
+    if ( IsEmpty() )
+        return BVHBounds();
+
+    // Arvo's method
+    BVHBounds res;
+    for ( int row = 0; row < 3; ++row )
+    {
+        res.min[row] = res.max[row] = m[row][3];
+        for ( int col = 0; col < 3; ++col )
+        {
+            const float a = m[row][col] * min[col];
+            const float b = m[row][col] * max[col];
+            res.min[row] += std::min( a, b );
+            res.max[row] += std::max( a, b );
+        }
+    }
+    return res;
+}
+
+// MeshBVH
+
+struct MeshBVH::RayPacket
+{
+    Vec3x4 origin;
+    Vec3x4 dir;
+    Vec3x4 inv_dir;
+    __m128 t_min;
+    __m128 t_max;
+
+    // lanes past num_rays replicate the first ray, they are expected to be masked out
+    void Load( const BVHRay* rays, uint32_t num_rays )
+    {
+        alignas( 16 ) float values[8][4];
+        for ( uint32_t lane = 0; lane < 4; ++lane )
+        {
+            const BVHRay& ray = rays[lane < num_rays ? lane : 0];
+            for ( int axis = 0; axis < 3; ++axis )
+            {
+                values[axis][lane] = ray.origin[axis];
+                values[3 + axis][lane] = ray.direction[axis];
+            }
+            values[6][lane] = ray.t_min;
+            values[7][lane] = ray.t_max;
+        }
+
+        origin = Vec3x4{ _mm_load_ps( values[0] ), _mm_load_ps( values[1] ), _mm_load_ps( values[2] ) };
+        dir = Vec3x4{ _mm_load_ps( values[3] ), _mm_load_ps( values[4] ), _mm_load_ps( values[5] ) };
+        inv_dir = Vec3x4{ SafeInverse( dir.x ), SafeInverse( dir.y ), SafeInverse( dir.z ) };
+        t_min = _mm_load_ps( values[6] );
+        t_max = _mm_load_ps( values[7] );
+    }
+
+    // rows of an affine 3x4 matrix
+    RayPacket Transform( const float m[3][4] ) const
+    {
+        RayPacket res;
+        __m128* res_origin = &res.origin.x;
+        __m128* res_dir = &res.dir.x;
+        for ( int row = 0; row < 3; ++row )
+        {
+            const __m128 m0 = _mm_set1_ps( m[row][0] );
+            const __m128 m1 = _mm_set1_ps( m[row][1] );
+            const __m128 m2 = _mm_set1_ps( m[row][2] );
+            res_dir[row] = _mm_add_ps( _mm_add_ps( _mm_mul_ps( m0, dir.x ), _mm_mul_ps( m1, dir.y ) ), _mm_mul_ps( m2, dir.z ) );
+            res_origin[row] = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( m0, origin.x ), _mm_mul_ps( m1, origin.y ) ), _mm_mul_ps( m2, origin.z ) ), _mm_set1_ps( m[row][3] ) );
+        }
+        res.inv_dir = Vec3x4{ SafeInverse( res.dir.x ), SafeInverse( res.dir.y ), SafeInverse( res.dir.z ) };
+        res.t_min = t_min;
+        res.t_max = t_max;
+        return res;
+    }
+};
+
+void MeshBVH::Build( const void* positions, uint32_t num_vertices, size_t position_stride,
+                     const uint32_t* indices, uint32_t num_indices, const BVHBuildSettings& settings )
+{
+    BuildImpl( positions, num_vertices, position_stride, indices, num_indices, settings );
+}
+
+void MeshBVH::Build( const void* positions, uint32_t num_vertices, size_t position_stride,
+                     const uint16_t* indices, uint32_t num_indices, const BVHBuildSettings& settings )
+{
+    BuildImpl( positions, num_vertices, position_stride, indices, num_indices, settings );
+}
+
+template<typename IndexT>
+void MeshBVH::BuildImpl( const void* positions, uint32_t num_vertices, size_t position_stride,
+                         const IndexT* indices, uint32_t num_indices, const BVHBuildSettings& settings )
+{
+    Clear();
+
+    const uint8_t* position_bytes = static_cast<const uint8_t*>( positions );
+    auto get_position = [&]( uint32_t index )
+    {
+        assert( index < num_vertices );
+        return reinterpret_cast<const float*>( position_bytes + index * position_stride );
+    };
+
+    m_num_triangles = num_indices / 3;
+
+    std::vector<BuildPrimitive> prims( m_num_triangles );
+    for ( uint32_t tri = 0; tri < m_num_triangles; ++tri )
+    {
+        BVHBounds bounds;
+        for ( uint32_t corner = 0; corner < 3; ++corner )
+            bounds.Extend( get_position( indices[tri * 3 + corner] ) );
+
+        const BuildBounds build_bounds = BuildBounds::FromBounds( bounds );
+        prims[tri] = BuildPrimitive{ build_bounds.min, build_bounds.max, tri };
+    }
+
+    BuildHierarchy( prims, TrianglesPerQuad, settings, m_nodes );
+
+    size_t total_quads = 0;
+    for ( const BVHNode& node : m_nodes )
+    {
+        if ( node.IsLeaf() )
+            total_quads += ( node.count + TrianglesPerQuad - 1 ) / TrianglesPerQuad;
+    }
+    m_quads.reserve( total_quads );
+
+    // leaves are converted to ranges of quads, triangles are stored in traversal order
+    for ( BVHNode& node : m_nodes )
+    {
+        if ( !node.IsLeaf() )
+            continue;
+
+        const uint32_t first_quad = uint32_t( m_quads.size() );
+        const uint32_t num_quads = ( node.count + TrianglesPerQuad - 1 ) / TrianglesPerQuad;
+        m_quads.resize( m_quads.size() + num_quads, TriangleQuad{} );
+
+        for ( uint32_t i = 0; i < num_quads * TrianglesPerQuad; ++i )
+        {
+            TriangleQuad& quad = m_quads[first_quad + i / TrianglesPerQuad];
+            const uint32_t lane = i % TrianglesPerQuad;
+            if ( i >= node.count )
+            {
+                quad.ids[lane] = BVHHit::Invalid;
+                continue;
+            }
+
+            const uint32_t tri = prims[node.first + i].id;
+            const float* v0 = get_position( indices[tri * 3] );
+            const float* v1 = get_position( indices[tri * 3 + 1] );
+            const float* v2 = get_position( indices[tri * 3 + 2] );
+            for ( int axis = 0; axis < 3; ++axis )
+            {
+                quad.v0[axis][lane] = v0[axis];
+                quad.e1[axis][lane] = v1[axis] - v0[axis];
+                quad.e2[axis][lane] = v2[axis] - v0[axis];
+            }
+            quad.ids[lane] = tri;
+        }
+
+        node.first = first_quad;
+        node.count = num_quads;
+    }
+}
+
+void MeshBVH::Clear()
+{
+    m_nodes.clear();
+    m_quads.clear();
+    m_num_triangles = 0;
+}
+
+BVHBounds MeshBVH::GetBounds() const
+{
+    BVHBounds bounds;
+    if ( !m_nodes.empty() )
+    {
+        bounds.Extend( m_nodes[0].min );
+        bounds.Extend( m_nodes[0].max );
+    }
+    return bounds;
+}
+
+size_t MeshBVH::GetMemoryUsage() const
+{
+    return m_nodes.capacity() * sizeof( BVHNode ) + m_quads.capacity() * sizeof( TriangleQuad );
+}
+
+namespace
+{
+    struct MeshBVHSerializedHeader
+    {
+        uint32_t version;
+        uint32_t num_nodes;
+        uint32_t num_quads;
+        uint32_t num_triangles;
+    };
+}
+
+size_t MeshBVH::GetSerializedSize() const
+{
+    return sizeof( MeshBVHSerializedHeader ) + m_nodes.size() * sizeof( BVHNode ) + m_quads.size() * sizeof( TriangleQuad );
+}
+
+void MeshBVH::Serialize( void* dst ) const
+{
+    MeshBVHSerializedHeader header;
+    header.version = SerializationVersion;
+    header.num_nodes = uint32_t( m_nodes.size() );
+    header.num_quads = uint32_t( m_quads.size() );
+    header.num_triangles = m_num_triangles;
+
+    uint8_t* dst_bytes = static_cast<uint8_t*>( dst );
+    memcpy( dst_bytes, &header, sizeof( header ) );
+    dst_bytes += sizeof( header );
+    if ( !m_nodes.empty() )
+        memcpy( dst_bytes, m_nodes.data(), m_nodes.size() * sizeof( BVHNode ) );
+    dst_bytes += m_nodes.size() * sizeof( BVHNode );
+    if ( !m_quads.empty() )
+        memcpy( dst_bytes, m_quads.data(), m_quads.size() * sizeof( TriangleQuad ) );
+}
+
+bool MeshBVH::Deserialize( const void* src, size_t size )
+{
+    Clear();
+
+    MeshBVHSerializedHeader header;
+    if ( size < sizeof( header ) )
+        return false;
+    memcpy( &header, src, sizeof( header ) );
+
+    if ( header.version != SerializationVersion )
+        return false;
+    if ( size != sizeof( header ) + size_t( header.num_nodes ) * sizeof( BVHNode ) + size_t( header.num_quads ) * sizeof( TriangleQuad ) )
+        return false;
+    if ( header.num_nodes == 0 )
+        return header.num_quads == 0 && header.num_triangles == 0;
+
+    const uint8_t* src_bytes = static_cast<const uint8_t*>( src ) + sizeof( header );
+    m_nodes.resize( header.num_nodes );
+    memcpy( m_nodes.data(), src_bytes, m_nodes.size() * sizeof( BVHNode ) );
+    src_bytes += m_nodes.size() * sizeof( BVHNode );
+    m_quads.resize( header.num_quads );
+    memcpy( m_quads.data(), src_bytes, m_quads.size() * sizeof( TriangleQuad ) );
+    m_num_triangles = header.num_triangles;
+
+    // children always follow their parent, so depths are final when a node is reached in order
+    std::vector<uint32_t> depths( m_nodes.size(), 0 );
+    bool valid = true;
+    for ( uint32_t node_idx = 0; node_idx < header.num_nodes && valid; ++node_idx )
+    {
+        const BVHNode& node = m_nodes[node_idx];
+        if ( node.IsLeaf() )
+        {
+            valid = node.first <= header.num_quads && node.count <= header.num_quads - node.first;
+            continue;
+        }
+
+        valid = node.first > node_idx && node.first < header.num_nodes - 1 && depths[node_idx] < MaxBuildDepth;
+        if ( valid )
+        {
+            depths[node.first] = std::max( depths[node.first], depths[node_idx] + 1 );
+            depths[node.first + 1] = std::max( depths[node.first + 1], depths[node_idx] + 1 );
+        }
+    }
+
+    for ( size_t quad_idx = 0; quad_idx < m_quads.size() && valid; ++quad_idx )
+        for ( uint32_t id : m_quads[quad_idx].ids )
+            valid &= id < header.num_triangles || id == BVHHit::Invalid; // padding lanes
+
+    if ( !valid )
+        Clear();
+    return valid;
+}
+
+bool MeshBVH::IntersectQuads( const BVHRay& ray, const BVHNode& leaf, bool any_hit, BVHHit& hit ) const
+{
+    const Vec3x4 origin = Broadcast( ray.origin );
+    const Vec3x4 dir = Broadcast( ray.direction );
+    const __m128 t_min = _mm_set1_ps( ray.t_min );
+
+    bool found = false;
+    for ( uint32_t quad_idx = leaf.first; quad_idx < leaf.first + leaf.count; ++quad_idx )
+    {
+        const TriangleQuad& quad = m_quads[quad_idx];
+
+        __m128 t, u, v;
+        const int mask = _mm_movemask_ps( IntersectTriangles4( origin, dir, Load( quad.v0 ), Load( quad.e1 ), Load( quad.e2 ), t_min, _mm_set1_ps( hit.t ), t, u, v ) );
+        if ( mask == 0 )
+            continue;
+
+        if ( any_hit )
+            return true;
+
+        alignas( 16 ) float ts[4], us[4], vs[4];
+        _mm_store_ps( ts, t );
+        _mm_store_ps( us, u );
+        _mm_store_ps( vs, v );
+        for ( int lane = 0; lane < 4; ++lane )
+        {
+            if ( ( mask & ( 1 << lane ) ) == 0 || ts[lane] >= hit.t )
+                continue;
+
+            hit.t = ts[lane];
+            hit.u = us[lane];
+            hit.v = vs[lane];
+            hit.triangle = quad.ids[lane];
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool MeshBVH::IntersectClosest( const BVHRay& ray, BVHHit& hit ) const
+{
+    BVHHit closest;
+    closest.t = ray.t_max;
+
+    float t_max = ray.t_max;
+    TraverseSingle( m_nodes, MakeSingleRay( ray ), t_max, [&]( const BVHNode& leaf, float& leaf_t_max )
+    {
+        if ( IntersectQuads( ray, leaf, false, closest ) )
+            leaf_t_max = closest.t;
+        return false;
+    } );
+
+    if ( !closest.IsHit() )
+        return false;
+
+    hit = closest;
+    return true;
+}
+
+bool MeshBVH::IntersectAny( const BVHRay& ray ) const
+{
+    BVHHit limits;
+    limits.t = ray.t_max;
+
+    bool occluded = false;
+    float t_max = ray.t_max;
+    TraverseSingle( m_nodes, MakeSingleRay( ray ), t_max, [&]( const BVHNode& leaf, float& )
+    {
+        occluded = IntersectQuads( ray, leaf, true, limits );
+        return occluded;
+    } );
+    return occluded;
+}
+
+int MeshBVH::IntersectPacketClosest( RayPacket& packet, int active_mask, BVHHit* hits ) const
+{
+    int hit_mask = 0;
+    TraversePacket( m_nodes, packet, active_mask, [&]( const BVHNode& leaf, int node_mask )
+    {
+        for ( uint32_t quad_idx = leaf.first; quad_idx < leaf.first + leaf.count; ++quad_idx )
+        {
+            const TriangleQuad& quad = m_quads[quad_idx];
+            for ( int tri_lane = 0; tri_lane < 4 && quad.ids[tri_lane] != BVHHit::Invalid; ++tri_lane )
+            {
+                __m128 t, u, v;
+                const __m128 mask_vec = IntersectTriangles4( packet.origin, packet.dir,
+                    BroadcastLane( quad.v0, tri_lane ), BroadcastLane( quad.e1, tri_lane ), BroadcastLane( quad.e2, tri_lane ),
+                    packet.t_min, packet.t_max, t, u, v );
+                const int mask = _mm_movemask_ps( mask_vec ) & node_mask;
+                if ( mask == 0 )
+                    continue;
+
+                packet.t_max = Select( mask_vec, t, packet.t_max );
+
+                alignas( 16 ) float ts[4], us[4], vs[4];
+                _mm_store_ps( ts, t );
+                _mm_store_ps( us, u );
+                _mm_store_ps( vs, v );
+                for ( int ray_lane = 0; ray_lane < 4; ++ray_lane )
+                {
+                    if ( ( mask & ( 1 << ray_lane ) ) == 0 )
+                        continue;
+
+                    BVHHit& hit = hits[ray_lane];
+                    hit.t = ts[ray_lane];
+                    hit.u = us[ray_lane];
+                    hit.v = vs[ray_lane];
+                    hit.triangle = quad.ids[tri_lane];
+                }
+                hit_mask |= mask;
+            }
+        }
+        return active_mask;
+    } );
+    return hit_mask;
+}
+
+int MeshBVH::IntersectPacketAny( const RayPacket& packet, int active_mask ) const
+{
+    int occluded_mask = 0;
+    TraversePacket( m_nodes, packet, active_mask, [&]( const BVHNode& leaf, int node_mask )
+    {
+        for ( uint32_t quad_idx = leaf.first; quad_idx < leaf.first + leaf.count; ++quad_idx )
+        {
+            const TriangleQuad& quad = m_quads[quad_idx];
+            for ( int tri_lane = 0; tri_lane < 4 && quad.ids[tri_lane] != BVHHit::Invalid; ++tri_lane )
+            {
+                __m128 t, u, v;
+                const __m128 mask_vec = IntersectTriangles4( packet.origin, packet.dir,
+                    BroadcastLane( quad.v0, tri_lane ), BroadcastLane( quad.e1, tri_lane ), BroadcastLane( quad.e2, tri_lane ),
+                    packet.t_min, packet.t_max, t, u, v );
+                occluded_mask |= _mm_movemask_ps( mask_vec ) & node_mask & ~occluded_mask;
+            }
+        }
+        return active_mask & ~occluded_mask;
+    } );
+    return occluded_mask;
+}
+
+void MeshBVH::IntersectClosest( const BVHRay* rays, BVHHit* hits, size_t num_rays ) const
+{
+    for ( size_t first_ray = 0; first_ray < num_rays; first_ray += 4 )
+    {
+        const uint32_t num_lanes = PacketSize( num_rays, first_ray );
+
+        RayPacket packet;
+        packet.Load( rays + first_ray, num_lanes );
+
+        BVHHit packet_hits[4];
+        IntersectPacketClosest( packet, LaneMask( num_lanes ), packet_hits );
+        for ( uint32_t lane = 0; lane < num_lanes; ++lane )
+            hits[first_ray + lane] = packet_hits[lane];
+    }
+}
+
+void MeshBVH::IntersectAny( const BVHRay* rays, uint8_t* occluded, size_t num_rays ) const
+{
+    for ( size_t first_ray = 0; first_ray < num_rays; first_ray += 4 )
+    {
+        const uint32_t num_lanes = PacketSize( num_rays, first_ray );
+
+        RayPacket packet;
+        packet.Load( rays + first_ray, num_lanes );
+
+        const int occluded_mask = IntersectPacketAny( packet, LaneMask( num_lanes ) );
+        for ( uint32_t lane = 0; lane < num_lanes; ++lane )
+            occluded[first_ray + lane] = ( occluded_mask & ( 1 << lane ) ) ? 1 : 0;
+    }
+}
+
+// InstanceBVH
+
+namespace
+{
+    BVHRay TransformRay( const BVHRay& ray, const float m[3][4] )
+    {
+        BVHRay res = ray;
+        for ( int row = 0; row < 3; ++row )
+        {
+            res.origin[row] = m[row][0] * ray.origin[0] + m[row][1] * ray.origin[1] + m[row][2] * ray.origin[2] + m[row][3];
+            res.direction[row] = m[row][0] * ray.direction[0] + m[row][1] * ray.direction[1] + m[row][2] * ray.direction[2];
+        }
+        return res;
+    }
+}
+
+void InstanceBVH::UpdateInstance( InstanceData& dst, const Instance& src ) const
+{
+    dst.blas = src.blas;
+    dst.world_bounds = BVHBounds();
+
+    const float( &m )[3][4] = src.object_to_world;
+
+    // direction is not renormalized in object space, so hit distances are the same in both spaces
+    const float cofactors[3][3] =
+    {
+        { m[1][1] * m[2][2] - m[1][2] * m[2][1], m[0][2] * m[2][1] - m[0][1] * m[2][2], m[0][1] * m[1][2] - m[0][2] * m[1][1] },
+        { m[1][2] * m[2][0] - m[1][0] * m[2][2], m[0][0] * m[2][2] - m[0][2] * m[2][0], m[0][2] * m[1][0] - m[0][0] * m[1][2] },
+        { m[1][0] * m[2][1] - m[1][1] * m[2][0], m[0][1] * m[2][0] - m[0][0] * m[2][1], m[0][0] * m[1][1] - m[0][1] * m[1][0] },
+    };
+    const float det = m[0][0] * cofactors[0][0] + m[0][1] * cofactors[1][0] + m[0][2] * cofactors[2][0];
+    if ( det == 0.0f || src.blas == nullptr || src.blas->IsEmpty() )
+    {
+        // can't be hit
+        dst.blas = nullptr;
+        return;
+    }
+
+    const float inv_det = 1.0f / det;
+    for ( int row = 0; row < 3; ++row )
+    {
+        for ( int col = 0; col < 3; ++col )
+            dst.world_to_object[row][col] = cofactors[row][col] * inv_det;
+        dst.world_to_object[row][3] = -( dst.world_to_object[row][0] * m[0][3] + dst.world_to_object[row][1] * m[1][3] + dst.world_to_object[row][2] * m[2][3] );
+    }
+
+    dst.world_bounds = src.blas->GetBounds().Transformed( m );
+}
+
+float InstanceBVH::CalcSAHCost() const
+{
+    return CalcTreeSAHCost( m_nodes, 1, m_settings );
+}
+
+void InstanceBVH::Build( const Instance* instances, uint32_t num_instances, const BVHBuildSettings& settings )
+{
+    m_settings = settings;
+    m_instances.resize( num_instances );
+
+    std::vector<BuildPrimitive> prims;
+    prims.reserve( num_instances );
+    for ( uint32_t i = 0; i < num_instances; ++i )
+    {
+        UpdateInstance( m_instances[i], instances[i] );
+        if ( m_instances[i].blas == nullptr )
+            continue;
+
+        const BuildBounds build_bounds = BuildBounds::FromBounds( m_instances[i].world_bounds );
+        prims.emplace_back( BuildPrimitive{ build_bounds.min, build_bounds.max, i } );
+    }
+
+    BuildHierarchy( prims, 1, settings, m_nodes );
+
+    m_leaf_instances.resize( prims.size() );
+    for ( size_t i = 0; i < prims.size(); ++i )
+        m_leaf_instances[i] = prims[i].id;
+
+    m_build_sah_cost = CalcSAHCost();
+    m_sah_cost = m_build_sah_cost;
+}
+
+void InstanceBVH::Refit( const Instance* instances, uint32_t num_instances )
+{
+    if ( num_instances != m_instances.size() )
+    {
+        Build( instances, num_instances, m_settings );
+        return;
+    }
+
+    for ( uint32_t i = 0; i < num_instances; ++i )
+    {
+        const bool was_in_tree = m_instances[i].blas != nullptr;
+        UpdateInstance( m_instances[i], instances[i] );
+        if ( was_in_tree != ( m_instances[i].blas != nullptr ) )
+        {
+            // an instance became degenerate or got valid again, topology has to change
+            Build( instances, num_instances, m_settings );
+            return;
+        }
+    }
+
+    // children always follow their parent, so a reverse pass sees them updated
+    for ( size_t node_idx = m_nodes.size(); node_idx-- > 0; )
+    {
+        BVHNode& node = m_nodes[node_idx];
+        BVHBounds bounds;
+        if ( node.IsLeaf() )
+        {
+            for ( uint32_t i = node.first; i < node.first + node.count; ++i )
+                bounds.Extend( m_instances[m_leaf_instances[i]].world_bounds );
+        }
+        else
+        {
+            for ( uint32_t child = node.first; child < node.first + 2; ++child )
+            {
+                bounds.Extend( m_nodes[child].min );
+                bounds.Extend( m_nodes[child].max );
+            }
+        }
+        SetNodeBounds( node, bounds );
+    }
+
+    m_sah_cost = CalcSAHCost();
+}
+
+void InstanceBVH::Clear()
+{
+    m_nodes.clear();
+    m_leaf_instances.clear();
+    m_instances.clear();
+    m_sah_cost = 0.0f;
+    m_build_sah_cost = 0.0f;
+}
+
+bool InstanceBVH::IntersectClosest( const BVHRay& ray, BVHHit& hit ) const
+{
+    BVHHit closest;
+
+    float t_max = ray.t_max;
+    TraverseSingle( m_nodes, MakeSingleRay( ray ), t_max, [&]( const BVHNode& leaf, float& leaf_t_max )
+    {
+        for ( uint32_t i = leaf.first; i < leaf.first + leaf.count; ++i )
+        {
+            const uint32_t instance_idx = m_leaf_instances[i];
+            const InstanceData& instance = m_instances[instance_idx];
+
+            BVHRay local_ray = TransformRay( ray, instance.world_to_object );
+            local_ray.t_max = leaf_t_max;
+            if ( instance.blas->IntersectClosest( local_ray, closest ) )
+            {
+                closest.instance = instance_idx;
+                leaf_t_max = closest.t;
+            }
+        }
+        return false;
+    } );
+
+    if ( !closest.IsHit() )
+        return false;
+
+    hit = closest;
+    return true;
+}
+
+bool InstanceBVH::IntersectAny( const BVHRay& ray ) const
+{
+    bool occluded = false;
+    float t_max = ray.t_max;
+    TraverseSingle( m_nodes, MakeSingleRay( ray ), t_max, [&]( const BVHNode& leaf, float& )
+    {
+        for ( uint32_t i = leaf.first; i < leaf.first + leaf.count && !occluded; ++i )
+        {
+            const InstanceData& instance = m_instances[m_leaf_instances[i]];
+            occluded = instance.blas->IntersectAny( TransformRay( ray, instance.world_to_object ) );
+        }
+        return occluded;
+    } );
+    return occluded;
+}
+
+void InstanceBVH::IntersectClosest( const BVHRay* rays, BVHHit* hits, size_t num_rays ) const
+{
+    for ( size_t first_ray = 0; first_ray < num_rays; first_ray += 4 )
+    {
+        const uint32_t num_lanes = PacketSize( num_rays, first_ray );
+
+        MeshBVH::RayPacket packet;
+        packet.Load( rays + first_ray, num_lanes );
+
+        BVHHit packet_hits[4];
+        const int active_mask = LaneMask( num_lanes );
+        TraversePacket( m_nodes, packet, active_mask, [&]( const BVHNode& leaf, int node_mask )
+        {
+            for ( uint32_t i = leaf.first; i < leaf.first + leaf.count; ++i )
+            {
+                const uint32_t instance_idx = m_leaf_instances[i];
+                const InstanceData& instance = m_instances[instance_idx];
+
+                MeshBVH::RayPacket local_packet = packet.Transform( instance.world_to_object );
+                const int hit_mask = instance.blas->IntersectPacketClosest( local_packet, node_mask, packet_hits );
+                if ( hit_mask == 0 )
+                    continue;
+
+                packet.t_max = local_packet.t_max;
+                for ( uint32_t lane = 0; lane < 4; ++lane )
+                {
+                    if ( hit_mask & ( 1 << lane ) )
+                        packet_hits[lane].instance = instance_idx;
+                }
+            }
+            return active_mask;
+        } );
+
+        for ( uint32_t lane = 0; lane < num_lanes; ++lane )
+            hits[first_ray + lane] = packet_hits[lane];
+    }
+}
+
+void InstanceBVH::IntersectAny( const BVHRay* rays, uint8_t* occluded, size_t num_rays ) const
+{
+    for ( size_t first_ray = 0; first_ray < num_rays; first_ray += 4 )
+    {
+        const uint32_t num_lanes = PacketSize( num_rays, first_ray );
+
+        MeshBVH::RayPacket packet;
+        packet.Load( rays + first_ray, num_lanes );
+
+        int occluded_mask = 0;
+        TraversePacket( m_nodes, packet, LaneMask( num_lanes ), [&]( const BVHNode& leaf, int node_mask )
+        {
+            for ( uint32_t i = leaf.first; i < leaf.first + leaf.count; ++i )
+            {
+                const InstanceData& instance = m_instances[m_leaf_instances[i]];
+                occluded_mask |= instance.blas->IntersectPacketAny( packet.Transform( instance.world_to_object ), node_mask & ~occluded_mask );
+            }
+            return LaneMask( num_lanes ) & ~occluded_mask;
+        } );
+
+        for ( uint32_t lane = 0; lane < num_lanes; ++lane )
+            occluded[first_ray + lane] = ( occluded_mask & ( 1 << lane ) ) ? 1 : 0;
+    }
+}
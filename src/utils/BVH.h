@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// CPU bounding volume hierarchies for ray queries (picking, line of sight, tools).
+// Self-contained: vertex data is passed as raw float3 arrays, so both the legacy engine and the new one can use it
+
+struct BVHRay
+{
+    float origin[3] = {};
+    float t_min = 0.0f;
+    float direction[3] = {};
+    float t_max = FLT_MAX;
+};
+
+struct BVHHit
+{
+    static constexpr uint32_t Invalid = uint32_t( -1 );
+
+    float t = FLT_MAX;
+    // barycentrics of the second and the third triangle vertex
+    float u = 0.0f;
+    float v = 0.0f;
+    uint32_t triangle = Invalid; // index of the triangle in the source index buffer
+    uint32_t instance = Invalid; // index of the instance for InstanceBVH queries
+
+    bool IsHit() const { return triangle != Invalid; }
+};
+
+struct BVHBounds
+{
+    float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+    bool IsEmpty() const { return min[0] > max[0]; }
+    float HalfArea() const;
+    void Extend( const float p[3] );
+    void Extend( const BVHBounds& other );
+    // bounds of the transformed box, m is row major 3x4 for column vectors
+    BVHBounds Transformed( const float ( &m )[3][4] ) const;
+};
+
+struct alignas( 32 ) BVHNode
+{
+    float min[3];
+    uint32_t first; // first child for inner nodes (the second one follows it), first primitive for leaves
+    float max[3];
+    uint32_t count; // 0 for inner nodes
+
+    bool IsLeaf() const { return count != 0; }
+};
+static_assert( sizeof( BVHNode ) == 32 );
+
+struct BVHBuildSettings
+{
+    uint32_t num_bins = 16;
+    uint32_t max_leaf_size = 8;
+    // SAH costs, relative to a single primitive intersection
+    float traversal_cost = 1.0f;
+    float intersection_cost = 1.0f;
+};
+
+// Bottom level, built over the triangles of a single mesh with the binned SAH.
+// Rays are tested against 4 triangles at once, batches are traversed as packets of 4 rays
+class MeshBVH
+{
+public:
+    MeshBVH() = default;
+
+    // positions are float3 with an arbitrary byte stride, every 3 indices form a triangle
+    void Build( const void* positions, uint32_t num_vertices, size_t position_stride,
+                const uint32_t* indices, uint32_t num_indices, const BVHBuildSettings& settings = {} );
+    void Build( const void* positions, uint32_t num_vertices, size_t position_stride,
+                const uint16_t* indices, uint32_t num_indices, const BVHBuildSettings& settings = {} );
+    void Clear();
+
+    bool IsEmpty() const { return m_nodes.empty(); }
+    BVHBounds GetBounds() const;
+    uint32_t GetNumNodes() const { return uint32_t( m_nodes.size() ); }
+    uint32_t GetNumTriangles() const { return m_num_triangles; }
+    size_t GetMemoryUsage() const;
+
+    // Raw copy of the hierarchy for cooked assets, so it is not rebuilt on load. Data is only readable by the same SerializationVersion
+    static constexpr uint32_t SerializationVersion = 1;
+    size_t GetSerializedSize() const;
+    // dst must hold GetSerializedSize() bytes, no alignment is required
+    void Serialize( void* dst ) const;
+    // Validates the data, malformed files can't make traversal go out of bounds. Returns false and leaves the hierarchy empty on errors
+    bool Deserialize( const void* src, size_t size );
+
+    // Hits are reported for t_min <= t < t_max.
+    // Closest hit. Previous hit.t is ignored, use ray.t_max to limit the search. Returns false and leaves hit untouched on a miss
+    bool IntersectClosest( const BVHRay& ray, BVHHit& hit ) const;
+    // Any hit, for occlusion and line of sight queries
+    bool IntersectAny( const BVHRay& ray ) const;
+
+    // Batched versions. Consecutive rays are grouped into packets of 4, so batches of coherent rays (same origin, close directions) are the fastest
+    void IntersectClosest( const BVHRay* rays, BVHHit* hits, size_t num_rays ) const;
+    void IntersectAny( const BVHRay* rays, uint8_t* occluded, size_t num_rays ) const;
+
+private:
+    friend class InstanceBVH;
+
+    struct RayPacket;
+
+    // triangles of a leaf are stored in groups of 4, SoA. Padding lanes have zero edges and never hit
+    struct alignas( 16 ) TriangleQuad
+    {
+        float v0[3][4];
+        float e1[3][4];
+        float e2[3][4];
+        uint32_t ids[4];
+    };
+
+    template<typename IndexT>
+    void BuildImpl( const void* positions, uint32_t num_vertices, size_t position_stride,
+                    const IndexT* indices, uint32_t num_indices, const BVHBuildSettings& settings );
+
+    bool IntersectQuads( const BVHRay& ray, const BVHNode& leaf, bool any_hit, BVHHit& hit ) const;
+
+    // lanes are skipped when active_mask bit is not set. Returns the mask of lanes that got a hit
+    // packet.t_max is shortened as closer hits are found
+    int IntersectPacketClosest( RayPacket& packet, int active_mask, BVHHit* hits ) const;
+    int IntersectPacketAny( const RayPacket& packet, int active_mask ) const;
+
+    std::vector<BVHNode> m_nodes;
+    std::vector<TriangleQuad> m_quads;
+    uint32_t m_num_triangles = 0;
+};
+
+// Top level over instances of MeshBVH. Instances can be moved without a rebuild, Refit only updates the bounds
+class InstanceBVH
+{
+public:
+    struct Instance
+    {
+        const MeshBVH* blas = nullptr;
+        float object_to_world[3][4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 } }; // row major
+    };
+
+    // Instances are copied. Hit instance indices refer to the array passed here
+    void Build( const Instance* instances, uint32_t num_instances, const BVHBuildSettings& settings = {} );
+    // Same instances in the same order, only the transforms have changed. Tree topology is kept
+    void Refit( const Instance* instances, uint32_t num_instances );
+    void Clear();
+
+    uint32_t GetNumInstances() const { return uint32_t( m_instances.size() ); }
+    // Surface area heuristic cost of the tree. Grows with refits, compare to GetBuildSAHCost to decide when to rebuild
+    float GetSAHCost() const { return m_sah_cost; }
+    float GetBuildSAHCost() const { return m_build_sah_cost; }
+
+    bool IntersectClosest( const BVHRay& ray, BVHHit& hit ) const;
+    bool IntersectAny( const BVHRay& ray ) const;
+
+    void IntersectClosest( const BVHRay* rays, BVHHit* hits, size_t num_rays ) const;
+    void IntersectAny( const BVHRay* rays, uint8_t* occluded, size_t num_rays ) const;
+
+private:
+    struct InstanceData
+    {
+        const MeshBVH* blas = nullptr;
+        float world_to_object[3][4] = {};
+        BVHBounds world_bounds;
+    };
+
+    void UpdateInstance( InstanceData& dst, const Instance& src ) const;
+    float CalcSAHCost() const;
+
+    std::vector<BVHNode> m_nodes;
+    std::vector<uint32_t> m_leaf_instances; // leaves reference ranges of this array
+    std::vector<InstanceData> m_instances;
+    float m_sah_cost = 0.0f;
+    float m_build_sah_cost = 0.0f;
+    BVHBuildSettings m_settings;
+};
@@ -0,0 +1,475 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "FrustumCulling.h"
+
+#include <immintrin.h>
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+// AVX2 kernels are compiled without enabling AVX for the whole project and only called when the cpu supports it
+#if defined( _MSC_VER ) && !defined( __clang__ )
+#define SE_TARGET_AVX2
+#else
+#define SE_TARGET_AVX2 __attribute__(( target( "avx2" ) ))
+#endif
+
+namespace
+{
+    constexpr uint32_t SlotGroupSize = 8;
+    // median splits, so the depth is at most log2 of the object count
+    constexpr uint32_t TraversalStackSize = 64;
+
+    uint32_t CountTrailingZeros( uint32_t value )
+    {
+        assert( value != 0 );
+#if defined( _MSC_VER ) && !defined( __clang__ )
+        unsigned long index;
+        _BitScanForward( &index, value );
+        return uint32_t( index );
+#else
+        return uint32_t( __builtin_ctz( value ) );
+#endif
+    }
+
+    // Box vs plane test with the box corner furthest along the plane normal (p-vertex) and the nearest one (n-vertex).
+    // Every implementation evaluates ( ( n.x * p.x + n.y * p.y ) + n.z * p.z ) + w in the same order without fma,
+    // so a box inside a node never passes a plane the node has failed, and results don't depend on the instruction set
+    struct CullingPlane
+    {
+        float n[3];
+        float w;
+        // p-vertex coordinates for every slot, max or min SoA array depending on the normal sign
+        const float* p[3];
+        bool use_max[3];
+
+        float Distance( float x, float y, float z ) const { return ( ( n[0] * x + n[1] * y ) + n[2] * z ) + w; }
+    };
+    using CullingPlanes = CullingPlane[6];
+
+    enum class NodeClass
+    {
+        Outside,
+        Intersecting,
+        Inside
+    };
+
+    NodeClass ClassifyBounds( const BVHBounds& bounds, const CullingPlanes& planes )
+    {
+        NodeClass res = NodeClass::Inside;
+        for ( const CullingPlane& plane : planes )
+        {
+            const float p_dist = plane.Distance(
+                plane.use_max[0] ? bounds.max[0] : bounds.min[0],
+                plane.use_max[1] ? bounds.max[1] : bounds.min[1],
+                plane.use_max[2] ? bounds.max[2] : bounds.min[2] );
+            if ( !( p_dist >= 0.0f ) )
+                return NodeClass::Outside;
+
+            const float n_dist = plane.Distance(
+                plane.use_max[0] ? bounds.min[0] : bounds.max[0],
+                plane.use_max[1] ? bounds.min[1] : bounds.max[1],
+                plane.use_max[2] ? bounds.min[2] : bounds.max[2] );
+            if ( !( n_dist >= 0.0f ) )
+                res = NodeClass::Intersecting;
+        }
+        return res;
+    }
+
+    void AppendVisible( uint32_t lane_mask, const uint32_t* slot_objects, std::vector<uint32_t>& visible )
+    {
+        while ( lane_mask != 0 )
+        {
+            visible.push_back( slot_objects[CountTrailingZeros( lane_mask )] );
+            lane_mask &= lane_mask - 1;
+        }
+    }
+
+    // Leaf kernels. Test slots [first_slot, end_slot) against the frustums in frustum_mask, the range is a multiple of 8
+
+    void CullLeafScalar( uint32_t first_slot, uint32_t end_slot, const uint32_t* slot_objects,
+                         const CullingPlanes* frustums, uint32_t frustum_mask, std::vector<uint32_t>* visible )
+    {
+        for ( uint32_t slot = first_slot; slot < end_slot; ++slot )
+        {
+            for ( uint32_t mask = frustum_mask; mask != 0; mask &= mask - 1 )
+            {
+                const uint32_t frustum_idx = CountTrailingZeros( mask );
+                bool inside = true;
+                for ( const CullingPlane& plane : frustums[frustum_idx] )
+                    inside &= plane.Distance( plane.p[0][slot], plane.p[1][slot], plane.p[2][slot] ) >= 0.0f;
+
+                if ( inside )
+                    visible[frustum_idx].push_back( slot_objects[slot] );
+            }
+        }
+    }
+
+    void CullLeafSSE( uint32_t first_slot, uint32_t end_slot, const uint32_t* slot_objects,
+                      const CullingPlanes* frustums, uint32_t frustum_mask, std::vector<uint32_t>* visible )
+    {
+        const __m128 zero = _mm_setzero_ps();
+        for ( uint32_t slot = first_slot; slot < end_slot; slot += SlotGroupSize )
+        {
+            for ( uint32_t mask = frustum_mask; mask != 0; mask &= mask - 1 )
+            {
+                const uint32_t frustum_idx = CountTrailingZeros( mask );
+                __m128 inside[2] = { _mm_castsi128_ps( _mm_set1_epi32( -1 ) ), _mm_castsi128_ps( _mm_set1_epi32( -1 ) ) };
+                for ( const CullingPlane& plane : frustums[frustum_idx] )
+                {
+                    for ( uint32_t half = 0; half < 2; ++half )
+                    {
+                        const uint32_t offset = slot + half * 4;
+                        __m128 dist = _mm_mul_ps( _mm_set1_ps( plane.n[0] ), _mm_loadu_ps( plane.p[0] + offset ) );
+                        dist = _mm_add_ps( dist, _mm_mul_ps( _mm_set1_ps( plane.n[1] ), _mm_loadu_ps( plane.p[1] + offset ) ) );
+                        dist = _mm_add_ps( dist, _mm_mul_ps( _mm_set1_ps( plane.n[2] ), _mm_loadu_ps( plane.p[2] + offset ) ) );
+                        dist = _mm_add_ps( dist, _mm_set1_ps( plane.w ) );
+                        inside[half] = _mm_and_ps( inside[half], _mm_cmpge_ps( dist, zero ) );
+                    }
+                }
+
+                const uint32_t lane_mask = uint32_t( _mm_movemask_ps( inside[0] ) ) | ( uint32_t( _mm_movemask_ps( inside[1] ) ) << 4 );
+                AppendVisible( lane_mask, slot_objects + slot, visible[frustum_idx] );
+            }
+        }
+    }
+
+    SE_TARGET_AVX2 void CullLeafAVX2( uint32_t first_slot, uint32_t end_slot, const uint32_t* slot_objects,
+                                      const CullingPlanes* frustums, uint32_t frustum_mask, std::vector<uint32_t>* visible )
+    {
+        const __m256 zero = _mm256_setzero_ps();
+        for ( uint32_t slot = first_slot; slot < end_slot; slot += SlotGroupSize )
+        {
+            for ( uint32_t mask = frustum_mask; mask != 0; mask &= mask - 1 )
+            {
+                const uint32_t frustum_idx = CountTrailingZeros( mask );
+                __m256 inside = _mm256_castsi256_ps( _mm256_set1_epi32( -1 ) );
+                for ( const CullingPlane& plane : frustums[frustum_idx] )
+                {
+                    __m256 dist = _mm256_mul_ps( _mm256_set1_ps( plane.n[0] ), _mm256_loadu_ps( plane.p[0] + slot ) );
+                    dist = _mm256_add_ps( dist, _mm256_mul_ps( _mm256_set1_ps( plane.n[1] ), _mm256_loadu_ps( plane.p[1] + slot ) ) );
+                    dist = _mm256_add_ps( dist, _mm256_mul_ps( _mm256_set1_ps( plane.n[2] ), _mm256_loadu_ps( plane.p[2] + slot ) ) );
+                    dist = _mm256_add_ps( dist, _mm256_set1_ps( plane.w ) );
+                    inside = _mm256_and_ps( inside, _mm256_cmp_ps( dist, zero, _CMP_GE_OQ ) );
+                }
+
+                AppendVisible( uint32_t( _mm256_movemask_ps( inside ) ), slot_objects + slot, visible[frustum_idx] );
+            }
+        }
+    }
+
+    using CullLeafFunc = void( * )( uint32_t, uint32_t, const uint32_t*, const CullingPlanes*, uint32_t, std::vector<uint32_t>* );
+
+    CullLeafFunc GetCullLeafFunc( CullingSIMD simd )
+    {
+        switch ( simd )
+        {
+            case CullingSIMD::Scalar: return &CullLeafScalar;
+            case CullingSIMD::SSE: return &CullLeafSSE;
+            case CullingSIMD::AVX2: return &CullLeafAVX2;
+        }
+        return &CullLeafScalar;
+    }
+}
+
+CullingFrustum CullingFrustum::FromMatrix( const float ( &m )[4][4] )
+{
+    // Gribb-Hartmann, planes are combinations of the matrix rows. Depth is clipped to 0 <= z <= w
+    CullingFrustum res;
+    for ( int col = 0; col < 4; ++col )
+    {
+        res.planes[0][col] = m[3][col] + m[0][col]; // left
+        res.planes[1][col] = m[3][col] - m[0][col]; // right
+        res.planes[2][col] = m[3][col] + m[1][col]; // bottom
+        res.planes[3][col] = m[3][col] - m[1][col]; // top
+        res.planes[4][col] = m[2][col]; // near, far for reversed depth
+        res.planes[5][col] = m[3][col] - m[2][col];
+    }
+
+    // normalized, so that distances are comparable between planes
+    for ( float( &plane )[4] : res.planes )
+    {
+        const float len = std::sqrt( plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2] );
+        if ( len > 0.0f )
+        {
+            for ( float& value : plane )
+                value /= len;
+        }
+    }
+    return res;
+}
+
+CullingSIMD GetSupportedCullingSIMD()
+{
+    static const CullingSIMD supported = []()
+    {
+#if defined( _MSC_VER ) && !defined( __clang__ )
+        int info[4] = {};
+        __cpuid( info, 0 );
+        if ( info[0] < 7 )
+            return CullingSIMD::SSE;
+
+        __cpuid( info, 1 );
+        const bool os_saves_ymm = ( info[2] & ( 1 << 27 ) ) != 0 && ( _xgetbv( 0 ) & 0x6 ) == 0x6;
+        const bool avx = ( info[2] & ( 1 << 28 ) ) != 0;
+        __cpuidex( info, 7, 0 );
+        const bool avx2 = ( info[1] & ( 1 << 5 ) ) != 0;
+        return ( os_saves_ymm && avx && avx2 ) ? CullingSIMD::AVX2 : CullingSIMD::SSE;
+#else
+        return __builtin_cpu_supports( "avx2" ) ? CullingSIMD::AVX2 : CullingSIMD::SSE;
+#endif
+    }();
+    return supported;
+}
+
+// CullingBVH
+
+void CullingBVH::Build( const BVHBounds* bounds, uint32_t num_objects, uint32_t max_leaf_size )
+{
+    Clear();
+    if ( num_objects == 0 )
+        return;
+
+    max_leaf_size = std::max( max_leaf_size, 1u );
+
+    std::vector<BuildItem> items( num_objects );
+    for ( uint32_t i = 0; i < num_objects; ++i )
+    {
+        items[i].object = i;
+        // empty bounds get a finite centroid, they are culled by the plane tests anyway
+        for ( int axis = 0; axis < 3; ++axis )
+            items[i].centroid[axis] = bounds[i].IsEmpty() ? 0.0f : ( bounds[i].min[axis] + bounds[i].max[axis] ) * 0.5f;
+    }
+
+    const uint32_t max_slots = num_objects + ( num_objects / max_leaf_size + 1 ) * SlotGroupSize;
+    for ( int axis = 0; axis < 3; ++axis )
+    {
+        m_min[axis].reserve( max_slots );
+        m_max[axis].reserve( max_slots );
+    }
+    m_slot_objects.reserve( max_slots );
+    m_object_slots.resize( num_objects );
+    m_nodes.reserve( size_t( num_objects / max_leaf_size + 1 ) * 2 );
+
+    m_nodes.emplace_back();
+    BuildNode( 0, items.data(), num_objects, bounds, max_leaf_size );
+
+    m_needs_refit = true;
+    Refit();
+}
+
+void CullingBVH::BuildNode( uint32_t node, BuildItem* items, uint32_t count, const BVHBounds* bounds, uint32_t max_leaf_size )
+{
+    m_nodes[node].first_slot = uint32_t( m_slot_objects.size() );
+
+    if ( count <= max_leaf_size )
+    {
+        for ( uint32_t i = 0; i < count; ++i )
+        {
+            const uint32_t object = items[i].object;
+            m_object_slots[object] = uint32_t( m_slot_objects.size() );
+            m_slot_objects.push_back( object );
+            for ( int axis = 0; axis < 3; ++axis )
+            {
+                m_min[axis].push_back( bounds[object].min[axis] );
+                m_max[axis].push_back( bounds[object].max[axis] );
+            }
+        }
+        while ( m_slot_objects.size() % SlotGroupSize != 0 )
+        {
+            m_slot_objects.push_back( InvalidObject );
+            for ( int axis = 0; axis < 3; ++axis )
+            {
+                m_min[axis].push_back( NAN );
+                m_max[axis].push_back( NAN );
+            }
+        }
+        m_nodes[node].end_slot = uint32_t( m_slot_objects.size() );
+        return;
+    }
+
+    // median split along the longest centroid extent
+    float centroid_min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float centroid_max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for ( uint32_t i = 0; i < count; ++i )
+    {
+        for ( int axis = 0; axis < 3; ++axis )
+        {
+            centroid_min[axis] = std::min( centroid_min[axis], items[i].centroid[axis] );
+            centroid_max[axis] = std::max( centroid_max[axis], items[i].centroid[axis] );
+        }
+    }
+    int split_axis = 0;
+    for ( int axis = 1; axis < 3; ++axis )
+    {
+        if ( centroid_max[axis] - centroid_min[axis] > centroid_max[split_axis] - centroid_min[split_axis] )
+            split_axis = axis;
+    }
+
+    const uint32_t left_count = count / 2;
+    std::nth_element( items, items + left_count, items + count, [split_axis]( const BuildItem& lhs, const BuildItem& rhs )
+    {
+        return lhs.centroid[split_axis] < rhs.centroid[split_axis];
+    } );
+
+    const uint32_t first_child = uint32_t( m_nodes.size() );
+    m_nodes.emplace_back();
+    m_nodes.emplace_back();
+    m_nodes[node].first_child = first_child;
+
+    BuildNode( first_child, items, left_count, bounds, max_leaf_size );
+    BuildNode( first_child + 1, items + left_count, count - left_count, bounds, max_leaf_size );
+
+    m_nodes[node].end_slot = uint32_t( m_slot_objects.size() );
+}
+
+void CullingBVH::SetBounds( uint32_t object, const BVHBounds& bounds )
+{
+    assert( object < m_object_slots.size() );
+    const uint32_t slot = m_object_slots[object];
+    for ( int axis = 0; axis < 3; ++axis )
+    {
+        m_min[axis][slot] = bounds.min[axis];
+        m_max[axis][slot] = bounds.max[axis];
+    }
+    m_needs_refit = true;
+}
+
+void CullingBVH::RefitNode( Node& node ) const
+{
+    node.bounds = BVHBounds();
+    if ( !node.IsLeaf() )
+    {
+        node.bounds.Extend( m_nodes[node.first_child].bounds );
+        node.bounds.Extend( m_nodes[node.first_child + 1].bounds );
+        return;
+    }
+
+    for ( uint32_t slot = node.first_slot; slot < node.end_slot; ++slot )
+    {
+        if ( m_slot_objects[slot] == InvalidObject )
+            continue;
+
+        for ( int axis = 0; axis < 3; ++axis )
+        {
+            node.bounds.min[axis] = std::min( node.bounds.min[axis], m_min[axis][slot] );
+            node.bounds.max[axis] = std::max( node.bounds.max[axis], m_max[axis][slot] );
+        }
+    }
+}
+
+void CullingBVH::Refit()
+{
+    if ( !m_needs_refit )
+        return;
+
+    // children are always stored after their parent
+    for ( size_t i = m_nodes.size(); i-- > 0; )
+        RefitNode( m_nodes[i] );
+
+    m_needs_refit = false;
+}
+
+void CullingBVH::Clear()
+{
+    m_nodes.clear();
+    for ( int axis = 0; axis < 3; ++axis )
+    {
+        m_min[axis].clear();
+        m_max[axis].clear();
+    }
+    m_slot_objects.clear();
+    m_object_slots.clear();
+    m_needs_refit = false;
+}
+
+void CullingBVH::Cull( const CullingFrustum* frustums, uint32_t num_frustums, std::vector<uint32_t>* visible ) const
+{
+    Cull( frustums, num_frustums, visible, GetSupportedCullingSIMD() );
+}
+
+void CullingBVH::Cull( const CullingFrustum* frustums, uint32_t num_frustums, std::vector<uint32_t>* visible, CullingSIMD simd ) const
+{
+    assert( num_frustums <= MaxFrustums );
+    assert( !m_needs_refit );
+
+    for ( uint32_t i = 0; i < num_frustums; ++i )
+        visible[i].clear();
+
+    if ( m_nodes.empty() || num_frustums == 0 )
+        return;
+
+    CullingPlanes planes[MaxFrustums];
+    for ( uint32_t frustum_idx = 0; frustum_idx < num_frustums; ++frustum_idx )
+    {
+        for ( int plane_idx = 0; plane_idx < 6; ++plane_idx )
+        {
+            const float( &src )[4] = frustums[frustum_idx].planes[plane_idx];
+            CullingPlane& plane = planes[frustum_idx][plane_idx];
+            for ( int axis = 0; axis < 3; ++axis )
+            {
+                plane.n[axis] = src[axis];
+                plane.use_max[axis] = src[axis] >= 0.0f;
+                plane.p[axis] = plane.use_max[axis] ? m_max[axis].data() : m_min[axis].data();
+            }
+            plane.w = src[3];
+        }
+    }
+
+    const CullLeafFunc cull_leaf = GetCullLeafFunc( simd );
+
+    struct StackEntry
+    {
+        uint32_t node;
+        uint32_t frustum_mask; // frustums intersecting the parent
+    };
+    StackEntry stack[TraversalStackSize];
+    uint32_t stack_size = 0;
+    stack[stack_size++] = StackEntry{ 0, uint32_t( ( uint64_t( 1 ) << num_frustums ) - 1 ) };
+
+    while ( stack_size > 0 )
+    {
+        const StackEntry entry = stack[--stack_size];
+        const Node& node = m_nodes[entry.node];
+
+        uint32_t intersecting_mask = 0;
+        for ( uint32_t mask = entry.frustum_mask; mask != 0; mask &= mask - 1 )
+        {
+            const uint32_t frustum_idx = CountTrailingZeros( mask );
+            switch ( ClassifyBounds( node.bounds, planes[frustum_idx] ) )
+            {
+                case NodeClass::Outside:
+                    break;
+                case NodeClass::Intersecting:
+                    intersecting_mask |= 1u << frustum_idx;
+                    break;
+                case NodeClass::Inside:
+                    // the whole subtree is visible, only padding and empty boxes are skipped
+                    for ( uint32_t slot = node.first_slot; slot < node.end_slot; ++slot )
+                    {
+                        if ( m_min[0][slot] <= m_max[0][slot] )
+                            visible[frustum_idx].push_back( m_slot_objects[slot] );
+                    }
+                    break;
+            }
+        }
+
+        if ( intersecting_mask == 0 )
+            continue;
+
+        if ( node.IsLeaf() )
+        {
+            cull_leaf( node.first_slot, node.end_slot, m_slot_objects.data(), planes, intersecting_mask, visible );
+            continue;
+        }
+
+        assert( stack_size + 2 <= TraversalStackSize );
+        stack[stack_size++] = StackEntry{ node.first_child + 1, intersecting_mask };
+        stack[stack_size++] = StackEntry{ node.first_child, intersecting_mask };
+    }
+}
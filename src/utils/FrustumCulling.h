@@ -0,0 +1,85 @@
+#pragma once
+
+#include "BVH.h"
+
+// Frustum culling of world space boxes for draw list generation.
+// Self-contained like BVH.h, matrices and bounds are passed as raw floats
+
+struct CullingFrustum
+{
+    // a point is inside when dot( plane.xyz, p ) + plane.w >= 0 for every plane
+    float planes[6][4] = {};
+
+    // clip_from_world is row major for column vectors, clip = m * float4( p, 1 ). Clip space depth must be in [0, 1] range, reversed or not.
+    // Transpose DirectXMath matrices before passing them here
+    static CullingFrustum FromMatrix( const float ( &clip_from_world )[4][4] );
+};
+
+enum class CullingSIMD : uint8_t
+{
+    Scalar = 0,
+    SSE,
+    AVX2 // 8 boxes per iteration
+};
+
+// best instruction set supported by the cpu, checked once
+CullingSIMD GetSupportedCullingSIMD();
+
+// Hierarchy over world space boxes of scene objects, for culling against several frustums (main view, shadow cascades) at once.
+// Boxes are stored SoA in leaf order. Every leaf starts at a multiple of 8, so leaves are tested 8 boxes per iteration.
+// Nodes which are fully inside or outside a frustum are resolved without testing their boxes
+class CullingBVH
+{
+public:
+    static constexpr uint32_t MaxFrustums = 32;
+    static constexpr uint32_t InvalidObject = uint32_t( -1 );
+
+    // objects are identified by their index in the bounds array. Empty bounds are never visible
+    void Build( const BVHBounds* bounds, uint32_t num_objects, uint32_t max_leaf_size = 32 );
+    // Moved objects. Node bounds are updated with the next Refit call, topology is kept, so rebuild after larger changes
+    void SetBounds( uint32_t object, const BVHBounds& bounds );
+    void Refit();
+    void Clear();
+
+    uint32_t GetNumObjects() const { return uint32_t( m_object_slots.size() ); }
+    uint32_t GetNumNodes() const { return uint32_t( m_nodes.size() ); }
+    bool NeedsRefit() const { return m_needs_refit; }
+
+    // Tests every object against every frustum in a single traversal, num_frustums <= MaxFrustums.
+    // visible[i] receives the objects intersecting frustums[i], in no particular order. The test is conservative,
+    // boxes close to the frustum edges may be reported visible while being outside
+    void Cull( const CullingFrustum* frustums, uint32_t num_frustums, std::vector<uint32_t>* visible ) const;
+    void Cull( const CullingFrustum* frustums, uint32_t num_frustums, std::vector<uint32_t>* visible, CullingSIMD simd ) const;
+
+private:
+    struct Node
+    {
+        BVHBounds bounds;
+        uint32_t first_child = 0; // second child follows the first one. 0 for leaves, root can't be a child
+        // slots of the whole subtree, leaves start at a multiple of 8
+        uint32_t first_slot = 0;
+        uint32_t end_slot = 0;
+
+        bool IsLeaf() const { return first_child == 0; }
+    };
+
+    struct BuildItem
+    {
+        float centroid[3];
+        uint32_t object;
+    };
+
+    // items are reordered
+    void BuildNode( uint32_t node, BuildItem* items, uint32_t count, const BVHBounds* bounds, uint32_t max_leaf_size );
+    void RefitNode( Node& node ) const;
+
+    std::vector<Node> m_nodes;
+
+    // SoA bounds, indexed by slot. Padding slots are NaN, so they never pass a plane test
+    std::vector<float> m_min[3];
+    std::vector<float> m_max[3];
+    std::vector<uint32_t> m_slot_objects; // InvalidObject for padding
+    std::vector<uint32_t> m_object_slots;
+
+    bool m_needs_refit = false;
+};
@@ -1,10 +1,19 @@
 // This is an independent project of an individual developer. Dear PVS-Studio, please check it.
 // PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
 
-#include "../stdafx.h"
-
 #include "MemoryMappedFile.h"
 
+#include <string>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 
 MemoryMappedFile::~MemoryMappedFile()
 {
@@ -14,52 +23,89 @@ MemoryMappedFile::~MemoryMappedFile()
 
 MemoryMappedFile::MemoryMappedFile( MemoryMappedFile&& other ) noexcept
 {
-    m_file_handle = other.m_file_handle;
-    m_file_mapping = other.m_file_mapping;
-    m_mapped_file_data = other.m_mapped_file_data;
-    other.m_file_handle = INVALID_HANDLE_VALUE;
-    other.m_file_mapping = nullptr;
-    other.m_mapped_file_data = span<const uint8_t>();
+    *this = std::move( other );
 }
 
 
 MemoryMappedFile& MemoryMappedFile::operator=( MemoryMappedFile && other ) noexcept
 {
+    if ( this == &other )
+        return *this;
+
+    Close();
+
+#ifdef _WIN32
     m_file_handle = other.m_file_handle;
     m_file_mapping = other.m_file_mapping;
+#else
+    m_file_descriptor = other.m_file_descriptor;
+#endif
     m_mapped_file_data = other.m_mapped_file_data;
-    other.m_file_handle = INVALID_HANDLE_VALUE;
-    other.m_file_mapping = nullptr;
-    other.m_mapped_file_data = span<const uint8_t>();
+    other.Reset();
     return *this;
 }
 
 
 bool MemoryMappedFile::Open( const std::string_view& path ) noexcept
 {
-    // be careful with return value for failed winapi functions!
-    // different functions return different values for handles!
     if ( IsOpened() )
         return false;
 
-    m_file_handle = CreateFileA( path.data(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
-    if ( m_file_handle == INVALID_HANDLE_VALUE )
+    // path may be a view into a larger string
+    const std::string path_str( path );
+
+#ifdef _WIN32
+    // be careful with return value for failed winapi functions!
+    // different functions return different values for handles!
+    HANDLE file_handle = CreateFileA( path_str.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+    if ( file_handle == INVALID_HANDLE_VALUE )
         return false;
+    m_file_handle = file_handle;
 
     LARGE_INTEGER filesize;
-    if ( ! GetFileSizeEx( m_file_handle, &filesize ) )
-        return false;
-    if ( filesize.QuadPart == 0 )
+    if ( ! GetFileSizeEx( file_handle, &filesize ) || filesize.QuadPart == 0 )
+    {
+        Close();
         return false;
-    m_file_mapping = CreateFileMappingA( m_file_handle, nullptr, PAGE_READONLY, 0, 0, NULL );
+    }
+
+    m_file_mapping = CreateFileMappingA( file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr );
     if ( ! m_file_mapping )
+    {
+        Close();
         return false;
+    }
 
     const uint8_t* mapped_region_start = reinterpret_cast<const uint8_t*>( MapViewOfFile( m_file_mapping, FILE_MAP_READ, 0, 0, 0 ) );
     if ( ! mapped_region_start )
+    {
+        Close();
         return false;
+    }
 
     m_mapped_file_data = span<const uint8_t>( mapped_region_start, mapped_region_start + filesize.QuadPart );
+#else
+    m_file_descriptor = open( path_str.c_str(), O_RDONLY | O_CLOEXEC );
+    if ( m_file_descriptor < 0 )
+        return false;
+
+    struct stat file_stat = {};
+    if ( fstat( m_file_descriptor, &file_stat ) != 0 || file_stat.st_size <= 0 )
+    {
+        Close();
+        return false;
+    }
+
+    void* mapped_region_start = mmap( nullptr, size_t( file_stat.st_size ), PROT_READ, MAP_PRIVATE, m_file_descriptor, 0 );
+    if ( mapped_region_start == MAP_FAILED )
+    {
+        Close();
+        return false;
+    }
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>( mapped_region_start );
+    m_mapped_file_data = span<const uint8_t>( data, data + file_stat.st_size );
+#endif
 
     return true;
 }
@@ -67,20 +113,40 @@ bool MemoryMappedFile::Open( const std::string_view& path ) noexcept
 
 bool MemoryMappedFile::IsOpened() const noexcept
 {
-    return m_file_handle != nullptr && m_file_handle != INVALID_HANDLE_VALUE
-        && m_file_mapping != nullptr && m_file_mapping != INVALID_HANDLE_VALUE
-        && m_mapped_file_data.cbegin() != nullptr;
+    return m_mapped_file_data.cbegin() != nullptr;
 }
 
 
 void MemoryMappedFile::Close() noexcept
 {
+#ifdef _WIN32
     if ( m_mapped_file_data.cbegin() != nullptr )
         UnmapViewOfFile( m_mapped_file_data.cbegin() );
 
-    if ( m_file_mapping != nullptr && m_file_mapping != INVALID_HANDLE_VALUE )
+    if ( m_file_mapping != nullptr )
         CloseHandle( m_file_mapping );
 
-    if ( m_file_handle != nullptr && m_file_handle != INVALID_HANDLE_VALUE )
+    if ( m_file_handle != nullptr )
         CloseHandle( m_file_handle );
+#else
+    if ( m_mapped_file_data.cbegin() != nullptr )
+        munmap( const_cast<uint8_t*>( m_mapped_file_data.cbegin() ), m_mapped_file_data.size() );
+
+    if ( m_file_descriptor >= 0 )
+        close( m_file_descriptor );
+#endif
+
+    Reset();
+}
+
+
+void MemoryMappedFile::Reset() noexcept
+{
+#ifdef _WIN32
+    m_file_handle = nullptr;
+    m_file_mapping = nullptr;
+#else
+    m_file_descriptor = -1;
+#endif
+    m_mapped_file_data = span<const uint8_t>();
 }
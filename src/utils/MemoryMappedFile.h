@@ -1,7 +1,11 @@
 #pragma once
 
+#include <cstdint>
+#include <string_view>
+
 #include "span.h"
 
+// Read-only mapping of a whole file. Works on Windows and POSIX systems, platform headers are only included in the .cpp
 class MemoryMappedFile
 {
 public:
@@ -10,13 +14,20 @@ public:
     MemoryMappedFile( const MemoryMappedFile& other ) = delete;
     MemoryMappedFile( MemoryMappedFile&& other ) noexcept;
     MemoryMappedFile& operator=( MemoryMappedFile&& other ) noexcept;
+    // empty files can't be mapped, Open fails for them
     bool Open( const std::string_view& path ) noexcept;
     bool IsOpened() const noexcept;
     void Close() noexcept;
     const span<const uint8_t>& GetData() const noexcept { return m_mapped_file_data; }
 
 private:
-    HANDLE m_file_handle = INVALID_HANDLE_VALUE;
-    HANDLE m_file_mapping = nullptr; // different default values because of different error values for corresponding winapi functions
+    void Reset() noexcept;
+
+#ifdef _WIN32
+    void* m_file_handle = nullptr; // HANDLE
+    void* m_file_mapping = nullptr; // HANDLE
+#else
+    int m_file_descriptor = -1;
+#endif
     span<const uint8_t> m_mapped_file_data;
-};
\ No newline at end of file
+};
@@ -0,0 +1,373 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "MeshOptimization.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    constexpr uint32_t NoVertex = uint32_t( -1 );
+
+    // FIFO post-transform cache. A vertex is cached while fewer than cache_size other vertices were transformed after it
+    class VertexCacheSimulator
+    {
+    public:
+        VertexCacheSimulator( uint32_t num_vertices, uint32_t cache_size )
+            : m_timestamps( num_vertices, 0 ), m_cache_size( cache_size ), m_time( cache_size + 1 )
+        {}
+
+        // returns true on a miss
+        bool Access( uint32_t vertex )
+        {
+            if ( m_time - m_timestamps[vertex] <= m_cache_size )
+                return false;
+            m_timestamps[vertex] = m_time++;
+            return true;
+        }
+
+        uint32_t AccessTriangle( const uint32_t* triangle )
+        {
+            return uint32_t( Access( triangle[0] ) ) + uint32_t( Access( triangle[1] ) ) + uint32_t( Access( triangle[2] ) );
+        }
+
+        void Flush() { m_time += m_cache_size + 1; }
+
+    private:
+        std::vector<uint32_t> m_timestamps;
+        uint32_t m_cache_size;
+        uint32_t m_time;
+    };
+
+    const float* Position( const float* positions, size_t position_stride, uint32_t vertex )
+    {
+        return reinterpret_cast<const float*>( reinterpret_cast<const uint8_t*>( positions ) + vertex * position_stride );
+    }
+}
+
+VertexCacheStats AnalyzeVertexCache( const uint32_t* indices, size_t num_indices, uint32_t num_vertices, uint32_t cache_size )
+{
+    assert( num_indices % 3 == 0 );
+
+    VertexCacheStats stats;
+    if ( num_indices == 0 )
+        return stats;
+
+    VertexCacheSimulator cache( num_vertices, cache_size );
+    std::vector<uint8_t> referenced( num_vertices, 0 );
+    uint32_t num_referenced = 0;
+    for ( size_t i = 0; i < num_indices; ++i )
+    {
+        assert( indices[i] < num_vertices );
+        stats.transformed_vertices += uint32_t( cache.Access( indices[i] ) );
+        num_referenced += uint32_t( referenced[indices[i]] == 0 );
+        referenced[indices[i]] = 1;
+    }
+
+    stats.acmr = float( stats.transformed_vertices ) / float( num_indices / 3 );
+    stats.atvr = float( stats.transformed_vertices ) / float( num_referenced );
+    return stats;
+}
+
+float AnalyzeVertexFetchOverfetch( const uint32_t* indices, size_t num_indices, uint32_t num_vertices, size_t vertex_stride )
+{
+    constexpr size_t LineSize = 64;
+    constexpr size_t NumLines = 16 * 1024 / LineSize;
+
+    std::vector<size_t> line_tags( NumLines, size_t( -1 ) );
+    std::vector<uint8_t> referenced( num_vertices, 0 );
+    size_t num_referenced = 0;
+    size_t bytes_fetched = 0;
+
+    for ( size_t i = 0; i < num_indices; ++i )
+    {
+        const uint32_t vertex = indices[i];
+        assert( vertex < num_vertices );
+        num_referenced += size_t( referenced[vertex] == 0 );
+        referenced[vertex] = 1;
+
+        const size_t first_line = vertex * vertex_stride / LineSize;
+        const size_t last_line = ( ( vertex + 1 ) * vertex_stride - 1 ) / LineSize;
+        for ( size_t line = first_line; line <= last_line; ++line )
+        {
+            size_t& tag = line_tags[line % NumLines];
+            if ( tag != line )
+            {
+                tag = line;
+                bytes_fetched += LineSize;
+            }
+        }
+    }
+
+    return num_referenced > 0 ? float( bytes_fetched ) / float( num_referenced * vertex_stride ) : 0.0f;
+}
+
+void OptimizeVertexCacheTipsify( uint32_t* dst, const uint32_t* indices, size_t num_indices, uint32_t num_vertices,
+                                 uint32_t cache_size, std::vector<uint32_t>* hard_boundaries )
+{
+    assert( num_indices % 3 == 0 );
+    assert( dst != indices );
+
+    if ( hard_boundaries )
+        hard_boundaries->clear();
+    if ( num_indices == 0 )
+        return;
+
+    // triangles of every vertex. Live counts are the numbers of triangles not emitted yet
+    std::vector<uint32_t> live_triangles( num_vertices, 0 );
+    for ( size_t i = 0; i < num_indices; ++i )
+    {
+        assert( indices[i] < num_vertices );
+        live_triangles[indices[i]]++;
+    }
+
+    std::vector<uint32_t> adjacency_offsets( size_t( num_vertices ) + 1, 0 );
+    for ( uint32_t vertex = 0; vertex < num_vertices; ++vertex )
+        adjacency_offsets[vertex + 1] = adjacency_offsets[vertex] + live_triangles[vertex];
+
+    std::vector<uint32_t> adjacency( num_indices );
+    {
+        std::vector<uint32_t> fill_offsets( adjacency_offsets.begin(), adjacency_offsets.end() - 1 );
+        for ( size_t i = 0; i < num_indices; ++i )
+            adjacency[fill_offsets[indices[i]]++] = uint32_t( i / 3 );
+    }
+
+    std::vector<uint32_t> timestamps( num_vertices, 0 );
+    std::vector<uint8_t> emitted( num_indices / 3, 0 );
+    std::vector<uint32_t> dead_ends;
+    dead_ends.reserve( num_indices );
+    std::vector<uint32_t> candidates;
+
+    uint32_t time = cache_size + 1;
+    uint32_t input_cursor = 0;
+    size_t num_emitted_indices = 0;
+
+    if ( hard_boundaries )
+        hard_boundaries->push_back( 0 );
+
+    uint32_t fanning_vertex = indices[0];
+    while ( fanning_vertex != NoVertex )
+    {
+        // emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for ( uint32_t adjacency_idx = adjacency_offsets[fanning_vertex]; adjacency_idx < adjacency_offsets[fanning_vertex + 1]; ++adjacency_idx )
+        {
+            const uint32_t triangle = adjacency[adjacency_idx];
+            if ( emitted[triangle] )
+                continue;
+            emitted[triangle] = 1;
+
+            for ( uint32_t corner = 0; corner < 3; ++corner )
+            {
+                const uint32_t vertex = indices[triangle * 3 + corner];
+                dst[num_emitted_indices++] = vertex;
+                dead_ends.push_back( vertex );
+                candidates.push_back( vertex );
+                live_triangles[vertex]--;
+                if ( time - timestamps[vertex] > cache_size )
+                    timestamps[vertex] = time++;
+            }
+        }
+
+        // next fanning vertex is the one staying in the cache the longest while all its triangles are emitted
+        uint32_t next_vertex = NoVertex;
+        int64_t best_priority = -1;
+        for ( uint32_t vertex : candidates )
+        {
+            if ( live_triangles[vertex] == 0 )
+                continue;
+
+            int64_t priority = 0;
+            if ( int64_t( time - timestamps[vertex] ) + 2 * int64_t( live_triangles[vertex] ) <= int64_t( cache_size ) )
+                priority = int64_t( time - timestamps[vertex] );
+            if ( priority > best_priority )
+            {
+                best_priority = priority;
+                next_vertex = vertex;
+            }
+        }
+
+        if ( next_vertex == NoVertex )
+        {
+            // dead end: recently used vertices first, then the first vertex with triangles left
+            while ( !dead_ends.empty() && next_vertex == NoVertex )
+            {
+                const uint32_t vertex = dead_ends.back();
+                dead_ends.pop_back();
+                if ( live_triangles[vertex] > 0 )
+                    next_vertex = vertex;
+            }
+            for ( ; next_vertex == NoVertex && input_cursor < num_vertices; ++input_cursor )
+            {
+                if ( live_triangles[input_cursor] > 0 )
+                    next_vertex = input_cursor;
+            }
+
+            if ( next_vertex != NoVertex && hard_boundaries )
+                hard_boundaries->push_back( uint32_t( num_emitted_indices / 3 ) );
+        }
+
+        fanning_vertex = next_vertex;
+    }
+
+    assert( num_emitted_indices == num_indices );
+}
+
+void OptimizeOverdraw( uint32_t* dst, const uint32_t* indices, size_t num_indices, const float* positions, uint32_t num_vertices, size_t position_stride,
+                       const std::vector<uint32_t>& hard_boundaries, uint32_t cache_size, float threshold )
+{
+    assert( num_indices % 3 == 0 );
+    assert( dst != indices );
+
+    const uint32_t num_triangles = uint32_t( num_indices / 3 );
+    if ( num_triangles == 0 )
+        return;
+
+    // soft boundaries: a run is split once the part before the split is cache efficient enough on its own,
+    // so starting the next cluster with a cold cache costs little
+    std::vector<uint32_t> cluster_starts;
+    VertexCacheSimulator cache( num_vertices, cache_size );
+    const std::vector<uint32_t> run_starts = hard_boundaries.empty() ? std::vector<uint32_t>{ 0 } : hard_boundaries;
+    for ( size_t run_idx = 0; run_idx < run_starts.size(); ++run_idx )
+    {
+        const uint32_t run_begin = run_starts[run_idx];
+        const uint32_t run_end = run_idx + 1 < run_starts.size() ? run_starts[run_idx + 1] : num_triangles;
+        assert( run_begin < run_end && run_end <= num_triangles );
+
+        cache.Flush();
+        uint32_t run_misses = 0;
+        for ( uint32_t triangle = run_begin; triangle < run_end; ++triangle )
+            run_misses += cache.AccessTriangle( indices + triangle * 3 );
+        const float run_threshold = threshold * float( run_misses ) / float( run_end - run_begin );
+
+        cache.Flush();
+        cluster_starts.push_back( run_begin );
+        uint32_t cluster_begin = run_begin;
+        uint32_t cluster_misses = 0;
+        for ( uint32_t triangle = run_begin; triangle + 1 < run_end; ++triangle )
+        {
+            cluster_misses += cache.AccessTriangle( indices + triangle * 3 );
+            if ( float( cluster_misses ) <= run_threshold * float( triangle + 1 - cluster_begin ) )
+            {
+                cluster_begin = triangle + 1;
+                cluster_misses = 0;
+                cluster_starts.push_back( cluster_begin );
+                cache.Flush();
+            }
+        }
+    }
+
+    // area weighted centroids and normals
+    struct Cluster
+    {
+        uint32_t begin;
+        uint32_t end;
+        float centroid[3];
+        float normal[3];
+        float area;
+        float sort_key;
+    };
+    std::vector<Cluster> clusters( cluster_starts.size() );
+
+    double mesh_centroid[3] = {};
+    double mesh_area = 0.0;
+    for ( size_t cluster_idx = 0; cluster_idx < clusters.size(); ++cluster_idx )
+    {
+        Cluster& cluster = clusters[cluster_idx];
+        cluster = {};
+        cluster.begin = cluster_starts[cluster_idx];
+        cluster.end = cluster_idx + 1 < cluster_starts.size() ? cluster_starts[cluster_idx + 1] : num_triangles;
+
+        for ( uint32_t triangle = cluster.begin; triangle < cluster.end; ++triangle )
+        {
+            const float* p0 = Position( positions, position_stride, indices[triangle * 3 + 0] );
+            const float* p1 = Position( positions, position_stride, indices[triangle * 3 + 1] );
+            const float* p2 = Position( positions, position_stride, indices[triangle * 3 + 2] );
+
+            const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            const float area = std::sqrt( n[0] * n[0] + n[1] * n[1] + n[2] * n[2] );
+
+            for ( int axis = 0; axis < 3; ++axis )
+            {
+                cluster.centroid[axis] += area * ( p0[axis] + p1[axis] + p2[axis] ) / 3.0f;
+                cluster.normal[axis] += n[axis];
+            }
+            cluster.area += area;
+        }
+
+        for ( int axis = 0; axis < 3; ++axis )
+            mesh_centroid[axis] += cluster.centroid[axis];
+        mesh_area += cluster.area;
+
+        if ( cluster.area > 0.0f )
+            for ( float& coord : cluster.centroid )
+                coord /= cluster.area;
+    }
+
+    if ( mesh_area > 0.0 )
+        for ( double& coord : mesh_centroid )
+            coord /= mesh_area;
+
+    for ( Cluster& cluster : clusters )
+    {
+        const float normal_length = std::sqrt( cluster.normal[0] * cluster.normal[0] + cluster.normal[1] * cluster.normal[1] + cluster.normal[2] * cluster.normal[2] );
+        cluster.sort_key = 0.0f;
+        if ( normal_length > 0.0f )
+        {
+            for ( int axis = 0; axis < 3; ++axis )
+                cluster.sort_key += ( cluster.centroid[axis] - float( mesh_centroid[axis] ) ) * cluster.normal[axis] / normal_length;
+        }
+    }
+
+    std::stable_sort( clusters.begin(), clusters.end(), []( const Cluster& lhs, const Cluster& rhs ) { return lhs.sort_key > rhs.sort_key; } );
+
+    uint32_t* dst_triangle = dst;
+    for ( const Cluster& cluster : clusters )
+    {
+        const size_t cluster_indices = size_t( cluster.end - cluster.begin ) * 3;
+        memcpy( dst_triangle, indices + size_t( cluster.begin ) * 3, cluster_indices * sizeof( uint32_t ) );
+        dst_triangle += cluster_indices;
+    }
+}
+
+uint32_t OptimizeVertexFetchRemap( uint32_t* remap, const uint32_t* indices, size_t num_indices, uint32_t num_vertices )
+{
+    std::fill_n( remap, num_vertices, UnusedVertexRemap );
+
+    uint32_t next_vertex = 0;
+    for ( size_t i = 0; i < num_indices; ++i )
+    {
+        assert( indices[i] < num_vertices );
+        uint32_t& new_vertex = remap[indices[i]];
+        if ( new_vertex == UnusedVertexRemap )
+            new_vertex = next_vertex++;
+    }
+    return next_vertex;
+}
+
+void RemapIndices( uint32_t* indices, size_t num_indices, const uint32_t* remap )
+{
+    for ( size_t i = 0; i < num_indices; ++i )
+    {
+        assert( remap[indices[i]] != UnusedVertexRemap );
+        indices[i] = remap[indices[i]];
+    }
+}
+
+void RemapVertices( void* dst, const void* vertices, uint32_t num_vertices, size_t vertex_stride, const uint32_t* remap )
+{
+    assert( dst != vertices );
+
+    uint8_t* dst_bytes = static_cast<uint8_t*>( dst );
+    const uint8_t* src_bytes = static_cast<const uint8_t*>( vertices );
+    for ( uint32_t vertex = 0; vertex < num_vertices; ++vertex )
+    {
+        if ( remap[vertex] != UnusedVertexRemap )
+            memcpy( dst_bytes + size_t( remap[vertex] ) * vertex_stride, src_bytes + size_t( vertex ) * vertex_stride, vertex_stride );
+    }
+}
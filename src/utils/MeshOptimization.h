@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Reordering of indexed triangle lists for the GPU: post-transform vertex cache, overdraw and vertex fetch.
+// Self-contained like BVH.h, indices are uint32 and positions are float3 with an arbitrary byte stride.
+// Only the order of triangles and vertices changes, every triangle keeps its vertices and winding
+
+struct VertexCacheStats
+{
+    float acmr = 0.0f; // transformed vertices per triangle, 0.5 at best for regular meshes, 3 at worst
+    float atvr = 0.0f; // transformed vertices per referenced vertex, 1 is optimal
+    uint32_t transformed_vertices = 0;
+};
+
+// simulates a FIFO post-transform cache of cache_size vertices
+VertexCacheStats AnalyzeVertexCache( const uint32_t* indices, size_t num_indices, uint32_t num_vertices, uint32_t cache_size = 16 );
+
+// Bytes fetched from memory through a 16 KB direct-mapped cache with 64 byte lines, relative to the size of the referenced vertices.
+// 1 is optimal, every vertex is loaded once
+float AnalyzeVertexFetchOverfetch( const uint32_t* indices, size_t num_indices, uint32_t num_vertices, size_t vertex_stride );
+
+// Tipsify (Sander, Nehab, Barczak 2007), linear time. dst and indices must not overlap.
+// When hard_boundaries is set, it receives the first triangle of every run which had to restart from a dead end,
+// runs between them are independent for the cache and can be moved around by OptimizeOverdraw
+void OptimizeVertexCacheTipsify( uint32_t* dst, const uint32_t* indices, size_t num_indices, uint32_t num_vertices,
+                                 uint32_t cache_size = 16, std::vector<uint32_t>* hard_boundaries = nullptr );
+
+// Splits the cache optimized triangles into clusters and sorts the clusters so the ones facing away from the mesh center go first,
+// they are the most likely to occlude the rest. Clusters are only split where the ACMR of the parts stays below threshold * ACMR of the whole run.
+// indices must come from OptimizeVertexCacheTipsify with the same hard_boundaries. dst and indices must not overlap
+void OptimizeOverdraw( uint32_t* dst, const uint32_t* indices, size_t num_indices, const float* positions, uint32_t num_vertices, size_t position_stride,
+                       const std::vector<uint32_t>& hard_boundaries, uint32_t cache_size = 16, float threshold = 1.05f );
+
+// Numbers vertices in the order of their first use, so vertex fetch reads memory sequentially. remap[old_vertex] = new_vertex,
+// unreferenced vertices get UnusedVertexRemap. Returns the number of referenced vertices. Apply with RemapIndices and RemapVertices
+constexpr uint32_t UnusedVertexRemap = uint32_t( -1 );
+uint32_t OptimizeVertexFetchRemap( uint32_t* remap, const uint32_t* indices, size_t num_indices, uint32_t num_vertices );
+void RemapIndices( uint32_t* indices, size_t num_indices, const uint32_t* remap );
+// dst holds the referenced vertices, it must not overlap vertices
+void RemapVertices( void* dst, const void* vertices, uint32_t num_vertices, size_t vertex_stride, const uint32_t* remap );
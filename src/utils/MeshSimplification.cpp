@@ -0,0 +1,717 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "MeshSimplification.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace
+{
+    constexpr uint32_t NoVertex = uint32_t( -1 );
+    constexpr uint32_t MultipleVertices = uint32_t( -2 );
+
+    // border edges are weighted higher than triangles so silhouettes of open meshes erode last
+    constexpr float BorderEdgeWeight = 10.0f;
+    // a pass applies collapses up to this factor above the error of the collapse which would reach the target
+    constexpr float PassErrorBound = 1.5f;
+
+    struct Vec3
+    {
+        float x, y, z;
+    };
+
+    Vec3 operator-( const Vec3& l, const Vec3& r ) { return Vec3{ l.x - r.x, l.y - r.y, l.z - r.z }; }
+    float Dot( const Vec3& l, const Vec3& r ) { return l.x * r.x + l.y * r.y + l.z * r.z; }
+    Vec3 Cross( const Vec3& l, const Vec3& r ) { return Vec3{ l.y * r.z - l.z * r.y, l.z * r.x - l.x * r.z, l.x * r.y - l.y * r.x }; }
+    float Length( const Vec3& v ) { return std::sqrt( Dot( v, v ) ); }
+
+    const float* Element( const float* data, size_t stride, uint32_t vertex )
+    {
+        return reinterpret_cast<const float*>( reinterpret_cast<const uint8_t*>( data ) + vertex * stride );
+    }
+
+    // symmetric 4x4 form over ( p, 1 ): p^T A p + 2 b.p + c, averaged over the accumulated weight
+    struct Quadric
+    {
+        float a00 = 0, a11 = 0, a22 = 0, a10 = 0, a20 = 0, a21 = 0;
+        float b0 = 0, b1 = 0, b2 = 0;
+        float c = 0;
+        float w = 0;
+
+        void Add( const Quadric& other )
+        {
+            a00 += other.a00; a11 += other.a11; a22 += other.a22;
+            a10 += other.a10; a20 += other.a20; a21 += other.a21;
+            b0 += other.b0; b1 += other.b1; b2 += other.b2;
+            c += other.c;
+            w += other.w;
+        }
+
+        // squared distance to the plane n.p + d = 0 times weight, n is unit length
+        void AddPlane( const Vec3& n, float d, float weight )
+        {
+            a00 += weight * n.x * n.x; a11 += weight * n.y * n.y; a22 += weight * n.z * n.z;
+            a10 += weight * n.y * n.x; a20 += weight * n.z * n.x; a21 += weight * n.z * n.y;
+            b0 += weight * n.x * d; b1 += weight * n.y * d; b2 += weight * n.z * d;
+            c += weight * d * d;
+            w += weight;
+        }
+
+        float EvaluateUnnormalized( const Vec3& p ) const
+        {
+            const float rx = a00 * p.x + a10 * p.y + a20 * p.z;
+            const float ry = a10 * p.x + a11 * p.y + a21 * p.z;
+            const float rz = a20 * p.x + a21 * p.y + a22 * p.z;
+            return rx * p.x + ry * p.y + rz * p.z + 2.0f * ( b0 * p.x + b1 * p.y + b2 * p.z ) + c;
+        }
+
+        float Evaluate( const Vec3& p ) const
+        {
+            const float r = std::abs( EvaluateUnnormalized( p ) );
+            return w > 0.0f ? r / w : r;
+        }
+    };
+
+    // Per vertex attribute quadric: squared difference between the attribute of the vertex and the attribute interpolated
+    // over the original triangles at its position. For every attribute the gradient g and offset d of the linear interpolation
+    // are accumulated as sum( w * ( g.p + d - a )^2 ) = p^T A p + 2 b.p + c - 2 a sum( w ( g.p + d ) ) + a^2 sum( w ),
+    // the first part is stored in a Quadric. Stored as 4 floats of sum( w ( g, d ) ) and 1 float of sum( w ) per attribute
+    class AttributeQuadrics
+    {
+    public:
+        AttributeQuadrics( uint32_t num_vertices, uint32_t num_attributes )
+            : m_num_attributes( num_attributes ), m_quadrics( num_attributes > 0 ? num_vertices : 0 ), m_gradients( size_t( num_vertices ) * num_attributes * 5, 0.0f )
+        {}
+
+        bool Empty() const { return m_num_attributes == 0; }
+
+        void AddTriangle( const uint32_t* triangle, const Vec3* positions, const float* attributes, size_t attribute_stride, const float* weights )
+        {
+            const Vec3& p0 = positions[triangle[0]];
+            const Vec3 e1 = positions[triangle[1]] - p0;
+            const Vec3 e2 = positions[triangle[2]] - p0;
+            const float area = 0.5f * Length( Cross( e1, e2 ) );
+            const float d11 = Dot( e1, e1 );
+            const float d12 = Dot( e1, e2 );
+            const float d22 = Dot( e2, e2 );
+            const float det = d11 * d22 - d12 * d12;
+            if ( area <= 0.0f || std::abs( det ) <= std::numeric_limits<float>::min() )
+                return;
+
+            const float* a0 = Element( attributes, attribute_stride, triangle[0] );
+            const float* a1 = Element( attributes, attribute_stride, triangle[1] );
+            const float* a2 = Element( attributes, attribute_stride, triangle[2] );
+
+            Quadric quadric;
+            float contributions[MaxSimplificationAttributes * 5];
+            for ( uint32_t attribute = 0; attribute < m_num_attributes; ++attribute )
+            {
+                // gradient in the triangle plane: g.e1 = a1 - a0, g.e2 = a2 - a0
+                const float da1 = a1[attribute] - a0[attribute];
+                const float da2 = a2[attribute] - a0[attribute];
+                const float alpha = ( d22 * da1 - d12 * da2 ) / det;
+                const float beta = ( d11 * da2 - d12 * da1 ) / det;
+                const Vec3 g = Vec3{ alpha * e1.x + beta * e2.x, alpha * e1.y + beta * e2.y, alpha * e1.z + beta * e2.z };
+                const float d = a0[attribute] - Dot( g, p0 );
+                const float weight = area * weights[attribute];
+
+                quadric.a00 += weight * g.x * g.x; quadric.a11 += weight * g.y * g.y; quadric.a22 += weight * g.z * g.z;
+                quadric.a10 += weight * g.y * g.x; quadric.a20 += weight * g.z * g.x; quadric.a21 += weight * g.z * g.y;
+                quadric.b0 += weight * g.x * d; quadric.b1 += weight * g.y * d; quadric.b2 += weight * g.z * d;
+                quadric.c += weight * d * d;
+
+                float* contribution = contributions + attribute * 5;
+                contribution[0] = weight * g.x;
+                contribution[1] = weight * g.y;
+                contribution[2] = weight * g.z;
+                contribution[3] = weight * d;
+                contribution[4] = weight;
+            }
+            quadric.w = area;
+
+            for ( uint32_t corner = 0; corner < 3; ++corner )
+            {
+                m_quadrics[triangle[corner]].Add( quadric );
+                float* gradients = Gradients( triangle[corner] );
+                for ( uint32_t i = 0; i < m_num_attributes * 5; ++i )
+                    gradients[i] += contributions[i];
+            }
+        }
+
+        void Merge( uint32_t dst, uint32_t src )
+        {
+            m_quadrics[dst].Add( m_quadrics[src] );
+            float* dst_gradients = Gradients( dst );
+            const float* src_gradients = Gradients( src );
+            for ( uint32_t i = 0; i < m_num_attributes * 5; ++i )
+                dst_gradients[i] += src_gradients[i];
+        }
+
+        float Evaluate( uint32_t vertex, const Vec3& p, const float* attributes ) const
+        {
+            const Quadric& quadric = m_quadrics[vertex];
+            const float* gradients = m_gradients.data() + size_t( vertex ) * m_num_attributes * 5;
+
+            float r = quadric.EvaluateUnnormalized( p );
+            for ( uint32_t attribute = 0; attribute < m_num_attributes; ++attribute )
+            {
+                const float* g = gradients + attribute * 5;
+                const float a = attributes[attribute];
+                r += a * ( g[4] * a - 2.0f * ( g[0] * p.x + g[1] * p.y + g[2] * p.z + g[3] ) );
+            }
+            r = std::abs( r );
+            return quadric.w > 0.0f ? r / quadric.w : r;
+        }
+
+    private:
+        float* Gradients( uint32_t vertex ) { return m_gradients.data() + size_t( vertex ) * m_num_attributes * 5; }
+
+        uint32_t m_num_attributes;
+        std::vector<Quadric> m_quadrics;
+        std::vector<float> m_gradients;
+    };
+
+    // remap[v] is the first vertex with the same position, wedges[v] links vertices with the same position into a cycle
+    void BuildPositionRemap( std::vector<uint32_t>& remap, std::vector<uint32_t>& wedges, const float* positions, uint32_t num_vertices, size_t position_stride )
+    {
+        size_t table_size = 1;
+        while ( table_size < size_t( num_vertices ) * 2 )
+            table_size *= 2;
+        std::vector<uint32_t> table( table_size, NoVertex );
+
+        remap.resize( num_vertices );
+        wedges.resize( num_vertices );
+        for ( uint32_t vertex = 0; vertex < num_vertices; ++vertex )
+        {
+            const float* position = Element( positions, position_stride, vertex );
+            uint32_t bits[3];
+            memcpy( bits, position, sizeof( bits ) );
+            // mixed down to the low bits, round coordinates have their low mantissa bits all zero
+            uint32_t hash = ( bits[0] * 73856093u ) ^ ( bits[1] * 19349663u ) ^ ( bits[2] * 83492791u );
+            hash ^= hash >> 16;
+            hash *= 0x85ebca6bu;
+            hash ^= hash >> 13;
+            size_t slot = hash & ( table_size - 1 );
+            while ( table[slot] != NoVertex && memcmp( Element( positions, position_stride, table[slot] ), position, sizeof( float ) * 3 ) != 0 )
+                slot = ( slot + 1 ) & ( table_size - 1 );
+
+            if ( table[slot] == NoVertex )
+            {
+                table[slot] = vertex;
+                remap[vertex] = vertex;
+                wedges[vertex] = vertex;
+            }
+            else
+            {
+                const uint32_t first = table[slot];
+                remap[vertex] = first;
+                wedges[vertex] = wedges[first];
+                wedges[first] = vertex;
+            }
+        }
+    }
+
+    // compressed lists of triangles around every vertex
+    struct TriangleAdjacency
+    {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+
+        void Build( const uint32_t* indices, size_t num_indices, const uint32_t* remap, uint32_t num_vertices )
+        {
+            offsets.assign( num_vertices + 1, 0 );
+            for ( size_t i = 0; i < num_indices; ++i )
+                offsets[remap[indices[i]] + 1]++;
+            for ( uint32_t vertex = 0; vertex < num_vertices; ++vertex )
+                offsets[vertex + 1] += offsets[vertex];
+
+            triangles.resize( num_indices );
+            std::vector<uint32_t> fill( offsets.begin(), offsets.end() - 1 );
+            for ( size_t i = 0; i < num_indices; ++i )
+                triangles[fill[remap[indices[i]]]++] = uint32_t( i / 3 );
+        }
+
+        const uint32_t* begin( uint32_t vertex ) const { return triangles.data() + offsets[vertex]; }
+        const uint32_t* end( uint32_t vertex ) const { return triangles.data() + offsets[vertex + 1]; }
+    };
+
+    enum class VertexKind : uint8_t
+    {
+        Manifold, // any collapse
+        Border, // single wedge on an open border, collapses along the border
+        Seam, // two wedges on an attribute seam, collapses along the seam together
+        Locked // non-manifold, seam crossings and corners, vertex_lock
+    };
+
+    struct Collapse
+    {
+        uint32_t from;
+        uint32_t to;
+        float error; // geometric and attribute error, used for ordering
+        float geometric_error;
+    };
+
+    // Counting sort on the top bits of the non negative errors, exponent and 4 bits of mantissa.
+    // Linear and within 1/16 of the exact order, which is below the slack of PassErrorBound
+    void SortCollapses( std::vector<Collapse>& sorted, const std::vector<Collapse>& collapses )
+    {
+        constexpr uint32_t KeyBits = 12;
+        auto key = []( float error )
+        {
+            uint32_t bits;
+            std::memcpy( &bits, &error, sizeof( bits ) );
+            return ( bits >> ( 31 - KeyBits ) ) & ( ( 1u << KeyBits ) - 1 );
+        };
+
+        std::vector<uint32_t> offsets( ( 1u << KeyBits ) + 1, 0 );
+        for ( const Collapse& collapse : collapses )
+            offsets[key( collapse.error ) + 1]++;
+        for ( size_t bucket = 1; bucket < offsets.size(); ++bucket )
+            offsets[bucket] += offsets[bucket - 1];
+
+        sorted.resize( collapses.size() );
+        for ( const Collapse& collapse : collapses )
+            sorted[offsets[key( collapse.error )]++] = collapse;
+    }
+}
+
+size_t SimplifyMesh( uint32_t* dst, const uint32_t* indices, size_t num_indices, const float* positions, uint32_t num_vertices, size_t position_stride,
+                     size_t target_index_count, float target_error, float* result_error,
+                     const float* attributes, size_t attribute_stride, const float* attribute_weights, uint32_t num_attributes,
+                     const uint8_t* vertex_lock )
+{
+    assert( num_indices % 3 == 0 );
+    assert( num_attributes <= MaxSimplificationAttributes );
+    if ( attributes == nullptr )
+        num_attributes = 0;
+
+    std::vector<uint32_t> remap;
+    std::vector<uint32_t> wedges;
+    BuildPositionRemap( remap, wedges, positions, num_vertices, position_stride );
+
+    // triangles which are degenerate by position can't be part of the topology
+    std::vector<uint32_t> result;
+    result.reserve( num_indices );
+    for ( size_t i = 0; i < num_indices; i += 3 )
+    {
+        const uint32_t r0 = remap[indices[i]], r1 = remap[indices[i + 1]], r2 = remap[indices[i + 2]];
+        if ( r0 != r1 && r0 != r2 && r1 != r2 )
+            result.insert( result.end(), { indices[i], indices[i + 1], indices[i + 2] } );
+    }
+
+    // unit extent, so attribute weights and error bounds don't depend on the mesh scale
+    Vec3 bounds_min = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    Vec3 bounds_max = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+    for ( uint32_t index : result )
+    {
+        const float* p = Element( positions, position_stride, index );
+        bounds_min = Vec3{ std::min( bounds_min.x, p[0] ), std::min( bounds_min.y, p[1] ), std::min( bounds_min.z, p[2] ) };
+        bounds_max = Vec3{ std::max( bounds_max.x, p[0] ), std::max( bounds_max.y, p[1] ), std::max( bounds_max.z, p[2] ) };
+    }
+    float extent = std::max( { bounds_max.x - bounds_min.x, bounds_max.y - bounds_min.y, bounds_max.z - bounds_min.z } );
+    extent = extent > 0.0f ? extent : 1.0f;
+    const float inv_extent = 1.0f / extent;
+
+    std::vector<Vec3> scaled_positions( num_vertices );
+    for ( uint32_t vertex = 0; vertex < num_vertices; ++vertex )
+    {
+        const float* p = Element( positions, position_stride, vertex );
+        scaled_positions[vertex] = Vec3{ ( p[0] - bounds_min.x ) * inv_extent, ( p[1] - bounds_min.y ) * inv_extent, ( p[2] - bounds_min.z ) * inv_extent };
+    }
+
+    // open edges: open_out[v] = t for a half-edge v->t without a t->v twin, open_in[t] = v. Per wedge, so attribute seams are open too
+    std::vector<uint32_t> open_out( num_vertices, NoVertex );
+    std::vector<uint32_t> open_in( num_vertices, NoVertex );
+    {
+        TriangleAdjacency wedge_adjacency;
+        std::vector<uint32_t> identity( num_vertices );
+        for ( uint32_t vertex = 0; vertex < num_vertices; ++vertex )
+            identity[vertex] = vertex;
+        wedge_adjacency.Build( result.data(), result.size(), identity.data(), num_vertices );
+
+        auto has_edge = [&]( uint32_t from, uint32_t to )
+        {
+            for ( const uint32_t* triangle = wedge_adjacency.begin( from ); triangle != wedge_adjacency.end( from ); ++triangle )
+            {
+                const uint32_t* corners = result.data() + size_t( *triangle ) * 3;
+                for ( uint32_t corner = 0; corner < 3; ++corner )
+                    if ( corners[corner] == from && corners[( corner + 1 ) % 3] == to )
+                        return true;
+            }
+            return false;
+        };
+
+        for ( size_t i = 0; i < result.size(); ++i )
+        {
+            const uint32_t from = result[i];
+            const uint32_t to = result[i - i % 3 + ( i + 1 ) % 3];
+            if ( has_edge( to, from ) )
+                continue;
+            open_out[from] = open_out[from] == NoVertex ? to : MultipleVertices;
+            open_in[to] = open_in[to] == NoVertex ? from : MultipleVertices;
+        }
+    }
+
+    auto is_single = []( uint32_t vertex ) { return vertex != NoVertex && vertex != MultipleVertices; };
+
+    std::vector<VertexKind> kinds( num_vertices, VertexKind::Locked );
+    for ( uint32_t vertex = 0; vertex < num_vertices; ++vertex )
+    {
+        if ( remap[vertex] != vertex )
+            continue;
+
+        VertexKind kind = VertexKind::Locked;
+        const uint32_t wedge = wedges[vertex];
+        if ( wedge == vertex )
+        {
+            if ( open_out[vertex] == NoVertex && open_in[vertex] == NoVertex )
+                kind = VertexKind::Manifold;
+            // a seam ending at the vertex has both open edges going to the same position
+            else if ( is_single( open_out[vertex] ) && is_single( open_in[vertex] ) && remap[open_out[vertex]] != remap[open_in[vertex]] )
+                kind = VertexKind::Border;
+        }
+        else if ( wedges[wedge] == vertex )
+        {
+            // the two sides of a seam run in opposite directions
+            const uint32_t out_v = open_out[vertex], in_v = open_in[vertex], out_w = open_out[wedge], in_w = open_in[wedge];
+            if ( is_single( out_v ) && is_single( in_v ) && is_single( out_w ) && is_single( in_w )
+                 && remap[out_v] == remap[in_w] && remap[in_v] == remap[out_w] && remap[out_v] != remap[in_v] )
+                kind = VertexKind::Seam;
+        }
+
+        uint32_t w = vertex;
+        do
+        {
+            if ( vertex_lock != nullptr && vertex_lock[w] != 0 )
+                kind = VertexKind::Locked;
+            w = wedges[w];
+        } while ( w != vertex );
+        kinds[vertex] = kind;
+    }
+
+    std::vector<Quadric> quadrics( num_vertices );
+    AttributeQuadrics attribute_quadrics( num_vertices, num_attributes );
+    for ( size_t i = 0; i < result.size(); i += 3 )
+    {
+        const uint32_t* triangle = result.data() + i;
+        const Vec3& p0 = scaled_positions[triangle[0]];
+        const Vec3& p1 = scaled_positions[triangle[1]];
+        const Vec3& p2 = scaled_positions[triangle[2]];
+        const Vec3 normal = Cross( p1 - p0, p2 - p0 );
+        const float double_area = Length( normal );
+        if ( double_area > 0.0f )
+        {
+            const Vec3 n = Vec3{ normal.x / double_area, normal.y / double_area, normal.z / double_area };
+            Quadric quadric;
+            quadric.AddPlane( n, -Dot( n, p0 ), 0.5f * double_area );
+            for ( uint32_t corner = 0; corner < 3; ++corner )
+                quadrics[remap[triangle[corner]]].Add( quadric );
+
+            // border edges get a plane through them perpendicular to the triangle
+            for ( uint32_t corner = 0; corner < 3; ++corner )
+            {
+                const uint32_t from = triangle[corner];
+                const uint32_t to = triangle[( corner + 1 ) % 3];
+                if ( open_out[from] != to || kinds[remap[from]] == VertexKind::Seam )
+                    continue;
+
+                const Vec3 edge = scaled_positions[to] - scaled_positions[from];
+                const float edge_length = Length( edge );
+                const Vec3 edge_normal = Cross( edge, n );
+                const float edge_normal_length = Length( edge_normal );
+                if ( edge_normal_length <= 0.0f )
+                    continue;
+
+                const Vec3 m = Vec3{ edge_normal.x / edge_normal_length, edge_normal.y / edge_normal_length, edge_normal.z / edge_normal_length };
+                Quadric edge_quadric;
+                edge_quadric.AddPlane( m, -Dot( m, scaled_positions[from] ), BorderEdgeWeight * edge_length * edge_length );
+                quadrics[remap[from]].Add( edge_quadric );
+                quadrics[remap[to]].Add( edge_quadric );
+            }
+        }
+
+        if ( !attribute_quadrics.Empty() )
+            attribute_quadrics.AddTriangle( triangle, scaled_positions.data(), attributes, attribute_stride, attribute_weights );
+    }
+
+    // wedge of the target position which continues the seam of the other wedge of from
+    auto get_seam_partner = [&]( uint32_t from, uint32_t to, uint32_t& partner_from, uint32_t& partner_to )
+    {
+        partner_from = wedges[from];
+        partner_to = to == open_out[from] ? open_in[partner_from] : open_out[partner_from];
+        return is_single( partner_to ) && remap[partner_to] == remap[to] && partner_to != to;
+    };
+
+    auto can_collapse = [&]( uint32_t from, uint32_t to )
+    {
+        const VertexKind from_kind = kinds[remap[from]];
+        const VertexKind to_kind = kinds[remap[to]];
+        switch ( from_kind )
+        {
+        case VertexKind::Manifold:
+            return true;
+        case VertexKind::Border:
+            return ( to_kind == VertexKind::Border || to_kind == VertexKind::Locked ) && ( open_out[from] == to || open_in[from] == to );
+        case VertexKind::Seam:
+        {
+            uint32_t partner_from, partner_to;
+            return ( to_kind == VertexKind::Seam || to_kind == VertexKind::Locked ) && ( open_out[from] == to || open_in[from] == to )
+                && get_seam_partner( from, to, partner_from, partner_to );
+        }
+        default:
+            return false;
+        }
+    };
+
+    auto evaluate = [&]( uint32_t from, uint32_t to, Collapse& collapse )
+    {
+        const Vec3& p = scaled_positions[to];
+        collapse.from = from;
+        collapse.to = to;
+        collapse.geometric_error = quadrics[remap[from]].Evaluate( p );
+        collapse.error = collapse.geometric_error;
+        if ( !attribute_quadrics.Empty() )
+        {
+            collapse.error += attribute_quadrics.Evaluate( from, p, Element( attributes, attribute_stride, to ) );
+            uint32_t partner_from, partner_to;
+            if ( kinds[remap[from]] == VertexKind::Seam && get_seam_partner( from, to, partner_from, partner_to ) )
+                collapse.error += attribute_quadrics.Evaluate( partner_from, p, Element( attributes, attribute_stride, partner_to ) );
+        }
+    };
+
+    // Triangles around from which stay must not turn over. The link condition keeps the mesh manifold:
+    // positions next to both ends must be the third corners of the triangles on the edge, otherwise the collapse folds the surface
+    TriangleAdjacency adjacency;
+    std::vector<uint32_t> from_neighbours;
+    auto is_collapse_valid = [&]( uint32_t from, uint32_t to )
+    {
+        const uint32_t from_position = remap[from];
+        const uint32_t to_position = remap[to];
+
+        from_neighbours.clear();
+        uint32_t edge_triangles = 0;
+        for ( const uint32_t* triangle = adjacency.begin( from_position ); triangle != adjacency.end( from_position ); ++triangle )
+        {
+            const uint32_t* corners = result.data() + size_t( *triangle ) * 3;
+            Vec3 p[3];
+            Vec3 moved[3];
+            bool collapses = false;
+            for ( uint32_t corner = 0; corner < 3; ++corner )
+            {
+                const uint32_t position = remap[corners[corner]];
+                collapses |= position == to_position;
+                if ( position != from_position && position != to_position )
+                    from_neighbours.push_back( position );
+                p[corner] = scaled_positions[corners[corner]];
+                moved[corner] = position == from_position ? scaled_positions[to] : p[corner];
+            }
+            if ( collapses )
+            {
+                edge_triangles++;
+                continue;
+            }
+
+            const Vec3 normal = Cross( p[1] - p[0], p[2] - p[0] );
+            const Vec3 moved_normal = Cross( moved[1] - moved[0], moved[2] - moved[0] );
+            if ( Dot( normal, moved_normal ) <= 0.0f )
+                return false;
+        }
+        std::sort( from_neighbours.begin(), from_neighbours.end() );
+        from_neighbours.erase( std::unique( from_neighbours.begin(), from_neighbours.end() ), from_neighbours.end() );
+
+        uint32_t shared_neighbours = 0;
+        for ( const uint32_t* triangle = adjacency.begin( to_position ); triangle != adjacency.end( to_position ); ++triangle )
+        {
+            const uint32_t* corners = result.data() + size_t( *triangle ) * 3;
+            for ( uint32_t corner = 0; corner < 3; ++corner )
+            {
+                const uint32_t position = remap[corners[corner]];
+                auto it = std::lower_bound( from_neighbours.begin(), from_neighbours.end(), position );
+                if ( it != from_neighbours.end() && *it == position )
+                {
+                    // each shared position is counted once
+                    from_neighbours.erase( it );
+                    shared_neighbours++;
+                }
+            }
+        }
+        return shared_neighbours == edge_triangles;
+    };
+
+    const float error_limit = target_error * inv_extent * target_error * inv_extent;
+    float max_geometric_error = 0.0f;
+
+    // positions around applied collapses, per pass
+    std::vector<uint8_t> pass_locked( num_vertices, 0 );
+    std::vector<uint32_t> collapse_remap( num_vertices );
+    std::vector<Collapse> collapses;
+    std::vector<Collapse> sorted_collapses;
+
+    while ( result.size() > target_index_count )
+    {
+        adjacency.Build( result.data(), result.size(), remap.data(), num_vertices );
+
+        // one candidate per edge, interior edges are seen from both triangles
+        collapses.clear();
+        for ( size_t i = 0; i < result.size(); ++i )
+        {
+            const uint32_t v0 = result[i];
+            const uint32_t v1 = result[i - i % 3 + ( i + 1 ) % 3];
+            const VertexKind kind0 = kinds[remap[v0]];
+            const bool has_twin = kind0 == VertexKind::Manifold || ( kind0 != VertexKind::Locked && open_out[v0] != v1 );
+            if ( has_twin && remap[v0] > remap[v1] )
+                continue;
+
+            Collapse best = { NoVertex, NoVertex, std::numeric_limits<float>::max(), 0.0f };
+            Collapse candidate;
+            if ( can_collapse( v0, v1 ) )
+            {
+                evaluate( v0, v1, candidate );
+                best = candidate;
+            }
+            if ( can_collapse( v1, v0 ) )
+            {
+                evaluate( v1, v0, candidate );
+                if ( candidate.error < best.error )
+                    best = candidate;
+            }
+            if ( best.from != NoVertex )
+                collapses.push_back( best );
+        }
+        if ( collapses.empty() )
+            break;
+
+        SortCollapses( sorted_collapses, collapses );
+
+        // an edge collapse removes two triangles in the interior
+        const size_t triangle_goal = ( result.size() - target_index_count ) / 3;
+        // invalid candidates don't count towards the goal, so the bound moves past them
+        size_t goal_candidate = triangle_goal / 2;
+        auto pass_error_limit = [&]()
+        {
+            return goal_candidate < sorted_collapses.size() ? sorted_collapses[goal_candidate].error * PassErrorBound : std::numeric_limits<float>::max();
+        };
+
+        std::fill( pass_locked.begin(), pass_locked.end(), 0 );
+        for ( uint32_t vertex = 0; vertex < num_vertices; ++vertex )
+            collapse_remap[vertex] = vertex;
+
+        size_t removed_triangles = 0;
+        size_t applied_collapses = 0;
+        for ( const Collapse& collapse : sorted_collapses )
+        {
+            if ( collapse.error > pass_error_limit() || removed_triangles >= std::max<size_t>( triangle_goal, 1 ) )
+                break;
+            if ( collapse.geometric_error > error_limit )
+            {
+                goal_candidate++;
+                continue;
+            }
+
+            const uint32_t from_position = remap[collapse.from];
+            const uint32_t to_position = remap[collapse.to];
+            // triangles around a locked vertex changed this pass, adjacency and candidates don't see that
+            if ( pass_locked[from_position] || pass_locked[to_position] )
+                continue;
+            if ( !is_collapse_valid( collapse.from, collapse.to ) )
+            {
+                goal_candidate++;
+                continue;
+            }
+
+            collapse_remap[collapse.from] = collapse.to;
+            if ( !attribute_quadrics.Empty() )
+                attribute_quadrics.Merge( collapse.to, collapse.from );
+            if ( kinds[from_position] == VertexKind::Seam )
+            {
+                uint32_t partner_from, partner_to;
+                get_seam_partner( collapse.from, collapse.to, partner_from, partner_to );
+                collapse_remap[partner_from] = partner_to;
+                if ( !attribute_quadrics.Empty() )
+                    attribute_quadrics.Merge( partner_to, partner_from );
+            }
+            quadrics[to_position].Add( quadrics[from_position] );
+
+            // keep border and seam loops linked around the removed vertex
+            uint32_t w = collapse.from;
+            do
+            {
+                const uint32_t target = collapse_remap[w];
+                if ( kinds[from_position] != VertexKind::Manifold && target != w )
+                {
+                    if ( open_out[w] == target && is_single( open_in[w] ) )
+                    {
+                        open_out[open_in[w]] = target;
+                        open_in[target] = open_in[w];
+                    }
+                    else if ( open_in[w] == target && is_single( open_out[w] ) )
+                    {
+                        open_in[open_out[w]] = target;
+                        open_out[target] = open_out[w];
+                    }
+                }
+                w = wedges[w];
+            } while ( w != collapse.from );
+
+            for ( const uint32_t* triangle = adjacency.begin( from_position ); triangle != adjacency.end( from_position ); ++triangle )
+            {
+                const uint32_t* corners = result.data() + size_t( *triangle ) * 3;
+                bool collapses_triangle = false;
+                for ( uint32_t corner = 0; corner < 3; ++corner )
+                {
+                    const uint32_t position = remap[corners[corner]];
+                    collapses_triangle |= position == to_position;
+                    pass_locked[position] = 1;
+                }
+                removed_triangles += collapses_triangle ? 1 : 0;
+            }
+
+            max_geometric_error = std::max( max_geometric_error, collapse.geometric_error );
+            applied_collapses++;
+        }
+        if ( applied_collapses == 0 )
+            break;
+
+        size_t write = 0;
+        for ( size_t i = 0; i < result.size(); i += 3 )
+        {
+            const uint32_t v0 = collapse_remap[result[i]], v1 = collapse_remap[result[i + 1]], v2 = collapse_remap[result[i + 2]];
+            const uint32_t r0 = remap[v0], r1 = remap[v1], r2 = remap[v2];
+            if ( r0 == r1 || r0 == r2 || r1 == r2 )
+                continue;
+            result[write++] = v0;
+            result[write++] = v1;
+            result[write++] = v2;
+        }
+        result.resize( write );
+    }
+
+    if ( result_error != nullptr )
+        *result_error = std::sqrt( max_geometric_error ) * extent;
+
+    std::copy( result.begin(), result.end(), dst );
+    return result.size();
+}
+
+float GetLODProjectionScale( float fov_y, float viewport_height )
+{
+    return viewport_height / ( 2.0f * std::tan( fov_y * 0.5f ) );
+}
+
+uint32_t SelectLOD( const float* lod_errors, uint32_t num_lods, float distance, float projection_scale, float max_pixel_error )
+{
+    // inside the bounds every LOD is infinitely large on screen
+    if ( distance <= 0.0f )
+        return 0;
+
+    const float max_error = max_pixel_error * distance / projection_scale;
+    for ( uint32_t lod = num_lods; lod > 1; --lod )
+        if ( lod_errors[lod - 1] <= max_error )
+            return lod - 1;
+    return 0;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Quadric error edge collapse (Garland, Heckbert 1997) with attribute quadrics (Hoppe 1999).
+// Self-contained like MeshOptimization.h: indices are uint32, positions and attributes are floats with an arbitrary byte stride.
+// Collapses move a vertex onto one of its neighbours, so the vertex buffer is shared by all LODs and only indices change.
+// Vertices with the same position are welded for topology: open borders and attribute seams only collapse along themselves
+// and stay closed, closed meshes stay closed
+
+// attributes: num_attributes floats per vertex, each weighted by attribute_weights relative to squared distances
+// on the mesh scaled to a unit extent. At most MaxSimplificationAttributes
+constexpr uint32_t MaxSimplificationAttributes = 8;
+
+// Writes at most num_indices indices into dst, which may be the same as indices. Stops at target_index_count or
+// once the next collapse would deviate more than target_error from the input surface, in mesh units.
+// result_error receives the largest deviation introduced. Vertices with vertex_lock set never move
+size_t SimplifyMesh( uint32_t* dst, const uint32_t* indices, size_t num_indices, const float* positions, uint32_t num_vertices, size_t position_stride,
+                     size_t target_index_count, float target_error, float* result_error = nullptr,
+                     const float* attributes = nullptr, size_t attribute_stride = 0, const float* attribute_weights = nullptr, uint32_t num_attributes = 0,
+                     const uint8_t* vertex_lock = nullptr );
+
+// Converts an error in world units at a distance to pixels: viewport_height / ( 2 * tan( fov_y / 2 ) )
+float GetLODProjectionScale( float fov_y, float viewport_height );
+
+// lod_errors grow with the LOD index, LOD 0 is the full mesh. Returns the coarsest LOD with a projected error below max_pixel_error
+uint32_t SelectLOD( const float* lod_errors, uint32_t num_lods, float distance, float projection_scale, float max_pixel_error );
@@ -0,0 +1,184 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    constexpr uint8_t NoLocalVertex = 0xff;
+
+    const float* Position( const float* positions, size_t position_stride, uint32_t vertex )
+    {
+        return reinterpret_cast<const float*>( reinterpret_cast<const uint8_t*>( positions ) + vertex * position_stride );
+    }
+
+    void FinishMeshlet( Meshlet& meshlet, std::vector<uint32_t>& meshlet_vertices, std::vector<uint8_t>& meshlet_triangles, std::vector<uint8_t>& local_indices )
+    {
+        for ( uint32_t i = 0; i < meshlet.num_vertices; ++i )
+            local_indices[meshlet_vertices[meshlet.vertex_offset + i]] = NoLocalVertex;
+        meshlet_triangles.resize( ( meshlet_triangles.size() + 3 ) & ~size_t( 3 ), 0 );
+    }
+}
+
+void BuildMeshlets( std::vector<Meshlet>& meshlets, std::vector<uint32_t>& meshlet_vertices, std::vector<uint8_t>& meshlet_triangles,
+                    const uint32_t* indices, size_t num_indices, uint32_t num_vertices, uint32_t max_vertices, uint32_t max_triangles )
+{
+    assert( num_indices % 3 == 0 );
+    assert( max_vertices >= 3 && max_vertices < NoLocalVertex && max_triangles > 0 );
+
+    // local index of every vertex in the current meshlet
+    std::vector<uint8_t> local_indices( num_vertices, NoLocalVertex );
+    meshlet_triangles.resize( ( meshlet_triangles.size() + 3 ) & ~size_t( 3 ), 0 );
+
+    Meshlet meshlet;
+    meshlet.vertex_offset = uint32_t( meshlet_vertices.size() );
+    meshlet.triangle_offset = uint32_t( meshlet_triangles.size() );
+    for ( size_t i = 0; i < num_indices; i += 3 )
+    {
+        const uint32_t* triangle = indices + i;
+        const uint32_t new_vertices = uint32_t( local_indices[triangle[0]] == NoLocalVertex )
+            + uint32_t( local_indices[triangle[1]] == NoLocalVertex && triangle[1] != triangle[0] )
+            + uint32_t( local_indices[triangle[2]] == NoLocalVertex && triangle[2] != triangle[0] && triangle[2] != triangle[1] );
+
+        if ( meshlet.num_vertices + new_vertices > max_vertices || meshlet.num_triangles == max_triangles )
+        {
+            FinishMeshlet( meshlet, meshlet_vertices, meshlet_triangles, local_indices );
+            meshlets.push_back( meshlet );
+
+            meshlet = Meshlet{};
+            meshlet.vertex_offset = uint32_t( meshlet_vertices.size() );
+            meshlet.triangle_offset = uint32_t( meshlet_triangles.size() );
+        }
+
+        for ( uint32_t corner = 0; corner < 3; ++corner )
+        {
+            uint8_t& local = local_indices[triangle[corner]];
+            if ( local == NoLocalVertex )
+            {
+                local = uint8_t( meshlet.num_vertices++ );
+                meshlet_vertices.push_back( triangle[corner] );
+            }
+            meshlet_triangles.push_back( local );
+        }
+        meshlet.num_triangles++;
+    }
+
+    if ( meshlet.num_triangles > 0 )
+    {
+        FinishMeshlet( meshlet, meshlet_vertices, meshlet_triangles, local_indices );
+        meshlets.push_back( meshlet );
+    }
+}
+
+MeshletBounds ComputeMeshletBounds( const Meshlet& meshlet, const uint32_t* meshlet_vertices, const uint8_t* meshlet_triangles,
+                                    const float* positions, size_t position_stride )
+{
+    MeshletBounds bounds;
+    if ( meshlet.num_vertices == 0 )
+        return bounds;
+
+    // sphere around the box center
+    float box_min[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    float box_max[3] = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+    for ( uint32_t i = 0; i < meshlet.num_vertices; ++i )
+    {
+        const float* p = Position( positions, position_stride, meshlet_vertices[meshlet.vertex_offset + i] );
+        for ( int axis = 0; axis < 3; ++axis )
+        {
+            box_min[axis] = std::min( box_min[axis], p[axis] );
+            box_max[axis] = std::max( box_max[axis], p[axis] );
+        }
+    }
+    for ( int axis = 0; axis < 3; ++axis )
+        bounds.center[axis] = ( box_min[axis] + box_max[axis] ) * 0.5f;
+
+    float radius_sq = 0.0f;
+    for ( uint32_t i = 0; i < meshlet.num_vertices; ++i )
+    {
+        const float* p = Position( positions, position_stride, meshlet_vertices[meshlet.vertex_offset + i] );
+        const float d[3] = { p[0] - bounds.center[0], p[1] - bounds.center[1], p[2] - bounds.center[2] };
+        radius_sq = std::max( radius_sq, d[0] * d[0] + d[1] * d[1] + d[2] * d[2] );
+    }
+    bounds.radius = std::sqrt( radius_sq );
+
+    // cone axis is the average of unit normals, cutoff comes from the normal furthest from it. Degenerate triangles have zero normals
+    std::vector<float> normals( meshlet.num_triangles * 3, 0.0f );
+    float axis[3] = {};
+    for ( uint32_t triangle = 0; triangle < meshlet.num_triangles; ++triangle )
+    {
+        const uint8_t* local = meshlet_triangles + meshlet.triangle_offset + triangle * 3;
+        const float* p0 = Position( positions, position_stride, meshlet_vertices[meshlet.vertex_offset + local[0]] );
+        const float* p1 = Position( positions, position_stride, meshlet_vertices[meshlet.vertex_offset + local[1]] );
+        const float* p2 = Position( positions, position_stride, meshlet_vertices[meshlet.vertex_offset + local[2]] );
+
+        const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+        const float length = std::sqrt( n[0] * n[0] + n[1] * n[1] + n[2] * n[2] );
+        if ( length <= 0.0f )
+            continue;
+
+        for ( int i = 0; i < 3; ++i )
+        {
+            normals[triangle * 3 + i] = n[i] / length;
+            axis[i] += n[i] / length;
+        }
+    }
+
+    const float axis_length = std::sqrt( axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] );
+    if ( axis_length <= 0.0f )
+    {
+        std::copy( bounds.center, bounds.center + 3, bounds.cone_apex );
+        return bounds;
+    }
+    for ( int i = 0; i < 3; ++i )
+        bounds.cone_axis[i] = axis[i] / axis_length;
+
+    float min_dot = 1.0f;
+    for ( uint32_t triangle = 0; triangle < meshlet.num_triangles; ++triangle )
+    {
+        const float* n = normals.data() + triangle * 3;
+        if ( n[0] != 0.0f || n[1] != 0.0f || n[2] != 0.0f )
+            min_dot = std::min( min_dot, n[0] * bounds.cone_axis[0] + n[1] * bounds.cone_axis[1] + n[2] * bounds.cone_axis[2] );
+    }
+
+    // the apex is pushed back along the axis until it is behind the plane of every triangle
+    float max_t = 0.0f;
+    if ( min_dot > 0.0f )
+    {
+        for ( uint32_t triangle = 0; triangle < meshlet.num_triangles; ++triangle )
+        {
+            const float* n = normals.data() + triangle * 3;
+            const uint8_t* local = meshlet_triangles + meshlet.triangle_offset + triangle * 3;
+            const float* p0 = Position( positions, position_stride, meshlet_vertices[meshlet.vertex_offset + local[0]] );
+            const float dc = ( bounds.center[0] - p0[0] ) * n[0] + ( bounds.center[1] - p0[1] ) * n[1] + ( bounds.center[2] - p0[2] ) * n[2];
+            const float dn = bounds.cone_axis[0] * n[0] + bounds.cone_axis[1] * n[1] + bounds.cone_axis[2] * n[2];
+            if ( dn > 0.0f )
+                max_t = std::max( max_t, dc / dn );
+        }
+        bounds.cone_cutoff = std::sqrt( std::max( 0.0f, 1.0f - min_dot * min_dot ) );
+    }
+
+    for ( int i = 0; i < 3; ++i )
+        bounds.cone_apex[i] = bounds.center[i] - bounds.cone_axis[i] * max_t;
+
+    return bounds;
+}
+
+bool IsMeshletBackfacing( const MeshletBounds& bounds, const float camera_position[3] )
+{
+    if ( bounds.cone_cutoff >= 1.0f )
+        return false;
+
+    const float d[3] = { bounds.cone_apex[0] - camera_position[0], bounds.cone_apex[1] - camera_position[1], bounds.cone_apex[2] - camera_position[2] };
+    const float length = std::sqrt( d[0] * d[0] + d[1] * d[1] + d[2] * d[2] );
+    if ( length <= 0.0f )
+        return false;
+
+    return ( d[0] * bounds.cone_axis[0] + d[1] * bounds.cone_axis[1] + d[2] * bounds.cone_axis[2] ) >= bounds.cone_cutoff * length;
+}
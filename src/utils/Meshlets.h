@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Clusters of triangles for mesh shaders and cluster culling.
+// Self-contained like MeshOptimization.h, indices are uint32 and positions are float3 with an arbitrary byte stride
+
+// 124 triangles keep the local index block of a meshlet within 372 bytes, 64 vertices fit one wave of outputs
+constexpr uint32_t MaxMeshletVertices = 64;
+constexpr uint32_t MaxMeshletTriangles = 124;
+
+struct Meshlet
+{
+    uint32_t vertex_offset = 0; // into meshlet_vertices
+    uint32_t triangle_offset = 0; // into meshlet_triangles, a multiple of 4
+    uint32_t num_vertices = 0;
+    uint32_t num_triangles = 0;
+};
+
+// Culling data. The meshlet is behind the camera for every triangle when
+// dot( normalize( cone_apex - camera ), cone_axis ) >= cone_cutoff, see IsMeshletBackfacing
+struct MeshletBounds
+{
+    float center[3] = {};
+    float radius = 0.0f;
+    float cone_apex[3] = {};
+    float cone_axis[3] = {};
+    float cone_cutoff = 1.0f; // sine of the cone half angle, 1 when the triangles face too many directions
+};
+
+// Appends meshlets in index order, so indices should be optimized for the vertex cache first. meshlet_vertices receives
+// the mesh vertices of every meshlet, meshlet_triangles 3 local indices per triangle, each meshlet padded to 4 bytes
+void BuildMeshlets( std::vector<Meshlet>& meshlets, std::vector<uint32_t>& meshlet_vertices, std::vector<uint8_t>& meshlet_triangles,
+                    const uint32_t* indices, size_t num_indices, uint32_t num_vertices,
+                    uint32_t max_vertices = MaxMeshletVertices, uint32_t max_triangles = MaxMeshletTriangles );
+
+// front faces wind so that cross( p1 - p0, p2 - p0 ) points outwards
+MeshletBounds ComputeMeshletBounds( const Meshlet& meshlet, const uint32_t* meshlet_vertices, const uint8_t* meshlet_triangles,
+                                    const float* positions, size_t position_stride );
+
+bool IsMeshletBackfacing( const MeshletBounds& bounds, const float camera_position[3] );
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Minimal pluggable scheduler for data-parallel loops (ECS views, etc.)
+class ITaskScheduler
+{
+public:
+    virtual ~ITaskScheduler() = default;
+
+    // Runs task( task_idx ) for each task_idx in [0, num_tasks) and returns when all of them are finished.
+    // Tasks may run concurrently in any order
+    virtual void ParallelFor( size_t num_tasks, const std::function<void( size_t task_idx )>& task ) = 0;
+
+    // Number of threads that may execute tasks simultaneously, including the calling thread
+    virtual uint32_t GetNumThreads() const = 0;
+};
+
+
+// Runs all tasks on the calling thread in ascending order. Deterministic, use it as a reference for parallel code
+class SerialTaskScheduler : public ITaskScheduler
+{
+public:
+    virtual void ParallelFor( size_t num_tasks, const std::function<void( size_t task_idx )>& task ) override
+    {
+        for ( size_t i = 0; i < num_tasks; ++i )
+            task( i );
+    }
+
+    virtual uint32_t GetNumThreads() const override { return 1; }
+};
+
+
+// Fixed-size pool of worker threads. The calling thread participates in ParallelFor too.
+// ParallelFor calls from different threads are serialized, nested calls from inside a task run serially
+class ThreadPoolTaskScheduler : public ITaskScheduler
+{
+public:
+    // num_threads includes the calling thread, 0 means std::thread::hardware_concurrency()
+    explicit ThreadPoolTaskScheduler( uint32_t num_threads = 0 );
+    virtual ~ThreadPoolTaskScheduler() override;
+
+    ThreadPoolTaskScheduler( const ThreadPoolTaskScheduler& ) = delete;
+    ThreadPoolTaskScheduler& operator=( const ThreadPoolTaskScheduler& ) = delete;
+
+    virtual void ParallelFor( size_t num_tasks, const std::function<void( size_t task_idx )>& task ) override;
+
+    virtual uint32_t GetNumThreads() const override { return uint32_t( m_workers.size() + 1 ); }
+
+private:
+    struct Job
+    {
+        const std::function<void( size_t )>* task = nullptr;
+        size_t num_tasks = 0;
+        std::atomic<size_t> next_task = 0;
+        std::atomic<size_t> num_finished = 0;
+    };
+
+    void WorkerLoop();
+    void ExecuteTasks( Job& job );
+
+    static bool& IsInsideTask()
+    {
+        static thread_local bool inside_task = false;
+        return inside_task;
+    }
+
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_parallel_for_cs; // one job at a time
+
+    std::mutex m_job_cs;
+    std::condition_variable m_job_started;
+    std::condition_variable m_job_finished;
+    Job m_job;
+    uint64_t m_job_generation = 0;
+    uint32_t m_num_active_workers = 0;
+    bool m_stop = false;
+};
+
+
+inline ThreadPoolTaskScheduler::ThreadPoolTaskScheduler( uint32_t num_threads )
+{
+    if ( num_threads == 0 )
+        num_threads = std::max( std::thread::hardware_concurrency(), 1u );
+
+    m_workers.reserve( num_threads - 1 );
+    for ( uint32_t i = 1; i < num_threads; ++i )
+        m_workers.emplace_back( [this]() { WorkerLoop(); } );
+}
+
+
+inline ThreadPoolTaskScheduler::~ThreadPoolTaskScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock( m_job_cs );
+        m_stop = true;
+    }
+    m_job_started.notify_all();
+
+    for ( std::thread& worker : m_workers )
+        worker.join();
+}
+
+
+inline void ThreadPoolTaskScheduler::ParallelFor( size_t num_tasks, const std::function<void( size_t task_idx )>& task )
+{
+    if ( num_tasks == 0 )
+        return;
+
+    if ( num_tasks == 1 || m_workers.empty() || IsInsideTask() )
+    {
+        for ( size_t i = 0; i < num_tasks; ++i )
+            task( i );
+        return;
+    }
+
+    std::lock_guard<std::mutex> parallel_for_lock( m_parallel_for_cs );
+
+    {
+        // a worker that woke up too late for the previous job may still be looking at it
+        std::unique_lock<std::mutex> lock( m_job_cs );
+        m_job_finished.wait( lock, [&]() { return m_num_active_workers == 0; } );
+        m_job.task = &task;
+        m_job.num_tasks = num_tasks;
+        m_job.next_task = 0;
+        m_job.num_finished = 0;
+        m_job_generation++;
+    }
+    m_job_started.notify_all();
+
+    ExecuteTasks( m_job );
+
+    // workers may still hold a reference to the job even if all tasks are done, wait for them to leave it
+    std::unique_lock<std::mutex> lock( m_job_cs );
+    m_job_finished.wait( lock, [&]() { return m_job.num_finished == num_tasks && m_num_active_workers == 0; } );
+    m_job.task = nullptr;
+}
+
+
+inline void ThreadPoolTaskScheduler::WorkerLoop()
+{
+    uint64_t last_generation = 0;
+    for ( ;; )
+    {
+        {
+            std::unique_lock<std::mutex> lock( m_job_cs );
+            m_job_started.wait( lock, [&]() { return m_stop || m_job_generation != last_generation; } );
+            if ( m_stop )
+                return;
+            last_generation = m_job_generation;
+            m_num_active_workers++;
+        }
+
+        ExecuteTasks( m_job );
+
+        {
+            std::lock_guard<std::mutex> lock( m_job_cs );
+            m_num_active_workers--;
+        }
+        m_job_finished.notify_all();
+    }
+}
+
+
+inline void ThreadPoolTaskScheduler::ExecuteTasks( Job& job )
+{
+    IsInsideTask() = true;
+    for ( size_t task_idx = job.next_task++; task_idx < job.num_tasks; task_idx = job.next_task++ )
+    {
+        ( *job.task )( task_idx );
+        job.num_finished++;
+    }
+    IsInsideTask() = false;
+}
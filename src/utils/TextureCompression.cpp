@@ -0,0 +1,1058 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "TextureCompression.h"
+
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+    constexpr uint32_t BlockTexels = 16;
+    constexpr uint32_t BC1BlockSize = 8;
+    constexpr uint32_t BC4BlockSize = 8;
+    constexpr uint32_t BC7BlockSize = 16;
+    constexpr uint32_t BC6HBlockSize = 16;
+
+    // weights of the second endpoint in 64ths for 4 bit indices, shared by BC6H and BC7
+    constexpr uint32_t Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    using BlockValues = float[BlockTexels][4];
+
+    // Little endian bit stream, the layout of every BCn block
+    class BlockWriter
+    {
+    public:
+        BlockWriter( uint8_t* block, size_t size )
+            : m_block( block )
+        {
+            std::fill_n( block, size, uint8_t( 0 ) );
+        }
+
+        void Write( uint32_t value, uint32_t num_bits )
+        {
+            for ( uint32_t i = 0; i < num_bits; ++i, ++m_pos )
+                m_block[m_pos / 8] |= uint8_t( ( value >> i & 1 ) << ( m_pos % 8 ) );
+        }
+
+    private:
+        uint8_t* m_block = nullptr;
+        uint32_t m_pos = 0;
+    };
+
+    class BlockReader
+    {
+    public:
+        explicit BlockReader( const uint8_t* block )
+            : m_block( block )
+        {}
+
+        uint32_t Read( uint32_t num_bits )
+        {
+            uint32_t value = 0;
+            for ( uint32_t i = 0; i < num_bits; ++i, ++m_pos )
+                value |= uint32_t( m_block[m_pos / 8] >> ( m_pos % 8 ) & 1 ) << i;
+            return value;
+        }
+
+    private:
+        const uint8_t* m_block = nullptr;
+        uint32_t m_pos = 0;
+    };
+
+    void LoadBlockValues( const float* texels, uint32_t first_channel, uint32_t num_channels, float scale, BlockValues& values )
+    {
+        for ( uint32_t i = 0; i < BlockTexels; ++i )
+            for ( uint32_t c = 0; c < num_channels; ++c )
+                values[i][c] = std::clamp( texels[i * 4 + first_channel + c], 0.0f, 1.0f ) * scale;
+    }
+
+    // Endpoints of the segment of the principal axis covered by the values, the axis is the dominant eigenvector of the covariance
+    void FitPrincipalAxis( const BlockValues& values, uint32_t num_channels, float* e0, float* e1 )
+    {
+        float mean[4] = {};
+        for ( uint32_t i = 0; i < BlockTexels; ++i )
+            for ( uint32_t c = 0; c < num_channels; ++c )
+                mean[c] += values[i][c] / float( BlockTexels );
+
+        float covariance[4][4] = {};
+        for ( uint32_t i = 0; i < BlockTexels; ++i )
+            for ( uint32_t a = 0; a < num_channels; ++a )
+                for ( uint32_t b = 0; b < num_channels; ++b )
+                    covariance[a][b] += ( values[i][a] - mean[a] ) * ( values[i][b] - mean[b] );
+
+        // power iteration from the row with the largest variance
+        uint32_t max_row = 0;
+        for ( uint32_t c = 1; c < num_channels; ++c )
+            if ( covariance[c][c] > covariance[max_row][max_row] )
+                max_row = c;
+
+        float axis[4] = {};
+        std::copy_n( covariance[max_row], num_channels, axis );
+        for ( int iteration = 0; iteration < 8; ++iteration )
+        {
+            float next[4] = {};
+            float max_component = 0.0f;
+            for ( uint32_t a = 0; a < num_channels; ++a )
+            {
+                for ( uint32_t b = 0; b < num_channels; ++b )
+                    next[a] += covariance[a][b] * axis[b];
+                max_component = std::max( max_component, std::abs( next[a] ) );
+            }
+            if ( max_component <= 0.0f )
+                break;
+            for ( uint32_t c = 0; c < num_channels; ++c )
+                axis[c] = next[c] / max_component;
+        }
+
+        float length_sq = 0.0f;
+        for ( uint32_t c = 0; c < num_channels; ++c )
+            length_sq += axis[c] * axis[c];
+        if ( length_sq <= 0.0f )
+        {
+            // all values are the same
+            std::copy_n( mean, num_channels, e0 );
+            std::copy_n( mean, num_channels, e1 );
+            return;
+        }
+        for ( uint32_t c = 0; c < num_channels; ++c )
+            axis[c] /= std::sqrt( length_sq );
+
+        float min_t = std::numeric_limits<float>::max();
+        float max_t = -std::numeric_limits<float>::max();
+        for ( uint32_t i = 0; i < BlockTexels; ++i )
+        {
+            float t = 0.0f;
+            for ( uint32_t c = 0; c < num_channels; ++c )
+                t += ( values[i][c] - mean[c] ) * axis[c];
+            min_t = std::min( min_t, t );
+            max_t = std::max( max_t, t );
+        }
+
+        for ( uint32_t c = 0; c < num_channels; ++c )
+        {
+            e0[c] = mean[c] + axis[c] * min_t;
+            e1[c] = mean[c] + axis[c] * max_t;
+        }
+    }
+
+    // Least squares endpoints for fixed interpolation weights, weights[i] is the weight of e1 for texel i.
+    // Fails when all texels use the same weight
+    bool SolveEndpoints( const BlockValues& values, uint32_t num_channels, const float* weights, float* e0, float* e1 )
+    {
+        float aa = 0.0f;
+        float ab = 0.0f;
+        float bb = 0.0f;
+        float ax[4] = {};
+        float bx[4] = {};
+        for ( uint32_t i = 0; i < BlockTexels; ++i )
+        {
+            const float a = 1.0f - weights[i];
+            const float b = weights[i];
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for ( uint32_t c = 0; c < num_channels; ++c )
+            {
+                ax[c] += a * values[i][c];
+                bx[c] += b * values[i][c];
+            }
+        }
+
+        const float det = aa * bb - ab * ab;
+        if ( det <= 1e-6f )
+            return false;
+
+        for ( uint32_t c = 0; c < num_channels; ++c )
+        {
+            e0[c] = ( bb * ax[c] - ab * bx[c] ) / det;
+            e1[c] = ( aa * bx[c] - ab * ax[c] ) / det;
+        }
+        return true;
+    }
+
+    uint32_t QuantizeUnorm( float value, float max_value, uint32_t max_quantized )
+    {
+        return uint32_t( std::clamp( value, 0.0f, max_value ) * float( max_quantized ) / max_value + 0.5f );
+    }
+
+    // Entries of a 4 bit index palette lie on the line between the first and the last one up to rounding, so the projection
+    // onto that line gives a close index and only its neighbours need to be checked. Returns the squared error
+    float FindIndex4( const float ( &palette )[16][4], uint32_t num_channels, const float* value, uint32_t& index )
+    {
+        float axis[4] = {};
+        float axis_length_sq = 0.0f;
+        float t = 0.0f;
+        for ( uint32_t c = 0; c < num_channels; ++c )
+        {
+            axis[c] = palette[15][c] - palette[0][c];
+            axis_length_sq += axis[c] * axis[c];
+            t += ( value[c] - palette[0][c] ) * axis[c];
+        }
+        const int32_t estimate = axis_length_sq > 0.0f ? int32_t( std::clamp( t / axis_length_sq, 0.0f, 1.0f ) * 15.0f + 0.5f ) : 0;
+
+        float best_error = std::numeric_limits<float>::max();
+        for ( int32_t candidate = std::max( estimate - 1, 0 ); candidate <= std::min( estimate + 1, 15 ); ++candidate )
+        {
+            float error = 0.0f;
+            for ( uint32_t c = 0; c < num_channels; ++c )
+                error += ( palette[candidate][c] - value[c] ) * ( palette[candidate][c] - value[c] );
+            if ( error < best_error )
+            {
+                best_error = error;
+                index = uint32_t( candidate );
+            }
+        }
+        return best_error;
+    }
+
+    // BC1
+
+    uint16_t QuantizeRGB565( const float* rgb )
+    {
+        return uint16_t( QuantizeUnorm( rgb[0], 255.0f, 31 ) << 11 | QuantizeUnorm( rgb[1], 255.0f, 63 ) << 5 | QuantizeUnorm( rgb[2], 255.0f, 31 ) );
+    }
+
+    void ExpandRGB565( uint16_t color, float* rgb )
+    {
+        const uint32_t r = color >> 11;
+        const uint32_t g = color >> 5 & 63;
+        const uint32_t b = color & 31;
+        rgb[0] = float( r << 3 | r >> 2 );
+        rgb[1] = float( g << 2 | g >> 4 );
+        rgb[2] = float( b << 3 | b >> 2 );
+    }
+
+    // Endpoint pair per 8 bit value whose 2/3 : 1/3 mix is closest to it, flat blocks get much closer than with equal endpoints
+    struct SingleColorEntry
+    {
+        uint8_t e0 = 0;
+        uint8_t e1 = 0;
+    };
+    using SingleColorTable = std::array<SingleColorEntry, 256>;
+
+    SingleColorTable BuildSingleColorTable( uint32_t bits )
+    {
+        const uint32_t max_quantized = ( 1u << bits ) - 1;
+        auto expand = [bits]( uint32_t q ) { return q << ( 8 - bits ) | q >> ( 2 * bits - 8 ); };
+
+        SingleColorTable table;
+        for ( uint32_t value = 0; value < 256; ++value )
+        {
+            float best_error = std::numeric_limits<float>::max();
+            for ( uint32_t e0 = 0; e0 <= max_quantized; ++e0 )
+            {
+                for ( uint32_t e1 = 0; e1 <= max_quantized; ++e1 )
+                {
+                    const float error = std::abs( ( 2.0f * float( expand( e0 ) ) + float( expand( e1 ) ) ) / 3.0f - float( value ) );
+                    if ( error < best_error )
+                    {
+                        best_error = error;
+                        table[value] = SingleColorEntry{ uint8_t( e0 ), uint8_t( e1 ) };
+                    }
+                }
+            }
+        }
+        return table;
+    }
+
+    // 4 color mode when c0 > c1, otherwise 3 colors and transparent black
+    void BC1Palette( uint16_t c0, uint16_t c1, float ( &palette )[4][3] )
+    {
+        ExpandRGB565( c0, palette[0] );
+        ExpandRGB565( c1, palette[1] );
+        for ( int c = 0; c < 3; ++c )
+        {
+            if ( c0 > c1 )
+            {
+                palette[2][c] = ( 2.0f * palette[0][c] + palette[1][c] ) / 3.0f;
+                palette[3][c] = ( palette[0][c] + 2.0f * palette[1][c] ) / 3.0f;
+            }
+            else
+            {
+                palette[2][c] = ( palette[0][c] + palette[1][c] ) * 0.5f;
+                palette[3][c] = 0.0f;
+            }
+        }
+    }
+
+    // BC4
+
+    // 8 value mode when a0 > a1: a0, a1 and 6 values between them. 6 value mode otherwise: a0, a1, 4 values between them, 0 and 255
+    void BC4Palette( uint32_t a0, uint32_t a1, float ( &palette )[8] )
+    {
+        palette[0] = float( a0 );
+        palette[1] = float( a1 );
+        if ( a0 > a1 )
+        {
+            for ( uint32_t i = 2; i < 8; ++i )
+                palette[i] = float( ( 8 - i ) * a0 + ( i - 1 ) * a1 ) / 7.0f;
+        }
+        else
+        {
+            for ( uint32_t i = 2; i < 6; ++i )
+                palette[i] = float( ( 6 - i ) * a0 + ( i - 1 ) * a1 ) / 5.0f;
+            palette[6] = 0.0f;
+            palette[7] = 255.0f;
+        }
+    }
+
+    float FindBC4Indices( const float* values, uint32_t a0, uint32_t a1, uint64_t& indices )
+    {
+        float palette[8];
+        BC4Palette( a0, a1, palette );
+
+        float error = 0.0f;
+        indices = 0;
+        for ( uint32_t i = 0; i < BlockTexels; ++i )
+        {
+            uint32_t best_index = 0;
+            float best_error = std::numeric_limits<float>::max();
+            for ( uint32_t index = 0; index < 8; ++index )
+            {
+                const float texel_error = ( palette[index] - values[i] ) * ( palette[index] - values[i] );
+                if ( texel_error < best_error )
+                {
+                    best_error = texel_error;
+                    best_index = index;
+                }
+            }
+            indices |= uint64_t( best_index ) << ( i * 3 );
+            error += best_error;
+        }
+        return error;
+    }
+
+    // BC6H, mode 11: one region, 10 bit endpoints without deltas, 4 bit indices
+
+    constexpr uint32_t BC6HMode11 = 0x03;
+    constexpr uint32_t MaxHalf = 0x7BFF;
+
+    // non-negative values only, rounds to nearest even and clamps to the largest finite half
+    uint32_t FloatToHalf( float value )
+    {
+        if ( !( value > 0.0f ) )
+            return 0;
+        if ( value >= 65504.0f )
+            return MaxHalf;
+        if ( value < 6.103515625e-05f ) // smallest normal half, denormals are multiples of 2^-24
+            return uint32_t( value * 16777216.0f + 0.5f );
+
+        uint32_t bits = 0;
+        std::memcpy( &bits, &value, sizeof( bits ) );
+        // rebias the exponent from 127 to 15 and round the 13 dropped mantissa bits, a carry into the exponent is correct rounding
+        bits -= 112u << 23;
+        bits += 0x0FFF + ( bits >> 13 & 1 );
+        return std::min( bits >> 13, MaxHalf );
+    }
+
+    float HalfToFloat( uint32_t half )
+    {
+        const int exponent = int( half >> 10 & 31 );
+        const uint32_t mantissa = half & 1023;
+        float value = 0.0f;
+        if ( exponent == 0 )
+            value = std::ldexp( float( mantissa ), -24 );
+        else if ( exponent == 31 )
+            value = mantissa == 0 ? std::numeric_limits<float>::infinity() : std::numeric_limits<float>::quiet_NaN();
+        else
+            value = std::ldexp( float( 1024 + mantissa ), exponent - 25 );
+        return ( half & 0x8000 ) != 0 ? -value : value;
+    }
+
+    uint32_t UnquantizeBC6H10( uint32_t value )
+    {
+        if ( value == 0 )
+            return 0;
+        if ( value == 1023 )
+            return 0xFFFF;
+        return ( ( value << 16 ) + 0x8000 ) >> 10;
+    }
+
+    // interpolated unquantized values become half float bits, unsigned formats are scaled by 31 / 64
+    uint32_t BC6HInterpolate( uint32_t e0, uint32_t e1, uint32_t weight )
+    {
+        const uint32_t value = ( ( 64 - weight ) * UnquantizeBC6H10( e0 ) + weight * UnquantizeBC6H10( e1 ) + 32 ) >> 6;
+        return ( value * 31 ) >> 6;
+    }
+
+    // endpoint that decodes to the closest half, the endpoint alone decodes to 31 * q + 15
+    uint32_t QuantizeBC6HEndpoint( float half )
+    {
+        const int32_t estimate = int32_t( std::clamp( ( half - 15.0f ) / 31.0f + 0.5f, 0.0f, 1023.0f ) );
+        uint32_t best = 0;
+        float best_error = std::numeric_limits<float>::max();
+        for ( int32_t candidate = estimate - 1; candidate <= estimate + 1; ++candidate )
+        {
+            const uint32_t q = uint32_t( std::clamp( candidate, 0, 1023 ) );
+            const float error = std::abs( float( BC6HInterpolate( q, q, 0 ) ) - half );
+            if ( error < best_error )
+            {
+                best_error = error;
+                best = q;
+            }
+        }
+        return best;
+    }
+
+    // BC7, mode 6: one subset, rgba endpoints with 7 bits and a unique p-bit each, 4 bit indices
+
+    constexpr uint32_t BC7Mode6 = 6;
+
+    // the p-bit is the shared lowest bit of all four channels, the one with the smaller rounding error is picked
+    void QuantizeBC7Endpoint( const float* endpoint, uint32_t* quantized, uint32_t& p_bit )
+    {
+        float best_error = std::numeric_limits<float>::max();
+        for ( uint32_t p = 0; p < 2; ++p )
+        {
+            uint32_t candidate[4];
+            float error = 0.0f;
+            for ( int c = 0; c < 4; ++c )
+            {
+                candidate[c] = uint32_t( std::clamp( ( endpoint[c] - float( p ) ) * 0.5f + 0.5f, 0.0f, 127.0f ) );
+                const float value = float( candidate[c] * 2 + p );
+                error += ( value - endpoint[c] ) * ( value - endpoint[c] );
+            }
+            if ( error < best_error )
+            {
+                best_error = error;
+                p_bit = p;
+                std::copy_n( candidate, 4, quantized );
+            }
+        }
+    }
+
+    void WriteIndices4( BlockWriter& writer, const uint32_t* indices )
+    {
+        // the first index is an anchor, its highest bit is implicitly 0
+        writer.Write( indices[0], 3 );
+        for ( uint32_t i = 1; i < BlockTexels; ++i )
+            writer.Write( indices[i], 4 );
+    }
+
+    void ReadIndices4( BlockReader& reader, uint32_t* indices )
+    {
+        indices[0] = reader.Read( 3 );
+        for ( uint32_t i = 1; i < BlockTexels; ++i )
+            indices[i] = reader.Read( 4 );
+    }
+
+    void DecodeUnsupportedBlock( float* texels )
+    {
+        for ( uint32_t i = 0; i < BlockTexels; ++i )
+        {
+            texels[i * 4 + 0] = 1.0f;
+            texels[i * 4 + 1] = 0.0f;
+            texels[i * 4 + 2] = 1.0f;
+            texels[i * 4 + 3] = 1.0f;
+        }
+    }
+
+    void EncodeTexel( TextureEncoding encoding, const float* texel, uint8_t* dst )
+    {
+        if ( encoding == TextureEncoding::RGB9E5 )
+        {
+            const uint32_t packed = PackRGB9E5( texel[0], texel[1], texel[2] );
+            std::copy_n( reinterpret_cast<const uint8_t*>( &packed ), sizeof( packed ), dst );
+            return;
+        }
+
+        assert( encoding == TextureEncoding::RGBA8 );
+        for ( int c = 0; c < 4; ++c )
+            dst[c] = uint8_t( QuantizeUnorm( texel[c], 1.0f, 255 ) );
+    }
+
+    void DecodeTexel( TextureEncoding encoding, const uint8_t* src, float* texel )
+    {
+        if ( encoding == TextureEncoding::RGB9E5 )
+        {
+            uint32_t packed = 0;
+            std::copy_n( src, sizeof( packed ), reinterpret_cast<uint8_t*>( &packed ) );
+            UnpackRGB9E5( packed, texel );
+            texel[3] = 1.0f;
+            return;
+        }
+
+        assert( encoding == TextureEncoding::RGBA8 );
+        for ( int c = 0; c < 4; ++c )
+            texel[c] = float( src[c] ) / 255.0f;
+    }
+
+    void EncodeBlock( TextureEncoding encoding, const float* texels, uint8_t* block )
+    {
+        switch ( encoding )
+        {
+        case TextureEncoding::BC1: EncodeBC1Block( texels, block ); break;
+        case TextureEncoding::BC4: EncodeBC4Block( texels, 0, block ); break;
+        case TextureEncoding::BC5: EncodeBC5Block( texels, block ); break;
+        case TextureEncoding::BC6H: EncodeBC6HBlock( texels, block ); break;
+        case TextureEncoding::BC7: EncodeBC7Block( texels, block ); break;
+        default: assert( false ); break;
+        }
+    }
+
+    bool DecodeBlock( TextureEncoding encoding, const uint8_t* block, float* texels )
+    {
+        switch ( encoding )
+        {
+        case TextureEncoding::BC1: DecodeBC1Block( block, texels ); return true;
+        case TextureEncoding::BC4: DecodeBC4Block( block, 0, texels ); return true;
+        case TextureEncoding::BC5: DecodeBC5Block( block, texels ); return true;
+        case TextureEncoding::BC6H: return DecodeBC6HBlock( block, texels );
+        case TextureEncoding::BC7: return DecodeBC7Block( block, texels );
+        default: assert( false ); return false;
+        }
+    }
+}
+
+bool IsBlockCompressed( TextureEncoding encoding )
+{
+    return encoding != TextureEncoding::RGBA8 && encoding != TextureEncoding::RGB9E5;
+}
+
+uint32_t GetEncodingElementSize( TextureEncoding encoding )
+{
+    switch ( encoding )
+    {
+    case TextureEncoding::RGBA8: return 4;
+    case TextureEncoding::BC1: return BC1BlockSize;
+    case TextureEncoding::BC4: return BC4BlockSize;
+    case TextureEncoding::BC5: return BC4BlockSize * 2;
+    case TextureEncoding::BC6H: return BC6HBlockSize;
+    case TextureEncoding::BC7: return BC7BlockSize;
+    case TextureEncoding::RGB9E5: return 4;
+    default: assert( false ); return 0;
+    }
+}
+
+size_t GetEncodedSize( TextureEncoding encoding, uint32_t width, uint32_t height )
+{
+    if ( IsBlockCompressed( encoding ) )
+        return size_t( ( width + 3 ) / 4 ) * ( ( height + 3 ) / 4 ) * GetEncodingElementSize( encoding );
+    return size_t( width ) * height * GetEncodingElementSize( encoding );
+}
+
+void EncodeTexture( TextureEncoding encoding, const float* rgba, uint32_t width, uint32_t height, uint8_t* dst, ITaskScheduler& scheduler )
+{
+    const uint32_t element_size = GetEncodingElementSize( encoding );
+    if ( !IsBlockCompressed( encoding ) )
+    {
+        scheduler.ParallelFor( height, [&]( size_t row )
+        {
+            for ( size_t i = row * width; i < ( row + 1 ) * width; ++i )
+                EncodeTexel( encoding, rgba + i * 4, dst + i * element_size );
+        } );
+        return;
+    }
+
+    const uint32_t blocks_x = ( width + 3 ) / 4;
+    const uint32_t blocks_y = ( height + 3 ) / 4;
+    scheduler.ParallelFor( blocks_y, [&]( size_t block_y )
+    {
+        float texels[BlockTexels * 4];
+        for ( uint32_t block_x = 0; block_x < blocks_x; ++block_x )
+        {
+            for ( uint32_t i = 0; i < BlockTexels; ++i )
+            {
+                const uint32_t x = std::min( block_x * 4 + i % 4, width - 1 );
+                const uint32_t y = std::min( uint32_t( block_y ) * 4 + i / 4, height - 1 );
+                std::copy_n( rgba + ( size_t( y ) * width + x ) * 4, 4, texels + i * 4 );
+            }
+            EncodeBlock( encoding, texels, dst + ( block_y * blocks_x + block_x ) * element_size );
+        }
+    } );
+}
+
+bool DecodeTexture( TextureEncoding encoding, const uint8_t* src, uint32_t width, uint32_t height, float* rgba )
+{
+    const uint32_t element_size = GetEncodingElementSize( encoding );
+    if ( !IsBlockCompressed( encoding ) )
+    {
+        for ( size_t i = 0; i < size_t( width ) * height; ++i )
+            DecodeTexel( encoding, src + i * element_size, rgba + i * 4 );
+        return true;
+    }
+
+    bool supported = true;
+    const uint32_t blocks_x = ( width + 3 ) / 4;
+    const uint32_t blocks_y = ( height + 3 ) / 4;
+    float texels[BlockTexels * 4];
+    for ( uint32_t block_y = 0; block_y < blocks_y; ++block_y )
+    {
+        for ( uint32_t block_x = 0; block_x < blocks_x; ++block_x )
+        {
+            supported &= DecodeBlock( encoding, src + ( size_t( block_y ) * blocks_x + block_x ) * element_size, texels );
+            for ( uint32_t i = 0; i < BlockTexels; ++i )
+            {
+                const uint32_t x = block_x * 4 + i % 4;
+                const uint32_t y = block_y * 4 + i / 4;
+                if ( x < width && y < height )
+                    std::copy_n( texels + i * 4, 4, rgba + ( size_t( y ) * width + x ) * 4 );
+            }
+        }
+    }
+    return supported;
+}
+
+void EncodeBC1Block( const float* texels, uint8_t* block )
+{
+    BlockValues values;
+    LoadBlockValues( texels, 0, 3, 255.0f, values );
+
+    uint32_t rgb8[3];
+    bool single_color = true;
+    for ( uint32_t c = 0; c < 3; ++c )
+    {
+        rgb8[c] = QuantizeUnorm( values[0][c], 255.0f, 255 );
+        for ( uint32_t i = 1; i < BlockTexels; ++i )
+            single_color &= QuantizeUnorm( values[i][c], 255.0f, 255 ) == rgb8[c];
+    }
+    if ( single_color )
+    {
+        static const SingleColorTable table5 = BuildSingleColorTable( 5 );
+        static const SingleColorTable table6 = BuildSingleColorTable( 6 );
+        uint16_t c0 = uint16_t( table5[rgb8[0]].e0 << 11 | table6[rgb8[1]].e0 << 5 | table5[rgb8[2]].e0 );
+        uint16_t c1 = uint16_t( table5[rgb8[0]].e1 << 11 | table6[rgb8[1]].e1 << 5 | table5[rgb8[2]].e1 );
+        // every texel uses the 2/3 c0 + 1/3 c1 entry, which is index 3 once the endpoints are swapped for the 4 color mode.
+        // Equal endpoints mean the color is exact and any index but 3 decodes to it
+        uint32_t indices = 0xAAAAAAAA;
+        if ( c0 < c1 )
+        {
+            std::swap( c0, c1 );
+            indices = 0xFFFFFFFF;
+        }
+        else if ( c0 == c1 )
+        {
+            indices = 0;
+        }
+
+        block[0] = uint8_t( c0 );
+        block[1] = uint8_t( c0 >> 8 );
+        block[2] = uint8_t( c1 );
+        block[3] = uint8_t( c1 >> 8 );
+        for ( int i = 0; i < 4; ++i )
+            block[4 + i] = uint8_t( indices >> ( i * 8 ) );
+        return;
+    }
+
+    float e0[4];
+    float e1[4];
+    FitPrincipalAxis( values, 3, e0, e1 );
+
+    // weight of c1 for every index of the 4 color mode
+    constexpr float Weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+    uint16_t best_c0 = 0;
+    uint16_t best_c1 = 0;
+    uint32_t best_indices = 0;
+    float best_error = std::numeric_limits<float>::max();
+    for ( int iteration = 0; iteration < 3; ++iteration )
+    {
+        uint16_t c0 = QuantizeRGB565( e1 );
+        uint16_t c1 = QuantizeRGB565( e0 );
+        const bool swapped = c0 < c1;
+        if ( swapped )
+            std::swap( c0, c1 );
+
+        float palette[4][3];
+        BC1Palette( c0, c1, palette );
+
+        // equal endpoints select the 3 color mode, where only index 0 is safe to use
+        const uint32_t num_indices = c0 == c1 ? 1 : 4;
+        uint32_t indices = 0;
+        float weights[BlockTexels];
+        float error = 0.0f;
+        for ( uint32_t i = 0; i < BlockTexels; ++i )
+        {
+            uint32_t best_index = 0;
+            float best_texel_error = std::numeric_limits<float>::max();
+            for ( uint32_t index = 0; index < num_indices; ++index )
+            {
+                float texel_error = 0.0f;
+                for ( int c = 0; c < 3; ++c )
+                    texel_error += ( palette[index][c] - values[i][c] ) * ( palette[index][c] - values[i][c] );
+                if ( texel_error < best_texel_error )
+                {
+                    best_texel_error = texel_error;
+                    best_index = index;
+                }
+            }
+            indices |= best_index << ( i * 2 );
+            // weights are relative to e0 -> e1, which map to c1 -> c0 unless swapped
+            weights[i] = swapped ? Weights[best_index] : 1.0f - Weights[best_index];
+            error += best_texel_error;
+        }
+
+        if ( error < best_error )
+        {
+            best_error = error;
+            best_c0 = c0;
+            best_c1 = c1;
+            best_indices = indices;
+        }
+
+        if ( num_indices == 1 || !SolveEndpoints( values, 3, weights, e0, e1 ) )
+            break;
+    }
+
+    block[0] = uint8_t( best_c0 );
+    block[1] = uint8_t( best_c0 >> 8 );
+    block[2] = uint8_t( best_c1 );
+    block[3] = uint8_t( best_c1 >> 8 );
+    for ( int i = 0; i < 4; ++i )
+        block[4 + i] = uint8_t( best_indices >> ( i * 8 ) );
+}
+
+void DecodeBC1Block( const uint8_t* block, float* texels )
+{
+    const uint16_t c0 = uint16_t( block[0] | block[1] << 8 );
+    const uint16_t c1 = uint16_t( block[2] | block[3] << 8 );
+    const uint32_t indices = uint32_t( block[4] ) | uint32_t( block[5] ) << 8 | uint32_t( block[6] ) << 16 | uint32_t( block[7] ) << 24;
+
+    float palette[4][3];
+    BC1Palette( c0, c1, palette );
+
+    for ( uint32_t i = 0; i < BlockTexels; ++i )
+    {
+        const uint32_t index = indices >> ( i * 2 ) & 3;
+        for ( int c = 0; c < 3; ++c )
+            texels[i * 4 + c] = palette[index][c] / 255.0f;
+        texels[i * 4 + 3] = ( c0 <= c1 && index == 3 ) ? 0.0f : 1.0f;
+    }
+}
+
+void EncodeBC4Block( const float* texels, uint32_t channel, uint8_t* block )
+{
+    float values[BlockTexels];
+    float min_value = 255.0f;
+    float max_value = 0.0f;
+    // extremes the 6 value mode gets for free are left out of its endpoints
+    float inner_min = 255.0f;
+    float inner_max = 0.0f;
+    for ( uint32_t i = 0; i < BlockTexels; ++i )
+    {
+        values[i] = std::clamp( texels[i * 4 + channel], 0.0f, 1.0f ) * 255.0f;
+        min_value = std::min( min_value, values[i] );
+        max_value = std::max( max_value, values[i] );
+        if ( values[i] > 0.5f && values[i] < 254.5f )
+        {
+            inner_min = std::min( inner_min, values[i] );
+            inner_max = std::max( inner_max, values[i] );
+        }
+    }
+    if ( inner_min > inner_max )
+    {
+        inner_min = min_value;
+        inner_max = max_value;
+    }
+
+    const uint32_t lo = QuantizeUnorm( min_value, 255.0f, 255 );
+    const uint32_t hi = QuantizeUnorm( max_value, 255.0f, 255 );
+
+    uint32_t a0 = QuantizeUnorm( inner_min, 255.0f, 255 );
+    uint32_t a1 = QuantizeUnorm( inner_max, 255.0f, 255 );
+    uint64_t indices = 0;
+    float error = FindBC4Indices( values, a0, a1, indices );
+
+    if ( hi > lo )
+    {
+        uint64_t indices8 = 0;
+        const float error8 = FindBC4Indices( values, hi, lo, indices8 );
+        if ( error8 < error )
+        {
+            a0 = hi;
+            a1 = lo;
+            indices = indices8;
+        }
+    }
+
+    block[0] = uint8_t( a0 );
+    block[1] = uint8_t( a1 );
+    for ( int i = 0; i < 6; ++i )
+        block[2 + i] = uint8_t( indices >> ( i * 8 ) );
+}
+
+void DecodeBC4Block( const uint8_t* block, uint32_t channel, float* texels )
+{
+    float palette[8];
+    BC4Palette( block[0], block[1], palette );
+
+    uint64_t indices = 0;
+    for ( int i = 0; i < 6; ++i )
+        indices |= uint64_t( block[2 + i] ) << ( i * 8 );
+
+    for ( uint32_t i = 0; i < BlockTexels; ++i )
+    {
+        float* texel = texels + i * 4;
+        if ( channel == 0 )
+        {
+            texel[1] = 0.0f;
+            texel[2] = 0.0f;
+            texel[3] = 1.0f;
+        }
+        texel[channel] = palette[indices >> ( i * 3 ) & 7] / 255.0f;
+    }
+}
+
+void EncodeBC5Block( const float* texels, uint8_t* block )
+{
+    EncodeBC4Block( texels, 0, block );
+    EncodeBC4Block( texels, 1, block + BC4BlockSize );
+}
+
+void DecodeBC5Block( const uint8_t* block, float* texels )
+{
+    DecodeBC4Block( block, 0, texels );
+    DecodeBC4Block( block + BC4BlockSize, 1, texels );
+}
+
+void EncodeBC6HBlock( const float* texels, uint8_t* block )
+{
+    // endpoints are interpolated as integers in the domain of half float bits, which is close to logarithmic
+    BlockValues values;
+    for ( uint32_t i = 0; i < BlockTexels; ++i )
+        for ( uint32_t c = 0; c < 3; ++c )
+            values[i][c] = float( FloatToHalf( texels[i * 4 + c] ) );
+
+    float e0[4];
+    float e1[4];
+    FitPrincipalAxis( values, 3, e0, e1 );
+
+    uint32_t best_q0[3] = {};
+    uint32_t best_q1[3] = {};
+    uint32_t best_indices[BlockTexels] = {};
+    float best_error = std::numeric_limits<float>::max();
+    for ( int iteration = 0; iteration < 3; ++iteration )
+    {
+        uint32_t q0[3];
+        uint32_t q1[3];
+        for ( int c = 0; c < 3; ++c )
+        {
+            q0[c] = QuantizeBC6HEndpoint( e0[c] );
+            q1[c] = QuantizeBC6HEndpoint( e1[c] );
+        }
+
+        float palette[16][4];
+        for ( uint32_t index = 0; index < 16; ++index )
+            for ( int c = 0; c < 3; ++c )
+                palette[index][c] = float( BC6HInterpolate( q0[c], q1[c], Weights4[index] ) );
+
+        uint32_t indices[BlockTexels];
+        float weights[BlockTexels];
+        float error = 0.0f;
+        for ( uint32_t i = 0; i < BlockTexels; ++i )
+        {
+            error += FindIndex4( palette, 3, values[i], indices[i] );
+            weights[i] = float( Weights4[indices[i]] ) / 64.0f;
+        }
+
+        if ( error < best_error )
+        {
+            best_error = error;
+            std::copy_n( q0, 3, best_q0 );
+            std::copy_n( q1, 3, best_q1 );
+            std::copy_n( indices, BlockTexels, best_indices );
+        }
+
+        if ( !SolveEndpoints( values, 3, weights, e0, e1 ) )
+            break;
+    }
+
+    if ( best_indices[0] >= 8 )
+    {
+        std::swap( best_q0, best_q1 );
+        for ( uint32_t& index : best_indices )
+            index = 15 - index;
+    }
+
+    BlockWriter writer( block, BC6HBlockSize );
+    writer.Write( BC6HMode11, 5 );
+    for ( int c = 0; c < 3; ++c )
+        writer.Write( best_q0[c], 10 );
+    for ( int c = 0; c < 3; ++c )
+        writer.Write( best_q1[c], 10 );
+    WriteIndices4( writer, best_indices );
+}
+
+bool DecodeBC6HBlock( const uint8_t* block, float* texels )
+{
+    BlockReader reader( block );
+    uint32_t mode = reader.Read( 2 );
+    if ( mode > 1 )
+        mode |= reader.Read( 3 ) << 2;
+    if ( mode != BC6HMode11 )
+    {
+        DecodeUnsupportedBlock( texels );
+        return false;
+    }
+
+    uint32_t q0[3];
+    uint32_t q1[3];
+    for ( int c = 0; c < 3; ++c )
+        q0[c] = reader.Read( 10 );
+    for ( int c = 0; c < 3; ++c )
+        q1[c] = reader.Read( 10 );
+    uint32_t indices[BlockTexels];
+    ReadIndices4( reader, indices );
+
+    for ( uint32_t i = 0; i < BlockTexels; ++i )
+    {
+        for ( int c = 0; c < 3; ++c )
+            texels[i * 4 + c] = HalfToFloat( BC6HInterpolate( q0[c], q1[c], Weights4[indices[i]] ) );
+        texels[i * 4 + 3] = 1.0f;
+    }
+    return true;
+}
+
+void EncodeBC7Block( const float* texels, uint8_t* block )
+{
+    BlockValues values;
+    LoadBlockValues( texels, 0, 4, 255.0f, values );
+
+    float e0[4];
+    float e1[4];
+    FitPrincipalAxis( values, 4, e0, e1 );
+
+    uint32_t best_q[2][4] = {};
+    uint32_t best_p[2] = {};
+    uint32_t best_indices[BlockTexels] = {};
+    float best_error = std::numeric_limits<float>::max();
+    for ( int iteration = 0; iteration < 3; ++iteration )
+    {
+        uint32_t q[2][4];
+        uint32_t p[2];
+        QuantizeBC7Endpoint( e0, q[0], p[0] );
+        QuantizeBC7Endpoint( e1, q[1], p[1] );
+
+        float palette[16][4];
+        for ( uint32_t index = 0; index < 16; ++index )
+        {
+            for ( int c = 0; c < 4; ++c )
+            {
+                const uint32_t v0 = q[0][c] * 2 + p[0];
+                const uint32_t v1 = q[1][c] * 2 + p[1];
+                palette[index][c] = float( ( ( 64 - Weights4[index] ) * v0 + Weights4[index] * v1 + 32 ) >> 6 );
+            }
+        }
+
+        uint32_t indices[BlockTexels];
+        float weights[BlockTexels];
+        float error = 0.0f;
+        for ( uint32_t i = 0; i < BlockTexels; ++i )
+        {
+            error += FindIndex4( palette, 4, values[i], indices[i] );
+            weights[i] = float( Weights4[indices[i]] ) / 64.0f;
+        }
+
+        if ( error < best_error )
+        {
+            best_error = error;
+            std::copy_n( &q[0][0], 8, &best_q[0][0] );
+            std::copy_n( p, 2, best_p );
+            std::copy_n( indices, BlockTexels, best_indices );
+        }
+
+        if ( !SolveEndpoints( values, 4, weights, e0, e1 ) )
+            break;
+    }
+
+    if ( best_indices[0] >= 8 )
+    {
+        std::swap( best_q[0], best_q[1] );
+        std::swap( best_p[0], best_p[1] );
+        for ( uint32_t& index : best_indices )
+            index = 15 - index;
+    }
+
+    BlockWriter writer( block, BC7BlockSize );
+    writer.Write( 1u << BC7Mode6, BC7Mode6 + 1 );
+    for ( int c = 0; c < 4; ++c )
+    {
+        writer.Write( best_q[0][c], 7 );
+        writer.Write( best_q[1][c], 7 );
+    }
+    writer.Write( best_p[0], 1 );
+    writer.Write( best_p[1], 1 );
+    WriteIndices4( writer, best_indices );
+}
+
+bool DecodeBC7Block( const uint8_t* block, float* texels )
+{
+    // the mode is the number of zero bits before the first set one
+    BlockReader reader( block );
+    uint32_t mode = 0;
+    while ( mode < 8 && reader.Read( 1 ) == 0 )
+        mode++;
+    if ( mode != BC7Mode6 )
+    {
+        DecodeUnsupportedBlock( texels );
+        return false;
+    }
+
+    uint32_t q[2][4];
+    for ( int c = 0; c < 4; ++c )
+    {
+        q[0][c] = reader.Read( 7 );
+        q[1][c] = reader.Read( 7 );
+    }
+    const uint32_t p0 = reader.Read( 1 );
+    const uint32_t p1 = reader.Read( 1 );
+    uint32_t indices[BlockTexels];
+    ReadIndices4( reader, indices );
+
+    for ( uint32_t i = 0; i < BlockTexels; ++i )
+    {
+        const uint32_t weight = Weights4[indices[i]];
+        for ( int c = 0; c < 4; ++c )
+        {
+            const uint32_t v0 = q[0][c] * 2 + p0;
+            const uint32_t v1 = q[1][c] * 2 + p1;
+            texels[i * 4 + c] = float( ( ( 64 - weight ) * v0 + weight * v1 + 32 ) >> 6 ) / 255.0f;
+        }
+    }
+    return true;
+}
+
+uint32_t PackRGB9E5( float r, float g, float b )
+{
+    constexpr int MantissaBits = 9;
+    constexpr int ExponentBias = 15;
+    constexpr float MaxValue = 65408.0f; // ( 2^9 - 1 ) / 2^9 * 2^( 31 - 15 )
+
+    // comparisons with NaN are false, so NaNs become 0 too
+    const float rgb[3] = {
+        r > 0.0f ? std::min( r, MaxValue ) : 0.0f,
+        g > 0.0f ? std::min( g, MaxValue ) : 0.0f,
+        b > 0.0f ? std::min( b, MaxValue ) : 0.0f };
+    const float max_value = std::max( { rgb[0], rgb[1], rgb[2] } );
+
+    // floor( log2( max_value ) ) is frexp exponent - 1
+    int max_exponent = 0;
+    std::frexp( max_value, &max_exponent );
+    int exponent = max_value > 0.0f ? std::max( -ExponentBias - 1, max_exponent - 1 ) + 1 + ExponentBias : 0;
+
+    float scale = std::ldexp( 1.0f, exponent - ExponentBias - MantissaBits );
+    if ( uint32_t( std::floor( max_value / scale + 0.5f ) ) == ( 1u << MantissaBits ) )
+    {
+        exponent++;
+        scale *= 2.0f;
+    }
+
+    uint32_t packed = uint32_t( exponent ) << 27;
+    for ( int c = 0; c < 3; ++c )
+        packed |= std::min( uint32_t( std::floor( rgb[c] / scale + 0.5f ) ), ( 1u << MantissaBits ) - 1 ) << ( c * MantissaBits );
+    return packed;
+}
+
+void UnpackRGB9E5( uint32_t packed, float* rgb )
+{
+    const float scale = std::ldexp( 1.0f, int( packed >> 27 ) - 15 - 9 );
+    for ( int c = 0; c < 3; ++c )
+        rgb[c] = float( packed >> ( c * 9 ) & 511 ) * scale;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class ITaskScheduler;
+
+// CPU encoders for BCn block compression and RGB9E5, the bit layouts are the ones of the D3D and Vulkan formats with the same names.
+// Input is RGBA32F, row major. Values are encoded as they are, so sRGB formats expect sRGB encoded rgb and UNORM ones [0, 1].
+// Partial blocks at the right and bottom edges are padded with the edge texels
+enum class TextureEncoding : uint8_t
+{
+    RGBA8 = 0, // uncompressed, 8 bits per channel
+    BC1, // rgb with 5:6:5 endpoints and 2 bit indices, alpha is dropped. 8 bytes per block
+    BC4, // red only, 8 bytes per block
+    BC5, // red and green, e.g. xy of a normal map. 16 bytes per block
+    BC6H, // unsigned half float rgb, single region mode only. 16 bytes per block
+    BC7, // rgba, mode 6 only: one line through rgba space with 7 bit endpoints and 4 bit indices. 16 bytes per block
+    RGB9E5, // unsigned float rgb with a shared exponent, uncompressed
+
+    Count
+};
+
+bool IsBlockCompressed( TextureEncoding encoding );
+// bytes per 4x4 block for block compressed encodings, per texel otherwise
+uint32_t GetEncodingElementSize( TextureEncoding encoding );
+size_t GetEncodedSize( TextureEncoding encoding, uint32_t width, uint32_t height );
+
+// Block rows are encoded in parallel. dst must hold GetEncodedSize bytes
+void EncodeTexture( TextureEncoding encoding, const float* rgba, uint32_t width, uint32_t height, uint8_t* dst, ITaskScheduler& scheduler );
+
+// Back to RGBA32F, for tests and previews. Channels missing from the encoding decode to 0 and alpha to 1, like on a GPU.
+// Only the block modes written by EncodeTexture are supported, other blocks decode to magenta and make the function return false
+bool DecodeTexture( TextureEncoding encoding, const uint8_t* src, uint32_t width, uint32_t height, float* rgba );
+
+// 4x4 blocks, texels are 16 RGBA values in row order
+void EncodeBC1Block( const float* texels, uint8_t* block );
+void EncodeBC4Block( const float* texels, uint32_t channel, uint8_t* block );
+void EncodeBC5Block( const float* texels, uint8_t* block );
+void EncodeBC6HBlock( const float* texels, uint8_t* block );
+void EncodeBC7Block( const float* texels, uint8_t* block );
+
+void DecodeBC1Block( const uint8_t* block, float* texels );
+void DecodeBC4Block( const uint8_t* block, uint32_t channel, float* texels );
+void DecodeBC5Block( const uint8_t* block, float* texels );
+bool DecodeBC6HBlock( const uint8_t* block, float* texels );
+bool DecodeBC7Block( const uint8_t* block, float* texels );
+
+// Negative values and NaNs become 0, values above 65408 are clamped
+uint32_t PackRGB9E5( float r, float g, float b );
+void UnpackRGB9E5( uint32_t packed, float* rgb );
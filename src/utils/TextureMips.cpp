@@ -0,0 +1,280 @@
+// This is an independent project of an individual developer. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "TextureMips.h"
+
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+    constexpr float KaiserRadius = 3.0f; // in destination texels
+    constexpr float KaiserAlpha = 4.0f;
+    constexpr float Pi = 3.14159265358979f;
+    constexpr size_t RowsPerTask = 16;
+
+    // zeroth order modified Bessel function of the first kind, the series converges quickly for the alphas used by the window
+    float BesselI0( float x )
+    {
+        const float quarter_x_sq = x * x * 0.25f;
+        float sum = 1.0f;
+        float term = 1.0f;
+        for ( int k = 1; k < 32 && term > sum * 1e-8f; ++k )
+        {
+            term *= quarter_x_sq / float( k * k );
+            sum += term;
+        }
+        return sum;
+    }
+
+    float Sinc( float x )
+    {
+        if ( std::abs( x ) < 1e-6f )
+            return 1.0f;
+        x *= Pi;
+        return std::sin( x ) / x;
+    }
+
+    uint32_t AddressTexel( int64_t coord, uint32_t size, bool wrap )
+    {
+        if ( wrap )
+            return uint32_t( ( coord % int64_t( size ) + int64_t( size ) ) % int64_t( size ) );
+        return uint32_t( std::clamp<int64_t>( coord, 0, int64_t( size ) - 1 ) );
+    }
+
+    // Filter of one axis with the same number of taps for every destination texel, unused taps have zero weight
+    struct FilterTaps
+    {
+        uint32_t taps_per_texel = 0;
+        std::vector<uint32_t> src_texels;
+        std::vector<float> weights;
+    };
+
+    FilterTaps BuildFilterTaps( uint32_t src_size, uint32_t dst_size, MipFilter filter, bool wrap )
+    {
+        const float scale = float( src_size ) / float( dst_size );
+        const float radius = ( filter == MipFilter::Box ? 0.5f : KaiserRadius ) * scale; // in source texels
+        const float window_scale = 1.0f / BesselI0( KaiserAlpha );
+
+        FilterTaps taps;
+        taps.taps_per_texel = uint32_t( std::ceil( radius * 2.0f ) ) + 1;
+        taps.src_texels.resize( size_t( dst_size ) * taps.taps_per_texel );
+        taps.weights.resize( size_t( dst_size ) * taps.taps_per_texel );
+
+        for ( uint32_t dst = 0; dst < dst_size; ++dst )
+        {
+            const float center = ( float( dst ) + 0.5f ) * scale;
+            const int64_t first = int64_t( std::floor( center - radius ) );
+            uint32_t* src_texels = taps.src_texels.data() + size_t( dst ) * taps.taps_per_texel;
+            float* weights = taps.weights.data() + size_t( dst ) * taps.taps_per_texel;
+
+            float weight_sum = 0.0f;
+            for ( uint32_t tap = 0; tap < taps.taps_per_texel; ++tap )
+            {
+                const int64_t src = first + tap;
+                float weight = 0.0f;
+                if ( filter == MipFilter::Box )
+                {
+                    // coverage of the source texel by the destination one
+                    weight = std::max( 0.0f, std::min( float( src + 1 ), center + radius ) - std::max( float( src ), center - radius ) );
+                }
+                else
+                {
+                    const float t = ( float( src ) + 0.5f - center ) / scale;
+                    const float x = t / KaiserRadius;
+                    if ( std::abs( x ) < 1.0f )
+                        weight = Sinc( t ) * BesselI0( KaiserAlpha * std::sqrt( 1.0f - x * x ) ) * window_scale;
+                }
+                src_texels[tap] = AddressTexel( src, src_size, wrap );
+                weights[tap] = weight;
+                weight_sum += weight;
+            }
+
+            // the tap closest to the center always has a positive weight
+            for ( uint32_t tap = 0; tap < taps.taps_per_texel; ++tap )
+                weights[tap] /= weight_sum;
+        }
+
+        return taps;
+    }
+
+    void ToFilterSpace( float* texel, MipContent content )
+    {
+        if ( content == MipContent::SRGB )
+        {
+            for ( int c = 0; c < 3; ++c )
+                texel[c] = SRGBToLinear( texel[c] );
+        }
+        else if ( content == MipContent::NormalMap )
+        {
+            for ( int c = 0; c < 3; ++c )
+                texel[c] = texel[c] * 2.0f - 1.0f;
+        }
+    }
+
+    // Clamps what the filter overshot and renormalizes normals, the result is the source of the next level
+    void FinishFilteredTexel( float* texel, MipContent content )
+    {
+        switch ( content )
+        {
+        case MipContent::Linear:
+        case MipContent::SRGB:
+            for ( int c = 0; c < 3; ++c )
+                texel[c] = std::clamp( texel[c], 0.0f, 1.0f );
+            break;
+        case MipContent::HDR:
+            for ( int c = 0; c < 3; ++c )
+                texel[c] = std::max( texel[c], 0.0f );
+            break;
+        case MipContent::NormalMap:
+        {
+            const float length = std::sqrt( texel[0] * texel[0] + texel[1] * texel[1] + texel[2] * texel[2] );
+            if ( length > 1e-6f )
+            {
+                for ( int c = 0; c < 3; ++c )
+                    texel[c] /= length;
+            }
+            else
+            {
+                // opposite normals cancelled out
+                texel[0] = 0.0f;
+                texel[1] = 0.0f;
+                texel[2] = 1.0f;
+            }
+            break;
+        }
+        }
+        texel[3] = std::clamp( texel[3], 0.0f, 1.0f );
+    }
+
+    void FromFilterSpace( const float* texel, float* stored, MipContent content )
+    {
+        for ( int c = 0; c < 3; ++c )
+        {
+            if ( content == MipContent::SRGB )
+                stored[c] = LinearToSRGB( texel[c] );
+            else if ( content == MipContent::NormalMap )
+                stored[c] = texel[c] * 0.5f + 0.5f;
+            else
+                stored[c] = texel[c];
+        }
+        stored[3] = texel[3];
+    }
+
+    void ParallelForRows( ITaskScheduler& scheduler, uint32_t num_rows, const std::function<void( uint32_t row )>& fn )
+    {
+        scheduler.ParallelFor( ( num_rows + RowsPerTask - 1 ) / RowsPerTask, [&]( size_t task_idx )
+        {
+            const uint32_t first_row = uint32_t( task_idx * RowsPerTask );
+            const uint32_t last_row = std::min( num_rows, uint32_t( first_row + RowsPerTask ) );
+            for ( uint32_t row = first_row; row < last_row; ++row )
+                fn( row );
+        } );
+    }
+}
+
+uint32_t GetNumMips( uint32_t width, uint32_t height )
+{
+    uint32_t num_mips = 1;
+    for ( uint32_t size = std::max( width, height ); size > 1; size /= 2 )
+        num_mips++;
+    return num_mips;
+}
+
+void GenerateMips( std::vector<TextureImage>& mips, const MipSettings& settings, ITaskScheduler& scheduler )
+{
+    assert( !mips.empty() );
+    assert( mips[0].width > 0 && mips[0].height > 0 && mips[0].texels.size() == size_t( mips[0].width ) * mips[0].height * 4 );
+
+    uint32_t num_mips = GetNumMips( mips[0].width, mips[0].height );
+    if ( settings.max_mips > 0 )
+        num_mips = std::min( num_mips, settings.max_mips );
+    mips.resize( num_mips );
+
+    // the whole chain is filtered in linear space, only the stored levels are converted back
+    std::vector<float> src = mips[0].texels;
+    if ( settings.content == MipContent::SRGB || settings.content == MipContent::NormalMap )
+    {
+        ParallelForRows( scheduler, mips[0].height, [&]( uint32_t row )
+        {
+            for ( size_t i = size_t( row ) * mips[0].width; i < size_t( row + 1 ) * mips[0].width; ++i )
+                ToFilterSpace( &src[i * 4], settings.content );
+        } );
+    }
+
+    std::vector<float> horizontal;
+    std::vector<float> dst;
+    for ( uint32_t level = 1; level < num_mips; ++level )
+    {
+        const uint32_t src_width = mips[level - 1].width;
+        const uint32_t src_height = mips[level - 1].height;
+        TextureImage& mip = mips[level];
+        mip.width = std::max( src_width / 2, 1u );
+        mip.height = std::max( src_height / 2, 1u );
+        mip.texels.resize( size_t( mip.width ) * mip.height * 4 );
+
+        const FilterTaps taps_x = BuildFilterTaps( src_width, mip.width, settings.filter, settings.wrap );
+        const FilterTaps taps_y = BuildFilterTaps( src_height, mip.height, settings.filter, settings.wrap );
+
+        horizontal.resize( size_t( mip.width ) * src_height * 4 );
+        ParallelForRows( scheduler, src_height, [&]( uint32_t row )
+        {
+            const float* src_row = src.data() + size_t( row ) * src_width * 4;
+            float* dst_row = horizontal.data() + size_t( row ) * mip.width * 4;
+            for ( uint32_t x = 0; x < mip.width; ++x )
+            {
+                float sum[4] = {};
+                for ( uint32_t tap = 0; tap < taps_x.taps_per_texel; ++tap )
+                {
+                    const float weight = taps_x.weights[size_t( x ) * taps_x.taps_per_texel + tap];
+                    const float* texel = src_row + size_t( taps_x.src_texels[size_t( x ) * taps_x.taps_per_texel + tap] ) * 4;
+                    for ( int c = 0; c < 4; ++c )
+                        sum[c] += texel[c] * weight;
+                }
+                std::copy_n( sum, 4, dst_row + size_t( x ) * 4 );
+            }
+        } );
+
+        dst.resize( mip.texels.size() );
+        ParallelForRows( scheduler, mip.height, [&]( uint32_t row )
+        {
+            float* dst_row = dst.data() + size_t( row ) * mip.width * 4;
+            std::fill_n( dst_row, size_t( mip.width ) * 4, 0.0f );
+            for ( uint32_t tap = 0; tap < taps_y.taps_per_texel; ++tap )
+            {
+                const float weight = taps_y.weights[size_t( row ) * taps_y.taps_per_texel + tap];
+                if ( weight == 0.0f )
+                    continue;
+                const float* src_row = horizontal.data() + size_t( taps_y.src_texels[size_t( row ) * taps_y.taps_per_texel + tap] ) * mip.width * 4;
+                for ( size_t i = 0; i < size_t( mip.width ) * 4; ++i )
+                    dst_row[i] += src_row[i] * weight;
+            }
+
+            float* stored_row = mip.texels.data() + size_t( row ) * mip.width * 4;
+            for ( size_t x = 0; x < mip.width; ++x )
+            {
+                FinishFilteredTexel( dst_row + x * 4, settings.content );
+                FromFilterSpace( dst_row + x * 4, stored_row + x * 4, settings.content );
+            }
+        } );
+
+        std::swap( src, dst );
+    }
+}
+
+float SRGBToLinear( float value )
+{
+    if ( value <= 0.04045f )
+        return value / 12.92f;
+    return std::pow( ( value + 0.055f ) / 1.055f, 2.4f );
+}
+
+float LinearToSRGB( float value )
+{
+    if ( value <= 0.0031308f )
+        return value * 12.92f;
+    return 1.055f * std::pow( value, 1.0f / 2.4f ) - 0.055f;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class ITaskScheduler;
+
+// Mip chain generation for RGBA32F images. Every level is filtered from the previous one with a separable filter
+// and halves its size, odd sizes round down and levels never get smaller than one texel
+
+// RGBA32F texels, row major without padding
+struct TextureImage
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<float> texels; // width * height * 4 floats
+};
+
+enum class MipFilter : uint8_t
+{
+    Box = 0, // average of the covered texels. Cheap, but blurs and lets high frequencies alias
+    Kaiser, // Kaiser windowed sinc. Sharper and with less aliasing, may ring a little around hard edges
+};
+
+enum class MipContent : uint8_t
+{
+    Linear = 0, // [0, 1] values filtered as they are
+    SRGB, // rgb is sRGB encoded and filtered in linear space, alpha is linear
+    NormalMap, // rgb is a unit vector stored as n * 0.5 + 0.5 and renormalized after filtering, alpha is linear
+    HDR, // unbounded non-negative linear values
+};
+
+struct MipSettings
+{
+    MipFilter filter = MipFilter::Kaiser;
+    MipContent content = MipContent::SRGB;
+    bool wrap = false; // filters of tiling textures sample across the opposite edge, others clamp to the edge texel
+    uint32_t max_mips = 0; // including the source, 0 means the full chain down to 1x1
+};
+
+uint32_t GetNumMips( uint32_t width, uint32_t height );
+
+// mips[0] is the source, levels after it are replaced with the generated chain. Rows are filtered in parallel
+void GenerateMips( std::vector<TextureImage>& mips, const MipSettings& settings, ITaskScheduler& scheduler );
+
+float SRGBToLinear( float value );
+float LinearToSRGB( float value );
@@ -1,7 +1,54 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
+#include <type_traits>
 #include <utility>
+#include <vector>
+
+// Node size policy. The factor is chosen so that the key array of a full node takes KeyCacheLines cache lines,
+// a node search then touches a fixed number of lines on each level. Nodes with big values are kept under MaxNodeSize
+template<typename Key, typename T, uint32_t CacheLineSize = 64, uint32_t KeyCacheLines = 4, uint32_t MaxNodeSize = 4096>
+struct btree_map_cache_line_policy
+{
+    static constexpr uint32_t cache_line_size = CacheLineSize;
+
+    static constexpr uint32_t max_keys_by_cache_lines = uint32_t( KeyCacheLines * CacheLineSize / sizeof( Key ) );
+    static constexpr uint32_t max_keys_by_node_size = uint32_t( MaxNodeSize / ( sizeof( Key ) + sizeof( T ) + sizeof( void* ) ) );
+    static constexpr uint32_t max_keys = std::max( std::min( max_keys_by_cache_lines, max_keys_by_node_size ), 3u );
+
+    // a node holds up to 2F - 1 keys
+    static constexpr uint32_t factor = ( max_keys + 1 ) / 2;
+};
+
+
+// Keys with an integer representation that has the same ordering (ordered_bits_t) are searched with SIMD
+template<typename Key, typename = void>
+struct btree_map_key_traits
+{
+    using ordered_bits_t = void;
+};
+
+template<typename Key>
+struct btree_map_key_traits<Key, std::enable_if_t<std::is_integral_v<Key> && ( sizeof( Key ) == 4 || sizeof( Key ) == 8 )>>
+{
+    using ordered_bits_t = Key;
+};
+
+template<typename Key>
+struct btree_map_key_traits<Key*, void>
+{
+    using ordered_bits_t = uintptr_t;
+};
+
+template<typename Key>
+struct btree_map_key_traits<Key, std::void_t<typename Key::ordered_bits_t>>
+{
+    static_assert( sizeof( typename Key::ordered_bits_t ) == sizeof( Key ) );
+    using ordered_bits_t = typename Key::ordered_bits_t;
+};
+
 
 template<typename Key, typename T, uint32_t F>
 struct btree_map_node;
@@ -25,14 +72,19 @@ struct btree_map_cursor
     bool operator== ( const btree_map_cursor& rhs ) const { return this->node == rhs.node && this->position == rhs.position; }
 };
 
+// Keys are kept in a separate array at the start of the node, padded to whole cache lines,
+// so that a search on each level reads only the key lines, num_elems and one child pointer.
+// Cold data (max_key, parent cursor, values) goes after that
 template<typename Key, typename T, uint32_t F>
-struct btree_map_node
+struct alignas( 64 ) btree_map_node
 {
-    alignas(Key) char key_storage[sizeof(Key)*(2*F - 1)];
+    static constexpr uint32_t key_storage_size = ( sizeof( Key ) * ( 2*F - 1 ) + 63 ) & ~63u;
+
+    alignas( 64 ) alignas( Key ) char key_storage[key_storage_size];
+    uint32_t num_elems;
     btree_map_node<Key, T, F>* children[2*F];
     const Key* max_key; // including this node's children
     btree_map_cursor<Key, T, F> parent;
-    uint32_t num_elems;
     alignas(T) char value_storage[sizeof(T)*(2*F - 1)];
 
     // simple accessors for convenience
@@ -44,6 +96,9 @@ struct btree_map_node
 
     bool is_leaf() const { return !children[0]; }
     bool is_filled() const { return num_elems == 2*F - 1; }
+
+    // returns the position of the first key not less than the given one, num_elems if there is none
+    uint32_t lower_bound_pos( const Key& key ) const;
 };
 
 template<typename Key, typename T, uint32_t F>
@@ -53,7 +108,7 @@ struct btree_map_default_callback
 };
 
 
-template<typename Key, typename T, uint32_t F,
+template<typename Key, typename T, uint32_t F = btree_map_cache_line_policy<Key, T>::factor,
          typename Allocator = std::allocator<btree_map_node<Key, T, F>>,
          typename PointerChangeCallback = btree_map_default_callback<Key, T, F>>
 class btree_map
@@ -62,6 +117,8 @@ class btree_map
     using allocator_t = Allocator;
     using callback_t = PointerChangeCallback;
 
+    static_assert( F >= 2, "btree_map factor must be at least 2" );
+
     static constexpr uint32_t MiddleIdx = F - 1;
 public:
 
@@ -83,10 +140,33 @@ public:
     cursor_t emplace( const Key& key, Args&&... args );
     cursor_t insert( const Key& key, T elem );
 
+    // Returns the cursor to the element that followed the erased one, or an invalid cursor if there is none
     cursor_t erase( const cursor_t& pos );
 
+    // Bulk operations. The callback is called once for every element that ends up in a new place.
+    // Range elements are pair-like (first is a key, second is a value), sorted by key, keys are unique.
+    // Builds the tree bottom-up in O(n) with packed nodes. If the tree is not empty, its elements are merged
+    // with the range (range values replace existing ones with the same key) and the tree is rebuilt
+    template<typename ForwardIt>
+    void bulk_insert_sorted( ForwardIt first, ForwardIt last );
+
+    // Erase elements for which pred( key, value ) returns true, returns the number of erased elements.
+    // A small number of elements is erased one by one, otherwise the tree is rebuilt from the remaining elements once
+    template<typename Predicate>
+    size_t erase_if( Predicate&& pred );
+
+    // Erase elements with keys in [first_key, last_key), returns the number of erased elements
+    size_t erase_range( const Key& first_key, const Key& last_key );
+
     cursor_t find( const Key& key ) const;
 
+    // returns the first element with a key not less than the given one
+    cursor_t lower_bound( const Key& key ) const;
+
+    // returns up to num_ranges - 1 sorted keys from the upper levels of the tree
+    // that split it into roughly equal independent ranges
+    std::vector<Key> get_split_keys( size_t num_ranges ) const;
+
     cursor_t get_next( const cursor_t& pos ) const;
 
     cursor_t begin() const;
@@ -108,6 +188,20 @@ private:
     // a node must not be null
     void destroy_node_recursive( node_t* node ) noexcept;
 
+    // erasing more than 1/BulkEraseRatio of the elements rebuilds the tree
+    static constexpr size_t BulkEraseRatio = 16;
+
+    // the tree must be empty
+    template<typename ForwardIt>
+    void build_from_sorted( ForwardIt first, size_t count );
+
+    template<typename ForwardIt>
+    node_t* build_subtree( ForwardIt& it, size_t count, uint32_t height, const cursor_t& parent );
+
+    // moves out elements for which should_erase( cursor ) is false, in key order, and rebuilds the tree from them
+    template<typename ShouldErase>
+    void rebuild_without( size_t num_erased, ShouldErase&& should_erase );
+
     node_t* create_empty_node( const cursor_t& cursor );
     node_t* create_root();
 
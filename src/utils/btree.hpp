@@ -2,9 +2,116 @@
 
 #include "btree.h"
 
+#include <algorithm>
 #include <assert.h>
+#include <cstring>
+#include <iterator>
 #include <optional>
 
+#if defined( _M_X64 ) || defined( _M_IX86 ) || defined( __x86_64__ ) || defined( __i386__ )
+#define BTREE_MAP_SSE2
+#include <immintrin.h>
+#endif
+
+
+namespace btree_map_details
+{
+#ifdef BTREE_MAP_SSE2
+    // Counts keys less than the given one, for sorted keys that is the lower bound position.
+    // Branchless: all vectors up to num_keys are compared, lanes past num_keys are masked out.
+    // Reads whole vectors, so the key array must be aligned and padded to the vector size
+    template<typename Bits>
+    uint32_t simd_lower_bound( const Bits* keys, uint32_t num_keys, Bits key )
+    {
+        static_assert( sizeof( Bits ) == 4 || sizeof( Bits ) == 8 );
+
+        // there is only a signed comparison, flip the sign bit for unsigned keys
+        constexpr bool is_unsigned = std::is_unsigned_v<Bits>;
+
+        if constexpr ( sizeof( Bits ) == 4 )
+        {
+#if defined( __AVX2__ )
+            const __m256i bias = _mm256_set1_epi32( is_unsigned ? int32_t( 0x80000000 ) : 0 );
+            const __m256i key_v = _mm256_xor_si256( _mm256_set1_epi32( int32_t( key ) ), bias );
+            const __m256i num_keys_v = _mm256_set1_epi32( int32_t( num_keys ) );
+            __m256i lane_idx = _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 );
+            __m256i counts = _mm256_setzero_si256();
+            for ( uint32_t pos = 0; pos < num_keys; pos += 8 )
+            {
+                const __m256i keys_v = _mm256_xor_si256( _mm256_load_si256( reinterpret_cast<const __m256i*>( keys + pos ) ), bias );
+                const __m256i less = _mm256_and_si256( _mm256_cmpgt_epi32( key_v, keys_v ), _mm256_cmpgt_epi32( num_keys_v, lane_idx ) );
+                counts = _mm256_sub_epi32( counts, less );
+                lane_idx = _mm256_add_epi32( lane_idx, _mm256_set1_epi32( 8 ) );
+            }
+            __m128i sum = _mm_add_epi32( _mm256_castsi256_si128( counts ), _mm256_extracti128_si256( counts, 1 ) );
+#else
+            const __m128i bias = _mm_set1_epi32( is_unsigned ? int32_t( 0x80000000 ) : 0 );
+            const __m128i key_v = _mm_xor_si128( _mm_set1_epi32( int32_t( key ) ), bias );
+            const __m128i num_keys_v = _mm_set1_epi32( int32_t( num_keys ) );
+            __m128i lane_idx = _mm_setr_epi32( 0, 1, 2, 3 );
+            __m128i sum = _mm_setzero_si128();
+            for ( uint32_t pos = 0; pos < num_keys; pos += 4 )
+            {
+                const __m128i keys_v = _mm_xor_si128( _mm_load_si128( reinterpret_cast<const __m128i*>( keys + pos ) ), bias );
+                const __m128i less = _mm_and_si128( _mm_cmpgt_epi32( key_v, keys_v ), _mm_cmpgt_epi32( num_keys_v, lane_idx ) );
+                sum = _mm_sub_epi32( sum, less );
+                lane_idx = _mm_add_epi32( lane_idx, _mm_set1_epi32( 4 ) );
+            }
+#endif
+            sum = _mm_add_epi32( sum, _mm_shuffle_epi32( sum, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+            sum = _mm_add_epi32( sum, _mm_shuffle_epi32( sum, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+            return uint32_t( _mm_cvtsi128_si32( sum ) );
+        }
+        else
+        {
+#if defined( __AVX2__ )
+            const __m256i bias = _mm256_set1_epi64x( is_unsigned ? int64_t( 0x8000000000000000ull ) : 0 );
+            const __m256i key_v = _mm256_xor_si256( _mm256_set1_epi64x( int64_t( key ) ), bias );
+            const __m256i num_keys_v = _mm256_set1_epi64x( int64_t( num_keys ) );
+            __m256i lane_idx = _mm256_setr_epi64x( 0, 1, 2, 3 );
+            __m256i counts = _mm256_setzero_si256();
+            for ( uint32_t pos = 0; pos < num_keys; pos += 4 )
+            {
+                const __m256i keys_v = _mm256_xor_si256( _mm256_load_si256( reinterpret_cast<const __m256i*>( keys + pos ) ), bias );
+                const __m256i less = _mm256_and_si256( _mm256_cmpgt_epi64( key_v, keys_v ), _mm256_cmpgt_epi64( num_keys_v, lane_idx ) );
+                counts = _mm256_sub_epi64( counts, less );
+                lane_idx = _mm256_add_epi64( lane_idx, _mm256_set1_epi64x( 4 ) );
+            }
+            __m128i sum = _mm_add_epi64( _mm256_castsi256_si128( counts ), _mm256_extracti128_si256( counts, 1 ) );
+            sum = _mm_add_epi64( sum, _mm_unpackhi_epi64( sum, sum ) );
+            return uint32_t( _mm_cvtsi128_si32( sum ) );
+#else
+            // SSE2 has no 64-bit comparison, a branchless scalar count still beats an early-out loop
+            uint32_t num_less = 0;
+            for ( uint32_t pos = 0; pos < num_keys; ++pos )
+                num_less += keys[pos] < key;
+            return num_less;
+#endif
+        }
+    }
+#endif
+}
+
+
+template<typename Key, typename T, uint32_t F>
+uint32_t btree_map_node<Key, T, F>::lower_bound_pos( const Key& key ) const
+{
+    using bits_t = typename btree_map_key_traits<Key>::ordered_bits_t;
+
+#ifdef BTREE_MAP_SSE2
+    if constexpr ( ! std::is_void_v<bits_t> )
+    {
+        bits_t key_bits;
+        memcpy( &key_bits, &key, sizeof( key_bits ) );
+        return btree_map_details::simd_lower_bound( reinterpret_cast<const bits_t*>( key_storage ), num_elems, key_bits );
+    }
+    else
+#endif
+    {
+        return uint32_t( std::lower_bound( keys(), keys() + num_elems, key ) - keys() );
+    }
+}
+
 #define btree_map_class btree_map<Key, T, F, Allocator, PointerChangeCallback>
 
 #define btree_map_method_definition( rettype )                   \
@@ -58,18 +165,20 @@ template<typename... Args>
 typename btree_map_class::cursor_t btree_map_class::emplace( const Key& key, Args&&... args )
 {
     cursor_t new_elem_location = find_place_for_insertion( key );
-    assert( new_elem_location.node->is_leaf() );
 
     auto& node = *new_elem_location.node;
     uint32_t pos = new_elem_location.position;
 
     auto* new_key = &node.keys()[pos];
     auto* new_value = &node.values()[pos];
-    if ( *new_key != key || pos == node.num_elems )
+    if ( pos == node.num_elems || *new_key != key )
     {
+        // new elements are always inserted into leaves, existing keys may be found in inner nodes too
+        assert( node.is_leaf() );
         make_space_for_new_elem( node, pos );
         new( new_key ) Key( key );
         new( new_value ) T( std::forward<Args>( args )... );
+        m_size++;
     }
     else
     {
@@ -78,8 +187,6 @@ typename btree_map_class::cursor_t btree_map_class::emplace( const Key& key, Arg
         *new_value = T( std::forward<Args>( args )... );
     }
 
-    m_size++;
-
     return cursor_t{ &node, pos };
 }
 
@@ -113,18 +220,20 @@ void btree_map_class::for_each( node_t& node, Visitor&& visitor )
 btree_map_method_definition( typename btree_map_class::cursor_t )::insert( const Key& key, T elem )
 {
     cursor_t new_elem_location = find_place_for_insertion( key );
-    assert( new_elem_location.node->is_leaf() );
 
     auto& node = *new_elem_location.node;
     uint32_t pos = new_elem_location.position;
 
     auto* new_key = &node.keys()[pos];
     auto* new_value = &node.values()[pos];
-    if ( *new_key != key || pos == node.num_elems )
+    if ( pos == node.num_elems || *new_key != key )
     {
+        // new elements are always inserted into leaves, existing keys may be found in inner nodes too
+        assert( node.is_leaf() );
         make_space_for_new_elem( node, pos );
         new( new_key ) Key( key );
         new( new_value ) T( std::move( elem ) );
+        m_size++;
     }
     else
     {
@@ -133,8 +242,6 @@ btree_map_method_definition( typename btree_map_class::cursor_t )::insert( const
         *new_value = std::move( elem );
     }
 
-    m_size++;
-
     return cursor_t{ &node, pos };
 }
 
@@ -197,8 +304,107 @@ btree_map_method_definition( typename btree_map_class::cursor_t )::erase( const
 
         notify_cursor_change( cursor );
 
-        return erase( next );
+        // the successor now lives in this slot, but rebalancing the leaf may move it again
+        const Key successor_key = node.keys()[pos];
+        erase( next );
+        return find_elem( successor_key );
+    }
+}
+
+
+template<typename Key, typename T, uint32_t F,
+         typename Allocator, typename PointerChangeCallback>
+template<typename ForwardIt>
+void btree_map_class::bulk_insert_sorted( ForwardIt first, ForwardIt last )
+{
+    assert( std::adjacent_find( first, last, []( const auto& lhs, const auto& rhs ) { return !( lhs.first < rhs.first ); } ) == last );
+
+    if ( m_size == 0 )
+    {
+        build_from_sorted( first, size_t( std::distance( first, last ) ) );
+        return;
     }
+
+    std::vector<std::pair<Key, T>> merged;
+    merged.reserve( m_size + size_t( std::distance( first, last ) ) );
+
+    cursor_t cursor = begin();
+    while ( cursor.valid() || first != last )
+    {
+        if ( first == last || ( cursor.valid() && cursor.key() < first->first ) )
+        {
+            merged.emplace_back( std::move( cursor.key() ), std::move( cursor.value() ) );
+            cursor = get_next( cursor );
+        }
+        else
+        {
+            if ( cursor.valid() && cursor.key() == first->first )
+                cursor = get_next( cursor );
+            auto&& elem = *first;
+            merged.emplace_back( std::forward<decltype( elem )>( elem ).first, std::forward<decltype( elem )>( elem ).second );
+            ++first;
+        }
+    }
+
+    clear();
+    build_from_sorted( std::make_move_iterator( merged.begin() ), merged.size() );
+}
+
+
+template<typename Key, typename T, uint32_t F,
+         typename Allocator, typename PointerChangeCallback>
+template<typename Predicate>
+size_t btree_map_class::erase_if( Predicate&& pred )
+{
+    std::vector<Key> keys_to_erase;
+    for ( cursor_t cursor = begin(); cursor.valid(); cursor = get_next( cursor ) )
+        if ( pred( std::as_const( cursor.key() ), std::as_const( cursor.value() ) ) )
+            keys_to_erase.push_back( cursor.key() );
+
+    if ( keys_to_erase.size() * BulkEraseRatio <= m_size )
+    {
+        for ( const Key& key : keys_to_erase )
+            erase( find_elem( key ) );
+        return keys_to_erase.size();
+    }
+
+    // both sequences are sorted
+    auto next_key_to_erase = keys_to_erase.cbegin();
+    rebuild_without( keys_to_erase.size(), [&]( const cursor_t& cursor )
+    {
+        if ( next_key_to_erase == keys_to_erase.cend() || *next_key_to_erase != cursor.key() )
+            return false;
+        ++next_key_to_erase;
+        return true;
+    } );
+
+    return keys_to_erase.size();
+}
+
+
+btree_map_method_definition( size_t )::erase_range( const Key& first_key, const Key& last_key )
+{
+    if ( !( first_key < last_key ) )
+        return 0;
+
+    size_t num_erased = 0;
+    for ( cursor_t cursor = lower_bound( first_key ); cursor.valid() && cursor.key() < last_key; cursor = get_next( cursor ) )
+        num_erased++;
+
+    if ( num_erased * BulkEraseRatio <= m_size )
+    {
+        cursor_t cursor = lower_bound( first_key );
+        for ( size_t i = 0; i < num_erased; ++i )
+            cursor = erase( cursor );
+        return num_erased;
+    }
+
+    rebuild_without( num_erased, [&]( const cursor_t& cursor )
+    {
+        return !( cursor.key() < first_key ) && cursor.key() < last_key;
+    } );
+
+    return num_erased;
 }
 
 
@@ -208,6 +414,74 @@ btree_map_method_definition( typename btree_map_class::cursor_t )::find( const K
 }
 
 
+btree_map_method_definition( typename btree_map_class::cursor_t )::lower_bound( const Key& key ) const
+{
+    assert( m_root );
+
+    // the closest inner node element greater than the key on the way down
+    cursor_t candidate = cursor_t{ nullptr, 0 };
+    node_t* cur_node = m_root;
+    for ( ;; )
+    {
+        const uint32_t position = cur_node->lower_bound_pos( key );
+        if ( position < cur_node->num_elems && key == cur_node->keys()[position] )
+            return cursor_t{ cur_node, position };
+
+        if ( cur_node->is_leaf() )
+        {
+            if ( position < cur_node->num_elems )
+                return cursor_t{ cur_node, position };
+            return candidate;
+        }
+
+        if ( position < cur_node->num_elems )
+            candidate = cursor_t{ cur_node, position };
+
+        cur_node = cur_node->children[position];
+    }
+}
+
+
+btree_map_method_definition( std::vector<Key> )::get_split_keys( size_t num_ranges ) const
+{
+    assert( m_root );
+
+    std::vector<Key> split_keys;
+    if ( num_ranges < 2 || m_size == 0 )
+        return split_keys;
+
+    // all leaves have the same depth, so keys of one level are sorted when the level is traversed from left to right
+    std::vector<const node_t*> level{ m_root };
+    std::vector<const node_t*> next_level;
+    size_t level_keys = m_root->num_elems;
+    while ( level_keys < num_ranges - 1 && ! level.front()->is_leaf() )
+    {
+        next_level.clear();
+        level_keys = 0;
+        for ( const node_t* node : level )
+            for ( uint32_t i = 0; i <= node->num_elems; ++i )
+            {
+                next_level.push_back( node->children[i] );
+                level_keys += node->children[i]->num_elems;
+            }
+        std::swap( level, next_level );
+    }
+
+    std::vector<const Key*> level_key_ptrs;
+    level_key_ptrs.reserve( level_keys );
+    for ( const node_t* node : level )
+        for ( uint32_t i = 0; i < node->num_elems; ++i )
+            level_key_ptrs.push_back( &node->keys()[i] );
+
+    const size_t num_split_keys = std::min( num_ranges - 1, level_key_ptrs.size() );
+    split_keys.reserve( num_split_keys );
+    for ( size_t i = 0; i < num_split_keys; ++i )
+        split_keys.push_back( *level_key_ptrs[( ( i + 1 ) * level_key_ptrs.size() ) / ( num_split_keys + 1 )] );
+
+    return split_keys;
+}
+
+
 btree_map_method_definition( typename btree_map_class::cursor_t )::get_next( const cursor_t& pos ) const
 {
     assert( pos.node );
@@ -290,6 +564,95 @@ btree_map_method_definition( void )::destroy_node_recursive( node_t* node ) noex
 }
 
 
+template<typename Key, typename T, uint32_t F,
+         typename Allocator, typename PointerChangeCallback>
+template<typename ForwardIt>
+void btree_map_class::build_from_sorted( ForwardIt first, size_t count )
+{
+    assert( m_root && m_size == 0 );
+
+    if ( count == 0 )
+        return;
+
+    // the lowest tree that fits all the elements, max_subtree_size[h] = (2F)^h - 1
+    std::vector<size_t> max_subtree_size{ 0 };
+    while ( max_subtree_size.back() < count )
+        max_subtree_size.push_back( ( max_subtree_size.back() + 1 ) * 2 * F - 1 );
+
+    destroy_node_recursive( m_root );
+    m_root = build_subtree( first, count, uint32_t( max_subtree_size.size() - 1 ), cursor_t{ nullptr, 0 } );
+    m_size = count;
+}
+
+
+template<typename Key, typename T, uint32_t F,
+         typename Allocator, typename PointerChangeCallback>
+template<typename ForwardIt>
+typename btree_map_class::node_t* btree_map_class::build_subtree( ForwardIt& it, size_t count, uint32_t height, const cursor_t& parent )
+{
+    node_t* node = create_empty_node( parent );
+
+    auto place_elem = [&]( uint32_t pos )
+    {
+        // moves elements out of move iterators
+        auto&& elem = *it;
+        new( &node->keys()[pos] ) Key( std::forward<decltype( elem )>( elem ).first );
+        new( &node->values()[pos] ) T( std::forward<decltype( elem )>( elem ).second );
+        ++it;
+        notify_cursor_change( *node, pos );
+    };
+
+    if ( height == 1 )
+    {
+        assert( count <= 2*F - 1 );
+        for ( uint32_t i = 0; i < count; ++i )
+            place_elem( i );
+        node->num_elems = uint32_t( count );
+        node->max_key = &node->keys()[count - 1];
+        return node;
+    }
+
+    // as few children as possible so that nodes are packed, but not less than a non-root node needs
+    size_t max_child_size = 2*F - 1;
+    for ( uint32_t i = 2; i < height; ++i )
+        max_child_size = ( max_child_size + 1 ) * 2 * F - 1;
+    const size_t min_children = parent.node ? F : 2;
+    const size_t num_children = std::max( ( count + 1 + max_child_size ) / ( max_child_size + 1 ), min_children );
+    assert( num_children <= 2*F );
+
+    const size_t num_child_elems = count - ( num_children - 1 );
+    for ( uint32_t child = 0; child < num_children; ++child )
+    {
+        const size_t child_count = num_child_elems / num_children + ( child < num_child_elems % num_children ? 1 : 0 );
+        node->children[child] = build_subtree( it, child_count, height - 1, cursor_t{ node, child } );
+        if ( child + 1 < num_children )
+            place_elem( child );
+    }
+
+    node->num_elems = uint32_t( num_children - 1 );
+    node->max_key = node->children[num_children - 1]->max_key;
+    return node;
+}
+
+
+template<typename Key, typename T, uint32_t F,
+         typename Allocator, typename PointerChangeCallback>
+template<typename ShouldErase>
+void btree_map_class::rebuild_without( size_t num_erased, ShouldErase&& should_erase )
+{
+    std::vector<std::pair<Key, T>> remaining;
+    remaining.reserve( m_size - num_erased );
+    for ( cursor_t cursor = begin(); cursor.valid(); cursor = get_next( cursor ) )
+        if ( ! should_erase( std::as_const( cursor ) ) )
+            remaining.emplace_back( std::move( cursor.key() ), std::move( cursor.value() ) );
+
+    assert( remaining.size() == m_size - num_erased );
+
+    clear();
+    build_from_sorted( std::make_move_iterator( remaining.begin() ), remaining.size() );
+}
+
+
 btree_map_method_definition( typename btree_map_class::node_t* )::create_empty_node( const cursor_t& cursor )
 {
     node_t* new_node = m_allocator.allocate( 1 );
@@ -323,17 +686,12 @@ btree_map_method_definition( typename btree_map_class::cursor_t )::find_elem( co
     node_t* cur_node = m_root;
     while ( retval.node == nullptr )
     {
-        uint32_t position = 0;
-        for ( ; position < cur_node->num_elems; ++position )
+        const uint32_t position = cur_node->lower_bound_pos( key );
+        if ( position < cur_node->num_elems && key == cur_node->keys()[position] )
         {
-            if ( key == cur_node->keys()[position] )
-            {
-                retval.node = cur_node;
-                retval.position = position;
-                return retval;
-            }
-            if ( key < cur_node->keys()[position] )
-                break;
+            retval.node = cur_node;
+            retval.position = position;
+            return retval;
         }
 
         if ( cur_node->is_leaf() )
@@ -375,17 +733,12 @@ btree_map_method_definition( typename btree_map_class::cursor_t )::find_place_fo
                 cur_node = right_node;
         }
 
-        uint32_t position = 0;
-        for ( ; position < cur_node->num_elems; ++position )
+        const uint32_t position = cur_node->lower_bound_pos( key );
+        if ( position < cur_node->num_elems && key == cur_node->keys()[position] )
         {
-            if ( key == cur_node->keys()[position] )
-            {
-                retval.node = cur_node;
-                retval.position = position;
-                return retval;
-            }
-            if ( key < cur_node->keys()[position] )
-                break;
+            retval.node = cur_node;
+            retval.position = position;
+            return retval;
         }
 
         if ( cur_node->is_leaf() )
@@ -717,6 +1070,7 @@ btree_map_method_definition( void )::merge_with_neighbour( node_t* node )
 
         m_root = node->children[0];
         m_root->parent = cursor_t{ nullptr, 0 };
+        m_allocator.deallocate( node, 1 );
     }
 }
 
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+#include "packed_freelist.h"
+#include "span.h"
+
+// packed_freelist variant for filling from several threads.
+// insert(), emplace() and erase() may be called from any thread at the same time,
+// the changes are recorded into per-thread staging buffers and become visible only after commit().
+// ids are returned right away and keep the packed_freelist guarantees: they stay valid until the element is erased,
+// and a slot generation check catches stale ids after the slot is reused.
+//
+// const methods and get() see only committed elements, they don't take locks and may run
+// concurrently with insert/emplace/erase.
+// commit() merges the staging buffers into the packed array, it must not run concurrently with any other method
+//
+// elements must be movable
+// max 2^32 elems simultaneously in freelist
+
+template<typename T>
+class concurrent_packed_freelist
+{
+public:
+    using id = typename packed_freelist<T>::id;
+
+    concurrent_packed_freelist() noexcept = default;
+    ~concurrent_packed_freelist();
+
+    concurrent_packed_freelist( const concurrent_packed_freelist& ) = delete;
+    concurrent_packed_freelist& operator=( const concurrent_packed_freelist& ) = delete;
+
+    // thread-safe, the element becomes visible after commit()
+    id insert( T elem );
+    template<typename ... Args>
+    id emplace( Args&& ... args );
+
+    // thread-safe, the element is removed on commit(). Does nothing if the element does not exist at that point
+    void erase( id elem_id );
+
+    // applies staged inserts, then staged erases
+    void commit();
+
+    bool has( id elem_id ) const noexcept;
+
+    // returns nullptr if elem does not exist
+    T* try_get( id elem_id ) noexcept;
+    const T* try_get( id elem_id ) const noexcept;
+
+    // ub if element with elem_id has been deleted
+    T& get( id elem_id ) noexcept;
+    const T& get( id elem_id ) const noexcept;
+
+    size_t get_packed_idx( id elem_id ) const noexcept;
+
+    T& operator[]( id elem_id ) noexcept;
+    const T& operator[]( id elem_id ) const noexcept;
+
+    // committed elements only
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+
+    void reserve( uint32_t nelems );
+
+    using iterator = typename std::vector<T>::iterator;
+    using const_iterator = typename std::vector<T>::const_iterator;
+
+    // these traversal iterators are invalidated by commit()
+    iterator begin() noexcept;
+    iterator end() noexcept;
+
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+
+    span<T> get_elems() noexcept;
+    span<const T> get_elems() const noexcept;
+
+    T* data() noexcept;
+    const T* data() const noexcept;
+
+private:
+    // threads get one staging buffer each, if there are more threads than buffers some of them share buffers
+    static constexpr uint32_t MaxStagingBuffers = 64;
+
+    struct staging_buffer
+    {
+        std::mutex lock; // uncontended unless threads share a buffer
+        std::vector<std::pair<id, T>> inserts;
+        std::vector<id> erases;
+    };
+
+    struct freelist_elem
+    {
+        uint32_t packed_idx;
+        uint32_t slot_cnt;
+    };
+
+    static constexpr uint32_t NOT_PACKED = std::numeric_limits<uint32_t>::max();
+
+    static uint32_t get_thread_idx() noexcept;
+
+    staging_buffer& get_staging_buffer();
+
+    id allocate_id() noexcept;
+
+    std::vector<T> m_packed_data;
+    std::vector<freelist_elem> m_freelist;
+    std::vector<uint32_t> m_backlinks;
+
+    // slots freed before the last commit, handed out to new elements lock-free
+    std::vector<uint32_t> m_free_slots;
+    std::atomic<uint32_t> m_num_taken_free_slots = 0;
+    std::atomic<uint32_t> m_next_new_slot = 0;
+
+    std::array<std::atomic<staging_buffer*>, MaxStagingBuffers> m_staging_buffers = {};
+};
+
+#include "concurrent_packed_freelist.hpp"
@@ -0,0 +1,303 @@
+#pragma once
+
+#include "concurrent_packed_freelist.h"
+
+#include <algorithm>
+#include <cassert>
+
+
+template<typename T>
+concurrent_packed_freelist<T>::~concurrent_packed_freelist()
+{
+    for ( auto& buffer : m_staging_buffers )
+        delete buffer.load( std::memory_order_acquire );
+}
+
+
+template<typename T>
+typename concurrent_packed_freelist<T>::id concurrent_packed_freelist<T>::insert( T elem )
+{
+    const id new_id = allocate_id();
+
+    staging_buffer& buffer = get_staging_buffer();
+    std::lock_guard<std::mutex> lock( buffer.lock );
+    buffer.inserts.emplace_back( new_id, std::move( elem ) );
+
+    return new_id;
+}
+
+
+template<typename T>
+template<typename ... Args>
+typename concurrent_packed_freelist<T>::id concurrent_packed_freelist<T>::emplace( Args&& ... args )
+{
+    return insert( T( std::forward<Args>( args )... ) );
+}
+
+
+template<typename T>
+void concurrent_packed_freelist<T>::erase( id elem_id )
+{
+    staging_buffer& buffer = get_staging_buffer();
+    std::lock_guard<std::mutex> lock( buffer.lock );
+    buffer.erases.push_back( elem_id );
+}
+
+
+template<typename T>
+void concurrent_packed_freelist<T>::commit()
+{
+    // inserts first, so that elements inserted and erased before the same commit are erased
+    for ( auto& buffer_ptr : m_staging_buffers )
+    {
+        staging_buffer* buffer = buffer_ptr.load( std::memory_order_acquire );
+        if ( ! buffer )
+            continue;
+
+        for ( auto& [new_id, elem] : buffer->inserts )
+        {
+            if ( new_id.idx >= m_freelist.size() )
+                m_freelist.resize( size_t( new_id.idx ) + 1, freelist_elem{ NOT_PACKED, 0 } );
+
+            freelist_elem& slot = m_freelist[new_id.idx];
+            assert( slot.slot_cnt == new_id.inner_id && slot.packed_idx == NOT_PACKED );
+
+            slot.packed_idx = uint32_t( m_packed_data.size() );
+            m_packed_data.push_back( std::move( elem ) );
+            m_backlinks.push_back( new_id.idx );
+        }
+        buffer->inserts.clear();
+    }
+
+    assert( m_freelist.size() == m_next_new_slot.load( std::memory_order_relaxed ) );
+
+    // slots that were not handed out stay free
+    const uint32_t num_taken_free_slots = std::min<uint32_t>( m_num_taken_free_slots.load( std::memory_order_relaxed ), uint32_t( m_free_slots.size() ) );
+    m_free_slots.erase( m_free_slots.begin(), m_free_slots.begin() + num_taken_free_slots );
+
+    for ( auto& buffer_ptr : m_staging_buffers )
+    {
+        staging_buffer* buffer = buffer_ptr.load( std::memory_order_acquire );
+        if ( ! buffer )
+            continue;
+
+        for ( id elem_id : buffer->erases )
+        {
+            if ( ! has( elem_id ) )
+                continue;
+
+            freelist_elem& slot = m_freelist[elem_id.idx];
+            slot.slot_cnt++;
+
+            using std::swap; // include to adl
+            swap( m_packed_data.back(), m_packed_data[slot.packed_idx] );
+            m_packed_data.pop_back();
+
+            m_freelist[m_backlinks.back()].packed_idx = slot.packed_idx;
+            swap( m_backlinks.back(), m_backlinks[slot.packed_idx] );
+            m_backlinks.pop_back();
+
+            slot.packed_idx = NOT_PACKED;
+            m_free_slots.push_back( elem_id.idx );
+        }
+        buffer->erases.clear();
+    }
+
+    m_num_taken_free_slots.store( 0, std::memory_order_relaxed );
+    m_next_new_slot.store( uint32_t( m_freelist.size() ), std::memory_order_relaxed );
+}
+
+
+template<typename T>
+bool concurrent_packed_freelist<T>::has( id elem_id ) const noexcept
+{
+    if ( elem_id.idx < m_freelist.size() )
+        return m_freelist[elem_id.idx].slot_cnt == elem_id.inner_id && m_freelist[elem_id.idx].packed_idx != NOT_PACKED;
+    else
+        return false;
+}
+
+
+template<typename T>
+T* concurrent_packed_freelist<T>::try_get( id elem_id ) noexcept
+{
+    if ( has( elem_id ) )
+        return &m_packed_data[m_freelist[elem_id.idx].packed_idx];
+    return nullptr;
+}
+
+
+template<typename T>
+const T* concurrent_packed_freelist<T>::try_get( id elem_id ) const noexcept
+{
+    if ( has( elem_id ) )
+        return &m_packed_data[m_freelist[elem_id.idx].packed_idx];
+    return nullptr;
+}
+
+
+template<typename T>
+T& concurrent_packed_freelist<T>::get( id elem_id ) noexcept
+{
+    assert( has( elem_id ) );
+    return m_packed_data[m_freelist[elem_id.idx].packed_idx];
+}
+
+
+template<typename T>
+const T& concurrent_packed_freelist<T>::get( id elem_id ) const noexcept
+{
+    assert( has( elem_id ) );
+    return m_packed_data[m_freelist[elem_id.idx].packed_idx];
+}
+
+
+template<typename T>
+size_t concurrent_packed_freelist<T>::get_packed_idx( id elem_id ) const noexcept
+{
+    assert( has( elem_id ) );
+    return m_freelist[elem_id.idx].packed_idx;
+}
+
+
+template<typename T>
+T& concurrent_packed_freelist<T>::operator[]( id elem_id ) noexcept
+{
+    return get( elem_id );
+}
+
+
+template<typename T>
+const T& concurrent_packed_freelist<T>::operator[]( id elem_id ) const noexcept
+{
+    return get( elem_id );
+}
+
+
+template<typename T>
+size_t concurrent_packed_freelist<T>::size() const noexcept
+{
+    return m_packed_data.size();
+}
+
+
+template<typename T>
+bool concurrent_packed_freelist<T>::empty() const noexcept
+{
+    return m_packed_data.empty();
+}
+
+
+template<typename T>
+void concurrent_packed_freelist<T>::reserve( uint32_t nelems )
+{
+    m_packed_data.reserve( nelems );
+    m_freelist.reserve( nelems );
+    m_backlinks.reserve( nelems );
+}
+
+
+template<typename T>
+typename concurrent_packed_freelist<T>::iterator concurrent_packed_freelist<T>::begin() noexcept
+{
+    return m_packed_data.begin();
+}
+
+
+template<typename T>
+typename concurrent_packed_freelist<T>::iterator concurrent_packed_freelist<T>::end() noexcept
+{
+    return m_packed_data.end();
+}
+
+
+template<typename T>
+typename concurrent_packed_freelist<T>::const_iterator concurrent_packed_freelist<T>::begin() const noexcept
+{
+    return m_packed_data.begin();
+}
+
+
+template<typename T>
+typename concurrent_packed_freelist<T>::const_iterator concurrent_packed_freelist<T>::end() const noexcept
+{
+    return m_packed_data.end();
+}
+
+
+template<typename T>
+span<T> concurrent_packed_freelist<T>::get_elems() noexcept
+{
+    return make_span( m_packed_data );
+}
+
+
+template<typename T>
+span<const T> concurrent_packed_freelist<T>::get_elems() const noexcept
+{
+    return make_span( m_packed_data );
+}
+
+
+template<typename T>
+T* concurrent_packed_freelist<T>::data() noexcept
+{
+    return m_packed_data.data();
+}
+
+
+template<typename T>
+const T* concurrent_packed_freelist<T>::data() const noexcept
+{
+    return m_packed_data.data();
+}
+
+
+template<typename T>
+uint32_t concurrent_packed_freelist<T>::get_thread_idx() noexcept
+{
+    static std::atomic<uint32_t> num_threads = 0;
+    thread_local const uint32_t thread_idx = num_threads.fetch_add( 1, std::memory_order_relaxed );
+    return thread_idx;
+}
+
+
+template<typename T>
+typename concurrent_packed_freelist<T>::staging_buffer& concurrent_packed_freelist<T>::get_staging_buffer()
+{
+    std::atomic<staging_buffer*>& buffer_ptr = m_staging_buffers[get_thread_idx() % MaxStagingBuffers];
+
+    staging_buffer* buffer = buffer_ptr.load( std::memory_order_acquire );
+    if ( ! buffer )
+    {
+        staging_buffer* new_buffer = new staging_buffer();
+        if ( buffer_ptr.compare_exchange_strong( buffer, new_buffer, std::memory_order_acq_rel ) )
+            buffer = new_buffer;
+        else
+            delete new_buffer;
+    }
+
+    return *buffer;
+}
+
+
+template<typename T>
+typename concurrent_packed_freelist<T>::id concurrent_packed_freelist<T>::allocate_id() noexcept
+{
+    id new_id;
+
+    const uint32_t free_slot_idx = m_num_taken_free_slots.fetch_add( 1, std::memory_order_relaxed );
+    if ( free_slot_idx < m_free_slots.size() )
+    {
+        // the slot generation only changes on commit, no need to synchronize
+        new_id.idx = m_free_slots[free_slot_idx];
+        new_id.inner_id = m_freelist[new_id.idx].slot_cnt;
+    }
+    else
+    {
+        new_id.idx = m_next_new_slot.fetch_add( 1, std::memory_order_relaxed );
+        new_id.inner_id = 0;
+    }
+
+    return new_id;
+}
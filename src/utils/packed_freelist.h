@@ -20,19 +20,24 @@ class packed_freelist
 public:
     struct alignas( 8 ) id
     {
+		// idx is the high half of the comparator on little-endian targets,
+		// so comparing comparators orders ids by idx first, then by inner_id
 		union
 		{
 			struct
 			{
-				uint32_t idx;
 				uint32_t inner_id;
+				uint32_t idx;
 			};
 			uint64_t comparator;
 		};
         bool operator==( const id& rhs ) const noexcept { return this->comparator == rhs.comparator; }
         bool operator!=( const id& rhs ) const noexcept { return this->comparator != rhs.comparator; }
-        bool operator<( const id& rhs ) const noexcept { return this->idx < rhs.idx || this->idx == rhs.idx && this->inner_id < rhs.inner_id; }
-        bool operator>( const id& rhs ) const noexcept { return this->idx > rhs.idx || this->idx == rhs.idx && this->inner_id > rhs.inner_id; }
+        bool operator<( const id& rhs ) const noexcept { return this->comparator < rhs.comparator; }
+        bool operator>( const id& rhs ) const noexcept { return this->comparator > rhs.comparator; }
+
+        // lets btree_map compare ids as plain integers
+        using ordered_bits_t = uint64_t;
 
         static const id nullid;
 
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
 // contigious span of elements
 template<typename T>
 class span